@@ -0,0 +1,176 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Runtime.InteropServices;
+
+namespace QuickLook.Common.Helpers;
+
+/// <summary>
+/// What a file is by its content, guessed by QuickLook.Native from the first and last few kilobytes, which it reads
+/// once. The host sniffs every file before asking the plugins whether they can handle it, so a plugin can consult the
+/// guesses here instead of opening the file itself.
+/// </summary>
+public static class ContentTypeHelper
+{
+    // ContentType::MAX_GUESSES in QuickLook.Native/QuickLook.Native32/ContentType.h
+    private const uint MaxGuesses = 8;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static readonly object CacheLock = new();
+    private static readonly Dictionary<uint, string> MimeTypes = [];
+
+    private static volatile bool _unavailable;
+    private static string _path;
+    private static ContentTypeGuess[] _guesses;
+
+    /// <summary>
+    /// Reads <paramref name="path" /> again and remembers the guesses for it, which <see cref="Guess" /> then returns.
+    /// </summary>
+    /// <returns>
+    /// The guesses, most confident first; empty if nothing matched, or <see langword="null" /> if the file cannot be
+    /// read or the native library is not available.
+    /// </returns>
+    public static ContentTypeGuess[] Sniff(string path)
+    {
+        var guesses = SniffNative(path);
+        lock (CacheLock)
+        {
+            _path = path;
+            _guesses = guesses;
+        }
+        return guesses;
+    }
+
+    /// <summary>
+    /// The guesses for <paramref name="path" />, from the last <see cref="Sniff" /> if it was for the same path.
+    /// </summary>
+    /// <inheritdoc cref="Sniff" />
+    public static ContentTypeGuess[] Guess(string path)
+    {
+        lock (CacheLock)
+        {
+            if (path != null && string.Equals(path, _path, StringComparison.OrdinalIgnoreCase))
+                return _guesses;
+        }
+        return Sniff(path);
+    }
+
+    /// <summary>
+    /// Whether any guess for <paramref name="path" /> is one of <paramref name="mimeTypes" />. A type ending with
+    /// <c>/*</c>, such as <c>image/*</c>, stands for all of its subtypes.
+    /// </summary>
+    /// <returns>
+    /// <see langword="null" /> if there are no guesses to go by, in which case the caller looks at the file itself.
+    /// </returns>
+    public static bool? Is(string path, params string[] mimeTypes)
+    {
+        if (Guess(path) is not { } guesses)
+            return null;
+
+        return guesses.Any(guess => mimeTypes.Any(mimeType => mimeType.EndsWith("/*", StringComparison.Ordinal)
+            ? guess.MimeType.StartsWith(mimeType.Substring(0, mimeType.Length - 1), StringComparison.Ordinal)
+            : guess.MimeType == mimeType));
+    }
+
+    private static ContentTypeGuess[] SniffNative(string path)
+    {
+        if (_unavailable || string.IsNullOrEmpty(path))
+            return null;
+
+        try
+        {
+            var guesses = new NativeGuess[MaxGuesses];
+            var found = IsArm64 ? ContentTypeSniff_arm64(path, guesses, MaxGuesses, out var count)
+                : Is64Bit ? ContentTypeSniff_64(path, guesses, MaxGuesses, out count)
+                : ContentTypeSniff_32(path, guesses, MaxGuesses, out count);
+            if (!found)
+                return null;
+
+            return [.. guesses.Take((int)Math.Min(count, MaxGuesses))
+                .Select(guess => new ContentTypeGuess(MimeTypeOf(guess.Type), (int)guess.Confidence))];
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    private static string MimeTypeOf(uint type)
+    {
+        lock (MimeTypes)
+        {
+            if (!MimeTypes.TryGetValue(type, out var mimeType))
+            {
+                var name = IsArm64 ? ContentTypeGetMimeType_arm64(type)
+                    : Is64Bit ? ContentTypeGetMimeType_64(type) : ContentTypeGetMimeType_32(type);
+                mimeType = Marshal.PtrToStringAnsi(name) ?? "application/octet-stream";
+                MimeTypes.Add(type, mimeType);
+            }
+            return mimeType;
+        }
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ContentTypeSniff", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ContentTypeSniff_32([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [Out] NativeGuess[] guesses, uint capacity, out uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ContentTypeGetMimeType", CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr ContentTypeGetMimeType_32(uint type);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ContentTypeSniff", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ContentTypeSniff_64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [Out] NativeGuess[] guesses, uint capacity, out uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ContentTypeGetMimeType", CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr ContentTypeGetMimeType_64(uint type);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ContentTypeSniff", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ContentTypeSniff_arm64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [Out] NativeGuess[] guesses, uint capacity, out uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ContentTypeGetMimeType", CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr ContentTypeGetMimeType_arm64(uint type);
+
+    // Must match ContentType::Guess in QuickLook.Native/QuickLook.Native32/ContentType.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeGuess
+    {
+        public uint Type;
+        public uint Confidence;
+    }
+}
+
+/// <summary>
+/// A MIME type a file may have, with how sure the guess is, from 1 to 100.
+/// </summary>
+public sealed class ContentTypeGuess(string mimeType, int confidence)
+{
+    public string MimeType { get; } = mimeType;
+
+    public int Confidence { get; } = confidence;
+
+    public override string ToString() => $"{MimeType} ({Confidence})";
+}
@@ -0,0 +1,348 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
+
+namespace QuickLook.Common.Helpers;
+
+/// <summary>
+/// Apple .icns, Windows .ico and .cur and animated .ani cursors, read by the icon container engine of QuickLook.Native.
+/// Opening one only indexes its entries by type and size; an entry is decoded when it is rendered, so a caller that
+/// renders what <see cref="Select" /> picks decodes just the one entry it shows. Not thread-safe.
+/// </summary>
+public sealed class NativeIconContainer : IDisposable
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+
+    /// <summary>
+    /// How many images an animated cursor has, 1 for any other container.
+    /// </summary>
+    public int IconCount { get; }
+
+    /// <summary>
+    /// Which image each step of the animation shows; a single step showing image 0 unless the cursor is animated.
+    /// </summary>
+    public int[] StepIcons { get; }
+
+    /// <summary>
+    /// How long each step of the animation is shown, in milliseconds.
+    /// </summary>
+    public int[] StepDelays { get; }
+
+    private NativeIconContainer(nint handle, int iconCount, int[] stepIcons, int[] stepDelays)
+    {
+        _handle = handle;
+        IconCount = iconCount;
+        StepIcons = stepIcons;
+        StepDelays = stepDelays;
+    }
+
+    /// <summary>
+    /// Maps the specified file and indexes its entries.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeIconContainer" />, or <see langword="null" /> if the file is not an icon container with at
+    /// least one entry, or the native engine is not available.
+    /// </returns>
+    public static NativeIconContainer Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        return Open(() => IsArm64 ? IconOpen_arm64(path) : Is64Bit ? IconOpen_64(path) : IconOpen_32(path));
+    }
+
+    /// <summary>
+    /// Indexes a copy of <paramref name="data" />, for icons that are not files of their own.
+    /// </summary>
+    /// <inheritdoc cref="Open(string)" />
+    public static NativeIconContainer Open(byte[] data)
+    {
+        _ = data ?? throw new ArgumentNullException(nameof(data));
+
+        var size = (ulong)data.LongLength;
+        return Open(() => IsArm64 ? IconOpenMemory_arm64(data, size)
+            : Is64Bit ? IconOpenMemory_64(data, size) : IconOpenMemory_32(data, size));
+    }
+
+    private static NativeIconContainer Open(Func<nint> open)
+    {
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = open();
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? IconGetInfo_arm64(handle, out var info)
+                : Is64Bit ? IconGetInfo_64(handle, out info) : IconGetInfo_32(handle, out info);
+            if (ok)
+            {
+                var stepIcons = new int[info.StepCount];
+                var stepDelays = new int[info.StepCount];
+                for (var i = 0u; i < info.StepCount; i++)
+                {
+                    _ = IsArm64 ? IconGetStep_arm64(handle, i, out var step)
+                        : Is64Bit ? IconGetStep_64(handle, i, out step) : IconGetStep_32(handle, i, out step);
+                    stepIcons[i] = (int)step.Icon;
+                    stepDelays[i] = (int)Math.Min(step.Delay, int.MaxValue);
+                }
+                return new NativeIconContainer(handle, (int)info.IconCount, stepIcons, stepDelays);
+            }
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// The entry of image <paramref name="icon" /> to show at <paramref name="size" /> pixels across: the smallest one
+    /// at least that large, or else the largest. Entries that <see cref="Render" /> cannot decode are only picked when
+    /// there is nothing else. A size of 0 asks for the largest.
+    /// </summary>
+    /// <returns>The index of the entry, or -1 if the image has none.</returns>
+    public int Select(int icon, int size)
+    {
+        var entry = IsArm64 ? IconSelect_arm64(ThrowIfDisposed(), (uint)icon, (uint)Math.Max(size, 0))
+            : Is64Bit ? IconSelect_64(ThrowIfDisposed(), (uint)icon, (uint)Math.Max(size, 0))
+            : IconSelect_32(ThrowIfDisposed(), (uint)icon, (uint)Math.Max(size, 0));
+        return entry == uint.MaxValue ? -1 : (int)entry;
+    }
+
+    public IconContainerEntry GetEntry(int index)
+    {
+        _ = IsArm64 ? IconGetEntry_arm64(ThrowIfDisposed(), (uint)index, out var entry)
+            : Is64Bit ? IconGetEntry_64(ThrowIfDisposed(), (uint)index, out entry)
+            : IconGetEntry_32(ThrowIfDisposed(), (uint)index, out entry);
+        return entry;
+    }
+
+    /// <summary>
+    /// The stored bytes of an entry, for decoding one that <see cref="Render" /> cannot, such as JPEG 2000.
+    /// </summary>
+    public byte[] GetData(int index)
+    {
+        var ok = IsArm64 ? IconGetData_arm64(ThrowIfDisposed(), (uint)index, out var data, out var size)
+            : Is64Bit ? IconGetData_64(ThrowIfDisposed(), (uint)index, out data, out size)
+            : IconGetData_32(ThrowIfDisposed(), (uint)index, out data, out size);
+        if (!ok)
+            return null;
+
+        var bytes = new byte[size];
+        Marshal.Copy(data, bytes, 0, bytes.Length);
+        return bytes;
+    }
+
+    /// <summary>
+    /// Decodes entry <paramref name="index" />.
+    /// </summary>
+    /// <returns>
+    /// The frozen image, or <see langword="null" /> if the entry is JPEG 2000, too damaged to draw or not there.
+    /// </returns>
+    public BitmapSource Render(int index, double dpiX, double dpiY)
+    {
+        var entry = GetEntry(index);
+        var pixels = IsArm64 ? IconDecode_arm64(ThrowIfDisposed(), (uint)index)
+            : Is64Bit ? IconDecode_64(ThrowIfDisposed(), (uint)index) : IconDecode_32(ThrowIfDisposed(), (uint)index);
+        if (pixels == 0)
+            return null;
+
+        var width = (int)entry.Width;
+        var height = (int)entry.Height;
+        var stride = width * 4;
+        var image = BitmapSource.Create(width, height, dpiX, dpiY, PixelFormats.Pbgra32, null, pixels,
+            stride * height, stride);
+        image.Freeze();
+        return image;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeIconContainer));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            IconClose_arm64(handle);
+        else if (Is64Bit)
+            IconClose_64(handle);
+        else
+            IconClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconOpenMemory", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconOpenMemory_32(byte[] data, ulong size);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void IconClose_32(nint container);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetInfo_32(nint container, out NativeIconInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconGetEntry", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetEntry_32(nint container, uint index, out IconContainerEntry entry);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconGetStep", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetStep_32(nint container, uint index, out NativeIconStep step);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconSelect", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint IconSelect_32(nint container, uint icon, uint size);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconGetData", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetData_32(nint container, uint index, out nint data, out uint size);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "IconDecode", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconDecode_32(nint container, uint index);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconOpenMemory", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconOpenMemory_64(byte[] data, ulong size);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void IconClose_64(nint container);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetInfo_64(nint container, out NativeIconInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconGetEntry", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetEntry_64(nint container, uint index, out IconContainerEntry entry);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconGetStep", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetStep_64(nint container, uint index, out NativeIconStep step);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconSelect", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint IconSelect_64(nint container, uint icon, uint size);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconGetData", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetData_64(nint container, uint index, out nint data, out uint size);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "IconDecode", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconDecode_64(nint container, uint index);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconOpenMemory", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconOpenMemory_arm64(byte[] data, ulong size);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void IconClose_arm64(nint container);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetInfo_arm64(nint container, out NativeIconInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconGetEntry", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetEntry_arm64(nint container, uint index, out IconContainerEntry entry);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconGetStep", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetStep_arm64(nint container, uint index, out NativeIconStep step);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconSelect", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint IconSelect_arm64(nint container, uint icon, uint size);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconGetData", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool IconGetData_arm64(nint container, uint index, out nint data, out uint size);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "IconDecode", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint IconDecode_arm64(nint container, uint index);
+
+    // Must match IconContainer::Info in QuickLook.Native/QuickLook.Native32/IconContainer.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeIconInfo
+    {
+        public uint Format;
+        public uint EntryCount;
+        public uint IconCount;
+        public uint StepCount;
+    }
+
+    // Must match IconContainer::Step in QuickLook.Native/QuickLook.Native32/IconContainer.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeIconStep
+    {
+        public uint Icon;
+        public uint Delay;
+    }
+}
+
+/// <summary>
+/// One image stored in an icon container.
+/// </summary>
+// Must match IconContainer::Entry in QuickLook.Native/QuickLook.Native32/IconContainer.h
+[StructLayout(LayoutKind.Sequential)]
+public struct IconContainerEntry
+{
+    public uint Width;
+    public uint Height;
+    public uint BitDepth;
+    public IconEncoding Encoding;
+
+    /// <summary>
+    /// Which image of an animated cursor the entry belongs to.
+    /// </summary>
+    public uint Icon;
+
+    /// <summary>
+    /// The ICNS OSType, first character in the high byte; 0 for the other containers.
+    /// </summary>
+    public uint Type;
+
+    public uint HotspotX;
+    public uint HotspotY;
+}
+
+// Must match IconContainer::Encoding in QuickLook.Native/QuickLook.Native32/IconContainer.h
+public enum IconEncoding : uint
+{
+    Png,
+    Jpeg2000,
+    Dib,
+    Rle,
+    PackBits,
+    Palette,
+}
@@ -0,0 +1,263 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stdafx.h"
+
+#include "QuickLook.Launcher.h"
+#include <cwchar>
+
+// Must be kept in sync with QuickLook/PipeServerManager.cs and QuickLook/App.xaml.cs
+#define PIPE_PREFIX L"\\\\.\\pipe\\QuickLook.App.Pipe."
+#define APP_MUTEX L"QuickLook.App.Mutex"
+#define APP_FILE L"\\QuickLook.exe"
+
+#define MSG_INVOKE L"QuickLook.App.PipeMessages.Invoke"
+#define MSG_SWITCH L"QuickLook.App.PipeMessages.Switch"
+#define MSG_TOGGLE L"QuickLook.App.PipeMessages.Toggle"
+
+// how long we wait for an instance which holds the mutex but has not opened its pipe yet
+#define PIPE_STARTUP_TIMEOUT 5000
+#define PIPE_BUSY_TIMEOUT 2000
+
+int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
+                      _In_opt_ HINSTANCE hPrevInstance,
+                      _In_ LPWSTR lpCmdLine,
+                      _In_ int nCmdShow)
+{
+    auto argc = 0;
+    auto argv = CommandLineToArgvW(GetCommandLine(), &argc);
+    if (argv == nullptr)
+        return 1;
+
+    // QuickLook.Launcher.exe [/invoke | /toggle | /switch] <path> [options...]
+    auto message = MSG_TOGGLE;
+    PCWCHAR verb = nullptr;
+    auto index = 1;
+    if (index < argc && argv[index][0] == L'/')
+    {
+        if (_wcsicmp(argv[index], L"/invoke") == 0)
+            message = MSG_INVOKE;
+        else if (_wcsicmp(argv[index], L"/switch") == 0)
+            message = MSG_SWITCH;
+
+        if (message != MSG_TOGGLE || _wcsicmp(argv[index], L"/toggle") == 0)
+            verb = argv[index++];
+    }
+
+    // nothing to preview: behave like double-clicking QuickLook.exe
+    if (index >= argc)
+    {
+        LocalFree(argv);
+        return LaunchApp(L"") ? 0 : 1;
+    }
+
+    // the first call asks for the length, including the terminator
+    std::wstring path = argv[index];
+    auto length = GetFullPathName(argv[index], 0, nullptr, nullptr);
+    if (length != 0)
+    {
+        std::wstring fullPath(length, L'\0');
+        length = GetFullPathName(argv[index], length, &fullPath[0], nullptr);
+        if (length != 0 && length < fullPath.size())
+            path.assign(fullPath, 0, length);
+    }
+
+    // same format as PipeServerManager.PostMessage: options are joined by ","
+    std::wstring options;
+    for (auto i = index + 1; i < argc; i++)
+    {
+        if (i > index + 1)
+            options += L',';
+        options += argv[i];
+    }
+
+    auto exists = GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+    auto sent = exists && SendPipeMessage(message, path.c_str(), options.c_str());
+
+    if (!sent)
+    {
+        // no instance is listening: hand the original arguments, verb included, to the full app,
+        // which inherits our working directory and resolves relative paths itself
+        std::wstring arguments;
+        if (verb != nullptr)
+            arguments = verb;
+        for (auto i = index; i < argc; i++)
+            AppendArgument(arguments, argv[i]);
+        sent = LaunchApp(arguments.c_str());
+    }
+
+    LocalFree(argv);
+
+    return sent ? 0 : 1;
+}
+
+bool GetPipeName(PWCHAR buffer, DWORD size)
+{
+    HANDLE hToken = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &hToken))
+        return false;
+
+    DWORD length = 0;
+    GetTokenInformation(hToken, TokenUser, nullptr, 0, &length);
+
+    auto tokenUser = reinterpret_cast<PTOKEN_USER>(new BYTE[length]);
+    auto ret = false;
+
+    if (GetTokenInformation(hToken, TokenUser, tokenUser, length, &length))
+    {
+        PWCHAR sid = nullptr;
+        if (ConvertSidToStringSid(tokenUser->User.Sid, &sid))
+        {
+            ret = wcscpy_s(buffer, size, PIPE_PREFIX) == 0 && wcscat_s(buffer, size, sid) == 0;
+            LocalFree(sid);
+        }
+    }
+
+    delete[] reinterpret_cast<PBYTE>(tokenUser);
+    CloseHandle(hToken);
+
+    return ret;
+}
+
+bool SendPipeMessage(PCWCHAR message, PCWCHAR path, PCWCHAR options)
+{
+    WCHAR pipeName[MAX_PATH] = {'\0'};
+    if (!GetPipeName(pipeName, MAX_PATH))
+        return false;
+
+    auto hPipe = INVALID_HANDLE_VALUE;
+    auto waited = 0UL;
+
+    while (true)
+    {
+        hPipe = CreateFile(pipeName, GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (hPipe != INVALID_HANDLE_VALUE)
+            break;
+
+        auto error = GetLastError();
+
+        // the server is handling another client; it accepts one connection at a time
+        if (error == ERROR_PIPE_BUSY)
+        {
+            if (!WaitNamedPipe(pipeName, PIPE_BUSY_TIMEOUT))
+                return false;
+            continue;
+        }
+
+        // no pipe: either QuickLook is not running, or it holds the mutex and is still starting up
+        if (error == ERROR_FILE_NOT_FOUND && waited < PIPE_STARTUP_TIMEOUT)
+        {
+            auto hMutex = OpenMutex(SYNCHRONIZE, FALSE, APP_MUTEX);
+            if (hMutex == nullptr)
+                return false;
+            CloseHandle(hMutex);
+
+            Sleep(50);
+            waited += 50;
+            continue;
+        }
+
+        return false;
+    }
+
+    // "<message>|<path>|<options>\r\n" in UTF-8, as StreamWriter.WriteLine produces it
+    auto lineLength = wcslen(message) + wcslen(path) + wcslen(options) + 5;
+    auto line = new WCHAR[lineLength]{'\0'};
+    swprintf_s(line, lineLength, L"%s|%s|%s\r\n", message, path, options);
+
+    auto size = WideCharToMultiByte(CP_UTF8, 0, line, -1, nullptr, 0, nullptr, nullptr);
+    auto utf8 = new CHAR[size]{'\0'};
+    WideCharToMultiByte(CP_UTF8, 0, line, -1, utf8, size, nullptr, nullptr);
+
+    DWORD written = 0;
+    auto ret = WriteFile(hPipe, utf8, size - 1, &written, nullptr) && written == static_cast<DWORD>(size - 1);
+    if (ret)
+        FlushFileBuffers(hPipe);
+
+    delete[] utf8;
+    delete[] line;
+    CloseHandle(hPipe);
+
+    return ret;
+}
+
+bool LaunchApp(PCWCHAR arguments)
+{
+    std::wstring fullPath(MAX_PATH_EX, L'\0');
+    auto length = GetModuleFileName(nullptr, &fullPath[0], MAX_PATH_EX);
+    if (length == 0 || length >= MAX_PATH_EX)
+        return false;
+    fullPath.resize(length);
+
+    auto p = fullPath.rfind(L'\\');
+    if (p == std::wstring::npos)
+        return false;
+    fullPath.replace(p, std::wstring::npos, APP_FILE);
+
+    // CreateProcess may modify the command line buffer in place
+    std::wstring cmdLine = L"\"" + fullPath + L"\" " + arguments;
+
+    // longer than CreateProcess accepts: report the failure rather than start the app with a cut-off path
+    if (cmdLine.size() >= MAX_PATH_EX)
+    {
+        SetLastError(ERROR_FILENAME_EXCED_RANGE);
+        return false;
+    }
+
+    STARTUPINFO si = {sizeof si};
+    PROCESS_INFORMATION pi = {nullptr};
+
+    auto ret = CreateProcess(fullPath.c_str(), &cmdLine[0], nullptr, nullptr, false, 0, nullptr, nullptr, &si,
+                             &pi);
+    if (ret)
+    {
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+
+    return ret;
+}
+
+// Appends one argument so that CommandLineToArgvW gives it back unchanged: quoted, with the backslashes
+// in front of a quote or of the closing quote doubled
+void AppendArgument(std::wstring& line, PCWCHAR argument)
+{
+    if (!line.empty())
+        line += L' ';
+    line += L'"';
+
+    for (auto p = argument;; p++)
+    {
+        size_t slashes = 0;
+        while (*p == L'\\')
+        {
+            p++;
+            slashes++;
+        }
+
+        if (*p == L'\0')
+        {
+            line.append(slashes * 2, L'\\');
+            break;
+        }
+
+        line.append(*p == L'"' ? slashes * 2 + 1 : slashes, L'\\');
+        line += *p;
+    }
+
+    line += L'"';
+}
@@ -0,0 +1,763 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ApngImage.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    constexpr uint64_t CHUNK_OVERHEAD = 12; // length, type and CRC
+    constexpr uint32_t IHDR_SIZE = 13;
+    constexpr uint32_t ACTL_SIZE = 8;
+    constexpr uint32_t FCTL_SIZE = 26;
+    constexpr uint32_t PHYS_SIZE = 9;
+    constexpr uint8_t PHYS_METER = 1;
+
+    // 4096 x 4096; every buffer is this many pixels at most, and there are RING_SIZE + 3 of them
+    constexpr uint64_t MAX_PIXELS = 1 << 24;
+
+    constexpr uint8_t GRAY = 0;
+    constexpr uint8_t RGB = 2;
+    constexpr uint8_t INDEXED = 3;
+    constexpr uint8_t GRAY_ALPHA = 4;
+    constexpr uint8_t RGBA = 6;
+
+    constexpr uint8_t FILTER_NONE = 0;
+    constexpr uint8_t FILTER_SUB = 1;
+    constexpr uint8_t FILTER_UP = 2;
+    constexpr uint8_t FILTER_AVERAGE = 3;
+    constexpr uint8_t FILTER_PAETH = 4;
+
+    constexpr uint32_t OPAQUE_BLACK = 0xFF000000;
+
+    // Adam7: pixels of an interlaced image come in seven passes, each a smaller image of every step-th pixel
+    // from start
+    struct Pass
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t stepX;
+        uint32_t stepY;
+    };
+
+    constexpr Pass ADAM7[] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                              {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+    constexpr Pass PROGRESSIVE[] = {{0, 0, 1, 1}};
+
+    inline uint32_t be32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+               static_cast<uint32_t>(p[2]) << 8 | p[3];
+    }
+
+    inline uint16_t be16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] << 8 | p[1]);
+    }
+
+    inline bool isChunk(const uint8_t* type, const char (&name)[5])
+    {
+        return memcmp(type, name, 4) == 0;
+    }
+
+    inline uint32_t channels(uint8_t colorType)
+    {
+        switch (colorType)
+        {
+        case RGB:
+            return 3;
+        case GRAY_ALPHA:
+            return 2;
+        case RGBA:
+            return 4;
+        default:
+            return 1;
+        }
+    }
+
+    bool validDepth(uint8_t colorType, uint8_t bitDepth)
+    {
+        switch (colorType)
+        {
+        case GRAY:
+            return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+        case INDEXED:
+            return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+        case RGB:
+        case GRAY_ALPHA:
+        case RGBA:
+            return bitDepth == 8 || bitDepth == 16;
+        default:
+            return false;
+        }
+    }
+
+    // x / 255, rounded; exact for any product of two bytes
+    inline uint32_t div255(uint32_t x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    inline uint32_t premultiply(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+    {
+        if (a == 255)
+            return OPAQUE_BLACK | r << 16 | g << 8 | b;
+        return a << 24 | div255(r * a) << 16 | div255(g * a) << 8 | div255(b * a);
+    }
+
+    inline uint32_t gray(uint32_t value, uint32_t alpha)
+    {
+        return premultiply(value, value, value, alpha);
+    }
+
+    // the depth-bit sample at index of a row, most significant bits first
+    inline uint32_t sample(const uint8_t* row, uint32_t index, uint32_t depth)
+    {
+        auto bit = index * depth;
+        return static_cast<uint32_t>(row[bit / 8] >> (8 - depth - bit % 8)) & ((1u << depth) - 1);
+    }
+
+    inline uint8_t paeth(uint8_t left, uint8_t up, uint8_t upLeft)
+    {
+        int estimate = left + up - upLeft;
+        auto toLeft = std::abs(estimate - left);
+        auto toUp = std::abs(estimate - up);
+        auto toUpLeft = std::abs(estimate - upLeft);
+        if (toLeft <= toUp && toLeft <= toUpLeft)
+            return left;
+        return toUp <= toUpLeft ? up : upLeft;
+    }
+
+    // Reverses the filter of one scanline in place; prior is the scanline above, already unfiltered, or null.
+    bool unfilter(uint8_t filter, uint8_t* row, const uint8_t* prior, uint32_t size, uint32_t pixelSize)
+    {
+        switch (filter)
+        {
+        case FILTER_NONE:
+            return true;
+        case FILTER_SUB:
+            for (auto i = pixelSize; i < size; i++)
+                row[i] = static_cast<uint8_t>(row[i] + row[i - pixelSize]);
+            return true;
+        case FILTER_UP:
+            if (prior != nullptr)
+            {
+                for (uint32_t i = 0; i < size; i++)
+                    row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+            }
+            return true;
+        case FILTER_AVERAGE:
+            for (uint32_t i = 0; i < size; i++)
+            {
+                uint32_t left = i >= pixelSize ? row[i - pixelSize] : 0;
+                uint32_t up = prior != nullptr ? prior[i] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + ((left + up) >> 1));
+            }
+            return true;
+        case FILTER_PAETH:
+            for (uint32_t i = 0; i < size; i++)
+            {
+                uint8_t left = i >= pixelSize ? row[i - pixelSize] : 0;
+                uint8_t up = prior != nullptr ? prior[i] : 0;
+                uint8_t upLeft = prior != nullptr && i >= pixelSize ? prior[i - pixelSize] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + paeth(left, up, upLeft));
+            }
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // A frame's rectangle clipped to the canvas: the canvas offsets of its first pixel and of the row after its last,
+    // and its width.
+    struct Span
+    {
+        size_t begin;
+        size_t end;
+        uint32_t width;
+    };
+
+    Span clip(const ApngImage::Frame& frame, const ApngImage::Info& info)
+    {
+        Span span;
+        span.width = std::min(frame.width, info.width - frame.left);
+        span.begin = static_cast<size_t>(frame.top) * info.width + frame.left;
+        span.end = static_cast<size_t>(frame.top + std::min(frame.height, info.height - frame.top)) * info.width;
+        return span;
+    }
+
+    // The vector kernels leave what does not fill a whole vector to the scalar loop, and skip vectors of source
+    // pixels that are all opaque or all transparent, which is most of them in a typical frame.
+
+    void blendScalar(uint32_t* target, const uint32_t* source, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto color = source[i];
+            auto alpha = color >> 24;
+            if (alpha == 255)
+            {
+                target[i] = color;
+            }
+            else if (color != 0)
+            {
+                auto inverse = 255 - alpha;
+                auto below = target[i];
+                uint32_t blended = 0;
+                for (uint32_t shift = 0; shift < 32; shift += 8)
+                {
+                    auto channel = (color >> shift & 0xFF) + div255((below >> shift & 0xFF) * inverse);
+                    blended |= std::min(channel, 255u) << shift;
+                }
+                target[i] = blended;
+            }
+        }
+    }
+
+#ifdef QL_SIMD_X86
+    uint32_t blendSse2(uint32_t* target, const uint32_t* source, uint32_t count)
+    {
+        auto zero = _mm_setzero_si128();
+        auto full = _mm_set1_epi32(255);
+        auto half = _mm_set1_epi16(128);
+        auto opaque = _mm_set1_epi32(static_cast<int>(OPAQUE_BLACK));
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            auto color = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            auto alphaSet = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(color, opaque), opaque));
+            if (alphaSet == 0xFFFF)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), color);
+                continue;
+            }
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(color, zero)) == 0xFFFF)
+                continue;
+
+            // 255 - alpha in both 16-bit halves of each pixel, then spread over the four channels
+            auto inverse = _mm_sub_epi32(full, _mm_srli_epi32(color, 24));
+            inverse = _mm_or_si128(inverse, _mm_slli_epi32(inverse, 16));
+            auto below = _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + i));
+            auto low = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(below, zero), _mm_unpacklo_epi32(inverse, inverse)), half);
+            auto high = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(below, zero), _mm_unpackhi_epi32(inverse, inverse)), half);
+            low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+            high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_adds_epu8(_mm_packus_epi16(low, high), color));
+        }
+        return i;
+    }
+
+    QL_TARGET_AVX2 uint32_t blendAvx2(uint32_t* target, const uint32_t* source, uint32_t count)
+    {
+        auto zero = _mm256_setzero_si256();
+        auto full = _mm256_set1_epi32(255);
+        auto half = _mm256_set1_epi16(128);
+        auto opaque = _mm256_set1_epi32(static_cast<int>(OPAQUE_BLACK));
+        uint32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto color = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+            auto alphaSet = _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(color, opaque), opaque));
+            if (alphaSet == -1)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i), color);
+                continue;
+            }
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(color, zero)) == -1)
+                continue;
+
+            // the unpacks work within each 128-bit lane, the same way for the pixels and their inverse alpha
+            auto inverse = _mm256_sub_epi32(full, _mm256_srli_epi32(color, 24));
+            inverse = _mm256_or_si256(inverse, _mm256_slli_epi32(inverse, 16));
+            auto below = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(target + i));
+            auto low = _mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(below, zero), _mm256_unpacklo_epi32(inverse, inverse)), half);
+            auto high = _mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(below, zero), _mm256_unpackhi_epi32(inverse, inverse)), half);
+            low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+            high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i),
+                                _mm256_adds_epu8(_mm256_packus_epi16(low, high), color));
+        }
+        return i;
+    }
+#endif
+
+#ifdef QL_SIMD_NEON
+    uint32_t blendNeon(uint32_t* target, const uint32_t* source, uint32_t count)
+    {
+        auto half = vdupq_n_u16(128);
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            auto color = vld1q_u32(source + i);
+            auto alpha = vshrq_n_u32(color, 24);
+            if (vminvq_u32(alpha) == 255)
+            {
+                vst1q_u32(target + i, color);
+                continue;
+            }
+            if (vmaxvq_u32(color) == 0)
+                continue;
+
+            // 255 - alpha copied into each byte of its pixel
+            auto inverse = vreinterpretq_u8_u32(vmulq_n_u32(vsubq_u32(vdupq_n_u32(255), alpha), 0x01010101));
+            auto below = vreinterpretq_u8_u32(vld1q_u32(target + i));
+            auto low = vaddq_u16(vmull_u8(vget_low_u8(below), vget_low_u8(inverse)), half);
+            auto high = vaddq_u16(vmull_u8(vget_high_u8(below), vget_high_u8(inverse)), half);
+            auto blended = vcombine_u8(vshrn_n_u16(vaddq_u16(low, vshrq_n_u16(low, 8)), 8),
+                                       vshrn_n_u16(vaddq_u16(high, vshrq_n_u16(high, 8)), 8));
+            vst1q_u32(target + i, vreinterpretq_u32_u8(vqaddq_u8(blended, vreinterpretq_u8_u32(color))));
+        }
+        return i;
+    }
+#endif
+}
+
+bool ApngImage::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool ApngImage::Parse(const uint8_t* data, uint64_t size, bool acceptStill)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _records.clear();
+    _chunks.clear();
+    _canvas.clear();
+    _next = 0;
+    for (auto& slot : _ring)
+        slot = {};
+    std::fill_n(_colors, 256, OPAQUE_BLACK);
+    std::fill_n(_transparent, 3, -1);
+
+    if (_data == nullptr || _size < sizeof SIGNATURE + CHUNK_OVERHEAD + IHDR_SIZE ||
+        memcmp(_data, SIGNATURE, sizeof SIGNATURE) != 0)
+        return false;
+
+    uint64_t palette = 0;
+    uint32_t paletteSize = 0;
+    uint64_t transparency = 0;
+    uint32_t transparencySize = 0;
+    auto animated = false;
+    auto seenData = false; // IDAT or fdAT
+
+    // a truncated file keeps the frames that were indexed before it ended
+    for (auto offset = static_cast<uint64_t>(sizeof SIGNATURE); _size - offset >= CHUNK_OVERHEAD;)
+    {
+        auto length = be32(_data + offset);
+        auto type = _data + offset + 4;
+        auto body = offset + 8;
+        if (length > _size - offset - CHUNK_OVERHEAD)
+            break;
+
+        if (offset == sizeof SIGNATURE)
+        {
+            if (!isChunk(type, "IHDR") || length < IHDR_SIZE)
+                return false;
+
+            _info.width = be32(_data + body);
+            _info.height = be32(_data + body + 4);
+            _bitDepth = _data[body + 8];
+            _colorType = _data[body + 9];
+            _interlaced = _data[body + 12] == 1;
+            if (_info.width == 0 || _info.height == 0 ||
+                static_cast<uint64_t>(_info.width) * _info.height > MAX_PIXELS ||
+                !validDepth(_colorType, _bitDepth) || _data[body + 10] != 0 || _data[body + 11] != 0 ||
+                _data[body + 12] > 1)
+                return false;
+        }
+        else if (isChunk(type, "PLTE"))
+        {
+            palette = body;
+            paletteSize = std::min(length / 3, 256u);
+        }
+        else if (isChunk(type, "tRNS"))
+        {
+            transparency = body;
+            transparencySize = length;
+        }
+        else if (isChunk(type, "pHYs") && length >= PHYS_SIZE && _data[body + 8] == PHYS_METER)
+        {
+            _info.pixelsPerMeterX = be32(_data + body);
+            _info.pixelsPerMeterY = be32(_data + body + 4);
+        }
+        else if (isChunk(type, "acTL") && length >= ACTL_SIZE && !seenData)
+        {
+            animated = true;
+            _info.loopCount = be32(_data + body + 4);
+        }
+        else if (isChunk(type, "fcTL") && length >= FCTL_SIZE && animated)
+        {
+            auto control = _data + body;
+            Record record = {};
+            record.frame.width = be32(control + 4);
+            record.frame.height = be32(control + 8);
+            record.frame.left = be32(control + 12);
+            record.frame.top = be32(control + 16);
+            auto numerator = be16(control + 20);
+            auto denominator = be16(control + 22);
+            record.frame.delay = numerator * 1000u / (denominator != 0 ? denominator : 100u);
+            record.frame.disposal = control[24] <= DISPOSE_PREVIOUS ? control[24] : static_cast<uint32_t>(DISPOSE_NONE);
+            record.frame.blend = control[25] == BLEND_OVER ? BLEND_OVER : BLEND_SOURCE;
+            record.firstChunk = static_cast<uint32_t>(_chunks.size());
+            _records.push_back(record);
+        }
+        else if (isChunk(type, "IDAT"))
+        {
+            if (!animated && acceptStill && _records.empty())
+            {
+                Record record = {};
+                record.frame.width = _info.width;
+                record.frame.height = _info.height;
+                _records.push_back(record);
+            }
+
+            // the default image is the first frame only when its control chunk comes before it
+            if (_records.size() == 1)
+            {
+                _chunks.push_back({body, length});
+                _records[0].chunkCount++;
+            }
+            seenData = true;
+        }
+        else if (isChunk(type, "fdAT") && length > 4 && seenData && !_records.empty())
+        {
+            _chunks.push_back({body + 4, length - 4});
+            _records.back().chunkCount++;
+        }
+        else if (isChunk(type, "IEND"))
+        {
+            break;
+        }
+
+        offset = body + length + 4;
+    }
+
+    if (!animated && !acceptStill)
+        return false;
+
+    // frames that cannot be drawn are left out rather than shown wrong
+    _records.erase(std::remove_if(_records.begin(), _records.end(),
+                                  [this](const Record& record)
+                                  {
+                                      auto& frame = record.frame;
+                                      return record.chunkCount == 0 || frame.width == 0 || frame.height == 0 ||
+                                             frame.left >= _info.width || frame.top >= _info.height ||
+                                             static_cast<uint64_t>(frame.width) * frame.height > MAX_PIXELS;
+                                  }),
+                   _records.end());
+    if (!_records.empty() && _records[0].frame.disposal == DISPOSE_PREVIOUS)
+        _records[0].frame.disposal = DISPOSE_BACKGROUND;
+
+    if (_colorType == INDEXED)
+    {
+        for (uint32_t i = 0; i < paletteSize; i++)
+        {
+            auto rgb = _data + palette + i * 3;
+            auto alpha = i < transparencySize ? _data[transparency + i] : 255u;
+            _colors[i] = premultiply(rgb[0], rgb[1], rgb[2], alpha);
+        }
+    }
+    else if (transparency != 0 && (_colorType == GRAY || _colorType == RGB))
+    {
+        for (uint32_t i = 0; i < channels(_colorType) && 2 * i + 2 <= transparencySize; i++)
+            _transparent[i] = be16(_data + transparency + 2 * i);
+    }
+
+    _info.frameCount = static_cast<uint32_t>(_records.size());
+    return _info.frameCount != 0;
+}
+
+bool ApngImage::GetFrame(uint32_t index, Frame* frame) const
+{
+    if (index >= _records.size())
+        return false;
+
+    *frame = _records[index].frame;
+    return true;
+}
+
+const uint8_t* ApngImage::Render(uint32_t index)
+{
+    if (index >= _info.frameCount)
+        return nullptr;
+
+    for (auto& slot : _ring)
+    {
+        if (slot.index == index)
+        {
+            slot.age = ++_clock;
+            return reinterpret_cast<const uint8_t*>(slot.pixels.data());
+        }
+    }
+
+    auto pixels = static_cast<size_t>(_info.width) * _info.height;
+    if (_canvas.empty() || index < _next)
+    {
+        _canvas.assign(pixels, 0);
+        _next = 0;
+    }
+
+    auto slot = std::min_element(std::begin(_ring), std::end(_ring),
+                                 [](const Slot& a, const Slot& b) { return a.age < b.age; });
+    for (; _next <= index; _next++)
+    {
+        auto& record = _records[_next];
+        auto& frame = record.frame;
+        auto span = clip(frame, _info);
+        if (frame.disposal == DISPOSE_PREVIOUS)
+        {
+            _saved.resize(pixels);
+            for (auto at = span.begin; at < span.end; at += _info.width)
+                std::copy_n(_canvas.data() + at, span.width, _saved.data() + at);
+        }
+
+        if (decode(record))
+            compose(record);
+
+        if (_next == index)
+        {
+            snapshot(*slot, index);
+            slot->age = ++_clock;
+        }
+
+        for (auto at = span.begin; at < span.end; at += _info.width)
+        {
+            if (frame.disposal == DISPOSE_BACKGROUND)
+                std::fill_n(_canvas.data() + at, span.width, 0);
+            else if (frame.disposal == DISPOSE_PREVIOUS)
+                std::copy_n(_saved.data() + at, span.width, _canvas.data() + at);
+        }
+    }
+
+    return reinterpret_cast<const uint8_t*>(slot->pixels.data());
+}
+
+void ApngImage::BlendOver(uint32_t* target, const uint32_t* source, uint32_t count, Simd::Level level)
+{
+    uint32_t done = 0;
+    switch (level)
+    {
+#ifdef QL_SIMD_X86
+    case Simd::SSE2:
+        done = blendSse2(target, source, count);
+        break;
+    case Simd::AVX2:
+        done = blendAvx2(target, source, count);
+        break;
+#endif
+#ifdef QL_SIMD_NEON
+    case Simd::NEON:
+        done = blendNeon(target, source, count);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    blendScalar(target + done, source + done, count - done);
+}
+
+bool ApngImage::decode(const Record& record)
+{
+    auto& frame = record.frame;
+    auto bitsPerPixel = channels(_colorType) * _bitDepth;
+    auto pixelSize = std::max(bitsPerPixel / 8, 1u);
+    auto rowSize = [bitsPerPixel](uint32_t width) { return static_cast<uint32_t>((width * bitsPerPixel + 7) / 8); };
+
+    const Pass* passes = PROGRESSIVE;
+    size_t passCount = 1;
+    if (_interlaced)
+    {
+        passes = ADAM7;
+        passCount = sizeof ADAM7 / sizeof ADAM7[0];
+    }
+
+    // a pass with no pixels has no scanlines at all, not even their filter bytes
+    uint64_t total = 0;
+    for (size_t i = 0; i < passCount; i++)
+    {
+        auto& pass = passes[i];
+        auto width = frame.width > pass.x ? (frame.width - pass.x + pass.stepX - 1) / pass.stepX : 0;
+        auto height = frame.height > pass.y ? (frame.height - pass.y + pass.stepY - 1) / pass.stepY : 0;
+        if (width != 0)
+            total += static_cast<uint64_t>(height) * (1 + rowSize(width));
+    }
+
+    // the data chunks are joined first, so the inflater sees one stream
+    _compressed.clear();
+    for (uint32_t i = 0; i < record.chunkCount; i++)
+    {
+        auto& chunk = _chunks[record.firstChunk + i];
+        _compressed.insert(_compressed.end(), _data + chunk.offset, _data + chunk.offset + chunk.size);
+    }
+
+    _filtered.resize(static_cast<size_t>(total));
+    auto available = Inflate::Decompress(_compressed.data(), _compressed.size(), _filtered.data(), _filtered.size());
+    if (available == 0)
+        return false;
+
+    // pixels the data runs out before are left transparent; the passes of an interlaced image are spread out over
+    // all of it
+    _pixels.resize(static_cast<size_t>(frame.width) * frame.height);
+    if (available < total || _interlaced)
+        std::fill(_pixels.begin(), _pixels.end(), 0);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < passCount; i++)
+    {
+        auto& pass = passes[i];
+        auto width = frame.width > pass.x ? (frame.width - pass.x + pass.stepX - 1) / pass.stepX : 0;
+        auto height = frame.height > pass.y ? (frame.height - pass.y + pass.stepY - 1) / pass.stepY : 0;
+        if (width == 0)
+            continue;
+
+        auto size = rowSize(width);
+        const uint8_t* prior = nullptr;
+        for (uint32_t row = 0; row < height; row++, offset += 1 + size)
+        {
+            auto y = pass.y + row * pass.stepY;
+            auto line = _filtered.data() + offset;
+            if (available < offset + 1 + size || !unfilter(line[0], line + 1, prior, size, pixelSize))
+            {
+                if (!_interlaced)
+                    std::fill(_pixels.begin() + static_cast<size_t>(y) * frame.width, _pixels.end(), 0);
+                return true;
+            }
+
+            convertRow(line + 1, width, _pixels.data() + static_cast<size_t>(y) * frame.width + pass.x, pass.stepX);
+            prior = line + 1;
+        }
+    }
+    return true;
+}
+
+void ApngImage::convertRow(const uint8_t* row, uint32_t count, uint32_t* target, uint32_t step) const
+{
+    auto wide = _bitDepth == 16;
+    switch (_colorType)
+    {
+    case RGBA:
+        for (uint32_t x = 0; x < count; x++, target += step)
+        {
+            auto p = row + x * (wide ? 8 : 4);
+            *target = wide ? premultiply(p[0], p[2], p[4], p[6]) : premultiply(p[0], p[1], p[2], p[3]);
+        }
+        break;
+    case RGB:
+        for (uint32_t x = 0; x < count; x++, target += step)
+        {
+            if (wide)
+            {
+                auto p = row + x * 6;
+                auto clear = be16(p) == _transparent[0] && be16(p + 2) == _transparent[1] &&
+                             be16(p + 4) == _transparent[2];
+                *target = clear ? 0 : premultiply(p[0], p[2], p[4], 255);
+            }
+            else
+            {
+                auto p = row + x * 3;
+                auto clear = p[0] == _transparent[0] && p[1] == _transparent[1] && p[2] == _transparent[2];
+                *target = clear ? 0 : premultiply(p[0], p[1], p[2], 255);
+            }
+        }
+        break;
+    case GRAY_ALPHA:
+        for (uint32_t x = 0; x < count; x++, target += step)
+        {
+            auto p = row + x * (wide ? 4 : 2);
+            *target = wide ? gray(p[0], p[2]) : gray(p[0], p[1]);
+        }
+        break;
+    case GRAY:
+        for (uint32_t x = 0; x < count; x++, target += step)
+        {
+            auto value = wide ? be16(row + x * 2) : sample(row, x, _bitDepth);
+            if (static_cast<int32_t>(value) == _transparent[0])
+                *target = 0;
+            else
+                *target = gray(wide ? value >> 8 : value * 255 / ((1u << _bitDepth) - 1), 255);
+        }
+        break;
+    case INDEXED:
+        for (uint32_t x = 0; x < count; x++, target += step)
+            *target = _colors[sample(row, x, _bitDepth)];
+        break;
+    default:
+        break;
+    }
+}
+
+void ApngImage::compose(const Record& record)
+{
+    auto& frame = record.frame;
+    auto span = clip(frame, _info);
+    auto source = _pixels.data();
+    auto level = Simd::Best();
+    for (auto at = span.begin; at < span.end; at += _info.width, source += frame.width)
+    {
+        if (frame.blend == BLEND_SOURCE)
+            std::copy_n(source, span.width, _canvas.data() + at);
+        else
+            BlendOver(_canvas.data() + at, source, span.width, level);
+    }
+}
+
+void ApngImage::snapshot(Slot& slot, uint32_t index)
+{
+    // Rendering is deterministic, so a slot that holds another frame differs from the canvas only inside the
+    // rectangles of the frames from that one to this one. Only those are copied, unless they add up to more than
+    // the canvas; in a screen recording they are a tiny part of it.
+    auto pixels = static_cast<size_t>(_info.width) * _info.height;
+    if (slot.index < _info.frameCount && slot.pixels.size() == pixels)
+    {
+        auto first = std::min(slot.index, index);
+        auto last = std::max(slot.index, index);
+        uint64_t area = 0;
+        for (auto i = first; i <= last && area < pixels; i++)
+        {
+            auto span = clip(_records[i].frame, _info);
+            area += (span.end - span.begin + _info.width - 1) / _info.width * span.width;
+        }
+
+        if (area < pixels)
+        {
+            for (auto i = first; i <= last; i++)
+            {
+                auto span = clip(_records[i].frame, _info);
+                for (auto at = span.begin; at < span.end; at += _info.width)
+                    std::copy_n(_canvas.data() + at, span.width, slot.pixels.data() + at);
+            }
+            slot.index = index;
+            return;
+        }
+    }
+
+    slot.pixels.assign(_canvas.begin(), _canvas.end());
+    slot.index = index;
+}
@@ -0,0 +1,139 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+#include "Simd.h"
+
+#include <cstdint>
+#include <vector>
+
+// Animated PNG player over the mapped file, built like GifImage. Opening it walks the chunks once
+// to index each frame's control chunk and where its IDAT or fdAT data is, without inflating any of
+// it. Frames are then inflated, unfiltered and composed one at a time on a single canvas as they
+// are asked for; only the frame's own rectangle of the canvas is touched, and blending it over
+// what is there is vectorized. Memory depends on the canvas size only, never on the number of
+// frames.
+class ApngImage
+{
+public:
+    static constexpr uint32_t RING_SIZE = 3;
+
+    enum Disposal : uint32_t
+    {
+        DISPOSE_NONE = 0,
+        DISPOSE_BACKGROUND = 1, // cleared to transparent
+        DISPOSE_PREVIOUS = 2,
+    };
+
+    enum Blend : uint32_t
+    {
+        BLEND_SOURCE = 0,
+        BLEND_OVER = 1,
+    };
+
+    // Must match NativeApngInfo in QuickLook.Plugin/QuickLook.Plugin.ImageViewer/AnimatedImage/Providers/NativeApng.cs
+    struct Info
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t frameCount;
+        uint32_t loopCount; // 0 loops forever
+        uint32_t pixelsPerMeterX; // from pHYs, 0 when the file does not say
+        uint32_t pixelsPerMeterY;
+    };
+
+    // Must match NativeApngFrame in QuickLook.Plugin/QuickLook.Plugin.ImageViewer/AnimatedImage/Providers/NativeApng.cs
+    struct Frame
+    {
+        uint32_t left;
+        uint32_t top;
+        uint32_t width;
+        uint32_t height;
+        uint32_t delay; // in milliseconds
+        uint32_t disposal;
+        uint32_t blend;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // The buffer is not copied and must outlive this object. A PNG that is not animated is refused unless
+    // acceptStill is set, in which case its image is the one frame.
+    bool Parse(const uint8_t* data, uint64_t size, bool acceptStill = false);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    bool GetFrame(uint32_t index, Frame* frame) const;
+
+    // Composes frame index and returns its premultiplied BGRA pixels, width * 4 bytes a row. They stay
+    // valid until RING_SIZE - 1 other frames have been rendered. Going forward by one frame decodes
+    // just that frame; going back starts over from the first one.
+    const uint8_t* Render(uint32_t index);
+
+    // Blends count premultiplied BGRA pixels of source over target.
+    static void BlendOver(uint32_t* target, const uint32_t* source, uint32_t count, Simd::Level level);
+
+private:
+    struct Record
+    {
+        Frame frame;
+        uint32_t firstChunk; // into _chunks
+        uint32_t chunkCount;
+    };
+
+    struct Chunk
+    {
+        uint64_t offset; // of the compressed data, past the sequence number of an fdAT
+        uint32_t size;
+    };
+
+    struct Slot
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t age = 0;
+        std::vector<uint32_t> pixels;
+    };
+
+    bool decode(const Record& record);
+    void convertRow(const uint8_t* row, uint32_t count, uint32_t* target, uint32_t step) const;
+    void compose(const Record& record);
+    void snapshot(Slot& slot, uint32_t index);
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    uint8_t _bitDepth = 0;
+    uint8_t _colorType = 0;
+    bool _interlaced = false;
+    uint32_t _colors[256] = {}; // PLTE with tRNS applied, premultiplied BGRA
+    int32_t _transparent[3] = {-1, -1, -1}; // tRNS sample values for gray or RGB images
+    std::vector<Record> _records;
+    std::vector<Chunk> _chunks;
+
+    std::vector<uint32_t> _canvas;
+    std::vector<uint32_t> _saved; // the canvas under a frame that is disposed of by restoring it
+    std::vector<uint32_t> _pixels; // of the frame being drawn
+    std::vector<uint8_t> _compressed; // its data chunks, joined
+    std::vector<uint8_t> _filtered; // its scanlines, each with its filter type byte
+    uint32_t _next = 0; // the frame the canvas is ready for
+    Slot _ring[RING_SIZE];
+    uint32_t _clock = 0;
+};
@@ -0,0 +1,359 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CompoundFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t SIGNATURE[] = {0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+    constexpr uint32_t HEADER_SIZE = 512;
+    constexpr uint32_t HEADER_DIFAT_ENTRIES = 109;
+    constexpr uint32_t ENTRY_SIZE = 128;
+    constexpr uint32_t MINI_SHIFT = 6;
+    constexpr uint32_t MINI_STREAM_CUTOFF = 4096;
+    constexpr uint32_t MAX_REGULAR_SECTOR = 0xFFFFFFFA;
+    constexpr uint32_t END_OF_CHAIN = 0xFFFFFFFE;
+    constexpr uint32_t NO_STREAM = 0xFFFFFFFF;
+    // keeps merged runs well inside what a caller can address with a 32-bit length
+    constexpr uint32_t MAX_SEGMENT = 1u << 30;
+
+    constexpr uint32_t TYPE_STORAGE = 1;
+    constexpr uint32_t TYPE_STREAM = 2;
+    constexpr uint32_t TYPE_ROOT = 5;
+
+    constexpr uint32_t CURSOR_STARTED = 1;
+    constexpr uint32_t CURSOR_DONE = 2;
+}
+
+bool CompoundFile::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool CompoundFile::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _fat.clear();
+    _directory.clear();
+    _miniLoaded = false;
+    _miniFat.clear();
+    _miniStream.clear();
+    _claimed.clear();
+    _children.clear();
+
+    if (!has(0, HEADER_SIZE) || memcmp(_data, SIGNATURE, sizeof(SIGNATURE)) != 0 || u16(0x1C) != 0xFFFE)
+        return false;
+
+    // version 3 uses 512-byte sectors, version 4 uses 4096-byte sectors; the header fills the first one
+    _info.majorVersion = u16(0x1A);
+    _shift = u16(0x1E);
+    if (!(_info.majorVersion == 3 && _shift == 9) && !(_info.majorVersion == 4 && _shift == 12))
+        return false;
+    if (u16(0x20) != MINI_SHIFT)
+        return false;
+
+    _info.sectorSize = 1u << _shift;
+    _info.miniStreamCutoff = u32(0x38);
+    if (_info.miniStreamCutoff != MINI_STREAM_CUTOFF)
+        return false;
+
+    auto sectors = (_size + _info.sectorSize - 1) >> _shift;
+    if (sectors < 2)
+        return false;
+    _sectorCount = static_cast<uint32_t>(std::min<uint64_t>(sectors - 1, MAX_REGULAR_SECTOR + 1ull));
+
+    // the FAT sectors are listed in the header and then in the DIFAT chain
+    auto fatSectors = std::min(u32(0x2C), _sectorCount);
+    _fat.reserve(fatSectors);
+    for (uint32_t i = 0; i < HEADER_DIFAT_ENTRIES && _fat.size() < fatSectors; i++)
+        _fat.push_back(u32(0x4C + i * 4));
+
+    auto perDifat = _info.sectorSize / 4 - 1;
+    auto difat = u32(0x44);
+    for (uint32_t i = 0; i < _sectorCount && _fat.size() < fatSectors && difat < _sectorCount; i++)
+    {
+        auto offset = sectorOffset(difat);
+        if (!has(offset, _info.sectorSize))
+            break;
+
+        for (uint32_t j = 0; j < perDifat && _fat.size() < fatSectors; j++)
+            _fat.push_back(u32(offset + j * 4));
+        difat = u32(offset + perDifat * 4);
+    }
+    _info.fatSectors = static_cast<uint32_t>(_fat.size());
+
+    chain(u32(0x30), _sectorCount, &_directory);
+    _info.entryCount = static_cast<uint32_t>(std::min<uint64_t>(
+        static_cast<uint64_t>(_directory.size()) << (_shift - 7), UINT32_MAX));
+    _miniFatStart = u32(0x3C);
+    _info.miniFatSectors = u32(0x40);
+
+    auto root = entryOffset(ROOT);
+    return root != 0 && _data[root + 66] == TYPE_ROOT;
+}
+
+bool CompoundFile::GetEntry(uint32_t id, Entry* entry) const
+{
+    auto offset = entryOffset(id);
+    if (offset == 0)
+        return false;
+
+    // the stored length is in bytes and counts the terminator
+    uint32_t nameBytes = std::min<uint16_t>(u16(offset + 64), 64);
+
+    *entry = {};
+    entry->name = _data + offset;
+    entry->nameLength = nameBytes >= 2 ? nameBytes / 2 - 1 : 0;
+    entry->type = _data[offset + 66];
+    entry->creationTime = u64(offset + 100);
+    entry->modifiedTime = u64(offset + 108);
+    if (entry->type == TYPE_STREAM || entry->type == TYPE_ROOT)
+        entry->size = streamSize(offset);
+    return true;
+}
+
+uint32_t CompoundFile::ReadChildren(uint32_t storage, uint32_t start, uint32_t* ids, uint32_t count)
+{
+    auto offset = entryOffset(storage);
+    if (offset == 0 || (_data[offset + 66] != TYPE_STORAGE && _data[offset + 66] != TYPE_ROOT))
+        return 0;
+
+    auto& list = children(storage);
+    if (start >= list.size())
+        return 0;
+
+    auto filled = static_cast<uint32_t>(std::min<size_t>(count, list.size() - start));
+    std::copy_n(list.begin() + start, filled, ids);
+    return filled;
+}
+
+uint32_t CompoundFile::ReadSegments(uint32_t id, SegmentCursor* cursor, Segment* segments, uint32_t count)
+{
+    if (cursor->state == CURSOR_DONE)
+        return 0;
+
+    auto offset = entryOffset(id);
+    if (offset == 0 || _data[offset + 66] != TYPE_STREAM)
+    {
+        cursor->state = CURSOR_DONE;
+        return 0;
+    }
+
+    auto size = streamSize(offset);
+    auto mini = size < _info.miniStreamCutoff;
+    // a stream that claims more sectors than the file has cannot be walked to its end
+    if (!mini && size > static_cast<uint64_t>(_sectorCount) << _shift)
+    {
+        cursor->state = CURSOR_DONE;
+        return 0;
+    }
+
+    if (cursor->state == 0)
+    {
+        cursor->position = 0;
+        cursor->sector = u32(offset + 116);
+        cursor->state = CURSOR_STARTED;
+    }
+
+    uint32_t filled = 0;
+    while (cursor->position < size)
+    {
+        const uint8_t* data;
+        uint32_t length;
+        if (!sectorData(mini, cursor->sector, size - cursor->position, &data, &length))
+        {
+            cursor->state = CURSOR_DONE;
+            break;
+        }
+
+        auto last = filled != 0 ? &segments[filled - 1] : nullptr;
+        if (last != nullptr && last->data + last->length == data && last->length <= MAX_SEGMENT - length)
+        {
+            last->length += length;
+        }
+        else
+        {
+            if (filled == count)
+                break;
+            segments[filled++] = {data, length};
+        }
+
+        cursor->position += length;
+        cursor->sector = mini ? nextMini(cursor->sector) : next(cursor->sector);
+    }
+
+    if (cursor->position >= size)
+        cursor->state = CURSOR_DONE;
+    return filled;
+}
+
+bool CompoundFile::has(uint64_t offset, uint64_t size) const
+{
+    return _data != nullptr && offset <= _size && size <= _size - offset;
+}
+
+uint16_t CompoundFile::u16(uint64_t offset) const
+{
+    return static_cast<uint16_t>(_data[offset] | _data[offset + 1] << 8);
+}
+
+uint32_t CompoundFile::u32(uint64_t offset) const
+{
+    return static_cast<uint32_t>(_data[offset]) | static_cast<uint32_t>(_data[offset + 1]) << 8 |
+           static_cast<uint32_t>(_data[offset + 2]) << 16 | static_cast<uint32_t>(_data[offset + 3]) << 24;
+}
+
+uint64_t CompoundFile::u64(uint64_t offset) const
+{
+    return u32(offset) | static_cast<uint64_t>(u32(offset + 4)) << 32;
+}
+
+uint64_t CompoundFile::sectorOffset(uint32_t sector) const
+{
+    return (static_cast<uint64_t>(sector) + 1) << _shift;
+}
+
+uint64_t CompoundFile::entryOffset(uint32_t id) const
+{
+    // returns 0 for ids outside the directory, which can never be an entry
+    auto perSector = _info.sectorSize / ENTRY_SIZE;
+    if (id / perSector >= _directory.size())
+        return 0;
+
+    auto offset = sectorOffset(_directory[id / perSector]) + static_cast<uint64_t>(id % perSector) * ENTRY_SIZE;
+    return has(offset, ENTRY_SIZE) ? offset : 0;
+}
+
+uint64_t CompoundFile::streamSize(uint64_t entry) const
+{
+    // version 3 writers may leave garbage in the high half
+    return _info.majorVersion == 3 ? u32(entry + 120) : u64(entry + 120);
+}
+
+uint32_t CompoundFile::next(uint32_t sector) const
+{
+    auto perSector = _info.sectorSize / 4;
+    if (sector >= _sectorCount || sector / perSector >= _fat.size())
+        return END_OF_CHAIN;
+
+    auto fat = _fat[sector / perSector];
+    if (fat >= _sectorCount)
+        return END_OF_CHAIN;
+
+    auto offset = sectorOffset(fat) + static_cast<uint64_t>(sector % perSector) * 4;
+    return has(offset, 4) ? u32(offset) : END_OF_CHAIN;
+}
+
+uint32_t CompoundFile::nextMini(uint32_t sector) const
+{
+    auto perSector = _info.sectorSize / 4;
+    if (sector / perSector >= _miniFat.size())
+        return END_OF_CHAIN;
+
+    auto offset = sectorOffset(_miniFat[sector / perSector]) + static_cast<uint64_t>(sector % perSector) * 4;
+    return has(offset, 4) ? u32(offset) : END_OF_CHAIN;
+}
+
+void CompoundFile::chain(uint32_t start, uint64_t limit, std::vector<uint32_t>* sectors) const
+{
+    // a chain longer than the file has sectors must contain a loop
+    limit = std::min<uint64_t>(limit, _sectorCount);
+    for (auto sector = start; sector < _sectorCount && sectors->size() < limit; sector = next(sector))
+        sectors->push_back(sector);
+}
+
+bool CompoundFile::sectorData(bool mini, uint32_t sector, uint64_t remaining, const uint8_t** data,
+                              uint32_t* length)
+{
+    if (!mini)
+    {
+        if (sector >= _sectorCount)
+            return false;
+
+        auto offset = sectorOffset(sector);
+        *length = static_cast<uint32_t>(std::min<uint64_t>(remaining, _info.sectorSize));
+        *data = _data + offset;
+        return has(offset, *length);
+    }
+
+    // small streams live in 64-byte sectors inside the stream of the root entry
+    if (!_miniLoaded)
+    {
+        auto root = entryOffset(ROOT);
+        auto rootSize = streamSize(root);
+        chain(u32(root + 116), (rootSize + _info.sectorSize - 1) >> _shift, &_miniStream);
+        chain(_miniFatStart, _sectorCount, &_miniFat);
+        _miniLoaded = true;
+    }
+
+    auto position = static_cast<uint64_t>(sector) << MINI_SHIFT;
+    auto index = position >> _shift;
+    if (sector > MAX_REGULAR_SECTOR || index >= _miniStream.size())
+        return false;
+
+    auto offset = sectorOffset(_miniStream[index]) + (position & (_info.sectorSize - 1));
+    *length = static_cast<uint32_t>(std::min<uint64_t>(remaining, 1u << MINI_SHIFT));
+    *data = _data + offset;
+    return has(offset, *length);
+}
+
+const std::vector<uint32_t>& CompoundFile::children(uint32_t storage)
+{
+    auto found = _children.find(storage);
+    if (found != _children.end())
+        return found->second;
+
+    if (_claimed.empty())
+    {
+        _claimed.resize(_info.entryCount);
+        _claimed[ROOT] = true;
+    }
+
+    // in-order walk of the red-black tree of siblings; an entry is entered at most once per file
+    auto& list = _children[storage];
+    std::vector<uint32_t> stack;
+    auto id = u32(entryOffset(storage) + 76);
+    while (true)
+    {
+        for (; id != NO_STREAM && id < _claimed.size() && !_claimed[id]; id = u32(entryOffset(id) + 68))
+        {
+            if (entryOffset(id) == 0)
+                break;
+
+            _claimed[id] = true;
+            stack.push_back(id);
+        }
+
+        if (stack.empty())
+            break;
+
+        id = stack.back();
+        stack.pop_back();
+
+        auto offset = entryOffset(id);
+        if (_data[offset + 66] == TYPE_STORAGE || _data[offset + 66] == TYPE_STREAM)
+            list.push_back(id);
+        id = u32(offset + 72);
+    }
+
+    return list;
+}
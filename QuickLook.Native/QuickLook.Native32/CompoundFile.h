@@ -0,0 +1,122 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// COM-free reader for Compound File Binary containers (Thumbs.db, .msi, .doc, .xls, .eif, ...).
+// The file is mapped and opening it only collects the FAT and directory sector lists; the children
+// of a storage are gathered when first asked for, and streams are handed out as runs of bytes
+// inside the mapping while their FAT or mini FAT chain is followed, so nothing gets copied.
+//
+// Every entry is claimed by the first storage whose red-black tree reaches it, which keeps the
+// tree free of cycles even when the sibling pointers of a corrupt file are not.
+class CompoundFile
+{
+public:
+    static constexpr uint32_t ROOT = 0;
+
+    struct Info
+    {
+        uint32_t majorVersion;
+        uint32_t sectorSize;
+        uint32_t miniStreamCutoff;
+        uint32_t entryCount; // directory slots, including unused ones
+        uint32_t fatSectors;
+        uint32_t miniFatSectors;
+    };
+
+    // Must match CfbEntry in QuickLook.Plugin.ArchiveViewer/CompoundFileBinary/NativeCompoundFile.cs
+    struct Entry
+    {
+        const uint8_t* name;
+        uint32_t nameLength; // in UTF-16 code units
+        uint32_t type;       // 1: storage, 2: stream, 5: root storage
+        uint64_t size;       // streams only
+        uint64_t creationTime; // FILETIME, storages only
+        uint64_t modifiedTime;
+    };
+
+    struct Segment
+    {
+        const uint8_t* data;
+        uint32_t length;
+    };
+
+    // Position inside a stream; start from all zeroes.
+    struct SegmentCursor
+    {
+        uint64_t position;
+        uint32_t sector;
+        uint32_t state;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    bool GetEntry(uint32_t id, Entry* entry) const;
+
+    // Fills up to count entry ids of the children of a storage, in directory order, and returns
+    // how many it filled; 0 means the end.
+    uint32_t ReadChildren(uint32_t storage, uint32_t start, uint32_t* ids, uint32_t count);
+
+    // Fills up to count runs of stream data and returns how many it filled; 0 means the end.
+    // Adjacent sectors are merged into one run. A broken chain ends the stream early.
+    uint32_t ReadSegments(uint32_t id, SegmentCursor* cursor, Segment* segments, uint32_t count);
+
+private:
+    bool has(uint64_t offset, uint64_t size) const;
+    uint16_t u16(uint64_t offset) const;
+    uint32_t u32(uint64_t offset) const;
+    uint64_t u64(uint64_t offset) const;
+
+    uint64_t sectorOffset(uint32_t sector) const;
+    uint64_t entryOffset(uint32_t id) const;
+    uint64_t streamSize(uint64_t entry) const;
+    uint32_t next(uint32_t sector) const;
+    uint32_t nextMini(uint32_t sector) const;
+    void chain(uint32_t start, uint64_t limit, std::vector<uint32_t>* sectors) const;
+    bool sectorData(bool mini, uint32_t sector, uint64_t remaining, const uint8_t** data, uint32_t* length);
+    const std::vector<uint32_t>& children(uint32_t storage);
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    uint32_t _shift = 0;
+    uint32_t _sectorCount = 0;
+    uint32_t _miniFatStart = 0;
+    std::vector<uint32_t> _fat;       // sectors holding the FAT
+    std::vector<uint32_t> _directory; // sectors holding the directory
+    // built on first use
+    bool _miniLoaded = false;
+    std::vector<uint32_t> _miniFat;    // sectors holding the mini FAT
+    std::vector<uint32_t> _miniStream; // sectors holding the mini stream
+    std::vector<bool> _claimed;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> _children;
+};
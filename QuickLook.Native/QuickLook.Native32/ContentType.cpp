@@ -0,0 +1,892 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ContentType.h"
+
+#include "MappedWindow.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+    // how far into the file a PDF header may be, as Acrobat accepts it
+    constexpr size_t PDF_SEARCH = 1024;
+    constexpr char PDF_HEADER[] = "%PDF-";
+    // how far into an EBML header the document type is looked for
+    constexpr size_t EBML_SEARCH = 64;
+    constexpr uint32_t ZIP_LOCAL = 0x04034B50;
+    constexpr uint32_t ZIP_CENTRAL = 0x02014B50;
+    constexpr uint32_t ZIP_END = 0x06054B50;
+    constexpr size_t ZIP_LOCAL_SIZE = 30;
+    constexpr size_t ZIP_CENTRAL_SIZE = 46;
+    constexpr size_t ZIP_END_SIZE = 22;
+    constexpr size_t CFB_ENTRY_SIZE = 128;
+
+    typedef ContentType::Type Type;
+
+    // The bytes at both ends of the file. Offsets are file offsets; the middle is not there.
+    struct Probe
+    {
+        const uint8_t* head;
+        size_t headLength;
+        const uint8_t* tail;
+        size_t tailLength;
+        uint64_t size;
+
+        bool has(size_t offset, size_t length) const
+        {
+            return offset <= headLength && length <= headLength - offset;
+        }
+
+        bool equals(size_t offset, const char* bytes, size_t length) const
+        {
+            return has(offset, length) && memcmp(head + offset, bytes, length) == 0;
+        }
+
+        // length bytes at offset from whichever end has them, or nullptr
+        const uint8_t* at(uint64_t offset, size_t length) const
+        {
+            if (offset <= headLength && length <= headLength - offset)
+                return head + offset;
+
+            auto tailStart = size - tailLength;
+            if (offset >= tailStart && offset <= size && length <= size - offset)
+                return tail + (offset - tailStart);
+            return nullptr;
+        }
+
+        uint16_t le16(size_t offset) const
+        {
+            return static_cast<uint16_t>(head[offset] | head[offset + 1] << 8);
+        }
+
+        uint32_t le32(size_t offset) const
+        {
+            return static_cast<uint32_t>(le16(offset) | static_cast<uint32_t>(le16(offset + 2)) << 16);
+        }
+
+        uint16_t be16(size_t offset) const
+        {
+            return static_cast<uint16_t>(head[offset] << 8 | head[offset + 1]);
+        }
+
+        uint32_t be32(size_t offset) const
+        {
+            return static_cast<uint32_t>(be16(offset)) << 16 | be16(offset + 2);
+        }
+    };
+
+    inline uint16_t le16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | p[1] << 8);
+    }
+
+    inline uint32_t le32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(le16(p) | static_cast<uint32_t>(le16(p + 2)) << 16);
+    }
+
+    class Guesses
+    {
+    public:
+        void add(Type type, uint32_t confidence)
+        {
+            for (uint32_t i = 0; i < _count; i++)
+            {
+                if (_items[i].type == type)
+                {
+                    _items[i].confidence = std::max(_items[i].confidence, confidence);
+                    return;
+                }
+            }
+            if (_count < ContentType::MAX_GUESSES)
+                _items[_count++] = {type, confidence};
+        }
+
+        uint32_t store(ContentType::Guess* guesses, uint32_t capacity)
+        {
+            std::stable_sort(_items.begin(), _items.begin() + _count,
+                             [](const ContentType::Guess& a, const ContentType::Guess& b) {
+                                 return a.confidence > b.confidence;
+                             });
+            std::copy_n(_items.begin(), std::min(_count, capacity), guesses);
+            return _count;
+        }
+
+    private:
+        std::array<ContentType::Guess, ContentType::MAX_GUESSES> _items{};
+        uint32_t _count = 0;
+    };
+
+    // Looks closer at a match, adding guesses of its own. Returns whether the guess of the magic
+    // itself stands.
+    typedef bool (*Refine)(const Probe& probe, Guesses& guesses);
+
+    struct Magic
+    {
+        uint32_t offset; // from the start, or from the end for TAIL_MAGIC
+        const char* bytes;
+        uint32_t length;
+        Type type;
+        uint32_t confidence;
+        Refine refine;
+    };
+
+    template <size_t N>
+    constexpr Magic magic(uint32_t offset, const char (&bytes)[N], Type type, uint32_t confidence,
+                          Refine refine = nullptr)
+    {
+        return {offset, bytes, static_cast<uint32_t>(N - 1), type, confidence, refine};
+    }
+
+    // zip ----------------------------------------------------------------------------------------
+
+    enum NameMatch
+    {
+        EXACT,
+        PREFIX,
+        SUFFIX_AT_ROOT,
+    };
+
+    struct ZipEntry
+    {
+        const char* name;
+        NameMatch match;
+        Type type;
+        uint32_t confidence;
+    };
+
+    constexpr ZipEntry ZIP_ENTRIES[] = {
+        {"word/", PREFIX, ContentType::DOCX, 95},
+        {"xl/", PREFIX, ContentType::XLSX, 95},
+        {"ppt/", PREFIX, ContentType::PPTX, 95},
+        {"visio/", PREFIX, ContentType::VSDX, 95},
+        {"AndroidManifest.xml", EXACT, ContentType::APK, 95},
+        {"META-INF/MANIFEST.MF", EXACT, ContentType::JAR, 85},
+        {"Payload/", PREFIX, ContentType::IPA, 90},
+        {"AppxManifest.xml", EXACT, ContentType::APPX, 95},
+        {"AppxMetadata/AppxBundleManifest.xml", EXACT, ContentType::APPX_BUNDLE, 95},
+        {"extension.vsixmanifest", EXACT, ContentType::VSIX, 95},
+        {".nuspec", SUFFIX_AT_ROOT, ContentType::NUPKG, 95},
+        {"FixedDocumentSequence.fdseq", EXACT, ContentType::XPS, 95},
+        {"FixedDocSeq.fdseq", EXACT, ContentType::XPS, 95},
+        {"doc.kml", EXACT, ContentType::KMZ, 90},
+        {"3D/3dmodel.model", EXACT, ContentType::MODEL_3MF, 95},
+    };
+
+    // what the stored "mimetype" entry at the start of OpenDocument and EPUB files says
+    struct ZipMimeType
+    {
+        const char* mimeType;
+        Type type;
+    };
+
+    constexpr ZipMimeType ZIP_MIME_TYPES[] = {
+        {"application/vnd.oasis.opendocument.text", ContentType::ODT},
+        {"application/vnd.oasis.opendocument.spreadsheet", ContentType::ODS},
+        {"application/vnd.oasis.opendocument.presentation", ContentType::ODP},
+        {"application/vnd.oasis.opendocument.graphics", ContentType::ODG},
+        {"application/epub+zip", ContentType::EPUB},
+    };
+
+    bool nameIs(const uint8_t* name, size_t length, const char* text)
+    {
+        return strlen(text) == length && memcmp(name, text, length) == 0;
+    }
+
+    void matchZipEntry(const uint8_t* name, size_t length, Guesses& guesses)
+    {
+        for (auto& entry : ZIP_ENTRIES)
+        {
+            auto entryLength = strlen(entry.name);
+            auto matches = false;
+            switch (entry.match)
+            {
+            case EXACT:
+                matches = entryLength == length && memcmp(name, entry.name, length) == 0;
+                break;
+            case PREFIX:
+                matches = entryLength <= length && memcmp(name, entry.name, entryLength) == 0;
+                break;
+            case SUFFIX_AT_ROOT:
+                matches = entryLength < length && memcmp(name + length - entryLength, entry.name, entryLength) == 0 &&
+                          memchr(name, '/', length) == nullptr;
+                break;
+            }
+            if (matches)
+                guesses.add(entry.type, entry.confidence);
+        }
+    }
+
+    // the local headers at the start, as far as their sizes are known
+    void walkZipHead(const Probe& probe, Guesses& guesses)
+    {
+        uint64_t offset = 0;
+        while (probe.has(static_cast<size_t>(offset), ZIP_LOCAL_SIZE) && probe.le32(static_cast<size_t>(offset)) == ZIP_LOCAL)
+        {
+            auto at = static_cast<size_t>(offset);
+            auto flags = probe.le16(at + 6);
+            auto method = probe.le16(at + 8);
+            auto compressed = probe.le32(at + 18);
+            size_t nameLength = probe.le16(at + 26);
+            size_t extraLength = probe.le16(at + 28);
+            if (!probe.has(at + ZIP_LOCAL_SIZE, nameLength))
+                return;
+
+            auto name = probe.head + at + ZIP_LOCAL_SIZE;
+            matchZipEntry(name, nameLength, guesses);
+
+            auto data = at + ZIP_LOCAL_SIZE + nameLength + extraLength;
+            if (offset == 0 && method == 0 && nameIs(name, nameLength, "mimetype") && probe.has(data, compressed))
+            {
+                for (auto& mimeType : ZIP_MIME_TYPES)
+                {
+                    if (nameIs(probe.head + data, compressed, mimeType.mimeType))
+                        guesses.add(mimeType.type, 98);
+                }
+            }
+
+            // the sizes come after the data
+            if ((flags & 0x8) != 0)
+                return;
+            offset = static_cast<uint64_t>(data) + compressed;
+        }
+    }
+
+    // the central directory, as far as it is in the tail
+    void walkZipTail(const Probe& probe, Guesses& guesses)
+    {
+        if (probe.tailLength < ZIP_END_SIZE)
+            return;
+
+        auto tail = probe.tail;
+        auto end = probe.tailLength - ZIP_END_SIZE + 1;
+        while (end > 0 && le32(tail + end - 1) != ZIP_END)
+            end--;
+        if (end == 0)
+            return;
+        end--;
+
+        // from the start of the directory if the tail has it, otherwise from the first entry in the tail
+        size_t offset = 0;
+        auto tailStart = probe.size - probe.tailLength;
+        auto directory = static_cast<uint64_t>(le32(tail + end + 16));
+        if (directory >= tailStart && directory < tailStart + end)
+            offset = static_cast<size_t>(directory - tailStart);
+        while (offset + 4 <= end && le32(tail + offset) != ZIP_CENTRAL)
+            offset++;
+
+        while (offset + ZIP_CENTRAL_SIZE <= end && le32(tail + offset) == ZIP_CENTRAL)
+        {
+            size_t nameLength = le16(tail + offset + 28);
+            size_t extraLength = le16(tail + offset + 30);
+            size_t commentLength = le16(tail + offset + 32);
+            if (nameLength > end - offset - ZIP_CENTRAL_SIZE)
+                return;
+
+            matchZipEntry(tail + offset + ZIP_CENTRAL_SIZE, nameLength, guesses);
+            offset += ZIP_CENTRAL_SIZE + nameLength + extraLength + commentLength;
+        }
+    }
+
+    bool refineZip(const Probe& probe, Guesses& guesses)
+    {
+        walkZipHead(probe, guesses);
+        walkZipTail(probe, guesses);
+        return true;
+    }
+
+    // compound files -----------------------------------------------------------------------------
+
+    struct CfbClass
+    {
+        uint8_t clsid[16]; // as stored, the first three fields little-endian
+        Type type;
+    };
+
+    constexpr CfbClass CFB_CLASSES[] = {
+        {{0x84, 0x10, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::MSI},
+        {{0x86, 0x10, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::MSI}, // patch
+        {{0x82, 0x10, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::MSI}, // transform
+        {{0x06, 0x09, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::DOC},
+        {{0x20, 0x08, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::XLS},
+        {{0x10, 0x08, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::XLS}, // Excel 5
+        {{0x10, 0x8D, 0x81, 0x64, 0x9B, 0x4F, 0xCF, 0x11, 0x86, 0xEA, 0x00, 0xAA, 0x00, 0xB9, 0x29, 0xE8},
+         ContentType::PPT},
+        {{0x14, 0x1A, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::VSD},
+        {{0x0B, 0x0D, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46},
+         ContentType::MSG},
+    };
+
+    struct CfbStream
+    {
+        const char* name;
+        Type type;
+    };
+
+    constexpr CfbStream CFB_STREAMS[] = {
+        {"WordDocument", ContentType::DOC},
+        {"Workbook", ContentType::XLS},
+        {"Book", ContentType::XLS},
+        {"PowerPoint Document", ContentType::PPT},
+        {"VisioDocument", ContentType::VSD},
+        {"__properties_version1.0", ContentType::MSG},
+        {"__nameid_version1.0", ContentType::MSG},
+        {"Catalog", ContentType::THUMBS_DB},
+    };
+
+    bool entryNameIs(const uint8_t* entry, const char* name)
+    {
+        // the length in bytes counts the terminating null
+        size_t length = strlen(name);
+        if (le16(entry + 0x40) != (length + 1) * 2)
+            return false;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            if (le16(entry + i * 2) != static_cast<uint8_t>(name[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // the root entry and its neighbours in the first directory sector
+    bool refineCfb(const Probe& probe, Guesses& guesses)
+    {
+        if (!probe.has(0, 0x34))
+            return true;
+
+        auto shift = probe.le16(0x1E);
+        if (shift != 9 && shift != 12)
+            return true;
+
+        size_t sectorSize = size_t(1) << shift;
+        auto offset = (static_cast<uint64_t>(probe.le32(0x30)) + 1) << shift;
+        auto sector = probe.at(offset, sectorSize);
+        auto entries = sectorSize / CFB_ENTRY_SIZE;
+        if (sector == nullptr)
+        {
+            sector = probe.at(offset, CFB_ENTRY_SIZE);
+            entries = 1;
+        }
+        if (sector == nullptr)
+            return true;
+
+        for (auto& cfbClass : CFB_CLASSES)
+        {
+            if (memcmp(sector + 0x50, cfbClass.clsid, sizeof(cfbClass.clsid)) == 0)
+                guesses.add(cfbClass.type, 95);
+        }
+        for (size_t i = 1; i < entries; i++)
+        {
+            for (auto& stream : CFB_STREAMS)
+            {
+                if (entryNameIs(sector + i * CFB_ENTRY_SIZE, stream.name))
+                    guesses.add(stream.type, 90);
+            }
+        }
+        return true;
+    }
+
+    // executables --------------------------------------------------------------------------------
+
+    bool refineMz(const Probe& probe, Guesses& guesses)
+    {
+        if (!probe.has(0x3C, 4))
+            return true;
+
+        size_t header = probe.le32(0x3C);
+        if (header < 0x40 || !probe.equals(header, "PE\0\0", 4))
+            return true;
+
+        guesses.add(ContentType::PE, 95);
+        return false;
+    }
+
+    bool refineElf(const Probe& probe, Guesses& guesses)
+    {
+        if (!probe.has(0, 18))
+            return true;
+
+        auto type = probe.head[5] == 2 ? probe.be16(16) : probe.le16(16);
+        switch (type)
+        {
+        case 1:
+            guesses.add(ContentType::ELF_OBJECT, 95);
+            return false;
+        case 2:
+            guesses.add(ContentType::ELF_EXECUTABLE, 95);
+            return false;
+        case 3:
+            guesses.add(ContentType::ELF_SHARED, 95);
+            return false;
+        case 4:
+            guesses.add(ContentType::ELF_CORE, 95);
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    // CA FE BA BE starts both fat Mach-O files and Java classes; the former count their
+    // architectures where the latter have their version
+    bool refineCafeBabe(const Probe& probe, Guesses& guesses)
+    {
+        if (!probe.has(0, 8))
+            return false;
+
+        auto architectures = probe.be32(4);
+        if (architectures != 0 && architectures < 32)
+            guesses.add(ContentType::MACHO, 85);
+        else if (probe.be16(6) >= 45)
+            guesses.add(ContentType::JAVA_CLASS, 90);
+        return false;
+    }
+
+    // images -------------------------------------------------------------------------------------
+
+    // an animation control chunk before the first image data makes it APNG
+    bool refinePng(const Probe& probe, Guesses& guesses)
+    {
+        uint64_t offset = 8;
+        while (probe.has(static_cast<size_t>(offset), 8))
+        {
+            auto at = static_cast<size_t>(offset);
+            if (probe.equals(at + 4, "acTL", 4))
+                guesses.add(ContentType::APNG, 97);
+            if (probe.equals(at + 4, "IDAT", 4))
+                break;
+            offset += 12 + static_cast<uint64_t>(probe.be32(at));
+        }
+        return true;
+    }
+
+    bool refineBmp(const Probe& probe, Guesses&)
+    {
+        if (!probe.has(0, 28))
+            return false;
+
+        auto info = probe.le32(14);
+        return (info == 12 || info == 40 || info == 52 || info == 56 || info == 64 || info == 108 || info == 124) &&
+               probe.le16(info == 12 ? 22 : 26) == 1;
+    }
+
+    // icons and cursors have a directory of images after the six byte header
+    bool refineIcon(const Probe& probe, Guesses&)
+    {
+        if (!probe.has(0, 22))
+            return false;
+
+        auto count = probe.le16(4);
+        return count != 0 && probe.head[9] == 0 && probe.le32(14) != 0 && probe.le32(18) >= 6u + 16u * count;
+    }
+
+    bool refineRiff(const Probe& probe, Guesses& guesses)
+    {
+        if (probe.equals(8, "WEBP", 4))
+            guesses.add(ContentType::WEBP, 95);
+        else if (probe.equals(8, "WAVE", 4))
+            guesses.add(ContentType::WAV, 95);
+        else if (probe.equals(8, "AVI ", 4))
+            guesses.add(ContentType::AVI, 95);
+        else if (probe.equals(8, "ACON", 4))
+            guesses.add(ContentType::ANI, 95);
+        return false;
+    }
+
+    bool refineTiff(const Probe& probe, Guesses& guesses)
+    {
+        if (probe.equals(8, "CR\x02", 3))
+            guesses.add(ContentType::CR2, 95);
+        return true;
+    }
+
+    // ISO base media files name what they are in the brands of their first box
+    bool refineFtyp(const Probe& probe, Guesses& guesses)
+    {
+        if (!probe.has(0, 12))
+            return false;
+
+        auto end = std::min<size_t>(std::max<uint32_t>(probe.be32(0), 12), probe.headLength);
+        auto hasBrand = [&](const char* brand) {
+            for (size_t offset = 8; offset + 4 <= end; offset += offset == 8 ? 8 : 4)
+            {
+                if (memcmp(probe.head + offset, brand, 4) == 0)
+                    return true;
+            }
+            return false;
+        };
+
+        if (hasBrand("avif") || hasBrand("avis"))
+            guesses.add(ContentType::AVIF, 95);
+        else if (hasBrand("heic") || hasBrand("heix") || hasBrand("hevc") || hasBrand("hevx") || hasBrand("heim") ||
+                 hasBrand("heis"))
+            guesses.add(ContentType::HEIC, 95);
+        else if (hasBrand("mif1") || hasBrand("msf1"))
+            guesses.add(ContentType::HEIF, 90);
+        else if (probe.equals(8, "crx ", 4))
+            guesses.add(ContentType::CR3, 95);
+        else if (probe.equals(8, "qt  ", 4))
+            guesses.add(ContentType::QUICKTIME, 90);
+        else if (probe.equals(8, "M4A ", 4) || probe.equals(8, "M4B ", 4))
+            guesses.add(ContentType::M4A, 90);
+        else
+            guesses.add(ContentType::MP4, 80);
+        return false;
+    }
+
+    // everything else ----------------------------------------------------------------------------
+
+    bool refineEbml(const Probe& probe, Guesses& guesses)
+    {
+        auto end = std::min(probe.headLength, EBML_SEARCH);
+        auto contains = [&](const char* text, size_t length) {
+            return std::search(probe.head, probe.head + end, text, text + length) != probe.head + end;
+        };
+
+        if (contains("webm", 4))
+            guesses.add(ContentType::WEBM, 95);
+        else
+            guesses.add(ContentType::MKV, contains("matroska", 8) ? 95 : 70);
+        return false;
+    }
+
+    bool refineAr(const Probe& probe, Guesses& guesses)
+    {
+        if (probe.equals(8, "debian-binary", 13))
+            guesses.add(ContentType::DEB, 95);
+        return true;
+    }
+
+    bool refineMinidump(const Probe& probe, Guesses&)
+    {
+        return probe.has(0, 32);
+    }
+
+    bool refineTrueType(const Probe& probe, Guesses&)
+    {
+        if (!probe.has(0, 6))
+            return false;
+
+        auto tables = probe.be16(4);
+        return tables != 0 && tables <= 64;
+    }
+
+    const Magic HEAD_MAGIC[] = {
+        magic(0, "PK\x03\x04", ContentType::ZIP, 60, refineZip),
+        magic(0, "PK\x05\x06", ContentType::ZIP, 60),
+        magic(0, "\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1", ContentType::CFB, 70, refineCfb),
+        magic(0, "MZ", ContentType::DOS, 50, refineMz),
+        magic(0, "\x7F" "ELF", ContentType::ELF, 90, refineElf),
+        magic(0, "\xFE\xED\xFA\xCE", ContentType::MACHO, 90),
+        magic(0, "\xFE\xED\xFA\xCF", ContentType::MACHO, 90),
+        magic(0, "\xCE\xFA\xED\xFE", ContentType::MACHO, 90),
+        magic(0, "\xCF\xFA\xED\xFE", ContentType::MACHO, 90),
+        magic(0, "\xCA\xFE\xBA\xBE", ContentType::UNKNOWN, 0, refineCafeBabe),
+        magic(0, "dex\n", ContentType::DEX, 95),
+        magic(0, "\x27\x05\x19\x56", ContentType::UIMAGE, 90),
+        magic(0, "%PDF-", ContentType::PDF, 95),
+        magic(0, "%!PS", ContentType::POSTSCRIPT, 90),
+        magic(0, "{\\rtf", ContentType::RTF, 90),
+        magic(0, "\x89PNG\r\n\x1A\n", ContentType::PNG, 95, refinePng),
+        magic(0, "\xFF\xD8\xFF", ContentType::JPEG, 90),
+        magic(0, "GIF87a", ContentType::GIF, 95),
+        magic(0, "GIF89a", ContentType::GIF, 95),
+        magic(0, "BM", ContentType::BMP, 85, refineBmp),
+        magic(0, "RIFF", ContentType::UNKNOWN, 0, refineRiff),
+        magic(0, "II*\0", ContentType::TIFF, 85, refineTiff),
+        magic(0, "MM\0*", ContentType::TIFF, 85),
+        magic(0, "II+\0", ContentType::TIFF, 85),
+        magic(0, "MM\0+", ContentType::TIFF, 85),
+        magic(0, "\0\0\x01\0", ContentType::ICO, 80, refineIcon),
+        magic(0, "\0\0\x02\0", ContentType::CUR, 80, refineIcon),
+        magic(0, "8BPS", ContentType::PSD, 90),
+        magic(0, "qoif", ContentType::QOI, 90),
+        magic(0, "DDS ", ContentType::DDS, 90),
+        magic(0, "\xFF\x0A", ContentType::JXL, 70),
+        magic(0, "\0\0\0\x0CJXL \r\n\x87\n", ContentType::JXL, 95),
+        magic(0, "\0\0\0\x0CjP  \r\n\x87\n", ContentType::JP2, 95),
+        magic(0, "v/1\x01", ContentType::EXR, 90),
+        magic(0, "#?RADIANCE", ContentType::HDR, 90),
+        magic(0, "#?RGBE", ContentType::HDR, 90),
+        magic(4, "ftyp", ContentType::UNKNOWN, 0, refineFtyp),
+        magic(0, "\x1A\x45\xDF\xA3", ContentType::UNKNOWN, 0, refineEbml),
+        magic(0, "OggS", ContentType::OGG, 90),
+        magic(0, "fLaC", ContentType::FLAC, 95),
+        magic(0, "ID3", ContentType::MP3, 80),
+        magic(0, "\x1F\x8B", ContentType::GZIP, 90),
+        magic(0, "7z\xBC\xAF\x27\x1C", ContentType::SEVEN_ZIP, 95),
+        magic(0, "Rar!\x1A\x07", ContentType::RAR, 95),
+        magic(0, "\xFD" "7zXZ\0", ContentType::XZ, 95),
+        magic(0, "BZh", ContentType::BZIP2, 60),
+        magic(0, "\x28\xB5\x2F\xFD", ContentType::ZSTD, 90),
+        magic(257, "ustar", ContentType::TAR, 90),
+        magic(0, "MSCF", ContentType::CAB, 95),
+        magic(0, "!<arch>\n", ContentType::AR, 80, refineAr),
+        magic(0, "\xED\xAB\xEE\xDB", ContentType::RPM, 95),
+        magic(0, "xar!", ContentType::XAR, 95),
+        magic(0, "MSWIM\0\0\0", ContentType::WIM, 95),
+        magic(0, "SQLite format 3\0", ContentType::SQLITE, 98),
+        magic(32, "** This is a LiteDB file **", ContentType::LITEDB, 95),
+        magic(0, "MDMP", ContentType::MINIDUMP, 90, refineMinidump),
+        magic(0, "ITSF", ContentType::CHM, 90),
+        magic(0, "\0\0\0\x01" "Bud1", ContentType::DS_STORE, 95),
+        magic(0, "wOFF", ContentType::WOFF, 95),
+        magic(0, "wOF2", ContentType::WOFF2, 95),
+        magic(0, "\0\x01\0\0", ContentType::TTF, 70, refineTrueType),
+        magic(0, "true", ContentType::TTF, 70, refineTrueType),
+        magic(0, "OTTO", ContentType::OTF, 90),
+        magic(0, "ttcf", ContentType::TTC, 90),
+        magic(0, "-----BEGIN ", ContentType::PEM, 80),
+    };
+
+    // footers, at their distance from the end
+    const Magic TAIL_MAGIC[] = {
+        magic(512, "koly", ContentType::DMG, 90),
+        magic(18, "TRUEVISION-XFILE.\0", ContentType::TGA, 95),
+    };
+
+    constexpr struct
+    {
+        Type type;
+        const char* mimeType;
+    } MIME_TYPES[] = {
+        {ContentType::UNKNOWN, "application/octet-stream"},
+        {ContentType::ZIP, "application/zip"},
+        {ContentType::DOCX, "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+        {ContentType::XLSX, "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+        {ContentType::PPTX, "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+        {ContentType::VSDX, "application/vnd.ms-visio.drawing"},
+        {ContentType::ODT, "application/vnd.oasis.opendocument.text"},
+        {ContentType::ODS, "application/vnd.oasis.opendocument.spreadsheet"},
+        {ContentType::ODP, "application/vnd.oasis.opendocument.presentation"},
+        {ContentType::ODG, "application/vnd.oasis.opendocument.graphics"},
+        {ContentType::EPUB, "application/epub+zip"},
+        {ContentType::JAR, "application/java-archive"},
+        {ContentType::APK, "application/vnd.android.package-archive"},
+        {ContentType::IPA, "application/x-ios-app"},
+        {ContentType::APPX, "application/vnd.ms-appx"},
+        {ContentType::APPX_BUNDLE, "application/vnd.ms-appx.bundle"},
+        {ContentType::VSIX, "application/vsix"},
+        {ContentType::NUPKG, "application/x-nupkg"},
+        {ContentType::XPS, "application/vnd.ms-xpsdocument"},
+        {ContentType::KMZ, "application/vnd.google-earth.kmz"},
+        {ContentType::MODEL_3MF, "model/3mf"},
+        {ContentType::CFB, "application/x-ole-storage"},
+        {ContentType::DOC, "application/msword"},
+        {ContentType::XLS, "application/vnd.ms-excel"},
+        {ContentType::PPT, "application/vnd.ms-powerpoint"},
+        {ContentType::VSD, "application/vnd.visio"},
+        {ContentType::MSI, "application/x-msi"},
+        {ContentType::MSG, "application/vnd.ms-outlook"},
+        {ContentType::THUMBS_DB, "application/x-ms-thumbnail-cache"},
+        {ContentType::PE, "application/vnd.microsoft.portable-executable"},
+        {ContentType::DOS, "application/x-dosexec"},
+        {ContentType::ELF, "application/x-elf"},
+        {ContentType::ELF_OBJECT, "application/x-object"},
+        {ContentType::ELF_EXECUTABLE, "application/x-executable"},
+        {ContentType::ELF_SHARED, "application/x-sharedlib"},
+        {ContentType::ELF_CORE, "application/x-coredump"},
+        {ContentType::MACHO, "application/x-mach-binary"},
+        {ContentType::JAVA_CLASS, "application/java-vm"},
+        {ContentType::DEX, "application/x-dex"},
+        {ContentType::UIMAGE, "application/x-uboot-image"},
+        {ContentType::PDF, "application/pdf"},
+        {ContentType::POSTSCRIPT, "application/postscript"},
+        {ContentType::RTF, "application/rtf"},
+        {ContentType::PNG, "image/png"},
+        {ContentType::APNG, "image/apng"},
+        {ContentType::JPEG, "image/jpeg"},
+        {ContentType::GIF, "image/gif"},
+        {ContentType::BMP, "image/bmp"},
+        {ContentType::WEBP, "image/webp"},
+        {ContentType::TIFF, "image/tiff"},
+        {ContentType::CR2, "image/x-canon-cr2"},
+        {ContentType::CR3, "image/x-canon-cr3"},
+        {ContentType::ICO, "image/x-icon"},
+        {ContentType::CUR, "image/x-win-bitmap"},
+        {ContentType::ANI, "application/x-navi-animation"},
+        {ContentType::PSD, "image/vnd.adobe.photoshop"},
+        {ContentType::QOI, "image/qoi"},
+        {ContentType::DDS, "image/vnd-ms.dds"},
+        {ContentType::JXL, "image/jxl"},
+        {ContentType::JP2, "image/jp2"},
+        {ContentType::EXR, "image/x-exr"},
+        {ContentType::HDR, "image/vnd.radiance"},
+        {ContentType::HEIC, "image/heic"},
+        {ContentType::HEIF, "image/heif"},
+        {ContentType::AVIF, "image/avif"},
+        {ContentType::TGA, "image/x-tga"},
+        {ContentType::MP4, "video/mp4"},
+        {ContentType::QUICKTIME, "video/quicktime"},
+        {ContentType::M4A, "audio/mp4"},
+        {ContentType::WEBM, "video/webm"},
+        {ContentType::MKV, "video/x-matroska"},
+        {ContentType::AVI, "video/x-msvideo"},
+        {ContentType::WAV, "audio/wav"},
+        {ContentType::OGG, "audio/ogg"},
+        {ContentType::FLAC, "audio/flac"},
+        {ContentType::MP3, "audio/mpeg"},
+        {ContentType::GZIP, "application/gzip"},
+        {ContentType::SEVEN_ZIP, "application/x-7z-compressed"},
+        {ContentType::RAR, "application/vnd.rar"},
+        {ContentType::XZ, "application/x-xz"},
+        {ContentType::BZIP2, "application/x-bzip2"},
+        {ContentType::ZSTD, "application/zstd"},
+        {ContentType::TAR, "application/x-tar"},
+        {ContentType::CAB, "application/vnd.ms-cab-compressed"},
+        {ContentType::AR, "application/x-archive"},
+        {ContentType::DEB, "application/vnd.debian.binary-package"},
+        {ContentType::RPM, "application/x-rpm"},
+        {ContentType::XAR, "application/x-xar"},
+        {ContentType::WIM, "application/x-ms-wim"},
+        {ContentType::DMG, "application/x-apple-diskimage"},
+        {ContentType::SQLITE, "application/vnd.sqlite3"},
+        {ContentType::LITEDB, "application/x-litedb"},
+        {ContentType::MINIDUMP, "application/x-dmp"},
+        {ContentType::CHM, "application/vnd.ms-htmlhelp"},
+        {ContentType::DS_STORE, "application/x-apple-ds-store"},
+        {ContentType::WOFF, "font/woff"},
+        {ContentType::WOFF2, "font/woff2"},
+        {ContentType::TTF, "font/ttf"},
+        {ContentType::OTF, "font/otf"},
+        {ContentType::TTC, "font/collection"},
+        {ContentType::PEM, "application/x-pem-file"},
+    };
+
+    // The head magic by offset, then by first byte.
+    struct Index
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<std::array<std::vector<uint16_t>, 256>> magic;
+    };
+
+    const Index& index()
+    {
+        static const Index built = [] {
+            Index index;
+            for (uint16_t i = 0; i < static_cast<uint16_t>(std::size(HEAD_MAGIC)); i++)
+            {
+                auto& entry = HEAD_MAGIC[i];
+                auto slot = std::find(index.offsets.begin(), index.offsets.end(), entry.offset) - index.offsets.begin();
+                if (static_cast<size_t>(slot) == index.offsets.size())
+                {
+                    index.offsets.push_back(entry.offset);
+                    index.magic.emplace_back();
+                }
+                index.magic[slot][static_cast<uint8_t>(entry.bytes[0])].push_back(i);
+            }
+            return index;
+        }();
+        return built;
+    }
+
+    void apply(const Magic& entry, const Probe& probe, Guesses& guesses)
+    {
+        if ((entry.refine == nullptr || entry.refine(probe, guesses)) && entry.type != ContentType::UNKNOWN)
+            guesses.add(entry.type, entry.confidence);
+    }
+}
+
+bool ContentType::Sniff(const MappedFile::PathChar* path, Guess* guesses, uint32_t capacity, uint32_t* count)
+{
+    MappedWindow file;
+    if (!file.Open(path))
+        return false;
+
+    uint8_t head[HEAD_SIZE];
+    uint8_t tail[TAIL_SIZE];
+    auto size = file.Size();
+    auto headLength = static_cast<uint32_t>(std::min<uint64_t>(size, HEAD_SIZE));
+    auto tailLength = static_cast<uint32_t>(std::min<uint64_t>(size, TAIL_SIZE));
+    if (headLength != 0)
+    {
+        auto view = file.View(0, headLength);
+        if (view == nullptr)
+            return false;
+        memcpy(head, view, headLength);
+    }
+    if (tailLength != 0)
+    {
+        auto view = file.View(size - tailLength, tailLength);
+        if (view == nullptr)
+            return false;
+        memcpy(tail, view, tailLength);
+    }
+
+    *count = Match(head, headLength, tail, tailLength, size, guesses, capacity);
+    return true;
+}
+
+uint32_t ContentType::Match(const uint8_t* head, size_t headLength, const uint8_t* tail, size_t tailLength,
+                            uint64_t size, Guess* guesses, uint32_t capacity)
+{
+    Probe probe{head, static_cast<size_t>(std::min<uint64_t>(headLength, size)), tail,
+                static_cast<size_t>(std::min<uint64_t>(tailLength, size)), size};
+    Guesses found;
+
+    auto& magicIndex = index();
+    for (size_t slot = 0; slot < magicIndex.offsets.size(); slot++)
+    {
+        auto offset = magicIndex.offsets[slot];
+        if (offset >= probe.headLength)
+            continue;
+
+        for (auto i : magicIndex.magic[slot][probe.head[offset]])
+        {
+            auto& entry = HEAD_MAGIC[i];
+            if (probe.equals(offset, entry.bytes, entry.length))
+                apply(entry, probe, found);
+        }
+    }
+
+    for (auto& entry : TAIL_MAGIC)
+    {
+        if (entry.offset <= probe.tailLength &&
+            memcmp(probe.tail + probe.tailLength - entry.offset, entry.bytes, entry.length) == 0)
+            apply(entry, probe, found);
+    }
+
+    // Acrobat takes a header anywhere in the first kilobyte
+    auto searched = std::min(probe.headLength, PDF_SEARCH);
+    if (std::search(probe.head + std::min<size_t>(searched, 1), probe.head + searched, PDF_HEADER,
+                    PDF_HEADER + sizeof(PDF_HEADER) - 1) != probe.head + searched)
+        found.add(PDF, 80);
+
+    return found.store(guesses, capacity);
+}
+
+const char* ContentType::MimeType(uint32_t type)
+{
+    for (auto& entry : MIME_TYPES)
+    {
+        if (entry.type == type)
+            return entry.mimeType;
+    }
+    return nullptr;
+}
@@ -0,0 +1,168 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Guesses the type of a file from its first and last few kilobytes, which are read once, so the
+// host can tell plugins what a file is without each of them opening it. The magic numbers are
+// kept in a table indexed by their offset and first byte, and the containers that need a closer
+// look (zip packages, compound files, executables, MP4-style boxes) are refined from the same bytes.
+class ContentType
+{
+public:
+    static constexpr uint32_t HEAD_SIZE = 8 * 1024;
+    static constexpr uint32_t TAIL_SIZE = 8 * 1024;
+    static constexpr uint32_t MAX_GUESSES = 8;
+
+    enum Type : uint32_t
+    {
+        UNKNOWN,
+        // zip and the packages built on it
+        ZIP,
+        DOCX,
+        XLSX,
+        PPTX,
+        VSDX,
+        ODT,
+        ODS,
+        ODP,
+        ODG,
+        EPUB,
+        JAR,
+        APK,
+        IPA,
+        APPX,
+        APPX_BUNDLE,
+        VSIX,
+        NUPKG,
+        XPS,
+        KMZ,
+        MODEL_3MF,
+        // compound files
+        CFB,
+        DOC,
+        XLS,
+        PPT,
+        VSD,
+        MSI,
+        MSG,
+        THUMBS_DB,
+        // executables
+        PE,
+        DOS,
+        ELF,
+        ELF_OBJECT,
+        ELF_EXECUTABLE,
+        ELF_SHARED,
+        ELF_CORE,
+        MACHO,
+        JAVA_CLASS,
+        DEX,
+        UIMAGE,
+        // documents
+        PDF,
+        POSTSCRIPT,
+        RTF,
+        // images
+        PNG,
+        APNG,
+        JPEG,
+        GIF,
+        BMP,
+        WEBP,
+        TIFF,
+        CR2,
+        CR3,
+        ICO,
+        CUR,
+        ANI,
+        PSD,
+        QOI,
+        DDS,
+        JXL,
+        JP2,
+        EXR,
+        HDR,
+        HEIC,
+        HEIF,
+        AVIF,
+        TGA,
+        // media
+        MP4,
+        QUICKTIME,
+        M4A,
+        WEBM,
+        MKV,
+        AVI,
+        WAV,
+        OGG,
+        FLAC,
+        MP3,
+        // archives
+        GZIP,
+        SEVEN_ZIP,
+        RAR,
+        XZ,
+        BZIP2,
+        ZSTD,
+        TAR,
+        CAB,
+        AR,
+        DEB,
+        RPM,
+        XAR,
+        WIM,
+        DMG,
+        // everything else
+        SQLITE,
+        LITEDB,
+        MINIDUMP,
+        CHM,
+        DS_STORE,
+        WOFF,
+        WOFF2,
+        TTF,
+        OTF,
+        TTC,
+        PEM,
+        COUNT,
+    };
+
+    // Must match NativeGuess in QuickLook.Common/Helpers/ContentTypeHelper.cs
+    struct Guess
+    {
+        uint32_t type;
+        uint32_t confidence; // 1 to 100
+    };
+
+    // Reads the head and tail of the file and matches them. Fails only if the file cannot be read;
+    // a file that matches nothing has no guesses.
+    static bool Sniff(const MappedFile::PathChar* path, Guess* guesses, uint32_t capacity, uint32_t* count);
+
+    // Stores the guesses for a file of size bytes that starts with head and ends with tail, most
+    // confident first, and returns how many there are, at most MAX_GUESSES.
+    static uint32_t Match(const uint8_t* head, size_t headLength, const uint8_t* tail, size_t tailLength,
+                          uint64_t size, Guess* guesses, uint32_t capacity);
+
+    // The MIME type of type, or nullptr if there is no such type.
+    static const char* MimeType(uint32_t type);
+};
@@ -0,0 +1,498 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CsvTable.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t QUOTE = '"';
+    constexpr uint8_t LINE_FEED = '\n';
+    constexpr uint8_t CARRIAGE_RETURN = '\r';
+
+    constexpr uint8_t DELIMITERS[] = {',', ';', '\t', '|'};
+    constexpr size_t DELIMITER_COUNT = sizeof(DELIMITERS);
+    constexpr size_t MAX_SAMPLE_ROWS = 1000;
+
+    // Bit i of the result is the parity of bits 0 to i of mask: set from an opening quote up to,
+    // not including, the closing one.
+    inline uint64_t prefixXor(uint64_t mask)
+    {
+        mask ^= mask << 1;
+        mask ^= mask << 2;
+        mask ^= mask << 4;
+        mask ^= mask << 8;
+        mask ^= mask << 16;
+        mask ^= mask << 32;
+        return mask;
+    }
+
+    // Takes the row ends of one 64-byte block given as masks of its quotes and line feeds. Returns
+    // true and sets *at to the byte after the *count-th if the block has that many; otherwise
+    // lowers *count by their number and carries the quoting on in *inside.
+    inline bool takeBlock(uint64_t quotes, uint64_t lineFeeds, uint64_t* inside, uint64_t* count, size_t* at)
+    {
+        auto quoted = prefixXor(quotes) ^ *inside;
+        // all ones if the block ends inside quotes
+        *inside = 0 - (quoted >> 63);
+
+        auto ends = lineFeeds & ~quoted;
+        if (ends == 0)
+            return false;
+
+        auto found = static_cast<uint64_t>(Simd::PopCount(ends));
+        if (found < *count)
+        {
+            *count -= found;
+            return false;
+        }
+
+        for (; *count > 1; --*count)
+            ends &= ends - 1;
+        *count = 0;
+        *at = Simd::TrailingZeros(ends) + 1;
+        return true;
+    }
+
+    size_t skipScalar(const uint8_t* data, size_t size, bool* quoted, uint64_t* count, size_t i)
+    {
+        for (; i < size; i++)
+        {
+            if (data[i] == QUOTE)
+                *quoted = !*quoted;
+            else if (data[i] == LINE_FEED && !*quoted && --*count == 0)
+                return i + 1;
+        }
+        return size;
+    }
+
+    // The vector kernels stop at the last full block and leave the rest in *next.
+
+#ifdef QL_SIMD_X86
+    size_t skipSse2(const uint8_t* data, size_t size, bool* quoted, uint64_t* count, size_t* next)
+    {
+        auto quote = _mm_set1_epi8(static_cast<char>(QUOTE));
+        auto lineFeed = _mm_set1_epi8(static_cast<char>(LINE_FEED));
+        uint64_t inside = *quoted ? ~0ull : 0;
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            uint64_t quotes = 0, lineFeeds = 0;
+            for (int part = 0; part < 4; part++)
+            {
+                auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16 * part));
+                quotes |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote))))
+                          << (16 * part);
+                lineFeeds |=
+                    static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, lineFeed))))
+                    << (16 * part);
+            }
+
+            size_t at;
+            if (takeBlock(quotes, lineFeeds, &inside, count, &at))
+            {
+                *quoted = false;
+                return i + at;
+            }
+        }
+        *quoted = inside != 0;
+        *next = i;
+        return size;
+    }
+
+    QL_TARGET_AVX2 size_t skipAvx2(const uint8_t* data, size_t size, bool* quoted, uint64_t* count, size_t* next)
+    {
+        auto quote = _mm256_set1_epi8(static_cast<char>(QUOTE));
+        auto lineFeed = _mm256_set1_epi8(static_cast<char>(LINE_FEED));
+        uint64_t inside = *quoted ? ~0ull : 0;
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            auto low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            auto high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+            auto quotes =
+                static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, quote)))) |
+                static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, quote))))
+                    << 32;
+            auto lineFeeds =
+                static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, lineFeed)))) |
+                static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, lineFeed))))
+                    << 32;
+
+            size_t at;
+            if (takeBlock(quotes, lineFeeds, &inside, count, &at))
+            {
+                *quoted = false;
+                return i + at;
+            }
+        }
+        *quoted = inside != 0;
+        *next = i;
+        return size;
+    }
+#endif
+
+#ifdef QL_SIMD_NEON
+    constexpr uint8_t BIT_WEIGHTS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+    // NEON has no movemask; weighting each byte by its bit and adding pairs three times gathers
+    // the comparison results of 64 bytes into one mask.
+    inline uint64_t movemask(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d, uint8x16_t weights)
+    {
+        auto ab = vpaddq_u8(vandq_u8(a, weights), vandq_u8(b, weights));
+        auto cd = vpaddq_u8(vandq_u8(c, weights), vandq_u8(d, weights));
+        auto sum = vpaddq_u8(ab, cd);
+        sum = vpaddq_u8(sum, sum);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+    }
+
+    size_t skipNeon(const uint8_t* data, size_t size, bool* quoted, uint64_t* count, size_t* next)
+    {
+        auto quote = vdupq_n_u8(QUOTE);
+        auto lineFeed = vdupq_n_u8(LINE_FEED);
+        auto weights = vld1q_u8(BIT_WEIGHTS);
+        uint64_t inside = *quoted ? ~0ull : 0;
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            auto a = vld1q_u8(data + i);
+            auto b = vld1q_u8(data + i + 16);
+            auto c = vld1q_u8(data + i + 32);
+            auto d = vld1q_u8(data + i + 48);
+            auto quotes = movemask(vceqq_u8(a, quote), vceqq_u8(b, quote), vceqq_u8(c, quote), vceqq_u8(d, quote),
+                                   weights);
+            auto lineFeeds = movemask(vceqq_u8(a, lineFeed), vceqq_u8(b, lineFeed), vceqq_u8(c, lineFeed),
+                                      vceqq_u8(d, lineFeed), weights);
+
+            size_t at;
+            if (takeBlock(quotes, lineFeeds, &inside, count, &at))
+            {
+                *quoted = false;
+                return i + at;
+            }
+        }
+        *quoted = inside != 0;
+        *next = i;
+        return size;
+    }
+#endif
+}
+
+bool CsvTable::Open(const MappedFile::PathChar* path, uint64_t start, uint8_t delimiter)
+{
+    if (!_buildWindow.Open(path) || !_readWindow.Open(path))
+        return false;
+
+    _size = _buildWindow.Size();
+    if (start > _size)
+        start = _size;
+
+    if (delimiter == 0)
+    {
+        auto length = _size - start < SAMPLE_SIZE ? static_cast<uint32_t>(_size - start) : SAMPLE_SIZE;
+        auto sample = _buildWindow.View(start, length);
+        delimiter = sample != nullptr ? InferDelimiter(sample, length) : ',';
+    }
+    _delimiter = delimiter;
+    _quoted = false;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _checkpoints.assign(1, start);
+    _rowEnds = 0;
+    _indexed = start;
+    _openEnd = false;
+    return true;
+}
+
+CsvTable::Info CsvTable::GetInfo()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return {_size, _openEnd ? _rowEnds + 1 : _rowEnds, _indexed, _delimiter};
+}
+
+bool CsvTable::Build(uint32_t bytes)
+{
+    // only this thread changes the index, so it can read it without the lock
+    auto position = _indexed;
+    if (position == _size)
+        return false;
+
+    auto end = _size - position > bytes ? position + bytes : _size;
+    auto rowEnds = _rowEnds;
+    std::vector<uint64_t> checkpoints;
+
+    while (position < end)
+    {
+        auto wanted = CHECKPOINT_INTERVAL - rowEnds % CHECKPOINT_INTERVAL;
+        auto count = wanted;
+        if (!skip(_buildWindow, &position, end, &_quoted, &count))
+            return false;
+
+        rowEnds += wanted - count;
+        if (count == 0)
+            checkpoints.push_back(position);
+    }
+
+    // a last row without a line end, or one cut off inside quotes, still counts
+    auto openEnd = false;
+    if (end == _size)
+    {
+        auto last = _buildWindow.View(_size - 1, 1);
+        openEnd = _quoted || (last != nullptr && *last != LINE_FEED);
+    }
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _checkpoints.insert(_checkpoints.end(), checkpoints.begin(), checkpoints.end());
+    _rowEnds = rowEnds;
+    _indexed = end;
+    _openEnd = openEnd;
+    return end < _size;
+}
+
+uint32_t CsvTable::GetRows(uint64_t firstRow, uint32_t count, uint64_t* starts)
+{
+    uint64_t position, rows, indexed;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        rows = _openEnd ? _rowEnds + 1 : _rowEnds;
+        indexed = _indexed;
+        if (firstRow >= rows)
+            return 0;
+        position = _checkpoints[static_cast<size_t>(firstRow / CHECKPOINT_INTERVAL)];
+    }
+
+    // checkpoints are row starts, which are never inside quotes
+    auto quoted = false;
+    uint64_t ahead = firstRow % CHECKPOINT_INTERVAL;
+    if (ahead != 0 && (!skip(_readWindow, &position, indexed, &quoted, &ahead) || ahead != 0))
+        return 0;
+
+    uint32_t found = 0;
+    starts[0] = position;
+    while (found < count && firstRow + found < rows)
+    {
+        uint64_t one = 1;
+        if (!skip(_readWindow, &position, indexed, &quoted, &one))
+            break;
+
+        starts[++found] = position;
+    }
+    return found;
+}
+
+bool CsvTable::FindRow(uint64_t offset, uint64_t* row)
+{
+    uint64_t position, first, indexed;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        indexed = _indexed;
+        if (offset >= indexed)
+            return false;
+
+        auto after = std::upper_bound(_checkpoints.begin(), _checkpoints.end(), offset);
+        auto index = after == _checkpoints.begin() ? 0 : static_cast<size_t>(after - _checkpoints.begin() - 1);
+        position = _checkpoints[index];
+        first = index * CHECKPOINT_INTERVAL;
+    }
+
+    // like TextLines::FindLine, from a row start, which is never inside quotes
+    auto quoted = false;
+    while (true)
+    {
+        uint64_t one = 1;
+        if (!skip(_readWindow, &position, indexed, &quoted, &one))
+            return false;
+
+        if (one != 0 || position > offset)
+        {
+            *row = first;
+            return true;
+        }
+        first++;
+    }
+}
+
+uint32_t CsvTable::ReadRow(uint64_t offset, uint64_t end, uint8_t* text, uint32_t capacity, uint32_t* fieldEnds,
+                           uint32_t maxFields)
+{
+    if (offset >= end || end > _size)
+        return 0;
+
+    auto length = end - offset < MappedWindow::MAX_SPAN ? static_cast<uint32_t>(end - offset) : MappedWindow::MAX_SPAN;
+    auto row = _readWindow.View(offset, length);
+    return row != nullptr ? Split(row, length, _delimiter, text, capacity, fieldEnds, maxFields) : 0;
+}
+
+bool CsvTable::skip(MappedWindow& window, uint64_t* offset, uint64_t end, bool* quoted, uint64_t* count)
+{
+    while (*count != 0 && *offset < end)
+    {
+        auto part =
+            end - *offset < MappedWindow::MAX_SPAN ? static_cast<uint32_t>(end - *offset) : MappedWindow::MAX_SPAN;
+        auto data = window.View(*offset, part);
+        if (data == nullptr)
+            return false;
+
+        *offset += Skip(data, part, quoted, count, Simd::Best());
+    }
+    return true;
+}
+
+size_t CsvTable::Skip(const uint8_t* data, size_t size, bool* quoted, uint64_t* count, Simd::Level level)
+{
+    if (*count == 0)
+        return 0;
+
+    size_t next = 0;
+    size_t index = size;
+    switch (level)
+    {
+#ifdef QL_SIMD_X86
+    case Simd::SSE2:
+        index = skipSse2(data, size, quoted, count, &next);
+        break;
+    case Simd::AVX2:
+        index = skipAvx2(data, size, quoted, count, &next);
+        break;
+#endif
+#ifdef QL_SIMD_NEON
+    case Simd::NEON:
+        index = skipNeon(data, size, quoted, count, &next);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return *count == 0 ? index : skipScalar(data, size, quoted, count, next);
+}
+
+uint32_t CsvTable::Split(const uint8_t* row, size_t size, uint8_t delimiter, uint8_t* text, uint32_t capacity,
+                         uint32_t* fieldEnds, uint32_t maxFields)
+{
+    if (maxFields == 0)
+        return 0;
+
+    if (size > 0 && row[size - 1] == LINE_FEED)
+        size--;
+    if (size > 0 && row[size - 1] == CARRIAGE_RETURN)
+        size--;
+
+    // Like the row index, every quote opens or closes a quoted part, so a field can mix quoted and
+    // plain text; two quotes inside a quoted part stand for one.
+    uint32_t fields = 0;
+    uint32_t written = 0;
+    auto quoted = false;
+    for (size_t i = 0; i < size; i++)
+    {
+        auto byte = row[i];
+        if (byte == QUOTE)
+        {
+            if (!quoted || i + 1 >= size || row[i + 1] != QUOTE)
+            {
+                quoted = !quoted;
+                continue;
+            }
+            i++;
+        }
+        else if (byte == delimiter && !quoted)
+        {
+            fieldEnds[fields++] = written;
+            if (fields == maxFields)
+                return fields;
+            continue;
+        }
+
+        if (written < capacity)
+            text[written++] = byte;
+    }
+
+    fieldEnds[fields++] = written;
+    return fields;
+}
+
+uint8_t CsvTable::InferDelimiter(const uint8_t* data, size_t size)
+{
+    // how often each candidate occurs outside quotes in each whole row of the sample
+    std::vector<std::array<uint32_t, DELIMITER_COUNT>> rows;
+    std::array<uint32_t, DELIMITER_COUNT> counts = {};
+    auto quoted = false;
+    for (size_t i = 0; i < size && rows.size() < MAX_SAMPLE_ROWS; i++)
+    {
+        auto byte = data[i];
+        if (byte == QUOTE)
+        {
+            quoted = !quoted;
+        }
+        else if (quoted)
+        {
+        }
+        else if (byte == LINE_FEED)
+        {
+            rows.push_back(counts);
+            counts = {};
+        }
+        else
+        {
+            for (size_t k = 0; k < DELIMITER_COUNT; k++)
+                counts[k] += byte == DELIMITERS[k];
+        }
+    }
+    // a sample of one row that may be cut off is still better than none
+    if (rows.empty())
+        rows.push_back(counts);
+
+    // the candidate that occurs the same number of times in the most rows wins, the one with
+    // more fields on a tie, and earlier candidates on a full tie
+    auto best = DELIMITERS[0];
+    size_t bestRows = 0;
+    uint32_t bestCount = 0;
+    std::vector<uint32_t> column(rows.size());
+    for (size_t k = 0; k < DELIMITER_COUNT; k++)
+    {
+        for (size_t r = 0; r < rows.size(); r++)
+            column[r] = rows[r][k];
+        std::sort(column.begin(), column.end());
+
+        // the most frequent non-zero count
+        size_t modeRows = 0;
+        uint32_t mode = 0;
+        for (size_t r = 0; r < column.size();)
+        {
+            auto next = r;
+            while (next < column.size() && column[next] == column[r])
+                next++;
+            if (column[r] != 0 && next - r >= modeRows)
+            {
+                modeRows = next - r;
+                mode = column[r];
+            }
+            r = next;
+        }
+
+        if (mode != 0 && (modeRows > bestRows || (modeRows == bestRows && mode > bestCount)))
+        {
+            best = DELIMITERS[k];
+            bestRows = modeRows;
+            bestCount = mode;
+        }
+    }
+    return best;
+}
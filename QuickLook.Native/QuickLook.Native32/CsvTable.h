@@ -0,0 +1,106 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedWindow.h"
+#include "Simd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Row index of a CSV file of any size for the CSV viewer. A background pass finds the row ends the
+// way simdcsv does: 64 bytes at a time, the quotes are turned into a mask of the bytes inside quoted
+// fields by a prefix XOR, and only line feeds outside of it end a row. The start of every
+// CHECKPOINT_INTERVAL-th row is kept, so any row is found by scanning at most that many rows, and
+// only the rows shown are split into fields.
+//
+// Fields follow RFC 4180 with double quotes; the text is taken as bytes, so it must be in an
+// encoding where the delimiter, quote and line feed are single ASCII bytes, such as UTF-8. Build
+// runs on one thread while the other calls are made from another.
+class CsvTable
+{
+public:
+    static constexpr uint32_t CHECKPOINT_INTERVAL = 64;
+    // bytes from the start of the file the delimiter is inferred from
+    static constexpr uint32_t SAMPLE_SIZE = 64 * 1024;
+
+    // Must match CsvInfo in QuickLook.Plugin.CsvViewer/NativeCsvTable.cs
+    struct Info
+    {
+        uint64_t size;
+        uint64_t rows;    // rows whose end is known; all of them once indexed reaches size
+        uint64_t indexed; // offset up to which the row ends are counted
+        uint32_t delimiter;
+    };
+
+    // The first row begins at start, after any byte order mark; a delimiter of 0 is inferred from
+    // the first rows.
+    bool Open(const MappedFile::PathChar* path, uint64_t start, uint8_t delimiter);
+
+    Info GetInfo();
+
+    // Counts the row ends in the next bytes bytes of the file. Returns false once the whole file is
+    // indexed, or if it cannot be read.
+    bool Build(uint32_t bytes);
+
+    // Stores where rows firstRow to firstRow + count - 1 begin, and after them where the last one
+    // ends, in starts[0] to starts[count]. Returns the number of rows found, which is less than
+    // count at the end of what is indexed.
+    uint32_t GetRows(uint64_t firstRow, uint32_t count, uint64_t* starts);
+
+    // Stores the number of the row that offset is in, for turning search matches into rows. Fails
+    // if offset is not indexed yet.
+    bool FindRow(uint64_t offset, uint64_t* row);
+
+    // Splits the row [offset, end) into fields like Split; rows longer than MappedWindow::MAX_SPAN
+    // are cut.
+    uint32_t ReadRow(uint64_t offset, uint64_t end, uint8_t* text, uint32_t capacity, uint32_t* fieldEnds,
+                     uint32_t maxFields);
+
+    // The most consistent of comma, semicolon, tab and bar over the rows of a sample, or comma.
+    static uint8_t InferDelimiter(const uint8_t* data, size_t size);
+
+    // Moves past up to *count row ends and returns where it stopped: just after the *count-th, with
+    // *count set to 0, or at the end of data, with *count lowered by the row ends passed. *quoted
+    // tells whether data starts inside a quoted field, and is left telling whether it ends in one.
+    static size_t Skip(const uint8_t* data, size_t size, bool* quoted, uint64_t* count, Simd::Level level);
+
+    // Writes the unquoted fields of one row one after another into text, which is cut at capacity,
+    // and where each of them ends into fieldEnds. The line end of the row is dropped. Returns the
+    // number of fields, at most maxFields.
+    static uint32_t Split(const uint8_t* row, size_t size, uint8_t delimiter, uint8_t* text, uint32_t capacity,
+                          uint32_t* fieldEnds, uint32_t maxFields);
+
+private:
+    static bool skip(MappedWindow& window, uint64_t* offset, uint64_t end, bool* quoted, uint64_t* count);
+
+    MappedWindow _buildWindow;
+    MappedWindow _readWindow;
+    uint64_t _size = 0;
+    uint8_t _delimiter = ',';
+    bool _quoted = false; // where Build stopped; only Build uses it
+
+    // guards the fields below, which Build changes while the rows are read
+    std::mutex _lock;
+    std::vector<uint64_t> _checkpoints; // where rows 0, CHECKPOINT_INTERVAL, 2 * CHECKPOINT_INTERVAL... begin
+    uint64_t _rowEnds = 0;
+    uint64_t _indexed = 0;
+    bool _openEnd = false; // the file does not end with a row end; set once indexed reaches size
+};
@@ -17,6 +17,7 @@
 
 #include "stdafx.h"
 #include "DOpus.h"
+#include "ProviderInit.h"
 #include "rapidxml.hpp"
 
 #include <iostream>
@@ -54,9 +55,7 @@ void DOpus::GetSelected(PWCHAR buffer)
      * 012FE814  |013A26C0 ; UNICODE "listsel"
      */
 
-    if (hMsgWnd == nullptr)
-        PrepareMessageWindow();
-    if (hMsgWnd == nullptr)
+    if (!ProviderInit::Ensure(ProviderInit::DOPUS))
         return;
 
     PWCHAR data = DOPUS_IPC_LP_DATA;
@@ -116,7 +115,12 @@ void DOpus::ParseXmlBuffer(PWCHAR buffer)
     }
 }
 
-void DOpus::PrepareMessageWindow()
+bool DOpus::IsRunning()
+{
+    return FindWindow(DOPUS_CLASS, DOPUS_NAME) != nullptr;
+}
+
+bool DOpus::PrepareMessageWindow()
 {
     WNDCLASSEX wx = {sizeof wx};
     wx.cbSize = sizeof(WNDCLASSEX);
@@ -127,6 +131,8 @@ void DOpus::PrepareMessageWindow()
         hMsgWnd = CreateWindowEx(0, MSGWINDOW_CLASS, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, nullptr, nullptr);
 
     hGetResultEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+    return hMsgWnd != nullptr && hGetResultEvent != nullptr;
 }
 
 LRESULT CALLBACK DOpus::msgWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
@@ -19,7 +19,8 @@
 class DOpus
 {
 public:
-    static void PrepareMessageWindow();
+    static bool IsRunning();
+    static bool PrepareMessageWindow();
     static void GetSelected(PWCHAR buffer);
 private:
     static void ParseXmlBuffer(PWCHAR buffer);
@@ -0,0 +1,253 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DSStoreReader.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t FILE_MAGIC = 1;
+    constexpr uint32_t BUD1_MAGIC = 0x42756431; // "Bud1"
+    // allocator addresses are relative to the buddy allocator, which starts after the file magic
+    constexpr uint64_t ALLOCATOR_BASE = 4;
+    constexpr uint32_t OFFSETS_PER_PAGE = 256;
+    constexpr uint32_t DSDB_SIZE = 20;
+    constexpr uint32_t NODE_HEADER_SIZE = 8;
+
+    constexpr uint32_t FourCC(const char (&code)[5])
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(code[0])) << 24 |
+               static_cast<uint32_t>(static_cast<uint8_t>(code[1])) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(code[2])) << 8 | static_cast<uint8_t>(code[3]);
+    }
+}
+
+bool DSStoreReader::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool DSStoreReader::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _offsets = 0;
+
+    if (!has(0, 20) || u32(0) != FILE_MAGIC || u32(4) != BUD1_MAGIC || u32(8) != u32(16))
+        return false;
+
+    // the root block: the block address table, the table of contents and the free lists
+    auto root = ALLOCATOR_BASE + u32(8);
+    uint64_t rootSize = u32(12);
+    if (!has(root, rootSize) || rootSize < 8)
+        return false;
+
+    auto blockCount = u32(root);
+    auto tableEntries = (static_cast<uint64_t>(blockCount) + OFFSETS_PER_PAGE - 1) / OFFSETS_PER_PAGE * OFFSETS_PER_PAGE;
+    auto toc = root + 8 + tableEntries * 4;
+    auto end = root + rootSize;
+    if (toc + 4 > end)
+        return false;
+
+    _offsets = root + 8;
+    _info.blockCount = blockCount;
+
+    // the table of contents maps names to block ids; only the "DSDB" B-tree holds records
+    auto entries = u32(toc);
+    auto entry = toc + 4;
+    for (uint32_t i = 0; i < entries && entry < end; i++)
+    {
+        uint32_t length = _data[entry];
+        if (1 + length + 4 > end - entry)
+            break;
+
+        auto name = _data + entry + 1;
+        auto id = u32(entry + 1 + length);
+        entry += 1 + length + 4;
+
+        uint64_t offset;
+        uint64_t blockSize;
+        if (length != 4 || memcmp(name, "DSDB", 4) != 0 || !block(id, &offset, &blockSize) || blockSize < DSDB_SIZE)
+            continue;
+
+        _info.rootNode = u32(offset);
+        _info.levels = u32(offset + 4);
+        _info.records = u32(offset + 8);
+        _info.nodes = u32(offset + 12);
+        _info.pageSize = u32(offset + 16);
+        return true;
+    }
+
+    // a store without a B-tree has no records
+    _info.rootNode = UINT32_MAX;
+    return true;
+}
+
+uint32_t DSStoreReader::ReadRecords(Cursor* cursor, Record* entries, uint32_t count) const
+{
+    if (cursor->done)
+        return 0;
+
+    if (cursor->depth == 0 && cursor->visited == 0 && !push(cursor, _info.rootNode))
+    {
+        cursor->done = 1;
+        return 0;
+    }
+
+    uint32_t filled = 0;
+    while (filled < count && cursor->depth != 0)
+    {
+        auto& frame = cursor->frames[cursor->depth - 1];
+        uint64_t offset;
+        uint64_t size;
+        block(frame.block, &offset, &size); // checked when the node was pushed
+
+        auto rightmost = u32(offset);
+        auto recordCount = u32(offset + 4);
+
+        if (frame.index > recordCount || (frame.index == recordCount && (rightmost == 0 || frame.descended)))
+        {
+            cursor->depth--;
+            continue;
+        }
+
+        // internal nodes interleave child pointers and records and end with the rightmost child
+        if (rightmost != 0 && !frame.descended)
+        {
+            uint32_t child = rightmost;
+            if (frame.index < recordCount)
+            {
+                if (frame.offset + 4 > size)
+                    break;
+                child = u32(offset + frame.offset);
+                frame.offset += 4;
+            }
+
+            frame.descended = 1;
+            if (!push(cursor, child))
+                break;
+            continue;
+        }
+
+        uint64_t next;
+        if (!readRecord(offset + frame.offset, offset + size, &entries[filled], &next))
+            break;
+
+        filled++;
+        frame.offset = static_cast<uint32_t>(next - offset);
+        frame.index++;
+        frame.descended = 0;
+    }
+
+    // the loop only stops early on corrupt data; what was read so far is still returned
+    if (filled < count)
+        cursor->done = 1;
+    return filled;
+}
+
+bool DSStoreReader::has(uint64_t offset, uint64_t size) const
+{
+    return _data != nullptr && offset <= _size && size <= _size - offset;
+}
+
+uint32_t DSStoreReader::u32(uint64_t offset) const
+{
+    return static_cast<uint32_t>(_data[offset]) << 24 | static_cast<uint32_t>(_data[offset + 1]) << 16 |
+           static_cast<uint32_t>(_data[offset + 2]) << 8 | _data[offset + 3];
+}
+
+bool DSStoreReader::block(uint32_t id, uint64_t* offset, uint64_t* size) const
+{
+    if (id >= _info.blockCount)
+        return false;
+
+    // the low five bits of an address are the log2 of the block size, the rest is its offset
+    auto address = u32(_offsets + static_cast<uint64_t>(id) * 4);
+    *offset = ALLOCATOR_BASE + (address & ~0x1fu);
+    *size = 1ull << (address & 0x1f);
+    return has(*offset, *size);
+}
+
+bool DSStoreReader::push(Cursor* cursor, uint32_t id) const
+{
+    uint64_t offset;
+    uint64_t size;
+    if (cursor->depth == MAX_DEPTH || cursor->visited >= _info.blockCount || !block(id, &offset, &size) ||
+        size < NODE_HEADER_SIZE)
+        return false;
+
+    cursor->visited++;
+    cursor->frames[cursor->depth++] = {id, 0, NODE_HEADER_SIZE, 0};
+    return true;
+}
+
+bool DSStoreReader::readRecord(uint64_t offset, uint64_t end, Record* record, uint64_t* next) const
+{
+    // name length, UTF-16BE name, structure code, data type, value
+    if (offset + 4 > end)
+        return false;
+
+    uint64_t nameLength = u32(offset);
+    auto code = offset + 4 + nameLength * 2;
+    if (code + 8 > end)
+        return false;
+
+    *record = {};
+    record->name = _data + offset + 4;
+    record->nameLength = static_cast<uint32_t>(nameLength);
+    record->code = u32(code);
+    record->type = u32(code + 4);
+
+    auto value = code + 8;
+    uint64_t valueSize;
+    switch (record->type)
+    {
+    case FourCC("bool"):
+        valueSize = 1;
+        break;
+    case FourCC("long"):
+    case FourCC("shor"):
+    case FourCC("type"):
+        valueSize = 4;
+        break;
+    case FourCC("comp"):
+    case FourCC("dutc"):
+        valueSize = 8;
+        break;
+    case FourCC("blob"):
+    case FourCC("ustr"):
+        if (value + 4 > end)
+            return false;
+        record->dataLength = u32(value);
+        record->data = _data + value + 4;
+        valueSize = 4 + static_cast<uint64_t>(record->dataLength) * (record->type == FourCC("ustr") ? 2 : 1);
+        break;
+    default:
+        return false;
+    }
+
+    if (valueSize > end - value)
+        return false;
+
+    for (uint64_t i = 0; i < valueSize && record->data == nullptr; i++)
+        record->value = record->value << 8 | _data[value + i];
+
+    *next = value + valueSize;
+    return true;
+}
@@ -0,0 +1,100 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+
+// Zero-copy reader for macOS .DS_Store files. The file is mapped and opening it only resolves the
+// buddy allocator's block table; the "DSDB" B-tree is walked lazily in key order through a cursor,
+// so a DS_Store of a folder with hundreds of thousands of items pages in like a small one.
+//
+// Names and string values are UTF-16BE pointers into the mapping; they are not terminated and not
+// necessarily aligned.
+class DSStoreReader
+{
+public:
+    static constexpr uint32_t MAX_DEPTH = 16;
+
+    // Must match DSStoreInfo in QuickLook.Plugin.ArchiveViewer/DSStore/NativeDSStore.cs
+    struct Info
+    {
+        uint32_t blockCount;
+        uint32_t rootNode;
+        uint32_t levels;
+        uint32_t records; // as claimed by the B-tree header
+        uint32_t nodes;
+        uint32_t pageSize;
+    };
+
+    struct Record
+    {
+        const uint8_t* name;
+        uint32_t nameLength; // in UTF-16 code units
+        uint32_t code;       // e.g. 'Iloc', 'ptbN'
+        uint32_t type;       // 'bool', 'long', 'shor', 'type', 'comp', 'dutc', 'blob' or 'ustr'
+        uint32_t dataLength; // blob: bytes, ustr: UTF-16 code units
+        const uint8_t* data; // blob and ustr only
+        uint64_t value;      // the scalar types only
+    };
+
+    // Position of the next record; start from all zeroes. The path from the root to the current
+    // node is kept in the cursor, so no state lives in the reader.
+    struct Cursor
+    {
+        struct Frame
+        {
+            uint32_t block;
+            uint32_t index;  // next record of the node
+            uint32_t offset; // of the next child pointer or record inside the node
+            uint32_t descended; // internal nodes: the child before the record has been visited
+        };
+
+        uint32_t depth;
+        uint32_t visited; // nodes entered, bounded by the block count against cyclic trees
+        uint32_t done;
+        Frame frames[MAX_DEPTH];
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    // Fills up to count records in B-tree order and returns how many it filled; 0 means the end.
+    // A corrupt node ends the walk.
+    uint32_t ReadRecords(Cursor* cursor, Record* entries, uint32_t count) const;
+
+private:
+    bool has(uint64_t offset, uint64_t size) const;
+    uint32_t u32(uint64_t offset) const;
+    bool block(uint32_t id, uint64_t* offset, uint64_t* size) const;
+    bool push(Cursor* cursor, uint32_t id) const;
+    bool readRecord(uint64_t offset, uint64_t end, Record* record, uint64_t* next) const;
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    uint64_t _offsets = 0; // the block address table inside the root block
+};
@@ -0,0 +1,60 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "stdafx.h"
+
+// Counters reported through the GetDiagnostics export.
+// Callers set cbSize; fields are only ever appended so older callers keep working.
+struct Diagnostics
+{
+    DWORD cbSize;
+
+    ULONGLONG selectionCacheHits;
+    ULONGLONG selectionCacheMisses;
+    ULONGLONG selectionCacheInvalidations;
+
+    // cold initialisation cost of each lazily initialised provider; 0 while it is still uninitialised
+    ULONGLONG wow64HookHelperInitMicroseconds;
+    ULONGLONG dopusInitMicroseconds;
+    ULONGLONG multiCommanderInitMicroseconds;
+    // whether the provider was initialised by the pre-warm thread rather than on its first match
+    BOOL dopusPreWarmed;
+    BOOL multiCommanderPreWarmed;
+    // from the Init export until the pre-warm thread had initialised every running file manager
+    ULONGLONG preWarmMicroseconds;
+
+    ULONGLONG readAheadRequests;
+    ULONGLONG readAheadBytes;
+    ULONGLONG readAheadCancelled;
+
+    ULONGLONG imageCacheHits;
+    ULONGLONG imageCacheMisses;
+    ULONGLONG imageCacheEvictions;
+    // pixel buffers held by the cache, its pool included
+    ULONGLONG imageCacheBytes;
+
+    // first GetCurrentSelection through each provider which had to wait for its initialisation (cold),
+    // and the first which found it ready (warm); 0 until there has been one
+    ULONGLONG wow64HookHelperColdSelectionMicroseconds;
+    ULONGLONG wow64HookHelperWarmSelectionMicroseconds;
+    ULONGLONG dopusColdSelectionMicroseconds;
+    ULONGLONG dopusWarmSelectionMicroseconds;
+    ULONGLONG multiCommanderColdSelectionMicroseconds;
+    ULONGLONG multiCommanderWarmSelectionMicroseconds;
+};
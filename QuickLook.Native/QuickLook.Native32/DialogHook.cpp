@@ -18,6 +18,7 @@
 #include "stdafx.h"
 #include "DialogHook.h"
 #include "WoW64HookHelper.h"
+#include "ProviderInit.h"
 #include "HelperMethods.h"
 
 
@@ -92,9 +93,9 @@ void DialogHook::getSelectedInternal(CComPtr<IShellBrowser> psb, PWCHAR buffer)
 
 void DialogHook::GetSelectedFromWoW64HookHelper(PWCHAR buffer)
 {
-    if (!WoW64HookHelper::CheckStatus())
-        if (!WoW64HookHelper::Launch())
-            return;
+    // the helper is only launched the first time a 32-bit dialog is hit
+    if (!ProviderInit::Ensure(ProviderInit::WOW64HOOKHELPER))
+        return;
 
     auto hHelperWnd = FindWindowEx(HWND_MESSAGE, nullptr, WoW64HookHelper::GetMsgWindowClassName(), nullptr);
     if (hHelperWnd == nullptr)
@@ -18,21 +18,40 @@
 #include "stdafx.h"
 
 #include "Shell32.h"
-#include "WoW64HookHelper.h"
-#include "DOpus.h"
-#include "MultiCommander.h"
 #include "IDMan.h"
 #include "DeskBox.h"
+#include "KeyboardHook.h"
+#include "SelectionCache.h"
+#include "ProviderInit.h"
+#include "ReadAhead.h"
+#include "FolderScanner.h"
+#include "PeImage.h"
+#include "ObjectImage.h"
+#include "XpressHuffman.h"
+#include "MinidumpImage.h"
+#include "DSStoreReader.h"
+#include "CompoundFile.h"
+#include "PakFile.h"
+#include "TextEncoding.h"
+#include "HexView.h"
+#include "TextLines.h"
+#include "CsvTable.h"
+#include "FileSearch.h"
+#include "SyntaxRules.h"
+#include "SyntaxLexer.h"
+#include "TextSniffer.h"
+#include "ContentType.h"
+#include "ImageCache.h"
+#include "GifImage.h"
+#include "ApngImage.h"
+#include "IconContainer.h"
 
 #define EXPORT extern "C" __declspec(dllexport)
 
 EXPORT void Init()
 {
-#ifdef WIN64
-    WoW64HookHelper::Launch();
-#endif
-    DOpus::PrepareMessageWindow();
-    MultiCommander::PrepareMessageWindow();
+    // the WoW64 helper and the DOpus/MultiCommander message windows are set up on first use
+    ProviderInit::PreWarm();
 }
 
 EXPORT Shell32::FocusedWindowType GetFocusedWindowType()
@@ -44,3 +63,869 @@ EXPORT void GetCurrentSelection(PWCHAR buffer)
 {
     Shell32::GetCurrentSelection(buffer);
 }
+
+EXPORT BOOL StartKeyboardHook()
+{
+    return KeyboardHook::Start();
+}
+
+EXPORT void StopKeyboardHook()
+{
+    KeyboardHook::Stop();
+}
+
+EXPORT BOOL WaitKeystrokeEvent(KeyboardHook::KeystrokeEvent* ev, DWORD timeout)
+{
+    return KeyboardHook::WaitEvent(ev, timeout);
+}
+
+EXPORT void SetReadAheadEnabled(BOOL enabled)
+{
+    ReadAhead::SetEnabled(enabled != FALSE);
+}
+
+EXPORT BOOL ScanFolder(PCWCHAR root, DWORD flags, FolderScanner::ProgressCallback progress, PVOID context,
+                       FolderScanner::Result* result)
+{
+    if (root == nullptr || result == nullptr)
+        return FALSE;
+
+    return FolderScanner::Scan(root, flags, progress, context, 0, result);
+}
+
+// A PeImage handle must not be used from two threads at once. Pointers returned through it
+// point into the mapped file and stay valid until PeClose.
+EXPORT PeImage* PeOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto image = new PeImage();
+    if (!image->Open(path))
+    {
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+EXPORT void PeClose(PeImage* image)
+{
+    delete image;
+}
+
+EXPORT BOOL PeGetHeaders(PeImage* image, PeImage::Headers* headers)
+{
+    if (image == nullptr || headers == nullptr)
+        return FALSE;
+
+    *headers = image->GetHeaders();
+    return TRUE;
+}
+
+EXPORT DWORD PeReadImports(PeImage* image, PeImage::ImportCursor* cursor, PeImage::ImportEntry* entries, DWORD count)
+{
+    return image != nullptr && cursor != nullptr && entries != nullptr ? image->ReadImports(cursor, entries, count) : 0;
+}
+
+EXPORT DWORD PeReadExports(PeImage* image, DWORD start, PeImage::ExportEntry* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadExports(start, entries, count) : 0;
+}
+
+EXPORT DWORD PeReadResources(PeImage* image, DWORD directoryOffset, DWORD start, PeImage::ResourceEntry* entries,
+                             DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadResources(directoryOffset, start, entries, count) : 0;
+}
+
+// Same threading and lifetime rules as PeImage. Strings are terminated unless they come with a
+// length.
+EXPORT ObjectImage* ObjectOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto image = new ObjectImage();
+    if (!image->Open(path))
+    {
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+EXPORT void ObjectClose(ObjectImage* image)
+{
+    delete image;
+}
+
+EXPORT BOOL ObjectGetInfo(ObjectImage* image, ObjectImage::Info* info)
+{
+    if (image == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = image->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL ObjectSelectSlice(ObjectImage* image, DWORD index)
+{
+    return image != nullptr && image->SelectSlice(index);
+}
+
+EXPORT BOOL ObjectVerifyPayload(ObjectImage* image)
+{
+    return image != nullptr && image->VerifyPayload();
+}
+
+EXPORT DWORD ObjectReadProgramHeaders(ObjectImage* image, DWORD start, ObjectImage::ProgramHeader* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadProgramHeaders(start, entries, count) : 0;
+}
+
+EXPORT DWORD ObjectReadSections(ObjectImage* image, DWORD start, ObjectImage::Section* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadSections(start, entries, count) : 0;
+}
+
+EXPORT DWORD ObjectReadDynamic(ObjectImage* image, DWORD start, ObjectImage::DynamicEntry* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadDynamic(start, entries, count) : 0;
+}
+
+EXPORT DWORD ObjectReadSymbols(ObjectImage* image, ObjectImage::SymbolCursor* cursor, ObjectImage::Symbol* entries,
+                               DWORD count)
+{
+    return image != nullptr && cursor != nullptr && entries != nullptr ? image->ReadSymbols(cursor, entries, count) : 0;
+}
+
+EXPORT DWORD ObjectReadSlices(ObjectImage* image, DWORD start, ObjectImage::Slice* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadSlices(start, entries, count) : 0;
+}
+
+// Returns the decompressed size of a "MAM" (Xpress Huffman) prefetch file, or 0 if it is not one
+// or is corrupt. Pass output == nullptr to get the size first.
+EXPORT DWORD DecompressMam(const BYTE* input, DWORD inputSize, BYTE* output, DWORD outputSize)
+{
+    if (input == nullptr)
+        return 0;
+
+    return static_cast<DWORD>(XpressHuffman::DecompressMam(input, inputSize, output, outputSize));
+}
+
+EXPORT BOOL XpressHuffmanDecompress(const BYTE* input, DWORD inputSize, BYTE* output, DWORD outputSize)
+{
+    if (input == nullptr || output == nullptr)
+        return FALSE;
+
+    return XpressHuffman::Decompress(input, inputSize, output, outputSize);
+}
+
+// Same threading and lifetime rules as PeImage. Strings are UTF-16 and come with a length.
+EXPORT MinidumpImage* MinidumpOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto image = new MinidumpImage();
+    if (!image->Open(path))
+    {
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+EXPORT void MinidumpClose(MinidumpImage* image)
+{
+    delete image;
+}
+
+EXPORT BOOL MinidumpGetInfo(MinidumpImage* image, MinidumpImage::Info* info)
+{
+    if (image == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = image->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL MinidumpGetSystemInfo(MinidumpImage* image, MinidumpImage::SystemInfo* info)
+{
+    return image != nullptr && info != nullptr && image->GetSystemInfo(info);
+}
+
+EXPORT BOOL MinidumpGetException(MinidumpImage* image, MinidumpImage::Exception* exception)
+{
+    return image != nullptr && exception != nullptr && image->GetException(exception);
+}
+
+EXPORT DWORD MinidumpReadStreams(MinidumpImage* image, DWORD start, MinidumpImage::Stream* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadStreams(start, entries, count) : 0;
+}
+
+EXPORT DWORD MinidumpReadThreads(MinidumpImage* image, DWORD start, MinidumpImage::Thread* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadThreads(start, entries, count) : 0;
+}
+
+EXPORT DWORD MinidumpReadModules(MinidumpImage* image, DWORD start, MinidumpImage::Module* entries, DWORD count)
+{
+    return image != nullptr && entries != nullptr ? image->ReadModules(start, entries, count) : 0;
+}
+
+// Same threading and lifetime rules as PeImage. The cursor carries the whole walk state, so any
+// number of cursors may walk one store.
+EXPORT DSStoreReader* DSStoreOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto store = new DSStoreReader();
+    if (!store->Open(path))
+    {
+        delete store;
+        return nullptr;
+    }
+    return store;
+}
+
+EXPORT void DSStoreClose(DSStoreReader* store)
+{
+    delete store;
+}
+
+EXPORT BOOL DSStoreGetInfo(DSStoreReader* store, DSStoreReader::Info* info)
+{
+    if (store == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = store->GetInfo();
+    return TRUE;
+}
+
+EXPORT DWORD DSStoreReadRecords(DSStoreReader* store, DSStoreReader::Cursor* cursor, DSStoreReader::Record* entries,
+                                DWORD count)
+{
+    return store != nullptr && cursor != nullptr && entries != nullptr ? store->ReadRecords(cursor, entries, count) : 0;
+}
+
+// Same threading and lifetime rules as PeImage. Names are UTF-16 and come with a length; stream
+// segments point into the mapping and are only read, never copied.
+EXPORT CompoundFile* CfbOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto file = new CompoundFile();
+    if (!file->Open(path))
+    {
+        delete file;
+        return nullptr;
+    }
+    return file;
+}
+
+EXPORT void CfbClose(CompoundFile* file)
+{
+    delete file;
+}
+
+EXPORT BOOL CfbGetInfo(CompoundFile* file, CompoundFile::Info* info)
+{
+    if (file == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = file->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL CfbGetEntry(CompoundFile* file, DWORD id, CompoundFile::Entry* entry)
+{
+    return file != nullptr && entry != nullptr && file->GetEntry(id, entry);
+}
+
+EXPORT DWORD CfbReadChildren(CompoundFile* file, DWORD storage, DWORD start, uint32_t* ids, DWORD count)
+{
+    return file != nullptr && ids != nullptr ? file->ReadChildren(storage, start, ids, count) : 0;
+}
+
+EXPORT DWORD CfbReadSegments(CompoundFile* file, DWORD id, CompoundFile::SegmentCursor* cursor,
+                             CompoundFile::Segment* segments, DWORD count)
+{
+    return file != nullptr && cursor != nullptr && segments != nullptr
+               ? file->ReadSegments(id, cursor, segments, count)
+               : 0;
+}
+
+// Same threading and lifetime rules as PeImage. Resource data points into the mapping and is
+// handed out still compressed.
+EXPORT PakFile* PakOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto pak = new PakFile();
+    if (!pak->Open(path))
+    {
+        delete pak;
+        return nullptr;
+    }
+    return pak;
+}
+
+EXPORT void PakClose(PakFile* pak)
+{
+    delete pak;
+}
+
+EXPORT BOOL PakGetInfo(PakFile* pak, PakFile::Info* info)
+{
+    if (pak == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = pak->GetInfo();
+    return TRUE;
+}
+
+EXPORT DWORD PakReadResources(PakFile* pak, DWORD start, PakFile::Resource* entries, DWORD count)
+{
+    return pak != nullptr && entries != nullptr ? pak->ReadResources(start, entries, count) : 0;
+}
+
+// Returns a TextEncoding::Kind; UNKNOWN leaves the decision to a statistical detector. Pass
+// truncated when data is only the head of a file, so a sequence cut off at its end is accepted.
+EXPORT DWORD DetectTextEncoding(const BYTE* data, DWORD size, BOOL truncated)
+{
+    return data != nullptr ? TextEncoding::Detect(data, size, truncated != FALSE) : TextEncoding::UNKNOWN;
+}
+
+// Same as DetectTextEncoding over the first maxBytes of a file, or all of it when maxBytes is 0.
+// The file is mapped rather than read, and is truncated only if it is longer than maxBytes.
+EXPORT DWORD DetectFileTextEncoding(PCWCHAR path, DWORD64 maxBytes)
+{
+    MappedFile file;
+    if (path == nullptr || !file.Open(path))
+        return TextEncoding::UNKNOWN;
+
+    auto size = maxBytes != 0 && maxBytes < file.Size() ? maxBytes : file.Size();
+    return TextEncoding::Detect(file.Data(), static_cast<size_t>(size), size < file.Size());
+}
+
+// Same threading and lifetime rules as PeImage; a search that runs while rows are being painted
+// needs a handle of its own. Rows are ASCII, one '\n'-terminated line each.
+EXPORT HexView* HexOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto view = new HexView();
+    if (!view->Open(path))
+    {
+        delete view;
+        return nullptr;
+    }
+    return view;
+}
+
+EXPORT void HexClose(HexView* view)
+{
+    delete view;
+}
+
+EXPORT BOOL HexGetInfo(HexView* view, HexView::Info* info)
+{
+    if (view == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = view->GetInfo();
+    return TRUE;
+}
+
+EXPORT DWORD HexRowWidth(DWORD offsetDigits, DWORD bytesPerRow)
+{
+    return HexView::RowWidth(offsetDigits, bytesPerRow);
+}
+
+EXPORT DWORD HexFormat(HexView* view, uint64_t firstRow, DWORD rows, DWORD bytesPerRow, char* text, DWORD capacity)
+{
+    return view != nullptr && text != nullptr ? view->Format(firstRow, rows, bytesPerRow, text, capacity) : 0;
+}
+
+// Same threading rules as PeImage, except that TextLinesBuild may run on one other thread while
+// the rest are called.
+EXPORT TextLines* TextLinesOpen(PCWCHAR path, DWORD newline, uint64_t start)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto lines = new TextLines();
+    if (!lines->Open(path, static_cast<TextLines::Newline>(newline), start))
+    {
+        delete lines;
+        return nullptr;
+    }
+    return lines;
+}
+
+EXPORT void TextLinesClose(TextLines* lines)
+{
+    delete lines;
+}
+
+EXPORT BOOL TextLinesGetInfo(TextLines* lines, TextLines::Info* info)
+{
+    if (lines == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = lines->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL TextLinesBuild(TextLines* lines, DWORD bytes)
+{
+    return lines != nullptr && lines->Build(bytes);
+}
+
+EXPORT DWORD TextLinesGetLines(TextLines* lines, uint64_t firstLine, DWORD count, uint64_t* starts)
+{
+    return lines != nullptr && starts != nullptr ? lines->GetLines(firstLine, count, starts) : 0;
+}
+
+EXPORT BOOL TextLinesFindLine(TextLines* lines, uint64_t offset, uint64_t* line)
+{
+    return lines != nullptr && line != nullptr && lines->FindLine(offset, line);
+}
+
+EXPORT DWORD TextLinesRead(TextLines* lines, uint64_t offset, DWORD length, BYTE* buffer)
+{
+    return lines != nullptr && buffer != nullptr ? lines->Read(offset, length, buffer) : 0;
+}
+
+// Same threading rules as TextLines, with CsvBuild on the other thread.
+EXPORT CsvTable* CsvOpen(PCWCHAR path, uint64_t start, DWORD delimiter)
+{
+    if (path == nullptr || delimiter > 0x7F)
+        return nullptr;
+
+    auto table = new CsvTable();
+    if (!table->Open(path, start, static_cast<uint8_t>(delimiter)))
+    {
+        delete table;
+        return nullptr;
+    }
+    return table;
+}
+
+EXPORT void CsvClose(CsvTable* table)
+{
+    delete table;
+}
+
+EXPORT BOOL CsvGetInfo(CsvTable* table, CsvTable::Info* info)
+{
+    if (table == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = table->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL CsvBuild(CsvTable* table, DWORD bytes)
+{
+    return table != nullptr && table->Build(bytes);
+}
+
+EXPORT DWORD CsvGetRows(CsvTable* table, uint64_t firstRow, DWORD count, uint64_t* starts)
+{
+    return table != nullptr && starts != nullptr ? table->GetRows(firstRow, count, starts) : 0;
+}
+
+EXPORT BOOL CsvFindRow(CsvTable* table, uint64_t offset, uint64_t* row)
+{
+    return table != nullptr && row != nullptr && table->FindRow(offset, row);
+}
+
+EXPORT DWORD CsvReadRow(CsvTable* table, uint64_t offset, uint64_t end, BYTE* text, DWORD capacity,
+                        uint32_t* fieldEnds, DWORD maxFields)
+{
+    if (table == nullptr || text == nullptr || fieldEnds == nullptr)
+        return 0;
+
+    return table->ReadRow(offset, end, text, capacity, fieldEnds, maxFields);
+}
+
+// Same threading rules as PeImage, except that SearchCancel may be called from any thread while
+// SearchRun runs. The callback is called on the worker threads, one call at a time.
+EXPORT FileSearch* SearchOpen(PCWCHAR path, const uint16_t* pattern, DWORD length, DWORD encoding, DWORD flags)
+{
+    if (path == nullptr || pattern == nullptr)
+        return nullptr;
+
+    auto search = new FileSearch();
+    if (!search->Open(path, pattern, length, static_cast<RegexDfa::Encoding>(encoding), flags))
+    {
+        delete search;
+        return nullptr;
+    }
+    return search;
+}
+
+EXPORT void SearchClose(FileSearch* search)
+{
+    delete search;
+}
+
+EXPORT BOOL SearchRun(FileSearch* search, uint64_t from, uint64_t to, DWORD threads, FileSearch::Callback callback,
+                      PVOID context)
+{
+    return search != nullptr && search->Run(from, to, threads, callback, context);
+}
+
+EXPORT void SearchCancel(FileSearch* search)
+{
+    if (search != nullptr)
+        search->Cancel();
+}
+
+// Compiled rules are never changed, so they may be shared by lexers on any threads; they must
+// outlive every lexer opened with them.
+EXPORT SyntaxRules* SyntaxRulesCompile(const SyntaxRules::Rule* rules, DWORD count, const uint16_t* text,
+                                       DWORD textLength, DWORD encoding)
+{
+    if ((rules == nullptr && count != 0) || (text == nullptr && textLength != 0))
+        return nullptr;
+
+    auto compiled = new SyntaxRules();
+    if (!compiled->Compile(rules, count, text, textLength, static_cast<RegexDfa::Encoding>(encoding)))
+    {
+        delete compiled;
+        return nullptr;
+    }
+    return compiled;
+}
+
+EXPORT void SyntaxRulesFree(SyntaxRules* rules)
+{
+    delete rules;
+}
+
+EXPORT DWORD SyntaxRulesGetDropped(SyntaxRules* rules)
+{
+    return rules != nullptr ? rules->Dropped() : 0;
+}
+
+// Same threading rules as TextLines, with SyntaxLexerBuild on the other thread.
+EXPORT SyntaxLexer* SyntaxLexerOpen(PCWCHAR path, uint64_t start, SyntaxRules* rules)
+{
+    if (path == nullptr || rules == nullptr)
+        return nullptr;
+
+    auto lexer = new SyntaxLexer();
+    if (!lexer->Open(path, start, rules))
+    {
+        delete lexer;
+        return nullptr;
+    }
+    return lexer;
+}
+
+// Lexes a copy of length UTF-16 code units of text, for rules compiled for UTF-16LE.
+EXPORT SyntaxLexer* SyntaxLexerOpenText(const uint16_t* text, uint64_t length, SyntaxRules* rules)
+{
+    if ((text == nullptr && length != 0) || length > SIZE_MAX / sizeof(uint16_t) || rules == nullptr ||
+        rules->Encoding() != RegexDfa::UTF16LE)
+        return nullptr;
+
+    auto lexer = new SyntaxLexer();
+    if (!lexer->Open(reinterpret_cast<const uint8_t*>(text), static_cast<size_t>(length) * sizeof(uint16_t), rules))
+    {
+        delete lexer;
+        return nullptr;
+    }
+    return lexer;
+}
+
+EXPORT void SyntaxLexerClose(SyntaxLexer* lexer)
+{
+    delete lexer;
+}
+
+EXPORT BOOL SyntaxLexerGetInfo(SyntaxLexer* lexer, SyntaxLexer::Info* info)
+{
+    if (lexer == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = lexer->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL SyntaxLexerBuild(SyntaxLexer* lexer, DWORD bytes)
+{
+    return lexer != nullptr && lexer->Build(bytes);
+}
+
+EXPORT DWORD SyntaxLexerTokenize(SyntaxLexer* lexer, uint64_t firstLine, DWORD count, DWORD maxColumn,
+                                 SyntaxLexer::Token* tokens, DWORD capacity, uint32_t* tokenEnds)
+{
+    if (lexer == nullptr || tokens == nullptr || tokenEnds == nullptr)
+        return 0;
+
+    return lexer->Tokenize(firstLine, count, maxColumn, tokens, capacity, tokenEnds);
+}
+
+EXPORT BOOL SyntaxLexerGetFrame(SyntaxLexer* lexer, DWORD frame, uint32_t* parent, uint32_t* color)
+{
+    return lexer != nullptr && parent != nullptr && color != nullptr && lexer->GetFrame(frame, parent, color);
+}
+
+// A compiled sniffer is never changed, so it may be run on any threads at once.
+EXPORT TextSniffer* TextSnifferCompile(const TextSniffer::Signature* signatures, DWORD count, const uint16_t* text,
+                                       DWORD textLength)
+{
+    if ((signatures == nullptr && count != 0) || (text == nullptr && textLength != 0))
+        return nullptr;
+
+    auto sniffer = new TextSniffer();
+    if (!sniffer->Compile(signatures, count, text, textLength))
+    {
+        delete sniffer;
+        return nullptr;
+    }
+    return sniffer;
+}
+
+EXPORT void TextSnifferFree(TextSniffer* sniffer)
+{
+    delete sniffer;
+}
+
+EXPORT DWORD TextSnifferRun(TextSniffer* sniffer, const uint16_t* text, DWORD length,
+                            TextSniffer::Candidate* candidates, DWORD capacity)
+{
+    if (sniffer == nullptr || (text == nullptr && length != 0) || (candidates == nullptr && capacity != 0))
+        return 0;
+
+    return sniffer->Run(text, length, candidates, capacity);
+}
+
+// Safe to call from any thread.
+EXPORT BOOL ContentTypeSniff(PCWCHAR path, ContentType::Guess* guesses, DWORD capacity, DWORD* count)
+{
+    if (path == nullptr || (guesses == nullptr && capacity != 0) || count == nullptr)
+        return FALSE;
+
+    uint32_t found = 0;
+    if (!ContentType::Sniff(path, guesses, capacity, &found))
+        return FALSE;
+
+    *count = found;
+    return TRUE;
+}
+
+// The returned string is static.
+EXPORT const char* ContentTypeGetMimeType(DWORD type)
+{
+    return ContentType::MimeType(type);
+}
+
+// Safe to call from any thread. The pixels of an acquired image stay valid until ImageCacheRelease;
+// a reserved buffer has to be handed to ImageCacheCommit whether or not it was filled.
+EXPORT void ImageCacheSetBudget(uint64_t bytes)
+{
+    ImageCache::SetBudget(bytes);
+}
+
+EXPORT ImageCache::Entry* ImageCacheAcquire(PCWCHAR path, const ImageCache::Key* key, ImageCache::Image* image)
+{
+    return ImageCache::Acquire(path, key, image);
+}
+
+EXPORT void ImageCacheRelease(ImageCache::Entry* entry)
+{
+    ImageCache::Release(entry);
+}
+
+EXPORT ImageCache::Entry* ImageCacheReserve(PCWCHAR path, const ImageCache::Key* key, ImageCache::Image* image)
+{
+    return ImageCache::Reserve(path, key, image);
+}
+
+EXPORT void ImageCacheCommit(ImageCache::Entry* entry, BOOL keep)
+{
+    ImageCache::Commit(entry, keep != FALSE);
+}
+
+// Same threading and lifetime rules as PeImage. Rendered pixels belong to the image; see
+// GifImage::Render for how long they stay valid.
+EXPORT GifImage* GifOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto image = new GifImage();
+    if (!image->Open(path))
+    {
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+EXPORT void GifClose(GifImage* image)
+{
+    delete image;
+}
+
+EXPORT BOOL GifGetInfo(GifImage* image, GifImage::Info* info)
+{
+    if (image == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = image->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL GifGetFrame(GifImage* image, DWORD index, GifImage::Frame* frame)
+{
+    return image != nullptr && frame != nullptr && image->GetFrame(index, frame);
+}
+
+EXPORT const BYTE* GifRender(GifImage* image, DWORD index)
+{
+    return image != nullptr ? image->Render(index) : nullptr;
+}
+
+// Same rules as GifImage.
+EXPORT ApngImage* ApngOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto image = new ApngImage();
+    if (!image->Open(path))
+    {
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+EXPORT void ApngClose(ApngImage* image)
+{
+    delete image;
+}
+
+EXPORT BOOL ApngGetInfo(ApngImage* image, ApngImage::Info* info)
+{
+    if (image == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = image->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL ApngGetFrame(ApngImage* image, DWORD index, ApngImage::Frame* frame)
+{
+    return image != nullptr && frame != nullptr && image->GetFrame(index, frame);
+}
+
+EXPORT const BYTE* ApngRender(ApngImage* image, DWORD index)
+{
+    return image != nullptr ? image->Render(index) : nullptr;
+}
+
+// Same rules as GifImage. Entry data handed out by IconGetData points into the container and stays valid until
+// IconClose; decoded pixels only until the next IconDecode.
+EXPORT IconContainer* IconOpen(PCWCHAR path)
+{
+    if (path == nullptr)
+        return nullptr;
+
+    auto container = new IconContainer();
+    if (!container->Open(path))
+    {
+        delete container;
+        return nullptr;
+    }
+    return container;
+}
+
+// Indexes a copy of size bytes of data, for icons that are not files of their own.
+EXPORT IconContainer* IconOpenMemory(const BYTE* data, uint64_t size)
+{
+    if (data == nullptr || size > SIZE_MAX)
+        return nullptr;
+
+    auto container = new IconContainer();
+    if (!container->Open(data, static_cast<size_t>(size)))
+    {
+        delete container;
+        return nullptr;
+    }
+    return container;
+}
+
+EXPORT void IconClose(IconContainer* container)
+{
+    delete container;
+}
+
+EXPORT BOOL IconGetInfo(IconContainer* container, IconContainer::Info* info)
+{
+    if (container == nullptr || info == nullptr)
+        return FALSE;
+
+    *info = container->GetInfo();
+    return TRUE;
+}
+
+EXPORT BOOL IconGetEntry(IconContainer* container, DWORD index, IconContainer::Entry* entry)
+{
+    return container != nullptr && entry != nullptr && container->GetEntry(index, entry);
+}
+
+EXPORT BOOL IconGetStep(IconContainer* container, DWORD index, IconContainer::Step* step)
+{
+    return container != nullptr && step != nullptr && container->GetStep(index, step);
+}
+
+EXPORT DWORD IconSelect(IconContainer* container, DWORD icon, DWORD size)
+{
+    return container != nullptr ? container->Select(icon, size) : UINT32_MAX;
+}
+
+EXPORT BOOL IconGetData(IconContainer* container, DWORD index, const BYTE** data, DWORD* size)
+{
+    uint32_t length = 0;
+    if (container == nullptr || data == nullptr || size == nullptr || !container->GetData(index, data, &length))
+        return FALSE;
+
+    *size = length;
+    return TRUE;
+}
+
+EXPORT const BYTE* IconDecode(IconContainer* container, DWORD index)
+{
+    return container != nullptr ? container->Decode(index) : nullptr;
+}
+
+EXPORT void GetDiagnostics(Diagnostics* diagnostics)
+{
+    if (diagnostics == nullptr || diagnostics->cbSize <= sizeof(DWORD))
+        return;
+
+    // older callers pass a shorter struct; give them the prefix they know about
+    Diagnostics all = {sizeof(Diagnostics)};
+    SelectionCache::FillDiagnostics(&all);
+    ProviderInit::FillDiagnostics(&all);
+    ReadAhead::FillDiagnostics(&all);
+    ImageCache::FillDiagnostics(&all);
+
+    auto size = min(static_cast<size_t>(diagnostics->cbSize), sizeof(Diagnostics));
+    memcpy(reinterpret_cast<PBYTE>(diagnostics) + sizeof(DWORD), reinterpret_cast<PBYTE>(&all) + sizeof(DWORD),
+           size - sizeof(DWORD));
+}
@@ -0,0 +1,530 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileSearch.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+    // chunks each worker may be ahead of the last one handed to the callback, which bounds the
+    // matches held back while a slow chunk is still being searched
+    constexpr uint64_t CHUNKS_AHEAD = 2;
+
+    constexpr uint32_t LINE_FEED = '\n';
+
+    inline bool isAsciiLetter(uint32_t c)
+    {
+        return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+    }
+
+    inline bool matchesRest(const uint8_t* data, const uint8_t* pattern, const uint8_t* fold, size_t length)
+    {
+        // the first byte is known to match
+        if (fold == nullptr)
+            return memcmp(data + 1, pattern + 1, length - 1) == 0;
+
+        for (size_t i = 1; i < length; i++)
+        {
+            if ((data[i] | fold[i]) != pattern[i])
+                return false;
+        }
+        return true;
+    }
+
+    size_t findScalar(const uint8_t* data, size_t starts, const uint8_t* pattern, const uint8_t* fold, size_t length,
+                      size_t step, size_t i)
+    {
+        auto first = pattern[0];
+        auto foldFirst = fold != nullptr ? fold[0] : 0;
+        for (; i < starts; i += step)
+        {
+            if ((data[i] | foldFirst) == first && matchesRest(data + i, pattern, fold, length))
+                return i;
+        }
+        return FileSearch::NOT_FOUND;
+    }
+
+    // The vector searches compare 16 or 32 starts at once against the first and the last byte of
+    // the pattern and only check the rest where both match (Muła, "SIMD-friendly algorithms for
+    // substring searching"). The bytes are folded before they are compared, and starts not on a
+    // step are masked out. They stop at the last full vector and leave the rest in *next.
+
+#ifdef QL_SIMD_X86
+    size_t findSse2(const uint8_t* data, size_t starts, const uint8_t* pattern, const uint8_t* fold, size_t length,
+                    uint32_t lanes, size_t* next)
+    {
+        auto first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+        auto last = _mm_set1_epi8(static_cast<char>(pattern[length - 1]));
+        auto foldFirst = _mm_set1_epi8(static_cast<char>(fold != nullptr ? fold[0] : 0));
+        auto foldLast = _mm_set1_epi8(static_cast<char>(fold != nullptr ? fold[length - 1] : 0));
+        size_t i = 0;
+        for (; i + 16 <= starts; i += 16)
+        {
+            auto head = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), foldFirst);
+            auto tail = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1)), foldLast);
+            auto mask = static_cast<uint32_t>(
+                            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)))) &
+                        lanes;
+            for (; mask != 0; mask &= mask - 1)
+            {
+                auto at = i + Simd::TrailingZeros(mask);
+                if (matchesRest(data + at, pattern, fold, length))
+                    return at;
+            }
+        }
+        *next = i;
+        return FileSearch::NOT_FOUND;
+    }
+
+    QL_TARGET_AVX2 size_t findAvx2(const uint8_t* data, size_t starts, const uint8_t* pattern, const uint8_t* fold,
+                                   size_t length, uint32_t lanes, size_t* next)
+    {
+        auto first = _mm256_set1_epi8(static_cast<char>(pattern[0]));
+        auto last = _mm256_set1_epi8(static_cast<char>(pattern[length - 1]));
+        auto foldFirst = _mm256_set1_epi8(static_cast<char>(fold != nullptr ? fold[0] : 0));
+        auto foldLast = _mm256_set1_epi8(static_cast<char>(fold != nullptr ? fold[length - 1] : 0));
+        size_t i = 0;
+        for (; i + 32 <= starts; i += 32)
+        {
+            auto head = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), foldFirst);
+            auto tail =
+                _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1)), foldLast);
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                            _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)))) &
+                        lanes;
+            for (; mask != 0; mask &= mask - 1)
+            {
+                auto at = i + Simd::TrailingZeros(mask);
+                if (matchesRest(data + at, pattern, fold, length))
+                    return at;
+            }
+        }
+        *next = i;
+        return FileSearch::NOT_FOUND;
+    }
+#endif
+
+#ifdef QL_SIMD_NEON
+    size_t findNeon(const uint8_t* data, size_t starts, const uint8_t* pattern, const uint8_t* fold, size_t length,
+                    uint64_t lanes, size_t* next)
+    {
+        auto first = vdupq_n_u8(pattern[0]);
+        auto last = vdupq_n_u8(pattern[length - 1]);
+        auto foldFirst = vdupq_n_u8(fold != nullptr ? fold[0] : 0);
+        auto foldLast = vdupq_n_u8(fold != nullptr ? fold[length - 1] : 0);
+        size_t i = 0;
+        for (; i + 16 <= starts; i += 16)
+        {
+            auto head = vorrq_u8(vld1q_u8(data + i), foldFirst);
+            auto tail = vorrq_u8(vld1q_u8(data + i + length - 1), foldLast);
+            auto equal = vandq_u8(vceqq_u8(head, first), vceqq_u8(tail, last));
+            // NEON has no movemask; narrowing leaves four bits per byte
+            auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0) & lanes;
+            for (; mask != 0; mask &= ~(0xFull << (Simd::TrailingZeros(mask) & ~3u)))
+            {
+                auto at = i + Simd::TrailingZeros(mask) / 4;
+                if (matchesRest(data + at, pattern, fold, length))
+                    return at;
+            }
+        }
+        *next = i;
+        return FileSearch::NOT_FOUND;
+    }
+#endif
+}
+
+struct FileSearch::RunState
+{
+    uint64_t from;
+    uint64_t to;
+    uint64_t chunks;
+    uint64_t ahead;
+    Callback callback;
+    void* context;
+
+    // guards the fields below
+    std::mutex lock;
+    std::condition_variable flushed;
+    uint64_t nextChunk = 0;
+    uint64_t nextFlush = 0;
+    std::map<uint64_t, std::vector<Match>> done; // chunks searched but not flushed yet
+    bool flushing = false;
+    bool stopped = false;
+
+    // only used by the thread that is flushing
+    uint64_t lastEnd = 0;
+};
+
+bool FileSearch::Open(const MappedFile::PathChar* path, const uint16_t* pattern, uint32_t length,
+                      RegexDfa::Encoding encoding, uint32_t flags)
+{
+    if (pattern == nullptr || length == 0 || length > MAX_PATTERN || encoding > RegexDfa::UTF16BE)
+        return false;
+
+    MappedWindow window;
+    if (!window.Open(path))
+        return false;
+
+    _path = path;
+    _size = window.Size();
+    _encoding = encoding;
+    _unit = encoding == RegexDfa::UTF16LE || encoding == RegexDfa::UTF16BE ? 2 : 1;
+    _regex = (flags & REGEX) != 0;
+
+    if (_regex)
+    {
+        // the chunk loops feed line starts and ends but not word boundaries
+        uint32_t ignoreCase = (flags & IGNORE_CASE) != 0 ? static_cast<uint32_t>(RegexDfa::IGNORE_CASE) : 0u;
+        return _forward.Compile(&pattern, &length, 1, encoding, ignoreCase | RegexDfa::UNANCHORED) &&
+               !_forward.MatchesEmpty() && !_forward.UsesWords() && _reverse.Compile(&pattern, &length, 1, encoding, ignoreCase | RegexDfa::REVERSE);
+    }
+
+    // the text is lowered and its ASCII letters folded, so either case matches
+    auto ignoreCase = (flags & IGNORE_CASE) != 0;
+    _text.clear();
+    _fold.clear();
+    for (uint32_t i = 0; i < length; i++)
+    {
+        uint32_t c = pattern[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length && pattern[i + 1] >= 0xDC00 && pattern[i + 1] <= 0xDFFF)
+            c = 0x10000 + ((c - 0xD800) << 10) + (pattern[++i] - 0xDC00);
+
+        auto letter = ignoreCase && isAsciiLetter(c);
+        uint8_t bytes[4];
+        auto count = RegexDfa::Encode(letter ? c | 0x20 : c, encoding, bytes);
+        if (count == 0)
+            return false;
+
+        for (uint32_t b = 0; b < count; b++)
+        {
+            _text.push_back(bytes[b]);
+            _fold.push_back(letter && bytes[b] == (c | 0x20) ? 0x20 : 0);
+        }
+    }
+    return _text.size() <= MAX_PATTERN;
+}
+
+bool FileSearch::Run(uint64_t from, uint64_t to, unsigned threads, Callback callback, void* context)
+{
+    if (callback == nullptr)
+        return false;
+
+    to = std::min(to, _size);
+    if (from >= to)
+        return !_cancelled;
+
+    RunState run;
+    run.from = from;
+    run.to = to;
+    run.chunks = (to - from + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    run.callback = callback;
+    run.context = context;
+
+    auto count = threads != 0 ? std::min(threads, MAX_THREADS)
+                              : std::max(1u, std::min(std::thread::hardware_concurrency(), MAX_THREADS));
+    count = static_cast<unsigned>(std::min<uint64_t>(count, run.chunks));
+    run.ahead = CHUNKS_AHEAD * count;
+
+    // the calling thread is one of the workers
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < count; i++)
+    {
+        try
+        {
+            workers.emplace_back(&FileSearch::worker, this, &run);
+        }
+        catch (const std::system_error&)
+        {
+            break;
+        }
+    }
+    worker(&run);
+
+    for (auto& worker : workers)
+        worker.join();
+
+    return !run.stopped && !_cancelled;
+}
+
+void FileSearch::worker(RunState* run) const
+{
+    MappedWindow window;
+    auto opened = window.Open(_path.c_str());
+
+    std::unique_lock<std::mutex> lock(run->lock);
+    while (true)
+    {
+        run->flushed.wait(lock, [&] {
+            return run->stopped || run->nextChunk >= run->chunks || run->nextChunk < run->nextFlush + run->ahead;
+        });
+        if (run->stopped || run->nextChunk >= run->chunks)
+            break;
+
+        auto chunk = run->nextChunk++;
+        lock.unlock();
+
+        std::vector<Match> matches;
+        auto searched = opened && !_cancelled && searchChunk(window, chunk, *run, &matches);
+
+        lock.lock();
+        if (!searched)
+        {
+            run->stopped = true;
+            run->flushed.notify_all();
+            break;
+        }
+
+        run->done.emplace(chunk, std::move(matches));
+        flush(run, lock);
+    }
+}
+
+void FileSearch::flush(RunState* run, std::unique_lock<std::mutex>& lock) const
+{
+    // one thread at a time hands the chunks to the callback, and carries on with those that got
+    // done meanwhile
+    if (run->flushing)
+        return;
+
+    run->flushing = true;
+    while (!run->stopped)
+    {
+        auto found = run->done.find(run->nextFlush);
+        if (found == run->done.end())
+            break;
+
+        auto matches = std::move(found->second);
+        run->done.erase(found);
+        auto chunk = run->nextFlush;
+        lock.unlock();
+
+        // a match at the end of a chunk may run over the first ones of the next
+        auto kept = std::remove_if(matches.begin(), matches.end(), [&](const Match& match) {
+            if (match.offset < run->lastEnd)
+                return true;
+            run->lastEnd = match.offset + match.length;
+            return false;
+        });
+        matches.erase(kept, matches.end());
+
+        auto searched = std::min(run->to - run->from, (chunk + 1) * CHUNK_SIZE);
+        auto go = !_cancelled && run->callback(matches.data(), static_cast<uint32_t>(matches.size()), searched,
+                                               run->context) != 0;
+
+        lock.lock();
+        run->nextFlush++;
+        if (!go)
+            run->stopped = true;
+        run->flushed.notify_all();
+    }
+    run->flushing = false;
+}
+
+bool FileSearch::searchChunk(MappedWindow& window, uint64_t chunk, const RunState& run,
+                             std::vector<Match>* matches) const
+{
+    // matches begin in [begin, limit) and end by end; the unit before begin tells if a line
+    // begins there
+    auto begin = run.from + chunk * CHUNK_SIZE;
+    auto limit = std::min(run.to, begin + CHUNK_SIZE);
+    auto end = std::min(run.to, limit + (_regex ? MAX_MATCH : _text.size() - 1));
+    auto base = begin > run.from ? begin - _unit : begin;
+
+    auto data = window.View(base, static_cast<uint32_t>(end - base));
+    if (data == nullptr)
+        return false;
+
+    if (_regex)
+        findRegex(data, base, begin, limit, end, run, matches);
+    else
+        findText(data, base, begin, limit, end, matches);
+    return true;
+}
+
+void FileSearch::findText(const uint8_t* data, uint64_t base, uint64_t begin, uint64_t limit, uint64_t end,
+                          std::vector<Match>* matches) const
+{
+    auto length = _text.size();
+    if (end - begin < length)
+        return;
+
+    auto fold = std::any_of(_fold.begin(), _fold.end(), [](uint8_t f) { return f != 0; }) ? _fold.data() : nullptr;
+    auto starts = std::min(limit, end - length + 1);
+    for (auto pos = begin; pos < starts;)
+    {
+        auto index = Find(data + (pos - base), starts - pos + length - 1, _text.data(), fold, length, _unit,
+                          Simd::Best());
+        if (index == NOT_FOUND)
+            break;
+
+        matches->push_back({pos + index, length});
+        pos += index + length;
+    }
+}
+
+void FileSearch::findRegex(const uint8_t* data, uint64_t base, uint64_t begin, uint64_t limit, uint64_t end,
+                           const RunState& run, std::vector<Match>* matches) const
+{
+    auto lines = _forward.UsesLines();
+    auto unit = _unit;
+    auto encoding = _encoding;
+    auto at = [&](uint64_t p) { return data[p - base]; };
+    auto isLineFeed = [&](uint64_t p) {
+        switch (encoding)
+        {
+        case RegexDfa::UTF16LE:
+            return at(p) == LINE_FEED && at(p + 1) == 0;
+        case RegexDfa::UTF16BE:
+            return at(p) == 0 && at(p + 1) == LINE_FEED;
+        default:
+            return at(p) == LINE_FEED;
+        }
+    };
+    // lines begin and end only between code units; past end nothing is known
+    auto lineBegins = [&](uint64_t p) {
+        return (p - run.from) % unit == 0 && (p == run.from || (p - unit >= base && isLineFeed(p - unit)));
+    };
+    auto lineEnds = [&](uint64_t p) {
+        return (p - run.from) % unit == 0 && (p == run.to || (p + unit <= end && isLineFeed(p)));
+    };
+    auto forwardLines = [&](uint32_t state, uint64_t p) {
+        if (lineBegins(p))
+            state = _forward.Next(state, RegexDfa::LINE_BEGIN);
+        if (lineEnds(p))
+            state = _forward.Next(state, RegexDfa::LINE_END);
+        return state;
+    };
+
+    for (auto resume = begin; resume < limit;)
+    {
+        // where the first match from resume on ends; matches beginning at limit or later are
+        // left to the next chunk
+        auto state = _forward.UnanchoredStart();
+        auto p = resume;
+        auto anchored = false;
+        auto found = false;
+        while (true)
+        {
+            if (p == limit && !anchored)
+            {
+                state = _forward.Anchor(state);
+                anchored = true;
+            }
+            if (lines)
+                state = forwardLines(state, p);
+            if (_forward.Match(state) != RegexDfa::NO_MATCH)
+            {
+                found = true;
+                break;
+            }
+            if (state == RegexDfa::DEAD || p == end)
+                break;
+
+            if (lines)
+            {
+                state = _forward.Next(state, at(p++));
+                continue;
+            }
+
+            // nothing happens between the bytes, so only the table is looked at up to limit
+            auto stop = anchored ? end : limit;
+            do
+            {
+                state = _forward.Next(state, at(p++));
+            } while (p < stop && !_forward.IsSpecial(state));
+        }
+        if (!found)
+            return;
+        auto matchEnd = p;
+
+        // back to where the longest match ending there begins
+        state = _reverse.Start();
+        auto matchBegin = matchEnd;
+        for (p = matchEnd;; p--)
+        {
+            if (lines)
+            {
+                if (lineEnds(p))
+                    state = _reverse.Next(state, RegexDfa::LINE_END);
+                if (lineBegins(p))
+                    state = _reverse.Next(state, RegexDfa::LINE_BEGIN);
+            }
+            if (_reverse.Match(state) != RegexDfa::NO_MATCH)
+                matchBegin = p;
+            if (state == RegexDfa::DEAD || p == resume)
+                break;
+            state = _reverse.Next(state, at(p - 1));
+        }
+        if (matchBegin >= limit)
+            return;
+
+        // and on to the longest match from there
+        state = _forward.Start();
+        for (p = matchBegin;; p++)
+        {
+            if (lines)
+                state = forwardLines(state, p);
+            if (_forward.Match(state) != RegexDfa::NO_MATCH)
+                matchEnd = std::max(matchEnd, p);
+            if (state == RegexDfa::DEAD || p == end)
+                break;
+            state = _forward.Next(state, at(p));
+        }
+
+        matches->push_back({matchBegin, matchEnd - matchBegin});
+        resume = matchEnd;
+    }
+}
+
+size_t FileSearch::Find(const uint8_t* data, size_t size, const uint8_t* pattern, const uint8_t* fold, size_t length,
+                        size_t step, Simd::Level level)
+{
+    if (length == 0 || length > size || (step != 1 && step != 2))
+        return NOT_FOUND;
+
+    // with two-byte steps only the even lanes of the masks count
+    auto even = step == 2;
+    auto starts = size - length + 1;
+    size_t next = 0;
+    size_t index = NOT_FOUND;
+    switch (level)
+    {
+#ifdef QL_SIMD_X86
+    case Simd::SSE2:
+        index = findSse2(data, starts, pattern, fold, length, even ? 0x55555555u : UINT32_MAX, &next);
+        break;
+    case Simd::AVX2:
+        index = findAvx2(data, starts, pattern, fold, length, even ? 0x55555555u : UINT32_MAX, &next);
+        break;
+#endif
+#ifdef QL_SIMD_NEON
+    case Simd::NEON:
+        index = findNeon(data, starts, pattern, fold, length, even ? 0x0F0F0F0F0F0F0F0Full : UINT64_MAX, &next);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return index != NOT_FOUND ? index : findScalar(data, starts, pattern, fold, length, step, next);
+}
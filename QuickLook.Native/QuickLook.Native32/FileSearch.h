@@ -0,0 +1,122 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedWindow.h"
+#include "RegexDfa.h"
+#include "Simd.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Whole-file search for the text, CSV and binary viewers. The range is split into chunks of
+// CHUNK_SIZE bytes, which worker threads each search through their own MappedWindow; the matches
+// are handed to the callback in file order as soon as the chunks before them are done, so the
+// first ones show while the rest of the file is still being searched.
+//
+// The pattern is UTF-16 and is searched for in the bytes of the given text encoding. Plain text
+// is found by comparing 16 or 32 positions at once against its first and last byte; regular
+// expressions (see RegexDfa for the syntax) run a forward DFA to where the first match ends, a
+// reverse one back to where it begins and the forward one again for the longest match from there,
+// so every byte is looked at by a table lookup and nothing backtracks. Matches never overlap, and
+// a regular expression match is at most MAX_MATCH bytes long.
+class FileSearch
+{
+public:
+    static constexpr uint32_t MAX_PATTERN = 4096;
+    static constexpr uint32_t CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr uint32_t MAX_MATCH = 1024 * 1024;
+    static constexpr unsigned MAX_THREADS = 8;
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    // Must match SearchOptions in QuickLook.Plugin.TextViewer/NativeFileSearch.cs
+    enum Flags : uint32_t
+    {
+        IGNORE_CASE = 0x1, // ASCII letters only
+        REGEX = 0x2,
+    };
+
+    // Must match SearchMatch in QuickLook.Plugin.TextViewer/NativeFileSearch.cs
+    struct Match
+    {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    // Called with the matches of one or more chunks, in file order, and the number of bytes of the
+    // range searched up to the last of them; return 0 to stop the search.
+    typedef int (*Callback)(const Match* matches, uint32_t count, uint64_t searched, void* context);
+
+    // Fails if the file cannot be opened or the pattern is empty, invalid, has word boundaries or
+    // can match nothing at all, such as "a*".
+    bool Open(const MappedFile::PathChar* path, const uint16_t* pattern, uint32_t length,
+              RegexDfa::Encoding encoding, uint32_t flags);
+
+    uint64_t Size() const
+    {
+        return _size;
+    }
+
+    // Searches [from, to), which is taken as the whole text: lines begin at from and end at to,
+    // and with UTF-16 characters begin at an even distance from from. 0 threads picks a count from
+    // the number of processors. Returns false if the search was stopped or the file could not be
+    // read; the callback has had the matches found before that.
+    bool Run(uint64_t from, uint64_t to, unsigned threads, Callback callback, void* context);
+
+    // Makes a Run on another thread return soon, and any later one at once.
+    void Cancel()
+    {
+        _cancelled = true;
+    }
+
+    // Index of the first occurrence of pattern in data that starts at a multiple of step, 1 or 2,
+    // or NOT_FOUND. Pattern bytes that have fold set also match the byte with 0x20 cleared, for
+    // patterns lowered to find ASCII letters in either case.
+    static size_t Find(const uint8_t* data, size_t size, const uint8_t* pattern, const uint8_t* fold, size_t length,
+                       size_t step, Simd::Level level);
+
+private:
+    struct RunState;
+
+    bool searchChunk(MappedWindow& window, uint64_t chunk, const RunState& run, std::vector<Match>* matches) const;
+    void findText(const uint8_t* data, uint64_t base, uint64_t begin, uint64_t limit, uint64_t end,
+                  std::vector<Match>* matches) const;
+    void findRegex(const uint8_t* data, uint64_t base, uint64_t begin, uint64_t limit, uint64_t end,
+                   const RunState& run, std::vector<Match>* matches) const;
+    void worker(RunState* run) const;
+    void flush(RunState* run, std::unique_lock<std::mutex>& lock) const;
+
+    std::basic_string<MappedFile::PathChar> _path;
+    uint64_t _size = 0;
+    RegexDfa::Encoding _encoding = RegexDfa::BYTES;
+    bool _regex = false;
+    uint32_t _unit = 1; // bytes per code unit
+
+    // plain text, in the bytes of the encoding
+    std::vector<uint8_t> _text;
+    std::vector<uint8_t> _fold;
+
+    RegexDfa _forward;
+    RegexDfa _reverse;
+
+    std::atomic<bool> _cancelled{false};
+};
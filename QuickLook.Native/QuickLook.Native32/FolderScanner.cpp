@@ -0,0 +1,504 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "FolderScanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    typedef FolderScanner::PathChar PathChar;
+    typedef FolderScanner::PathString PathString;
+
+#ifdef _WIN32
+    constexpr PathChar SEPARATOR = L'\\';
+#else
+    constexpr PathChar SEPARATOR = '/';
+#endif
+
+    constexpr unsigned MAX_THREADS = 8;
+    constexpr unsigned DEFAULT_PROGRESS_INTERVAL = 100;
+    constexpr size_t LIST_BUFFER_SIZE = 64 * 1024;
+
+    constexpr int CACHE_SHARDS = 16;
+    constexpr size_t MAX_CACHE_ENTRIES = 256 * 1024;
+
+    // what a single directory contributes by itself, plus the sub-directories to descend into
+    struct Listing
+    {
+        uint64_t directories = 0;
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+        std::vector<PathString> children;
+        bool complete = true;
+
+        void Clear()
+        {
+            directories = files = bytes = 0;
+            children.clear();
+            complete = true;
+        }
+    };
+
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<PathString> tasks;
+    };
+
+    struct ScanState
+    {
+        std::unique_ptr<WorkQueue[]> queues;
+        unsigned queueCount = 0;
+        bool useCache = false;
+
+        // directories queued or being listed; the scan is over when this drops to 0
+        std::atomic<int64_t> pending{0};
+        std::atomic<bool> cancelled{false};
+
+        std::atomic<uint64_t> directories{0};
+        std::atomic<uint64_t> files{0};
+        std::atomic<uint64_t> bytes{0};
+
+        std::mutex doneLock;
+        std::condition_variable done;
+    };
+
+    class ListingCache
+    {
+    public:
+        bool Lookup(const PathString& path, int64_t lastWrite, Listing& listing)
+        {
+            auto& shard = shardOf(path);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            auto it = shard.entries.find(path);
+            if (it == shard.entries.end() || it->second.lastWrite != lastWrite)
+                return false;
+
+            listing = it->second.listing;
+            return true;
+        }
+
+        void Store(const PathString& path, int64_t lastWrite, const Listing& listing)
+        {
+            auto& shard = shardOf(path);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            // crude but bounded: start over once a shard is full
+            if (shard.entries.size() >= MAX_CACHE_ENTRIES / CACHE_SHARDS)
+                shard.entries.clear();
+
+            auto& entry = shard.entries[path];
+            entry.lastWrite = lastWrite;
+            entry.listing = listing;
+        }
+
+        void Clear()
+        {
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.entries.clear();
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            int64_t lastWrite;
+            Listing listing;
+        };
+
+        struct Shard
+        {
+            std::mutex lock;
+            std::unordered_map<PathString, Entry> entries;
+        };
+
+        Shard& shardOf(const PathString& path)
+        {
+            return shards[std::hash<PathString>()(path) % CACHE_SHARDS];
+        }
+
+        Shard shards[CACHE_SHARDS];
+    };
+
+    ListingCache cache;
+    std::atomic<unsigned> threadCount{0};
+
+    bool IsDotOrDotDot(const PathChar* name, size_t length)
+    {
+        return (length == 1 && name[0] == '.') || (length == 2 && name[0] == '.' && name[1] == '.');
+    }
+
+    PathString Join(const PathString& parent, const PathChar* name, size_t length)
+    {
+        PathString path(parent);
+        path.reserve(parent.size() + 1 + length);
+        if (path.empty() || path.back() != SEPARATOR)
+            path.push_back(SEPARATOR);
+        path.append(name, length);
+        return path;
+    }
+
+#ifdef _WIN32
+    PathString NormalizeRoot(const PathChar* root)
+    {
+        PathString path = root;
+
+        // walk below MAX_PATH without caring: \\?\C:\... and \\?\UNC\server\share\...
+        if (path.compare(0, 4, L"\\\\?\\") != 0)
+        {
+            if (path.compare(0, 2, L"\\\\") == 0)
+                path = L"\\\\?\\UNC\\" + path.substr(2);
+            else if (path.size() >= 2 && path[1] == L':')
+                path = L"\\\\?\\" + path;
+        }
+
+        // "\\?\C:" would open the volume rather than its root directory
+        while (path.size() > 1 && path.back() == SEPARATOR && path[path.size() - 2] != L':')
+            path.pop_back();
+        if (path.back() == L':')
+            path.push_back(SEPARATOR);
+
+        return path;
+    }
+
+    bool GetDirectoryTime(const PathString& path, int64_t* lastWrite)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data) ||
+            (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            return false;
+
+        *lastWrite = static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    bool ListDirectory(const PathString& path, std::vector<uint8_t>& buffer, Listing& listing)
+    {
+        auto hDir = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+        if (hDir == INVALID_HANDLE_VALUE)
+            return false;
+
+        // every call fills the buffer with as many entries as fit
+        auto infoClass = FileFullDirectoryRestartInfo;
+        while (GetFileInformationByHandleEx(hDir, infoClass, buffer.data(), static_cast<DWORD>(buffer.size())))
+        {
+            infoClass = FileFullDirectoryInfo;
+
+            auto p = buffer.data();
+            for (;;)
+            {
+                auto info = reinterpret_cast<const FILE_FULL_DIR_INFO*>(p);
+                auto length = info->FileNameLength / sizeof(WCHAR);
+
+                if (!IsDotOrDotDot(info->FileName, length))
+                {
+                    if (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                    {
+                        listing.directories++;
+                        if ((info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+                            listing.children.emplace_back(info->FileName, length);
+                    }
+                    else
+                    {
+                        listing.files++;
+                        listing.bytes += info->EndOfFile.QuadPart;
+                    }
+                }
+
+                if (info->NextEntryOffset == 0)
+                    break;
+                p += info->NextEntryOffset;
+            }
+        }
+
+        listing.complete = GetLastError() == ERROR_NO_MORE_FILES;
+        CloseHandle(hDir);
+        return true;
+    }
+#else
+    PathString NormalizeRoot(const PathChar* root)
+    {
+        PathString path = root;
+        while (path.size() > 1 && path.back() == SEPARATOR)
+            path.pop_back();
+        return path;
+    }
+
+    int64_t ToTime(const struct stat& st)
+    {
+#ifdef __APPLE__
+        return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    }
+
+    bool GetDirectoryTime(const PathString& path, int64_t* lastWrite)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+            return false;
+
+        *lastWrite = ToTime(st);
+        return true;
+    }
+
+    bool ListDirectory(const PathString& path, std::vector<uint8_t>&, Listing& listing)
+    {
+        auto dir = opendir(path.c_str());
+        if (dir == nullptr)
+            return false;
+
+        auto fd = dirfd(dir);
+        while (auto entry = readdir(dir))
+        {
+            auto name = entry->d_name;
+            auto length = strlen(name);
+            if (IsDotOrDotDot(name, length))
+                continue;
+
+            // sub-directories need no stat; everything else needs its size
+            struct stat st;
+            auto isDirectory = entry->d_type == DT_DIR;
+            if (!isDirectory)
+            {
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                isDirectory = S_ISDIR(st.st_mode);
+            }
+
+            if (isDirectory)
+            {
+                listing.directories++;
+                listing.children.emplace_back(name, length);
+            }
+            else
+            {
+                listing.files++;
+                listing.bytes += static_cast<uint64_t>(st.st_size);
+            }
+        }
+
+        closedir(dir);
+        return true;
+    }
+#endif
+
+    bool TakeTask(ScanState& state, unsigned index, PathString& task)
+    {
+        // own work newest first, which keeps the walk depth-first and the queues short
+        {
+            auto& queue = state.queues[index];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+
+        // steal the oldest entry of someone else, which is the one closest to the root
+        for (unsigned i = 1; i < state.queueCount; i++)
+        {
+            auto& queue = state.queues[(index + i) % state.queueCount];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ProcessDirectory(ScanState& state, unsigned index, const PathString& path, std::vector<uint8_t>& buffer,
+                          Listing& listing)
+    {
+        listing.Clear();
+
+        // The time is read from the directory itself, before it is listed, and never taken from the listing
+        // of its parent: that one may come from the cache and then still holds the time the directory had
+        // back then, which would hide every change two or more levels down.
+        int64_t lastWrite = 0;
+        auto canCache = state.useCache && GetDirectoryTime(path, &lastWrite) && lastWrite != 0;
+        if (!canCache || !cache.Lookup(path, lastWrite, listing))
+        {
+            // an unreadable directory has already been counted by its parent
+            if (!ListDirectory(path, buffer, listing))
+                return;
+
+            if (canCache && listing.complete)
+                cache.Store(path, lastWrite, listing);
+        }
+
+        state.directories.fetch_add(listing.directories, std::memory_order_relaxed);
+        state.files.fetch_add(listing.files, std::memory_order_relaxed);
+        state.bytes.fetch_add(listing.bytes, std::memory_order_relaxed);
+
+        if (listing.children.empty())
+            return;
+
+        // account for the children before this directory is marked as finished
+        state.pending.fetch_add(static_cast<int64_t>(listing.children.size()), std::memory_order_relaxed);
+
+        auto& queue = state.queues[index];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        for (auto& child : listing.children)
+            queue.tasks.push_back(Join(path, child.data(), child.size()));
+    }
+
+    void Worker(ScanState* state, unsigned index)
+    {
+        std::vector<uint8_t> buffer(LIST_BUFFER_SIZE);
+        Listing listing;
+        PathString task;
+        auto idle = 0;
+
+        while (!state->cancelled.load(std::memory_order_relaxed) && state->pending.load(std::memory_order_acquire) > 0)
+        {
+            if (!TakeTask(*state, index, task))
+            {
+                // the others are still listing; the next directories show up shortly
+                if (++idle < 64)
+                    std::this_thread::yield();
+                else
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            idle = 0;
+            ProcessDirectory(*state, index, task, buffer, listing);
+
+            if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> guard(state->doneLock);
+                state->done.notify_all();
+            }
+        }
+    }
+
+    void Snapshot(const ScanState& state, FolderScanner::Result* result)
+    {
+        result->directories = state.directories.load(std::memory_order_relaxed);
+        result->files = state.files.load(std::memory_order_relaxed);
+        result->bytes = state.bytes.load(std::memory_order_relaxed);
+    }
+}
+
+bool FolderScanner::Scan(const PathChar* root, unsigned flags, ProgressCallback progress, void* context,
+                         unsigned progressInterval, Result* result)
+{
+    *result = {};
+
+    auto path = NormalizeRoot(root);
+    int64_t rootTime;
+    if (!GetDirectoryTime(path, &rootTime))
+        return false;
+
+    auto count = threadCount.load();
+    if (count == 0)
+        count = std::max(2u, std::min(std::thread::hardware_concurrency(), MAX_THREADS));
+
+    ScanState state;
+    state.queues.reset(new WorkQueue[count]);
+    state.queueCount = count;
+    state.useCache = (flags & USE_CACHE) != 0;
+    state.pending = 1;
+    state.queues[0].tasks.push_back(path);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < count; i++)
+    {
+        try
+        {
+            workers.emplace_back(Worker, &state, i);
+        }
+        catch (const std::system_error&)
+        {
+            break;
+        }
+    }
+
+    // queues without a thread are still drained by stealing; with no thread at all, walk here
+    if (workers.empty())
+        Worker(&state, 0);
+
+    auto interval = std::chrono::milliseconds(progressInterval != 0 ? progressInterval : DEFAULT_PROGRESS_INTERVAL);
+    {
+        std::unique_lock<std::mutex> lock(state.doneLock);
+        while (state.pending.load() > 0 && !state.cancelled.load())
+        {
+            if (state.done.wait_for(lock, interval, [&] { return state.pending.load() == 0; }))
+                break;
+
+            if (progress != nullptr)
+            {
+                Result current;
+                Snapshot(state, &current);
+
+                lock.unlock();
+                if (progress(&current, context) == 0)
+                    state.cancelled = true;
+                lock.lock();
+            }
+        }
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    Snapshot(state, result);
+    return !state.cancelled.load();
+}
+
+void FolderScanner::ClearCache()
+{
+    cache.Clear();
+}
+
+void FolderScanner::SetThreadCount(unsigned count)
+{
+    threadCount = std::min(count, MAX_THREADS * 4);
+}
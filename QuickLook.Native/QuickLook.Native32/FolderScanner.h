@@ -0,0 +1,68 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Parallel directory-tree size counter. Each worker owns a deque of pending directories, takes work
+// from its back and steals from the front of the others when it runs dry. Directories are listed
+// with one bulk call per buffer (GetFileInformationByHandleEx on Windows, readdir elsewhere), so no
+// per-entry allocations happen. Directory symlinks and junctions are counted but never followed.
+//
+// The core is plain C++ so it can be built and measured on any platform; only the directory
+// listing is platform specific.
+class FolderScanner
+{
+public:
+#ifdef _WIN32
+    typedef wchar_t PathChar;
+#else
+    typedef char PathChar;
+#endif
+    typedef std::basic_string<PathChar> PathString;
+
+    // Must match FolderScanResult in QuickLook/NativeMethods/QuickLook.cs
+    struct Result
+    {
+        uint64_t directories; // sub-directories, not counting the root
+        uint64_t files;
+        uint64_t bytes;
+    };
+
+    // Called on the scanning thread every progressInterval milliseconds; return 0 to cancel.
+    typedef int (*ProgressCallback)(const Result* progress, void* context);
+
+    enum Flags
+    {
+        // Reuse the listing of directories whose last-write time has not changed since an earlier scan.
+        // A directory's time only changes when entries are added, removed or renamed, so files
+        // growing in place are not noticed; callers opt in when that is acceptable.
+        USE_CACHE = 0x1,
+    };
+
+    // Returns false when the root cannot be listed or the scan was cancelled; result holds what
+    // has been counted so far either way.
+    static bool Scan(const PathChar* root, unsigned flags, ProgressCallback progress, void* context,
+                     unsigned progressInterval, Result* result);
+
+    static void ClearCache();
+
+    // 0 picks a count from the number of processors
+    static void SetThreadCount(unsigned count);
+};
@@ -0,0 +1,410 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "GifImage.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t HEADER_SIZE = 13; // signature and logical screen descriptor
+    constexpr uint64_t DESCRIPTOR_SIZE = 10;
+    constexpr uint8_t EXTENSION = 0x21;
+    constexpr uint8_t IMAGE = 0x2C;
+    constexpr uint8_t TRAILER = 0x3B;
+    constexpr uint8_t GRAPHIC_CONTROL = 0xF9;
+    constexpr uint8_t APPLICATION = 0xFF;
+    constexpr char NETSCAPE[] = "NETSCAPE2.0";
+    constexpr uint32_t NETSCAPE_LENGTH = 11;
+
+    // 4096 x 4096; every buffer is this many pixels at most, and there are RING_SIZE + 2 of them
+    constexpr uint64_t MAX_PIXELS = 1 << 24;
+
+    constexpr uint32_t MAX_CODE_SIZE = 12;
+    constexpr uint32_t MAX_CODES = 1 << MAX_CODE_SIZE;
+    constexpr uint16_t NO_CODE = 0xFFFF;
+    constexpr uint32_t OPAQUE_BLACK = 0xFF000000;
+
+    // rows of an interlaced image come in four passes: every 8th from 0, every 8th from 4, every 4th from 2, then
+    // every 2nd from 1
+    constexpr uint32_t PASS_START[] = {0, 4, 2, 1};
+    constexpr uint32_t PASS_STEP[] = {8, 8, 4, 2};
+
+    inline uint16_t le16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | p[1] << 8);
+    }
+
+    // where the row-th stored row of an interlaced image goes
+    uint32_t interlacedRow(uint32_t row, uint32_t height)
+    {
+        for (uint32_t pass = 0; pass < 4; pass++)
+        {
+            auto rows = height > PASS_START[pass]
+                            ? (height - PASS_START[pass] + PASS_STEP[pass] - 1) / PASS_STEP[pass]
+                            : 0;
+            if (row < rows)
+                return PASS_START[pass] + row * PASS_STEP[pass];
+            row -= rows;
+        }
+        return height;
+    }
+}
+
+bool GifImage::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool GifImage::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _globalPalette = 0;
+    _globalPaletteSize = 0;
+    _records.clear();
+    _canvas.clear();
+    _next = 0;
+    for (auto& slot : _ring)
+        slot = {};
+
+    if (_data == nullptr || _size < HEADER_SIZE ||
+        (memcmp(_data, "GIF87a", 6) != 0 && memcmp(_data, "GIF89a", 6) != 0))
+        return false;
+
+    _info.width = le16(_data + 6);
+    _info.height = le16(_data + 8);
+    _info.loopCount = 1;
+    if (_info.width == 0 || _info.height == 0 ||
+        static_cast<uint64_t>(_info.width) * _info.height > MAX_PIXELS)
+        return false;
+
+    uint64_t offset = HEADER_SIZE;
+    if ((_data[10] & 0x80) != 0)
+    {
+        _globalPalette = offset;
+        _globalPaletteSize = 2u << (_data[10] & 7);
+        offset += 3 * _globalPaletteSize;
+    }
+
+    // a truncated file keeps the frames that were indexed before it ended
+    Record pending = {};
+    pending.transparent = -1;
+    while (offset < _size && _data[offset] != TRAILER)
+    {
+        if (_data[offset] == EXTENSION)
+        {
+            if (_size - offset < 2)
+                break;
+
+            auto label = _data[offset + 1];
+            auto body = offset + 2;
+            if (label == GRAPHIC_CONTROL && _size - body >= 6 && _data[body] >= 4)
+            {
+                auto packed = _data[body + 1];
+                auto disposal = static_cast<uint32_t>(packed >> 2 & 7);
+                pending.frame.disposal = disposal <= DISPOSE_PREVIOUS ? disposal : DISPOSE_NONE;
+                pending.frame.delay = le16(_data + body + 2) * 10u;
+                pending.transparent = (packed & 1) != 0 ? _data[body + 4] : -1;
+            }
+            else if (label == APPLICATION && _size - body >= 1 + NETSCAPE_LENGTH + 4 &&
+                     _data[body] == NETSCAPE_LENGTH && memcmp(_data + body + 1, NETSCAPE, NETSCAPE_LENGTH) == 0)
+            {
+                auto loop = body + 1 + NETSCAPE_LENGTH;
+                if (_data[loop] >= 3 && _data[loop + 1] == 1)
+                    _info.loopCount = le16(_data + loop + 2);
+            }
+            offset = skipSubBlocks(body);
+        }
+        else if (_data[offset] == IMAGE)
+        {
+            if (_size - offset < DESCRIPTOR_SIZE + 1)
+                break;
+
+            auto descriptor = _data + offset;
+            auto record = pending;
+            record.frame.left = le16(descriptor + 1);
+            record.frame.top = le16(descriptor + 3);
+            record.frame.width = le16(descriptor + 5);
+            record.frame.height = le16(descriptor + 7);
+            record.interlaced = (descriptor[9] & 0x40) != 0;
+            offset += DESCRIPTOR_SIZE;
+            if ((descriptor[9] & 0x80) != 0)
+            {
+                record.palette = offset;
+                record.paletteSize = 2u << (descriptor[9] & 7);
+                offset += 3 * record.paletteSize;
+            }
+            if (offset >= _size)
+                break;
+
+            record.minimumCodeSize = _data[offset];
+            record.data = offset + 1;
+            offset = skipSubBlocks(offset + 1);
+
+            if (record.frame.width != 0 && record.frame.height != 0 &&
+                static_cast<uint64_t>(record.frame.width) * record.frame.height <= MAX_PIXELS)
+                _records.push_back(record);
+
+            pending = {};
+            pending.transparent = -1;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    _info.frameCount = static_cast<uint32_t>(_records.size());
+    return _info.frameCount != 0;
+}
+
+bool GifImage::GetFrame(uint32_t index, Frame* frame) const
+{
+    if (index >= _records.size())
+        return false;
+
+    *frame = _records[index].frame;
+    return true;
+}
+
+const uint8_t* GifImage::Render(uint32_t index)
+{
+    if (index >= _info.frameCount)
+        return nullptr;
+
+    for (auto& slot : _ring)
+    {
+        if (slot.index == index)
+        {
+            slot.age = ++_clock;
+            return reinterpret_cast<const uint8_t*>(slot.pixels.data());
+        }
+    }
+
+    auto pixels = static_cast<size_t>(_info.width) * _info.height;
+    if (_canvas.empty() || index < _next)
+    {
+        _canvas.assign(pixels, 0);
+        _next = 0;
+    }
+
+    auto slot = std::min_element(std::begin(_ring), std::end(_ring),
+                                 [](const Slot& a, const Slot& b) { return a.age < b.age; });
+    for (; _next <= index; _next++)
+    {
+        auto& record = _records[_next];
+        auto& frame = record.frame;
+        auto left = std::min(frame.left, _info.width);
+        auto right = std::min(frame.left + frame.width, _info.width);
+        auto top = std::min(frame.top, _info.height);
+        auto bottom = std::min(frame.top + frame.height, _info.height);
+
+        if (frame.disposal == DISPOSE_PREVIOUS)
+        {
+            _saved.resize(pixels);
+            for (auto at = top * _info.width + left; at < bottom * _info.width; at += _info.width)
+                std::copy_n(_canvas.data() + at, right - left, _saved.data() + at);
+        }
+
+        if (decode(record))
+            draw(record);
+
+        if (_next == index)
+        {
+            slot->pixels.assign(_canvas.begin(), _canvas.end());
+            slot->index = index;
+            slot->age = ++_clock;
+        }
+
+        for (auto at = top * _info.width + left; at < bottom * _info.width; at += _info.width)
+        {
+            if (frame.disposal == DISPOSE_BACKGROUND)
+                std::fill_n(_canvas.data() + at, right - left, 0);
+            else if (frame.disposal == DISPOSE_PREVIOUS)
+                std::copy_n(_saved.data() + at, right - left, _canvas.data() + at);
+        }
+    }
+
+    return reinterpret_cast<const uint8_t*>(slot->pixels.data());
+}
+
+uint64_t GifImage::skipSubBlocks(uint64_t offset) const
+{
+    while (offset < _size)
+    {
+        auto length = _data[offset];
+        offset += 1 + length;
+        if (length == 0)
+            break;
+    }
+    return std::min(offset, _size);
+}
+
+bool GifImage::decode(const Record& record)
+{
+    auto minimumCodeSize = static_cast<uint32_t>(record.minimumCodeSize);
+    if (minimumCodeSize == 0 || minimumCodeSize >= MAX_CODE_SIZE)
+        return false;
+
+    // the sub-blocks are joined first, so the bit reader below never has to look for a block boundary
+    _code.clear();
+    for (auto offset = record.data; offset < _size && _data[offset] != 0;)
+    {
+        auto length = std::min<uint64_t>(_data[offset], _size - offset - 1);
+        _code.insert(_code.end(), _data + offset + 1, _data + offset + 1 + length);
+        offset += 1 + length;
+    }
+
+    auto pixels = static_cast<uint32_t>(record.frame.width * record.frame.height);
+    _indices.resize(pixels);
+    _decoded = 0;
+
+    // Each code stands for its prefix code followed by one more index. A string is written back to front, from its
+    // last index to its first, straight into place; knowing its length up front is what makes that possible.
+    uint16_t prefix[MAX_CODES];
+    uint8_t suffix[MAX_CODES];
+    uint8_t first[MAX_CODES];
+    uint16_t length[MAX_CODES];
+
+    auto clear = 1u << minimumCodeSize;
+    auto end = clear + 1;
+    for (uint32_t code = 0; code < clear; code++)
+    {
+        prefix[code] = NO_CODE;
+        suffix[code] = static_cast<uint8_t>(code);
+        first[code] = static_cast<uint8_t>(code);
+        length[code] = 1;
+    }
+
+    auto codeSize = minimumCodeSize + 1;
+    auto next = clear + 2;
+    uint32_t previous = NO_CODE;
+    uint32_t bits = 0;
+    uint32_t count = 0;
+    size_t position = 0;
+    auto code = _code.data();
+    auto available = _code.size();
+
+    while (_decoded < pixels)
+    {
+        while (count < codeSize)
+        {
+            if (position == available)
+                return _decoded != 0;
+            bits |= static_cast<uint32_t>(code[position++]) << count;
+            count += 8;
+        }
+
+        auto current = bits & ((1u << codeSize) - 1);
+        bits >>= codeSize;
+        count -= codeSize;
+
+        if (current == clear)
+        {
+            codeSize = minimumCodeSize + 1;
+            next = clear + 2;
+            previous = NO_CODE;
+            continue;
+        }
+        if (current == end)
+            break;
+
+        if (previous != NO_CODE && next < MAX_CODES)
+        {
+            // the new code is the previous string followed by the first index of the current one, which for a code
+            // that is not in the table yet is the first index of the previous string
+            if (current > next)
+                break;
+
+            prefix[next] = static_cast<uint16_t>(previous);
+            suffix[next] = current < next ? first[current] : first[previous];
+            first[next] = first[previous];
+            length[next] = static_cast<uint16_t>(length[previous] + 1);
+            next++;
+            if (next == 1u << codeSize && codeSize < MAX_CODE_SIZE)
+                codeSize++;
+        }
+        else if (current >= next)
+        {
+            break;
+        }
+
+        // a string that runs past the frame is cut at its end
+        auto stop = std::min(_decoded + length[current], pixels);
+        auto walk = current;
+        for (auto skip = _decoded + length[current] - stop; skip != 0; skip--)
+            walk = prefix[walk];
+        for (auto at = stop; at > _decoded; walk = prefix[walk])
+            _indices[--at] = suffix[walk];
+
+        _decoded = stop;
+        previous = current;
+    }
+    return true;
+}
+
+void GifImage::draw(const Record& record)
+{
+    uint32_t colors[256];
+    std::fill_n(colors, 256, OPAQUE_BLACK);
+    auto palette = record.palette != 0 ? record.palette : _globalPalette;
+    auto paletteSize = record.palette != 0 ? record.paletteSize : _globalPaletteSize;
+    if (palette != 0)
+    {
+        auto rgb = _data + palette;
+        auto entries = static_cast<uint32_t>(std::min<uint64_t>(paletteSize, (_size - palette) / 3));
+        for (uint32_t i = 0; i < entries; i++, rgb += 3)
+        {
+            colors[i] = OPAQUE_BLACK | static_cast<uint32_t>(rgb[0]) << 16 | static_cast<uint32_t>(rgb[1]) << 8 |
+                        rgb[2];
+        }
+    }
+
+    auto& frame = record.frame;
+    if (frame.left >= _info.width)
+        return;
+
+    auto width = std::min(frame.width, _info.width - frame.left);
+    auto rows = (_decoded + frame.width - 1) / frame.width;
+    for (uint32_t row = 0; row < rows; row++)
+    {
+        auto y = record.interlaced ? interlacedRow(row, frame.height) : row;
+        if (frame.top + y >= _info.height)
+            continue;
+
+        auto source = &_indices[static_cast<size_t>(row) * frame.width];
+        auto target = _canvas.data() + static_cast<size_t>(frame.top + y) * _info.width + frame.left;
+        auto count = std::min(width, _decoded - row * frame.width);
+        if (record.transparent < 0)
+        {
+            for (uint32_t x = 0; x < count; x++)
+                target[x] = colors[source[x]];
+        }
+        else
+        {
+            auto transparent = static_cast<uint8_t>(record.transparent);
+            for (uint32_t x = 0; x < count; x++)
+            {
+                if (source[x] != transparent)
+                    target[x] = colors[source[x]];
+            }
+        }
+    }
+}
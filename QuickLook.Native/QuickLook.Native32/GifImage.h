@@ -0,0 +1,118 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <vector>
+
+// Animated GIF player over the mapped file. Opening it walks the block structure once to index
+// where each frame's palette and image data are and how it is disposed of, without decoding any
+// of them. Frames are then decoded and composed one at a time on a single canvas, as they are
+// asked for, and handed out from a small ring of buffers; memory depends on the canvas size only,
+// never on the number of frames.
+class GifImage
+{
+public:
+    static constexpr uint32_t RING_SIZE = 3;
+
+    enum Disposal : uint32_t
+    {
+        DISPOSE_NONE = 0, // also "unspecified"
+        DISPOSE_KEEP = 1,
+        DISPOSE_BACKGROUND = 2, // cleared to transparent, as browsers do
+        DISPOSE_PREVIOUS = 3,
+    };
+
+    // Must match NativeGifInfo in QuickLook.Plugin/QuickLook.Plugin.ImageViewer/AnimatedImage/Providers/NativeGif.cs
+    struct Info
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t frameCount;
+        uint32_t loopCount; // 0 loops forever; 1 when the file has no loop extension
+    };
+
+    // Must match NativeGifFrame in QuickLook.Plugin/QuickLook.Plugin.ImageViewer/AnimatedImage/Providers/NativeGif.cs
+    struct Frame
+    {
+        uint32_t left;
+        uint32_t top;
+        uint32_t width;
+        uint32_t height;
+        uint32_t delay; // in milliseconds, as stored
+        uint32_t disposal;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    bool GetFrame(uint32_t index, Frame* frame) const;
+
+    // Composes frame index and returns its premultiplied BGRA pixels, width * 4 bytes a row. They stay
+    // valid until RING_SIZE - 1 other frames have been rendered. Going forward by one frame decodes
+    // just that frame; going back starts over from the first one.
+    const uint8_t* Render(uint32_t index);
+
+private:
+    struct Record
+    {
+        Frame frame;
+        uint64_t palette; // offset of the color table, 0 for the global one
+        uint32_t paletteSize; // entries
+        int32_t transparent; // index, or -1
+        bool interlaced;
+        uint8_t minimumCodeSize;
+        uint64_t data; // offset of the first data sub-block
+    };
+
+    struct Slot
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t age = 0;
+        std::vector<uint32_t> pixels;
+    };
+
+    uint64_t skipSubBlocks(uint64_t offset) const;
+    bool decode(const Record& record);
+    void draw(const Record& record);
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    uint64_t _globalPalette = 0;
+    uint32_t _globalPaletteSize = 0;
+    std::vector<Record> _records;
+
+    std::vector<uint32_t> _canvas;
+    std::vector<uint32_t> _saved; // the canvas under a frame that is disposed of by restoring it
+    std::vector<uint8_t> _indices; // of the frame being drawn
+    std::vector<uint8_t> _code; // its data sub-blocks, joined
+    uint32_t _decoded = 0; // indices the last frame had data for
+    uint32_t _next = 0; // the frame the canvas is ready for
+    Slot _ring[RING_SIZE];
+    uint32_t _clock = 0;
+};
@@ -0,0 +1,193 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "HexView.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t MIN_OFFSET_DIGITS = 8;
+    constexpr uint32_t MAX_OFFSET_DIGITS = 16;
+    constexpr uint32_t GROUP_SIZE = 8; // bytes between the wider gaps of a row
+
+    constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+    inline bool isPrintable(uint8_t byte)
+    {
+        return byte >= 0x20 && byte < 0x7F;
+    }
+}
+
+bool HexView::Open(const MappedFile::PathChar* path)
+{
+    _info = {};
+    if (!_window.Open(path))
+        return false;
+
+    _info.size = _window.Size();
+    _info.offsetDigits = MIN_OFFSET_DIGITS;
+    while (_info.offsetDigits < MAX_OFFSET_DIGITS && _info.size >> (4 * _info.offsetDigits) != 0)
+        _info.offsetDigits++;
+    return true;
+}
+
+uint32_t HexView::RowWidth(uint32_t offsetDigits, uint32_t bytesPerRow)
+{
+    // offset, two spaces, "XX " per byte with one more space between groups, a space, the characters
+    return offsetDigits + 2 + 3 * bytesPerRow + (bytesPerRow / GROUP_SIZE - 1) + 1 + bytesPerRow;
+}
+
+uint32_t HexView::Format(uint64_t firstRow, uint32_t rows, uint32_t bytesPerRow, char* text, uint32_t capacity)
+{
+    if (bytesPerRow == 0 || bytesPerRow % GROUP_SIZE != 0 || bytesPerRow > MAX_BYTES_PER_ROW)
+        return 0;
+
+    auto totalRows = (_info.size + bytesPerRow - 1) / bytesPerRow;
+    if (firstRow >= totalRows)
+        return 0;
+    if (rows > totalRows - firstRow)
+        rows = static_cast<uint32_t>(totalRows - firstRow);
+
+    auto width = RowWidth(_info.offsetDigits, bytesPerRow) + 1;
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < rows && capacity - written >= width; i++)
+    {
+        auto offset = (firstRow + i) * bytesPerRow;
+        auto count = _info.size - offset < bytesPerRow ? static_cast<uint32_t>(_info.size - offset) : bytesPerRow;
+        auto bytes = _window.View(offset, count);
+        if (bytes == nullptr)
+            break;
+
+        formatRow(offset, bytes, count, bytesPerRow, text + written);
+        written += width;
+    }
+    return written;
+}
+
+void HexView::formatRow(uint64_t offset, const uint8_t* bytes, uint32_t count, uint32_t bytesPerRow, char* text) const
+{
+    // a short last row is padded so the kernels can always convert whole rows
+    uint8_t row[MAX_BYTES_PER_ROW] = {};
+    memcpy(row, bytes, count);
+    char hex[2 * MAX_BYTES_PER_ROW];
+    ToHex(row, bytesPerRow, hex, Simd::Best());
+
+    auto out = text;
+    for (auto digit = _info.offsetDigits; digit-- > 0;)
+        *out++ = HEX_DIGITS[offset >> (4 * digit) & 0xF];
+    *out++ = ' ';
+    *out++ = ' ';
+
+    for (uint32_t i = 0; i < bytesPerRow; i++)
+    {
+        out[0] = i < count ? hex[2 * i] : ' ';
+        out[1] = i < count ? hex[2 * i + 1] : ' ';
+        out[2] = ' ';
+        out += 3;
+        if (i % GROUP_SIZE == GROUP_SIZE - 1 && i + 1 < bytesPerRow)
+            *out++ = ' ';
+    }
+    *out++ = ' ';
+
+    toPrintable(row, bytesPerRow, out, Simd::Best());
+    memset(out + count, ' ', bytesPerRow - count);
+    out[bytesPerRow] = '\n';
+}
+
+void HexView::ToHex(const uint8_t* data, size_t size, char* hex, Simd::Level level)
+{
+    size_t i = 0;
+#ifdef QL_SIMD_X86
+    // the digits are computed rather than looked up, SSE2 has no byte shuffle; AVX2 gains nothing
+    // on rows this short
+    if (level != Simd::SCALAR)
+    {
+        auto low4 = _mm_set1_epi8(0x0F);
+        auto nine = _mm_set1_epi8(9);
+        auto zero = _mm_set1_epi8('0');
+        auto letters = _mm_set1_epi8('A' - '0' - 10);
+        for (; i + 16 <= size; i += 16)
+        {
+            auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            auto high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low4);
+            auto low = _mm_and_si128(bytes, low4);
+            high = _mm_add_epi8(_mm_add_epi8(high, zero), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letters));
+            low = _mm_add_epi8(_mm_add_epi8(low, zero), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letters));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 2 * i), _mm_unpacklo_epi8(high, low));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+        }
+    }
+#endif
+#ifdef QL_SIMD_NEON
+    if (level == Simd::NEON)
+    {
+        auto digits = vld1q_u8(reinterpret_cast<const uint8_t*>(HEX_DIGITS));
+        auto low4 = vdupq_n_u8(0x0F);
+        for (; i + 16 <= size; i += 16)
+        {
+            auto bytes = vld1q_u8(data + i);
+            uint8x16x2_t pairs;
+            pairs.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(bytes, 4));
+            pairs.val[1] = vqtbl1q_u8(digits, vandq_u8(bytes, low4));
+            vst2q_u8(reinterpret_cast<uint8_t*>(hex + 2 * i), pairs);
+        }
+    }
+#endif
+    for (; i < size; i++)
+    {
+        hex[2 * i] = HEX_DIGITS[data[i] >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[data[i] & 0xF];
+    }
+}
+
+void HexView::toPrintable(const uint8_t* data, size_t size, char* text, Simd::Level level)
+{
+    size_t i = 0;
+#ifdef QL_SIMD_X86
+    if (level != Simd::SCALAR)
+    {
+        // as signed bytes everything from 0x80 up is negative and fails the first comparison
+        auto control = _mm_set1_epi8(0x1F);
+        auto del = _mm_set1_epi8(0x7F);
+        auto dot = _mm_set1_epi8('.');
+        for (; i + 16 <= size; i += 16)
+        {
+            auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            auto printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, control), _mm_cmplt_epi8(bytes, del));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(text + i),
+                             _mm_or_si128(_mm_and_si128(printable, bytes), _mm_andnot_si128(printable, dot)));
+        }
+    }
+#endif
+#ifdef QL_SIMD_NEON
+    if (level == Simd::NEON)
+    {
+        auto space = vdupq_n_u8(0x20);
+        auto del = vdupq_n_u8(0x7F);
+        auto dot = vdupq_n_u8('.');
+        for (; i + 16 <= size; i += 16)
+        {
+            auto bytes = vld1q_u8(data + i);
+            auto printable = vandq_u8(vcgeq_u8(bytes, space), vcltq_u8(bytes, del));
+            vst1q_u8(reinterpret_cast<uint8_t*>(text + i), vbslq_u8(printable, bytes, dot));
+        }
+    }
+#endif
+    for (; i < size; i++)
+        text[i] = isPrintable(data[i]) ? static_cast<char>(data[i]) : '.';
+}
@@ -0,0 +1,69 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedWindow.h"
+#include "Simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Hex dump of a file of any size for the binary viewer. The file is read through a MappedWindow,
+// and only the rows being shown are formatted, so scrolling to any place of a file costs the same
+// time and memory whatever its size. Rows are laid out like "hexdump -C":
+//
+//   0000000010  48 65 6C 6C 6F 2C 20 77  6F 72 6C 64 21 0A 00 00  Hello, world!...
+//
+// with as many offset digits as the file size needs, but at least 8.
+class HexView
+{
+public:
+    static constexpr uint32_t MAX_BYTES_PER_ROW = 64;
+
+    // Must match HexInfo in QuickLook.Plugin.BinaryViewer/NativeHexView.cs
+    struct Info
+    {
+        uint64_t size;
+        uint32_t offsetDigits;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    // Characters in one row, not counting its '\n'; bytesPerRow must be a multiple of 8 up to
+    // MAX_BYTES_PER_ROW.
+    static uint32_t RowWidth(uint32_t offsetDigits, uint32_t bytesPerRow);
+
+    // Writes up to rows rows from firstRow on as ASCII lines ending with '\n' and returns the
+    // number of characters written; rows past the end of the file or beyond capacity are left out.
+    uint32_t Format(uint64_t firstRow, uint32_t rows, uint32_t bytesPerRow, char* text, uint32_t capacity);
+
+    // Two uppercase hex digits for each byte.
+    static void ToHex(const uint8_t* data, size_t size, char* hex, Simd::Level level);
+
+private:
+    static void toPrintable(const uint8_t* data, size_t size, char* text, Simd::Level level);
+    void formatRow(uint64_t offset, const uint8_t* bytes, uint32_t count, uint32_t bytesPerRow, char* text) const;
+
+    MappedWindow _window;
+    Info _info = {};
+};
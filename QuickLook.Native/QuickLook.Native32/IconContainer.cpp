@@ -0,0 +1,894 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "IconContainer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t PNG_SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    constexpr uint8_t JP2_SIGNATURE[] = {0x00, 0x00, 0x00, 0x0C, 'j', 'P', ' ', ' '};
+    constexpr uint8_t J2K_SIGNATURE[] = {0xFF, 0x4F, 0xFF, 0x51}; // a bare codestream
+
+    // larger than any icon format can describe, and small enough that a corrupt header cannot ask for gigabytes
+    constexpr uint64_t MAX_PIXELS = 4096 * 4096;
+
+    constexpr uint32_t ICNS_HEADER_SIZE = 8;
+    constexpr uint32_t ICONDIR_SIZE = 6;
+    constexpr uint32_t ICONDIRENTRY_SIZE = 16;
+    constexpr uint16_t ICONDIR_ICO = 1;
+    constexpr uint16_t ICONDIR_CUR = 2;
+    constexpr uint32_t BITMAPINFOHEADER_SIZE = 40;
+    constexpr uint32_t BI_RGB = 0;
+    constexpr uint32_t BI_BITFIELDS = 3;
+    constexpr uint32_t RIFF_HEADER_SIZE = 12;
+    constexpr uint32_t ANIHEADER_SIZE = 36;
+    constexpr uint32_t AF_ICON = 1; // frames are .ico or .cur files rather than bare bitmaps
+    constexpr uint32_t JIFFIES_PER_SECOND = 60;
+
+    enum Kind : uint8_t
+    {
+        KIND_MONO, // 1-bit image followed by its 1-bit mask
+        KIND_ICON, // 1-bit image alone
+        KIND_PALETTE,
+        KIND_RLE,
+        KIND_MASK,
+        KIND_COMPRESSED, // PNG, JPEG 2000 or "ARGB"
+        KIND_COMPRESSED_OR_RLE, // the same, or run-length RGB in older files
+    };
+
+    struct IcnsType
+    {
+        char name[5];
+        uint16_t width;
+        uint16_t height;
+        uint8_t bitDepth;
+        Kind kind;
+    };
+
+    // https://en.wikipedia.org/wiki/Apple_Icon_Image_format
+    constexpr IcnsType ICNS_TYPES[] = {
+        {"ICON", 32, 32, 1, KIND_ICON},
+        {"ICN#", 32, 32, 1, KIND_MONO},
+        {"icm#", 16, 12, 1, KIND_MONO},
+        {"ics#", 16, 16, 1, KIND_MONO},
+        {"ich#", 48, 48, 1, KIND_MONO},
+        {"icm4", 16, 12, 4, KIND_PALETTE},
+        {"ics4", 16, 16, 4, KIND_PALETTE},
+        {"icl4", 32, 32, 4, KIND_PALETTE},
+        {"ich4", 48, 48, 4, KIND_PALETTE},
+        {"icm8", 16, 12, 8, KIND_PALETTE},
+        {"ics8", 16, 16, 8, KIND_PALETTE},
+        {"icl8", 32, 32, 8, KIND_PALETTE},
+        {"ich8", 48, 48, 8, KIND_PALETTE},
+        {"is32", 16, 16, 24, KIND_RLE},
+        {"il32", 32, 32, 24, KIND_RLE},
+        {"ih32", 48, 48, 24, KIND_RLE},
+        {"it32", 128, 128, 24, KIND_RLE},
+        {"s8mk", 16, 16, 8, KIND_MASK},
+        {"l8mk", 32, 32, 8, KIND_MASK},
+        {"h8mk", 48, 48, 8, KIND_MASK},
+        {"t8mk", 128, 128, 8, KIND_MASK},
+        {"icp4", 16, 16, 32, KIND_COMPRESSED_OR_RLE},
+        {"icp5", 32, 32, 32, KIND_COMPRESSED_OR_RLE},
+        {"icp6", 64, 64, 32, KIND_COMPRESSED},
+        {"ic07", 128, 128, 32, KIND_COMPRESSED},
+        {"ic08", 256, 256, 32, KIND_COMPRESSED},
+        {"ic09", 512, 512, 32, KIND_COMPRESSED},
+        {"ic10", 1024, 1024, 32, KIND_COMPRESSED},
+        {"ic11", 32, 32, 32, KIND_COMPRESSED},
+        {"ic12", 64, 64, 32, KIND_COMPRESSED},
+        {"ic13", 256, 256, 32, KIND_COMPRESSED},
+        {"ic14", 512, 512, 32, KIND_COMPRESSED},
+        {"ic04", 16, 16, 32, KIND_COMPRESSED},
+        {"ic05", 32, 32, 32, KIND_COMPRESSED},
+        {"icsb", 18, 18, 32, KIND_COMPRESSED},
+        {"icsB", 36, 36, 32, KIND_COMPRESSED},
+    };
+
+    // the classic Mac OS 16-colour palette, as 0xRRGGBB
+    constexpr uint32_t MAC_COLORS_4[] = {0xFFFFFF, 0xFCF305, 0xFF6402, 0xDD0806, 0xF20884, 0x4600A5,
+                                         0x0000D4, 0x02ABEA, 0x1FB714, 0x006411, 0x562C05, 0x90713A,
+                                         0xC0C0C0, 0x808080, 0x404040, 0x000000};
+
+    // levels of the red, green, blue and gray ramps that follow the colour cube of the 256-colour palette
+    constexpr uint8_t MAC_RAMP[] = {0xEE, 0xDD, 0xBB, 0xAA, 0x88, 0x77, 0x55, 0x44, 0x22, 0x11};
+
+    inline uint32_t be32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+               static_cast<uint32_t>(p[2]) << 8 | p[3];
+    }
+
+    inline uint32_t le32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[3]) << 24 | static_cast<uint32_t>(p[2]) << 16 |
+               static_cast<uint32_t>(p[1]) << 8 | p[0];
+    }
+
+    inline uint16_t le16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[1] << 8 | p[0]);
+    }
+
+    inline uint32_t fourcc(const char (&name)[5])
+    {
+        return be32(reinterpret_cast<const uint8_t*>(name));
+    }
+
+    template <size_t N>
+    inline bool startsWith(const uint8_t* data, uint64_t size, const uint8_t (&signature)[N])
+    {
+        return size >= N && memcmp(data, signature, N) == 0;
+    }
+
+    // the 256-colour palette is a 6 x 6 x 6 cube from white down, without black, then ten-step ramps of red,
+    // green, blue and gray, then black
+    uint32_t macColor8(uint8_t index)
+    {
+        if (index < 215)
+        {
+            auto r = 0xFFu - 0x33u * (index / 36);
+            auto g = 0xFFu - 0x33u * (index / 6 % 6);
+            auto b = 0xFFu - 0x33u * (index % 6);
+            return r << 16 | g << 8 | b;
+        }
+        if (index == 255)
+            return 0;
+
+        auto level = static_cast<uint32_t>(MAC_RAMP[(index - 215) % 10]);
+        switch ((index - 215) / 10)
+        {
+        case 0:
+            return level << 16;
+        case 1:
+            return level << 8;
+        case 2:
+            return level;
+        default:
+            return level << 16 | level << 8 | level;
+        }
+    }
+
+    // x / 255, rounded; exact for any product of two bytes
+    inline uint32_t div255(uint32_t x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    inline uint32_t premultiply(uint32_t rgb, uint32_t alpha)
+    {
+        if (alpha == 255)
+            return 0xFF000000 | rgb;
+
+        return alpha << 24 | div255((rgb >> 16 & 0xFF) * alpha) << 16 | div255((rgb >> 8 & 0xFF) * alpha) << 8 |
+               div255((rgb & 0xFF) * alpha);
+    }
+
+    // Expands run-length data into count bytes of plane: a control byte below 0x80 is followed by that many
+    // plus one literal bytes, one of 0x80 or more repeats the next byte that many minus 125 times. Runs are
+    // clipped to the plane; whatever the data does not reach is left as it was.
+    void unpack(const uint8_t* data, uint32_t size, uint32_t* position, uint8_t* plane, uint32_t count)
+    {
+        auto pos = *position;
+        for (uint32_t filled = 0; filled < count && pos < size;)
+        {
+            auto control = data[pos++];
+            if (control & 0x80)
+            {
+                if (pos >= size)
+                    break;
+
+                auto run = std::min(control - 125u, count - filled);
+                memset(plane + filled, data[pos++], run);
+                filled += run;
+            }
+            else
+            {
+                auto length = std::min(control + 1u, size - pos);
+                auto run = std::min(length, count - filled);
+                memcpy(plane + filled, data + pos, run);
+                pos += length;
+                filled += run;
+            }
+        }
+        *position = pos;
+    }
+
+    struct Field
+    {
+        uint32_t mask;
+        uint32_t shift;
+        uint32_t max;
+    };
+
+    Field field(uint32_t mask)
+    {
+        Field result = {mask, 0, 0};
+        if (mask == 0)
+            return result;
+
+        while ((mask & 1) == 0)
+        {
+            mask >>= 1;
+            result.shift++;
+        }
+        result.max = mask;
+        return result;
+    }
+
+    inline uint32_t extract(uint32_t value, const Field& field)
+    {
+        if (field.max == 0)
+            return 0;
+
+        uint64_t sample = (value & field.mask) >> field.shift;
+        return field.max == 255 ? static_cast<uint32_t>(sample)
+                                : static_cast<uint32_t>((sample * 255 + field.max / 2) / field.max);
+    }
+}
+
+bool IconContainer::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool IconContainer::Open(const uint8_t* data, size_t size)
+{
+    if (data == nullptr)
+        return false;
+
+    _copy.assign(data, data + size);
+    return Parse(_copy.data(), _copy.size());
+}
+
+bool IconContainer::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _records.clear();
+    _steps.clear();
+
+    if (_data == nullptr || _size < ICONDIR_SIZE)
+        return false;
+
+    auto ok = false;
+    if (_size >= ICNS_HEADER_SIZE && memcmp(_data, "icns", 4) == 0)
+    {
+        ok = parseIcns();
+    }
+    else if (_size >= RIFF_HEADER_SIZE && memcmp(_data, "RIFF", 4) == 0 && memcmp(_data + 8, "ACON", 4) == 0)
+    {
+        ok = parseAni();
+    }
+    else if (le16(_data) == 0 && (le16(_data + 2) == ICONDIR_ICO || le16(_data + 2) == ICONDIR_CUR))
+    {
+        _info.format = le16(_data + 2) == ICONDIR_CUR ? FORMAT_CUR : FORMAT_ICO;
+        _info.iconCount = 1;
+        parseIco(0, _size, 0);
+        ok = true;
+    }
+
+    if (!ok || _records.empty())
+        return false;
+
+    if (_steps.empty())
+        _steps.push_back({0, 0});
+
+    _info.entryCount = static_cast<uint32_t>(_records.size());
+    _info.stepCount = static_cast<uint32_t>(_steps.size());
+    return true;
+}
+
+bool IconContainer::parseIcns()
+{
+    _info.format = FORMAT_ICNS;
+    _info.iconCount = 1;
+
+    // the length in the header is often wrong in files written by hand; the elements are what counts
+    struct Element
+    {
+        const IcnsType* type;
+        uint64_t offset;
+        uint32_t size;
+    };
+    std::vector<Element> elements;
+
+    for (uint64_t offset = ICNS_HEADER_SIZE; _size - offset >= ICNS_HEADER_SIZE;)
+    {
+        auto code = be32(_data + offset);
+        auto length = be32(_data + offset + 4);
+        if (length < ICNS_HEADER_SIZE || length > _size - offset)
+            break;
+
+        for (auto& type : ICNS_TYPES)
+        {
+            if (fourcc(type.name) == code)
+            {
+                elements.push_back({&type, offset + ICNS_HEADER_SIZE, length - ICNS_HEADER_SIZE});
+                break;
+            }
+        }
+        offset += length;
+    }
+
+    auto findMask = [&elements](uint32_t width, uint32_t height, Kind kind) -> const Element*
+    {
+        for (auto& element : elements)
+            if (element.type->kind == kind && element.type->width == width && element.type->height == height)
+                return &element;
+        return nullptr;
+    };
+
+    for (auto& element : elements)
+    {
+        auto& type = *element.type;
+        if (type.kind == KIND_MASK)
+            continue;
+
+        Record record = {};
+        record.entry.width = type.width;
+        record.entry.height = type.height;
+        record.entry.bitDepth = type.bitDepth;
+        record.entry.type = fourcc(type.name);
+        record.offset = element.offset;
+        record.size = element.size;
+
+        auto body = _data + element.offset;
+        switch (type.kind)
+        {
+        case KIND_MONO:
+        case KIND_ICON:
+        case KIND_PALETTE:
+            record.entry.encoding = ENCODING_PALETTE;
+            break;
+        case KIND_RLE:
+            record.entry.encoding = ENCODING_RLE;
+            break;
+        default:
+            if (startsWith(body, element.size, PNG_SIGNATURE))
+            {
+                record.entry.encoding = ENCODING_PNG;
+                // the real size is in IHDR, which comes first
+                if (element.size >= 24)
+                {
+                    record.entry.width = be32(body + 16);
+                    record.entry.height = be32(body + 20);
+                }
+            }
+            else if (startsWith(body, element.size, JP2_SIGNATURE) || startsWith(body, element.size, J2K_SIGNATURE))
+            {
+                record.entry.encoding = ENCODING_JPEG2000;
+            }
+            else if (element.size >= 4 && memcmp(body, "ARGB", 4) == 0)
+            {
+                record.entry.encoding = ENCODING_PACKBITS;
+            }
+            else if (type.kind == KIND_COMPRESSED_OR_RLE)
+            {
+                record.entry.encoding = ENCODING_RLE;
+                record.entry.bitDepth = 24;
+            }
+            else
+            {
+                continue;
+            }
+            break;
+        }
+
+        if (record.entry.width == 0 || record.entry.height == 0 ||
+            static_cast<uint64_t>(record.entry.width) * record.entry.height > MAX_PIXELS)
+            continue;
+
+        // the colour types take their transparency from the 8-bit mask of their size, or else from the 1-bit
+        // mask that is the second half of the "#" entry
+        if (type.kind == KIND_MONO)
+        {
+            record.maskOffset = record.offset;
+            record.maskSize = record.size;
+            record.maskDepth = 1;
+        }
+        else if (type.kind == KIND_PALETTE || record.entry.encoding == ENCODING_RLE)
+        {
+            if (auto mask = findMask(type.width, type.height, KIND_MASK))
+            {
+                record.maskOffset = mask->offset;
+                record.maskSize = mask->size;
+                record.maskDepth = 8;
+            }
+            else if (auto mono = findMask(type.width, type.height, KIND_MONO))
+            {
+                record.maskOffset = mono->offset;
+                record.maskSize = mono->size;
+                record.maskDepth = 1;
+            }
+        }
+
+        _records.push_back(record);
+    }
+    return true;
+}
+
+void IconContainer::parseIco(uint64_t offset, uint64_t size, uint32_t icon)
+{
+    if (size < ICONDIR_SIZE)
+        return;
+
+    auto base = _data + offset;
+    auto cursor = le16(base + 2) == ICONDIR_CUR;
+    auto count = le16(base + 4);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        auto position = ICONDIR_SIZE + static_cast<uint64_t>(i) * ICONDIRENTRY_SIZE;
+        if (position + ICONDIRENTRY_SIZE > size)
+            break;
+
+        auto directory = base + position;
+        auto length = le32(directory + 8);
+        auto start = le32(directory + 12);
+        if (start >= size || length == 0)
+            continue;
+
+        Record record = {};
+        record.offset = offset + start;
+        // many writers get the length slightly wrong; it is enough that the entry starts inside the file
+        record.size = static_cast<uint32_t>(std::min<uint64_t>(length, size - start));
+        record.entry.icon = icon;
+        if (cursor)
+        {
+            record.entry.hotspotX = le16(directory + 4);
+            record.entry.hotspotY = le16(directory + 6);
+        }
+
+        auto body = _data + record.offset;
+        if (startsWith(body, record.size, PNG_SIGNATURE))
+        {
+            if (record.size < 24)
+                continue;
+
+            // the real size is in IHDR, which comes first; PNG entries are always stored as 32-bit
+            record.entry.encoding = ENCODING_PNG;
+            record.entry.width = be32(body + 16);
+            record.entry.height = be32(body + 20);
+            record.entry.bitDepth = 32;
+        }
+        else
+        {
+            if (record.size < BITMAPINFOHEADER_SIZE || le32(body) < BITMAPINFOHEADER_SIZE)
+                continue;
+
+            // the height covers the colour bitmap and the AND mask below it
+            auto width = static_cast<int32_t>(le32(body + 4));
+            auto height = static_cast<int32_t>(le32(body + 8));
+            record.entry.encoding = ENCODING_DIB;
+            record.entry.width = width > 0 ? static_cast<uint32_t>(width) : 0;
+            record.entry.height = height > 0 ? static_cast<uint32_t>(height) / 2 : 0;
+            record.entry.bitDepth = le16(body + 14);
+        }
+
+        if (record.entry.width == 0 || record.entry.height == 0 ||
+            static_cast<uint64_t>(record.entry.width) * record.entry.height > MAX_PIXELS)
+            continue;
+
+        _records.push_back(record);
+    }
+}
+
+bool IconContainer::parseAni()
+{
+    _info.format = FORMAT_ANI;
+
+    uint32_t stepCount = 0;
+    uint32_t displayRate = 0;
+    auto flags = 0u;
+    uint64_t rates = 0;
+    uint64_t sequence = 0;
+
+    auto end = std::min<uint64_t>(_size, static_cast<uint64_t>(le32(_data + 4)) + 8);
+    for (uint64_t offset = RIFF_HEADER_SIZE; offset + 8 <= end;)
+    {
+        auto id = _data + offset;
+        auto length = le32(_data + offset + 4);
+        auto body = offset + 8;
+        if (length > end - body)
+            break;
+
+        if (memcmp(id, "anih", 4) == 0 && length >= ANIHEADER_SIZE)
+        {
+            auto header = _data + body;
+            stepCount = le32(header + 8);
+            displayRate = le32(header + 28);
+            flags = le32(header + 32);
+        }
+        else if (memcmp(id, "rate", 4) == 0)
+        {
+            rates = body;
+        }
+        else if (memcmp(id, "seq ", 4) == 0)
+        {
+            sequence = body;
+        }
+        else if (memcmp(id, "LIST", 4) == 0 && length >= 4 && memcmp(_data + body, "fram", 4) == 0)
+        {
+            for (auto frame = body + 4; frame + 8 <= body + length;)
+            {
+                auto frameLength = le32(_data + frame + 4);
+                if (frameLength > body + length - frame - 8)
+                    break;
+
+                // a frame that cannot be read keeps its place, so the sequence still points at the right ones
+                if (memcmp(_data + frame, "icon", 4) == 0)
+                    parseIco(frame + 8, frameLength, _info.iconCount++);
+
+                frame += 8 + frameLength + (frameLength & 1);
+            }
+        }
+
+        // chunks are padded to an even length
+        offset = body + length + (length & 1);
+    }
+
+    if ((flags & AF_ICON) == 0 || _info.iconCount == 0)
+        return false;
+
+    // rate and seq hold one entry per step, when they are there and as long as the header says
+    if (stepCount == 0)
+        stepCount = _info.iconCount;
+    auto fits = [this, stepCount](uint64_t chunk)
+    { return chunk != 0 && le32(_data + chunk - 4) >= static_cast<uint64_t>(stepCount) * 4; };
+    if (!fits(rates))
+        rates = 0;
+    if (!fits(sequence))
+        sequence = 0;
+
+    for (uint32_t i = 0; i < stepCount; i++)
+    {
+        auto icon = sequence != 0 ? le32(_data + sequence + i * 4) : i;
+        if (icon >= _info.iconCount)
+            continue;
+
+        // in jiffies; a step of none is shown for one
+        auto jiffies = std::max(rates != 0 ? le32(_data + rates + i * 4) : displayRate, 1u);
+        _steps.push_back({icon, static_cast<uint32_t>(std::min<uint64_t>(jiffies * 1000ull / JIFFIES_PER_SECOND,
+                                                                          UINT32_MAX))});
+    }
+    return true;
+}
+
+bool IconContainer::GetEntry(uint32_t index, Entry* entry) const
+{
+    if (index >= _records.size())
+        return false;
+
+    *entry = _records[index].entry;
+    return true;
+}
+
+bool IconContainer::GetStep(uint32_t index, Step* step) const
+{
+    if (index >= _steps.size())
+        return false;
+
+    *step = _steps[index];
+    return true;
+}
+
+uint32_t IconContainer::Select(uint32_t icon, uint32_t size) const
+{
+    if (size == 0)
+        size = UINT32_MAX;
+
+    auto better = [size](const Entry& a, const Entry& b)
+    {
+        auto decodableA = a.encoding != ENCODING_JPEG2000;
+        auto decodableB = b.encoding != ENCODING_JPEG2000;
+        if (decodableA != decodableB)
+            return decodableA;
+
+        auto edgeA = std::max(a.width, a.height);
+        auto edgeB = std::max(b.width, b.height);
+        auto fitsA = edgeA >= size;
+        auto fitsB = edgeB >= size;
+        if (fitsA != fitsB)
+            return fitsA;
+        if (edgeA != edgeB)
+            return fitsA ? edgeA < edgeB : edgeA > edgeB;
+
+        return a.bitDepth > b.bitDepth;
+    };
+
+    auto best = UINT32_MAX;
+    for (uint32_t i = 0; i < _records.size(); i++)
+    {
+        auto& entry = _records[i].entry;
+        if (entry.icon == icon && (best == UINT32_MAX || better(entry, _records[best].entry)))
+            best = i;
+    }
+    return best;
+}
+
+bool IconContainer::GetData(uint32_t index, const uint8_t** data, uint32_t* size) const
+{
+    if (index >= _records.size())
+        return false;
+
+    *data = _data + _records[index].offset;
+    *size = _records[index].size;
+    return true;
+}
+
+const uint8_t* IconContainer::Decode(uint32_t index)
+{
+    if (index >= _records.size())
+        return nullptr;
+
+    auto& record = _records[index];
+    auto& entry = record.entry;
+    switch (entry.encoding)
+    {
+    case ENCODING_PNG:
+    {
+        if (!_png.Parse(_data + record.offset, record.size, true) || _png.GetInfo().width != entry.width ||
+            _png.GetInfo().height != entry.height)
+            return nullptr;
+        return _png.Render(0);
+    }
+    case ENCODING_DIB:
+        _pixels.assign(static_cast<size_t>(entry.width) * entry.height, 0);
+        if (!decodeDib(record))
+            return nullptr;
+        break;
+    case ENCODING_RLE:
+        _pixels.assign(static_cast<size_t>(entry.width) * entry.height, 0);
+        decodeRle(record);
+        break;
+    case ENCODING_PACKBITS:
+        _pixels.assign(static_cast<size_t>(entry.width) * entry.height, 0);
+        decodePackBits(record);
+        break;
+    case ENCODING_PALETTE:
+        _pixels.assign(static_cast<size_t>(entry.width) * entry.height, 0);
+        if (!decodePalette(record))
+            return nullptr;
+        break;
+    default:
+        return nullptr;
+    }
+    return reinterpret_cast<const uint8_t*>(_pixels.data());
+}
+
+bool IconContainer::decodeDib(const Record& record)
+{
+    auto body = _data + record.offset;
+    auto width = record.entry.width;
+    auto height = record.entry.height;
+    auto bitDepth = record.entry.bitDepth;
+    auto headerSize = le32(body);
+    auto compression = le32(body + 16);
+    auto colorsUsed = le32(body + 32);
+
+    if ((bitDepth != 1 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16 && bitDepth != 24 && bitDepth != 32) ||
+        (compression != BI_RGB && !(compression == BI_BITFIELDS && (bitDepth == 16 || bitDepth == 32))) ||
+        headerSize > record.size)
+        return false;
+
+    // the masks of BI_BITFIELDS follow a plain BITMAPINFOHEADER and are part of any larger one
+    uint64_t position = headerSize;
+    Field red = field(0x7C00), green = field(0x03E0), blue = field(0x001F);
+    if (bitDepth == 32)
+    {
+        red = field(0xFF0000);
+        green = field(0xFF00);
+        blue = field(0xFF);
+    }
+    if (compression == BI_BITFIELDS)
+    {
+        if (record.size < BITMAPINFOHEADER_SIZE + 12)
+            return false;
+
+        red = field(le32(body + BITMAPINFOHEADER_SIZE));
+        green = field(le32(body + BITMAPINFOHEADER_SIZE + 4));
+        blue = field(le32(body + BITMAPINFOHEADER_SIZE + 8));
+        if (headerSize == BITMAPINFOHEADER_SIZE)
+            position += 12;
+    }
+
+    uint32_t palette[256] = {};
+    if (bitDepth <= 8)
+    {
+        auto colors = colorsUsed != 0 && colorsUsed < (1u << bitDepth) ? colorsUsed : 1u << bitDepth;
+        if (record.size - position < colors * 4ull)
+            return false;
+
+        for (uint32_t i = 0; i < colors; i++)
+            palette[i] = le32(body + position + i * 4) & 0xFFFFFF;
+        position += colors * 4ull;
+    }
+
+    auto stride = (static_cast<uint64_t>(width) * bitDepth + 31) / 32 * 4;
+    auto maskStride = (static_cast<uint64_t>(width) + 31) / 32 * 4;
+    if (record.size - position < stride * height)
+        return false;
+
+    // the AND mask is left off by some writers of 32-bit icons, which need none
+    auto colors = body + position;
+    auto mask = record.size - position - stride * height >= maskStride * height ? colors + stride * height : nullptr;
+    auto hasAlpha = false;
+
+    // rows are stored bottom up
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto row = colors + (height - 1 - y) * stride;
+        auto target = _pixels.data() + static_cast<size_t>(y) * width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint32_t pixel;
+            switch (bitDepth)
+            {
+            case 1:
+                pixel = 0xFF000000 | palette[row[x >> 3] >> (7 - (x & 7)) & 1];
+                break;
+            case 4:
+                pixel = 0xFF000000 | palette[row[x >> 1] >> ((x & 1) != 0 ? 0 : 4) & 0xF];
+                break;
+            case 8:
+                pixel = 0xFF000000 | palette[row[x]];
+                break;
+            case 16:
+            {
+                auto value = le16(row + x * 2);
+                pixel = 0xFF000000 | extract(value, red) << 16 | extract(value, green) << 8 | extract(value, blue);
+                break;
+            }
+            case 24:
+                pixel = 0xFF000000 | static_cast<uint32_t>(row[x * 3 + 2]) << 16 | row[x * 3 + 1] << 8 | row[x * 3];
+                break;
+            default:
+            {
+                auto value = le32(row + x * 4);
+                pixel = (value & 0xFF000000) | extract(value, red) << 16 | extract(value, green) << 8 |
+                        extract(value, blue);
+                hasAlpha |= (value & 0xFF000000) != 0;
+                break;
+            }
+            }
+            target[x] = pixel;
+        }
+    }
+
+    // 32-bit pixels carry their own alpha, unless every one of them is 0, as in icons from before alpha was used
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto row = mask != nullptr ? mask + (height - 1 - y) * maskStride : nullptr;
+        auto target = _pixels.data() + static_cast<size_t>(y) * width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            auto alpha = target[x] >> 24;
+            if (bitDepth != 32 || !hasAlpha)
+                alpha = row != nullptr && (row[x >> 3] >> (7 - (x & 7)) & 1) != 0 ? 0 : 255;
+            target[x] = premultiply(target[x] & 0xFFFFFF, alpha);
+        }
+    }
+    return true;
+}
+
+void IconContainer::decodeRle(const Record& record)
+{
+    auto body = _data + record.offset;
+    auto count = record.entry.width * record.entry.height;
+
+    if (record.size >= count * 4ull)
+    {
+        // stored without compression, as 0RGB
+        for (uint32_t i = 0; i < count; i++)
+            _pixels[i] = 0xFF000000 | be32(body + i * 4);
+    }
+    else
+    {
+        // Some readers skip four bytes here when the image is at least 128 pixels wide, others when those
+        // bytes are all zero. All it32 entries from Apple start with four zero bytes and no smaller ones do,
+        // and smaller ones could begin with pixels that are zero, so they are skipped for it32 only.
+        uint32_t position = record.entry.type == fourcc("it32") ? 4 : 0;
+        _planes.assign(count * 3ull, 0);
+        for (uint32_t channel = 0; channel < 3; channel++)
+            unpack(body, record.size, &position, _planes.data() + channel * static_cast<size_t>(count), count);
+
+        auto r = _planes.data();
+        auto g = r + count;
+        auto b = g + count;
+        for (uint32_t i = 0; i < count; i++)
+            _pixels[i] = 0xFF000000 | static_cast<uint32_t>(r[i]) << 16 | g[i] << 8 | b[i];
+    }
+    applyMask(record);
+}
+
+void IconContainer::decodePackBits(const Record& record)
+{
+    auto count = record.entry.width * record.entry.height;
+    uint32_t position = 4; // past "ARGB"
+    _planes.assign(count * 4ull, 0);
+    for (uint32_t channel = 0; channel < 4; channel++)
+        unpack(_data + record.offset, record.size, &position, _planes.data() + channel * static_cast<size_t>(count),
+               count);
+
+    auto a = _planes.data();
+    auto r = a + count;
+    auto g = r + count;
+    auto b = g + count;
+    for (uint32_t i = 0; i < count; i++)
+        _pixels[i] = premultiply(static_cast<uint32_t>(r[i]) << 16 | g[i] << 8 | b[i], a[i]);
+}
+
+bool IconContainer::decodePalette(const Record& record)
+{
+    auto body = _data + record.offset;
+    auto count = record.entry.width * record.entry.height;
+    auto bitDepth = record.entry.bitDepth;
+    if (record.size < (static_cast<uint64_t>(count) * bitDepth + 7) / 8)
+        return false;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        switch (bitDepth)
+        {
+        case 1:
+            _pixels[i] = (body[i >> 3] >> (7 - (i & 7)) & 1) != 0 ? 0xFF000000 : 0xFFFFFFFF;
+            break;
+        case 4:
+            _pixels[i] = 0xFF000000 | MAC_COLORS_4[body[i >> 1] >> ((i & 1) != 0 ? 0 : 4) & 0xF];
+            break;
+        default:
+            _pixels[i] = 0xFF000000 | macColor8(body[i]);
+            break;
+        }
+    }
+    applyMask(record);
+    return true;
+}
+
+void IconContainer::applyMask(const Record& record)
+{
+    if (record.maskOffset == 0)
+        return;
+
+    auto mask = _data + record.maskOffset;
+    auto count = record.entry.width * record.entry.height;
+    if (record.maskDepth == 8)
+    {
+        if (record.maskSize < count)
+            return;
+
+        for (uint32_t i = 0; i < count; i++)
+            _pixels[i] = premultiply(_pixels[i] & 0xFFFFFF, mask[i]);
+    }
+    else
+    {
+        // the mask is the second half of the "#" entry
+        auto bytes = (count + 7) / 8;
+        if (record.maskSize < bytes * 2)
+            return;
+
+        mask += bytes;
+        for (uint32_t i = 0; i < count; i++)
+            if ((mask[i >> 3] >> (7 - (i & 7)) & 1) == 0)
+                _pixels[i] = 0;
+    }
+}
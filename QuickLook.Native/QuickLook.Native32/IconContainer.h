@@ -0,0 +1,138 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "ApngImage.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <vector>
+
+// Index over the entries of an icon container: an Apple .icns, a Windows .ico or .cur, or an animated .ani
+// cursor, whose frames are .ico or .cur files of their own. Opening it walks the headers once and records the
+// type, size and place of every entry without decoding any of them. The caller picks the one entry that best
+// fits the size it is going to be drawn at, and only that one is decoded.
+class IconContainer
+{
+public:
+    enum Format : uint32_t
+    {
+        FORMAT_ICNS = 1,
+        FORMAT_ICO = 2,
+        FORMAT_CUR = 3,
+        FORMAT_ANI = 4,
+    };
+
+    enum Encoding : uint32_t
+    {
+        ENCODING_PNG = 0,
+        ENCODING_JPEG2000 = 1, // indexed, but left to the caller to decode
+        ENCODING_DIB = 2, // ICO and CUR bitmaps with their AND mask
+        ENCODING_RLE = 3, // ICNS is32, il32, ih32 and it32: run-length RGB planes, masked by the matching 8-bit mask
+        ENCODING_PACKBITS = 4, // ICNS "ARGB": PackBits alpha, red, green and blue planes
+        ENCODING_PALETTE = 5, // ICNS 1, 4 and 8-bit types in the classic Mac palettes
+    };
+
+    // Must match NativeIconInfo in QuickLook.Common/Helpers/NativeIconContainer.cs
+    struct Info
+    {
+        uint32_t format;
+        uint32_t entryCount;
+        uint32_t iconCount; // frames of an animated cursor, 1 otherwise
+        uint32_t stepCount; // 1 unless animated
+    };
+
+    // Must match IconContainerEntry in QuickLook.Common/Helpers/NativeIconContainer.cs
+    struct Entry
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bitDepth;
+        uint32_t encoding;
+        uint32_t icon; // which frame of an animated cursor it belongs to
+        uint32_t type; // the ICNS OSType, first character in the high byte; 0 for the others
+        uint32_t hotspotX; // cursors only
+        uint32_t hotspotY;
+    };
+
+    // Must match NativeIconStep in QuickLook.Common/Helpers/NativeIconContainer.cs
+    struct Step
+    {
+        uint32_t icon;
+        uint32_t delay; // in milliseconds
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is copied
+    bool Open(const uint8_t* data, size_t size);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    bool GetEntry(uint32_t index, Entry* entry) const;
+    bool GetStep(uint32_t index, Step* step) const;
+
+    // The entry of icon to draw at size pixels across: the smallest one at least that large, or the largest one
+    // if none is, preferring entries that Decode can do and deeper colour among equals. A size of 0 asks for the
+    // largest. Returns UINT32_MAX if the icon has no entries.
+    uint32_t Select(uint32_t icon, uint32_t size) const;
+
+    // The undecoded bytes of an entry, pointing into the container.
+    bool GetData(uint32_t index, const uint8_t** data, uint32_t* size) const;
+
+    // Decodes an entry and returns its premultiplied BGRA pixels, width * 4 bytes a row, valid until the next
+    // call. Returns nullptr for JPEG 2000 and for entries that are too damaged to draw.
+    const uint8_t* Decode(uint32_t index);
+
+private:
+    struct Record
+    {
+        Entry entry;
+        uint64_t offset;
+        uint32_t size;
+        uint64_t maskOffset; // of an ICNS mask entry; 0 if there is none
+        uint32_t maskSize;
+        uint32_t maskDepth; // 8, or 1 for the second half of a "#" entry
+    };
+
+    bool parseIcns();
+    void parseIco(uint64_t offset, uint64_t size, uint32_t icon);
+    bool parseAni();
+
+    bool decodeDib(const Record& record);
+    void decodeRle(const Record& record);
+    bool decodePalette(const Record& record);
+    void decodePackBits(const Record& record);
+    void applyMask(const Record& record);
+
+    MappedFile _file;
+    std::vector<uint8_t> _copy; // of a container in memory
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    std::vector<Record> _records;
+    std::vector<Step> _steps;
+
+    std::vector<uint32_t> _pixels;
+    std::vector<uint8_t> _planes; // of a run-length or PackBits entry, one after another
+    ApngImage _png;
+};
@@ -0,0 +1,287 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stdafx.h"
+#include "ImageCache.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ImageCache::Entry
+{
+    std::wstring name;
+    ULONGLONG fileSize;
+    FILETIME lastWriteTime;
+    Image image;
+    ULONGLONG capacity;
+    // one for whoever reserved it until it is committed, then one for the cache while it is listed,
+    // plus one per Acquire
+    LONG references;
+    std::list<Entry*>::iterator position;
+};
+
+namespace
+{
+    // a pooled buffer is taken for an image that fills at least three quarters of it
+    constexpr ULONGLONG POOL_SLACK_DIVISOR = 3;
+    constexpr size_t MAX_POOLED_BUFFERS = 8;
+
+    struct Buffer
+    {
+        PBYTE data;
+        ULONGLONG capacity;
+    };
+
+    SRWLOCK lock = SRWLOCK_INIT;
+    ULONGLONG budget = ImageCache::DEFAULT_BUDGET;
+    // listed entries, reservations, entries evicted while still pinned and the pool
+    ULONGLONG usedBytes = 0;
+
+    std::list<ImageCache::Entry*> recent; // most recently used first
+    std::unordered_map<std::wstring, ImageCache::Entry*> entries;
+    std::vector<Buffer> pool;
+
+    volatile LONG64 hits = 0;
+    volatile LONG64 misses = 0;
+    volatile LONG64 evictions = 0;
+
+    bool getFileStamp(PCWCHAR path, ULONGLONG* size, FILETIME* lastWriteTime)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExW(path, GetFileExInfoStandard, &data) ||
+            (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            return false;
+
+        *size = static_cast<ULONGLONG>(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+        *lastWriteTime = data.ftLastWriteTime;
+        return true;
+    }
+
+    std::wstring nameOf(PCWCHAR path, const ImageCache::Key* key)
+    {
+        std::wstring name = path;
+        name += L'|';
+        if (key->colorProfile != nullptr)
+            name += key->colorProfile;
+        CharLowerBuffW(&name[0], static_cast<DWORD>(name.size()));
+        name += L'|' + std::to_wstring(key->kind) + L'|' + std::to_wstring(key->frame) + L'|' +
+            std::to_wstring(key->width) + L'|' + std::to_wstring(key->height) + L'|' +
+            std::to_wstring(key->dpiX) + L'|' + std::to_wstring(key->dpiY);
+        return name;
+    }
+
+    // called with the lock held, like the private helpers
+
+    void freeBuffer(PBYTE data, ULONGLONG capacity)
+    {
+        VirtualFree(data, 0, MEM_RELEASE);
+        usedBytes -= capacity;
+    }
+
+    void unlist(ImageCache::Entry* entry)
+    {
+        entries.erase(entry->name);
+        recent.erase(entry->position);
+    }
+}
+
+void ImageCache::SetBudget(ULONGLONG bytes)
+{
+    AcquireSRWLockExclusive(&lock);
+    budget = bytes;
+    makeRoom(0);
+    ReleaseSRWLockExclusive(&lock);
+}
+
+ImageCache::Entry* ImageCache::Acquire(PCWCHAR path, const Key* key, Image* image)
+{
+    ULONGLONG fileSize;
+    FILETIME lastWriteTime;
+    if (path == nullptr || key == nullptr || image == nullptr || !getFileStamp(path, &fileSize, &lastWriteTime))
+        return nullptr;
+
+    auto name = nameOf(path, key);
+    Entry* found = nullptr;
+
+    AcquireSRWLockExclusive(&lock);
+    auto it = entries.find(name);
+    if (it != entries.end())
+    {
+        auto entry = it->second;
+        if (entry->fileSize == fileSize && CompareFileTime(&entry->lastWriteTime, &lastWriteTime) == 0)
+        {
+            recent.splice(recent.begin(), recent, entry->position);
+            entry->references++;
+            *image = entry->image;
+            found = entry;
+        }
+        else
+        {
+            // the file was written since it was decoded
+            unlist(entry);
+            if (--entry->references == 0)
+                recycle(entry);
+        }
+    }
+    ReleaseSRWLockExclusive(&lock);
+
+    InterlockedIncrement64(found != nullptr ? &hits : &misses);
+    return found;
+}
+
+void ImageCache::Release(Entry* entry)
+{
+    if (entry == nullptr)
+        return;
+
+    AcquireSRWLockExclusive(&lock);
+    if (--entry->references == 0)
+        recycle(entry);
+    ReleaseSRWLockExclusive(&lock);
+}
+
+ImageCache::Entry* ImageCache::Reserve(PCWCHAR path, const Key* key, Image* image)
+{
+    if (path == nullptr || key == nullptr || image == nullptr || image->width == 0 || image->height == 0 ||
+        image->stride == 0)
+        return nullptr;
+
+    ULONGLONG fileSize;
+    FILETIME lastWriteTime;
+    if (!getFileStamp(path, &fileSize, &lastWriteTime))
+        return nullptr;
+
+    auto bytes = static_cast<ULONGLONG>(image->height) * image->stride;
+    ULONGLONG capacity = 0;
+
+    AcquireSRWLockExclusive(&lock);
+    auto pixels = takeBuffer(bytes, &capacity);
+    ReleaseSRWLockExclusive(&lock);
+    if (pixels == nullptr)
+        return nullptr;
+
+    image->pixels = pixels;
+    return new Entry{nameOf(path, key), fileSize, lastWriteTime, *image, capacity, 1, {}};
+}
+
+void ImageCache::Commit(Entry* entry, bool keep)
+{
+    if (entry == nullptr)
+        return;
+
+    AcquireSRWLockExclusive(&lock);
+    if (keep)
+    {
+        // the caller's reference becomes the cache's
+        auto it = entries.find(entry->name);
+        if (it != entries.end())
+        {
+            auto previous = it->second;
+            unlist(previous);
+            if (--previous->references == 0)
+                recycle(previous);
+        }
+
+        recent.push_front(entry);
+        entry->position = recent.begin();
+        entries.emplace(entry->name, entry);
+    }
+    else if (--entry->references == 0)
+    {
+        recycle(entry);
+    }
+    ReleaseSRWLockExclusive(&lock);
+}
+
+void ImageCache::FillDiagnostics(Diagnostics* diagnostics)
+{
+    diagnostics->imageCacheHits = InterlockedCompareExchange64(&hits, 0, 0);
+    diagnostics->imageCacheMisses = InterlockedCompareExchange64(&misses, 0, 0);
+    diagnostics->imageCacheEvictions = InterlockedCompareExchange64(&evictions, 0, 0);
+
+    AcquireSRWLockShared(&lock);
+    diagnostics->imageCacheBytes = usedBytes;
+    ReleaseSRWLockShared(&lock);
+}
+
+bool ImageCache::makeRoom(ULONGLONG bytes)
+{
+    while (usedBytes + bytes > budget)
+    {
+        if (!pool.empty())
+        {
+            freeBuffer(pool.back().data, pool.back().capacity);
+            pool.pop_back();
+        }
+        else if (!recent.empty())
+        {
+            // a pinned entry keeps its bytes until it is released, evict the next one as well
+            auto entry = recent.back();
+            unlist(entry);
+            if (--entry->references == 0)
+                recycle(entry);
+            InterlockedIncrement64(&evictions);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+PBYTE ImageCache::takeBuffer(ULONGLONG bytes, ULONGLONG* capacity)
+{
+    auto best = pool.end();
+    for (auto it = pool.begin(); it != pool.end(); ++it)
+    {
+        if (it->capacity >= bytes && it->capacity - bytes <= bytes / POOL_SLACK_DIVISOR &&
+            (best == pool.end() || it->capacity < best->capacity))
+            best = it;
+    }
+    if (best != pool.end())
+    {
+        auto data = best->data;
+        *capacity = best->capacity;
+        pool.erase(best);
+        return data;
+    }
+
+    if (bytes > budget || bytes > SIZE_MAX || !makeRoom(bytes))
+        return nullptr;
+
+    auto data = static_cast<PBYTE>(VirtualAlloc(nullptr, static_cast<SIZE_T>(bytes), MEM_COMMIT | MEM_RESERVE,
+                                                PAGE_READWRITE));
+    if (data == nullptr)
+        return nullptr;
+
+    usedBytes += bytes;
+    *capacity = bytes;
+    return data;
+}
+
+void ImageCache::recycle(Entry* entry)
+{
+    if (pool.size() < MAX_POOLED_BUFFERS && usedBytes <= budget)
+        pool.push_back({entry->image.pixels, entry->capacity});
+    else
+        freeBuffer(entry->image.pixels, entry->capacity);
+
+    delete entry;
+}
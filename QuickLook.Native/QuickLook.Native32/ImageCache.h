@@ -0,0 +1,88 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Diagnostics.h"
+
+// Decoded images shared by all image providers of the process, so going back to a file that was
+// just previewed shows it without decoding it again. Entries are keyed by path, by what was asked
+// for (thumbnail or frame, index, decode size), by what it was rendered for (display DPI, colour
+// profile) and by the size and write time the file had when it was decoded; an entry whose file
+// has changed since is dropped on lookup.
+//
+// The pixel buffers of all entries, of the stores under way and of the pool kept for reuse never
+// exceed the budget together. Least recently used entries are evicted to make room, and their
+// buffers go back to the pool so that the next image of the same size does not need a fresh
+// allocation. An entry that is pinned by Acquire is never freed under its reader.
+class ImageCache
+{
+public:
+    static constexpr ULONGLONG DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+    enum Kind : DWORD
+    {
+        THUMBNAIL,
+        FRAME,
+    };
+
+    // Must match NativeImageKey in QuickLook.Plugin/QuickLook.Plugin.ImageViewer/AnimatedImage/NativeImageCache.cs
+    struct Key
+    {
+        DWORD kind;
+        DWORD frame;
+        DWORD width; // the size the image was decoded for, 0 when it is not scaled
+        DWORD height;
+        DWORD dpiX; // the DPI of the display the image was rendered for
+        DWORD dpiY;
+        PCWCHAR colorProfile; // the profile the colours were mapped to, nullptr when they were not
+    };
+
+    // Must match NativeImageInfo in QuickLook.Plugin/QuickLook.Plugin.ImageViewer/AnimatedImage/NativeImageCache.cs
+    struct Image
+    {
+        DWORD width;
+        DWORD height;
+        DWORD stride;
+        DWORD format; // chosen by the caller, the cache only hands it back
+        double dpiX;
+        double dpiY;
+        PBYTE pixels; // height * stride bytes
+    };
+
+    struct Entry;
+
+    static void SetBudget(ULONGLONG bytes);
+
+    // Pins the image cached for path and key and describes it in image, or returns nullptr.
+    static Entry* Acquire(PCWCHAR path, const Key* key, Image* image);
+    static void Release(Entry* entry);
+
+    // Takes a buffer for the image described by image, which the caller fills through image->pixels
+    // and then hands to Commit. Returns nullptr if the image cannot fit into the budget or the file
+    // cannot be found.
+    static Entry* Reserve(PCWCHAR path, const Key* key, Image* image);
+    static void Commit(Entry* entry, bool keep);
+
+    static void FillDiagnostics(Diagnostics* diagnostics);
+
+private:
+    static bool makeRoom(ULONGLONG bytes);
+    static PBYTE takeBuffer(ULONGLONG bytes, ULONGLONG* capacity);
+    static void recycle(Entry* entry);
+};
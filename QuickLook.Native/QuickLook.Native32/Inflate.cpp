@@ -0,0 +1,379 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+    constexpr unsigned MAX_CODE_LENGTH = 15;
+    constexpr unsigned FAST_BITS = 10; // 2 KiB per table; longer codes are rare
+    constexpr unsigned LITERAL_CODES = 288;
+    constexpr unsigned DISTANCE_CODES = 32;
+    constexpr unsigned LENGTH_CODES = 19;
+    constexpr uint32_t END_OF_BLOCK = 256;
+    constexpr uint32_t NO_SYMBOL = 0xFFFF;
+
+    constexpr uint16_t LENGTH_BASE[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr uint8_t LENGTH_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                        2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr uint16_t DISTANCE_BASE[] = {1,    2,    3,    4,    5,    7,     9,     13,    17,   25,
+                                          33,   49,   65,   97,   129,  193,   257,   385,   513,  769,
+                                          1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    constexpr uint8_t DISTANCE_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                          6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    // the order in which a dynamic block lists the lengths of the code length code
+    constexpr uint8_t LENGTH_ORDER[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    struct Huffman
+    {
+        // symbol << 4 | length for codes up to FAST_BITS long, indexed by the next FAST_BITS bits of the stream;
+        // 0 marks a longer code or a hole
+        uint16_t fast[1 << FAST_BITS];
+
+        // codes are decoded canonically past the table: count holds how many there are of each length and sorted
+        // the symbols ordered by (length, symbol)
+        uint16_t count[MAX_CODE_LENGTH + 1];
+        uint16_t sorted[LITERAL_CODES];
+    };
+
+    struct Tables
+    {
+        Huffman literals;
+        Huffman distances;
+        Huffman lengths;
+        uint8_t codeLengths[LITERAL_CODES + DISTANCE_CODES];
+    };
+
+    // Bits are consumed from the bottom. Reading past the end of the input yields zero bits, which are counted
+    // so that a stream that needs them can be told apart from one that does not.
+    struct BitReader
+    {
+        const uint8_t* in;
+        const uint8_t* end;
+        uint64_t bits = 0;
+        uint32_t count = 0;
+        uint32_t overrun = 0; // bytes of zeros fed in past the end
+
+        // at least 57 bits are buffered afterwards, enough for a length and a distance with their extra bits
+        void Refill()
+        {
+            while (count <= 56)
+            {
+                if (in < end)
+                    bits |= static_cast<uint64_t>(*in++) << count;
+                else
+                    overrun++;
+                count += 8;
+            }
+        }
+
+        uint32_t Take(uint32_t n)
+        {
+            auto value = static_cast<uint32_t>(bits & ((1ull << n) - 1));
+            bits >>= n;
+            count -= n;
+            return value;
+        }
+
+        bool Exhausted() const
+        {
+            return count < overrun * 8;
+        }
+    };
+
+    uint32_t Reverse(uint32_t code, uint32_t length)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < length; i++, code >>= 1)
+            reversed = reversed << 1 | (code & 1);
+        return reversed;
+    }
+
+    // Codes are assigned canonically by (length, symbol). Incomplete codes are accepted, and fail only if a
+    // missing code turns up in the stream.
+    bool Build(Huffman* table, const uint8_t* lengths, unsigned symbols)
+    {
+        memset(table->count, 0, sizeof table->count);
+        for (unsigned symbol = 0; symbol < symbols; symbol++)
+            table->count[lengths[symbol]]++;
+        table->count[0] = 0;
+
+        uint16_t next[MAX_CODE_LENGTH + 1] = {};
+        uint16_t index[MAX_CODE_LENGTH + 1] = {};
+        int left = 1;
+        uint32_t code = 0;
+        for (unsigned length = 1; length <= MAX_CODE_LENGTH; length++)
+        {
+            left = (left << 1) - table->count[length];
+            if (left < 0)
+                return false;
+
+            next[length] = static_cast<uint16_t>(code);
+            index[length] = static_cast<uint16_t>(index[length - 1] + table->count[length - 1]);
+            code = (code + table->count[length]) << 1;
+        }
+
+        memset(table->fast, 0, sizeof table->fast);
+        for (unsigned symbol = 0; symbol < symbols; symbol++)
+        {
+            auto length = lengths[symbol];
+            if (length == 0)
+                continue;
+
+            table->sorted[index[length]++] = static_cast<uint16_t>(symbol);
+            auto assigned = next[length]++;
+            if (length > FAST_BITS)
+                continue;
+
+            auto entry = static_cast<uint16_t>(symbol << 4 | length);
+            for (auto i = Reverse(assigned, length); i < 1u << FAST_BITS; i += 1u << length)
+                table->fast[i] = entry;
+        }
+        return true;
+    }
+
+    // The caller refills first.
+    uint32_t Decode(BitReader& reader, const Huffman& table)
+    {
+        auto entry = table.fast[reader.bits & ((1u << FAST_BITS) - 1)];
+        if (entry != 0)
+        {
+            reader.Take(entry & 0xf);
+            return entry >> 4;
+        }
+
+        // the canonical code one bit at a time, the first bit being the most significant
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (unsigned length = 1; length <= MAX_CODE_LENGTH; length++)
+        {
+            code |= static_cast<int>(reader.bits >> (length - 1) & 1);
+            int count = table.count[length];
+            if (code - first < count)
+            {
+                reader.Take(length);
+                return table.sorted[index + code - first];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return NO_SYMBOL;
+    }
+
+    void BuildFixed(Tables* tables)
+    {
+        auto lengths = tables->codeLengths;
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + LITERAL_CODES, 8);
+        Build(&tables->literals, lengths, LITERAL_CODES);
+
+        std::fill(lengths, lengths + DISTANCE_CODES, 5);
+        Build(&tables->distances, lengths, DISTANCE_CODES);
+    }
+
+    bool BuildDynamic(BitReader& reader, Tables* tables)
+    {
+        reader.Refill();
+        auto literals = reader.Take(5) + 257;
+        auto distances = reader.Take(5) + 1;
+        auto lengthCodes = reader.Take(4) + 4;
+        if (literals > 286 || distances > 30)
+            return false;
+
+        uint8_t lengthLengths[LENGTH_CODES] = {};
+        for (unsigned i = 0; i < lengthCodes; i++)
+        {
+            reader.Refill();
+            lengthLengths[LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.Take(3));
+        }
+        if (!Build(&tables->lengths, lengthLengths, LENGTH_CODES))
+            return false;
+
+        auto lengths = tables->codeLengths;
+        for (unsigned i = 0; i < literals + distances;)
+        {
+            reader.Refill();
+            auto symbol = Decode(reader, tables->lengths);
+            if (symbol < 16)
+            {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            uint8_t value = 0;
+            uint32_t repeat;
+            if (symbol == 16)
+            {
+                if (i == 0)
+                    return false;
+                value = lengths[i - 1];
+                repeat = 3 + reader.Take(2);
+            }
+            else if (symbol == 17)
+            {
+                repeat = 3 + reader.Take(3);
+            }
+            else if (symbol == 18)
+            {
+                repeat = 11 + reader.Take(7);
+            }
+            else
+            {
+                return false;
+            }
+
+            if (repeat > literals + distances - i)
+                return false;
+            std::fill_n(lengths + i, repeat, value);
+            i += repeat;
+        }
+
+        // a block without an end would never stop
+        return !reader.Exhausted() && lengths[END_OF_BLOCK] != 0 &&
+               Build(&tables->literals, lengths, literals) && Build(&tables->distances, lengths + literals, distances);
+    }
+
+    void CopyMatch(uint8_t* out, size_t offset, size_t length, const uint8_t* outEnd)
+    {
+        auto src = out - offset;
+
+        if (offset >= 8 && outEnd - out >= static_cast<ptrdiff_t>(length + 8))
+        {
+            // whole words, possibly writing up to 7 bytes past the match; they get overwritten later
+            for (size_t i = 0; i < length; i += 8)
+                memcpy(out + i, src + i, 8);
+        }
+        else if (offset == 1)
+        {
+            memset(out, *src, length);
+        }
+        else
+        {
+            for (size_t i = 0; i < length; i++)
+                out[i] = src[i];
+        }
+    }
+
+    // Decodes the codes of one block. Returns true when it reached the end of the block, false when the output is
+    // full or the block is malformed.
+    bool DecodeBlock(BitReader& reader, const Tables& tables, const uint8_t* output, uint8_t** at, uint8_t* outEnd)
+    {
+        auto out = *at;
+        auto ended = false;
+        for (;;)
+        {
+            reader.Refill();
+            auto symbol = Decode(reader, tables.literals);
+            if (symbol < END_OF_BLOCK)
+            {
+                if (out == outEnd || reader.Exhausted())
+                    break;
+                *out++ = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == END_OF_BLOCK)
+            {
+                ended = !reader.Exhausted();
+                break;
+            }
+
+            symbol -= 257;
+            if (symbol >= sizeof LENGTH_BASE / sizeof LENGTH_BASE[0])
+                break;
+
+            size_t length = LENGTH_BASE[symbol] + reader.Take(LENGTH_EXTRA[symbol]);
+            auto distance = Decode(reader, tables.distances);
+            if (distance >= sizeof DISTANCE_BASE / sizeof DISTANCE_BASE[0])
+                break;
+
+            size_t offset = DISTANCE_BASE[distance] + reader.Take(DISTANCE_EXTRA[distance]);
+            if (reader.Exhausted() || offset > static_cast<size_t>(out - output) || out == outEnd)
+                break;
+
+            length = std::min(length, static_cast<size_t>(outEnd - out));
+            CopyMatch(out, offset, length, outEnd);
+            out += length;
+        }
+
+        *at = out;
+        return ended;
+    }
+}
+
+size_t Inflate::Decompress(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize)
+{
+    // deflate with a window of at most 32 KiB and no preset dictionary, checked by the header's own check bits
+    if (input == nullptr || output == nullptr || inputSize < 2 || (input[0] & 0xf) != 8 || input[0] >> 4 > 7 ||
+        (input[0] << 8 | input[1]) % 31 != 0 || (input[1] & 0x20) != 0)
+        return 0;
+
+    BitReader reader{input + 2, input + inputSize};
+    auto out = output;
+    auto outEnd = output + outputSize;
+    auto tables = std::make_unique<Tables>();
+
+    for (auto last = false; !last && out < outEnd;)
+    {
+        reader.Refill();
+        last = reader.Take(1) != 0;
+        auto type = reader.Take(2);
+
+        if (type == 0)
+        {
+            // stored: the length pair starts at the next byte, and the data is copied straight from the input
+            reader.Take(reader.count & 7);
+            auto length = reader.Take(16);
+            auto complement = reader.Take(16);
+            auto buffered = reader.count / 8;
+            if (reader.Exhausted() || buffered < reader.overrun || (length ^ complement) != 0xFFFF)
+                break;
+
+            reader.in -= buffered - reader.overrun;
+            reader.bits = 0;
+            reader.count = 0;
+            reader.overrun = 0;
+
+            auto copied = std::min<size_t>({length, static_cast<size_t>(reader.end - reader.in),
+                                            static_cast<size_t>(outEnd - out)});
+            memcpy(out, reader.in, copied);
+            reader.in += copied;
+            out += copied;
+            if (copied < length && out < outEnd)
+                break;
+            continue;
+        }
+
+        if (type == 1)
+            BuildFixed(tables.get());
+        else if (type != 2 || !BuildDynamic(reader, tables.get()))
+            break;
+
+        if (!DecodeBlock(reader, *tables, output, &out, outEnd))
+            break;
+    }
+
+    return static_cast<size_t>(out - output);
+}
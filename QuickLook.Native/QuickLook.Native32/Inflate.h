@@ -0,0 +1,35 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decoder for zlib streams (RFC 1950 around RFC 1951 deflate), which is how PNG stores its image
+// data. Codes of up to 10 bits, which is nearly all of them, are looked up with one load; longer
+// ones are walked bit by bit through the canonical code. Match copies move 8 bytes at a time when
+// the source does not overlap the word being written. The Adler-32 checksum is not verified.
+//
+// Plain C++ so it can be built and verified on any platform.
+class Inflate
+{
+public:
+    // Decompresses up to outputSize bytes and returns how many were written. Fewer than
+    // outputSize means the stream is malformed or ends early; the bytes before that are valid.
+    static size_t Decompress(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize);
+};
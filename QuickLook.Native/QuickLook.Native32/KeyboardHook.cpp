@@ -0,0 +1,332 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stdafx.h"
+#include "KeyboardHook.h"
+#include "Shell32.h"
+#include "SelectionCache.h"
+#include "SpscQueue.h"
+
+namespace
+{
+    // Synthetic key events replayed by QuickLook itself (see FilePilot.cpp) carry this marker
+    // and must not enter the hotkey pipeline.
+    // 0x514C5452 == 'QLTR' (QuickLook Third-party Replay)
+    constexpr ULONG_PTR QUICKLOOK_THIRD_PARTY_HOTKEY_REPLAY_EXTRA_INFO = 0x514C5452;
+
+    constexpr ULONGLONG HOLD_TO_PREVIEW_DURATION = 750;
+    constexpr ULONGLONG VALID_KEY_PRESS_DELAY = 1000;
+
+    struct RawKeystroke
+    {
+        DWORD vkCode;
+        bool isKeyDown;
+        bool hasModifiers;
+        bool isForegroundChange;
+        ULONGLONG tick;
+    };
+
+    // hook thread -> dispatch thread: everything the user types, so the hook itself stays trivial
+    SpscQueue<RawKeystroke, 256> rawQueue;
+    // dispatch thread -> managed side: only keystrokes that should reach ViewWindowManager
+    SpscQueue<KeyboardHook::KeystrokeEvent, 64> eventQueue;
+
+    HHOOK hHook = nullptr;
+    HWINEVENTHOOK hWinEventHook = nullptr;
+
+    HANDLE hHookThread = nullptr;
+    HANDLE hDispatchThread = nullptr;
+    DWORD hookThreadId = 0;
+
+    HANDLE hHookReady = nullptr;
+    HANDLE hRawAvailable = nullptr;
+    HANDLE hEventAvailable = nullptr;
+    HANDLE hStop = nullptr;
+
+    // state of the dispatch thread, ported from KeystrokeDispatcher
+    bool isPreviewRequestState = false;
+    bool spaceIsDown = false;
+    ULONGLONG spaceHoldTick = 0;
+    ULONGLONG lastInvalidKeyPressTick = 0;
+}
+
+bool KeyboardHook::Start()
+{
+    if (hHookThread != nullptr)
+        return hHook != nullptr;
+
+    // events live as long as the process: a managed thread may still be waiting in WaitEvent during Stop
+    if (hStop == nullptr)
+    {
+        hHookReady = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        hRawAvailable = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        hEventAvailable = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        hStop = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    }
+    ResetEvent(hHookReady);
+    ResetEvent(hStop);
+
+    hHookThread = CreateThread(nullptr, 0, hookThreadProc, nullptr, 0, &hookThreadId);
+    if (hHookThread == nullptr)
+        return false;
+
+    WaitForSingleObject(hHookReady, INFINITE);
+    if (hHook == nullptr)
+        return false;
+
+    hDispatchThread = CreateThread(nullptr, 0, dispatchThreadProc, nullptr, 0, nullptr);
+    if (hDispatchThread == nullptr)
+        return false;
+
+    // the selection cache is only useful to, and only enabled with, a running hook
+    SelectionCache::Start();
+    return true;
+}
+
+void KeyboardHook::Stop()
+{
+    if (hHookThread == nullptr)
+        return;
+
+    SelectionCache::Stop();
+
+    SetEvent(hStop);
+    PostThreadMessage(hookThreadId, WM_QUIT, 0, 0);
+
+    WaitForSingleObject(hHookThread, 2000);
+    if (hDispatchThread != nullptr)
+        WaitForSingleObject(hDispatchThread, 2000);
+
+    CloseHandle(hHookThread);
+    if (hDispatchThread != nullptr)
+        CloseHandle(hDispatchThread);
+    hHookThread = hDispatchThread = nullptr;
+}
+
+bool KeyboardHook::WaitEvent(KeystrokeEvent* ev, DWORD timeout)
+{
+    if (ev == nullptr || hEventAvailable == nullptr)
+        return false;
+
+    while (!eventQueue.Pop(*ev))
+    {
+        HANDLE handles[] = {hEventAvailable, hStop};
+        if (WaitForMultipleObjects(2, handles, FALSE, timeout) != WAIT_OBJECT_0)
+            return false;
+    }
+    return true;
+}
+
+DWORD WINAPI KeyboardHook::hookThreadProc(LPVOID lpParam)
+{
+    // Low-level hooks run on the installing thread. This one never runs managed code,
+    // so a GC in QuickLook cannot stall keyboard input system-wide.
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    HMODULE hModule = nullptr;
+    GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                      reinterpret_cast<LPCWSTR>(&lowLevelKeyboardProc), &hModule);
+
+    hHook = SetWindowsHookEx(WH_KEYBOARD_LL, lowLevelKeyboardProc, hModule, 0);
+
+    // When the foreground window changes (e.g. via Alt+Tab), reset the invalid-key
+    // delay so the first Space press in the newly focused Explorer window works.
+    // https://github.com/QL-Win/QuickLook/issues/1939
+    hWinEventHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr,
+                                    foregroundChangedProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+
+    SetEvent(hHookReady);
+    if (hHook == nullptr)
+        return 1;
+
+    MSG msg;
+    while (GetMessage(&msg, nullptr, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    if (hWinEventHook != nullptr)
+        UnhookWinEvent(hWinEventHook);
+    UnhookWindowsHookEx(hHook);
+    hWinEventHook = nullptr;
+    hHook = nullptr;
+
+    return 0;
+}
+
+LRESULT CALLBACK KeyboardHook::lowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+    if (nCode != HC_ACTION)
+        return CallNextHookEx(hHook, nCode, wParam, lParam);
+
+    auto kb = reinterpret_cast<PKBDLLHOOKSTRUCT>(lParam);
+
+    if (kb->dwExtraInfo == QUICKLOOK_THIRD_PARTY_HOTKEY_REPLAY_EXTRA_INFO)
+        return CallNextHookEx(hHook, nCode, wParam, lParam);
+
+    if ((GetAsyncKeyState(VK_LWIN) | GetAsyncKeyState(VK_RWIN)) & 0x8000)
+        return CallNextHookEx(hHook, nCode, wParam, lParam);
+
+    RawKeystroke raw = {};
+    raw.vkCode = kb->vkCode;
+    raw.isKeyDown = wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN;
+    raw.hasModifiers = ((GetAsyncKeyState(VK_CONTROL) | GetAsyncKeyState(VK_SHIFT) | GetAsyncKeyState(VK_MENU))
+        & 0x8000) != 0;
+    raw.tick = GetTickCount64();
+
+    if (raw.isKeyDown || wParam == WM_KEYUP || wParam == WM_SYSKEYUP)
+    {
+        if (rawQueue.Push(raw))
+            SetEvent(hRawAvailable);
+    }
+
+    return CallNextHookEx(hHook, nCode, wParam, lParam);
+}
+
+void CALLBACK KeyboardHook::foregroundChangedProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd,
+                                                  LONG idObject, LONG idChild, DWORD idEventThread,
+                                                  DWORD dwmsEventTime)
+{
+    RawKeystroke raw = {};
+    raw.isForegroundChange = true;
+
+    if (rawQueue.Push(raw))
+        SetEvent(hRawAvailable);
+}
+
+DWORD WINAPI KeyboardHook::dispatchThreadProc(LPVOID lpParam)
+{
+    // GetFocusedWindowType talks to UI Automation for some file managers
+    CoInitialize(nullptr);
+
+    HANDLE handles[] = {hRawAvailable, hStop};
+
+    while (true)
+    {
+        auto ret = MsgWaitForMultipleObjects(2, handles, FALSE, INFINITE, QS_ALLINPUT);
+        if (ret == WAIT_OBJECT_0 + 1 || ret == WAIT_FAILED)
+            break;
+
+        MSG msg;
+        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        RawKeystroke raw;
+        while (rawQueue.Pop(raw))
+        {
+            // Any invalid key presses that happened before a foreground switch (e.g. Alt+Tab
+            // keystrokes) belong to the previous context, so they must not suppress valid keys.
+            if (raw.isForegroundChange)
+            {
+                lastInvalidKeyPressTick = 0;
+                continue;
+            }
+
+            // skip invalid keys, but record the timestamp
+            if (!isValidKey(raw.vkCode))
+            {
+                lastInvalidKeyPressTick = raw.tick;
+                continue;
+            }
+
+            // skip valid keys when modifiers are used
+            if (raw.isKeyDown && raw.hasModifiers)
+                continue;
+
+            // skip if key is valid but too close after pressing an invalid key
+            if (raw.tick - lastInvalidKeyPressTick < VALID_KEY_PRESS_DELAY)
+                continue;
+            lastInvalidKeyPressTick = 0;
+
+            // skip if user is holding Space (don't skip other valid keys)
+            if (raw.isKeyDown && raw.vkCode == VK_SPACE)
+            {
+                if (spaceIsDown)
+                    continue;
+
+                spaceHoldTick = raw.tick;
+            }
+
+            // check if the valid key is a preview request; a key release keeps the state of its press
+            if (raw.isKeyDown)
+                isPreviewRequestState = isPreviewRequest();
+
+            // Post only when user pressed a key in a valid window, or released a key which was
+            // pressed in a valid window, with an exception of Space which must be hold for 750ms
+            // before releasing.
+            if (isPreviewRequestState)
+            {
+                if (raw.isKeyDown || raw.vkCode != VK_SPACE || raw.tick - spaceHoldTick >= HOLD_TO_PREVIEW_DURATION)
+                {
+                    KeystrokeEvent ev = {raw.vkCode, raw.isKeyDown};
+                    if (eventQueue.Push(ev))
+                        SetEvent(hEventAvailable);
+
+                    if (raw.isKeyDown && raw.vkCode == VK_SPACE)
+                        spaceIsDown = true;
+                }
+            }
+
+            // when the key has been released, reset variables
+            if (!raw.isKeyDown)
+            {
+                isPreviewRequestState = false;
+                spaceIsDown = raw.vkCode != VK_SPACE && spaceIsDown;
+            }
+        }
+    }
+
+    CoUninitialize();
+    return 0;
+}
+
+bool KeyboardHook::isValidKey(DWORD vkCode)
+{
+    switch (vkCode)
+    {
+    case VK_UP:
+    case VK_DOWN:
+    case VK_LEFT:
+    case VK_RIGHT:
+    case VK_RETURN:
+    case VK_SPACE:
+    case VK_ESCAPE:
+    case VK_F5:
+    case VK_F11:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool KeyboardHook::isPreviewRequest()
+{
+    if (Shell32::GetFocusedWindowType() != Shell32::INVALID)
+        return true;
+
+    auto hwnd = GetForegroundWindow();
+    if (hwnd == nullptr)
+        return false;
+
+    DWORD processId = 0;
+    GetWindowThreadProcessId(hwnd, &processId);
+    return processId == GetCurrentProcessId();
+}
@@ -0,0 +1,44 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "stdafx.h"
+
+class KeyboardHook
+{
+public:
+    // Must match KeystrokeEvent in QuickLook/NativeMethods/QuickLook.cs
+    struct KeystrokeEvent
+    {
+        DWORD vkCode;
+        BOOL isKeyDown;
+    };
+
+    static bool Start();
+    static void Stop();
+    static bool WaitEvent(KeystrokeEvent* ev, DWORD timeout);
+
+private:
+    static DWORD WINAPI hookThreadProc(LPVOID lpParam);
+    static DWORD WINAPI dispatchThreadProc(LPVOID lpParam);
+    static LRESULT CALLBACK lowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static void CALLBACK foregroundChangedProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd,
+                                               LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime);
+    static bool isValidKey(DWORD vkCode);
+    static bool isPreviewRequest();
+};
@@ -0,0 +1,113 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const PathChar* path)
+{
+    Close();
+
+    auto hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0 ||
+        static_cast<uint64_t>(size.QuadPart) > static_cast<uint64_t>(SIZE_MAX))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // the view keeps the section alive, the handles are not needed afterwards
+    auto hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(hFile);
+    if (hMapping == nullptr)
+        return false;
+
+    auto view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (view == nullptr)
+        return false;
+
+    _data = static_cast<const uint8_t*>(view);
+    _size = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+
+    _data = nullptr;
+    _size = 0;
+}
+#else
+bool MappedFile::Open(const PathChar* path)
+{
+    Close();
+
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 ||
+        static_cast<uint64_t>(st.st_size) > static_cast<uint64_t>(SIZE_MAX))
+    {
+        close(fd);
+        return false;
+    }
+
+    auto view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    _data = static_cast<const uint8_t*>(view);
+    _size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (_data != nullptr)
+        munmap(const_cast<uint8_t*>(_data), static_cast<size_t>(_size));
+
+    _data = nullptr;
+    _size = 0;
+}
+#endif
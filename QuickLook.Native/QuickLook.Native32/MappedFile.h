@@ -0,0 +1,58 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a whole file. The native parsers work on the mapping in place, so opening a
+// huge file costs only the page faults of the bytes that actually get looked at.
+//
+// In a 32-bit process very large files may not fit into the address space; Open fails for them.
+class MappedFile
+{
+public:
+#ifdef _WIN32
+    typedef wchar_t PathChar;
+#else
+    typedef char PathChar;
+#endif
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const PathChar* path);
+    void Close();
+
+    const uint8_t* Data() const
+    {
+        return _data;
+    }
+
+    uint64_t Size() const
+    {
+        return _size;
+    }
+
+private:
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+};
@@ -0,0 +1,161 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedWindow.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedWindow::~MappedWindow()
+{
+    Close();
+}
+
+const uint8_t* MappedWindow::View(uint64_t offset, uint32_t length)
+{
+    if (length == 0 || offset > _size || length > _size - offset || length > MAX_SPAN)
+        return nullptr;
+
+    if (_view != nullptr && offset >= _viewOffset && offset + length <= _viewOffset + _viewLength)
+        return _view + (offset - _viewOffset);
+
+    unmap();
+
+    // the window starts at or below offset and so always covers MAX_SPAN bytes from there
+    auto start = offset / GRANULARITY * GRANULARITY;
+    auto length64 = _size - start < WINDOW_SIZE ? _size - start : static_cast<uint64_t>(WINDOW_SIZE);
+    auto windowLength = static_cast<size_t>(length64);
+
+#ifdef _WIN32
+    auto view = MapViewOfFile(_mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start),
+                              windowLength);
+    if (view == nullptr)
+        return nullptr;
+#else
+    auto view = mmap(nullptr, windowLength, PROT_READ, MAP_SHARED, _fd, static_cast<off_t>(start));
+    if (view == MAP_FAILED)
+        return nullptr;
+#endif
+
+    _view = static_cast<const uint8_t*>(view);
+    _viewOffset = start;
+    _viewLength = windowLength;
+    return _view + (offset - start);
+}
+
+#ifdef _WIN32
+bool MappedWindow::Open(const MappedFile::PathChar* path)
+{
+    Close();
+
+    auto hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // a section cannot be created for an empty file
+    if (size.QuadPart != 0)
+    {
+        // the section keeps the file open, its handle is not needed afterwards
+        _mapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping == nullptr)
+        {
+            CloseHandle(hFile);
+            return false;
+        }
+    }
+
+    CloseHandle(hFile);
+    _size = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+void MappedWindow::Close()
+{
+    unmap();
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+
+    _mapping = nullptr;
+    _size = 0;
+}
+
+void MappedWindow::unmap()
+{
+    if (_view != nullptr)
+        UnmapViewOfFile(_view);
+
+    _view = nullptr;
+    _viewOffset = 0;
+    _viewLength = 0;
+}
+#else
+bool MappedWindow::Open(const MappedFile::PathChar* path)
+{
+    Close();
+
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void MappedWindow::Close()
+{
+    unmap();
+    if (_fd >= 0)
+        close(_fd);
+
+    _fd = -1;
+    _size = 0;
+}
+
+void MappedWindow::unmap()
+{
+    if (_view != nullptr)
+        munmap(const_cast<uint8_t*>(_view), _viewLength);
+
+    _view = nullptr;
+    _viewOffset = 0;
+    _viewLength = 0;
+}
+#endif
@@ -0,0 +1,69 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only file that is mapped a window at a time, for files too large to map whole. Only one
+// window of at most WINDOW_SIZE bytes is mapped at any time, so the address space and the working
+// set stay the same however large the file is; moving the window costs one remapping.
+class MappedWindow
+{
+public:
+    static constexpr uint32_t WINDOW_SIZE = 16 * 1024 * 1024;
+    // window offsets are multiples of this, the allocation granularity of Windows
+    static constexpr uint32_t GRANULARITY = 64 * 1024;
+    // the longest range View can return
+    static constexpr uint32_t MAX_SPAN = WINDOW_SIZE - GRANULARITY;
+
+    MappedWindow() = default;
+    ~MappedWindow();
+
+    MappedWindow(const MappedWindow&) = delete;
+    MappedWindow& operator=(const MappedWindow&) = delete;
+
+    // Unlike MappedFile, an empty file opens fine; it just has nothing to view.
+    bool Open(const MappedFile::PathChar* path);
+    void Close();
+
+    uint64_t Size() const
+    {
+        return _size;
+    }
+
+    // Returns the bytes [offset, offset + length) of the file, moving the window if they are not
+    // inside it, or nullptr if the range is empty, not inside the file, longer than MAX_SPAN or
+    // cannot be mapped. The pointer is valid until the next call.
+    const uint8_t* View(uint64_t offset, uint32_t length);
+
+private:
+    void unmap();
+
+#ifdef _WIN32
+    void* _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+    uint64_t _size = 0;
+    const uint8_t* _view = nullptr;
+    uint64_t _viewOffset = 0;
+    size_t _viewLength = 0;
+};
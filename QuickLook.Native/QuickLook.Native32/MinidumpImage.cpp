@@ -0,0 +1,279 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MinidumpImage.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t MINIDUMP_SIGNATURE = 0x504d444d; // "MDMP"
+    constexpr uint32_t HEADER_SIZE = 32;
+    constexpr uint32_t DIRECTORY_ENTRY_SIZE = 12;
+
+    constexpr uint32_t THREAD_LIST_STREAM = 3;
+    constexpr uint32_t MODULE_LIST_STREAM = 4;
+    constexpr uint32_t EXCEPTION_STREAM = 6;
+    constexpr uint32_t SYSTEM_INFO_STREAM = 7;
+    constexpr uint32_t THREAD_EX_LIST_STREAM = 8;
+
+    constexpr uint32_t SYSTEM_INFO_SIZE = 56;
+    constexpr uint32_t EXCEPTION_SIZE = 40; // up to ExceptionInformation; the rest is optional
+    constexpr uint32_t EXCEPTION_FULL_SIZE = 168;
+    constexpr uint32_t THREAD_SIZE = 48;
+    constexpr uint32_t THREAD_EX_SIZE = 64;
+    constexpr uint32_t MODULE_SIZE = 108;
+
+    constexpr uint32_t VS_FIXEDFILEINFO_SIGNATURE = 0xfeef04bd;
+    // module paths are at most 32767 characters; anything longer is garbage
+    constexpr uint32_t MAX_STRING_LENGTH = 32767;
+}
+
+bool MinidumpImage::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool MinidumpImage::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _directory = 0;
+
+    if (!has(0, HEADER_SIZE) || u32(0) != MINIDUMP_SIGNATURE)
+        return false;
+
+    _info.version = u32(4);
+    _info.checkSum = u32(16);
+    _info.timeDateStamp = u32(20);
+    _info.flags = u64(24);
+    _info.fileSize = size;
+
+    // a truncated directory keeps the entries which are there
+    uint64_t directory = u32(12);
+    if (directory < size)
+    {
+        _directory = directory;
+        _info.streamCount = static_cast<uint32_t>(
+            std::min<uint64_t>(u32(8), (size - directory) / DIRECTORY_ENTRY_SIZE));
+    }
+
+    return true;
+}
+
+bool MinidumpImage::GetSystemInfo(SystemInfo* info) const
+{
+    uint64_t offset;
+    uint32_t size;
+    if (!findStream(SYSTEM_INFO_STREAM, SYSTEM_INFO_SIZE - 24, &offset, &size)) // the CPU block is optional
+        return false;
+
+    *info = {};
+    info->processorArchitecture = u16(offset);
+    info->processorLevel = u16(offset + 2);
+    info->processorRevision = u16(offset + 4);
+    info->numberOfProcessors = _data[offset + 6];
+    info->productType = _data[offset + 7];
+    info->majorVersion = u32(offset + 8);
+    info->minorVersion = u32(offset + 12);
+    info->buildNumber = u32(offset + 16);
+    info->platformId = u32(offset + 20);
+    info->suiteMask = u16(offset + 28);
+    info->servicePack = stringAt(u32(offset + 24), &info->servicePackLength);
+    return true;
+}
+
+bool MinidumpImage::GetException(Exception* exception) const
+{
+    uint64_t offset;
+    uint32_t size;
+    if (!findStream(EXCEPTION_STREAM, EXCEPTION_SIZE, &offset, &size))
+        return false;
+
+    *exception = {};
+    exception->threadId = u32(offset);
+    exception->code = u32(offset + 8);
+    exception->flags = u32(offset + 12);
+    exception->record = u64(offset + 16);
+    exception->address = u64(offset + 24);
+
+    if (size >= EXCEPTION_FULL_SIZE)
+    {
+        exception->numberParameters = std::min(u32(offset + 32), 15u);
+        for (uint32_t i = 0; i < exception->numberParameters; i++)
+            exception->parameters[i] = u64(offset + 40 + i * 8);
+    }
+    return true;
+}
+
+uint32_t MinidumpImage::ReadStreams(uint32_t start, Stream* entries, uint32_t count) const
+{
+    uint32_t filled = 0;
+    for (auto i = start; i < _info.streamCount && filled < count; i++)
+    {
+        auto entry = _directory + static_cast<uint64_t>(i) * DIRECTORY_ENTRY_SIZE;
+        auto& stream = entries[filled++];
+        stream.type = u32(entry);
+        stream.size = u32(entry + 4);
+        stream.rva = u32(entry + 8);
+        stream.inFile = stream.size == 0 || has(stream.rva, stream.size);
+    }
+    return filled;
+}
+
+uint32_t MinidumpImage::ReadThreads(uint32_t start, Thread* entries, uint32_t count) const
+{
+    auto entrySize = THREAD_SIZE;
+    uint64_t list;
+    uint32_t threadCount;
+    if (!findList(THREAD_LIST_STREAM, entrySize, &list, &threadCount))
+    {
+        entrySize = THREAD_EX_SIZE;
+        if (!findList(THREAD_EX_LIST_STREAM, entrySize, &list, &threadCount))
+            return 0;
+    }
+
+    uint32_t filled = 0;
+    for (auto i = start; i < threadCount && filled < count; i++)
+    {
+        auto entry = list + static_cast<uint64_t>(i) * entrySize;
+        auto& thread = entries[filled++];
+        thread.threadId = u32(entry);
+        thread.suspendCount = u32(entry + 4);
+        thread.priorityClass = u32(entry + 8);
+        thread.priority = u32(entry + 12);
+        thread.teb = u64(entry + 16);
+        thread.stackStart = u64(entry + 24);
+        thread.stackSize = u32(entry + 32);
+        thread.contextSize = u32(entry + 40);
+    }
+    return filled;
+}
+
+uint32_t MinidumpImage::ReadModules(uint32_t start, Module* entries, uint32_t count) const
+{
+    uint64_t list;
+    uint32_t moduleCount;
+    if (!findList(MODULE_LIST_STREAM, MODULE_SIZE, &list, &moduleCount))
+        return 0;
+
+    uint32_t filled = 0;
+    for (auto i = start; i < moduleCount && filled < count; i++)
+    {
+        auto entry = list + static_cast<uint64_t>(i) * MODULE_SIZE;
+        auto& module = entries[filled++];
+        module = {};
+        module.baseAddress = u64(entry);
+        module.size = u32(entry + 8);
+        module.checkSum = u32(entry + 12);
+        module.timeDateStamp = u32(entry + 16);
+        module.name = stringAt(u32(entry + 20), &module.nameLength);
+
+        if (u32(entry + 24) == VS_FIXEDFILEINFO_SIGNATURE)
+        {
+            module.fileVersionMs = u32(entry + 32);
+            module.fileVersionLs = u32(entry + 36);
+            module.productVersionMs = u32(entry + 40);
+            module.productVersionLs = u32(entry + 44);
+        }
+    }
+    return filled;
+}
+
+bool MinidumpImage::has(uint64_t offset, uint64_t size) const
+{
+    return _data != nullptr && offset <= _size && size <= _size - offset;
+}
+
+// The readers below are only called on ranges which have been checked with has() or bounded by
+// the stream sizes checked in findStream.
+
+uint16_t MinidumpImage::u16(uint64_t offset) const
+{
+    uint16_t value;
+    memcpy(&value, _data + offset, sizeof value);
+    return value;
+}
+
+uint32_t MinidumpImage::u32(uint64_t offset) const
+{
+    uint32_t value;
+    memcpy(&value, _data + offset, sizeof value);
+    return value;
+}
+
+uint64_t MinidumpImage::u64(uint64_t offset) const
+{
+    uint64_t value;
+    memcpy(&value, _data + offset, sizeof value);
+    return value;
+}
+
+const uint8_t* MinidumpImage::stringAt(uint32_t rva, uint32_t* length) const
+{
+    *length = 0;
+    if (rva == 0 || !has(rva, 4))
+        return nullptr;
+
+    // MINIDUMP_STRING: the length in bytes, then the characters; a string cut off by the end of
+    // the file keeps what is there
+    auto available = (_size - rva - 4) / 2;
+    *length = static_cast<uint32_t>(std::min<uint64_t>({u32(rva) / 2, available, MAX_STRING_LENGTH}));
+    return *length != 0 ? _data + rva + 4 : nullptr;
+}
+
+bool MinidumpImage::findStream(uint32_t type, uint32_t minimumSize, uint64_t* offset, uint32_t* size) const
+{
+    // the first complete stream of a type wins, like dbghelp's MiniDumpReadDumpStream
+    for (uint32_t i = 0; i < _info.streamCount; i++)
+    {
+        auto entry = _directory + static_cast<uint64_t>(i) * DIRECTORY_ENTRY_SIZE;
+        if (u32(entry) != type)
+            continue;
+
+        auto streamSize = u32(entry + 4);
+        auto rva = u32(entry + 8);
+        if (streamSize < minimumSize || !has(rva, streamSize))
+            continue;
+
+        *offset = rva;
+        *size = streamSize;
+        return true;
+    }
+    return false;
+}
+
+bool MinidumpImage::findList(uint32_t type, uint32_t entrySize, uint64_t* entries, uint32_t* count) const
+{
+    uint64_t offset;
+    uint32_t size;
+    if (!findStream(type, 4, &offset, &size))
+        return false;
+
+    // the count is followed by the entries, but some writers pad the count to 8 bytes; like LLVM,
+    // take a stream with room to spare as padded
+    auto listCount = u32(offset);
+    uint32_t header = 4;
+    if (4 + static_cast<uint64_t>(listCount) * entrySize < size)
+        header = 8;
+
+    *entries = offset + header;
+    *count = std::min(listCount, (size - header) / entrySize);
+    return true;
+}
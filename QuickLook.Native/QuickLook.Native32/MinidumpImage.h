@@ -0,0 +1,138 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+
+// Zero-copy reader for Windows minidumps (.dmp, .mdmp, .hdmp). The file is mapped and only the
+// header and the stream directory are looked at when it is opened; the system info, exception,
+// thread and module streams are decoded when asked for. Memory lists are never touched, so a
+// full-memory dump of tens of gigabytes opens as fast as a small one.
+//
+// Minidumps are always little-endian. Strings are UTF-16 pointers into the mapping; they are not
+// terminated and not necessarily aligned.
+class MinidumpImage
+{
+public:
+    // Must match MinidumpInfo in QuickLook.Plugin.DumpViewer/NativeMinidump.cs
+    struct Info
+    {
+        uint32_t version;
+        uint32_t streamCount; // directory entries inside the file
+        uint32_t checkSum;
+        uint32_t timeDateStamp;
+        uint64_t flags;
+        uint64_t fileSize;
+    };
+
+    struct Stream
+    {
+        uint32_t type;
+        uint32_t size;
+        uint32_t rva;
+        uint32_t inFile; // whether the stream data lies completely inside the file
+    };
+
+    struct SystemInfo
+    {
+        uint32_t processorArchitecture;
+        uint32_t processorLevel;
+        uint32_t processorRevision;
+        uint32_t numberOfProcessors;
+        uint32_t productType;
+        uint32_t majorVersion;
+        uint32_t minorVersion;
+        uint32_t buildNumber;
+        uint32_t platformId;
+        uint32_t suiteMask;
+        const uint8_t* servicePack;
+        uint32_t servicePackLength; // in UTF-16 code units
+    };
+
+    struct Exception
+    {
+        uint32_t threadId;
+        uint32_t code;
+        uint32_t flags;
+        uint32_t numberParameters;
+        uint64_t record;
+        uint64_t address;
+        uint64_t parameters[15];
+    };
+
+    struct Thread
+    {
+        uint32_t threadId;
+        uint32_t suspendCount;
+        uint32_t priorityClass;
+        uint32_t priority;
+        uint64_t teb;
+        uint64_t stackStart;
+        uint32_t stackSize;
+        uint32_t contextSize;
+    };
+
+    struct Module
+    {
+        uint64_t baseAddress;
+        uint32_t size;
+        uint32_t checkSum;
+        uint32_t timeDateStamp;
+        uint32_t nameLength; // in UTF-16 code units
+        const uint8_t* name;
+        uint32_t fileVersionMs; // zero unless the module has a valid VS_FIXEDFILEINFO
+        uint32_t fileVersionLs;
+        uint32_t productVersionMs;
+        uint32_t productVersionLs;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    bool GetSystemInfo(SystemInfo* info) const;
+    bool GetException(Exception* exception) const;
+
+    // Each Read* call fills up to count entries and returns how many it filled; 0 means the end.
+    uint32_t ReadStreams(uint32_t start, Stream* entries, uint32_t count) const;
+    uint32_t ReadThreads(uint32_t start, Thread* entries, uint32_t count) const;
+    uint32_t ReadModules(uint32_t start, Module* entries, uint32_t count) const;
+
+private:
+    bool has(uint64_t offset, uint64_t size) const;
+    uint16_t u16(uint64_t offset) const;
+    uint32_t u32(uint64_t offset) const;
+    uint64_t u64(uint64_t offset) const;
+    const uint8_t* stringAt(uint32_t rva, uint32_t* length) const;
+
+    bool findStream(uint32_t type, uint32_t minimumSize, uint64_t* offset, uint32_t* size) const;
+    bool findList(uint32_t type, uint32_t entrySize, uint64_t* entries, uint32_t* count) const;
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    uint64_t _directory = 0;
+};
@@ -17,6 +17,7 @@
 
 #include "stdafx.h"
 #include "MultiCommander.h"
+#include "ProviderInit.h"
 
 HWND     MultiCommander::hMsgWnd          = nullptr;
 HANDLE   MultiCommander::hGetResultEvent  = nullptr;
@@ -24,7 +25,7 @@ PCHAR    MultiCommander::pCurrentItemPath = nullptr;
 
 void MultiCommander::GetSelected(PWCHAR buffer)
 {
-    if (false == PrepareMessageWindow()) { 
+    if (false == ProviderInit::Ensure(ProviderInit::MULTICOMMANDER)) {
         return;
     }
 
@@ -53,6 +54,11 @@ void MultiCommander::GetSelected(PWCHAR buffer)
     pCurrentItemPath = nullptr;
 }
 
+bool MultiCommander::IsRunning()
+{
+    return nullptr != FindWindow(MULTICMD_CLASS, nullptr);
+}
+
 bool MultiCommander::PrepareMessageWindow()
 {
     if (nullptr == hMsgWnd) {
@@ -26,6 +26,7 @@
 class MultiCommander
 {
 public:
+    static bool IsRunning();
     static void GetSelected(PWCHAR buffer);
     static bool PrepareMessageWindow();
     MultiCommander() = delete;
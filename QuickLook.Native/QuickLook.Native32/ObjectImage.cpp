@@ -0,0 +1,818 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ObjectImage.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t ELF_MAGIC[] = {0x7f, 'E', 'L', 'F'};
+    constexpr uint8_t ELFCLASS32 = 1;
+    constexpr uint8_t ELFCLASS64 = 2;
+    constexpr uint8_t ELFDATA2LSB = 1;
+    constexpr uint8_t ELFDATA2MSB = 2;
+    constexpr uint16_t SHN_XINDEX = 0xffff;
+    constexpr uint16_t PN_XNUM = 0xffff;
+
+    constexpr uint32_t PT_LOAD = 1;
+    constexpr uint32_t PT_DYNAMIC = 2;
+    constexpr uint32_t SHT_SYMTAB = 2;
+    constexpr uint32_t SHT_DYNAMIC = 6;
+    constexpr uint32_t SHT_DYNSYM = 11;
+
+    constexpr int64_t DT_NULL = 0;
+    constexpr int64_t DT_NEEDED = 1;
+    constexpr int64_t DT_STRTAB = 5;
+    constexpr int64_t DT_STRSZ = 10;
+    constexpr int64_t DT_SONAME = 14;
+    constexpr int64_t DT_RPATH = 15;
+    constexpr int64_t DT_RUNPATH = 29;
+
+    constexpr uint32_t MH_MAGIC = 0xfeedface;
+    constexpr uint32_t MH_MAGIC_64 = 0xfeedfacf;
+    constexpr uint32_t MH_CIGAM = 0xcefaedfe;
+    constexpr uint32_t MH_CIGAM_64 = 0xcffaedfe;
+    constexpr uint32_t FAT_MAGIC = 0xcafebabe;
+    constexpr uint32_t FAT_MAGIC_64 = 0xcafebabf;
+    // Java class files share FAT_MAGIC; their class file version reads as a far larger slice count
+    constexpr uint32_t MAX_FAT_SLICES = 20;
+
+    constexpr uint32_t LC_SEGMENT = 0x1;
+    constexpr uint32_t LC_SYMTAB = 0x2;
+    constexpr uint32_t LC_SEGMENT_64 = 0x19;
+    constexpr uint32_t MACHO_NAME_LENGTH = 16;
+
+    constexpr uint32_t UIMAGE_MAGIC = 0x27051956;
+    constexpr uint32_t UIMAGE_HEADER_SIZE = 64;
+    constexpr uint32_t UIMAGE_NAME_LENGTH = 32;
+
+    uint32_t Swap32(uint32_t value)
+    {
+        return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+    }
+
+    uint32_t ReadBig32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+               static_cast<uint32_t>(p[2]) << 8 | p[3];
+    }
+
+    // table-driven, since the uImage payload can be tens of megabytes
+    uint32_t Crc32(const uint8_t* data, uint64_t size)
+    {
+        static const auto table = []
+        {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                auto crc = i;
+                for (auto bit = 0; bit < 8; bit++)
+                    crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+                t[i] = crc;
+            }
+            return t;
+        }();
+
+        auto crc = 0xffffffffu;
+        for (uint64_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    uint32_t NameLength(const uint8_t* name, uint32_t maxLength)
+    {
+        auto end = static_cast<const uint8_t*>(memchr(name, 0, maxLength));
+        return end != nullptr ? static_cast<uint32_t>(end - name) : maxLength;
+    }
+}
+
+bool ObjectImage::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool ObjectImage::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _info.headerValid = 1;
+    _programHeaders = _sections = _base = _imageSize = _commands = _commandsSize = _slices = 0;
+    _programHeaderSize = _sectionHeaderSize = _sectionNames = _sliceSize = 0;
+
+    if (!has(0, 4))
+        return false;
+
+    if (memcmp(data, ELF_MAGIC, sizeof ELF_MAGIC) == 0)
+        return parseElf();
+
+    switch (ReadBig32(data))
+    {
+    case FAT_MAGIC:
+    case FAT_MAGIC_64:
+        return parseFat();
+    case UIMAGE_MAGIC:
+        return parseUImage();
+    default:
+        return parseMachO(0, size);
+    }
+}
+
+bool ObjectImage::SelectSlice(uint32_t index)
+{
+    Slice slice;
+    if (_info.format != FAT_MACHO || ReadSlices(index, &slice, 1) != 1)
+        return false;
+
+    return parseMachO(slice.offset, slice.size);
+}
+
+bool ObjectImage::parseElf()
+{
+    if (!has(0, 16))
+        return false;
+
+    auto elfClass = _data[4];
+    auto encoding = _data[5];
+    if ((elfClass != ELFCLASS32 && elfClass != ELFCLASS64) || (encoding != ELFDATA2LSB && encoding != ELFDATA2MSB))
+        return false;
+
+    _info.is64Bit = elfClass == ELFCLASS64;
+    _info.bigEndian = encoding == ELFDATA2MSB;
+    if (!has(0, _info.is64Bit ? 64 : 52))
+        return false;
+
+    // the fields up to e_entry have the same layout in both classes, the rest moves by 12 bytes
+    auto shift = _info.is64Bit ? 12u : 0u;
+    auto programHeaders = word(_info.is64Bit ? 32 : 28);
+    auto sections = word(_info.is64Bit ? 40 : 32);
+    auto programHeaderSize = u16(42 + shift);
+    uint32_t programHeaderCount = u16(44 + shift);
+    auto sectionHeaderSize = u16(46 + shift);
+    uint32_t sectionCount = u16(48 + shift);
+    uint32_t sectionNames = u16(50 + shift);
+
+    _info.format = ELF;
+    _info.os = _data[7];
+    _info.type = u16(16);
+    _info.machine = u16(18);
+    _info.entry = word(24);
+    _info.flags = u32(36 + shift);
+
+    // Huge objects keep the real counts in the first section header (extended numbering)
+    auto minimumSectionHeaderSize = _info.is64Bit ? 64u : 40u;
+    if (sections != 0 && sectionHeaderSize >= minimumSectionHeaderSize && has(sections, sectionHeaderSize))
+    {
+        if (sectionCount == 0)
+            sectionCount = static_cast<uint32_t>(std::min<uint64_t>(word(sections + (_info.is64Bit ? 32 : 20)), UINT32_MAX));
+        if (sectionNames == SHN_XINDEX)
+            sectionNames = u32(sections + (_info.is64Bit ? 40 : 24));
+        if (programHeaderCount == PN_XNUM)
+            programHeaderCount = u32(sections + (_info.is64Bit ? 44 : 28));
+    }
+
+    // a truncated table keeps the entries which are there
+    if (programHeaderSize >= (_info.is64Bit ? 56u : 32u) && programHeaders < _size)
+    {
+        _programHeaders = programHeaders;
+        _programHeaderSize = programHeaderSize;
+        _info.programHeaderCount = static_cast<uint32_t>(
+            std::min<uint64_t>(programHeaderCount, (_size - programHeaders) / programHeaderSize));
+    }
+
+    if (sectionHeaderSize >= minimumSectionHeaderSize && sections != 0 && sections < _size)
+    {
+        _sections = sections;
+        _sectionHeaderSize = sectionHeaderSize;
+        _sectionNames = sectionNames;
+        _info.sectionCount = static_cast<uint32_t>(
+            std::min<uint64_t>(sectionCount, (_size - sections) / sectionHeaderSize));
+    }
+
+    return true;
+}
+
+bool ObjectImage::parseMachO(uint64_t base, uint64_t size)
+{
+    if (base > _size || size > _size - base || size < 28)
+        return false;
+
+    // the magic tells both the word size and whether the file is in our byte order
+    uint32_t bigEndianMagic = ReadBig32(_data + base);
+    bool is64Bit;
+    bool bigEndian;
+    if (bigEndianMagic == MH_MAGIC || bigEndianMagic == MH_MAGIC_64)
+    {
+        is64Bit = bigEndianMagic == MH_MAGIC_64;
+        bigEndian = true;
+    }
+    else if (bigEndianMagic == MH_CIGAM || bigEndianMagic == MH_CIGAM_64)
+    {
+        is64Bit = bigEndianMagic == MH_CIGAM_64;
+        bigEndian = false;
+    }
+    else
+    {
+        return false;
+    }
+
+    auto headerSize = is64Bit ? 32u : 28u;
+    if (size < headerSize)
+        return false;
+
+    _info = {};
+    _info.headerValid = 1;
+    _info.format = MACHO;
+    _info.is64Bit = is64Bit;
+    _info.bigEndian = bigEndian;
+    _info.machine = u32(base + 4);
+    _info.subMachine = u32(base + 8);
+    _info.type = u32(base + 12);
+    _info.flags = u32(base + 24);
+
+    _base = base;
+    _imageSize = size;
+    _commands = base + headerSize;
+    _commandsSize = std::min<uint64_t>(u32(base + 20), size - headerSize);
+    _slices = 0;
+    _sliceSize = 0;
+
+    // count what can actually be walked; a bad cmdsize ends the list
+    auto commandCount = u32(base + 16);
+    auto segmentHeaderSize = is64Bit ? 72u : 56u;
+    auto sectionSize = is64Bit ? 80u : 68u;
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < commandCount && offset + 8 <= _commandsSize; i++)
+    {
+        auto command = u32(_commands + offset);
+        auto commandSize = u32(_commands + offset + 4);
+        if (commandSize < 8 || commandSize > _commandsSize - offset)
+            break;
+
+        if ((command == LC_SEGMENT || command == LC_SEGMENT_64) && commandSize >= segmentHeaderSize)
+            _info.sectionCount += std::min(u32(_commands + offset + segmentHeaderSize - 8),
+                                           (commandSize - segmentHeaderSize) / sectionSize);
+
+        _info.programHeaderCount++;
+        offset += commandSize;
+    }
+
+    return true;
+}
+
+bool ObjectImage::parseFat()
+{
+    auto is64Bit = ReadBig32(_data) == FAT_MAGIC_64;
+    if (!has(0, 8))
+        return false;
+
+    auto sliceCount = ReadBig32(_data + 4);
+    if (sliceCount == 0 || sliceCount > MAX_FAT_SLICES)
+        return false;
+
+    _info.format = FAT_MACHO;
+    _info.is64Bit = is64Bit;
+    _info.bigEndian = 1;
+    _slices = 8;
+    _sliceSize = is64Bit ? 32 : 20;
+    _info.sliceCount = static_cast<uint32_t>(std::min<uint64_t>(sliceCount, (_size - 8) / _sliceSize));
+    return true;
+}
+
+bool ObjectImage::parseUImage()
+{
+    if (!has(0, UIMAGE_HEADER_SIZE))
+        return false;
+
+    _info.bigEndian = 1;
+
+    // the header checksum is computed with its own field zeroed
+    uint8_t header[UIMAGE_HEADER_SIZE];
+    memcpy(header, _data, sizeof header);
+    memset(header + 4, 0, 4);
+
+    _info.format = UIMAGE;
+    _info.headerValid = Crc32(header, sizeof header) == u32(4);
+    _info.entry = u32(20);
+    _info.os = _data[28];
+    _info.machine = _data[29];
+    _info.type = _data[30];
+    _info.flags = _data[31];
+    _info.name = reinterpret_cast<const char*>(_data + 32);
+    _info.nameLength = NameLength(_data + 32, UIMAGE_NAME_LENGTH);
+    return true;
+}
+
+bool ObjectImage::VerifyPayload() const
+{
+    if (_info.format != UIMAGE)
+        return true;
+
+    // ih_size bytes follow the header and are covered by ih_dcrc; a truncated payload fails
+    auto payloadSize = u32(12);
+    return has(UIMAGE_HEADER_SIZE, payloadSize) && Crc32(_data + UIMAGE_HEADER_SIZE, payloadSize) == u32(24);
+}
+
+uint32_t ObjectImage::ReadProgramHeaders(uint32_t start, ProgramHeader* entries, uint32_t count) const
+{
+    uint32_t filled = 0;
+
+    if (_info.format == ELF)
+    {
+        for (auto i = start; i < _info.programHeaderCount && filled < count; i++)
+        {
+            auto p = _programHeaders + static_cast<uint64_t>(i) * _programHeaderSize;
+            auto& entry = entries[filled++];
+            entry = {};
+            entry.type = u32(p);
+            if (_info.is64Bit)
+            {
+                entry.flags = u32(p + 4);
+                entry.offset = u64(p + 8);
+                entry.address = u64(p + 16);
+                entry.fileSize = u64(p + 32);
+                entry.memorySize = u64(p + 40);
+            }
+            else
+            {
+                entry.offset = u32(p + 4);
+                entry.address = u32(p + 8);
+                entry.fileSize = u32(p + 16);
+                entry.memorySize = u32(p + 20);
+                entry.flags = u32(p + 24);
+            }
+        }
+    }
+    else if (_info.format == MACHO)
+    {
+        // load commands; segments also report their mapping and name
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < _info.programHeaderCount && filled < count; i++)
+        {
+            auto p = _commands + offset;
+            auto command = u32(p);
+            auto commandSize = u32(p + 4);
+            offset += commandSize;
+            if (i < start)
+                continue;
+
+            auto& entry = entries[filled++];
+            entry = {};
+            entry.type = command;
+            entry.offset = p;
+            entry.fileSize = commandSize;
+
+            if (command == LC_SEGMENT_64 && commandSize >= 72)
+            {
+                entry.address = u64(p + 24);
+                entry.memorySize = u64(p + 32);
+                entry.offset = _base + u64(p + 40);
+                entry.fileSize = u64(p + 48);
+                entry.flags = u32(p + 60);
+            }
+            else if (command == LC_SEGMENT && commandSize >= 56)
+            {
+                entry.address = u32(p + 24);
+                entry.memorySize = u32(p + 28);
+                entry.offset = _base + u32(p + 32);
+                entry.fileSize = u32(p + 36);
+                entry.flags = u32(p + 44);
+            }
+            else
+            {
+                continue;
+            }
+
+            entry.name = reinterpret_cast<const char*>(_data + p + 8);
+            entry.nameLength = NameLength(_data + p + 8, MACHO_NAME_LENGTH);
+        }
+    }
+
+    return filled;
+}
+
+uint32_t ObjectImage::ReadSections(uint32_t start, Section* entries, uint32_t count) const
+{
+    uint32_t filled = 0;
+
+    if (_info.format == ELF)
+    {
+        uint64_t namesOffset = 0;
+        uint64_t namesSize = 0;
+        uint64_t names;
+        if (elfSection(_sectionNames, &names))
+        {
+            namesOffset = word(names + (_info.is64Bit ? 24 : 16));
+            namesSize = word(names + (_info.is64Bit ? 32 : 20));
+        }
+
+        for (auto i = start; i < _info.sectionCount && filled < count; i++)
+        {
+            uint64_t p;
+            elfSection(i, &p);
+
+            auto& entry = entries[filled++];
+            entry = {};
+            entry.name = stringAt(namesOffset, namesSize, u32(p));
+            entry.nameLength = entry.name != nullptr ? static_cast<uint32_t>(strlen(entry.name)) : 0;
+            entry.type = u32(p + 4);
+            entry.flags = word(p + 8);
+            if (_info.is64Bit)
+            {
+                entry.address = u64(p + 16);
+                entry.offset = u64(p + 24);
+                entry.size = u64(p + 32);
+            }
+            else
+            {
+                entry.address = u32(p + 12);
+                entry.offset = u32(p + 16);
+                entry.size = u32(p + 20);
+            }
+        }
+    }
+    else if (_info.format == MACHO)
+    {
+        auto segmentHeaderSize = _info.is64Bit ? 72u : 56u;
+        auto sectionSize = _info.is64Bit ? 80u : 68u;
+        uint32_t index = 0;
+        uint64_t offset = 0;
+
+        for (uint32_t i = 0; i < _info.programHeaderCount && filled < count; i++)
+        {
+            auto p = _commands + offset;
+            auto command = u32(p);
+            auto commandSize = u32(p + 4);
+            offset += commandSize;
+
+            if ((command != LC_SEGMENT && command != LC_SEGMENT_64) || commandSize < segmentHeaderSize)
+                continue;
+
+            auto sectionCount = std::min(u32(p + segmentHeaderSize - 8), (commandSize - segmentHeaderSize) / sectionSize);
+            if (start >= index + sectionCount)
+            {
+                index += sectionCount;
+                continue;
+            }
+
+            for (auto j = start > index ? start - index : 0; j < sectionCount && filled < count; j++)
+            {
+                auto s = p + segmentHeaderSize + static_cast<uint64_t>(j) * sectionSize;
+
+                auto& entry = entries[filled++];
+                entry = {};
+                entry.name = reinterpret_cast<const char*>(_data + s);
+                entry.nameLength = NameLength(_data + s, MACHO_NAME_LENGTH);
+                entry.segmentName = reinterpret_cast<const char*>(_data + s + 16);
+                entry.segmentNameLength = NameLength(_data + s + 16, MACHO_NAME_LENGTH);
+
+                uint32_t fileOffset;
+                uint32_t flags;
+                if (_info.is64Bit)
+                {
+                    entry.address = u64(s + 32);
+                    entry.size = u64(s + 40);
+                    fileOffset = u32(s + 48);
+                    flags = u32(s + 64);
+                }
+                else
+                {
+                    entry.address = u32(s + 32);
+                    entry.size = u32(s + 36);
+                    fileOffset = u32(s + 40);
+                    flags = u32(s + 56);
+                }
+
+                // zero-fill sections have no file offset
+                entry.offset = fileOffset != 0 ? _base + fileOffset : 0;
+                entry.type = flags & 0xff;
+                entry.flags = flags;
+            }
+
+            index += sectionCount;
+        }
+    }
+
+    return filled;
+}
+
+uint32_t ObjectImage::ReadDynamic(uint32_t start, DynamicEntry* entries, uint32_t count) const
+{
+    uint64_t table;
+    uint64_t tableSize;
+    uint64_t strings;
+    uint64_t stringsSize;
+    if (_info.format != ELF || !elfDynamic(&table, &tableSize, &strings, &stringsSize))
+        return 0;
+
+    auto entrySize = _info.is64Bit ? 16u : 8u;
+    auto entryCount = tableSize / entrySize;
+    uint32_t filled = 0;
+
+    for (uint64_t i = start; i < entryCount && filled < count; i++)
+    {
+        auto p = table + i * entrySize;
+        auto tag = _info.is64Bit ? static_cast<int64_t>(u64(p)) : static_cast<int32_t>(u32(p));
+        if (tag == DT_NULL)
+            break;
+
+        auto& entry = entries[filled++];
+        entry.tag = tag;
+        entry.value = word(p + entrySize / 2);
+        entry.string = tag == DT_NEEDED || tag == DT_SONAME || tag == DT_RPATH || tag == DT_RUNPATH
+                           ? stringAt(strings, stringsSize, entry.value)
+                           : nullptr;
+    }
+
+    return filled;
+}
+
+uint32_t ObjectImage::ReadSymbols(SymbolCursor* cursor, Symbol* entries, uint32_t count) const
+{
+    uint32_t filled = 0;
+
+    if (_info.format == ELF)
+    {
+        // .symtab and .dynsym, in section order; index 0 of each table is the undefined symbol
+        auto minimumEntrySize = _info.is64Bit ? 24u : 16u;
+
+        for (; cursor->table < _info.sectionCount && filled < count; cursor->table++, cursor->index = 0)
+        {
+            uint64_t p;
+            elfSection(cursor->table, &p);
+
+            auto type = u32(p + 4);
+            if (type != SHT_SYMTAB && type != SHT_DYNSYM)
+                continue;
+
+            auto offset = word(p + (_info.is64Bit ? 24 : 16));
+            auto size = word(p + (_info.is64Bit ? 32 : 20));
+            auto entrySize = std::max<uint64_t>(word(p + (_info.is64Bit ? 56 : 36)), minimumEntrySize);
+            if (offset > _size)
+                continue;
+
+            auto entryCount = std::min(size, _size - offset) / entrySize;
+
+            uint64_t strings = 0;
+            uint64_t stringsSize = 0;
+            uint64_t link;
+            if (elfSection(u32(p + (_info.is64Bit ? 40 : 24)), &link))
+            {
+                strings = word(link + (_info.is64Bit ? 24 : 16));
+                stringsSize = word(link + (_info.is64Bit ? 32 : 20));
+            }
+
+            if (cursor->index == 0)
+                cursor->index = 1;
+
+            for (; cursor->index < entryCount && filled < count; cursor->index++)
+            {
+                auto s = offset + cursor->index * entrySize;
+
+                auto& entry = entries[filled++];
+                entry.name = stringAt(strings, stringsSize, u32(s));
+                if (_info.is64Bit)
+                {
+                    entry.type = _data[s + 4];
+                    entry.section = u16(s + 6);
+                    entry.value = u64(s + 8);
+                    entry.size = u64(s + 16);
+                }
+                else
+                {
+                    entry.value = u32(s + 4);
+                    entry.size = u32(s + 8);
+                    entry.type = _data[s + 12];
+                    entry.section = u16(s + 14);
+                }
+            }
+
+            if (cursor->index < entryCount)
+                break;
+        }
+    }
+    else if (_info.format == MACHO && cursor->table == 0)
+    {
+        uint64_t table;
+        uint32_t entryCount;
+        uint64_t strings;
+        uint64_t stringsSize;
+        if (!machOSymbolTable(&table, &entryCount, &strings, &stringsSize))
+            return 0;
+
+        auto entrySize = _info.is64Bit ? 16u : 12u;
+        for (; cursor->index < entryCount && filled < count; cursor->index++)
+        {
+            auto s = table + static_cast<uint64_t>(cursor->index) * entrySize;
+
+            auto& entry = entries[filled++];
+            entry.name = stringAt(strings, stringsSize, u32(s));
+            entry.type = _data[s + 4];
+            entry.section = _data[s + 5];
+            entry.value = _info.is64Bit ? u64(s + 8) : u32(s + 8);
+            entry.size = 0;
+        }
+
+        if (cursor->index >= entryCount)
+            cursor->table = 1;
+    }
+
+    return filled;
+}
+
+uint32_t ObjectImage::ReadSlices(uint32_t start, Slice* entries, uint32_t count) const
+{
+    uint32_t filled = 0;
+
+    for (auto i = start; i < _info.sliceCount && filled < count; i++)
+    {
+        auto p = _slices + static_cast<uint64_t>(i) * _sliceSize;
+
+        auto& entry = entries[filled++];
+        entry.machine = u32(p);
+        entry.subMachine = u32(p + 4);
+        entry.offset = _sliceSize == 32 ? u64(p + 8) : u32(p + 8);
+        entry.size = _sliceSize == 32 ? u64(p + 16) : u32(p + 12);
+    }
+
+    return filled;
+}
+
+bool ObjectImage::has(uint64_t offset, uint64_t size) const
+{
+    return _data != nullptr && offset <= _size && size <= _size - offset;
+}
+
+// The readers below are only called on ranges which have been checked with has() or bounded by
+// the table sizes computed at parse time.
+
+uint16_t ObjectImage::u16(uint64_t offset) const
+{
+    uint16_t value;
+    memcpy(&value, _data + offset, sizeof value);
+    return _info.bigEndian ? static_cast<uint16_t>(value >> 8 | value << 8) : value;
+}
+
+uint32_t ObjectImage::u32(uint64_t offset) const
+{
+    uint32_t value;
+    memcpy(&value, _data + offset, sizeof value);
+    return _info.bigEndian ? Swap32(value) : value;
+}
+
+uint64_t ObjectImage::u64(uint64_t offset) const
+{
+    uint64_t value;
+    memcpy(&value, _data + offset, sizeof value);
+    return _info.bigEndian ? static_cast<uint64_t>(Swap32(static_cast<uint32_t>(value))) << 32 | Swap32(value >> 32)
+                           : value;
+}
+
+uint64_t ObjectImage::word(uint64_t offset) const
+{
+    return _info.is64Bit ? u64(offset) : u32(offset);
+}
+
+const char* ObjectImage::stringAt(uint64_t tableOffset, uint64_t tableSize, uint64_t index) const
+{
+    if (tableOffset > _size || index >= tableSize)
+        return nullptr;
+
+    // only hand out strings which are terminated inside their table
+    auto size = std::min(tableSize, _size - tableOffset);
+    if (index >= size)
+        return nullptr;
+
+    auto string = _data + tableOffset + index;
+    if (memchr(string, 0, static_cast<size_t>(size - index)) == nullptr)
+        return nullptr;
+
+    return reinterpret_cast<const char*>(string);
+}
+
+bool ObjectImage::elfSection(uint32_t index, uint64_t* offset) const
+{
+    if (index >= _info.sectionCount)
+        return false;
+
+    *offset = _sections + static_cast<uint64_t>(index) * _sectionHeaderSize;
+    return true;
+}
+
+bool ObjectImage::elfAddressToOffset(uint64_t address, uint64_t* offset) const
+{
+    ProgramHeader header;
+    for (uint32_t i = 0; ReadProgramHeaders(i, &header, 1) == 1; i++)
+    {
+        if (header.type == PT_LOAD && address >= header.address && address - header.address < header.fileSize)
+        {
+            *offset = header.offset + (address - header.address);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ObjectImage::elfDynamic(uint64_t* offset, uint64_t* size, uint64_t* stringsOffset, uint64_t* stringsSize) const
+{
+    // the section tells where its strings are; fall back to PT_DYNAMIC for section-less files
+    for (uint32_t i = 0; i < _info.sectionCount; i++)
+    {
+        uint64_t p;
+        elfSection(i, &p);
+        if (u32(p + 4) != SHT_DYNAMIC)
+            continue;
+
+        *offset = word(p + (_info.is64Bit ? 24 : 16));
+        *size = word(p + (_info.is64Bit ? 32 : 20));
+        *stringsOffset = 0;
+        *stringsSize = 0;
+
+        uint64_t link;
+        if (elfSection(u32(p + (_info.is64Bit ? 40 : 24)), &link))
+        {
+            *stringsOffset = word(link + (_info.is64Bit ? 24 : 16));
+            *stringsSize = word(link + (_info.is64Bit ? 32 : 20));
+        }
+
+        return *offset <= _size && (*size = std::min(*size, _size - *offset)) > 0;
+    }
+
+    ProgramHeader header;
+    for (uint32_t i = 0; ReadProgramHeaders(i, &header, 1) == 1; i++)
+    {
+        if (header.type != PT_DYNAMIC || header.offset > _size)
+            continue;
+
+        *offset = header.offset;
+        *size = std::min(header.fileSize, _size - header.offset);
+
+        uint64_t address = 0;
+        *stringsSize = 0;
+        auto entrySize = _info.is64Bit ? 16u : 8u;
+        for (uint64_t p = *offset; p + entrySize <= *offset + *size; p += entrySize)
+        {
+            auto tag = _info.is64Bit ? static_cast<int64_t>(u64(p)) : static_cast<int32_t>(u32(p));
+            if (tag == DT_NULL)
+                break;
+            if (tag == DT_STRTAB)
+                address = word(p + entrySize / 2);
+            else if (tag == DT_STRSZ)
+                *stringsSize = word(p + entrySize / 2);
+        }
+
+        if (!elfAddressToOffset(address, stringsOffset))
+            *stringsSize = 0;
+
+        return *size > 0;
+    }
+
+    return false;
+}
+
+bool ObjectImage::machOSymbolTable(uint64_t* offset, uint32_t* count, uint64_t* stringsOffset,
+                                   uint64_t* stringsSize) const
+{
+    uint64_t position = 0;
+    for (uint32_t i = 0; i < _info.programHeaderCount; i++)
+    {
+        auto p = _commands + position;
+        auto commandSize = u32(p + 4);
+        position += commandSize;
+
+        if (u32(p) != LC_SYMTAB || commandSize < 24)
+            continue;
+
+        // the table offsets are relative to the slice
+        auto symbols = _base + u32(p + 8);
+        auto entrySize = _info.is64Bit ? 16u : 12u;
+        if (symbols > _base + _imageSize)
+            return false;
+
+        *offset = symbols;
+        *count = static_cast<uint32_t>(std::min<uint64_t>(u32(p + 12), (_base + _imageSize - symbols) / entrySize));
+        *stringsOffset = _base + u32(p + 16);
+        *stringsSize = std::min<uint64_t>(u32(p + 20), _base + _imageSize - std::min(*stringsOffset, _base + _imageSize));
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,177 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+
+// Zero-copy reader for ELF, Mach-O (thin and fat) and U-Boot uImage headers. The file is mapped and
+// only the parts that are asked for are decoded: program headers / load commands, sections,
+// dynamic entries and symbols are read page by page, so a stripped and an unstripped
+// multi-hundred-megabyte binary open equally fast. Names are pointers into the mapping.
+//
+// Multi-byte fields are converted from the file's byte order; everything else is left in place.
+class ObjectImage
+{
+public:
+    enum Format
+    {
+        UNKNOWN,
+        ELF,
+        MACHO,
+        FAT_MACHO,
+        UIMAGE,
+    };
+
+    // Must match ObjectImageInfo in QuickLook.Plugin.ELFViewer/NativeObjectImage.cs
+    struct Info
+    {
+        uint32_t format;
+        uint32_t is64Bit;
+        uint32_t bigEndian;
+        uint32_t machine;    // ELF e_machine, Mach-O cputype, uImage ih_arch
+        uint32_t subMachine; // Mach-O cpusubtype
+        uint32_t type;       // ELF e_type, Mach-O filetype, uImage ih_type
+        uint32_t os;         // ELF EI_OSABI, uImage ih_os
+        uint32_t flags;      // ELF e_flags, Mach-O flags, uImage ih_comp
+        uint64_t entry;      // ELF e_entry, uImage ih_ep
+        uint32_t programHeaderCount; // ELF program headers, Mach-O load commands
+        uint32_t sectionCount;
+        uint32_t sliceCount; // fat Mach-O only
+        uint32_t headerValid; // uImage header checksum; always 1 for the other formats
+        const char* name;     // uImage ih_name, not necessarily terminated
+        uint32_t nameLength;
+    };
+
+    struct ProgramHeader
+    {
+        uint32_t type; // ELF p_type, Mach-O load command
+        uint32_t flags;
+        uint64_t offset;
+        uint64_t address;
+        uint64_t fileSize;
+        uint64_t memorySize;
+        const char* name; // Mach-O segment name, not necessarily terminated
+        uint32_t nameLength;
+    };
+
+    struct Section
+    {
+        const char* name; // not necessarily terminated
+        uint32_t nameLength;
+        uint32_t type;
+        uint64_t flags;
+        uint64_t address;
+        uint64_t offset;
+        uint64_t size;
+        const char* segmentName; // Mach-O only
+        uint32_t segmentNameLength;
+    };
+
+    struct DynamicEntry
+    {
+        int64_t tag;
+        uint64_t value;
+        const char* string; // DT_NEEDED, DT_SONAME, DT_RPATH and DT_RUNPATH
+    };
+
+    struct Symbol
+    {
+        const char* name;
+        uint64_t value;
+        uint64_t size;
+        uint32_t type;    // ELF st_info, Mach-O n_type
+        uint32_t section; // ELF st_shndx, Mach-O n_sect
+    };
+
+    // Position of the next symbol; start from {0, 0}.
+    struct SymbolCursor
+    {
+        uint32_t table;
+        uint32_t index;
+    };
+
+    struct Slice
+    {
+        uint32_t machine;
+        uint32_t subMachine;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+    // re-targets a fat Mach-O at one of its slices; afterwards the image reads like a thin one
+    bool SelectSlice(uint32_t index);
+    // checks the uImage payload against ih_dcrc; this reads the whole file. True for the other formats.
+    bool VerifyPayload() const;
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    // Each Read* call fills up to count entries and returns how many it filled; 0 means the end.
+    uint32_t ReadProgramHeaders(uint32_t start, ProgramHeader* entries, uint32_t count) const;
+    uint32_t ReadSections(uint32_t start, Section* entries, uint32_t count) const;
+    uint32_t ReadDynamic(uint32_t start, DynamicEntry* entries, uint32_t count) const;
+    uint32_t ReadSymbols(SymbolCursor* cursor, Symbol* entries, uint32_t count) const;
+    uint32_t ReadSlices(uint32_t start, Slice* entries, uint32_t count) const;
+
+private:
+    bool parseElf();
+    bool parseMachO(uint64_t base, uint64_t size);
+    bool parseFat();
+    bool parseUImage();
+
+    bool has(uint64_t offset, uint64_t size) const;
+    uint16_t u16(uint64_t offset) const;
+    uint32_t u32(uint64_t offset) const;
+    uint64_t u64(uint64_t offset) const;
+    uint64_t word(uint64_t offset) const; // 4 or 8 bytes depending on the class
+    const char* stringAt(uint64_t tableOffset, uint64_t tableSize, uint64_t index) const;
+
+    bool elfSection(uint32_t index, uint64_t* offset) const;
+    bool elfAddressToOffset(uint64_t address, uint64_t* offset) const;
+    bool elfDynamic(uint64_t* offset, uint64_t* size, uint64_t* stringsOffset, uint64_t* stringsSize) const;
+    bool machOSymbolTable(uint64_t* offset, uint32_t* count, uint64_t* stringsOffset, uint64_t* stringsSize) const;
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+
+    // ELF: program and section header tables
+    uint64_t _programHeaders = 0;
+    uint32_t _programHeaderSize = 0;
+    uint64_t _sections = 0;
+    uint32_t _sectionHeaderSize = 0;
+    uint32_t _sectionNames = 0;
+
+    // Mach-O: the thin image (the whole file or one slice) and its load commands
+    uint64_t _base = 0;
+    uint64_t _imageSize = 0;
+    uint64_t _commands = 0;
+    uint64_t _commandsSize = 0;
+
+    // fat Mach-O: the slice table
+    uint64_t _slices = 0;
+    uint32_t _sliceSize = 0;
+};
@@ -0,0 +1,137 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PakFile.h"
+
+namespace
+{
+    constexpr uint32_t V4_HEADER_SIZE = 9;
+    constexpr uint32_t V5_HEADER_SIZE = 12;
+    constexpr uint32_t ENTRY_SIZE = 6;
+    constexpr uint32_t ALIAS_SIZE = 4;
+    constexpr uint32_t GZIP_MINIMUM_SIZE = 18; // header and trailer
+    constexpr uint32_t BROTLI_HEADER_SIZE = 8;
+}
+
+bool PakFile::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool PakFile::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _info = {};
+    _table = 0;
+
+    if (_data == nullptr || _size < V5_HEADER_SIZE)
+        return false;
+
+    _info.version = u32(0);
+    if (_info.version == 4)
+    {
+        _info.resourceCount = u32(4);
+        _info.encoding = _data[8];
+        _table = V4_HEADER_SIZE;
+    }
+    else if (_info.version == 5)
+    {
+        _info.encoding = _data[4];
+        _info.resourceCount = u16(8);
+        _info.aliasCount = u16(10);
+        _table = V5_HEADER_SIZE;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (_info.encoding > 2)
+        return false;
+
+    // the resource table ends with a sentinel entry whose offset is the end of the last resource
+    auto tables = (static_cast<uint64_t>(_info.resourceCount) + 1) * ENTRY_SIZE +
+                  static_cast<uint64_t>(_info.aliasCount) * ALIAS_SIZE;
+    if (tables > _size - _table)
+        return false;
+
+    // reject the pack unless every resource lies inside the file, behind the tables and in order
+    uint64_t previous = _table + tables;
+    for (uint32_t i = 0; i <= _info.resourceCount; i++)
+    {
+        uint64_t offset = offsetAt(i);
+        if (offset < previous || offset > _size)
+            return false;
+        previous = offset;
+    }
+
+    auto aliases = _table + (static_cast<uint64_t>(_info.resourceCount) + 1) * ENTRY_SIZE;
+    for (uint32_t i = 0; i < _info.aliasCount; i++)
+    {
+        if (u16(aliases + static_cast<uint64_t>(i) * ALIAS_SIZE + 2) >= _info.resourceCount)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t PakFile::ReadResources(uint32_t start, Resource* entries, uint32_t count) const
+{
+    uint32_t filled = 0;
+    for (auto i = start; i < _info.resourceCount && filled < count; i++)
+    {
+        auto offset = offsetAt(i);
+        auto length = offsetAt(i + 1) - offset;
+        auto data = _data + offset;
+
+        auto& entry = entries[filled++];
+        entry = {u16(_table + static_cast<uint64_t>(i) * ENTRY_SIZE), NONE, data, length, length};
+
+        if (length >= GZIP_MINIMUM_SIZE && data[0] == 0x1F && data[1] == 0x8B && data[2] == 8)
+        {
+            // ISIZE is the decoded size modulo 2^32
+            entry.compression = GZIP;
+            entry.size = u32(offset + length - 4);
+        }
+        else if (length >= BROTLI_HEADER_SIZE && data[0] == 0x1E && data[1] == 0x9B)
+        {
+            entry.compression = BROTLI;
+            entry.data = data + BROTLI_HEADER_SIZE;
+            entry.length = length - BROTLI_HEADER_SIZE;
+            entry.size = u32(offset + 2) | static_cast<uint64_t>(u16(offset + 6)) << 32;
+        }
+    }
+
+    return filled;
+}
+
+uint16_t PakFile::u16(uint64_t offset) const
+{
+    return static_cast<uint16_t>(_data[offset] | _data[offset + 1] << 8);
+}
+
+uint32_t PakFile::u32(uint64_t offset) const
+{
+    return static_cast<uint32_t>(_data[offset]) | static_cast<uint32_t>(_data[offset + 1]) << 8 |
+           static_cast<uint32_t>(_data[offset + 2]) << 16 | static_cast<uint32_t>(_data[offset + 3]) << 24;
+}
+
+uint32_t PakFile::offsetAt(uint32_t index) const
+{
+    return u32(_table + static_cast<uint64_t>(index) * ENTRY_SIZE + 2);
+}
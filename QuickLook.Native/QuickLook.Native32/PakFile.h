@@ -0,0 +1,78 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+
+// Index-only reader for Chromium resource packs (.pak, versions 4 and 5). The file is mapped and
+// opening it only checks the resource and alias tables; resource data is never touched until a
+// resource is asked for, and then only its header is sniffed for gzip or Chromium's brotli framing.
+// Decoding is left to the caller.
+class PakFile
+{
+public:
+    enum Compression : uint32_t
+    {
+        NONE = 0,
+        GZIP = 1,
+        BROTLI = 2, // Chromium framing: 0x1E 0x9B, then the decoded size in 6 bytes, then the brotli stream
+    };
+
+    struct Info
+    {
+        uint32_t version;
+        uint32_t encoding; // of the strings: 0 binary, 1 UTF-8, 2 UTF-16
+        uint32_t resourceCount;
+        uint32_t aliasCount;
+    };
+
+    // Must match NativeResource in QuickLook.Plugin.ArchiveViewer/ChromiumResourcePackage/NativePak.cs
+    struct Resource
+    {
+        uint32_t id;
+        uint32_t compression;
+        const uint8_t* data; // the payload, after the brotli framing if there is one
+        uint32_t length;
+        uint64_t size; // decoded size as claimed by the gzip trailer or the brotli framing
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Info& GetInfo() const
+    {
+        return _info;
+    }
+
+    // Fills up to count resources in table order and returns how many it filled; 0 means the end.
+    uint32_t ReadResources(uint32_t start, Resource* entries, uint32_t count) const;
+
+private:
+    uint16_t u16(uint64_t offset) const;
+    uint32_t u32(uint64_t offset) const;
+    uint32_t offsetAt(uint32_t index) const;
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Info _info = {};
+    uint64_t _table = 0;
+};
@@ -0,0 +1,369 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PeImage.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint16_t DOS_MAGIC = 0x5a4d;     // MZ
+    constexpr uint32_t PE_SIGNATURE = 0x4550;  // PE\0\0
+    constexpr uint32_t MAX_DATA_DIRECTORIES = 16;
+    constexpr uint32_t MAX_NAME_LENGTH = 64 * 1024;
+
+    constexpr uint32_t IMPORT_DESCRIPTOR_SIZE = 20;
+    constexpr uint32_t EXPORT_DIRECTORY_SIZE = 40;
+    constexpr uint32_t RESOURCE_DIRECTORY_SIZE = 16;
+    constexpr uint32_t RESOURCE_ENTRY_SIZE = 8;
+    constexpr uint32_t RESOURCE_DATA_ENTRY_SIZE = 16;
+    constexpr uint32_t HIGH_BIT = 0x80000000;
+
+    // offsets within IMAGE_OPTIONAL_HEADER32 / IMAGE_OPTIONAL_HEADER64
+    constexpr uint32_t SIZE_OF_HEADERS_OFFSET = 60;
+    constexpr uint32_t DIRECTORY_COUNT_OFFSET_32 = 92;
+    constexpr uint32_t DIRECTORY_COUNT_OFFSET_64 = 108;
+
+    uint16_t Read16(const uint8_t* p)
+    {
+        uint16_t value;
+        memcpy(&value, p, sizeof value);
+        return value;
+    }
+
+    uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof value);
+        return value;
+    }
+
+    uint64_t Read64(const uint8_t* p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof value);
+        return value;
+    }
+}
+
+bool PeImage::Open(const MappedFile::PathChar* path)
+{
+    return _file.Open(path) && Parse(_file.Data(), _file.Size());
+}
+
+bool PeImage::Parse(const uint8_t* data, uint64_t size)
+{
+    _data = data;
+    _size = size;
+    _headers = {};
+    _unnamedExports.clear();
+    _unnamedExportsBuilt = false;
+
+    auto dos = reinterpret_cast<const DosHeader*>(at(0, sizeof(DosHeader)));
+    if (dos == nullptr || dos->magic != DOS_MAGIC)
+        return false;
+
+    auto signature = at(dos->newHeaderOffset, 4 + sizeof(FileHeader));
+    if (signature == nullptr || Read32(signature) != PE_SIGNATURE)
+        return false;
+
+    auto file = reinterpret_cast<const FileHeader*>(signature + 4);
+    auto optionalOffset = static_cast<uint64_t>(dos->newHeaderOffset) + 4 + sizeof(FileHeader);
+    auto optional = at(optionalOffset, file->sizeOfOptionalHeader);
+    if (optional == nullptr || file->sizeOfOptionalHeader < 2)
+        return false;
+
+    uint32_t countOffset;
+    switch (Read16(optional))
+    {
+    case PE32:
+        countOffset = DIRECTORY_COUNT_OFFSET_32;
+        break;
+    case PE32_PLUS:
+        countOffset = DIRECTORY_COUNT_OFFSET_64;
+        break;
+    default:
+        return false; // ROM images and garbage
+    }
+
+    if (file->sizeOfOptionalHeader < countOffset + 4)
+        return false;
+
+    // trust neither NumberOfRvaAndSizes nor SizeOfOptionalHeader alone
+    auto directoryCount = std::min({Read32(optional + countOffset), MAX_DATA_DIRECTORIES,
+                                    (file->sizeOfOptionalHeader - countOffset - 4) / static_cast<uint32_t>(sizeof(DataDirectory))});
+
+    // a truncated section table keeps the sections which are there
+    auto sectionOffset = optionalOffset + file->sizeOfOptionalHeader;
+    auto sectionCount = sectionOffset <= size
+                            ? static_cast<uint32_t>(std::min<uint64_t>(file->numberOfSections,
+                                                                       (size - sectionOffset) / sizeof(SectionHeader)))
+                            : 0;
+
+    _headers.dosHeader = dos;
+    _headers.fileHeader = file;
+    _headers.optionalHeader = optional;
+    _headers.optionalHeaderMagic = Read16(optional);
+    _headers.dataDirectories = reinterpret_cast<const DataDirectory*>(optional + countOffset + 4);
+    _headers.numberOfDataDirectories = directoryCount;
+    _headers.sections = reinterpret_cast<const SectionHeader*>(_data + sectionOffset);
+    _headers.numberOfSections = sectionCount;
+    _headers.fileSize = size;
+    return true;
+}
+
+const uint8_t* PeImage::at(uint64_t offset, uint64_t size) const
+{
+    if (_data == nullptr || offset > _size || size > _size - offset)
+        return nullptr;
+
+    return _data + offset;
+}
+
+const PeImage::DataDirectory* PeImage::directory(uint32_t index) const
+{
+    if (index >= _headers.numberOfDataDirectories)
+        return nullptr;
+
+    auto dir = &_headers.dataDirectories[index];
+    return dir->virtualAddress != 0 ? dir : nullptr;
+}
+
+const uint8_t* PeImage::RvaToPointer(uint32_t rva, uint32_t size) const
+{
+    if (_headers.optionalHeader == nullptr)
+        return nullptr;
+
+    auto sizeOfHeaders = Read32(static_cast<const uint8_t*>(_headers.optionalHeader) + SIZE_OF_HEADERS_OFFSET);
+    if (static_cast<uint64_t>(rva) + size <= sizeOfHeaders)
+        return at(rva, size);
+
+    for (uint32_t i = 0; i < _headers.numberOfSections; i++)
+    {
+        auto& section = _headers.sections[i];
+        if (rva < section.virtualAddress)
+            continue;
+
+        // only the part backed by the file can be handed out
+        auto delta = static_cast<uint64_t>(rva) - section.virtualAddress;
+        if (delta + size <= section.sizeOfRawData)
+            return at(section.pointerToRawData + delta, size);
+    }
+    return nullptr;
+}
+
+const char* PeImage::stringAt(uint32_t rva) const
+{
+    auto p = RvaToPointer(rva, 1);
+    if (p == nullptr)
+        return nullptr;
+
+    auto limit = static_cast<size_t>(std::min<uint64_t>(_data + _size - p, MAX_NAME_LENGTH));
+    return memchr(p, 0, limit) != nullptr ? reinterpret_cast<const char*>(p) : nullptr;
+}
+
+uint32_t PeImage::ReadImports(ImportCursor* cursor, ImportEntry* entries, uint32_t count) const
+{
+    auto dir = directory(IMPORT_DIRECTORY);
+    if (dir == nullptr)
+        return 0;
+
+    auto thunkSize = _headers.optionalHeaderMagic == PE32_PLUS ? 8u : 4u;
+    uint32_t filled = 0;
+
+    while (filled < count)
+    {
+        auto descriptorRva = static_cast<uint64_t>(dir->virtualAddress) + static_cast<uint64_t>(cursor->descriptor) * IMPORT_DESCRIPTOR_SIZE;
+        auto descriptor = descriptorRva <= UINT32_MAX ? RvaToPointer(static_cast<uint32_t>(descriptorRva), IMPORT_DESCRIPTOR_SIZE) : nullptr;
+        if (descriptor == nullptr)
+            break;
+
+        auto lookupTable = Read32(descriptor);
+        auto nameRva = Read32(descriptor + 12);
+        auto addressTable = Read32(descriptor + 16);
+        if (nameRva == 0 && addressTable == 0)
+            break; // the terminating null descriptor
+
+        // bound imports overwrite the address table on disk, the lookup table keeps the names
+        auto table = lookupTable != 0 ? lookupTable : addressTable;
+        auto thunkRva = static_cast<uint64_t>(table) + static_cast<uint64_t>(cursor->thunk) * thunkSize;
+        auto thunk = thunkRva <= UINT32_MAX ? RvaToPointer(static_cast<uint32_t>(thunkRva), thunkSize) : nullptr;
+        auto value = thunk == nullptr ? 0 : thunkSize == 8 ? Read64(thunk) : Read32(thunk);
+
+        if (value == 0)
+        {
+            cursor->descriptor++;
+            cursor->thunk = 0;
+            continue;
+        }
+
+        cursor->thunk++;
+
+        auto& entry = entries[filled++];
+        entry.module = stringAt(nameRva);
+
+        auto byOrdinal = thunkSize == 8 ? (value >> 63) != 0 : (value & HIGH_BIT) != 0;
+        if (byOrdinal)
+        {
+            entry.name = nullptr;
+            entry.ordinal = static_cast<uint32_t>(value & 0xffff);
+        }
+        else
+        {
+            auto hintName = static_cast<uint32_t>(value & 0x7fffffff);
+            auto hint = RvaToPointer(hintName, 2);
+            entry.ordinal = hint != nullptr ? Read16(hint) : 0;
+            entry.name = stringAt(hintName + 2);
+        }
+    }
+    return filled;
+}
+
+uint32_t PeImage::ReadExports(uint32_t start, ExportEntry* entries, uint32_t count)
+{
+    auto dir = directory(EXPORT_DIRECTORY);
+    if (dir == nullptr)
+        return 0;
+
+    auto exports = RvaToPointer(dir->virtualAddress, EXPORT_DIRECTORY_SIZE);
+    if (exports == nullptr)
+        return 0;
+
+    auto base = Read32(exports + 16);
+    auto numberOfFunctions = Read32(exports + 20);
+    auto numberOfNames = Read32(exports + 24);
+
+    // tables which do not fit into the file are treated as empty
+    auto functions = numberOfFunctions <= UINT32_MAX / 4 ? RvaToPointer(Read32(exports + 28), numberOfFunctions * 4) : nullptr;
+    auto names = numberOfNames <= UINT32_MAX / 4 ? RvaToPointer(Read32(exports + 32), numberOfNames * 4) : nullptr;
+    auto ordinals = numberOfNames <= UINT32_MAX / 2 ? RvaToPointer(Read32(exports + 36), numberOfNames * 2) : nullptr;
+    if (functions == nullptr)
+        return 0;
+    if (names == nullptr || ordinals == nullptr)
+        numberOfNames = 0;
+
+    auto makeEntry = [&](ExportEntry& entry, uint32_t index, const char* name)
+    {
+        auto rva = Read32(functions + static_cast<size_t>(index) * 4);
+        auto forwarded = rva >= dir->virtualAddress && rva - dir->virtualAddress < dir->size;
+
+        entry.name = name;
+        entry.forwarder = forwarded ? stringAt(rva) : nullptr;
+        entry.ordinal = base + index;
+        entry.rva = forwarded ? 0 : rva;
+    };
+
+    uint32_t filled = 0;
+
+    // named exports first, straight from the name table
+    for (; filled < count && start < numberOfNames; start++)
+    {
+        auto index = Read16(ordinals + static_cast<size_t>(start) * 2);
+        if (index >= numberOfFunctions)
+            continue;
+
+        makeEntry(entries[filled++], index, stringAt(Read32(names + static_cast<size_t>(start) * 4)));
+    }
+
+    if (filled == count || start < numberOfNames)
+        return filled;
+
+    // then the ones exported by ordinal only
+    if (!_unnamedExportsBuilt)
+    {
+        std::vector<bool> named(numberOfFunctions);
+        for (uint32_t i = 0; i < numberOfNames; i++)
+        {
+            auto index = Read16(ordinals + static_cast<size_t>(i) * 2);
+            if (index < numberOfFunctions)
+                named[index] = true;
+        }
+
+        for (uint32_t i = 0; i < numberOfFunctions; i++)
+            if (!named[i] && Read32(functions + static_cast<size_t>(i) * 4) != 0)
+                _unnamedExports.push_back(i);
+
+        _unnamedExportsBuilt = true;
+    }
+
+    for (auto i = static_cast<uint64_t>(start) - numberOfNames; filled < count && i < _unnamedExports.size(); i++)
+        makeEntry(entries[filled++], _unnamedExports[static_cast<size_t>(i)], nullptr);
+
+    return filled;
+}
+
+uint32_t PeImage::ReadResources(uint32_t directoryOffset, uint32_t start, ResourceEntry* entries, uint32_t count) const
+{
+    auto dir = directory(RESOURCE_DIRECTORY);
+    if (dir == nullptr)
+        return 0;
+
+    auto resourceAt = [&](uint32_t offset, uint32_t size) -> const uint8_t*
+    {
+        auto rva = static_cast<uint64_t>(dir->virtualAddress) + offset;
+        return rva <= UINT32_MAX ? RvaToPointer(static_cast<uint32_t>(rva), size) : nullptr;
+    };
+
+    auto directoryHeader = resourceAt(directoryOffset, RESOURCE_DIRECTORY_SIZE);
+    if (directoryHeader == nullptr)
+        return 0;
+
+    auto total = static_cast<uint32_t>(Read16(directoryHeader + 12)) + Read16(directoryHeader + 14);
+    uint32_t filled = 0;
+
+    for (auto i = start; filled < count && i < total; i++)
+    {
+        auto raw = resourceAt(directoryOffset + RESOURCE_DIRECTORY_SIZE + i * RESOURCE_ENTRY_SIZE, RESOURCE_ENTRY_SIZE);
+        if (raw == nullptr)
+            break;
+
+        auto& entry = entries[filled++];
+        entry = {};
+
+        auto name = Read32(raw);
+        if (name & HIGH_BIT)
+        {
+            auto string = resourceAt(name & ~HIGH_BIT, 2);
+            auto length = string != nullptr ? Read16(string) : 0u;
+            auto text = string != nullptr ? resourceAt((name & ~HIGH_BIT) + 2, length * 2) : nullptr;
+
+            entry.name = reinterpret_cast<const uint16_t*>(text);
+            entry.nameLength = text != nullptr ? length : 0;
+        }
+        else
+        {
+            entry.id = name & 0xffff;
+        }
+
+        auto target = Read32(raw + 4);
+        entry.isDirectory = (target & HIGH_BIT) != 0;
+        entry.offset = target & ~HIGH_BIT;
+
+        if (!entry.isDirectory)
+        {
+            auto leaf = resourceAt(entry.offset, RESOURCE_DATA_ENTRY_SIZE);
+            if (leaf != nullptr)
+            {
+                entry.dataSize = Read32(leaf + 4);
+                entry.codePage = Read32(leaf + 8);
+                entry.data = RvaToPointer(Read32(leaf), entry.dataSize);
+            }
+        }
+    }
+    return filled;
+}
@@ -0,0 +1,164 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <vector>
+
+// Zero-copy PE/COFF image reader. Headers, the section table and the data directories are returned
+// as pointers into the mapped file; import, export and resource tables are walked page by page on
+// request, so opening a multi-gigabyte image only touches its headers.
+//
+// Every pointer handed out stays valid until the PeImage is destroyed.
+class PeImage
+{
+public:
+#pragma pack(push, 1)
+    struct DosHeader
+    {
+        uint16_t magic;
+        uint16_t fields[29];
+        uint32_t newHeaderOffset;
+    };
+
+    struct FileHeader
+    {
+        uint16_t machine;
+        uint16_t numberOfSections;
+        uint32_t timeDateStamp;
+        uint32_t pointerToSymbolTable;
+        uint32_t numberOfSymbols;
+        uint16_t sizeOfOptionalHeader;
+        uint16_t characteristics;
+    };
+
+    struct DataDirectory
+    {
+        uint32_t virtualAddress;
+        uint32_t size;
+    };
+
+    struct SectionHeader
+    {
+        uint8_t name[8];
+        uint32_t virtualSize;
+        uint32_t virtualAddress;
+        uint32_t sizeOfRawData;
+        uint32_t pointerToRawData;
+        uint32_t pointerToRelocations;
+        uint32_t pointerToLineNumbers;
+        uint16_t numberOfRelocations;
+        uint16_t numberOfLineNumbers;
+        uint32_t characteristics;
+    };
+#pragma pack(pop)
+
+    enum OptionalHeaderMagic
+    {
+        PE32 = 0x10b,
+        PE32_PLUS = 0x20b,
+    };
+
+    enum DirectoryIndex
+    {
+        EXPORT_DIRECTORY = 0,
+        IMPORT_DIRECTORY = 1,
+        RESOURCE_DIRECTORY = 2,
+    };
+
+    // Must match PEImageHeaders in QuickLook.Plugin.PEViewer/PEImageParser/NativePEImage.cs
+    struct Headers
+    {
+        const DosHeader* dosHeader;
+        const FileHeader* fileHeader;
+        const void* optionalHeader; // IMAGE_OPTIONAL_HEADER32 or IMAGE_OPTIONAL_HEADER64, see optionalHeaderMagic
+        const DataDirectory* dataDirectories;
+        const SectionHeader* sections;
+        uint64_t fileSize;
+        uint32_t optionalHeaderMagic;
+        uint32_t numberOfDataDirectories;
+        uint32_t numberOfSections;
+    };
+
+    // Position of the next import; start from {0, 0}.
+    struct ImportCursor
+    {
+        uint32_t descriptor;
+        uint32_t thunk;
+    };
+
+    struct ImportEntry
+    {
+        const char* module;
+        const char* name; // nullptr when imported by ordinal
+        uint32_t ordinal; // the hint when imported by name
+    };
+
+    struct ExportEntry
+    {
+        const char* name;      // nullptr for exports without a name
+        const char* forwarder; // "DLL.Function" when the export is forwarded
+        uint32_t ordinal;
+        uint32_t rva;
+    };
+
+    struct ResourceEntry
+    {
+        const uint16_t* name; // UTF-16, not terminated, may be unaligned; nullptr when the entry has an integer id
+        uint32_t nameLength;
+        uint32_t id;
+        uint32_t isDirectory;
+        uint32_t offset;      // of the sub-directory within the resource section, for ReadResources
+        const void* data;     // leaf entries only
+        uint32_t dataSize;
+        uint32_t codePage;
+    };
+
+    bool Open(const MappedFile::PathChar* path);
+    // the buffer is not copied and must outlive this object
+    bool Parse(const uint8_t* data, uint64_t size);
+
+    const Headers& GetHeaders() const
+    {
+        return _headers;
+    }
+
+    // Each Read* call fills up to count entries and returns how many it filled; 0 means the end.
+    uint32_t ReadImports(ImportCursor* cursor, ImportEntry* entries, uint32_t count) const;
+    uint32_t ReadExports(uint32_t start, ExportEntry* entries, uint32_t count);
+    // directoryOffset 0 is the root directory
+    uint32_t ReadResources(uint32_t directoryOffset, uint32_t start, ResourceEntry* entries, uint32_t count) const;
+
+    const uint8_t* RvaToPointer(uint32_t rva, uint32_t size) const;
+
+private:
+    const char* stringAt(uint32_t rva) const;
+    const uint8_t* at(uint64_t offset, uint64_t size) const;
+    const DataDirectory* directory(uint32_t index) const;
+
+    MappedFile _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    Headers _headers = {};
+
+    // function indices without a name; built the first time nameless exports are asked for
+    std::vector<uint32_t> _unnamedExports;
+    bool _unnamedExportsBuilt = false;
+};
@@ -0,0 +1,247 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stdafx.h"
+#include "ProviderInit.h"
+#include "WoW64HookHelper.h"
+#include "DOpus.h"
+#include "MultiCommander.h"
+
+namespace
+{
+    struct MessageWindowStart
+    {
+        bool (*prepare)();
+        HANDLE hReady;
+        bool result;
+    };
+
+    INIT_ONCE initOnce[ProviderInit::PROVIDER_COUNT] = {INIT_ONCE_STATIC_INIT, INIT_ONCE_STATIC_INIT, INIT_ONCE_STATIC_INIT};
+    SRWLOCK helperLock = SRWLOCK_INIT;
+
+    // cold initialisation cost of each provider, 0 until it has been initialised
+    volatile LONG64 coldInitMicroseconds[ProviderInit::PROVIDER_COUNT] = {};
+    volatile LONG preWarmed[ProviderInit::PROVIDER_COUNT] = {};
+    volatile LONG preWarmRunning = FALSE;
+    // from PreWarm until the pre-warm thread is done with every running file manager
+    volatile LONG64 preWarmMicroseconds = 0;
+    LARGE_INTEGER preWarmStart = {};
+
+    // first GetCurrentSelection of each provider which had to wait for its initialisation, and the
+    // first which found it ready; 0 until there has been one
+    volatile LONG64 coldSelectionMicroseconds[ProviderInit::PROVIDER_COUNT] = {};
+    volatile LONG64 warmSelectionMicroseconds[ProviderInit::PROVIDER_COUNT] = {};
+
+    // the selection being timed on this thread: when it started, and the provider it went through
+    thread_local LARGE_INTEGER selectionStart = {};
+    thread_local int selectionProvider = ProviderInit::PROVIDER_COUNT;
+    thread_local bool selectionWasReady = false;
+
+    LONGLONG ElapsedMicroseconds(const LARGE_INTEGER& start)
+    {
+        LARGE_INTEGER now, frequency;
+        QueryPerformanceCounter(&now);
+        QueryPerformanceFrequency(&frequency);
+        return (now.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart;
+    }
+}
+
+void ProviderInit::PreWarm()
+{
+    if (InterlockedExchange(&preWarmRunning, TRUE))
+        return;
+
+    QueryPerformanceCounter(&preWarmStart);
+
+    auto hThread = CreateThread(nullptr, 0, preWarmThreadProc, nullptr, 0, nullptr);
+    if (hThread != nullptr)
+        CloseHandle(hThread);
+}
+
+bool ProviderInit::Ensure(Provider provider)
+{
+    if (selectionProvider == PROVIDER_COUNT)
+    {
+        selectionProvider = provider;
+        selectionWasReady = isReady(provider);
+    }
+
+    if (provider == WOW64HOOKHELPER)
+    {
+#ifndef WIN64
+        return true;
+#else
+        // the helper may exit at any time, so it is re-launched on demand rather than once
+        if (WoW64HookHelper::CheckStatus())
+            return true;
+
+        AcquireSRWLockExclusive(&helperLock);
+
+        auto ret = WoW64HookHelper::CheckStatus();
+        if (!ret)
+        {
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            ret = WoW64HookHelper::Launch();
+
+            InterlockedCompareExchange64(&coldInitMicroseconds[WOW64HOOKHELPER], ElapsedMicroseconds(start), 0);
+        }
+
+        ReleaseSRWLockExclusive(&helperLock);
+        return ret;
+#endif
+    }
+
+    PVOID context = nullptr;
+    return InitOnceExecuteOnce(&initOnce[provider], initOnceCallback, reinterpret_cast<PVOID>(provider), &context)
+        && context != nullptr;
+}
+
+void ProviderInit::BeginSelection()
+{
+    selectionProvider = PROVIDER_COUNT;
+    QueryPerformanceCounter(&selectionStart);
+}
+
+void ProviderInit::EndSelection()
+{
+    // selections from Explorer and the other providers without an initialisation are not of interest
+    if (selectionProvider == PROVIDER_COUNT)
+        return;
+
+    auto& first = selectionWasReady ? warmSelectionMicroseconds : coldSelectionMicroseconds;
+    InterlockedCompareExchange64(&first[selectionProvider], max(ElapsedMicroseconds(selectionStart), 1LL), 0);
+    selectionProvider = PROVIDER_COUNT;
+}
+
+void ProviderInit::FillDiagnostics(Diagnostics* diagnostics)
+{
+    diagnostics->wow64HookHelperInitMicroseconds = InterlockedCompareExchange64(&coldInitMicroseconds[WOW64HOOKHELPER], 0, 0);
+    diagnostics->dopusInitMicroseconds = InterlockedCompareExchange64(&coldInitMicroseconds[DOPUS], 0, 0);
+    diagnostics->multiCommanderInitMicroseconds = InterlockedCompareExchange64(&coldInitMicroseconds[MULTICOMMANDER], 0, 0);
+    diagnostics->dopusPreWarmed = preWarmed[DOPUS];
+    diagnostics->multiCommanderPreWarmed = preWarmed[MULTICOMMANDER];
+    diagnostics->preWarmMicroseconds = InterlockedCompareExchange64(&preWarmMicroseconds, 0, 0);
+
+    diagnostics->wow64HookHelperColdSelectionMicroseconds = InterlockedCompareExchange64(&coldSelectionMicroseconds[WOW64HOOKHELPER], 0, 0);
+    diagnostics->wow64HookHelperWarmSelectionMicroseconds = InterlockedCompareExchange64(&warmSelectionMicroseconds[WOW64HOOKHELPER], 0, 0);
+    diagnostics->dopusColdSelectionMicroseconds = InterlockedCompareExchange64(&coldSelectionMicroseconds[DOPUS], 0, 0);
+    diagnostics->dopusWarmSelectionMicroseconds = InterlockedCompareExchange64(&warmSelectionMicroseconds[DOPUS], 0, 0);
+    diagnostics->multiCommanderColdSelectionMicroseconds = InterlockedCompareExchange64(&coldSelectionMicroseconds[MULTICOMMANDER], 0, 0);
+    diagnostics->multiCommanderWarmSelectionMicroseconds = InterlockedCompareExchange64(&warmSelectionMicroseconds[MULTICOMMANDER], 0, 0);
+}
+
+DWORD WINAPI ProviderInit::preWarmThreadProc(LPVOID lpParam)
+{
+    // stay out of the way of QuickLook's own startup, including its disk I/O
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+    // Only file managers which are running right now are worth preparing for. The WoW64 helper is
+    // never pre-warmed: most users never preview from a 32-bit dialog, so it waits for the first match.
+    if (DOpus::IsRunning() && Ensure(DOPUS))
+        InterlockedExchange(&preWarmed[DOPUS], TRUE);
+
+    if (MultiCommander::IsRunning() && Ensure(MULTICOMMANDER))
+        InterlockedExchange(&preWarmed[MULTICOMMANDER], TRUE);
+
+    InterlockedExchange64(&preWarmMicroseconds, ElapsedMicroseconds(preWarmStart));
+
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+    return 0;
+}
+
+bool ProviderInit::isReady(Provider provider)
+{
+    if (provider == WOW64HOOKHELPER)
+    {
+#ifndef WIN64
+        return true;
+#else
+        return WoW64HookHelper::CheckStatus();
+#endif
+    }
+
+    BOOL pending = FALSE;
+    return InitOnceBeginInit(&initOnce[provider], INIT_ONCE_CHECK_ONLY, &pending, nullptr) && !pending;
+}
+
+BOOL CALLBACK ProviderInit::initOnceCallback(PINIT_ONCE initOnce, PVOID parameter, PVOID* context)
+{
+    auto provider = static_cast<Provider>(reinterpret_cast<INT_PTR>(parameter));
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    auto ret = false;
+    switch (provider)
+    {
+    case DOPUS:
+        ret = startMessageWindowThread(DOpus::PrepareMessageWindow);
+        break;
+    case MULTICOMMANDER:
+        ret = startMessageWindowThread(MultiCommander::PrepareMessageWindow);
+        break;
+    default:
+        break;
+    }
+
+    InterlockedExchange64(&coldInitMicroseconds[provider], ElapsedMicroseconds(start));
+
+    // a failed provider is not retried; the result is handed to Ensure through the context
+    *context = ret ? reinterpret_cast<PVOID>(static_cast<INT_PTR>(1) << INIT_ONCE_CTX_RESERVED_BITS) : nullptr;
+    return TRUE;
+}
+
+bool ProviderInit::startMessageWindowThread(bool (*prepare)())
+{
+    // A message window only receives WM_COPYDATA while its thread pumps messages, so it gets its
+    // own thread instead of living on whichever short-lived thread happened to call us first.
+    MessageWindowStart start = {prepare, CreateEvent(nullptr, TRUE, FALSE, nullptr), false};
+    if (start.hReady == nullptr)
+        return false;
+
+    auto hThread = CreateThread(nullptr, 0, messageWindowThreadProc, &start, 0, nullptr);
+    if (hThread != nullptr)
+    {
+        WaitForSingleObject(start.hReady, INFINITE);
+        CloseHandle(hThread);
+    }
+
+    CloseHandle(start.hReady);
+    return start.result;
+}
+
+DWORD WINAPI ProviderInit::messageWindowThreadProc(LPVOID lpParam)
+{
+    auto start = static_cast<MessageWindowStart*>(lpParam);
+
+    auto result = start->prepare();
+    start->result = result;
+    SetEvent(start->hReady); // start is gone after this
+
+    if (!result)
+        return 1;
+
+    MSG msg;
+    while (GetMessage(&msg, nullptr, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    return 0;
+}
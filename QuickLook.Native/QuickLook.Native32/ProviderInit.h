@@ -0,0 +1,55 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Diagnostics.h"
+
+// Providers which need a helper process or a message window are initialised lazily: either on
+// their first match in GetCurrentSelection, or by a low-priority pre-warm thread started from Init
+// when their file manager is already running. Nothing is launched for providers the user never hits.
+//
+// For the cold-versus-warm comparison, GetCurrentSelection is timed between BeginSelection and
+// EndSelection: per provider, the first selection that found it still uninitialised and the first
+// one that found it ready are reported through GetDiagnostics.
+class ProviderInit
+{
+public:
+    enum Provider
+    {
+        WOW64HOOKHELPER,
+        DOPUS,
+        MULTICOMMANDER,
+        PROVIDER_COUNT,
+    };
+
+    static void PreWarm();
+    static bool Ensure(Provider provider);
+
+    static void BeginSelection();
+    static void EndSelection();
+
+    static void FillDiagnostics(Diagnostics* diagnostics);
+
+private:
+    static DWORD WINAPI preWarmThreadProc(LPVOID lpParam);
+    static DWORD WINAPI messageWindowThreadProc(LPVOID lpParam);
+    static BOOL CALLBACK initOnceCallback(PINIT_ONCE initOnce, PVOID parameter, PVOID* context);
+    static bool isReady(Provider provider);
+    static bool startMessageWindowThread(bool (*prepare)());
+};
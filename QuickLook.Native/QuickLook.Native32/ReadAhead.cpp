@@ -0,0 +1,362 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stdafx.h"
+#include "ReadAhead.h"
+
+#include <string>
+
+namespace
+{
+    constexpr ULONGLONG HEAD_SIZE = 4 * 1024 * 1024;
+    constexpr ULONGLONG PDF_TAIL_SIZE = 256 * 1024;
+    constexpr ULONGLONG MAX_TAIL_REGION = 32 * 1024 * 1024;
+
+    // the zip end of central directory record sits within the last 64 KiB (comment) + 22 bytes
+    constexpr DWORD ZIP_EOCD_SEARCH = 0xFFFF + 22;
+    constexpr int MAX_MP4_BOXES = 256;
+
+    // several reads in flight keep network shares and NCQ disks busy
+    constexpr DWORD CHUNK_SIZE = 1024 * 1024;
+    constexpr int QUEUE_DEPTH = 4;
+
+    SRWLOCK lock = SRWLOCK_INIT;
+    std::wstring pendingPath;
+
+    HANDLE hRequestEvent = nullptr;
+    PBYTE buffers[QUEUE_DEPTH] = {};
+
+    volatile LONG enabled = FALSE;
+    volatile LONG generation = 0;
+
+    volatile LONG64 requests = 0;
+    volatile LONG64 bytesRead = 0;
+    volatile LONG64 cancelled = 0;
+
+    DWORD ReadBigEndian32(const BYTE* p)
+    {
+        return static_cast<DWORD>(p[0]) << 24 | static_cast<DWORD>(p[1]) << 16 | static_cast<DWORD>(p[2]) << 8 | p[3];
+    }
+
+    DWORD ReadLittleEndian32(const BYTE* p)
+    {
+        return static_cast<DWORD>(p[3]) << 24 | static_cast<DWORD>(p[2]) << 16 | static_cast<DWORD>(p[1]) << 8 | p[0];
+    }
+}
+
+void ReadAhead::SetEnabled(bool value)
+{
+    if (value && hRequestEvent == nullptr)
+    {
+        AcquireSRWLockExclusive(&lock);
+        if (hRequestEvent == nullptr)
+        {
+            for (auto& buffer : buffers)
+                buffer = static_cast<PBYTE>(VirtualAlloc(nullptr, CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+            auto hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+            auto hThread = hEvent != nullptr ? CreateThread(nullptr, 0, workerThreadProc, hEvent, 0, nullptr) : nullptr;
+            if (hThread != nullptr)
+            {
+                CloseHandle(hThread);
+                hRequestEvent = hEvent;
+            }
+            else if (hEvent != nullptr)
+            {
+                CloseHandle(hEvent);
+            }
+        }
+        ReleaseSRWLockExclusive(&lock);
+    }
+
+    InterlockedExchange(&enabled, value && hRequestEvent != nullptr ? TRUE : FALSE);
+
+    // disabling cancels whatever is in flight, and the same selection may be asked for again afterwards
+    if (!value)
+    {
+        AcquireSRWLockExclusive(&lock);
+        pendingPath.clear();
+        InterlockedIncrement(&generation);
+        ReleaseSRWLockExclusive(&lock);
+    }
+}
+
+void ReadAhead::Request(PCWCHAR path)
+{
+    if (!enabled || path == nullptr || path[0] == L'\0')
+        return;
+
+    // FocusMonitor and repeated key presses keep resolving the same selection; only a different file
+    // may cancel the read-ahead in flight
+    AcquireSRWLockExclusive(&lock);
+    auto changed = pendingPath != path;
+    if (changed)
+    {
+        pendingPath = path;
+        InterlockedIncrement(&generation);
+    }
+    ReleaseSRWLockExclusive(&lock);
+
+    if (!changed)
+        return;
+
+    InterlockedIncrement64(&requests);
+    SetEvent(hRequestEvent);
+}
+
+void ReadAhead::FillDiagnostics(Diagnostics* diagnostics)
+{
+    diagnostics->readAheadRequests = InterlockedCompareExchange64(&requests, 0, 0);
+    diagnostics->readAheadBytes = InterlockedCompareExchange64(&bytesRead, 0, 0);
+    diagnostics->readAheadCancelled = InterlockedCompareExchange64(&cancelled, 0, 0);
+}
+
+DWORD WINAPI ReadAhead::workerThreadProc(LPVOID lpParam)
+{
+    auto hEvent = static_cast<HANDLE>(lpParam);
+
+    // CPU work here is negligible; keep normal I/O priority, the whole point is to be early
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+    LONG lastGeneration = 0;
+
+    while (WaitForSingleObject(hEvent, INFINITE) == WAIT_OBJECT_0)
+    {
+        AcquireSRWLockShared(&lock);
+        auto path = pendingPath;
+        auto current = generation;
+        ReleaseSRWLockShared(&lock);
+
+        // the generation only moves when the path does, so an unchanged one has been handled already
+        if (current == lastGeneration || path.empty())
+            continue;
+
+        lastGeneration = current;
+        prefetch(path.c_str(), current);
+    }
+    return 0;
+}
+
+void ReadAhead::prefetch(PCWCHAR path, LONG current)
+{
+    std::wstring unquoted = path;
+    if (unquoted.size() > 2 && unquoted.front() == L'"' && unquoted.back() == L'"')
+        unquoted = unquoted.substr(1, unquoted.size() - 2);
+
+    // never recall cloud placeholders or offline files just because they got selected
+    auto attributes = GetFileAttributes(unquoted.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES ||
+        (attributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_OFFLINE | FILE_ATTRIBUTE_RECALL_ON_OPEN |
+                       FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS)) != 0)
+        return;
+
+    auto hFile = CreateFile(unquoted.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(hFile);
+        return;
+    }
+
+    auto fileSize = static_cast<ULONGLONG>(size.QuadPart);
+    auto headEnd = min(fileSize, HEAD_SIZE);
+
+    if (readRange(hFile, 0, headEnd, current))
+    {
+        // the head is in the cache now, so sniffing and walking boxes is cheap
+        BYTE magic[8] = {};
+        readAt(hFile, 0, magic, sizeof magic);
+
+        ULONGLONG begin = 0, end = 0;
+        auto found = false;
+
+        if (memcmp(magic, "PK\x03\x04", 4) == 0)
+            found = findZipCentralDirectory(hFile, fileSize, &begin, &end);
+        else if (memcmp(magic + 4, "ftyp", 4) == 0)
+            found = findMp4MovieBox(hFile, fileSize, &begin, &end);
+        else if (memcmp(magic, "%PDF", 4) == 0)
+        {
+            // cross-reference table and trailer
+            begin = fileSize > PDF_TAIL_SIZE ? fileSize - PDF_TAIL_SIZE : 0;
+            end = fileSize;
+            found = true;
+        }
+
+        if (found)
+        {
+            begin = max(begin, headEnd);
+            end = min(end, begin + MAX_TAIL_REGION);
+            if (begin < end)
+                readRange(hFile, begin, end, current);
+        }
+    }
+
+    CloseHandle(hFile);
+}
+
+bool ReadAhead::readRange(HANDLE hFile, ULONGLONG begin, ULONGLONG end, LONG current)
+{
+    OVERLAPPED overlapped[QUEUE_DEPTH] = {};
+    HANDLE events[QUEUE_DEPTH] = {};
+    int slots[QUEUE_DEPTH] = {};
+    auto pending = 0;
+    auto next = begin;
+    auto ok = true;
+
+    for (auto i = 0; i < QUEUE_DEPTH; i++)
+        overlapped[i].hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+    auto issue = [&](int slot)
+    {
+        auto length = static_cast<DWORD>(min(static_cast<ULONGLONG>(CHUNK_SIZE), end - next));
+
+        ResetEvent(overlapped[slot].hEvent);
+        overlapped[slot].Offset = static_cast<DWORD>(next);
+        overlapped[slot].OffsetHigh = static_cast<DWORD>(next >> 32);
+
+        if (!ReadFile(hFile, buffers[slot], length, nullptr, &overlapped[slot]) && GetLastError() != ERROR_IO_PENDING)
+            return false;
+
+        next += length;
+        slots[pending] = slot;
+        events[pending] = overlapped[slot].hEvent;
+        pending++;
+        return true;
+    };
+
+    for (auto i = 0; i < QUEUE_DEPTH && next < end && ok; i++)
+        ok = overlapped[i].hEvent != nullptr && buffers[i] != nullptr && issue(i);
+
+    while (pending > 0)
+    {
+        if (ok && generation != current)
+        {
+            CancelIoEx(hFile, nullptr);
+            InterlockedIncrement64(&cancelled);
+            ok = false;
+        }
+
+        auto index = WaitForMultipleObjects(pending, events, FALSE, INFINITE) - WAIT_OBJECT_0;
+        if (index >= static_cast<DWORD>(pending))
+        {
+            CancelIoEx(hFile, nullptr);
+            ok = false;
+            index = 0;
+        }
+
+        auto slot = slots[index];
+        DWORD transferred = 0;
+        if (GetOverlappedResult(hFile, &overlapped[slot], &transferred, TRUE))
+            InterlockedAdd64(&bytesRead, transferred);
+        else
+            ok = false;
+
+        pending--;
+        slots[index] = slots[pending];
+        events[index] = events[pending];
+
+        if (ok && next < end)
+            ok = issue(slot);
+    }
+
+    for (auto& o : overlapped)
+        if (o.hEvent != nullptr)
+            CloseHandle(o.hEvent);
+
+    return ok;
+}
+
+DWORD ReadAhead::readAt(HANDLE hFile, ULONGLONG offset, PBYTE buffer, DWORD size)
+{
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (overlapped.hEvent == nullptr)
+        return 0;
+
+    DWORD transferred = 0;
+    if (ReadFile(hFile, buffer, size, nullptr, &overlapped) || GetLastError() == ERROR_IO_PENDING)
+        GetOverlappedResult(hFile, &overlapped, &transferred, TRUE);
+
+    CloseHandle(overlapped.hEvent);
+    return transferred;
+}
+
+bool ReadAhead::findZipCentralDirectory(HANDLE hFile, ULONGLONG fileSize, ULONGLONG* begin, ULONGLONG* end)
+{
+    auto searchSize = static_cast<DWORD>(min(fileSize, static_cast<ULONGLONG>(ZIP_EOCD_SEARCH)));
+    auto tail = buffers[0];
+    if (tail == nullptr)
+        return false;
+
+    auto read = readAt(hFile, fileSize - searchSize, tail, searchSize);
+    if (read < 22)
+        return false;
+
+    for (auto i = static_cast<int>(read) - 22; i >= 0; i--)
+    {
+        if (memcmp(tail + i, "PK\x05\x06", 4) != 0)
+            continue;
+
+        // the tail itself is cached by now, which also covers zip64 archives (0xFFFFFFFF here)
+        auto cdSize = ReadLittleEndian32(tail + i + 12);
+        auto cdOffset = ReadLittleEndian32(tail + i + 16);
+        if (cdOffset == 0xFFFFFFFF || cdOffset >= fileSize)
+            return false;
+
+        *begin = cdOffset;
+        *end = min(fileSize, static_cast<ULONGLONG>(cdOffset) + cdSize);
+        return true;
+    }
+    return false;
+}
+
+bool ReadAhead::findMp4MovieBox(HANDLE hFile, ULONGLONG fileSize, ULONGLONG* begin, ULONGLONG* end)
+{
+    ULONGLONG offset = 0;
+
+    for (auto i = 0; i < MAX_MP4_BOXES && offset + 8 <= fileSize; i++)
+    {
+        BYTE header[16];
+        if (readAt(hFile, offset, header, sizeof header) < 8)
+            return false;
+
+        ULONGLONG boxSize = ReadBigEndian32(header);
+        if (boxSize == 1)
+            boxSize = static_cast<ULONGLONG>(ReadBigEndian32(header + 8)) << 32 | ReadBigEndian32(header + 12);
+        else if (boxSize == 0)
+            boxSize = fileSize - offset;
+
+        if (boxSize < 8)
+            return false;
+
+        if (memcmp(header + 4, "moov", 4) == 0)
+        {
+            *begin = offset;
+            *end = min(fileSize, offset + boxSize);
+            return true;
+        }
+
+        offset += boxSize;
+    }
+    return false;
+}
@@ -0,0 +1,42 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Diagnostics.h"
+
+// Opt-in read-ahead of the file GetCurrentSelection has just resolved. A background thread pulls
+// the head of the file, plus the tail regions a viewer jumps to first (zip central directory, MP4
+// moov box, PDF trailer), into the system file cache while QuickLook is still picking a plugin and
+// creating its window. Only the newest request matters; a new selection cancels the previous one.
+class ReadAhead
+{
+public:
+    static void SetEnabled(bool enabled);
+    static void Request(PCWCHAR path);
+
+    static void FillDiagnostics(Diagnostics* diagnostics);
+
+private:
+    static DWORD WINAPI workerThreadProc(LPVOID lpParam);
+    static void prefetch(PCWCHAR path, LONG generation);
+    static bool readRange(HANDLE hFile, ULONGLONG begin, ULONGLONG end, LONG generation);
+    static DWORD readAt(HANDLE hFile, ULONGLONG offset, PBYTE buffer, DWORD size);
+    static bool findZipCentralDirectory(HANDLE hFile, ULONGLONG fileSize, ULONGLONG* begin, ULONGLONG* end);
+    static bool findMp4MovieBox(HANDLE hFile, ULONGLONG fileSize, ULONGLONG* begin, ULONGLONG* end);
+};
@@ -0,0 +1,1074 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "RegexDfa.h"
+
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <string>
+
+namespace
+{
+    constexpr uint32_t NONE = UINT32_MAX;
+    constexpr uint32_t MAX_NFA_STATES = 200000;
+    constexpr uint32_t MAX_REPEAT = 1000;
+    constexpr uint32_t BMP = 0x10000;
+    constexpr uint32_t LINE_FEED = '\n';
+
+    typedef std::bitset<RegexDfa::SYMBOLS> SymbolSet;
+
+    struct NfaState
+    {
+        SymbolSet symbols;
+        uint32_t next = NONE; // where a symbol in symbols leads
+        std::vector<uint32_t> epsilon;
+        uint32_t match = RegexDfa::NO_MATCH;
+    };
+
+    // A piece of the NFA entered at start and left at end, which has no transitions of its own yet.
+    struct Fragment
+    {
+        uint32_t start;
+        uint32_t end;
+    };
+
+    // The characters of a class. Those of the Basic Multilingual Plane are kept one by one; the
+    // others are only ever all in, for negated classes, or all out.
+    struct CharSet
+    {
+        std::vector<uint64_t> bits = std::vector<uint64_t>(BMP / 64);
+        bool astral = false;
+
+        bool Has(uint32_t c) const
+        {
+            return c < BMP ? (bits[c / 64] >> (c % 64) & 1) != 0 : astral;
+        }
+
+        void Add(uint32_t c)
+        {
+            bits[c / 64] |= 1ull << (c % 64);
+        }
+
+        void Remove(uint32_t c)
+        {
+            bits[c / 64] &= ~(1ull << (c % 64));
+        }
+
+        void AddRange(uint32_t first, uint32_t last)
+        {
+            for (auto c = first; c <= last; c++)
+                Add(c);
+        }
+
+        void AddAll(const CharSet& other)
+        {
+            for (size_t i = 0; i < bits.size(); i++)
+                bits[i] |= other.bits[i];
+            astral = astral || other.astral;
+        }
+
+        // the complement never holds a line feed, so negated classes stay on one line
+        void Negate()
+        {
+            for (auto& word : bits)
+                word = ~word;
+            astral = !astral;
+            Remove(LINE_FEED);
+        }
+    };
+
+    inline bool isAsciiLetter(uint32_t c)
+    {
+        return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+    }
+
+    inline SymbolSet one(uint32_t symbol)
+    {
+        SymbolSet set;
+        set.set(symbol);
+        return set;
+    }
+
+    SymbolSet byteRange(uint32_t first, uint32_t last)
+    {
+        SymbolSet set;
+        for (auto b = first; b <= last; b++)
+            set.set(b);
+        return set;
+    }
+
+    uint32_t encodeUtf8(uint32_t c, uint8_t* out)
+    {
+        if (c < 0x80)
+        {
+            out[0] = static_cast<uint8_t>(c);
+            return 1;
+        }
+        if (c < 0x800)
+        {
+            out[0] = static_cast<uint8_t>(0xC0 | c >> 6);
+            out[1] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+            return 2;
+        }
+        if (c < 0x10000)
+        {
+            out[0] = static_cast<uint8_t>(0xE0 | c >> 12);
+            out[1] = static_cast<uint8_t>(0x80 | (c >> 6 & 0x3F));
+            out[2] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<uint8_t>(0xF0 | c >> 18);
+        out[1] = static_cast<uint8_t>(0x80 | (c >> 12 & 0x3F));
+        out[2] = static_cast<uint8_t>(0x80 | (c >> 6 & 0x3F));
+        out[3] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+        return 4;
+    }
+
+    // Thompson construction of the NFA, with every character turned into the bytes that encode it.
+    class Builder
+    {
+    public:
+        Builder(RegexDfa::Encoding encoding, bool ignoreCase, bool reverse)
+            : _encoding(encoding), _ignoreCase(ignoreCase), _reverse(reverse)
+        {
+        }
+
+        std::vector<NfaState> states;
+        bool usesLines = false;
+        bool usesWords = false;
+
+        void IgnoreCase(bool ignoreCase)
+        {
+            _ignoreCase = ignoreCase;
+        }
+
+        bool Full() const
+        {
+            return states.size() > MAX_NFA_STATES;
+        }
+
+        uint32_t Add()
+        {
+            states.emplace_back();
+            return static_cast<uint32_t>(states.size() - 1);
+        }
+
+        void Link(uint32_t from, uint32_t to)
+        {
+            states[from].epsilon.push_back(to);
+        }
+
+        Fragment Empty()
+        {
+            auto state = Add();
+            return {state, state};
+        }
+
+        Fragment Symbols(const SymbolSet& set)
+        {
+            auto start = Add();
+            auto end = Add();
+            states[start].symbols = set;
+            states[start].next = end;
+            return {start, end};
+        }
+
+        // a then b, or b then a when the patterns are reversed
+        Fragment Concat(Fragment a, Fragment b)
+        {
+            if (_reverse)
+                std::swap(a, b);
+            Link(a.end, b.start);
+            return {a.start, b.end};
+        }
+
+        Fragment Alternate(const std::vector<Fragment>& alternatives)
+        {
+            auto start = Add();
+            auto end = Add();
+            for (auto& alternative : alternatives)
+            {
+                Link(start, alternative.start);
+                Link(alternative.end, end);
+            }
+            return {start, end};
+        }
+
+        Fragment Star(Fragment a)
+        {
+            auto start = Add();
+            auto end = Add();
+            Link(start, a.start);
+            Link(start, end);
+            Link(a.end, a.start);
+            Link(a.end, end);
+            return {start, end};
+        }
+
+        Fragment Plus(Fragment a)
+        {
+            auto end = Add();
+            Link(a.end, a.start);
+            Link(a.end, end);
+            return {a.start, end};
+        }
+
+        Fragment Optional(Fragment a)
+        {
+            auto start = Add();
+            auto end = Add();
+            Link(start, a.start);
+            Link(start, end);
+            Link(a.end, end);
+            return {start, end};
+        }
+
+        bool Literal(uint32_t c, Fragment* out)
+        {
+            // each byte also takes the one of the other case of an ASCII letter
+            auto other = _ignoreCase && isAsciiLetter(c) ? c ^ 0x20 : c;
+            uint8_t bytes[4], otherBytes[4];
+            auto length = RegexDfa::Encode(c, _encoding, bytes);
+            if (length == 0)
+                return false;
+            RegexDfa::Encode(other, _encoding, otherBytes);
+
+            for (uint32_t i = 0; i < length; i++)
+            {
+                auto set = one(bytes[i]);
+                set.set(otherBytes[i]);
+                *out = i == 0 ? Symbols(set) : Concat(*out, Symbols(set));
+            }
+            return true;
+        }
+
+        // adds the other case of the ASCII letters in set; classes do this before they are negated
+        void Fold(CharSet* set) const
+        {
+            if (!_ignoreCase)
+                return;
+
+            for (uint32_t c = 'A'; c <= 'Z'; c++)
+            {
+                if (set->Has(c) || set->Has(c | 0x20))
+                {
+                    set->Add(c);
+                    set->Add(c | 0x20);
+                }
+            }
+        }
+
+        Fragment Class(const CharSet& set)
+        {
+            switch (_encoding)
+            {
+            case RegexDfa::BYTES:
+            {
+                SymbolSet bytes;
+                for (uint32_t b = 0; b < 0x100; b++)
+                    bytes.set(b, set.Has(b));
+                return Symbols(bytes);
+            }
+            case RegexDfa::UTF8:
+                return utf8Class(set);
+            default:
+                return utf16Class(set);
+            }
+        }
+
+    private:
+        // one UTF-16 code unit, whose bytes come in the order of the encoding
+        Fragment unit(const SymbolSet& low, const SymbolSet& high)
+        {
+            return _encoding == RegexDfa::UTF16LE ? Concat(Symbols(low), Symbols(high))
+                                                  : Concat(Symbols(high), Symbols(low));
+        }
+
+        static std::string key(const SymbolSet& set)
+        {
+            return set.to_string();
+        }
+
+        // Units that share their set of low bytes become one alternative, so a range of any size
+        // costs as many alternatives as it has distinct rows of 256 units. Surrogates only come in
+        // pairs, for the characters past the Basic Multilingual Plane.
+        Fragment utf16Class(const CharSet& set)
+        {
+            std::map<std::string, std::pair<SymbolSet, SymbolSet>> rows; // low bytes -> (low bytes, high bytes)
+            for (uint32_t high = 0; high < 0x100; high++)
+            {
+                if (high >= 0xD8 && high <= 0xDF)
+                    continue;
+
+                SymbolSet low;
+                for (uint32_t b = 0; b < 0x100; b++)
+                    low.set(b, set.Has(high << 8 | b));
+                if (low.none())
+                    continue;
+
+                auto& row = rows[key(low)];
+                row.first = low;
+                row.second.set(high);
+            }
+
+            std::vector<Fragment> alternatives;
+            for (auto& row : rows)
+                alternatives.push_back(unit(row.second.first, row.second.second));
+            if (set.astral)
+            {
+                auto any = byteRange(0, 0xFF);
+                alternatives.push_back(Concat(unit(any, byteRange(0xD8, 0xDB)), unit(any, byteRange(0xDC, 0xDF))));
+            }
+            return Alternate(alternatives);
+        }
+
+        // Sequences are grouped the same way: by their last byte, then lead bytes with the same
+        // groups below them.
+        Fragment utf8Class(const CharSet& set)
+        {
+            std::vector<Fragment> alternatives;
+
+            SymbolSet ascii;
+            for (uint32_t c = 0; c < 0x80; c++)
+                ascii.set(c, set.Has(c));
+            if (ascii.any())
+                alternatives.push_back(Symbols(ascii));
+
+            std::map<std::string, std::pair<SymbolSet, SymbolSet>> twoBytes; // trail -> (lead, trail)
+            for (uint32_t lead = 0xC2; lead <= 0xDF; lead++)
+            {
+                SymbolSet trail;
+                for (uint32_t b = 0x80; b <= 0xBF; b++)
+                    trail.set(b, set.Has((lead & 0x1F) << 6 | (b & 0x3F)));
+                if (trail.none())
+                    continue;
+
+                auto& group = twoBytes[key(trail)];
+                group.first.set(lead);
+                group.second = trail;
+            }
+            for (auto& group : twoBytes)
+                alternatives.push_back(Concat(Symbols(group.second.first), Symbols(group.second.second)));
+
+            // lead -> the (second byte, third byte) groups below it, keyed by all of them
+            std::map<std::string, std::pair<SymbolSet, std::map<std::string, std::pair<SymbolSet, SymbolSet>>>>
+                threeBytes;
+            for (uint32_t lead = 0xE0; lead <= 0xEF; lead++)
+            {
+                std::map<std::string, std::pair<SymbolSet, SymbolSet>> groups; // third -> (second, third)
+                for (uint32_t second = 0x80; second <= 0xBF; second++)
+                {
+                    SymbolSet third;
+                    for (uint32_t b = 0x80; b <= 0xBF; b++)
+                    {
+                        auto c = (lead & 0x0F) << 12 | (second & 0x3F) << 6 | (b & 0x3F);
+                        // overlong forms and surrogates are not characters
+                        third.set(b, c >= 0x800 && (c < 0xD800 || c > 0xDFFF) && set.Has(c));
+                    }
+                    if (third.none())
+                        continue;
+
+                    auto& group = groups[key(third)];
+                    group.first.set(second);
+                    group.second = third;
+                }
+                if (groups.empty())
+                    continue;
+
+                std::string leadKey;
+                for (auto& group : groups)
+                    leadKey += key(group.second.first) + key(group.second.second);
+
+                auto& leads = threeBytes[leadKey];
+                leads.first.set(lead);
+                leads.second = groups;
+            }
+            for (auto& leads : threeBytes)
+            {
+                std::vector<Fragment> tails;
+                for (auto& group : leads.second.second)
+                    tails.push_back(Concat(Symbols(group.second.first), Symbols(group.second.second)));
+                alternatives.push_back(Concat(Symbols(leads.second.first), Alternate(tails)));
+            }
+
+            if (set.astral)
+            {
+                auto trail = byteRange(0x80, 0xBF);
+                alternatives.push_back(
+                    Concat(Concat(Symbols(byteRange(0xF0, 0xF4)), Symbols(trail)), Concat(Symbols(trail), Symbols(trail))));
+            }
+
+            return Alternate(alternatives);
+        }
+
+        RegexDfa::Encoding _encoding;
+        bool _ignoreCase;
+        bool _reverse;
+    };
+
+    // Recursive descent over the pattern, building the NFA as it goes. A counted repetition parses
+    // its atom again for every copy.
+    class Parser
+    {
+    public:
+        Parser(Builder& builder, const uint16_t* pattern, uint32_t length)
+            : _builder(builder), _pattern(pattern), _length(length)
+        {
+        }
+
+        bool Parse(Fragment* out)
+        {
+            static const uint16_t IGNORE_CASE[] = {'(', '?', 'i', ')'};
+            if (_length >= 4 && std::equal(IGNORE_CASE, IGNORE_CASE + 4, _pattern))
+            {
+                _builder.IgnoreCase(true);
+                _pos = 4;
+            }
+            return alternation(out) && _pos == _length;
+        }
+
+    private:
+        uint32_t peek() const
+        {
+            return _pos < _length ? _pattern[_pos] : NONE;
+        }
+
+        // the next character, joining surrogate pairs
+        uint32_t take()
+        {
+            if (_pos >= _length)
+                return NONE;
+
+            uint32_t c = _pattern[_pos++];
+            if (c >= 0xD800 && c <= 0xDBFF && _pos < _length && _pattern[_pos] >= 0xDC00 && _pattern[_pos] <= 0xDFFF)
+                c = BMP + ((c - 0xD800) << 10) + (_pattern[_pos++] - 0xDC00);
+            return c;
+        }
+
+        bool alternation(Fragment* out)
+        {
+            std::vector<Fragment> alternatives(1);
+            if (!sequence(&alternatives[0]))
+                return false;
+
+            while (peek() == '|')
+            {
+                _pos++;
+                alternatives.emplace_back();
+                if (!sequence(&alternatives.back()))
+                    return false;
+            }
+
+            *out = alternatives.size() == 1 ? alternatives[0] : _builder.Alternate(alternatives);
+            return true;
+        }
+
+        bool sequence(Fragment* out)
+        {
+            *out = _builder.Empty();
+            while (_pos < _length && peek() != '|' && peek() != ')')
+            {
+                Fragment next;
+                if (!repetition(&next) || _builder.Full())
+                    return false;
+                *out = _builder.Concat(*out, next);
+            }
+            return true;
+        }
+
+        bool repetition(Fragment* out)
+        {
+            auto atomStart = _pos;
+            if (!atom(out))
+                return false;
+
+            uint32_t min, max;
+            switch (peek())
+            {
+            case '*':
+                min = 0, max = NONE;
+                _pos++;
+                break;
+            case '+':
+                min = 1, max = NONE;
+                _pos++;
+                break;
+            case '?':
+                min = 0, max = 1;
+                _pos++;
+                break;
+            case '{':
+                // not a count, such as "{a}", is taken literally by the next atom
+                if (!counts(&min, &max))
+                    return true;
+                break;
+            default:
+                return true;
+            }
+
+            // lazy quantifiers match the same here, the DFA always takes the longest match
+            if (peek() == '?')
+                _pos++;
+            if (peek() == '*' || peek() == '+' || peek() == '?')
+                return false;
+
+            auto quantifierEnd = _pos;
+            if (min == 0 && max == NONE)
+            {
+                *out = _builder.Star(*out);
+            }
+            else if (min == 1 && max == NONE)
+            {
+                *out = _builder.Plus(*out);
+            }
+            else if (min == 0 && max == 1)
+            {
+                *out = _builder.Optional(*out);
+            }
+            else
+            {
+                if (min > MAX_REPEAT || (max != NONE && (max < min || max > MAX_REPEAT)))
+                    return false;
+
+                // the atom parsed first is the first copy
+                auto first = *out;
+                auto used = false;
+                auto copy = [&](Fragment* fragment) {
+                    if (!used)
+                    {
+                        used = true;
+                        *fragment = first;
+                        return true;
+                    }
+                    _pos = atomStart;
+                    return atom(fragment) && !_builder.Full();
+                };
+
+                auto result = _builder.Empty();
+                Fragment next;
+                for (uint32_t i = 0; i < min; i++)
+                {
+                    if (!copy(&next))
+                        return false;
+                    result = _builder.Concat(result, next);
+                }
+                if (max == NONE)
+                {
+                    if (!copy(&next))
+                        return false;
+                    result = _builder.Concat(result, _builder.Star(next));
+                }
+                for (auto i = min; max != NONE && i < max; i++)
+                {
+                    if (!copy(&next))
+                        return false;
+                    result = _builder.Concat(result, _builder.Optional(next));
+                }
+                *out = result;
+                _pos = quantifierEnd;
+            }
+            return true;
+        }
+
+        // "{m}", "{m,}" or "{m,n}"; leaves the position alone if there is none
+        bool counts(uint32_t* min, uint32_t* max)
+        {
+            auto start = _pos++;
+            if (!number(min))
+            {
+                _pos = start;
+                return false;
+            }
+
+            *max = *min;
+            if (peek() == ',')
+            {
+                _pos++;
+                if (!number(max))
+                    *max = NONE;
+            }
+
+            if (peek() != '}')
+            {
+                _pos = start;
+                return false;
+            }
+            _pos++;
+            return true;
+        }
+
+        bool number(uint32_t* value)
+        {
+            auto start = _pos;
+            *value = 0;
+            while (peek() >= '0' && peek() <= '9')
+            {
+                *value = std::min(*value * 10 + (_pattern[_pos++] - '0'), MAX_REPEAT + 1);
+            }
+            return _pos > start;
+        }
+
+        bool atom(Fragment* out)
+        {
+            auto c = take();
+            switch (c)
+            {
+            case NONE:
+            case '*':
+            case '+':
+            case '?':
+            case '|':
+            case ')':
+                return false;
+
+            case '(':
+                if (peek() == '?')
+                {
+                    // an atomic group matches like a plain one where it cannot give back characters,
+                    // as around the sorted keywords of syntax definitions
+                    if (_pos + 1 >= _length || (_pattern[_pos + 1] != ':' && _pattern[_pos + 1] != '>'))
+                        return false;
+                    _pos += 2;
+                }
+                return alternation(out) && take() == ')';
+
+            case '[':
+                return charClass(out);
+
+            case '.':
+            {
+                CharSet any;
+                any.Negate();
+                *out = _builder.Class(any);
+                return true;
+            }
+
+            case '^':
+            case '$':
+                _builder.usesLines = true;
+                *out = _builder.Symbols(one(c == '^' ? RegexDfa::LINE_BEGIN : RegexDfa::LINE_END));
+                return true;
+
+            case '\\':
+            {
+                auto e = take();
+                if (e == 'b' || e == 'B')
+                {
+                    _builder.usesWords = true;
+                    *out = _builder.Symbols(one(e == 'b' ? RegexDfa::WORD_BOUNDARY : RegexDfa::NOT_WORD_BOUNDARY));
+                    return true;
+                }
+
+                CharSet set;
+                if (classEscape(e, &set))
+                {
+                    *out = _builder.Class(set);
+                    return true;
+                }
+                return charEscape(e, &c) && _builder.Literal(c, out);
+            }
+
+            default:
+                return _builder.Literal(c, out);
+            }
+        }
+
+        bool charClass(Fragment* out)
+        {
+            CharSet set;
+            auto negate = peek() == '^';
+            if (negate)
+                _pos++;
+
+            // a ']' right at the start is a member
+            for (auto first = true;; first = false)
+            {
+                auto c = take();
+                if (c == NONE)
+                    return false;
+                if (c == ']' && !first)
+                    break;
+
+                if (c == '\\')
+                {
+                    auto e = take();
+                    if (classEscape(e, &set))
+                        continue;
+                    if (!charEscape(e, &c))
+                        return false;
+                }
+
+                auto last = c;
+                if (peek() == '-' && _pos + 1 < _length && _pattern[_pos + 1] != ']')
+                {
+                    _pos++;
+                    last = take();
+                    if (last == '\\' && !charEscape(take(), &last))
+                        return false;
+                    if (last < c)
+                        return false;
+                }
+
+                // members outside the Basic Multilingual Plane are not supported
+                if (last >= BMP)
+                    return false;
+                set.AddRange(c, last);
+            }
+
+            _builder.Fold(&set);
+            if (negate)
+                set.Negate();
+            *out = _builder.Class(set);
+            return true;
+        }
+
+        // \d, \w and \s and their negations, added to set
+        static bool classEscape(uint32_t e, CharSet* set)
+        {
+            CharSet members;
+            switch (e | 0x20)
+            {
+            case 'd':
+                members.AddRange('0', '9');
+                break;
+            case 'w':
+                members.AddRange('0', '9');
+                members.AddRange('A', 'Z');
+                members.AddRange('a', 'z');
+                members.Add('_');
+                break;
+            case 's':
+                members.AddRange('\t', '\r');
+                members.Add(' ');
+                break;
+            default:
+                return false;
+            }
+
+            if (e < 'a')
+                members.Negate();
+            set->AddAll(members);
+            return true;
+        }
+
+        bool charEscape(uint32_t e, uint32_t* c)
+        {
+            switch (e)
+            {
+            case 't':
+                *c = '\t';
+                return true;
+            case 'n':
+                *c = '\n';
+                return true;
+            case 'r':
+                *c = '\r';
+                return true;
+            case 'f':
+                *c = '\f';
+                return true;
+            case 'v':
+                *c = '\v';
+                return true;
+            case '0':
+                *c = 0;
+                return true;
+            case 'x':
+                return hex(2, c);
+            case 'u':
+                return hex(4, c);
+            default:
+                // other letters and digits are reserved; everything else stands for itself
+                *c = e;
+                return e != NONE && !(e < 0x80 && (isAsciiLetter(e) || (e >= '0' && e <= '9')));
+            }
+        }
+
+        bool hex(uint32_t digits, uint32_t* c)
+        {
+            *c = 0;
+            for (uint32_t i = 0; i < digits; i++)
+            {
+                auto d = peek();
+                uint32_t value;
+                if (d >= '0' && d <= '9')
+                    value = d - '0';
+                else if ((d | 0x20) >= 'a' && (d | 0x20) <= 'f')
+                    value = (d | 0x20) - 'a' + 10;
+                else
+                    return false;
+                *c = *c << 4 | value;
+                _pos++;
+            }
+            return true;
+        }
+
+        Builder& _builder;
+        const uint16_t* _pattern;
+        uint32_t _length;
+        uint32_t _pos = 0;
+    };
+
+    // Epsilon closures, kept to the states that consume a symbol or match; the subset construction
+    // only needs those.
+    class Closure
+    {
+    public:
+        explicit Closure(const std::vector<NfaState>& states) : _states(states), _marks(states.size())
+        {
+        }
+
+        std::vector<uint32_t> Of(const std::vector<uint32_t>& seeds)
+        {
+            _generation++;
+            std::vector<uint32_t> result;
+            _stack.assign(seeds.begin(), seeds.end());
+            while (!_stack.empty())
+            {
+                auto s = _stack.back();
+                _stack.pop_back();
+                if (_marks[s] == _generation)
+                    continue;
+                _marks[s] = _generation;
+
+                auto& state = _states[s];
+                if (state.symbols.any() || state.match != RegexDfa::NO_MATCH)
+                    result.push_back(s);
+                for (auto next : state.epsilon)
+                {
+                    if (_marks[next] != _generation)
+                        _stack.push_back(next);
+                }
+            }
+            std::sort(result.begin(), result.end());
+            return result;
+        }
+
+    private:
+        const std::vector<NfaState>& _states;
+        std::vector<uint32_t> _marks;
+        std::vector<uint32_t> _stack;
+        uint32_t _generation = 0;
+    };
+}
+
+bool RegexDfa::Compile(const uint16_t* const* patterns, const uint32_t* lengths, uint32_t count, Encoding encoding,
+                       uint32_t flags)
+{
+    if (count == 0 || encoding > UTF16BE)
+        return false;
+
+    _reverse = (flags & REVERSE) != 0;
+    Builder builder(encoding, (flags & IGNORE_CASE) != 0, _reverse);
+    auto root = builder.Add();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        builder.IgnoreCase((flags & IGNORE_CASE) != 0);
+        Parser parser(builder, patterns[i], lengths[i]);
+        Fragment fragment;
+        if (!parser.Parse(&fragment) || builder.Full())
+            return false;
+
+        auto match = builder.Add();
+        builder.states[match].match = i;
+        builder.Link(fragment.end, match);
+        builder.Link(root, fragment.start);
+    }
+    _usesLines = builder.usesLines;
+    _usesWords = builder.usesWords;
+
+    // Matches that begin later come from a loop over any character in front of the patterns: any
+    // byte, or any two for UTF-16 so they begin on a code unit.
+    std::vector<uint32_t> prefix;
+    if ((flags & UNANCHORED) != 0)
+    {
+        auto wide = encoding == UTF16LE || encoding == UTF16BE;
+        auto loop = builder.Add();
+        auto second = wide ? builder.Add() : loop;
+        builder.states[loop].symbols = byteRange(0, 0xFF);
+        builder.states[loop].next = second;
+        builder.states[second].symbols = byteRange(0, 0xFF);
+        builder.states[second].next = loop;
+        builder.Link(loop, root);
+        prefix = {loop, second};
+    }
+    auto& states = builder.states;
+
+    // symbols no state tells apart share a column of the table
+    uint16_t classes[SYMBOLS] = {};
+    classes[LINE_BEGIN] = 1;
+    classes[LINE_END] = 2;
+    classes[WORD_BOUNDARY] = 3;
+    classes[NOT_WORD_BOUNDARY] = 4;
+    uint32_t classCount = 5;
+    std::vector<int32_t> split;
+    for (auto& state : states)
+    {
+        if (state.symbols.none())
+            continue;
+
+        split.assign(classCount * 2, -1);
+        uint32_t refined = 0;
+        for (uint32_t symbol = 0; symbol < SYMBOLS; symbol++)
+        {
+            auto& id = split[classes[symbol] * 2 + (state.symbols[symbol] ? 1 : 0)];
+            if (id < 0)
+                id = static_cast<int32_t>(refined++);
+            classes[symbol] = static_cast<uint16_t>(id);
+        }
+        classCount = refined;
+    }
+    std::vector<uint32_t> representatives(classCount);
+    for (auto symbol = SYMBOLS; symbol-- > 0;)
+        representatives[classes[symbol]] = symbol;
+
+    // subset construction; state 0 is the empty set, the dead state
+    Closure closure(states);
+    std::vector<std::vector<uint32_t>> sets(1);
+    std::map<std::vector<uint32_t>, uint32_t> ids = {{{}, DEAD}};
+    auto intern = [&](std::vector<uint32_t>&& set) {
+        auto found = ids.find(set);
+        if (found != ids.end())
+            return found->second;
+
+        auto id = static_cast<uint32_t>(sets.size());
+        ids.emplace(set, id);
+        sets.push_back(std::move(set));
+        return id;
+    };
+
+    _start = intern(closure.Of({root}));
+    _unanchoredStart = prefix.empty() ? _start : intern(closure.Of({prefix[0]}));
+    _classCount = classCount;
+    std::copy(classes, classes + SYMBOLS, _classes);
+    _next.clear();
+    _matches.clear();
+    _anchors.clear();
+
+    std::vector<uint32_t> seeds;
+    for (size_t d = 0; d < sets.size(); d++)
+    {
+        if (sets.size() > MAX_STATES)
+            return false;
+
+        auto match = NO_MATCH;
+        for (auto s : sets[d])
+            match = std::min(match, states[s].match);
+        _matches.push_back(match);
+
+        for (uint32_t c = 0; c < classCount; c++)
+        {
+            auto symbol = representatives[c];
+            seeds.clear();
+            // threads not waiting for a line start or end or a word boundary let it pass
+            if (symbol >= LINE_BEGIN)
+                seeds = sets[d];
+            for (auto s : sets[d])
+            {
+                if (states[s].symbols[symbol])
+                    seeds.push_back(states[s].next);
+            }
+            _next.push_back(intern(closure.Of(seeds)));
+        }
+
+        std::vector<uint32_t> anchored;
+        for (auto s : sets[d])
+        {
+            if (std::find(prefix.begin(), prefix.end(), s) == prefix.end())
+                anchored.push_back(s);
+        }
+        _anchors.push_back(intern(std::move(anchored)));
+    }
+    if (sets.size() > MAX_STATES)
+        return false;
+
+    // the dead and matching states go first, so IsSpecial is one comparison, and states are
+    // numbered by where their row begins, so Next needs no multiplication
+    std::vector<uint32_t> order(sets.size()); // old number of each new one
+    for (uint32_t d = 0; d < order.size(); d++)
+        order[d] = d;
+    auto special = std::stable_partition(order.begin(), order.end(),
+                                         [&](uint32_t d) { return d == DEAD || _matches[d] != NO_MATCH; });
+    _lastSpecial = static_cast<uint32_t>(special - order.begin() - 1) * classCount;
+
+    std::vector<uint32_t> rows(sets.size());
+    for (uint32_t d = 0; d < order.size(); d++)
+        rows[order[d]] = d * classCount;
+
+    std::vector<uint32_t> next(_next.size()), matches(order.size()), anchors(order.size());
+    for (uint32_t d = 0; d < order.size(); d++)
+    {
+        for (uint32_t c = 0; c < classCount; c++)
+            next[d * classCount + c] = rows[_next[order[d] * classCount + c]];
+        matches[d] = _matches[order[d]];
+        anchors[d] = rows[_anchors[order[d]]];
+    }
+    _next.swap(next);
+    _matches.swap(matches);
+    _anchors.swap(anchors);
+    _start = rows[_start];
+    _unanchoredStart = rows[_unanchoredStart];
+    return true;
+}
+
+uint32_t RegexDfa::Encode(uint32_t c, Encoding encoding, uint8_t* out)
+{
+    switch (encoding)
+    {
+    case BYTES:
+        if (c > 0xFF)
+            return 0;
+        out[0] = static_cast<uint8_t>(c);
+        return 1;
+    case UTF8:
+        return encodeUtf8(c, out);
+    default:
+    {
+        uint32_t units[2] = {c, 0};
+        uint32_t count = 1;
+        if (c >= BMP)
+        {
+            units[0] = 0xD800 + ((c - BMP) >> 10);
+            units[1] = 0xDC00 + ((c - BMP) & 0x3FF);
+            count = 2;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto low = static_cast<uint8_t>(units[i] & 0xFF);
+            auto high = static_cast<uint8_t>(units[i] >> 8);
+            out[2 * i] = encoding == UTF16LE ? low : high;
+            out[2 * i + 1] = encoding == UTF16LE ? high : low;
+        }
+        return 2 * count;
+    }
+    }
+}
+
+bool RegexDfa::MatchesEmpty() const
+{
+    // at one boundary a line start comes before a line end, or after it when running backwards
+    auto first = _reverse ? LINE_END : LINE_BEGIN;
+    auto second = _reverse ? LINE_BEGIN : LINE_END;
+    auto afterFirst = Next(_start, first);
+    for (auto state : {_start, afterFirst, Next(_start, second), Next(afterFirst, second)})
+    {
+        if (Match(state) != NO_MATCH)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,150 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Regular expressions compiled ahead into a DFA over the bytes of a text in a known encoding, so
+// matching costs one table lookup per byte and never backtracks. Patterns are UTF-16 and are
+// compiled into byte sequences of the text encoding: a character class becomes the sequences of
+// its members, so "[^,]" consumes a whole UTF-8 or UTF-16 character.
+//
+// The syntax is the usual subset: alternation, groups "(...)", "(?:...)" and "(?>...)" (taken as
+// a plain group), the quantifiers "*", "+", "?" and "{m,n}" (a trailing "?" for laziness is
+// accepted but matches stay greedy), ".", classes with ranges and negation, "^" and "$" for line
+// starts and ends, \b and \B for word boundaries, "(?i)" at the start of a pattern to ignore case
+// in it, and the escapes \d \w \s \D \W \S \t \n \r \f \v \0 \xHH \uHHHH. Look-arounds and back
+// references are not supported. Case is ignored for ASCII letters only; ".", negated classes and
+// the negated escapes never match a line feed.
+//
+// Line starts and ends and word boundaries are not bytes: the caller feeds LINE_BEGIN,
+// WORD_BOUNDARY or NOT_WORD_BOUNDARY, and LINE_END, in this order, at the boundaries where they
+// hold. States that do not wait for them keep their threads, so feeding them where a pattern has
+// no anchors changes nothing.
+class RegexDfa
+{
+public:
+    // Must match NativeFileSearch.SearchEncoding in QuickLook.Plugin.TextViewer/NativeFileSearch.cs
+    enum Encoding : uint32_t
+    {
+        BYTES = 0, // a single-byte code page; every pattern character must be below 256
+        UTF8 = 1,
+        UTF16LE = 2,
+        UTF16BE = 3,
+    };
+
+    enum Flags : uint32_t
+    {
+        IGNORE_CASE = 0x1,
+        // matches the reversed patterns, for running backwards from the end of a match
+        REVERSE = 0x2,
+        // adds UnanchoredStart, from which the patterns match anywhere after it
+        UNANCHORED = 0x4,
+    };
+
+    static constexpr uint32_t LINE_BEGIN = 256;
+    static constexpr uint32_t LINE_END = 257;
+    static constexpr uint32_t WORD_BOUNDARY = 258;
+    static constexpr uint32_t NOT_WORD_BOUNDARY = 259;
+    static constexpr uint32_t SYMBOLS = 260;
+    // the state no pattern can match from any more
+    static constexpr uint32_t DEAD = 0;
+    static constexpr uint32_t NO_MATCH = UINT32_MAX;
+    static constexpr uint32_t MAX_STATES = 4096;
+
+    // Compiles the patterns as alternatives; a match reports the lowest index of the patterns
+    // that match there. Returns false if a pattern is invalid or needs more than MAX_STATES states.
+    bool Compile(const uint16_t* const* patterns, const uint32_t* lengths, uint32_t count, Encoding encoding,
+                 uint32_t flags);
+
+    uint32_t Start() const
+    {
+        return _start;
+    }
+
+    // Like Start, but a match may also begin after any number of characters; only with UNANCHORED.
+    uint32_t UnanchoredStart() const
+    {
+        return _unanchoredStart;
+    }
+
+    uint32_t Next(uint32_t state, uint32_t symbol) const
+    {
+        return _next[state + _classes[symbol]];
+    }
+
+    // Whether state is DEAD or has matched; the loops over the bytes only need to stop for these.
+    bool IsSpecial(uint32_t state) const
+    {
+        return state <= _lastSpecial;
+    }
+
+    // The index of the first pattern that has matched in state, or NO_MATCH.
+    uint32_t Match(uint32_t state) const
+    {
+        return state <= _lastSpecial ? _matches[state / _classCount] : NO_MATCH;
+    }
+
+    // The state with only the matches already begun, for a state reached from UnanchoredStart; one
+    // reached from Start is returned as it is.
+    uint32_t Anchor(uint32_t state) const
+    {
+        return _anchors[state / _classCount];
+    }
+
+    // Whether any pattern has "^" or "$", so LINE_BEGIN and LINE_END need to be fed at all.
+    bool UsesLines() const
+    {
+        return _usesLines;
+    }
+
+    // Whether any pattern has \b or \B, so WORD_BOUNDARY and NOT_WORD_BOUNDARY need to be fed.
+    bool UsesWords() const
+    {
+        return _usesWords;
+    }
+
+    // Whether a pattern matches where no byte has been consumed, such as "a*" or "^$"; word
+    // boundaries are not tried.
+    bool MatchesEmpty() const;
+
+    // Writes the at most 4 bytes of character c in encoding and returns how many; 0 if c is not
+    // in a single-byte code page.
+    static uint32_t Encode(uint32_t c, Encoding encoding, uint8_t* out);
+
+    uint32_t StateCount() const
+    {
+        return static_cast<uint32_t>(_matches.size());
+    }
+
+private:
+    // states are the offsets of their rows in _next
+    uint32_t _classCount = 0;
+    uint16_t _classes[SYMBOLS] = {};
+    uint32_t _lastSpecial = DEAD;
+    std::vector<uint32_t> _next;
+    std::vector<uint32_t> _matches;
+    std::vector<uint32_t> _anchors;
+    uint32_t _start = DEAD;
+    uint32_t _unanchoredStart = DEAD;
+    bool _usesLines = false;
+    bool _usesWords = false;
+    bool _reverse = false;
+};
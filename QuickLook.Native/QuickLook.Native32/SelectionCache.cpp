@@ -0,0 +1,266 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stdafx.h"
+#include "SelectionCache.h"
+
+#include <string>
+
+namespace
+{
+    constexpr auto CACHE_SIZE = 4;
+
+    // safety net for views which change their selection without raising any event
+    constexpr ULONGLONG MAX_ENTRY_AGE = 2000;
+
+    struct Entry
+    {
+        int provider;
+        HWND hwnd;
+        LONG sequence;
+        ULONGLONG tick;
+        std::wstring path;
+    };
+
+    SRWLOCK lock = SRWLOCK_INIT;
+    Entry entries[CACHE_SIZE] = {};
+    int nextSlot = 0;
+
+    // Without a live event source nothing would ever bump the sequence, so the cache stays off
+    // until the event thread has installed its hooks (e.g. it is never enabled inside WoW64HookHelper).
+    volatile LONG enabled = FALSE;
+    volatile LONG currentSequence = 0;
+
+    volatile LONG64 hits = 0;
+    volatile LONG64 misses = 0;
+    volatile LONG64 invalidations = 0;
+
+    HANDLE hEventThread = nullptr;
+    DWORD eventThreadId = 0;
+
+    // root of the foreground window while it is an Explorer window or the desktop, nullptr otherwise;
+    // only touched on the event thread
+    HWND watchedWindow = nullptr;
+}
+
+bool SelectionCache::Start()
+{
+    if (hEventThread != nullptr)
+        return enabled != FALSE;
+
+    auto hReady = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (hReady == nullptr)
+        return false;
+
+    hEventThread = CreateThread(nullptr, 0, eventThreadProc, hReady, 0, &eventThreadId);
+    if (hEventThread != nullptr)
+        WaitForSingleObject(hReady, INFINITE);
+
+    CloseHandle(hReady);
+    return enabled != FALSE;
+}
+
+void SelectionCache::Stop()
+{
+    if (hEventThread == nullptr)
+        return;
+
+    PostThreadMessage(eventThreadId, WM_QUIT, 0, 0);
+    WaitForSingleObject(hEventThread, 2000);
+
+    CloseHandle(hEventThread);
+    hEventThread = nullptr;
+}
+
+void SelectionCache::setEnabled(bool value)
+{
+    InterlockedExchange(&enabled, value ? TRUE : FALSE);
+    invalidate();
+}
+
+void SelectionCache::invalidate()
+{
+    InterlockedIncrement(&currentSequence);
+    InterlockedIncrement64(&invalidations);
+}
+
+LONG SelectionCache::GetSequence()
+{
+    return InterlockedCompareExchange(&currentSequence, 0, 0);
+}
+
+bool SelectionCache::TryGet(int provider, HWND hwnd, PWCHAR buffer)
+{
+    if (!enabled || hwnd == nullptr)
+        return false;
+
+    auto current = GetSequence();
+    auto now = GetTickCount64();
+    auto found = false;
+
+    AcquireSRWLockShared(&lock);
+    for (auto& entry : entries)
+    {
+        if (entry.hwnd == hwnd && entry.provider == provider && entry.sequence == current &&
+            now - entry.tick < MAX_ENTRY_AGE)
+        {
+            wcscpy_s(buffer, MAX_PATH_EX, entry.path.c_str());
+            found = true;
+            break;
+        }
+    }
+    ReleaseSRWLockShared(&lock);
+
+    InterlockedIncrement64(found ? &hits : &misses);
+    return found;
+}
+
+void SelectionCache::Put(int provider, HWND hwnd, LONG sequence, PCWCHAR path)
+{
+    // an empty result may come from a provider timing out (e.g. DOpus), do not pin it
+    if (!enabled || hwnd == nullptr || path == nullptr || path[0] == L'\0')
+        return;
+
+    AcquireSRWLockExclusive(&lock);
+
+    auto slot = -1;
+    for (auto i = 0; i < CACHE_SIZE; i++)
+    {
+        if (entries[i].hwnd == hwnd && entries[i].provider == provider)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0)
+    {
+        slot = nextSlot;
+        nextSlot = (nextSlot + 1) % CACHE_SIZE;
+    }
+
+    entries[slot].provider = provider;
+    entries[slot].hwnd = hwnd;
+    entries[slot].sequence = sequence;
+    entries[slot].tick = GetTickCount64();
+    entries[slot].path = path;
+
+    ReleaseSRWLockExclusive(&lock);
+}
+
+void SelectionCache::FillDiagnostics(Diagnostics* diagnostics)
+{
+    diagnostics->selectionCacheHits = InterlockedCompareExchange64(&hits, 0, 0);
+    diagnostics->selectionCacheMisses = InterlockedCompareExchange64(&misses, 0, 0);
+    diagnostics->selectionCacheInvalidations = InterlockedCompareExchange64(&invalidations, 0, 0);
+}
+
+DWORD WINAPI SelectionCache::eventThreadProc(LPVOID lpParam)
+{
+    // create the message queue before Start returns, so the WM_QUIT of Stop cannot get lost
+    MSG msg;
+    PeekMessage(&msg, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+
+    // Events are delivered to this thread from every process; the callbacks drop everything outside
+    // the watched window before touching the cache.
+    constexpr auto flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+    HWINEVENTHOOK hooks[] = {
+        SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, foregroundChangedProc,
+                        0, 0, flags),
+        SetWinEventHook(EVENT_OBJECT_FOCUS, EVENT_OBJECT_SELECTIONWITHIN, nullptr, selectionChangedProc,
+                        0, 0, flags),
+        SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, nullptr, selectionChangedProc,
+                        0, 0, flags),
+    };
+
+    auto installed = true;
+    for (auto hook : hooks)
+        installed = installed && hook != nullptr;
+
+    watchForeground();
+    setEnabled(installed);
+    SetEvent(static_cast<HANDLE>(lpParam)); // lpParam is gone after this
+
+    if (installed)
+    {
+        while (GetMessage(&msg, nullptr, 0, 0) > 0)
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+
+    setEnabled(false);
+
+    for (auto hook : hooks)
+    {
+        if (hook != nullptr)
+            UnhookWinEvent(hook);
+    }
+
+    return 0;
+}
+
+void SelectionCache::watchForeground()
+{
+    auto hwnd = GetAncestor(GetForegroundWindow(), GA_ROOT);
+
+    WCHAR className[MAX_PATH] = {'\0'};
+    if (hwnd == nullptr || GetClassName(hwnd, className, MAX_PATH) == 0)
+    {
+        watchedWindow = nullptr;
+        return;
+    }
+
+    // the same windows Shell32 resolves as EXPLORER and DESKTOP
+    auto watched = wcscmp(className, L"CabinetWClass") == 0 || wcscmp(className, L"ExploreWClass") == 0 ||
+        wcscmp(className, L"Progman") == 0 || wcscmp(className, L"WorkerW") == 0;
+    watchedWindow = watched ? hwnd : nullptr;
+}
+
+void CALLBACK SelectionCache::foregroundChangedProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd,
+                                                    LONG idObject, LONG idChild, DWORD idEventThread,
+                                                    DWORD dwmsEventTime)
+{
+    watchForeground();
+    invalidate();
+}
+
+void CALLBACK SelectionCache::selectionChangedProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd,
+                                                   LONG idObject, LONG idChild, DWORD idEventThread,
+                                                   DWORD dwmsEventTime)
+{
+    if (watchedWindow == nullptr || hwnd == nullptr)
+        return;
+
+    // the caret and the mouse pointer rename themselves all the time; neither says anything about the selection
+    switch (idObject)
+    {
+    case OBJID_CARET:
+    case OBJID_CURSOR:
+    case OBJID_SOUND:
+    case OBJID_ALERT:
+    case OBJID_HSCROLL:
+    case OBJID_VSCROLL:
+    case OBJID_SIZEGRIP:
+        return;
+    default:
+        break;
+    }
+
+    if (GetAncestor(hwnd, GA_ROOT) == watchedWindow)
+        invalidate();
+}
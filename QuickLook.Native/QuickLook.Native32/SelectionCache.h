@@ -0,0 +1,50 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Diagnostics.h"
+
+// Remembers the last resolved selection of a few file views, so repeated GetCurrentSelection calls
+// (FocusMonitor polling, Space pressed again) skip the shell round trip while nothing has changed.
+// Entries are keyed by provider, view window and a selection sequence number. The sequence is bumped
+// by foreground changes and by the selection, focus and name-change events of the foreground Explorer
+// window or desktop, which are watched on a thread of their own so the keyboard hook never waits on
+// them. Only views raising those events may be cached; entries also expire after a short while.
+class SelectionCache
+{
+public:
+    static bool Start();
+    static void Stop();
+    static LONG GetSequence();
+
+    static bool TryGet(int provider, HWND hwnd, PWCHAR buffer);
+    static void Put(int provider, HWND hwnd, LONG sequence, PCWCHAR path);
+
+    static void FillDiagnostics(Diagnostics* diagnostics);
+
+private:
+    static void setEnabled(bool enabled);
+    static void invalidate();
+    static void watchForeground();
+    static DWORD WINAPI eventThreadProc(LPVOID lpParam);
+    static void CALLBACK foregroundChangedProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd,
+                                               LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime);
+    static void CALLBACK selectionChangedProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd,
+                                              LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime);
+};
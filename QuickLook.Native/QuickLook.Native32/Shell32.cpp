@@ -26,6 +26,9 @@
 #include "IDMan.h"
 #include "FilePilot.h"
 #include "DeskBox.h"
+#include "SelectionCache.h"
+#include "ProviderInit.h"
+#include "ReadAhead.h"
 
 using namespace std;
 
@@ -97,7 +100,20 @@ Shell32::FocusedWindowType Shell32::GetFocusedWindowType()
 
 void Shell32::GetCurrentSelection(PWCHAR buffer)
 {
-    switch (GetFocusedWindowType())
+    auto type = GetFocusedWindowType();
+    auto hwndfg = GetForegroundWindow();
+
+    // only Explorer and the desktop raise the events which keep cached selections honest
+    auto cacheable = type == EXPLORER || type == DESKTOP;
+
+    if (type == INVALID || cacheable && SelectionCache::TryGet(type, hwndfg, buffer))
+        return;
+
+    // take the sequence before asking the provider: a change during the query must not be hidden
+    auto sequence = SelectionCache::GetSequence();
+    ProviderInit::BeginSelection();
+
+    switch (type)
     {
     case DESKTOP:
          getSelectedFromDesktop(buffer);
@@ -129,6 +145,12 @@ void Shell32::GetCurrentSelection(PWCHAR buffer)
     default:
         break;
     }
+
+    ProviderInit::EndSelection();
+
+    if (cacheable)
+        SelectionCache::Put(type, hwndfg, sequence, buffer);
+    ReadAhead::Request(buffer);
 }
 
 void Shell32::getSelectedFromExplorer(PWCHAR buffer)
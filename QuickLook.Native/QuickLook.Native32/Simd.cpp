@@ -0,0 +1,97 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Simd.h"
+
+#if defined(QL_SIMD_X86) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+Simd::Level Simd::Best()
+{
+    // a function-local static is initialized once even with concurrent callers
+    static const Level level = detect();
+    return level;
+}
+
+bool Simd::Supports(Level level)
+{
+    switch (level)
+    {
+    case SCALAR:
+        return true;
+#ifdef QL_SIMD_X86
+    case SSE2:
+        return true;
+    case AVX2:
+        return Best() == AVX2;
+#endif
+#ifdef QL_SIMD_NEON
+    case NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+Simd::Level Simd::detect()
+{
+#if defined(QL_SIMD_X86)
+    uint32_t leaf1[4] = {};
+    uint32_t leaf7[4] = {};
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    auto maxLeaf = static_cast<uint32_t>(regs[0]);
+    __cpuid(regs, 1);
+    for (int i = 0; i < 4; i++)
+        leaf1[i] = static_cast<uint32_t>(regs[i]);
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(regs, 7, 0);
+        for (int i = 0; i < 4; i++)
+            leaf7[i] = static_cast<uint32_t>(regs[i]);
+    }
+#else
+    auto maxLeaf = __get_cpuid_max(0, nullptr);
+    __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    if (maxLeaf >= 7)
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+    constexpr uint32_t OSXSAVE = 1u << 27;
+    constexpr uint32_t AVX = 1u << 28;
+    constexpr uint32_t AVX2_BIT = 1u << 5;
+    if ((leaf1[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX) || (leaf7[1] & AVX2_BIT) == 0)
+        return SSE2;
+
+#ifdef _MSC_VER
+    auto xcr0 = _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    auto xcr0 = static_cast<uint64_t>(edx) << 32 | eax;
+#endif
+    return (xcr0 & 6) == 6 ? AVX2 : SSE2;
+#elif defined(QL_SIMD_NEON)
+    return NEON;
+#else
+    return SCALAR;
+#endif
+}
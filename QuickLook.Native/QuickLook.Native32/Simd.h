@@ -0,0 +1,102 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Instruction set selection for the vectorized scanners. x86 builds always have SSE2 and pick AVX2
+// at run time; ARM64 builds always have NEON. Kernels that need AVX2 are marked QL_TARGET_AVX2 so
+// that GCC and Clang compile them without -mavx2 for the whole file; MSVC needs no such marking.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define QL_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define QL_TARGET_AVX2
+#else
+#define QL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define QL_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+class Simd
+{
+public:
+    enum Level : uint32_t
+    {
+        SCALAR = 0,
+        SSE2 = 1,
+        AVX2 = 2,
+        NEON = 3,
+    };
+
+    // The widest level this CPU and OS can run; checked once.
+    static Level Best();
+
+    // Whether a kernel for the level is compiled into this build and can run here.
+    static bool Supports(Level level);
+
+    // Index of the lowest set bit of a non-zero comparison mask.
+    static uint32_t TrailingZeros(uint32_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    static uint32_t TrailingZeros(uint64_t mask)
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return index;
+#elif defined(_MSC_VER)
+        auto low = static_cast<uint32_t>(mask);
+        return low != 0 ? TrailingZeros(low) : 32 + TrailingZeros(static_cast<uint32_t>(mask >> 32));
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+    }
+
+    // Number of set bits. POPCNT came after SSE2, so MSVC builds for x86 count them by hand.
+    static uint32_t PopCount(uint64_t mask)
+    {
+#if defined(_MSC_VER) && defined(_M_ARM64)
+        return static_cast<uint32_t>(_CountOneBits64(mask));
+#elif defined(_MSC_VER)
+        mask -= mask >> 1 & 0x5555555555555555ull;
+        mask = (mask & 0x3333333333333333ull) + (mask >> 2 & 0x3333333333333333ull);
+        mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return static_cast<uint32_t>(mask * 0x0101010101010101ull >> 56);
+#else
+        return static_cast<uint32_t>(__builtin_popcountll(mask));
+#endif
+    }
+
+private:
+    static Level detect();
+};
@@ -0,0 +1,431 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SyntaxLexer.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint8_t CARRIAGE_RETURN = 0x0D;
+    // how much of a line is looked at first, so the window only moves every few megabytes
+    constexpr uint32_t LINE_PROBE = 64 * 1024;
+
+    inline uint32_t unitSize(TextLines::Newline newline)
+    {
+        return newline == TextLines::LF ? 1 : 2;
+    }
+
+    // whether the last unit of data[0, length) is a CR
+    inline bool endsWithReturn(const uint8_t* data, uint32_t length, TextLines::Newline newline)
+    {
+        switch (newline)
+        {
+        case TextLines::LF_UTF16LE:
+            return length >= 2 && data[length - 2] == CARRIAGE_RETURN && data[length - 1] == 0;
+        case TextLines::LF_UTF16BE:
+            return length >= 2 && data[length - 2] == 0 && data[length - 1] == CARRIAGE_RETURN;
+        default:
+            return length >= 1 && data[length - 1] == CARRIAGE_RETURN;
+        }
+    }
+}
+
+// Collects the tokens of one line, turning its byte offsets into UTF-16 columns as they come in,
+// in order, and joining runs of the same color.
+class SyntaxLexer::Emitter
+{
+public:
+    Emitter(const uint8_t* data, RegexDfa::Encoding encoding, uint32_t maxColumn, Token* tokens, uint32_t capacity,
+            uint32_t* count)
+        : _data(data), _encoding(encoding), _maxColumn(maxColumn), _tokens(tokens), _capacity(capacity),
+          _count(count), _first(*count)
+    {
+    }
+
+    // Whether the columns so far reach maxColumn, past which nothing is shown.
+    bool Full() const
+    {
+        return _column >= _maxColumn;
+    }
+
+    // Text the frame does not color is left out.
+    void Emit(uint32_t from, uint32_t to, uint32_t color, uint32_t frame, bool colored)
+    {
+        if (from >= to || Full())
+            return;
+
+        auto start = columnAt(from);
+        auto end = std::min(columnAt(to), _maxColumn);
+        if ((color == 0 && !colored) || end <= start)
+            return;
+
+        auto last = _tokens + *_count - 1;
+        if (*_count > _first && last->start + last->length == start && last->color == color && last->frame == frame)
+            last->length += end - start;
+        else if (*_count < _capacity)
+            _tokens[(*_count)++] = {start, end - start, color, frame};
+    }
+
+private:
+    // offsets only grow, so UTF-8 is counted once
+    uint32_t columnAt(uint32_t offset)
+    {
+        switch (_encoding)
+        {
+        case RegexDfa::UTF8:
+            for (; _offset < offset; _offset++)
+            {
+                // four bytes are a surrogate pair
+                auto byte = _data[_offset];
+                if ((byte & 0xC0) != 0x80)
+                    _column += byte >= 0xF0 ? 2 : 1;
+            }
+            break;
+        case RegexDfa::UTF16LE:
+        case RegexDfa::UTF16BE:
+            _column = offset / 2;
+            break;
+        default:
+            _column = offset;
+            break;
+        }
+        return _column;
+    }
+
+    const uint8_t* _data;
+    RegexDfa::Encoding _encoding;
+    uint32_t _maxColumn;
+    Token* _tokens;
+    uint32_t _capacity;
+    uint32_t* _count;
+    uint32_t _first; // the first token of the line
+    uint32_t _offset = 0;
+    uint32_t _column = 0;
+};
+
+bool SyntaxLexer::Open(const MappedFile::PathChar* path, uint64_t start, const SyntaxRules* rules)
+{
+    if (rules == nullptr || !_buildWindow.Open(path) || !_readWindow.Open(path))
+        return false;
+
+    _size = _buildWindow.Size();
+    return open(rules, std::min(start, _size));
+}
+
+bool SyntaxLexer::Open(const uint8_t* text, size_t size, const SyntaxRules* rules)
+{
+    if (rules == nullptr)
+        return false;
+
+    _text.assign(text, text + size);
+    _inMemory = true;
+    _size = size;
+    return open(rules, 0);
+}
+
+SyntaxLexer::Info SyntaxLexer::GetInfo()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return {_size, _lines, _lexed};
+}
+
+bool SyntaxLexer::Build(uint32_t bytes)
+{
+    // only this thread changes the state, so it can read it without the lock
+    if (_done)
+        return false;
+
+    auto position = _lexed;
+    auto lines = _lines;
+    auto limit = _size - position > bytes ? position + bytes : _size;
+    std::vector<uint64_t> checkpoints;
+    std::vector<State> states;
+    auto done = false;
+    while (true)
+    {
+        uint32_t length;
+        uint64_t next;
+        bool ended;
+        auto data = readLine(_buildWindow, position, &length, &next, &ended);
+        if (data == nullptr)
+            return false;
+
+        // the rules color nothing that carries over, so only the spans are looked for
+        auto frame = lex(data, length, _frame, nullptr);
+        lines++;
+        position = next;
+        if (!ended)
+        {
+            done = true;
+            break;
+        }
+
+        if (lines % CHECKPOINT_INTERVAL == 0)
+            checkpoints.push_back(position);
+        if (frame != _frame)
+            states.push_back({lines, frame});
+        _frame = frame;
+        if (position >= limit)
+            break;
+    }
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _checkpoints.insert(_checkpoints.end(), checkpoints.begin(), checkpoints.end());
+    _states.insert(_states.end(), states.begin(), states.end());
+    _lines = lines;
+    _lexed = position;
+    _done = done;
+    return !done;
+}
+
+uint32_t SyntaxLexer::Tokenize(uint64_t firstLine, uint32_t count, uint32_t maxColumn, Token* tokens,
+                               uint32_t capacity, uint32_t* tokenEnds)
+{
+    uint64_t position;
+    std::vector<State> states;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (firstLine >= _lines || count == 0)
+            return 0;
+
+        count = static_cast<uint32_t>(std::min<uint64_t>(count, _lines - firstLine));
+        position = _checkpoints[static_cast<size_t>(firstLine / CHECKPOINT_INTERVAL)];
+
+        // the states in effect from firstLine on
+        auto byLine = [](uint64_t line, const State& state) { return line < state.line; };
+        auto first = std::upper_bound(_states.begin(), _states.end(), firstLine, byLine) - 1;
+        auto last = std::upper_bound(first, _states.end(), firstLine + count - 1, byLine);
+        states.assign(first, last);
+    }
+
+    uint64_t ahead = firstLine % CHECKPOINT_INTERVAL;
+    if (ahead != 0 && (!skip(_readWindow, &position, _size, &ahead) || ahead != 0))
+        return 0;
+
+    // no more of a line is lexed than can reach maxColumn
+    auto encoding = _rules->Encoding();
+    uint64_t bytesPerColumn = encoding == RegexDfa::UTF8 ? 3 : encoding == RegexDfa::BYTES ? 1 : 2;
+    uint32_t total = 0;
+    size_t state = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        while (state + 1 < states.size() && states[state + 1].line <= firstLine + i)
+            state++;
+
+        uint32_t length;
+        uint64_t next;
+        bool ended;
+        auto data = readLine(_readWindow, position, &length, &next, &ended);
+        if (data == nullptr)
+            return i;
+
+        length = static_cast<uint32_t>(std::min<uint64_t>(length, maxColumn * bytesPerColumn));
+        Emitter emitter(data, encoding, maxColumn, tokens, capacity, &total);
+        lex(data, length, states[state].frame, &emitter);
+        tokenEnds[i] = total;
+        position = next;
+    }
+    return count;
+}
+
+bool SyntaxLexer::GetFrame(uint32_t frame, uint32_t* parent, uint32_t* color)
+{
+    std::lock_guard<std::mutex> guard(_framesLock);
+    if (frame >= _frames.size())
+        return false;
+
+    auto& found = _frames[frame];
+    *parent = frame == ROOT ? ROOT : found.parent;
+    *color = frame == ROOT ? 0 : _rules->GetSpan(found.span).color;
+    return true;
+}
+
+bool SyntaxLexer::open(const SyntaxRules* rules, uint64_t start)
+{
+    switch (rules->Encoding())
+    {
+    case RegexDfa::UTF16LE:
+        _newline = TextLines::LF_UTF16LE;
+        break;
+    case RegexDfa::UTF16BE:
+        _newline = TextLines::LF_UTF16BE;
+        break;
+    default:
+        _newline = TextLines::LF;
+        break;
+    }
+    _rules = rules;
+    _frame = ROOT;
+
+    {
+        std::lock_guard<std::mutex> guard(_framesLock);
+        _frames.assign(1, {ROOT, SyntaxRules::NONE, 0, false});
+        _frameIds.clear();
+    }
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _checkpoints.assign(1, start);
+    _states.assign(1, {0, ROOT});
+    _lines = 0;
+    _lexed = start;
+    _done = false;
+    return true;
+}
+
+const uint8_t* SyntaxLexer::view(MappedWindow& window, uint64_t offset, uint32_t length)
+{
+    return _inMemory ? _text.data() + offset : window.View(offset, length);
+}
+
+const uint8_t* SyntaxLexer::readLine(MappedWindow& window, uint64_t offset, uint32_t* length, uint64_t* next,
+                                     bool* ended)
+{
+    // the last line may be empty, after a line end at the end of the text
+    static const uint8_t EMPTY = 0;
+    if (offset >= _size)
+    {
+        *length = 0;
+        *next = _size;
+        *ended = false;
+        return &EMPTY;
+    }
+
+    auto unit = unitSize(_newline);
+    for (auto span : {LINE_PROBE, MappedWindow::MAX_SPAN})
+    {
+        auto part = static_cast<uint32_t>(std::min<uint64_t>(span, _size - offset));
+        auto data = view(window, offset, part);
+        if (data == nullptr)
+            return nullptr;
+
+        uint64_t one = 1;
+        auto at = TextLines::Skip(data, part, _newline, &one, Simd::Best());
+        if (one == 0 || offset + part == _size)
+        {
+            *ended = one == 0;
+            *next = offset + at;
+            *length = static_cast<uint32_t>(*ended ? at - unit : at);
+            if (endsWithReturn(data, *length, _newline))
+                *length -= unit;
+            return data;
+        }
+    }
+
+    // the start of a line longer than a view stands for all of it
+    auto end = offset + MappedWindow::MAX_SPAN;
+    uint64_t one = 1;
+    if (!skip(window, &end, _size, &one))
+        return nullptr;
+
+    *ended = one == 0;
+    *next = end;
+    *length = MappedWindow::MAX_SPAN;
+    return view(window, offset, MappedWindow::MAX_SPAN);
+}
+
+bool SyntaxLexer::skip(MappedWindow& window, uint64_t* offset, uint64_t end, uint64_t* count)
+{
+    // MAX_SPAN is even, so the parts stay on unit boundaries
+    while (*count != 0 && *offset < end)
+    {
+        auto part =
+            end - *offset < MappedWindow::MAX_SPAN ? static_cast<uint32_t>(end - *offset) : MappedWindow::MAX_SPAN;
+        auto data = view(window, *offset, part);
+        if (data == nullptr)
+            return false;
+
+        *offset += TextLines::Skip(data, part, _newline, count, Simd::Best());
+    }
+    return true;
+}
+
+uint32_t SyntaxLexer::lex(const uint8_t* data, uint32_t length, uint32_t id, Emitter* emitter)
+{
+    auto current = frame(id);
+    uint32_t position = 0;
+    while (emitter == nullptr || !emitter->Full())
+    {
+        uint32_t begin, end;
+        auto found = _rules->FindSpan(current.span, {data, 0, length}, position, &begin, &end);
+        if (found == SyntaxRules::NONE)
+            break;
+
+        // the rules see the text before the span begin or end as the whole line
+        if (emitter != nullptr)
+            colorRules({data, position, begin}, current, id, emitter);
+
+        if (found == SyntaxRules::END)
+        {
+            if (emitter != nullptr)
+                emitter->Emit(begin, end, _rules->GetSpan(current.span).endColor, id, current.colored);
+            id = current.parent;
+            current = frame(id);
+        }
+        else if (current.depth < MAX_DEPTH)
+        {
+            id = push(id, found);
+            current = frame(id);
+            if (emitter != nullptr)
+                emitter->Emit(begin, end, _rules->GetSpan(found).beginColor, id, current.colored);
+        }
+        else if (emitter != nullptr)
+            emitter->Emit(begin, end, 0, id, current.colored);
+        position = end;
+    }
+
+    if (emitter != nullptr)
+        colorRules({data, position, length}, current, id, emitter);
+    return id;
+}
+
+void SyntaxLexer::colorRules(const SyntaxRules::Text& text, const Frame& frame, uint32_t id, Emitter* emitter) const
+{
+    auto position = text.begin;
+    while (position < text.end && !emitter->Full())
+    {
+        uint32_t begin, end, color;
+        if (!_rules->FindRule(frame.span, text, position, &begin, &end, &color))
+            break;
+
+        emitter->Emit(position, begin, 0, id, frame.colored);
+        emitter->Emit(begin, end, color, id, frame.colored);
+        position = end;
+    }
+    emitter->Emit(position, text.end, 0, id, frame.colored);
+}
+
+SyntaxLexer::Frame SyntaxLexer::frame(uint32_t id)
+{
+    std::lock_guard<std::mutex> guard(_framesLock);
+    return _frames[id];
+}
+
+uint32_t SyntaxLexer::push(uint32_t parent, uint32_t span)
+{
+    std::lock_guard<std::mutex> guard(_framesLock);
+    auto key = static_cast<uint64_t>(parent) << 32 | span;
+    auto found = _frameIds.find(key);
+    if (found != _frameIds.end())
+        return found->second;
+
+    auto& outer = _frames[parent];
+    auto id = static_cast<uint32_t>(_frames.size());
+    _frames.push_back({parent, span, outer.depth + 1, outer.colored || _rules->GetSpan(span).color != 0});
+    _frameIds.emplace(key, id);
+    return id;
+}
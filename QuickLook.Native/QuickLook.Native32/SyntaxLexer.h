@@ -0,0 +1,144 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedWindow.h"
+#include "SyntaxRules.h"
+#include "TextLines.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Syntax highlighting of a text of any size for the text viewer, by SyntaxRules. A background pass
+// lexes the lines in order, but only looks for span begins and ends, which are all that carry over
+// from one line to the next, and remembers the spans open at the start of every line where they
+// change and where every CHECKPOINT_INTERVAL-th line starts. Tokenize then colors just the lines
+// shown, each from its own start, so the view costs the same anywhere in a file of any size.
+//
+// The text is a file read through MappedWindows or a copy of one in memory, in the encoding the
+// rules were compiled for. Lines end with LF, in the code unit of the encoding, and a CR before
+// it is not part of the line. Build runs on one thread while the other calls are made from
+// another; Tokenize sees the lines lexed so far.
+class SyntaxLexer
+{
+public:
+    static constexpr uint32_t CHECKPOINT_INTERVAL = 64;
+    // spans nested deeper than this are taken as plain text
+    static constexpr uint32_t MAX_DEPTH = 32;
+    // the frame outside any span
+    static constexpr uint32_t ROOT = 0;
+
+    // Must match SyntaxLexerInfo in QuickLook.Plugin.TextViewer/NativeSyntax.cs
+    struct Info
+    {
+        uint64_t size;
+        uint64_t lines; // lines lexed; all of them once lexed reaches size
+        uint64_t lexed; // offset up to which the lines are lexed
+    };
+
+    // A run of a line in one color. Columns are UTF-16 code units from the start of the line, and
+    // the color is a rule color or the begin or end color of a span, or 0 for the text of the
+    // frame, the spans open around the run, which color it where the run has no color.
+    // Must match SyntaxToken in QuickLook.Plugin.TextViewer/NativeSyntax.cs
+    struct Token
+    {
+        uint32_t start;
+        uint32_t length;
+        uint32_t color;
+        uint32_t frame;
+    };
+
+    // The first line begins at start, after any byte order mark. rules must outlive the lexer.
+    bool Open(const MappedFile::PathChar* path, uint64_t start, const SyntaxRules* rules);
+
+    // Lexes a copy of the size bytes of text.
+    bool Open(const uint8_t* text, size_t size, const SyntaxRules* rules);
+
+    Info GetInfo();
+
+    // Lexes the lines in the next bytes bytes of the text, and the rest of the last one begun.
+    // Returns false once the whole text is lexed, or if it cannot be read.
+    bool Build(uint32_t bytes);
+
+    // Colors lines firstLine to firstLine + count - 1 up to column maxColumn, storing their tokens
+    // in tokens, with the number of tokens of the lines so far after each line in tokenEnds. Tokens
+    // that do not fit into capacity are left out. Returns the number of lines colored, which is
+    // less than count at the end of what is lexed.
+    uint32_t Tokenize(uint64_t firstLine, uint32_t count, uint32_t maxColumn, Token* tokens, uint32_t capacity,
+                      uint32_t* tokenEnds);
+
+    // Stores the frame that frame is nested in, or ROOT for ROOT, and the color of its span. Fails
+    // if the frame does not exist.
+    bool GetFrame(uint32_t frame, uint32_t* parent, uint32_t* color);
+
+private:
+    struct Frame
+    {
+        uint32_t parent;
+        uint32_t span; // SyntaxRules::NONE for ROOT
+        uint32_t depth;
+        bool colored; // whether any span of it or around it has a color
+    };
+
+    // the frame at the start of the lines from line on
+    struct State
+    {
+        uint64_t line;
+        uint32_t frame;
+    };
+
+    class Emitter;
+
+    bool open(const SyntaxRules* rules, uint64_t start);
+    const uint8_t* view(MappedWindow& window, uint64_t offset, uint32_t length);
+    // Returns the line at offset, without its line end, and where the next one begins; *ended is
+    // false for the last line. Only the first MAX_SPAN bytes of a longer line are returned.
+    const uint8_t* readLine(MappedWindow& window, uint64_t offset, uint32_t* length, uint64_t* next, bool* ended);
+    bool skip(MappedWindow& window, uint64_t* offset, uint64_t end, uint64_t* count);
+    uint32_t lex(const uint8_t* data, uint32_t length, uint32_t frame, Emitter* emitter);
+    void colorRules(const SyntaxRules::Text& text, const Frame& frame, uint32_t id, Emitter* emitter) const;
+    Frame frame(uint32_t id);
+    uint32_t push(uint32_t parent, uint32_t span);
+
+    const SyntaxRules* _rules = nullptr;
+    TextLines::Newline _newline = TextLines::LF;
+    MappedWindow _buildWindow;
+    MappedWindow _readWindow;
+    std::vector<uint8_t> _text; // the copy for a text in memory
+    bool _inMemory = false;
+    uint64_t _size = 0;
+
+    // only Build changes these
+    uint32_t _frame = ROOT; // at the start of the next line
+
+    // guards the fields below, which Build changes while the lines are tokenized
+    std::mutex _lock;
+    std::vector<uint64_t> _checkpoints; // where lines 0, CHECKPOINT_INTERVAL, 2 * CHECKPOINT_INTERVAL... begin
+    std::vector<State> _states;
+    uint64_t _lines = 0;
+    uint64_t _lexed = 0;
+    bool _done = false;
+
+    // spans open at once, numbered as they are first seen; guarded by _framesLock
+    std::mutex _framesLock;
+    std::vector<Frame> _frames;
+    std::map<uint64_t, uint32_t> _frameIds; // parent and span
+};
@@ -0,0 +1,743 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SyntaxRules.h"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+    constexpr uint32_t NONE = UINT32_MAX;
+    // Patterns longer than this together are not even tried in one DFA; a list of keywords needs
+    // about a state for each of its characters, and failing to fit into MAX_STATES takes long.
+    constexpr size_t MAX_GROUP_LENGTH = 2048;
+
+    typedef std::vector<uint16_t> Pattern;
+
+    struct LookaroundPattern
+    {
+        Pattern pattern;
+        bool behind;
+        bool negative;
+    };
+
+    bool startsWith(const Pattern& pattern, uint32_t at, const char* prefix)
+    {
+        for (; *prefix != 0; prefix++, at++)
+        {
+            if (at >= pattern.size() || pattern[at] != static_cast<uint16_t>(*prefix))
+                return false;
+        }
+        return true;
+    }
+
+    // the "]" that closes the class opened at open; one right after "[" or "[^" is a member
+    uint32_t classEnd(const Pattern& pattern, uint32_t open)
+    {
+        auto i = open + 1;
+        if (i < pattern.size() && pattern[i] == '^')
+            i++;
+        if (i < pattern.size() && pattern[i] == ']')
+            i++;
+        for (; i < pattern.size(); i++)
+        {
+            if (pattern[i] == '\\')
+                i++;
+            else if (pattern[i] == ']')
+                return i;
+        }
+        return NONE;
+    }
+
+    // the ")" that closes the group opened at open
+    uint32_t groupEnd(const Pattern& pattern, uint32_t open)
+    {
+        uint32_t depth = 0;
+        for (auto i = open; i < pattern.size(); i++)
+        {
+            switch (pattern[i])
+            {
+            case '\\':
+                i++;
+                break;
+            case '[':
+                i = classEnd(pattern, i);
+                if (i == NONE)
+                    return NONE;
+                break;
+            case '(':
+                depth++;
+                break;
+            case ')':
+                if (--depth == 0)
+                    return i;
+                break;
+            default:
+                break;
+            }
+        }
+        return NONE;
+    }
+
+    // Splits the look-behinds at the start of pattern and the look-aheads at its end off into
+    // lookarounds and leaves the rest in core. A leading "(?i)" is kept for every part. Fails if
+    // the groups are not closed, or an alternative of the whole pattern would lose its look-ahead.
+    bool split(const Pattern& pattern, Pattern* core, std::vector<LookaroundPattern>* lookarounds)
+    {
+        Pattern prefix;
+        uint32_t begin = 0;
+        if (startsWith(pattern, 0, "(?i)"))
+        {
+            prefix.assign(pattern.begin(), pattern.begin() + 4);
+            begin = 4;
+        }
+
+        auto part = [&](uint32_t open, uint32_t close, bool behind) {
+            // "(?=", "(?!", "(?<=" and "(?<!" are followed by the look-around pattern
+            auto first = open + (behind ? 4 : 3);
+            LookaroundPattern lookaround{prefix, behind, pattern[first - 1] == '!'};
+            lookaround.pattern.insert(lookaround.pattern.end(), pattern.begin() + first, pattern.begin() + close);
+            lookarounds->push_back(std::move(lookaround));
+        };
+
+        while (startsWith(pattern, begin, "(?<=") || startsWith(pattern, begin, "(?<!"))
+        {
+            auto close = groupEnd(pattern, begin);
+            if (close == NONE)
+                return false;
+            part(begin, close, true);
+            begin = close + 1;
+        }
+
+        auto end = static_cast<uint32_t>(pattern.size());
+        while (true)
+        {
+            // the last group at the top level, if the pattern ends with it
+            auto last = NONE;
+            auto alternation = false;
+            for (auto i = begin; i < end; i++)
+            {
+                last = NONE;
+                if (pattern[i] == '\\')
+                    i++;
+                else if (pattern[i] == '[')
+                    i = classEnd(pattern, i);
+                else if (pattern[i] == '|')
+                    alternation = true;
+                else if (pattern[i] == '(')
+                {
+                    last = i;
+                    i = groupEnd(pattern, i);
+                }
+                if (i == NONE)
+                    return false;
+            }
+            if (last == NONE || !(startsWith(pattern, last, "(?=") || startsWith(pattern, last, "(?!")))
+                break;
+            if (alternation)
+                return false;
+
+            part(last, end - 1, false);
+            end = last;
+        }
+
+        *core = prefix;
+        core->insert(core->end(), pattern.begin() + begin, pattern.begin() + end);
+        return true;
+    }
+
+    bool compile(RegexDfa* dfa, const Pattern& pattern, RegexDfa::Encoding encoding, uint32_t flags)
+    {
+        auto data = pattern.data();
+        auto length = static_cast<uint32_t>(pattern.size());
+        return length != 0 && dfa->Compile(&data, &length, 1, encoding, flags);
+    }
+
+    // Whether the parts of pattern compile, and it only matches empty text where that is allowed.
+    bool isValid(const Pattern& pattern, bool allowEmpty, RegexDfa::Encoding encoding)
+    {
+        Pattern core;
+        std::vector<LookaroundPattern> lookarounds;
+        RegexDfa dfa;
+        if (!split(pattern, &core, &lookarounds) || !compile(&dfa, core, encoding, 0) ||
+            (!allowEmpty && dfa.MatchesEmpty()))
+            return false;
+
+        for (auto& lookaround : lookarounds)
+        {
+            auto flags = lookaround.behind ? RegexDfa::REVERSE : 0u;
+            if (!compile(&dfa, lookaround.pattern, encoding, flags))
+                return false;
+        }
+        return true;
+    }
+
+    // The '|' at the top level of [from, to).
+    std::vector<uint32_t> alternatives(const Pattern& pattern, uint32_t from, uint32_t to)
+    {
+        std::vector<uint32_t> bars;
+        for (auto i = from; i < to && i != NONE; i++)
+        {
+            if (pattern[i] == '\\')
+                i++;
+            else if (pattern[i] == '[')
+                i = classEnd(pattern, i);
+            else if (pattern[i] == '(')
+                i = groupEnd(pattern, i);
+            else if (pattern[i] == '|')
+                bars.push_back(i);
+        }
+        return bars;
+    }
+
+    // Splits the alternatives of the first group at the top level that has some and is not
+    // repeated, or else of the whole pattern, into two patterns that match what pattern does
+    // between them, for keyword lists too long for one DFA.
+    bool halve(const Pattern& pattern, Pattern* first, Pattern* second)
+    {
+        uint32_t begin = startsWith(pattern, 0, "(?i)") ? 4 : 0;
+        auto size = static_cast<uint32_t>(pattern.size());
+        auto cut = [&](uint32_t from, uint32_t to, const std::vector<uint32_t>& bars) {
+            auto bar = bars[bars.size() / 2];
+            first->assign(pattern.begin(), pattern.begin() + bar);
+            first->insert(first->end(), pattern.begin() + to, pattern.end());
+            second->assign(pattern.begin(), pattern.begin() + from);
+            second->insert(second->end(), pattern.begin() + bar + 1, pattern.end());
+        };
+
+        for (auto i = begin; i < size; i++)
+        {
+            if (pattern[i] == '\\')
+                i++;
+            else if (pattern[i] == '[')
+                i = classEnd(pattern, i);
+            else if (pattern[i] == '(')
+            {
+                auto close = groupEnd(pattern, i);
+                if (close == NONE)
+                    return false;
+
+                // look-arounds are not split
+                auto from = i + 1;
+                auto plain = true;
+                if (startsWith(pattern, i, "(?:") || startsWith(pattern, i, "(?>"))
+                    from = i + 3;
+                else if (startsWith(pattern, i, "(?"))
+                    plain = false;
+
+                auto repeated = close + 1 < size && (pattern[close + 1] == '*' || pattern[close + 1] == '+' ||
+                                                     pattern[close + 1] == '?' || pattern[close + 1] == '{');
+                auto bars = plain && !repeated ? alternatives(pattern, from, close) : std::vector<uint32_t>();
+                if (!bars.empty())
+                {
+                    cut(from, close, bars);
+                    return true;
+                }
+                i = close;
+            }
+            if (i == NONE)
+                return false;
+        }
+
+        auto bars = alternatives(pattern, begin, size);
+        if (bars.empty())
+            return false;
+        cut(begin, size, bars);
+        return true;
+    }
+
+    // The patterns that pattern is split into until each one compiles, or none if that fails.
+    std::vector<Pattern> pieces(const Pattern& pattern, bool allowEmpty, RegexDfa::Encoding encoding)
+    {
+        Pattern first, second;
+        auto halved = pattern.size() > MAX_GROUP_LENGTH && halve(pattern, &first, &second);
+        if (!halved && isValid(pattern, allowEmpty, encoding))
+            return {pattern};
+        if (!halved && !halve(pattern, &first, &second))
+            return {};
+
+        auto result = pieces(first, allowEmpty, encoding);
+        auto rest = pieces(second, allowEmpty, encoding);
+        if (result.empty() || rest.empty())
+            return {};
+        result.insert(result.end(), rest.begin(), rest.end());
+        return result;
+    }
+
+    inline bool isWordChar(uint32_t c)
+    {
+        // \w of RegexDfa, which is ASCII only
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_';
+    }
+}
+
+bool SyntaxRules::Compile(const Rule* rules, uint32_t count, const uint16_t* text, uint32_t textLength,
+                          RegexDfa::Encoding encoding)
+{
+    if (count > MAX_RULES || encoding > RegexDfa::UTF16BE)
+        return false;
+
+    uint32_t ruleSets = 1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        auto& rule = rules[i];
+        if (rule.kind > SPAN || rule.ruleSet >= MAX_RULES || (rule.inner != NONE && rule.inner >= MAX_RULES) ||
+            rule.begin > textLength || rule.beginLength > textLength - rule.begin ||
+            (rule.kind == SPAN && (rule.end > textLength || rule.endLength > textLength - rule.end)))
+            return false;
+
+        ruleSets = std::max(ruleSets, rule.ruleSet + 1);
+        if (rule.kind == SPAN && rule.inner != NONE)
+            ruleSets = std::max(ruleSets, rule.inner + 1);
+    }
+
+    _encoding = encoding;
+    _dropped = 0;
+    _spans.clear();
+    _inner.clear();
+
+    // Definitions repeat their rule sets, such as the main one inside a span for escapes, so what
+    // is compiled is kept for the copies.
+    std::map<Pattern, std::vector<Pattern>> checked;
+    std::map<std::pair<std::vector<Pattern>, uint32_t>, const PatternSet*> compiled;
+    auto compileOnce = [&](std::vector<Pattern>&& patterns, uint32_t emptyIndex, PatternSet* set) {
+        auto key = std::make_pair(std::move(patterns), emptyIndex);
+        auto found = compiled.find(key);
+        if (found != compiled.end())
+        {
+            *set = *found->second;
+            return;
+        }
+        compileSet(key.first, emptyIndex, set);
+        compiled.emplace(std::move(key), set);
+    };
+
+    // the rules and spans that compile, by rule set, with the pieces of their begin patterns
+    std::vector<std::vector<uint32_t>> spansOf(ruleSets), rulesOf(ruleSets);
+    std::vector<std::vector<Pattern>> begins(count);
+    std::vector<Pattern> ends;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        auto& rule = rules[i];
+        Pattern end;
+        if (rule.kind == SPAN)
+            end.assign(text + rule.end, text + rule.end + rule.endLength);
+
+        // an empty begin would never move on; the end of a span, such as "$", may be empty
+        Pattern begin(text + rule.begin, text + rule.begin + rule.beginLength);
+        auto known = checked.find(begin);
+        if (known == checked.end())
+            known = checked.emplace(begin, pieces(begin, false, encoding)).first;
+        begins[i] = known->second;
+        if (begins[i].empty() || (!end.empty() && !isValid(end, true, encoding)))
+        {
+            begins[i].clear();
+            _dropped++;
+            continue;
+        }
+
+        if (rule.kind == RULE)
+        {
+            rulesOf[rule.ruleSet].push_back(i);
+            continue;
+        }
+
+        spansOf[rule.ruleSet].push_back(i);
+        _spans.push_back({rule.color, rule.beginColor, rule.endColor});
+        _inner.push_back(rule.inner);
+        ends.push_back(std::move(end));
+    }
+
+    _ruleSets.assign(ruleSets, RuleSet());
+    for (uint32_t set = 0; set < ruleSets; set++)
+    {
+        std::vector<Pattern> patterns;
+        for (auto i : rulesOf[set])
+        {
+            for (auto& piece : begins[i])
+            {
+                patterns.push_back(piece);
+                _ruleSets[set].colors.push_back(rules[i].color);
+            }
+        }
+        compileOnce(std::move(patterns), NONE, &_ruleSets[set].patterns);
+    }
+
+    // spans are numbered in the order of the rules
+    std::vector<uint32_t> spanOf(count, NONE);
+    for (uint32_t i = 0, span = 0; i < count; i++)
+    {
+        if (rules[i].kind == SPAN && !begins[i].empty())
+            spanOf[i] = span++;
+    }
+
+    _contexts.assign(_spans.size() + 1, Context());
+    for (size_t c = 0; c < _contexts.size(); c++)
+    {
+        auto& context = _contexts[c];
+        auto set = c == 0 ? 0 : _inner[c - 1];
+        std::vector<Pattern> patterns;
+        auto emptyIndex = NONE;
+        if (set != NONE)
+        {
+            for (auto i : spansOf[set])
+            {
+                for (auto& piece : begins[i])
+                {
+                    patterns.push_back(piece);
+                    context.spans.push_back(spanOf[i]);
+                }
+            }
+        }
+        if (c != 0 && !ends[c - 1].empty())
+        {
+            emptyIndex = static_cast<uint32_t>(patterns.size());
+            patterns.push_back(ends[c - 1]);
+            context.spans.push_back(END);
+        }
+        compileOnce(std::move(patterns), emptyIndex, &context.patterns);
+    }
+    return true;
+}
+
+uint32_t SyntaxRules::FindSpan(uint32_t span, const Text& text, uint32_t from, uint32_t* begin, uint32_t* end) const
+{
+    auto& context = _contexts[span == NONE ? 0 : span + 1];
+    auto index = find(context.patterns, text, from, begin, end);
+    return index == NONE ? NONE : context.spans[index];
+}
+
+bool SyntaxRules::FindRule(uint32_t span, const Text& text, uint32_t from, uint32_t* begin, uint32_t* end,
+                           uint32_t* color) const
+{
+    auto set = span == NONE ? 0 : _inner[span];
+    if (set == NONE)
+        return false;
+
+    auto& ruleSet = _ruleSets[set];
+    auto index = find(ruleSet.patterns, text, from, begin, end);
+    if (index == NONE)
+        return false;
+
+    *color = ruleSet.colors[index];
+    return true;
+}
+
+void SyntaxRules::compileSet(const std::vector<std::vector<uint16_t>>& patterns, uint32_t emptyIndex,
+                             PatternSet* set) const
+{
+    set->emptyIndex = emptyIndex;
+
+    // the patterns were checked alone, so only the states of several together can run out
+    std::vector<Pattern> plain;
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < patterns.size(); i++)
+    {
+        Pattern core;
+        std::vector<LookaroundPattern> lookarounds;
+        split(patterns[i], &core, &lookarounds);
+        if (lookarounds.empty())
+        {
+            plain.push_back(std::move(core));
+            indices.push_back(i);
+            continue;
+        }
+
+        Guarded guarded{i};
+        compile(&guarded.dfa, core, _encoding, 0);
+        for (auto& lookaround : lookarounds)
+        {
+            guarded.lookarounds.push_back({lookaround.behind, lookaround.negative});
+            auto flags = lookaround.behind ? RegexDfa::REVERSE : 0u;
+            compile(&guarded.lookarounds.back().dfa, lookaround.pattern, _encoding, flags);
+        }
+        set->guarded.push_back(std::move(guarded));
+    }
+
+    // as many plain patterns in one DFA as fit, halving the ranges that do not
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t i = 0, length = 0; i < plain.size(); i++)
+    {
+        if (ranges.empty() || length + plain[i].size() > MAX_GROUP_LENGTH)
+        {
+            ranges.emplace_back(i, i);
+            length = 0;
+        }
+        ranges.back().second++;
+        length += plain[i].size();
+    }
+    std::reverse(ranges.begin(), ranges.end());
+    while (!ranges.empty())
+    {
+        auto range = ranges.back();
+        ranges.pop_back();
+
+        std::vector<const uint16_t*> data;
+        std::vector<uint32_t> lengths;
+        for (auto i = range.first; i < range.second; i++)
+        {
+            data.push_back(plain[i].data());
+            lengths.push_back(static_cast<uint32_t>(plain[i].size()));
+        }
+
+        Group group;
+        if (group.dfa.Compile(data.data(), lengths.data(), static_cast<uint32_t>(data.size()), _encoding, 0))
+        {
+            group.indices.assign(indices.begin() + range.first, indices.begin() + range.second);
+            set->groups.push_back(std::move(group));
+        }
+        else if (range.second - range.first > 1)
+        {
+            auto middle = (range.first + range.second) / 2;
+            ranges.emplace_back(middle, range.second);
+            ranges.emplace_back(range.first, middle);
+        }
+    }
+    std::sort(set->guarded.begin(), set->guarded.end(),
+              [](const Guarded& a, const Guarded& b) { return a.index < b.index; });
+
+    // the states a match can begin in, after a line start or not and a word boundary or not
+    auto addStarts = [&](const RegexDfa& dfa) {
+        for (auto symbol : {NONE, RegexDfa::LINE_BEGIN})
+        {
+            for (auto word : {NONE, RegexDfa::WORD_BOUNDARY, RegexDfa::NOT_WORD_BOUNDARY})
+            {
+                auto state = symbol == NONE ? dfa.Start() : dfa.Next(dfa.Start(), symbol);
+                if (word != NONE)
+                    state = dfa.Next(state, word);
+                for (uint32_t b = 0; b < 256; b++)
+                    set->starts[b] = set->starts[b] || dfa.Next(state, b) != RegexDfa::DEAD;
+                set->emptyAnywhere = set->emptyAnywhere || dfa.Match(state) != RegexDfa::NO_MATCH;
+                set->emptyAtEnd =
+                    set->emptyAtEnd || dfa.Match(dfa.Next(state, RegexDfa::LINE_END)) != RegexDfa::NO_MATCH;
+            }
+        }
+    };
+    for (auto& group : set->groups)
+        addStarts(group.dfa);
+    for (auto& guarded : set->guarded)
+        addStarts(guarded.dfa);
+}
+
+uint32_t SyntaxRules::find(const PatternSet& set, const Text& text, uint32_t from, uint32_t* begin,
+                           uint32_t* end) const
+{
+    if (set.groups.empty() && set.guarded.empty())
+        return NONE;
+
+    // UTF-16 characters begin at an even distance from the start of the text
+    auto step = _encoding == RegexDfa::UTF16LE || _encoding == RegexDfa::UTF16BE ? 2u : 1u;
+    for (auto at = from; at <= text.end; at += step)
+    {
+        if (!set.emptyAnywhere && (at < text.end ? !set.starts[text.data[at]] : !set.emptyAtEnd))
+            continue;
+
+        // only the end of a span may match empty text
+        auto index = match(set, text, at, end);
+        if (index != NONE && (*end > at || index == set.emptyIndex))
+        {
+            *begin = at;
+            return index;
+        }
+    }
+    return NONE;
+}
+
+uint32_t SyntaxRules::match(const PatternSet& set, const Text& text, uint32_t at, uint32_t* end) const
+{
+    auto best = NONE;
+    for (auto& group : set.groups)
+    {
+        uint32_t groupEnd;
+        auto index = run(group.dfa, text, at, &groupEnd);
+        if (index != RegexDfa::NO_MATCH && group.indices[index] < best)
+        {
+            best = group.indices[index];
+            *end = groupEnd;
+        }
+    }
+
+    for (auto& guarded : set.guarded)
+    {
+        if (guarded.index >= best)
+            break;
+
+        // a look-behind holds wherever the match ends
+        auto holds = true;
+        for (auto& lookaround : guarded.lookarounds)
+            holds = holds && (!lookaround.behind || this->lookaround(lookaround, text, at));
+        if (!holds)
+            continue;
+
+        // the longest match after which the look-aheads hold
+        auto& dfa = guarded.dfa;
+        auto found = NONE;
+        auto state = boundary(dfa, dfa.Start(), text, at, false);
+        for (auto p = at;;)
+        {
+            if (dfa.IsSpecial(state))
+            {
+                if (state == RegexDfa::DEAD)
+                    break;
+
+                holds = true;
+                for (auto& lookaround : guarded.lookarounds)
+                    holds = holds && (lookaround.behind || this->lookaround(lookaround, text, p));
+                if (holds)
+                    found = p;
+            }
+            if (p == text.end)
+                break;
+
+            state = dfa.Next(state, text.data[p++]);
+            if (isCharStart(text, p))
+                state = boundary(dfa, state, text, p, false);
+        }
+
+        if (found != NONE)
+        {
+            *end = found;
+            return guarded.index;
+        }
+    }
+
+    return best;
+}
+
+uint32_t SyntaxRules::run(const RegexDfa& dfa, const Text& text, uint32_t at, uint32_t* end) const
+{
+    auto anchors = dfa.UsesLines() || dfa.UsesWords();
+    auto best = RegexDfa::NO_MATCH;
+    auto state = anchors ? boundary(dfa, dfa.Start(), text, at, false) : dfa.Start();
+    for (auto p = at;;)
+    {
+        if (dfa.IsSpecial(state))
+        {
+            if (state == RegexDfa::DEAD)
+                break;
+
+            // a lower index wins, and the same one later is a longer match
+            auto index = dfa.Match(state);
+            if (index <= best)
+            {
+                best = index;
+                *end = p;
+            }
+        }
+        if (p == text.end)
+            break;
+
+        state = dfa.Next(state, text.data[p++]);
+        if (anchors && isCharStart(text, p))
+            state = boundary(dfa, state, text, p, false);
+    }
+    return best;
+}
+
+bool SyntaxRules::lookaround(const Lookaround& lookaround, const Text& text, uint32_t at) const
+{
+    auto& dfa = lookaround.dfa;
+    auto matched = false;
+    if (!lookaround.behind)
+    {
+        uint32_t end;
+        matched = run(dfa, text, at, &end) != RegexDfa::NO_MATCH;
+    }
+    else
+    {
+        // the reversed pattern, backwards from at
+        auto state = boundary(dfa, dfa.Start(), text, at, true);
+        for (auto p = at;;)
+        {
+            if (dfa.IsSpecial(state))
+            {
+                matched = state != RegexDfa::DEAD;
+                break;
+            }
+            if (p == text.begin)
+                break;
+
+            state = dfa.Next(state, text.data[--p]);
+            if (isCharStart(text, p))
+                state = boundary(dfa, state, text, p, true);
+        }
+    }
+    return matched != lookaround.negative;
+}
+
+uint32_t SyntaxRules::boundary(const RegexDfa& dfa, uint32_t state, const Text& text, uint32_t at, bool reverse) const
+{
+    // a line start comes first at a boundary, and last when running backwards
+    auto lines = dfa.UsesLines();
+    if (lines && at == (reverse ? text.end : text.begin))
+        state = dfa.Next(state, reverse ? RegexDfa::LINE_END : RegexDfa::LINE_BEGIN);
+    if (dfa.UsesWords())
+    {
+        auto word = isWordBefore(text, at) != isWordAt(text, at);
+        state = dfa.Next(state, word ? RegexDfa::WORD_BOUNDARY : RegexDfa::NOT_WORD_BOUNDARY);
+    }
+    if (lines && at == (reverse ? text.begin : text.end))
+        state = dfa.Next(state, reverse ? RegexDfa::LINE_BEGIN : RegexDfa::LINE_END);
+    return state;
+}
+
+bool SyntaxRules::isCharStart(const Text& text, uint32_t at) const
+{
+    switch (_encoding)
+    {
+    case RegexDfa::UTF8:
+        return at == text.end || (text.data[at] & 0xC0) != 0x80;
+    case RegexDfa::UTF16LE:
+    case RegexDfa::UTF16BE:
+        return (at - text.begin) % 2 == 0;
+    default:
+        return true;
+    }
+}
+
+bool SyntaxRules::isWordAt(const Text& text, uint32_t at) const
+{
+    if (at >= text.end)
+        return false;
+
+    switch (_encoding)
+    {
+    case RegexDfa::UTF16LE:
+        return at + 1 < text.end && isWordChar(text.data[at] | text.data[at + 1] << 8);
+    case RegexDfa::UTF16BE:
+        return at + 1 < text.end && isWordChar(text.data[at] << 8 | text.data[at + 1]);
+    default:
+        // bytes of longer UTF-8 characters are never ASCII
+        return isWordChar(text.data[at]);
+    }
+}
+
+bool SyntaxRules::isWordBefore(const Text& text, uint32_t at) const
+{
+    if (at <= text.begin)
+        return false;
+
+    switch (_encoding)
+    {
+    case RegexDfa::UTF16LE:
+    case RegexDfa::UTF16BE:
+        return at - text.begin >= 2 && isWordAt(text, at - 2);
+    default:
+        return isWordChar(text.data[at - 1]);
+    }
+}
@@ -0,0 +1,182 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "RegexDfa.h"
+
+#include <cstdint>
+#include <vector>
+
+// The rules of a highlighting definition of the text viewer, compiled once for text in one
+// encoding and shared by every SyntaxLexer that uses them. A rule set has spans, which begin and
+// end with a pattern and may have a rule set of their own inside, and rules, which color the text
+// their pattern matches. As in AvalonEdit, the first span begin or end of the current span wins,
+// and the rules are only matched in the text before it, which they see as the whole line.
+//
+// The patterns of a rule set are compiled together into one RegexDfa (see there for the syntax),
+// so trying all of them at a position costs one table lookup per byte, and positions where none of
+// them can begin are passed over by their first byte. Look-behinds at the start of a pattern and
+// look-aheads at its end, which the definitions use to mark names after keywords, are split off
+// into DFAs of their own that only run where the rest of the pattern matched. Rules and spans with
+// patterns that still cannot be compiled, or that match empty text, are dropped.
+class SyntaxRules
+{
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    // what FindSpan returns for the end of the span it is in
+    static constexpr uint32_t END = UINT32_MAX - 1;
+    static constexpr uint32_t MAX_RULES = 65536;
+
+    // Must match SyntaxRuleKind in QuickLook.Plugin.TextViewer/NativeSyntax.cs
+    enum Kind : uint32_t
+    {
+        RULE = 0,
+        SPAN = 1,
+    };
+
+    // Must match SyntaxRule in QuickLook.Plugin.TextViewer/NativeSyntax.cs
+    struct Rule
+    {
+        uint32_t ruleSet; // rule set 0 is the one outside any span
+        uint32_t kind;
+        uint32_t begin; // where the pattern is in the text given to Compile
+        uint32_t beginLength;
+        uint32_t end; // spans only; a span with an empty end pattern never ends
+        uint32_t endLength;
+        uint32_t color; // colors are the caller's; 0 is none
+        uint32_t beginColor;
+        uint32_t endColor;
+        uint32_t inner; // the rule set inside a span, or NONE for none
+    };
+
+    // What the patterns are matched in: the bytes [begin, end) of data, taken as a whole line. Text
+    // before begin is not looked at.
+    struct Text
+    {
+        const uint8_t* data;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // A span as SyntaxLexer sees it.
+    struct Span
+    {
+        uint32_t color;
+        uint32_t beginColor;
+        uint32_t endColor;
+    };
+
+    // Fails if the rules are out of range or the patterns are not in the text; rules whose patterns
+    // cannot be compiled are dropped and counted in Dropped instead.
+    bool Compile(const Rule* rules, uint32_t count, const uint16_t* text, uint32_t textLength,
+                 RegexDfa::Encoding encoding);
+
+    RegexDfa::Encoding Encoding() const
+    {
+        return _encoding;
+    }
+
+    uint32_t Dropped() const
+    {
+        return _dropped;
+    }
+
+    uint32_t SpanCount() const
+    {
+        return static_cast<uint32_t>(_spans.size());
+    }
+
+    const Span& GetSpan(uint32_t span) const
+    {
+        return _spans[span];
+    }
+
+    // Finds the first span that begins at or after from, or the end of span, or of no span for
+    // NONE. Returns the span that begins, END or NONE if neither is found, with the match in
+    // [*begin, *end). A span begins before the end where both match at the same place.
+    uint32_t FindSpan(uint32_t span, const Text& text, uint32_t from, uint32_t* begin, uint32_t* end) const;
+
+    // Finds the first rule that matches at or after from, inside span or outside any for NONE, and
+    // stores the match in [*begin, *end) and the color of the rule. Returns false if none matches.
+    bool FindRule(uint32_t span, const Text& text, uint32_t from, uint32_t* begin, uint32_t* end,
+                  uint32_t* color) const;
+
+private:
+    struct Lookaround
+    {
+        bool behind;
+        bool negative;
+        RegexDfa dfa{}; // reversed for look-behinds
+    };
+
+    // A pattern with look-arounds, matched on its own.
+    struct Guarded
+    {
+        uint32_t index;
+        RegexDfa dfa{};
+        std::vector<Lookaround> lookarounds{};
+    };
+
+    // Patterns without look-arounds, matched together.
+    struct Group
+    {
+        RegexDfa dfa;
+        std::vector<uint32_t> indices; // the index of each pattern of dfa in the set
+    };
+
+    // Patterns matched together; the lowest index wins where several match.
+    struct PatternSet
+    {
+        std::vector<Group> groups;
+        std::vector<Guarded> guarded;
+        bool starts[256] = {}; // the bytes a match can begin with
+        bool emptyAnywhere = false;
+        bool emptyAtEnd = false;
+        uint32_t emptyIndex = NONE; // the pattern that may match empty text
+    };
+
+    // The spans of a rule set with the end of the span they are in, if it has one.
+    struct Context
+    {
+        PatternSet patterns;
+        std::vector<uint32_t> spans; // the span of each pattern; END for the end
+    };
+
+    struct RuleSet
+    {
+        PatternSet patterns;
+        std::vector<uint32_t> colors;
+    };
+
+    void compileSet(const std::vector<std::vector<uint16_t>>& patterns, uint32_t emptyIndex, PatternSet* set) const;
+    uint32_t find(const PatternSet& set, const Text& text, uint32_t from, uint32_t* begin, uint32_t* end) const;
+    uint32_t match(const PatternSet& set, const Text& text, uint32_t at, uint32_t* end) const;
+    uint32_t run(const RegexDfa& dfa, const Text& text, uint32_t at, uint32_t* end) const;
+    bool lookaround(const Lookaround& lookaround, const Text& text, uint32_t at) const;
+    uint32_t boundary(const RegexDfa& dfa, uint32_t state, const Text& text, uint32_t at, bool reverse) const;
+    bool isCharStart(const Text& text, uint32_t at) const;
+    bool isWordAt(const Text& text, uint32_t at) const;
+    bool isWordBefore(const Text& text, uint32_t at) const;
+
+    RegexDfa::Encoding _encoding = RegexDfa::BYTES;
+    uint32_t _dropped = 0;
+    std::vector<Span> _spans;
+    std::vector<uint32_t> _inner;   // the rule set inside each span
+    std::vector<Context> _contexts; // outside any span, then inside each span
+    std::vector<RuleSet> _ruleSets;
+};
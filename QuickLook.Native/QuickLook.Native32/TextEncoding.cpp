@@ -0,0 +1,491 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TextEncoding.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr size_t BLOCK_SIZE = 64;
+    constexpr size_t NULL_SAMPLE_SIZE = 4096;
+    constexpr size_t NULL_MINIMUM_PAIRS = 2;
+
+    constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+    constexpr uint64_t LOW_BITS = 0x0101010101010101ull;
+
+    // Error classes of Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+    // Each table maps a nibble of a byte pair to the classes it allows; a pair is an error when all
+    // three lookups share a bit. TWO_CONTS is then cancelled where a lead byte two or three bytes
+    // back does expect a further continuation.
+    constexpr uint8_t TOO_SHORT = 1 << 0;  // 11______ followed by 0_______ or 11______
+    constexpr uint8_t TOO_LONG = 1 << 1;   // 0_______ followed by 10______
+    constexpr uint8_t OVERLONG_3 = 1 << 2; // 11100000 100_____
+    constexpr uint8_t TOO_LARGE = 1 << 3;  // 11110100 1001____, 11110101 and above 1001____ or 101_____
+    constexpr uint8_t SURROGATE = 1 << 4;  // 11101101 101_____
+    constexpr uint8_t OVERLONG_2 = 1 << 5; // 1100000_ 10______
+    constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // 11110101 and above 1000____
+    constexpr uint8_t OVERLONG_4 = 1 << 6; // 11110000 1000____
+    constexpr uint8_t TWO_CONTS = 1 << 7;  // 10______ 10______
+    constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+    // indexed by the high nibble of the first byte
+    alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+    };
+
+    // indexed by the low nibble of the first byte
+    alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+    };
+
+    // indexed by the high nibble of the second byte
+    alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    };
+
+    // A block is incomplete when one of its last three bytes starts a sequence that needs more bytes
+    // than are left; subtracting these saturates to zero everywhere else. NEON uses the last 16.
+    alignas(32) constexpr uint8_t INCOMPLETE_MAX[32] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+    };
+
+    // a 64-byte block past the end of the buffer is padded with spaces
+    constexpr uint8_t PADDING = 0x20;
+}
+
+TextEncoding::Kind TextEncoding::Detect(const uint8_t* data, size_t size, bool truncated)
+{
+    return Detect(data, size, truncated, Simd::Best());
+}
+
+TextEncoding::Kind TextEncoding::Detect(const uint8_t* data, size_t size, bool truncated, Simd::Level level)
+{
+    if (size == 0)
+        return UNKNOWN;
+
+    auto bom = byteOrderMark(data, size);
+    if (bom != UNKNOWN)
+        return bom;
+
+    auto length = truncated ? trimTruncated(data, size) : size;
+    if (length == 0)
+        return UNKNOWN;
+
+    uint32_t scan;
+    switch (level)
+    {
+#ifdef QL_SIMD_X86
+    case Simd::SSE2:
+        scan = scanSse2(data, length);
+        break;
+    case Simd::AVX2:
+        scan = scanAvx2(data, length);
+        break;
+#endif
+#ifdef QL_SIMD_NEON
+    case Simd::NEON:
+        scan = scanNeon(data, length);
+        break;
+#endif
+    default:
+        scan = scanScalar(data, length);
+        break;
+    }
+
+    if (scan == SCAN_ASCII)
+        return ASCII;
+    if (scan == SCAN_UTF8)
+        return UTF8;
+
+    // zero bytes or invalid UTF-8: either UTF-16 without a BOM, or a job for the statistical detector
+    return nullPattern(data, size);
+}
+
+TextEncoding::Kind TextEncoding::byteOrderMark(const uint8_t* data, size_t size)
+{
+    // UTF-32LE first, its BOM starts with the UTF-16LE one
+    if (size >= 4 && data[0] == 0xFF && data[1] == 0xFE && data[2] == 0x00 && data[3] == 0x00)
+        return UTF32LE_BOM;
+    if (size >= 4 && data[0] == 0x00 && data[1] == 0x00 && data[2] == 0xFE && data[3] == 0xFF)
+        return UTF32BE_BOM;
+    if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
+        return UTF8_BOM;
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE)
+        return UTF16LE_BOM;
+    if (size >= 2 && data[0] == 0xFE && data[1] == 0xFF)
+        return UTF16BE_BOM;
+    return UNKNOWN;
+}
+
+TextEncoding::Kind TextEncoding::nullPattern(const uint8_t* data, size_t size)
+{
+    // Text in UTF-16 has most of its zero bytes on one side of each code unit: the high byte of
+    // every ASCII and Latin-1 character. Binary data has them on both sides.
+    auto pairs = (size < NULL_SAMPLE_SIZE ? size : NULL_SAMPLE_SIZE) / 2;
+    if (pairs < NULL_MINIMUM_PAIRS)
+        return UNKNOWN;
+
+    size_t even = 0;
+    size_t odd = 0;
+    for (size_t i = 0; i < pairs; i++)
+    {
+        even += data[2 * i] == 0;
+        odd += data[2 * i + 1] == 0;
+    }
+
+    if (odd * 8 >= pairs && even * 16 <= odd)
+        return UTF16LE;
+    if (even * 8 >= pairs && odd * 16 <= even)
+        return UTF16BE;
+    return UNKNOWN;
+}
+
+size_t TextEncoding::trimTruncated(const uint8_t* data, size_t size)
+{
+    // drop a sequence that the end of the buffer cuts off, so a sampled head still validates; only a
+    // lead byte with the continuation bytes it allows is dropped, anything else is left to the scan
+    for (size_t back = 1; back <= 3 && back <= size; back++)
+    {
+        auto lead = data[size - back];
+        if ((lead & 0xC0) == 0x80)
+            continue;
+
+        // C0, C1 and F5 to FF never start a sequence
+        if (lead < 0xC2 || lead > 0xF4)
+            return size;
+
+        auto needed = lead >= 0xF0 ? 4u : lead >= 0xE0 ? 3u : 2u;
+        if (needed <= back)
+            return size;
+
+        // the second byte of E0, ED, F0 and F4 sequences has a narrower range; see scalarStep
+        if (back >= 2)
+        {
+            auto second = data[size - back + 1];
+            if ((lead == 0xE0 && second < 0xA0) || (lead == 0xED && second > 0x9F) ||
+                (lead == 0xF0 && second < 0x90) || (lead == 0xF4 && second > 0x8F))
+                return size;
+        }
+        return size - back;
+    }
+    return size;
+}
+
+size_t TextEncoding::scalarStep(const uint8_t* data, size_t size)
+{
+    // returns the length of the well-formed sequence at data, or 0; see Table 3-7 of the Unicode standard
+    auto lead = data[0];
+    if (lead < 0x80)
+        return 1;
+
+    size_t length;
+    uint8_t low = 0x80;
+    uint8_t high = 0xBF;
+    if (lead < 0xC2)
+        return 0;
+    if (lead < 0xE0)
+        length = 2;
+    else if (lead < 0xF0)
+    {
+        length = 3;
+        if (lead == 0xE0)
+            low = 0xA0;
+        else if (lead == 0xED)
+            high = 0x9F;
+    }
+    else if (lead < 0xF5)
+    {
+        length = 4;
+        if (lead == 0xF0)
+            low = 0x90;
+        else if (lead == 0xF4)
+            high = 0x8F;
+    }
+    else
+        return 0;
+
+    if (size < length || data[1] < low || data[1] > high)
+        return 0;
+    for (size_t i = 2; i < length; i++)
+    {
+        if ((data[i] & 0xC0) != 0x80)
+            return 0;
+    }
+    return length;
+}
+
+uint32_t TextEncoding::scanScalar(const uint8_t* data, size_t size)
+{
+    uint32_t result = SCAN_ASCII;
+    size_t pos = 0;
+    while (pos < size)
+    {
+        if (size - pos >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, data + pos, 8);
+            if ((word & HIGH_BITS) == 0)
+            {
+                if (((word - LOW_BITS) & ~word & HIGH_BITS) != 0)
+                    result |= SCAN_NULL;
+                pos += 8;
+                continue;
+            }
+        }
+
+        auto byte = data[pos];
+        if (byte < 0x80)
+        {
+            if (byte == 0)
+                result |= SCAN_NULL;
+            pos++;
+            continue;
+        }
+
+        auto step = scalarStep(data + pos, size - pos);
+        if (step == 0)
+            return SCAN_INVALID;
+        result |= SCAN_UTF8;
+        pos += step;
+    }
+    return result;
+}
+
+#ifdef QL_SIMD_X86
+
+uint32_t TextEncoding::scanSse2(const uint8_t* data, size_t size)
+{
+    // SSE2 has no byte shuffle for the lookups, so blocks with non-ASCII bytes go one code point
+    // at a time
+    auto minimum = _mm_set1_epi8(-1);
+    auto nonAscii = false;
+    size_t pos = 0;
+    while (size - pos >= BLOCK_SIZE)
+    {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 16));
+        auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 32));
+        auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 48));
+        minimum = _mm_min_epu8(minimum, _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d)));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) == 0)
+        {
+            pos += BLOCK_SIZE;
+            continue;
+        }
+
+        // the last sequence may run up to three bytes into the next block, which then starts there
+        nonAscii = true;
+        for (auto end = pos + BLOCK_SIZE; pos < end;)
+        {
+            auto step = scalarStep(data + pos, size - pos);
+            if (step == 0)
+                return SCAN_INVALID;
+            pos += step;
+        }
+    }
+
+    auto result = scanScalar(data + pos, size - pos);
+    if (result == SCAN_INVALID)
+        return SCAN_INVALID;
+    if (nonAscii)
+        result |= SCAN_UTF8;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(minimum, _mm_setzero_si128())) != 0)
+        result |= SCAN_NULL;
+    return result;
+}
+
+namespace
+{
+    QL_TARGET_AVX2 inline __m256i lookupAvx2(const uint8_t* table, __m256i nibbles)
+    {
+        auto lanes = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+        return _mm256_shuffle_epi8(lanes, nibbles);
+    }
+
+    // error bits of every byte pair in input, whose preceding 32 bytes are previous
+    QL_TARGET_AVX2 inline __m256i checkAvx2(__m256i input, __m256i previous)
+    {
+        auto low4 = _mm256_set1_epi8(0x0F);
+        // the 32 bytes before input: the high lane of previous, then the low lane of input
+        auto shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+        auto prev1 = _mm256_alignr_epi8(input, shifted, 15);
+        auto prev2 = _mm256_alignr_epi8(input, shifted, 14);
+        auto prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+        auto special = _mm256_and_si256(
+            _mm256_and_si256(lookupAvx2(BYTE_1_HIGH, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low4)),
+                             lookupAvx2(BYTE_1_LOW, _mm256_and_si256(prev1, low4))),
+            lookupAvx2(BYTE_2_HIGH, _mm256_and_si256(_mm256_srli_epi16(input, 4), low4)));
+
+        // only 111_____ two bytes back and 1111____ three bytes back keep their high bit
+        auto third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        auto fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        auto expected = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+        return _mm256_xor_si256(expected, special);
+    }
+}
+
+QL_TARGET_AVX2 uint32_t TextEncoding::scanAvx2(const uint8_t* data, size_t size)
+{
+    auto incompleteMax = _mm256_load_si256(reinterpret_cast<const __m256i*>(INCOMPLETE_MAX));
+    auto error = _mm256_setzero_si256();
+    auto previous = _mm256_setzero_si256();
+    auto incomplete = _mm256_setzero_si256();
+    auto minimum = _mm256_set1_epi8(-1);
+    auto nonAscii = false;
+
+    uint8_t tail[BLOCK_SIZE];
+    for (size_t pos = 0; pos < size; pos += BLOCK_SIZE)
+    {
+        auto block = data + pos;
+        if (size - pos < BLOCK_SIZE)
+        {
+            memset(tail, PADDING, BLOCK_SIZE);
+            memcpy(tail, block, size - pos);
+            block = tail;
+        }
+
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+        minimum = _mm256_min_epu8(minimum, _mm256_min_epu8(a, b));
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) == 0)
+        {
+            error = _mm256_or_si256(error, incomplete);
+            continue;
+        }
+
+        nonAscii = true;
+        error = _mm256_or_si256(error, _mm256_or_si256(checkAvx2(a, previous), checkAvx2(b, a)));
+        incomplete = _mm256_subs_epu8(b, incompleteMax);
+        previous = b;
+        if (!_mm256_testz_si256(error, error))
+            return SCAN_INVALID;
+    }
+
+    error = _mm256_or_si256(error, incomplete);
+    if (!_mm256_testz_si256(error, error))
+        return SCAN_INVALID;
+
+    uint32_t result = nonAscii ? SCAN_UTF8 : SCAN_ASCII;
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(minimum, _mm256_setzero_si256())) != 0)
+        result |= SCAN_NULL;
+    return result;
+}
+
+#endif
+
+#ifdef QL_SIMD_NEON
+
+namespace
+{
+    // error bits of every byte pair in input, whose preceding 16 bytes are previous
+    inline uint8x16_t checkNeon(uint8x16_t input, uint8x16_t previous)
+    {
+        auto low4 = vdupq_n_u8(0x0F);
+        auto prev1 = vextq_u8(previous, input, 15);
+        auto prev2 = vextq_u8(previous, input, 14);
+        auto prev3 = vextq_u8(previous, input, 13);
+
+        auto special = vandq_u8(vandq_u8(vqtbl1q_u8(vld1q_u8(BYTE_1_HIGH), vshrq_n_u8(prev1, 4)),
+                                         vqtbl1q_u8(vld1q_u8(BYTE_1_LOW), vandq_u8(prev1, low4))),
+                                vqtbl1q_u8(vld1q_u8(BYTE_2_HIGH), vshrq_n_u8(input, 4)));
+
+        // only 111_____ two bytes back and 1111____ three bytes back keep their high bit
+        auto third = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+        auto fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+        auto expected = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+        return veorq_u8(expected, special);
+    }
+}
+
+uint32_t TextEncoding::scanNeon(const uint8_t* data, size_t size)
+{
+    auto incompleteMax = vld1q_u8(INCOMPLETE_MAX + 16);
+    auto error = vdupq_n_u8(0);
+    auto previous = vdupq_n_u8(0);
+    auto incomplete = vdupq_n_u8(0);
+    auto minimum = vdupq_n_u8(0xFF);
+    auto nonAscii = false;
+
+    uint8_t tail[BLOCK_SIZE];
+    for (size_t pos = 0; pos < size; pos += BLOCK_SIZE)
+    {
+        auto block = data + pos;
+        if (size - pos < BLOCK_SIZE)
+        {
+            memset(tail, PADDING, BLOCK_SIZE);
+            memcpy(tail, block, size - pos);
+            block = tail;
+        }
+
+        auto a = vld1q_u8(block);
+        auto b = vld1q_u8(block + 16);
+        auto c = vld1q_u8(block + 32);
+        auto d = vld1q_u8(block + 48);
+        minimum = vminq_u8(minimum, vminq_u8(vminq_u8(a, b), vminq_u8(c, d)));
+        if (vmaxvq_u8(vorrq_u8(vorrq_u8(a, b), vorrq_u8(c, d))) < 0x80)
+        {
+            error = vorrq_u8(error, incomplete);
+            continue;
+        }
+
+        nonAscii = true;
+        error = vorrq_u8(error, vorrq_u8(vorrq_u8(checkNeon(a, previous), checkNeon(b, a)),
+                                         vorrq_u8(checkNeon(c, b), checkNeon(d, c))));
+        incomplete = vqsubq_u8(d, incompleteMax);
+        previous = d;
+        if (vmaxvq_u8(error) != 0)
+            return SCAN_INVALID;
+    }
+
+    if (vmaxvq_u8(vorrq_u8(error, incomplete)) != 0)
+        return SCAN_INVALID;
+
+    uint32_t result = nonAscii ? SCAN_UTF8 : SCAN_ASCII;
+    if (vminvq_u8(minimum) == 0)
+        result |= SCAN_NULL;
+    return result;
+}
+
+#endif
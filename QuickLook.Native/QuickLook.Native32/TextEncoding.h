@@ -0,0 +1,79 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "Simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Fast path in front of the statistical charset detectors of the text, CSV and archive viewers.
+// Most files are plain ASCII or valid UTF-8, or announce themselves with a byte order mark, and
+// for those one pass over the bytes settles the question; everything else comes back as UNKNOWN
+// and is left to the statistical detector.
+//
+// The pass skips ASCII 64 bytes at a time and validates UTF-8 with the lookup-table method of
+// Keiser and Lemire on AVX2 and NEON; the SSE2 kernel only skips ASCII and checks the rest one
+// code point at a time. When the buffer is only the head of a file, a well-formed prefix of a
+// sequence cut off at its end is accepted.
+class TextEncoding
+{
+public:
+    // Must match NativeTextEncoding.Kind in QuickLook.Plugin.TextViewer/Detectors/NativeTextEncoding.cs
+    enum Kind : uint32_t
+    {
+        UNKNOWN = 0,
+        ASCII = 1,
+        UTF8 = 2,
+        UTF8_BOM = 3,
+        UTF16LE_BOM = 4,
+        UTF16BE_BOM = 5,
+        UTF32LE_BOM = 6,
+        UTF32BE_BOM = 7,
+        UTF16LE = 8, // no BOM; told by where the zero bytes fall
+        UTF16BE = 9,
+    };
+
+    // truncated: data is the head of a longer file and may end in the middle of a sequence
+    static Kind Detect(const uint8_t* data, size_t size, bool truncated);
+    // for benchmarks; the level must be supported
+    static Kind Detect(const uint8_t* data, size_t size, bool truncated, Simd::Level level);
+
+private:
+    enum Scan : uint32_t
+    {
+        SCAN_ASCII = 0,
+        SCAN_UTF8 = 1,
+        SCAN_INVALID = 2,
+        SCAN_NULL = 4, // flag: the buffer has a zero byte
+    };
+
+    static Kind byteOrderMark(const uint8_t* data, size_t size);
+    static Kind nullPattern(const uint8_t* data, size_t size);
+    static size_t trimTruncated(const uint8_t* data, size_t size);
+    static size_t scalarStep(const uint8_t* data, size_t size);
+
+    static uint32_t scanScalar(const uint8_t* data, size_t size);
+#ifdef QL_SIMD_X86
+    static uint32_t scanSse2(const uint8_t* data, size_t size);
+    static uint32_t scanAvx2(const uint8_t* data, size_t size);
+#endif
+#ifdef QL_SIMD_NEON
+    static uint32_t scanNeon(const uint8_t* data, size_t size);
+#endif
+};
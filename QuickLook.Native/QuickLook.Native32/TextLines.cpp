@@ -0,0 +1,349 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TextLines.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t LINE_FEED = 0x0A;
+    // LF as one little-endian 16-bit load sees it in either byte order
+    constexpr uint16_t LINE_FEED_LE = 0x000A;
+    constexpr uint16_t LINE_FEED_BE = 0x0A00;
+
+    inline uint32_t unitSize(TextLines::Newline newline)
+    {
+        return newline == TextLines::LF ? 1 : 2;
+    }
+
+    // Takes the line ends marked in a comparison mask of one block, with bitsPerByte bits for each
+    // byte of the block. Returns false if there are fewer than *count, which is then lowered by
+    // their number; otherwise sets *at to where the *count-th one begins in the block.
+    inline bool take(uint64_t mask, uint32_t bitsPerByte, uint32_t unit, uint64_t* count, size_t* at)
+    {
+        auto laneBits = bitsPerByte * unit;
+        auto lanes = Simd::PopCount(mask) / laneBits;
+        if (lanes < *count)
+        {
+            *count -= lanes;
+            return false;
+        }
+
+        // all bits of a lane are set together, so the lowest set bit starts a lane
+        auto lane = (1ull << laneBits) - 1;
+        for (; *count > 1; --*count)
+            mask &= ~(lane << Simd::TrailingZeros(mask));
+        *count = 0;
+        *at = Simd::TrailingZeros(mask) / bitsPerByte;
+        return true;
+    }
+
+    size_t skipScalar(const uint8_t* data, size_t size, TextLines::Newline newline, uint64_t* count, size_t i)
+    {
+        if (newline == TextLines::LF)
+        {
+            while (i < size)
+            {
+                auto hit = static_cast<const uint8_t*>(memchr(data + i, LINE_FEED, size - i));
+                if (hit == nullptr)
+                    break;
+
+                i = static_cast<size_t>(hit - data) + 1;
+                if (--*count == 0)
+                    return i;
+            }
+            return size;
+        }
+
+        // the line feed is the low byte of the unit, which comes first in little endian
+        auto low = newline == TextLines::LF_UTF16LE ? 0 : 1;
+        for (; i + 2 <= size; i += 2)
+        {
+            if (data[i + low] == LINE_FEED && data[i + 1 - low] == 0 && --*count == 0)
+                return i + 2;
+        }
+        return size;
+    }
+
+    // The vector kernels compare whole blocks against the line feed and only look for single line
+    // ends in blocks that hold the one wanted; the others are just counted. They stop at the last
+    // full block and leave the rest in *next.
+
+#ifdef QL_SIMD_X86
+    size_t skipSse2(const uint8_t* data, size_t size, TextLines::Newline newline, uint64_t* count, size_t* next)
+    {
+        auto unit = unitSize(newline);
+        auto byte = _mm_set1_epi8(static_cast<char>(LINE_FEED));
+        auto word = _mm_set1_epi16(static_cast<short>(newline == TextLines::LF_UTF16BE ? LINE_FEED_BE : LINE_FEED_LE));
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            uint64_t mask = 0;
+            for (int part = 0; part < 4; part++)
+            {
+                auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16 * part));
+                auto equal = unit == 1 ? _mm_cmpeq_epi8(bytes, byte) : _mm_cmpeq_epi16(bytes, word);
+                mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(equal))) << (16 * part);
+            }
+
+            size_t at;
+            if (mask != 0 && take(mask, 1, unit, count, &at))
+                return i + at + unit;
+        }
+        *next = i;
+        return size;
+    }
+
+    QL_TARGET_AVX2 size_t skipAvx2(const uint8_t* data, size_t size, TextLines::Newline newline, uint64_t* count,
+                                   size_t* next)
+    {
+        auto unit = unitSize(newline);
+        auto byte = _mm256_set1_epi8(static_cast<char>(LINE_FEED));
+        auto word =
+            _mm256_set1_epi16(static_cast<short>(newline == TextLines::LF_UTF16BE ? LINE_FEED_BE : LINE_FEED_LE));
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            auto low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            auto high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+            auto lowEqual = unit == 1 ? _mm256_cmpeq_epi8(low, byte) : _mm256_cmpeq_epi16(low, word);
+            auto highEqual = unit == 1 ? _mm256_cmpeq_epi8(high, byte) : _mm256_cmpeq_epi16(high, word);
+            auto mask = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(lowEqual))) |
+                        static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(highEqual))) << 32;
+
+            size_t at;
+            if (mask != 0 && take(mask, 1, unit, count, &at))
+                return i + at + unit;
+        }
+        *next = i;
+        return size;
+    }
+#endif
+
+#ifdef QL_SIMD_NEON
+    size_t skipNeon(const uint8_t* data, size_t size, TextLines::Newline newline, uint64_t* count, size_t* next)
+    {
+        auto unit = unitSize(newline);
+        auto byte = vdupq_n_u8(LINE_FEED);
+        auto word = vdupq_n_u16(newline == TextLines::LF_UTF16BE ? LINE_FEED_BE : LINE_FEED_LE);
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            auto bytes = vld1q_u8(data + i);
+            auto equal = unit == 1 ? vceqq_u8(bytes, byte)
+                                   : vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(bytes), word));
+            // NEON has no movemask; narrowing leaves four bits per byte
+            auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+
+            size_t at;
+            if (mask != 0 && take(mask, 4, unit, count, &at))
+                return i + at + unit;
+        }
+        *next = i;
+        return size;
+    }
+#endif
+}
+
+bool TextLines::Open(const MappedFile::PathChar* path, Newline newline, uint64_t start)
+{
+    if (newline > LF_UTF16BE || !_buildWindow.Open(path) || !_readWindow.Open(path))
+        return false;
+
+    _newline = newline;
+    _size = _buildWindow.Size();
+    if (start > _size)
+        start = _size;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _checkpoints.assign(1, start);
+    _lineEnds = 0;
+    _indexed = start;
+    return true;
+}
+
+TextLines::Info TextLines::GetInfo()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    // the last line has no line end; it is known once the whole file is
+    return {_size, _indexed == _size ? _lineEnds + 1 : _lineEnds, _indexed};
+}
+
+bool TextLines::Build(uint32_t bytes)
+{
+    // only this thread changes the index, so it can read it without the lock
+    auto position = _indexed;
+    if (position == _size)
+        return false;
+
+    // a step ends on a unit boundary, so no line end is split between two
+    auto unit = unitSize(_newline);
+    auto end = _size - position > bytes ? position + bytes / unit * unit : _size;
+    auto lineEnds = _lineEnds;
+    std::vector<uint64_t> checkpoints;
+
+    while (position < end)
+    {
+        auto wanted = CHECKPOINT_INTERVAL - lineEnds % CHECKPOINT_INTERVAL;
+        auto count = wanted;
+        if (!skip(_buildWindow, &position, end, &count))
+            return false;
+
+        lineEnds += wanted - count;
+        if (count == 0)
+            checkpoints.push_back(position);
+    }
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _checkpoints.insert(_checkpoints.end(), checkpoints.begin(), checkpoints.end());
+    _lineEnds = lineEnds;
+    _indexed = end;
+    return end < _size;
+}
+
+bool TextLines::FindLine(uint64_t offset, uint64_t* line)
+{
+    uint64_t position, first, indexed;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        indexed = _indexed;
+        if (offset >= indexed)
+            return false;
+
+        // the last checkpoint at or before offset; a byte order mark counts as part of line 0
+        auto after = std::upper_bound(_checkpoints.begin(), _checkpoints.end(), offset);
+        auto index = after == _checkpoints.begin() ? 0 : static_cast<size_t>(after - _checkpoints.begin() - 1);
+        position = _checkpoints[index];
+        first = index * CHECKPOINT_INTERVAL;
+    }
+
+    // at most CHECKPOINT_INTERVAL lines from there
+    while (true)
+    {
+        uint64_t one = 1;
+        if (!skip(_readWindow, &position, indexed, &one))
+            return false;
+
+        // no line end before indexed means offset is in the last line
+        if (one != 0 || position > offset)
+        {
+            *line = first;
+            return true;
+        }
+        first++;
+    }
+}
+
+uint32_t TextLines::GetLines(uint64_t firstLine, uint32_t count, uint64_t* starts)
+{
+    uint64_t position, lineEnds, indexed;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        lineEnds = _lineEnds;
+        indexed = _indexed;
+        // lines up to the last line end indexed have a checkpoint at or before them
+        if (firstLine > lineEnds)
+            return 0;
+        position = _checkpoints[static_cast<size_t>(firstLine / CHECKPOINT_INTERVAL)];
+    }
+
+    uint64_t ahead = firstLine % CHECKPOINT_INTERVAL;
+    if (ahead != 0 && (!skip(_readWindow, &position, indexed, &ahead) || ahead != 0))
+        return 0;
+
+    // the line after the last line end ends with the file, once all of it is indexed
+    auto lines = indexed == _size ? lineEnds + 1 : lineEnds;
+    uint32_t found = 0;
+    starts[0] = position;
+    while (found < count && firstLine + found < lines)
+    {
+        uint64_t one = 1;
+        if (!skip(_readWindow, &position, indexed, &one))
+            break;
+
+        starts[++found] = position;
+    }
+    return found;
+}
+
+uint32_t TextLines::Read(uint64_t offset, uint32_t length, uint8_t* buffer)
+{
+    if (offset >= _size)
+        return 0;
+    if (length > _size - offset)
+        length = static_cast<uint32_t>(_size - offset);
+
+    uint32_t copied = 0;
+    while (copied < length)
+    {
+        auto part = length - copied < MappedWindow::MAX_SPAN ? length - copied : MappedWindow::MAX_SPAN;
+        auto data = _readWindow.View(offset + copied, part);
+        if (data == nullptr)
+            break;
+
+        memcpy(buffer + copied, data, part);
+        copied += part;
+    }
+    return copied;
+}
+
+bool TextLines::skip(MappedWindow& window, uint64_t* offset, uint64_t end, uint64_t* count) const
+{
+    // MAX_SPAN is even, so the parts stay on unit boundaries
+    while (*count != 0 && *offset < end)
+    {
+        auto part =
+            end - *offset < MappedWindow::MAX_SPAN ? static_cast<uint32_t>(end - *offset) : MappedWindow::MAX_SPAN;
+        auto data = window.View(*offset, part);
+        if (data == nullptr)
+            return false;
+
+        *offset += Skip(data, part, _newline, count, Simd::Best());
+    }
+    return true;
+}
+
+size_t TextLines::Skip(const uint8_t* data, size_t size, Newline newline, uint64_t* count, Simd::Level level)
+{
+    if (*count == 0)
+        return 0;
+
+    size_t next = 0;
+    size_t index = size;
+    switch (level)
+    {
+#ifdef QL_SIMD_X86
+    case Simd::SSE2:
+        index = skipSse2(data, size, newline, count, &next);
+        break;
+    case Simd::AVX2:
+        index = skipAvx2(data, size, newline, count, &next);
+        break;
+#endif
+#ifdef QL_SIMD_NEON
+    case Simd::NEON:
+        index = skipNeon(data, size, newline, count, &next);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return *count == 0 ? index : skipScalar(data, size, newline, count, next);
+}
@@ -0,0 +1,96 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "MappedWindow.h"
+#include "Simd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Line index of a text file of any size for the text viewer. The file is read through MappedWindows
+// and the line ends are counted by a background pass, which remembers where every
+// CHECKPOINT_INTERVAL-th line starts. Finding a line then means scanning at most that many lines
+// from its checkpoint, so the viewer can jump to any line in the same time however large the file
+// is, and only decodes the lines it shows.
+//
+// Lines end with LF, in the code unit of the encoding; a CR before it is left to the caller. Build
+// runs on one thread while the other calls are made from another; GetLines sees the lines indexed
+// so far.
+class TextLines
+{
+public:
+    static constexpr uint32_t CHECKPOINT_INTERVAL = 64;
+
+    // Must match NativeTextLines.Newline in QuickLook.Plugin.TextViewer/NativeTextLines.cs
+    enum Newline : uint32_t
+    {
+        LF = 0, // ASCII, UTF-8 and the single and double byte code pages
+        LF_UTF16LE = 1,
+        LF_UTF16BE = 2,
+    };
+
+    // Must match TextLinesInfo in QuickLook.Plugin.TextViewer/NativeTextLines.cs
+    struct Info
+    {
+        uint64_t size;
+        uint64_t lines;   // lines whose end is known; all of them once indexed reaches size
+        uint64_t indexed; // offset up to which the line ends are counted
+    };
+
+    // The first line begins at start, after any byte order mark.
+    bool Open(const MappedFile::PathChar* path, Newline newline, uint64_t start);
+
+    Info GetInfo();
+
+    // Counts the line ends in the next bytes bytes of the file. Returns false once the whole file
+    // is indexed, or if it cannot be read.
+    bool Build(uint32_t bytes);
+
+    // Stores where lines firstLine to firstLine + count - 1 begin, and after them where the last
+    // one ends, in starts[0] to starts[count]. A line's bytes include its line end. Returns the
+    // number of lines found, which is less than count at the end of what is indexed.
+    uint32_t GetLines(uint64_t firstLine, uint32_t count, uint64_t* starts);
+
+    // Stores the number of the line that offset is in, for jumping to a search match. Fails if
+    // offset is not indexed yet.
+    bool FindLine(uint64_t offset, uint64_t* line);
+
+    // Copies up to length bytes from offset and returns how many were copied.
+    uint32_t Read(uint64_t offset, uint32_t length, uint8_t* buffer);
+
+    // Moves past up to *count line ends and returns where it stopped: just after the *count-th, with
+    // *count set to 0, or at the end of data, with *count lowered by the line ends passed.
+    static size_t Skip(const uint8_t* data, size_t size, Newline newline, uint64_t* count, Simd::Level level);
+
+private:
+    bool skip(MappedWindow& window, uint64_t* offset, uint64_t end, uint64_t* count) const;
+
+    MappedWindow _buildWindow;
+    MappedWindow _readWindow;
+    Newline _newline = LF;
+    uint64_t _size = 0;
+
+    // guards the fields below, which Build changes while the lines are read
+    std::mutex _lock;
+    std::vector<uint64_t> _checkpoints; // where lines 0, CHECKPOINT_INTERVAL, 2 * CHECKPOINT_INTERVAL... begin
+    uint64_t _lineEnds = 0;
+    uint64_t _indexed = 0;
+};
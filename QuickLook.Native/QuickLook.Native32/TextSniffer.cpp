@@ -0,0 +1,176 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TextSniffer.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace
+{
+    constexpr uint32_t OTHER = 128; // any code unit past ASCII
+    constexpr uint32_t SYMBOLS = 129;
+    constexpr uint32_t ROOT = 0;
+    constexpr uint32_t NO_LINE_START = UINT32_MAX;
+    constexpr uint16_t BYTE_ORDER_MARK = 0xFEFF;
+
+    inline uint16_t fold(uint16_t unit)
+    {
+        return unit >= 'A' && unit <= 'Z' ? unit + ('a' - 'A') : unit;
+    }
+
+    inline uint32_t symbolOf(uint16_t unit)
+    {
+        return unit < OTHER ? fold(unit) : OTHER;
+    }
+}
+
+bool TextSniffer::Compile(const Signature* signatures, uint32_t count, const uint16_t* text, uint32_t textLength)
+{
+    if (count > MAX_SIGNATURES)
+        return false;
+
+    _entries.clear();
+    _formats = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        auto& signature = signatures[i];
+        if (signature.format >= MAX_FORMATS || signature.length == 0 || signature.length > MAX_LENGTH ||
+            signature.begin > textLength || signature.length > textLength - signature.begin)
+            return false;
+
+        Entry entry{signature.format, signature.weight, signature.flags, (signature.flags & IGNORE_CASE) == 0,
+                    std::vector<uint16_t>(text + signature.begin, text + signature.begin + signature.length)};
+        entry.verify = entry.verify || std::any_of(entry.text.begin(), entry.text.end(),
+                                                   [](uint16_t unit) { return unit >= OTHER; });
+        _formats = std::max(_formats, signature.format + 1);
+        _entries.push_back(std::move(entry));
+    }
+
+    // the trie of the folded strings
+    _next.assign(SYMBOLS, ROOT);
+    _outputs.assign(1, {});
+    std::vector<bool> inTrie(SYMBOLS, false); // transitions of the trie, as opposed to the ones added below
+    for (uint32_t i = 0; i < _entries.size(); i++)
+    {
+        uint32_t state = ROOT;
+        for (auto unit : _entries[i].text)
+        {
+            auto at = state * SYMBOLS + symbolOf(unit);
+            if (!inTrie[at])
+            {
+                inTrie[at] = true;
+                _next[at] = static_cast<uint32_t>(_outputs.size());
+                _next.resize(_next.size() + SYMBOLS, ROOT);
+                inTrie.resize(_next.size(), false);
+                _outputs.emplace_back();
+            }
+            state = _next[at];
+        }
+        _outputs[state].push_back(i);
+    }
+
+    // breadth first, each state takes the transitions and outputs of its longest proper suffix
+    std::vector<uint32_t> fail(_outputs.size(), ROOT);
+    std::queue<uint32_t> pending;
+    for (uint32_t symbol = 0; symbol < SYMBOLS; symbol++)
+    {
+        if (inTrie[symbol])
+            pending.push(_next[symbol]);
+    }
+    while (!pending.empty())
+    {
+        auto state = pending.front();
+        pending.pop();
+        auto& inherited = _outputs[fail[state]];
+        _outputs[state].insert(_outputs[state].end(), inherited.begin(), inherited.end());
+
+        for (uint32_t symbol = 0; symbol < SYMBOLS; symbol++)
+        {
+            auto at = state * SYMBOLS + symbol;
+            auto fallback = _next[fail[state] * SYMBOLS + symbol];
+            if (inTrie[at])
+            {
+                fail[_next[at]] = fallback;
+                pending.push(_next[at]);
+            }
+            else
+            {
+                _next[at] = fallback;
+            }
+        }
+    }
+    return true;
+}
+
+uint32_t TextSniffer::Run(const uint16_t* text, uint32_t length, Candidate* candidates, uint32_t capacity) const
+{
+    std::vector<int32_t> scores(_formats, 0);
+    std::vector<bool> seen(_entries.size(), false);
+    uint32_t start = length != 0 && text[0] == BYTE_ORDER_MARK ? 1 : 0;
+    uint32_t lineStart = NO_LINE_START; // the first character on the line that is not a space or tab
+    uint32_t state = ROOT;
+    for (auto i = start; i < length; i++)
+    {
+        auto unit = text[i];
+        auto newline = unit == '\n' || unit == '\r';
+        if (lineStart == NO_LINE_START && !newline && unit != ' ' && unit != '\t')
+            lineStart = i;
+
+        state = _next[state * SYMBOLS + symbolOf(unit)];
+        for (auto index : _outputs[state])
+        {
+            auto& entry = _entries[index];
+            auto begin = i + 1 - static_cast<uint32_t>(entry.text.size());
+            if ((seen[index] && (entry.flags & EVERY_MATCH) == 0) ||
+                ((entry.flags & TEXT_START) != 0 && begin != start) ||
+                ((entry.flags & LINE_START) != 0 && begin != lineStart) ||
+                (entry.verify && !matches(entry, text, begin)))
+                continue;
+
+            seen[index] = true;
+            scores[entry.format] += entry.weight;
+        }
+
+        // a match that ends with the line end began on that line
+        if (newline)
+            lineStart = NO_LINE_START;
+    }
+
+    std::vector<Candidate> found;
+    for (uint32_t format = 0; format < _formats; format++)
+    {
+        if (scores[format] > 0)
+            found.push_back({format, scores[format]});
+    }
+    std::stable_sort(found.begin(), found.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+    std::copy_n(found.begin(), std::min<size_t>(found.size(), capacity), candidates);
+    return static_cast<uint32_t>(found.size());
+}
+
+bool TextSniffer::matches(const Entry& entry, const uint16_t* text, uint32_t begin) const
+{
+    auto ignoreCase = (entry.flags & IGNORE_CASE) != 0;
+    for (size_t i = 0; i < entry.text.size(); i++)
+    {
+        auto unit = text[begin + i];
+        if (ignoreCase ? fold(unit) != fold(entry.text[i]) : unit != entry.text[i])
+            return false;
+    }
+    return true;
+}
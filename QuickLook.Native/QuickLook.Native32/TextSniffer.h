@@ -0,0 +1,87 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Scores the head of a text for all the formats the text viewer detects at once. Each format has
+// signatures, strings whose presence makes it more or less likely by their weight, and all of them
+// are compiled into one Aho-Corasick automaton, so the text is read once however many there are.
+//
+// The text is UTF-16, as the viewer has it. The automaton runs on ASCII folded to lower case, with
+// every other code unit as one symbol, and a match of a signature that is case sensitive or not
+// ASCII is compared again with the text.
+class TextSniffer
+{
+public:
+    static constexpr uint32_t MAX_SIGNATURES = 4096;
+    static constexpr uint32_t MAX_LENGTH = 256;
+    static constexpr uint32_t MAX_FORMATS = 1024;
+
+    // Must match FormatSignatureOptions in QuickLook.Plugin.TextViewer/Detectors/FormatDetector.cs
+    enum Flags : uint32_t
+    {
+        IGNORE_CASE = 0x1, // ASCII letters only
+        LINE_START = 0x2,  // after nothing but spaces and tabs on its line
+        TEXT_START = 0x4,  // at the start of the text, after any byte order mark
+        EVERY_MATCH = 0x8, // weighs once for every match rather than once
+    };
+
+    // Must match SniffSignature in QuickLook.Plugin.TextViewer/Detectors/NativeFormatSniffer.cs
+    struct Signature
+    {
+        uint32_t format;
+        int32_t weight;
+        uint32_t flags;
+        uint32_t begin; // where the string is in the text given to Compile
+        uint32_t length;
+    };
+
+    // Must match SniffCandidate in QuickLook.Plugin.TextViewer/Detectors/NativeFormatSniffer.cs
+    struct Candidate
+    {
+        uint32_t format;
+        int32_t score;
+    };
+
+    // Fails if there are too many signatures or formats, or a string is empty, too long or not in the text.
+    bool Compile(const Signature* signatures, uint32_t count, const uint16_t* text, uint32_t textLength);
+
+    // Scores the length code units of text and stores the formats with a positive score in
+    // candidates, best first and in format order where they tie. Returns how many there are, which
+    // may be more than capacity. Can be called from several threads at once.
+    uint32_t Run(const uint16_t* text, uint32_t length, Candidate* candidates, uint32_t capacity) const;
+
+private:
+    struct Entry
+    {
+        uint32_t format;
+        int32_t weight;
+        uint32_t flags;
+        bool verify; // compared again with the text on a match
+        std::vector<uint16_t> text;
+    };
+
+    bool matches(const Entry& entry, const uint16_t* text, uint32_t begin) const;
+
+    std::vector<Entry> _entries;
+    uint32_t _formats = 0;
+    std::vector<uint32_t> _next;                  // state by state and symbol
+    std::vector<std::vector<uint32_t>> _outputs; // the entries that end in each state
+};
@@ -60,6 +60,10 @@ bool WoW64HookHelper::Launch()
 
     AssignProcessToJobObject(hJob, hHelper);
 
+    // the helper creates its message window before entering its message loop; wait for that so the
+    // request which triggered the launch does not miss the window
+    WaitForInputIdle(hHelper, 2000);
+
     return CheckStatus();
 }
 
@@ -0,0 +1,287 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "XpressHuffman.h"
+
+#include <cstring>
+#include <memory>
+
+namespace
+{
+    constexpr size_t BLOCK_SIZE = 64 * 1024;
+    constexpr unsigned SYMBOL_COUNT = 512;
+    constexpr unsigned TABLE_BYTES = SYMBOL_COUNT / 2;
+    constexpr unsigned MAX_CODE_LENGTH = 15;
+    constexpr unsigned TABLE_BITS = 12; // 8 KiB, stays in L1; longer codes are rare
+    constexpr unsigned MIN_MATCH = 3;
+
+    constexpr uint8_t MAM_SIGNATURE[] = {'M', 'A', 'M'};
+    constexpr uint8_t MAM_XPRESS_HUFFMAN = 4;
+    constexpr uint8_t MAM_HAS_CHECKSUM = 0x80;
+
+    constexpr uint16_t LONG_CODE = 1 << 4; // length 0, symbol 1: decode through the canonical limits
+
+    struct DecodeTable
+    {
+        // symbol << 4 | length for codes up to TABLE_BITS long; 0 marks a hole
+        uint16_t entries[1 << TABLE_BITS];
+
+        // codes longer than TABLE_BITS are decoded canonically: firstCode is the first code of each
+        // length and firstIndex its position in the symbols sorted by (length, symbol)
+        uint32_t firstCode[MAX_CODE_LENGTH + 1];
+        uint32_t count[MAX_CODE_LENGTH + 1];
+        uint32_t firstIndex[MAX_CODE_LENGTH + 1];
+        uint16_t sorted[SYMBOL_COUNT];
+    };
+
+    // Fills the decode table from the 4-bit code lengths at the start of a block. Codes are assigned
+    // canonically by (length, symbol).
+    bool BuildTable(const uint8_t* lengths, DecodeTable* table)
+    {
+        unsigned counts[MAX_CODE_LENGTH + 1] = {};
+        for (unsigned i = 0; i < TABLE_BYTES; i++)
+        {
+            counts[lengths[i] & 0xf]++;
+            counts[lengths[i] >> 4]++;
+        }
+
+        uint32_t next[MAX_CODE_LENGTH + 1] = {};
+        uint32_t index[MAX_CODE_LENGTH + 1] = {};
+        uint32_t code = 0;
+        uint32_t position = 0;
+        for (unsigned length = 1; length <= MAX_CODE_LENGTH; length++)
+        {
+            next[length] = table->firstCode[length] = code;
+            index[length] = table->firstIndex[length] = position;
+            table->count[length] = counts[length];
+            code = (code + counts[length]) << 1;
+            position += counts[length];
+        }
+
+        // an over-subscribed code would make entries collide
+        if (code > (1u << (MAX_CODE_LENGTH + 1)))
+            return false;
+
+        memset(table->entries, 0, sizeof table->entries);
+        for (unsigned symbol = 0; symbol < SYMBOL_COUNT; symbol++)
+        {
+            unsigned length = (lengths[symbol / 2] >> (symbol % 2 * 4)) & 0xf;
+            if (length == 0)
+                continue;
+
+            table->sorted[index[length]++] = static_cast<uint16_t>(symbol);
+
+            if (length > TABLE_BITS)
+            {
+                table->entries[next[length]++ >> (length - TABLE_BITS)] = LONG_CODE;
+                continue;
+            }
+
+            auto shift = TABLE_BITS - length;
+            auto first = next[length]++ << shift;
+            auto entry = static_cast<uint16_t>(symbol << 4 | length);
+            for (auto i = first; i < first + (1u << shift); i++)
+                table->entries[i] = entry;
+        }
+
+        return true;
+    }
+
+    // Returns symbol << 4 | length for a code longer than TABLE_BITS, or 0 if there is none.
+    uint16_t DecodeLong(const DecodeTable& table, uint32_t bits)
+    {
+        for (auto length = TABLE_BITS + 1; length <= MAX_CODE_LENGTH; length++)
+        {
+            auto offset = (bits >> (32 - length)) - table.firstCode[length];
+            if (offset < table.count[length])
+                return static_cast<uint16_t>(table.sorted[table.firstIndex[length] + offset] << 4 | length);
+        }
+
+        return 0;
+    }
+
+    void CopyMatch(uint8_t* out, size_t offset, size_t length, const uint8_t* outEnd)
+    {
+        auto src = out - offset;
+
+        if (offset >= 8 && outEnd - out >= static_cast<ptrdiff_t>(length + 8))
+        {
+            // whole words, possibly writing up to 7 bytes past the match; they get overwritten later
+            for (size_t i = 0; i < length; i += 8)
+                memcpy(out + i, src + i, 8);
+        }
+        else if (offset == 1)
+        {
+            memset(out, *src, length);
+        }
+        else
+        {
+            for (size_t i = 0; i < length; i++)
+                out[i] = src[i];
+        }
+    }
+}
+
+bool XpressHuffman::Decompress(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize)
+{
+    auto in = input;
+    auto inEnd = input + inputSize;
+    auto out = output;
+    auto outEnd = output + outputSize;
+
+    // reads past the end yield zero bits, since the bit buffer is refilled ahead of use; padding
+    // counts them so that a block which actually consumed any, as a truncated one does, fails
+    unsigned padding = 0;
+    auto read16 = [&]() -> uint32_t
+    {
+        if (inEnd - in < 2)
+        {
+            in = inEnd;
+            padding += 16;
+            return 0;
+        }
+
+        auto value = static_cast<uint32_t>(in[0] | in[1] << 8);
+        in += 2;
+        return value;
+    };
+
+    auto table = std::make_unique<DecodeTable>();
+
+    while (out < outEnd)
+    {
+        if (inEnd - in < static_cast<ptrdiff_t>(TABLE_BYTES) || !BuildTable(in, table.get()))
+            return false;
+
+        in += TABLE_BYTES;
+
+        // bits is consumed from the top; extra counts the bits beyond the 16 that are always there
+        padding = 0;
+        uint32_t bits = read16() << 16;
+        bits |= read16();
+        int extra = 16;
+
+        auto blockEnd = outEnd - out > static_cast<ptrdiff_t>(BLOCK_SIZE) ? out + BLOCK_SIZE : outEnd;
+        while (out < blockEnd)
+        {
+            auto entry = table->entries[bits >> (32 - TABLE_BITS)];
+            if (entry == LONG_CODE)
+                entry = DecodeLong(*table, bits);
+
+            auto length = entry & 0xfu;
+            if (length == 0)
+                return false;
+
+            bits <<= length;
+            extra -= length;
+            if (extra < 0)
+            {
+                bits |= read16() << -extra;
+                extra += 16;
+            }
+
+            auto symbol = entry >> 4;
+            if (symbol < 256)
+            {
+                *out++ = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            size_t matchLength = symbol & 0xf;
+            auto offsetBits = (symbol >> 4) & 0xf;
+
+            // long lengths continue in the byte stream, between the bit stream words
+            if (matchLength == 15)
+            {
+                if (in >= inEnd)
+                    return false;
+
+                matchLength = *in++;
+                if (matchLength == 255)
+                {
+                    if (inEnd - in < 2)
+                        return false;
+
+                    matchLength = in[0] | in[1] << 8;
+                    in += 2;
+                    if (matchLength == 0)
+                    {
+                        if (inEnd - in < 4)
+                            return false;
+
+                        matchLength = static_cast<uint32_t>(in[0] | in[1] << 8 | in[2] << 16) |
+                                      static_cast<uint32_t>(in[3]) << 24;
+                        in += 4;
+                    }
+                    if (matchLength < 15)
+                        return false;
+
+                    matchLength -= 15;
+                }
+                matchLength += 15;
+            }
+            matchLength += MIN_MATCH;
+
+            size_t offset = offsetBits != 0 ? bits >> (32 - offsetBits) : 0;
+            offset |= size_t(1) << offsetBits;
+            bits <<= offsetBits;
+            extra -= offsetBits;
+            if (extra < 0)
+            {
+                bits |= read16() << -extra;
+                extra += 16;
+            }
+
+            if (offset > static_cast<size_t>(out - output))
+                return false;
+
+            if (matchLength > static_cast<size_t>(outEnd - out))
+                matchLength = outEnd - out;
+
+            CopyMatch(out, offset, matchLength, outEnd);
+            out += matchLength;
+        }
+
+        // the padding sits at the bottom of the 16 + extra bits not yet consumed
+        if (padding > static_cast<unsigned>(16 + extra))
+            return false;
+    }
+
+    return true;
+}
+
+size_t XpressHuffman::DecompressMam(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize)
+{
+    if (input == nullptr || inputSize < 8 || memcmp(input, MAM_SIGNATURE, sizeof MAM_SIGNATURE) != 0 ||
+        (input[3] & 0xf) != MAM_XPRESS_HUFFMAN)
+        return 0;
+
+    size_t size = input[4] | input[5] << 8 | input[6] << 16 | static_cast<uint32_t>(input[7]) << 24;
+
+    // the checksum covers the compressed data and is not verified here
+    size_t header = input[3] & MAM_HAS_CHECKSUM ? 12 : 8;
+    if (inputSize < header)
+        return 0;
+
+    if (output == nullptr)
+        return size;
+
+    if (outputSize < size || !Decompress(input + header, inputSize - header, output, size))
+        return 0;
+
+    return size;
+}
@@ -0,0 +1,42 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decoder for the "LZ77 + Huffman" variant of Xpress (MS-XCA 2.2), which Windows 10 and later use to
+// compress prefetch files ("MAM\x04" container). Output is produced in 64 KiB blocks, each preceded
+// by the code lengths of its 512 symbols. Codes of up to 12 bits, which is nearly all of them, are
+// looked up with one load from an 8 KiB table that stays in L1; longer ones fall back to the
+// canonical code limits. Match copies move 8 bytes at a time when the source does not overlap the
+// word being written.
+//
+// Plain C++ so it can be built and verified on any platform.
+class XpressHuffman
+{
+public:
+    // Decompresses exactly outputSize bytes. Returns false on malformed input, in which case
+    // output holds whatever was decoded before the error.
+    static bool Decompress(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize);
+
+    // Unwraps a "MAM" container as found in compressed prefetch files. Returns the size of the
+    // decompressed data, or 0 if the input is not an Xpress Huffman MAM container or is corrupt.
+    // With output == nullptr only the size is returned.
+    static size_t DecompressMam(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize);
+};
@@ -1,15 +1,61 @@
-﻿using System;
+﻿using QuickLook.Common.Helpers;
+using System;
 using System.Collections.Generic;
 using System.Drawing;
+using System.Drawing.Imaging;
 using System.IO;
 using System.Linq;
 using System.Reflection;
+using System.Windows;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
+using PixelFormat = System.Drawing.Imaging.PixelFormat;
 
 namespace QuickLook.Plugin.AppViewer.PackageParsers.Dmg;
 
 public static class IcnsParser
 {
+    /// <summary>
+    /// Edge of the logo in the info panel, in device-independent pixels.
+    /// </summary>
+    private const double LogoSize = 120d;
+
     public static Bitmap Parse(byte[] icnsBytes)
+    {
+        return ParseNative(icnsBytes) ?? ParseManaged(icnsBytes);
+    }
+
+    /// <summary>
+    /// Decodes only the entry that fits the logo on the current display, through the icon engine that
+    /// ImageViewer uses as well.
+    /// </summary>
+    private static Bitmap ParseNative(byte[] icnsBytes)
+    {
+        using var icns = NativeIconContainer.Open(icnsBytes);
+        if (icns == null)
+            return null;
+
+        var scale = DisplayDeviceHelper.GetCurrentScaleFactor();
+        var index = icns.Select(0, (int)Math.Ceiling(LogoSize * Math.Max(scale.Horizontal, scale.Vertical)));
+        if (index < 0)
+            return null;
+
+        // JPEG 2000 entries come back null and are left to the managed parser
+        var image = icns.Render(index, DisplayDeviceHelper.DefaultDpi, DisplayDeviceHelper.DefaultDpi);
+        if (image == null)
+            return null;
+
+        // Bitmap.ToBitmapSource does not know premultiplied pixels, so hand them over straight
+        var straight = new FormatConvertedBitmap(image, PixelFormats.Bgra32, null, 0);
+        var bitmap = new Bitmap(straight.PixelWidth, straight.PixelHeight, PixelFormat.Format32bppArgb);
+        var data = bitmap.LockBits(new Rectangle(0, 0, bitmap.Width, bitmap.Height), ImageLockMode.WriteOnly,
+            bitmap.PixelFormat);
+        straight.CopyPixels(Int32Rect.Empty, data.Scan0, data.Stride * data.Height, data.Stride);
+        bitmap.UnlockBits(data);
+        return bitmap;
+    }
+
+    private static Bitmap ParseManaged(byte[] icnsBytes)
     {
         // Temporary method
 
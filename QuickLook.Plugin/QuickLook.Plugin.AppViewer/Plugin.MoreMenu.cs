@@ -45,6 +45,8 @@ public sealed partial class Plugin
             || _path.EndsWith(".appxbundle", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".msix", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".msixbundle", StringComparison.OrdinalIgnoreCase)
+            || _path.EndsWith(".msi", StringComparison.OrdinalIgnoreCase)
+            || _path.EndsWith(".msp", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".nupkg", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".snupkg", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".wgt", StringComparison.OrdinalIgnoreCase)
@@ -52,7 +54,7 @@ public sealed partial class Plugin
             || _path.EndsWith(".aar", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".har", StringComparison.OrdinalIgnoreCase))
         {
-            // If the file is ZIP-based (PK..), allow reopening with ArchiveViewer
+            // If the file is ZIP-based (PK..) or an MSI compound file, allow reopening with ArchiveViewer
             yield return new MoreMenuItem()
             {
                 Icon = FontSymbols.Tablet,
@@ -17,6 +17,7 @@
 
 using PureSharpCompress.Common;
 using PureSharpCompress.Readers;
+using QuickLook.Plugin.TextViewer.Detectors;
 using System;
 using System.Text;
 using UtfUnknown;
@@ -39,7 +40,9 @@ internal class ChardetReaderOptions : ReaderOptions
 
         Array.Copy(bytes, index, buffer, 0, count);
 
-        var encoding = CharsetDetector.DetectFromBytes(buffer).Detected?.Encoding ?? Encoding.Default;
+        var encoding = NativeTextEncoding.Detect(buffer, false) ??
+                       CharsetDetector.DetectFromBytes(buffer).Detected?.Encoding ??
+                       Encoding.Default;
 
         return encoding.GetString(buffer);
     }
@@ -0,0 +1,235 @@
+// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.IO.Compression;
+using System.Runtime.InteropServices;
+
+namespace QuickLook.Plugin.ArchiveViewer.ChromiumResourcePackage;
+
+/// <summary>
+/// Chromium .pak file (version 4 or 5) that is read in place by the memory-mapped parser of QuickLook.Native.
+/// Opening a pack only checks its resource and alias tables; a resource is read, and decompressed, only when it is opened.
+/// </summary>
+internal sealed class NativePak : IDisposable
+{
+    private const int PageSize = 256;
+    private const int SniffLength = 64;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+
+    private NativePak(nint handle)
+    {
+        _handle = handle;
+    }
+
+    /// <summary>
+    /// Maps the specified file and checks its resource and alias tables.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativePak" />, or <see langword="null" /> if the file is not a .pak file or the native parser is not available.
+    /// </returns>
+    public static NativePak Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? PakOpen_arm64(path) : Is64Bit ? PakOpen_64(path) : PakOpen_32(path);
+            if (handle != 0)
+                return new NativePak(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Enumerates the resources in table order without reading their data.
+    /// The returned resources can only be opened while this pack is not disposed.
+    /// </summary>
+    public IEnumerable<PakResource> GetResources()
+    {
+        var page = new NativeResource[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? PakReadResources_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? PakReadResources_64(ThrowIfDisposed(), start, page, PageSize)
+                : PakReadResources_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+            for (var i = 0; i < count; i++)
+                yield return new PakResource((ushort)page[i].Id, (PakCompression)page[i].Compression, page[i].Size, page[i].Data, page[i].Length);
+        }
+    }
+
+    /// <summary>
+    /// Opens a resource for reading. Gzip resources are decompressed while they are read; brotli resources
+    /// are returned as the bare brotli stream, without Chromium's framing.
+    /// </summary>
+    public unsafe Stream OpenResource(PakResource resource)
+    {
+        ThrowIfDisposed();
+
+        var stream = new UnmanagedMemoryStream((byte*)resource.Data, resource.Length);
+        return resource.Compression == PakCompression.Gzip ? new GZipStream(stream, CompressionMode.Decompress) : stream;
+    }
+
+    /// <summary>
+    /// Reads the whole resource, decompressed as by <see cref="OpenResource" />.
+    /// </summary>
+    public byte[] ReadResource(PakResource resource)
+    {
+        using var stream = OpenResource(resource);
+        // the size in the gzip trailer is not trusted for the allocation
+        using var buffer = new MemoryStream(resource.Compression == PakCompression.Gzip ? 0 : (int)resource.Length);
+        stream.CopyTo(buffer);
+        return buffer.ToArray();
+    }
+
+    /// <summary>
+    /// Guesses the file extension of a resource from its first bytes, looking through gzip compression.
+    /// Brotli resources are reported as ".br" since they are not decompressed.
+    /// </summary>
+    public string GuessFileExtension(PakResource resource)
+    {
+        if (resource.Compression == PakCompression.Brotli)
+            return ".br";
+
+        var head = new byte[SniffLength];
+        var length = 0;
+        try
+        {
+            using var stream = OpenResource(resource);
+            int read;
+            while (length < head.Length && (read = stream.Read(head, length, head.Length - length)) > 0)
+                length += read;
+        }
+        catch (InvalidDataException)
+        {
+            return ".gz";
+        }
+
+        return PakExtractor.GuessFileExtension(head, length);
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        if (IsArm64)
+            PakClose_arm64(_handle);
+        else if (Is64Bit)
+            PakClose_64(_handle);
+        else
+            PakClose_32(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativePak));
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PakOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint PakOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PakClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void PakClose_32(nint pak);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PakReadResources", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PakReadResources_32(nint pak, uint start, [Out] NativeResource[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PakOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint PakOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PakClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void PakClose_64(nint pak);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PakReadResources", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PakReadResources_64(nint pak, uint start, [Out] NativeResource[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PakOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint PakOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PakClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void PakClose_arm64(nint pak);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PakReadResources", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PakReadResources_arm64(nint pak, uint start, [Out] NativeResource[] entries, uint count);
+
+    // Must match PakFile::Resource in QuickLook.Native/QuickLook.Native32/PakFile.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeResource
+    {
+        public uint Id;
+        public uint Compression;
+        public nint Data;
+        public uint Length;
+        public ulong Size;
+    }
+}
+
+internal enum PakCompression : uint
+{
+    None = 0,
+    Gzip = 1,
+    Brotli = 2,
+}
+
+/// <summary>
+/// Represents one resource of a .pak file; the data stays in the mapping of the <see cref="NativePak" /> it came from.
+/// </summary>
+internal sealed class PakResource(ushort id, PakCompression compression, ulong size, nint data, uint length)
+{
+    public ushort Id { get; } = id;
+
+    public PakCompression Compression { get; } = compression;
+
+    /// <summary>
+    /// Gets the decompressed size as claimed by the resource, or the stored size if it is not compressed.
+    /// </summary>
+    public ulong Size { get; } = size;
+
+    internal nint Data { get; } = data;
+
+    internal uint Length { get; } = length;
+}
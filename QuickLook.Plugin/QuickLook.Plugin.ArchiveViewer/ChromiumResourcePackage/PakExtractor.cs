@@ -24,6 +24,8 @@ namespace QuickLook.Plugin.ArchiveViewer.ChromiumResourcePackage;
 
 /// <summary>
 /// Provides static methods for extracting resources from Chrome .pak archive files.
+/// Packs are read through <see cref="NativePak"/> when available, which also decompresses gzip resources;
+/// otherwise they are parsed here as version 5 and the resources are copied as stored.
 /// </summary>
 public static class PakExtractor
 {
@@ -36,6 +38,25 @@ public static class PakExtractor
     /// <param name="appendExtension">If true, append guessed file extension to the filename (e.g., "000000001.png").</param>
     public static void ExtractToDirectory(string fileName, string outputDirectory, bool appendExtension = true)
     {
+        using (var pak = NativePak.Open(fileName))
+        {
+            if (pak != null)
+            {
+                Directory.CreateDirectory(outputDirectory);
+                foreach (var resource in pak.GetResources())
+                {
+                    string resourceName = resource.Id.ToString("D9");
+                    if (appendExtension)
+                        resourceName += pak.GuessFileExtension(resource);
+
+                    using var input = pak.OpenResource(resource);
+                    using var file = File.Create(Path.Combine(outputDirectory, resourceName));
+                    input.CopyTo(file);
+                }
+                return;
+            }
+        }
+
         using var stream = File.OpenRead(fileName);
         using var br = new BinaryReader(stream);
         var version = br.ReadUInt32();
@@ -104,6 +125,22 @@ public static class PakExtractor
     /// <returns>A dictionary mapping resource names to their byte content.</returns>
     public static Dictionary<string, byte[]> ExtractToDictionary(string fileName, bool appendExtension = true)
     {
+        using (var pak = NativePak.Open(fileName))
+        {
+            if (pak != null)
+            {
+                var resources = new Dictionary<string, byte[]>();
+                foreach (var resource in pak.GetResources())
+                {
+                    string resourceName = resource.Id.ToString("D9");
+                    if (appendExtension)
+                        resourceName += pak.GuessFileExtension(resource);
+                    resources[resourceName] = pak.ReadResource(resource);
+                }
+                return resources;
+            }
+        }
+
         using var stream = File.OpenRead(fileName);
         using var br = new BinaryReader(stream);
         var version = br.ReadUInt32();
@@ -117,41 +117,62 @@ public partial class PakInfoPanel : UserControl, IDisposable, INotifyPropertyCha
 
     private void LoadItemsFromPak(string path)
     {
-        var dict = PakExtractor.ExtractToDictionary(path, appendExtension: true);
         var modifiedDate = File.GetLastWriteTime(path);
 
-        foreach (var kv in dict)
+        // The native reader lists from the resource table and only peeks at each resource to guess its type
+        using (var pak = NativePak.Open(path))
         {
-            var fragments = kv.Key.Split(['/', '\\'], StringSplitOptions.RemoveEmptyEntries);
-            string currentPath = string.Empty;
-            ArchiveFileEntry parent = _fileEntries[string.Empty];
-
-            for (int i = 0; i < fragments.Length - 1; i++)
+            if (pak != null)
             {
-                var dirName = fragments[i];
-                currentPath = string.IsNullOrEmpty(currentPath) ? dirName : currentPath + "\\" + dirName;
-                if (!_fileEntries.TryGetValue(currentPath, out var dirEntry))
+                foreach (var resource in pak.GetResources())
                 {
-                    dirEntry = new ArchiveFileEntry(dirName, true, parent)
-                    {
-                        ModifiedDate = modifiedDate,
-                    };
-                    _fileEntries.Add(currentPath, dirEntry);
+                    if (_disposed) return;
+
+                    AddEntry(resource.Id.ToString("D9") + pak.GuessFileExtension(resource), resource.Size, modifiedDate);
                 }
-                parent = dirEntry;
+                return;
             }
+        }
+
+        var dict = PakExtractor.ExtractToDictionary(path, appendExtension: true);
+
+        foreach (var kv in dict)
+        {
+            AddEntry(kv.Key, (ulong)kv.Value.Length, modifiedDate);
+        }
+    }
+
+    private void AddEntry(string name, ulong size, DateTime modifiedDate)
+    {
+        var fragments = name.Split(['/', '\\'], StringSplitOptions.RemoveEmptyEntries);
+        string currentPath = string.Empty;
+        ArchiveFileEntry parent = _fileEntries[string.Empty];
 
-            var fileName = fragments.Last();
-            var filePath = fragments.Length > 1 ? currentPath + "\\" + fileName : fileName;
-            if (!_fileEntries.ContainsKey(filePath))
+        for (int i = 0; i < fragments.Length - 1; i++)
+        {
+            var dirName = fragments[i];
+            currentPath = string.IsNullOrEmpty(currentPath) ? dirName : currentPath + "\\" + dirName;
+            if (!_fileEntries.TryGetValue(currentPath, out var dirEntry))
             {
-                var entry = new ArchiveFileEntry(fileName, false, parent)
+                dirEntry = new ArchiveFileEntry(dirName, true, parent)
                 {
-                    Size = (ulong)kv.Value.Length,
                     ModifiedDate = modifiedDate,
                 };
-                _fileEntries.Add(filePath, entry);
+                _fileEntries.Add(currentPath, dirEntry);
             }
+            parent = dirEntry;
+        }
+
+        var fileName = fragments.Last();
+        var filePath = fragments.Length > 1 ? currentPath + "\\" + fileName : fileName;
+        if (!_fileEntries.ContainsKey(filePath))
+        {
+            var entry = new ArchiveFileEntry(fileName, false, parent)
+            {
+                Size = size,
+                ModifiedDate = modifiedDate,
+            };
+            _fileEntries.Add(filePath, entry);
         }
     }
 
@@ -26,6 +26,7 @@ namespace QuickLook.Plugin.ArchiveViewer.CompoundFileBinary;
 /// <summary>
 /// Utility class to extract streams and storages from a COM compound file (IStorage) into the file system.
 /// This is a thin managed wrapper that enumerates entries inside the compound file and writes streams to disk.
+/// The file is read through <see cref="NativeCompoundFile"/> when available, with IStorage as the fallback.
 /// </summary>
 public static partial class CompoundFileExtractor
 {
@@ -59,6 +60,16 @@ public static partial class CompoundFileExtractor
             }
         }
 
+        // Prefer the native reader, which streams straight out of the mapped file.
+        using (NativeCompoundFile file = NativeCompoundFile.Open(compoundFilePath))
+        {
+            if (file != null)
+            {
+                ExtractNativeStorageToDirectory(file, NativeCompoundFile.Root, destinationDirectory);
+                return;
+            }
+        }
+
         // Open the compound file as an IStorage implementation wrapped by DisposableIStorage.
         using DisposableIStorage storage = new(compoundFilePath, STGM.DIRECT | STGM.READ | STGM.SHARE_EXCLUSIVE, IntPtr.Zero);
         IEnumerator<STATSTG> enumerator = storage.EnumElements();
@@ -81,6 +92,32 @@ public static partial class CompoundFileExtractor
         }
     }
 
+    /// <summary>
+    /// Extracts the children of a storage read by <see cref="NativeCompoundFile"/> recursively into <paramref name="directory"/>.
+    /// </summary>
+    /// <param name="file">The compound file.</param>
+    /// <param name="storage">Entry id of the storage to extract.</param>
+    /// <param name="directory">Directory to write the extracted files and directories to.</param>
+    private static void ExtractNativeStorageToDirectory(NativeCompoundFile file, uint storage, string directory)
+    {
+        foreach (CompoundFileEntry entry in file.GetChildren(storage))
+        {
+            string outputPath = Path.Combine(directory, entry.Name);
+
+            if (entry.IsStorage)
+            {
+                Directory.CreateDirectory(outputPath);
+                ExtractNativeStorageToDirectory(file, entry.Id, outputPath);
+            }
+            else
+            {
+                // This will overwrite existing files.
+                using FileStream output = new(outputPath, FileMode.Create, FileAccess.Write);
+                file.CopyStream(entry, output);
+            }
+        }
+    }
+
     /// <summary>
     /// Extracts a single stream from the provided <paramref name="storage"/> and writes it to <paramref name="destinationDirectory"/>.
     /// </summary>
@@ -146,6 +183,7 @@ public static partial class CompoundFileExtractor
 /// <summary>
 /// Utility class to extract streams and storages from a COM compound file (IStorage) into the memory.
 /// This is a thin managed wrapper that enumerates entries inside the compound file and writes streams to dictionary.
+/// The file is read through <see cref="NativeCompoundFile"/> when available, with IStorage as the fallback.
 /// </summary>
 public static partial class CompoundFileExtractor
 {
@@ -175,6 +213,16 @@ public static partial class CompoundFileExtractor
             }
         }
 
+        // Prefer the native reader, which copies the streams straight out of the mapped file.
+        using (NativeCompoundFile file = NativeCompoundFile.Open(compoundFilePath))
+        {
+            if (file != null)
+            {
+                ExtractNativeStorageToDictionary(file, NativeCompoundFile.Root, string.Empty, result);
+                return result;
+            }
+        }
+
         // Open the compound file as an IStorage implementation wrapped by DisposableIStorage.
         using DisposableIStorage storage = new(compoundFilePath, STGM.DIRECT | STGM.READ | STGM.SHARE_EXCLUSIVE, IntPtr.Zero);
         ExtractStorageToDictionary(storage, string.Empty, result);
@@ -182,6 +230,19 @@ public static partial class CompoundFileExtractor
         return result;
     }
 
+    private static void ExtractNativeStorageToDictionary(NativeCompoundFile file, uint storage, string currentPath, Dictionary<string, byte[]> result)
+    {
+        foreach (CompoundFileEntry entry in file.GetChildren(storage))
+        {
+            string entryPath = string.IsNullOrEmpty(currentPath) ? entry.Name : Path.Combine(currentPath, entry.Name);
+
+            if (entry.IsStorage)
+                ExtractNativeStorageToDictionary(file, entry.Id, entryPath, result);
+            else
+                result[entryPath] = file.ReadStream(entry);
+        }
+    }
+
     private static void ExtractStorageToDictionary(DisposableIStorage storage, string currentPath, Dictionary<string, byte[]> result)
     {
         IEnumerator<STATSTG> enumerator = storage.EnumElements();
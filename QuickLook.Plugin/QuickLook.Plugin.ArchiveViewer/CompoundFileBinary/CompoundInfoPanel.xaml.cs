@@ -30,7 +30,11 @@ namespace QuickLook.Plugin.ArchiveViewer.CompoundFileBinary;
 
 public partial class CompoundInfoPanel : UserControl, IDisposable, INotifyPropertyChanged
 {
+    // DateTime.MaxValue as a FILETIME
+    private const long MaxFileTime = 2650467743999999999;
+
     private readonly Dictionary<string, ArchiveFileEntry> _fileEntries = [];
+    private readonly bool _msiNames;
     private bool _disposed;
     private double _loadPercent;
     private ulong _totalSize;
@@ -42,6 +46,9 @@ public partial class CompoundInfoPanel : UserControl, IDisposable, INotifyProper
         // design-time only
         Resources.MergedDictionaries.Clear();
 
+        _msiNames = path.EndsWith(".msi", StringComparison.OrdinalIgnoreCase)
+            || path.EndsWith(".msp", StringComparison.OrdinalIgnoreCase);
+
         BeginLoadArchive(path);
     }
 
@@ -128,10 +135,53 @@ public partial class CompoundInfoPanel : UserControl, IDisposable, INotifyProper
 
     private void LoadItemsFromArchive(string path)
     {
+        using (var file = NativeCompoundFile.Open(path))
+        {
+            if (file != null)
+            {
+                ProcessNativeStorage(file, NativeCompoundFile.Root, string.Empty);
+                return;
+            }
+        }
+
         using var storage = new DisposableIStorage(path, STGM.READ | STGM.SHARE_DENY_WRITE, IntPtr.Zero);
         ProcessStorage(storage, string.Empty);
     }
 
+    private void ProcessNativeStorage(NativeCompoundFile file, uint storage, string currentPath)
+    {
+        _fileEntries.TryGetValue(currentPath, out var parent);
+
+        foreach (var child in file.GetChildren(storage))
+        {
+            if (_disposed) return;
+
+            var name = DisplayName(child.Name);
+            var fullPath = string.IsNullOrEmpty(currentPath) ? name : currentPath + "\\" + name;
+
+            // a corrupt directory may list a name twice; keep the first
+            if (_fileEntries.ContainsKey(fullPath))
+                continue;
+
+            if (child.IsStorage)
+            {
+                _fileEntries.Add(fullPath, new ArchiveFileEntry(name, true, parent));
+                ProcessNativeStorage(file, child.Id, fullPath);
+            }
+            else
+            {
+                _fileEntries.Add(fullPath, new ArchiveFileEntry(name, false, parent)
+                {
+                    Size = child.Size,
+                    // the times are read raw from the directory and may be garbage
+                    ModifiedDate = child.ModifiedTime is >= 0 and <= MaxFileTime
+                        ? DateTime.FromFileTimeUtc(child.ModifiedTime).ToLocalTime()
+                        : default
+                });
+            }
+        }
+    }
+
     private void ProcessStorage(DisposableIStorage storage, string currentPath)
     {
         var enumerator = storage.EnumElements();
@@ -140,7 +190,7 @@ public partial class CompoundInfoPanel : UserControl, IDisposable, INotifyProper
             if (_disposed) return;
 
             var stat = enumerator.Current;
-            var name = stat.pwcsName;
+            var name = DisplayName(stat.pwcsName);
             var fullPath = string.IsNullOrEmpty(currentPath) ? name : currentPath + "\\" + name;
 
             _fileEntries.TryGetValue(currentPath, out var parent);
@@ -150,7 +200,7 @@ public partial class CompoundInfoPanel : UserControl, IDisposable, INotifyProper
                 var entry = new ArchiveFileEntry(name, true, parent);
                 _fileEntries.Add(fullPath, entry);
 
-                using var subStorage = storage.OpenStorage(name, null, STGM.READ | STGM.SHARE_EXCLUSIVE, IntPtr.Zero);
+                using var subStorage = storage.OpenStorage(stat.pwcsName, null, STGM.READ | STGM.SHARE_EXCLUSIVE, IntPtr.Zero);
                 ProcessStorage(subStorage, fullPath);
             }
             else if (stat.type == (int)STGTY.STGTY_STREAM)
@@ -166,6 +216,11 @@ public partial class CompoundInfoPanel : UserControl, IDisposable, INotifyProper
         }
     }
 
+    private string DisplayName(string name)
+    {
+        return _msiNames ? MsiStreamName.Decode(name) : name;
+    }
+
     protected virtual void OnPropertyChanged([CallerMemberName] string propertyName = null)
     {
         PropertyChanged?.Invoke(this, new PropertyChangedEventArgs(propertyName));
@@ -0,0 +1,65 @@
+// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System.Text;
+
+namespace QuickLook.Plugin.ArchiveViewer.CompoundFileBinary;
+
+/// <summary>
+/// Decodes the stream names of Windows Installer databases (.msi, .msp). Windows Installer packs two
+/// characters of a table or stream name from [0-9A-Za-z._] into one code unit from U+3800 to U+47FF,
+/// an odd last one into U+4800 to U+483F, and starts table names with U+4840, which is shown as "!".
+/// </summary>
+internal static class MsiStreamName
+{
+    private const char PairFirst = '\u3800';
+    private const char SingleFirst = '\u4800';
+    private const char TableMarker = '\u4840';
+
+    public static string Decode(string name)
+    {
+        var builder = new StringBuilder(name.Length * 2);
+
+        foreach (var c in name)
+        {
+            if (c >= PairFirst && c < SingleFirst)
+            {
+                builder.Append(FromSixBits((c - PairFirst) & 0x3f));
+                builder.Append(FromSixBits((c - PairFirst) >> 6));
+            }
+            else if (c >= SingleFirst && c < TableMarker)
+            {
+                builder.Append(FromSixBits(c - SingleFirst));
+            }
+            else
+            {
+                builder.Append(c == TableMarker ? '!' : c);
+            }
+        }
+
+        return builder.ToString();
+    }
+
+    private static char FromSixBits(int value) => value switch
+    {
+        < 10 => (char)('0' + value),
+        < 36 => (char)('A' + value - 10),
+        < 62 => (char)('a' + value - 36),
+        62 => '.',
+        _ => '_',
+    };
+}
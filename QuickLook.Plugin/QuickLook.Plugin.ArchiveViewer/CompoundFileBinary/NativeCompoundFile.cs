@@ -0,0 +1,289 @@
+// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+
+namespace QuickLook.Plugin.ArchiveViewer.CompoundFileBinary;
+
+/// <summary>
+/// Compound File Binary container that is read in place by the memory-mapped parser of QuickLook.Native.
+/// Unlike <see cref="DisposableIStorage" /> it needs no COM apartment, so it can be used from any thread,
+/// and streams are copied straight out of the mapping instead of going through <c>IStream</c>.
+/// </summary>
+internal sealed class NativeCompoundFile : IDisposable
+{
+    public const uint Root = 0;
+
+    private const int PageSize = 256;
+    private const int SegmentPageSize = 64;
+    private const int CopyBufferSize = 81920;
+
+    private const uint TypeStorage = 1;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+
+    private NativeCompoundFile(nint handle)
+    {
+        _handle = handle;
+    }
+
+    /// <summary>
+    /// Maps the specified file and collects its FAT and directory sectors.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeCompoundFile" />, or <see langword="null" /> if the file is not a compound file or the native parser is not available.
+    /// </returns>
+    public static NativeCompoundFile Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? CfbOpen_arm64(path) : Is64Bit ? CfbOpen_64(path) : CfbOpen_32(path);
+            if (handle != 0)
+                return new NativeCompoundFile(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Enumerates the streams and storages directly inside the specified storage.
+    /// </summary>
+    public IEnumerable<CompoundFileEntry> GetChildren(uint storage = Root)
+    {
+        var ids = new uint[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? CfbReadChildren_arm64(ThrowIfDisposed(), storage, start, ids, PageSize)
+                : Is64Bit ? CfbReadChildren_64(ThrowIfDisposed(), storage, start, ids, PageSize)
+                : CfbReadChildren_32(ThrowIfDisposed(), storage, start, ids, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+            for (var i = 0; i < count; i++)
+            {
+                var ok = IsArm64 ? CfbGetEntry_arm64(_handle, ids[i], out var entry)
+                    : Is64Bit ? CfbGetEntry_64(_handle, ids[i], out entry) : CfbGetEntry_32(_handle, ids[i], out entry);
+                if (!ok)
+                    continue;
+
+                yield return new CompoundFileEntry(
+                    ids[i],
+                    Marshal.PtrToStringUni(entry.Name, (int)entry.NameLength),
+                    entry.Type == TypeStorage,
+                    entry.Size,
+                    (long)entry.ModifiedTime);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Reads the whole content of a stream.
+    /// </summary>
+    /// <exception cref="InvalidDataException">The sector chain of the stream ends before its size.</exception>
+    public byte[] ReadStream(CompoundFileEntry entry)
+    {
+        var buffer = new byte[checked((int)entry.Size)];
+        var position = 0;
+
+        foreach (var (data, length) in GetSegments(entry.Id))
+        {
+            Marshal.Copy(data, buffer, position, length);
+            position += length;
+        }
+
+        return position == buffer.Length ? buffer : throw new InvalidDataException($"Stream \"{entry.Name}\" is truncated.");
+    }
+
+    /// <summary>
+    /// Writes the whole content of a stream to <paramref name="destination" />.
+    /// </summary>
+    /// <exception cref="InvalidDataException">The sector chain of the stream ends before its size.</exception>
+    public void CopyStream(CompoundFileEntry entry, Stream destination)
+    {
+        var buffer = new byte[(int)Math.Min(CopyBufferSize, Math.Max(entry.Size, 1))];
+        var written = 0ul;
+
+        foreach (var (data, length) in GetSegments(entry.Id))
+        {
+            for (var offset = 0; offset < length; offset += buffer.Length)
+            {
+                var chunk = Math.Min(buffer.Length, length - offset);
+                Marshal.Copy(data + offset, buffer, 0, chunk);
+                destination.Write(buffer, 0, chunk);
+            }
+
+            written += (ulong)length;
+        }
+
+        if (written != entry.Size)
+            throw new InvalidDataException($"Stream \"{entry.Name}\" is truncated.");
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        if (IsArm64)
+            CfbClose_arm64(_handle);
+        else if (Is64Bit)
+            CfbClose_64(_handle);
+        else
+            CfbClose_32(_handle);
+        _handle = 0;
+    }
+
+    private IEnumerable<(nint data, int length)> GetSegments(uint id)
+    {
+        var cursor = new SegmentCursor();
+        var page = new Segment[SegmentPageSize];
+
+        while (true)
+        {
+            var count = IsArm64 ? CfbReadSegments_arm64(ThrowIfDisposed(), id, ref cursor, page, SegmentPageSize)
+                : Is64Bit ? CfbReadSegments_64(ThrowIfDisposed(), id, ref cursor, page, SegmentPageSize)
+                : CfbReadSegments_32(ThrowIfDisposed(), id, ref cursor, page, SegmentPageSize);
+            if (count == 0)
+                yield break;
+
+            for (var i = 0; i < count; i++)
+                yield return (page[i].Data, (int)page[i].Length);
+        }
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeCompoundFile));
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CfbOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint CfbOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CfbClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CfbClose_32(nint file);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CfbGetEntry", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CfbGetEntry_32(nint file, uint id, out CfbEntry entry);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CfbReadChildren", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CfbReadChildren_32(nint file, uint storage, uint start, [Out] uint[] ids, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CfbReadSegments", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CfbReadSegments_32(nint file, uint id, ref SegmentCursor cursor, [Out] Segment[] segments, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CfbOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint CfbOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CfbClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CfbClose_64(nint file);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CfbGetEntry", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CfbGetEntry_64(nint file, uint id, out CfbEntry entry);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CfbReadChildren", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CfbReadChildren_64(nint file, uint storage, uint start, [Out] uint[] ids, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CfbReadSegments", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CfbReadSegments_64(nint file, uint id, ref SegmentCursor cursor, [Out] Segment[] segments, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CfbOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint CfbOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CfbClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CfbClose_arm64(nint file);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CfbGetEntry", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CfbGetEntry_arm64(nint file, uint id, out CfbEntry entry);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CfbReadChildren", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CfbReadChildren_arm64(nint file, uint storage, uint start, [Out] uint[] ids, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CfbReadSegments", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CfbReadSegments_arm64(nint file, uint id, ref SegmentCursor cursor, [Out] Segment[] segments, uint count);
+
+    // Must match CompoundFile::Entry in QuickLook.Native/QuickLook.Native32/CompoundFile.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct CfbEntry
+    {
+        public nint Name;
+        public uint NameLength;
+        public uint Type;
+        public ulong Size;
+        public ulong CreationTime;
+        public ulong ModifiedTime;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SegmentCursor
+    {
+        public ulong Position;
+        public uint Sector;
+        public uint State;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct Segment
+    {
+        public nint Data;
+        public uint Length;
+    }
+}
+
+/// <summary>
+/// Represents a stream or storage inside a compound file.
+/// </summary>
+internal sealed class CompoundFileEntry(uint id, string name, bool isStorage, ulong size, long modifiedTime)
+{
+    public uint Id { get; } = id;
+
+    public string Name { get; } = name;
+
+    public bool IsStorage { get; } = isStorage;
+
+    public ulong Size { get; } = size;
+
+    /// <summary>
+    /// Gets the modification time as a FILETIME; writers usually only set it for storages.
+    /// </summary>
+    public long ModifiedTime { get; } = modifiedTime;
+}
@@ -103,6 +103,29 @@ public static class ThumbsDbExtractor
         if (!File.Exists(thumbsDbPath))
             throw new FileNotFoundException("Thumbs.db not found.", thumbsDbPath);
 
+        // The native reader needs no COM apartment; IStorage is only the fallback.
+        using (NativeCompoundFile file = NativeCompoundFile.Open(thumbsDbPath))
+        {
+            if (file != null)
+            {
+                foreach (CompoundFileEntry entry in file.GetChildren())
+                {
+                    if (entry.IsStorage || entry.Name.Equals("Catalog", StringComparison.OrdinalIgnoreCase))
+                        continue;
+
+                    try
+                    {
+                        WriteThumbnail(file.ReadStream(entry), entry.Name, destinationDirectory);
+                    }
+                    catch
+                    {
+                        // Skip unreadable or malformed streams
+                    }
+                }
+                return;
+            }
+        }
+
         using DisposableIStorage storage = new(thumbsDbPath, STGM.READ | STGM.SHARE_DENY_WRITE, IntPtr.Zero);
         IEnumerator<STATSTG> enumerator = storage.EnumElements();
 
@@ -118,12 +141,7 @@ public static class ThumbsDbExtractor
 
             try
             {
-                byte[] raw = ReadStream(storage, stat);
-                (byte[] imageBytes, string ext) = StripHeaderAndDetect(raw);
-                if (imageBytes == null) continue;
-
-                string outPath = Path.Combine(destinationDirectory, stat.pwcsName + ext);
-                File.WriteAllBytes(outPath, imageBytes);
+                WriteThumbnail(ReadStream(storage, stat), stat.pwcsName, destinationDirectory);
             }
             catch
             {
@@ -134,6 +152,18 @@ public static class ThumbsDbExtractor
 
     // -- Internals ----------------------------------------------------------------
 
+    /// <summary>
+    /// Writes the image carried by a thumbnail stream to <paramref name="destinationDirectory"/>, if it has one.
+    /// </summary>
+    private static void WriteThumbnail(byte[] raw, string streamName, string destinationDirectory)
+    {
+        (byte[] imageBytes, string ext) = StripHeaderAndDetect(raw);
+        if (imageBytes == null) return;
+
+        string outPath = Path.Combine(destinationDirectory, streamName + ext);
+        File.WriteAllBytes(outPath, imageBytes);
+    }
+
     /// <summary>
     /// Reads the full content of a stream entry from an open IStorage.
     /// </summary>
@@ -20,6 +20,7 @@ using QuickLook.Plugin.ArchiveViewer.ArchiveFile;
 using System;
 using System.Collections.Generic;
 using System.ComponentModel;
+using System.Linq;
 using System.Runtime.CompilerServices;
 using System.Threading.Tasks;
 using System.Windows.Controls;
@@ -28,6 +29,8 @@ namespace QuickLook.Plugin.ArchiveViewer.DSStore;
 
 public partial class DSStoreInfoPanel : UserControl, IDisposable, INotifyPropertyChanged
 {
+    private const int ProgressInterval = 4096;
+
     private bool _disposed;
     private double _loadPercent;
 
@@ -103,13 +106,22 @@ public partial class DSStoreInfoPanel : UserControl, IDisposable, INotifyPropert
 
     private void LoadItemsFromDSStore(string path, ArchiveFileEntry root)
     {
-        List<string> fileNames = DSStoreExtractor.GetFileNames(path);
+        // the native reader pages the B-tree in while the records are enumerated; the managed
+        // extractor decodes the whole file up front and is only the fallback
+        using var store = NativeDSStore.Open(path);
+        var fileNames = store != null ? store.GetRecords().Select(r => r.Name) : DSStoreExtractor.GetFileNames(path);
+        var total = store?.RecordCount ?? 0;
+        var read = 0;
 
         // Deduplicate while preserving order
         var seen = new HashSet<string>(StringComparer.Ordinal);
         foreach (var name in fileNames)
         {
             if (_disposed) return;
+
+            if (++read % ProgressInterval == 0 && total > 0)
+                LoadPercent = Math.Min(99d, 100d * read / total);
+
             if (string.IsNullOrEmpty(name)) continue;
             if (!seen.Add(name)) continue;
 
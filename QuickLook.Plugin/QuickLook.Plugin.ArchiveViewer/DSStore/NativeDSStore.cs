@@ -0,0 +1,245 @@
+// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace QuickLook.Plugin.ArchiveViewer.DSStore;
+
+/// <summary>
+/// .DS_Store file that is read in place by the memory-mapped parser of QuickLook.Native.
+/// Opening a store only resolves its block table; the B-tree is walked page by page while the records are enumerated.
+/// </summary>
+internal sealed class NativeDSStore : IDisposable
+{
+    private const int PageSize = 256;
+    private const int MaxDepth = 16;
+    private const int FrameSize = 4;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private readonly DSStoreInfo _info;
+
+    /// <summary>
+    /// Gets the number of records the B-tree header claims; only meant for progress reporting.
+    /// </summary>
+    public int RecordCount => (int)Math.Min(_info.Records, int.MaxValue);
+
+    private NativeDSStore(nint handle, DSStoreInfo info)
+    {
+        _handle = handle;
+        _info = info;
+    }
+
+    /// <summary>
+    /// Maps the specified file and resolves its block table.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeDSStore" />, or <see langword="null" /> if the file is not a .DS_Store file or the native parser is not available.
+    /// </returns>
+    public static NativeDSStore Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? DSStoreOpen_arm64(path) : Is64Bit ? DSStoreOpen_64(path) : DSStoreOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? DSStoreGetInfo_arm64(handle, out var info)
+                : Is64Bit ? DSStoreGetInfo_64(handle, out info) : DSStoreGetInfo_32(handle, out info);
+            if (ok)
+                return new NativeDSStore(handle, info);
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Enumerates the records in B-tree order, reading the nodes lazily. A corrupt node ends the enumeration.
+    /// </summary>
+    public IEnumerable<DSStoreRecord> GetRecords()
+    {
+        var cursor = new DSStoreCursor { Frames = new uint[MaxDepth * FrameSize] };
+        var page = new NativeRecord[PageSize];
+        var name = new byte[256];
+
+        while (true)
+        {
+            var count = IsArm64 ? DSStoreReadRecords_arm64(ThrowIfDisposed(), ref cursor, page, PageSize)
+                : Is64Bit ? DSStoreReadRecords_64(ThrowIfDisposed(), ref cursor, page, PageSize)
+                : DSStoreReadRecords_32(ThrowIfDisposed(), ref cursor, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            for (var i = 0; i < count; i++)
+            {
+                // names are UTF-16BE and not necessarily aligned
+                var length = (int)page[i].NameLength * 2;
+                if (name.Length < length)
+                    name = new byte[length];
+                Marshal.Copy(page[i].Name, name, 0, length);
+
+                yield return new DSStoreRecord(
+                    Encoding.BigEndianUnicode.GetString(name, 0, length),
+                    ToFourCC(page[i].Code),
+                    ToFourCC(page[i].Type));
+            }
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private static string ToFourCC(uint code)
+    {
+        return new string(new[] { (char)(code >> 24 & 0xFF), (char)(code >> 16 & 0xFF), (char)(code >> 8 & 0xFF), (char)(code & 0xFF) });
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeDSStore));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            DSStoreClose_arm64(handle);
+        else if (Is64Bit)
+            DSStoreClose_64(handle);
+        else
+            DSStoreClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "DSStoreOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint DSStoreOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "DSStoreClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void DSStoreClose_32(nint store);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "DSStoreGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool DSStoreGetInfo_32(nint store, out DSStoreInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "DSStoreReadRecords", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint DSStoreReadRecords_32(nint store, ref DSStoreCursor cursor, [Out] NativeRecord[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "DSStoreOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint DSStoreOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "DSStoreClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void DSStoreClose_64(nint store);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "DSStoreGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool DSStoreGetInfo_64(nint store, out DSStoreInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "DSStoreReadRecords", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint DSStoreReadRecords_64(nint store, ref DSStoreCursor cursor, [Out] NativeRecord[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "DSStoreOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint DSStoreOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "DSStoreClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void DSStoreClose_arm64(nint store);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "DSStoreGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool DSStoreGetInfo_arm64(nint store, out DSStoreInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "DSStoreReadRecords", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint DSStoreReadRecords_arm64(nint store, ref DSStoreCursor cursor, [Out] NativeRecord[] entries, uint count);
+
+    // Must match DSStoreReader::Info in QuickLook.Native/QuickLook.Native32/DSStoreReader.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct DSStoreInfo
+    {
+        public uint BlockCount;
+        public uint RootNode;
+        public uint Levels;
+        public uint Records;
+        public uint Nodes;
+        public uint PageSize;
+    }
+
+    // Opaque to this side; the frames are {block, index, offset, descended} from the root down
+    [StructLayout(LayoutKind.Sequential)]
+    private struct DSStoreCursor
+    {
+        public uint Depth;
+        public uint Visited;
+        public uint Done;
+
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = MaxDepth * FrameSize)]
+        public uint[] Frames;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeRecord
+    {
+        public nint Name;
+        public uint NameLength;
+        public uint Code;
+        public uint Type;
+        public uint DataLength;
+        public nint Data;
+        public ulong Value;
+    }
+}
+
+/// <summary>
+/// Represents one record of a .DS_Store file: a property of the item named <see cref="Name" />.
+/// </summary>
+internal sealed class DSStoreRecord(string name, string code, string type)
+{
+    public string Name { get; } = name;
+
+    /// <summary>
+    /// Gets the four-character property code, e.g. "Iloc" for the icon location.
+    /// </summary>
+    public string Code { get; } = code;
+
+    /// <summary>
+    /// Gets the four-character data type, e.g. "blob" or "ustr".
+    /// </summary>
+    public string Type { get; } = type;
+}
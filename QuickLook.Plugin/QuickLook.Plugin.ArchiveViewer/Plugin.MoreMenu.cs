@@ -83,6 +83,8 @@ public sealed partial class Plugin
             || _path.EndsWith(".appxbundle", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".msix", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".msixbundle", StringComparison.OrdinalIgnoreCase)
+            || _path.EndsWith(".msi", StringComparison.OrdinalIgnoreCase)
+            || _path.EndsWith(".msp", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".nupkg", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".snupkg", StringComparison.OrdinalIgnoreCase)
             || _path.EndsWith(".wgt", StringComparison.OrdinalIgnoreCase)
@@ -156,7 +158,7 @@ public sealed partial class Plugin
             }
             else if (_path.EndsWith(".pak", StringComparison.OrdinalIgnoreCase))
             {
-                // Chromium resource package file v5 extraction
+                // Chromium resource package file v4/v5 extraction
                 await Task.Run(() =>
                 {
                     PakExtractor.ExtractToDirectory(_path, dialog.FileName, appendExtension: true);
@@ -60,6 +60,8 @@ public sealed partial class Plugin : IViewer, IMoreMenu
         // List of supported compound file binary file extensions
         ".cfb",     // Compound File Binary format (used by older Microsoft Office files)
         ".eif",     // QQ emoji file (Compound File Binary format)
+        ".msi",     // Windows Installer package (Compound File Binary format, AppViewer usually takes it first)
+        ".msp",     // Windows Installer patch (Compound File Binary format, AppViewer usually takes it first)
 
         // List of supported chromium resource package file extensions
         ".pak",     // Chromium resource package file v5, used by Chromium-based applications (e.g., Google Chrome)
@@ -138,7 +140,9 @@ public sealed partial class Plugin : IViewer, IMoreMenu
         }
         else if (Path.GetFileName(path).Equals("Thumbs.db", StringComparison.OrdinalIgnoreCase)
             || path.EndsWith(".cfb", StringComparison.OrdinalIgnoreCase)
-            || path.EndsWith(".eif", StringComparison.OrdinalIgnoreCase))
+            || path.EndsWith(".eif", StringComparison.OrdinalIgnoreCase)
+            || path.EndsWith(".msi", StringComparison.OrdinalIgnoreCase)
+            || path.EndsWith(".msp", StringComparison.OrdinalIgnoreCase))
         {
             _panel = new CompoundInfoPanel(path);
         }
@@ -16,8 +16,18 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using QuickLook.Common.Helpers;
+using QuickLook.Plugin.TextViewer;
+using System;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
+using System.Windows.Controls.Primitives;
+using System.Windows.Input;
 using System.Windows.Media;
 using System.Windows.Threading;
 
@@ -25,6 +35,18 @@ namespace QuickLook.Plugin.BinaryViewer;
 
 public partial class BinaryViewerPanel : UserControl
 {
+    // Smaller files keep the full hex editor; larger ones are shown by the native engine, which
+    // needs the same time and memory for a file of any size.
+    private const long NativeViewThreshold = 64 * 1024 * 1024;
+
+    private readonly string _translationFile = Path.Combine(Path.GetDirectoryName(Assembly.GetExecutingAssembly().Location), "Translations.config");
+
+    private string _path;
+    private NativeHexView _view;
+    private CancellationTokenSource _search;
+    private string _lastQuery;
+    private ulong? _lastMatch;
+
     public BinaryViewerPanel()
     {
         InitializeComponent();
@@ -32,6 +54,9 @@ public partial class BinaryViewerPanel : UserControl
 
     public void LoadFile(string path)
     {
+        if (new FileInfo(path).Length >= NativeViewThreshold && LoadNative(path))
+            return;
+
         _hexEditor.FileName = path;
         _hexEditor.BarChartPanelVisibility = Visibility.Collapsed;
         _hexEditor.EnableDarkMode = OSThemeHelper.AppsUseDarkTheme();
@@ -50,8 +75,171 @@ public partial class BinaryViewerPanel : UserControl
 
     public void Unload()
     {
+        if (_view != null)
+        {
+            _search?.Cancel();
+            _rows.View = null;
+            _view.Dispose();
+            _view = null;
+            return;
+        }
+
         // Close() properly releases the file stream and lock,
         // whereas setting FileName = null does not free the handle.
         _hexEditor.Close();
     }
+
+    private bool LoadNative(string path)
+    {
+        _view = NativeHexView.Open(path);
+        if (_view == null)
+            return false;
+
+        _path = path;
+        _hexEditor.Visibility = Visibility.Collapsed;
+        _nativeView.Visibility = Visibility.Visible;
+        _searchBox.ToolTip = TranslationHelper.Get("SearchToolTip", _translationFile);
+        _rows.Foreground = OSThemeHelper.AppsUseDarkTheme() ? Brushes.White : Brushes.Black;
+        _rows.View = _view;
+        return true;
+    }
+
+    private void Rows_FirstRowChanged(object sender, EventArgs e)
+    {
+        var visible = _rows.VisibleRows;
+        _scrollBar.Maximum = _rows.MaxFirstRow;
+        _scrollBar.ViewportSize = visible;
+        _scrollBar.LargeChange = visible;
+        _scrollBar.SmallChange = 1;
+        _scrollBar.Value = _rows.FirstRow;
+    }
+
+    private void ScrollBar_Scroll(object sender, ScrollEventArgs e)
+    {
+        _rows.FirstRow = (ulong)Math.Max(0, Math.Round(e.NewValue));
+    }
+
+    private void NativeView_PreviewKeyDown(object sender, KeyEventArgs e)
+    {
+        if (e.Key == Key.F && Keyboard.Modifiers.HasFlag(ModifierKeys.Control))
+        {
+            _searchBox.Focus();
+            _searchBox.SelectAll();
+            e.Handled = true;
+            return;
+        }
+
+        if (e.Key == Key.F3)
+        {
+            FindNext();
+            e.Handled = true;
+        }
+    }
+
+    private void SearchBox_KeyDown(object sender, KeyEventArgs e)
+    {
+        if (e.Key != Key.Enter)
+            return;
+
+        FindNext();
+        e.Handled = true;
+    }
+
+    private async void FindNext()
+    {
+        var pattern = ParsePattern(_searchBox.Text);
+        if (_view == null || pattern == null)
+            return;
+
+        if (_searchBox.Text != _lastQuery)
+        {
+            _lastQuery = _searchBox.Text;
+            _lastMatch = null;
+        }
+
+        // from after the last match, or else from the first visible row
+        var start = _lastMatch + 1 ?? _rows.FirstRow * NativeHexView.BytesPerRow;
+        var path = _path;
+        var size = _view.Size;
+
+        _search?.Cancel();
+        var search = _search = new CancellationTokenSource();
+        var progress = new Progress<double>(done =>
+        {
+            if (!search.IsCancellationRequested)
+                _searchStatus.Text = $"{done:P0}";
+        });
+
+        ulong? found;
+        try
+        {
+            found = await Task.Run(() => Find(path, pattern, start, size, progress, search.Token), search.Token);
+        }
+        catch (OperationCanceledException)
+        {
+            return;
+        }
+
+        if (search.IsCancellationRequested || _view == null)
+            return;
+
+        _lastMatch = found;
+        if (found == null)
+        {
+            _searchStatus.Text = TranslationHelper.Get("SearchNotFound", _translationFile);
+            return;
+        }
+
+        _searchStatus.Text = $"0x{found.Value:X}";
+        _rows.Highlight(found.Value, pattern.Length);
+    }
+
+    private static ulong? Find(string path, byte[] pattern, ulong start, ulong size, IProgress<double> progress, CancellationToken token)
+    {
+        // searched by all processors through handles of its own, so the rows can be painted meanwhile
+        using var search = NativeFileSearch.Open(path, pattern);
+        if (search == null)
+            return null;
+
+        // to the end of the file, then around from the beginning up to the matches that start before start
+        ulong? found = null;
+        var searched = 0ul;
+        foreach (var (from, to) in new[] { (start, size), (0ul, Math.Min(start + (ulong)pattern.Length - 1, size)) })
+        {
+            search.Run(from, to, (matches, done) =>
+            {
+                progress.Report((double)(searched + done) / size);
+                if (matches.Length == 0)
+                    return true;
+
+                found = matches[0].Offset;
+                return false;
+            }, token);
+
+            token.ThrowIfCancellationRequested();
+            if (found != null)
+                return found;
+            searched += to - from;
+        }
+
+        return null;
+    }
+
+    private static byte[] ParsePattern(string text)
+    {
+        if (string.IsNullOrEmpty(text))
+            return null;
+
+        // pairs of hex digits are bytes, anything else (or anything in quotes) is UTF-8 text
+        byte[] pattern;
+        var hex = text.Replace(" ", string.Empty);
+        if (text.Length >= 2 && text[0] == '"' && text[text.Length - 1] == '"')
+            pattern = Encoding.UTF8.GetBytes(text.Substring(1, text.Length - 2));
+        else if (hex.Length % 2 == 0 && hex.All(Uri.IsHexDigit))
+            pattern = Enumerable.Range(0, hex.Length / 2).Select(i => Convert.ToByte(hex.Substring(2 * i, 2), 16)).ToArray();
+        else
+            pattern = Encoding.UTF8.GetBytes(text);
+
+        return pattern.Length is > 0 and <= NativeHexView.MaxPatternLength ? pattern : null;
+    }
 }
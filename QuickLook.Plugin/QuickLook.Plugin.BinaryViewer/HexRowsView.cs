@@ -0,0 +1,249 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Globalization;
+using System.Windows;
+using System.Windows.Input;
+using System.Windows.Media;
+
+namespace QuickLook.Plugin.BinaryViewer;
+
+/// <summary>
+/// Draws the rows of a <see cref="NativeHexView" /> that fit into the control, from <see cref="FirstRow" /> on.
+/// Only those rows are ever formatted, so scrolling costs the same in a file of any size.
+/// </summary>
+public sealed class HexRowsView : FrameworkElement
+{
+    private const double FontSize = 13;
+    private const int WheelRows = 3;
+
+    private static readonly Typeface Typeface = new(new FontFamily("Consolas"), FontStyles.Normal, FontWeights.Normal, FontStretches.Normal);
+
+    private NativeHexView _view;
+    private ulong _firstRow;
+    private ulong _highlightOffset;
+    private int _highlightLength;
+    private double _lineHeight;
+    private double _charWidth;
+
+    public HexRowsView()
+    {
+        Focusable = true;
+        FocusVisualStyle = null;
+    }
+
+    /// <summary>
+    /// Occurs when <see cref="FirstRow" /> or the number of visible rows changes.
+    /// </summary>
+    public event EventHandler FirstRowChanged;
+
+    public Brush Foreground { get; set; } = Brushes.Black;
+
+    public Brush HighlightBrush { get; set; } = new SolidColorBrush(Color.FromArgb(0x80, 0xFF, 0xB9, 0x00));
+
+    internal NativeHexView View
+    {
+        get => _view;
+        set
+        {
+            _view = value;
+            _firstRow = 0;
+            _highlightLength = 0;
+            InvalidateMeasure();
+            InvalidateVisual();
+            FirstRowChanged?.Invoke(this, EventArgs.Empty);
+        }
+    }
+
+    public ulong FirstRow
+    {
+        get => _firstRow;
+        set
+        {
+            var row = Math.Min(value, MaxFirstRow);
+            if (row == _firstRow)
+                return;
+
+            _firstRow = row;
+            InvalidateVisual();
+            FirstRowChanged?.Invoke(this, EventArgs.Empty);
+        }
+    }
+
+    public int VisibleRows => Math.Max(1, (int)(ActualHeight / LineHeight));
+
+    public ulong MaxFirstRow
+    {
+        get
+        {
+            var rows = _view?.RowCount ?? 0;
+            return rows > (ulong)VisibleRows ? rows - (ulong)VisibleRows : 0;
+        }
+    }
+
+    private double LineHeight
+    {
+        get
+        {
+            MeasureFont();
+            return _lineHeight;
+        }
+    }
+
+    /// <summary>
+    /// Marks <paramref name="length" /> bytes from <paramref name="offset" /> and scrolls them into view.
+    /// </summary>
+    public void Highlight(ulong offset, int length)
+    {
+        _highlightOffset = offset;
+        _highlightLength = length;
+
+        var row = offset / NativeHexView.BytesPerRow;
+        if (row < _firstRow || row >= _firstRow + (ulong)VisibleRows)
+            FirstRow = row - Math.Min(row, (ulong)(VisibleRows / 3));
+        InvalidateVisual();
+    }
+
+    public void ScrollBy(long rows)
+    {
+        FirstRow = rows < 0 ? _firstRow - Math.Min(_firstRow, (ulong)-rows) : _firstRow + Math.Min((ulong)rows, MaxFirstRow - _firstRow);
+    }
+
+    protected override Size MeasureOverride(Size availableSize)
+    {
+        MeasureFont();
+        return new Size(_view == null ? 0 : _view.RowWidth * _charWidth, 0);
+    }
+
+    protected override void OnRenderSizeChanged(SizeChangedInfo sizeInfo)
+    {
+        base.OnRenderSizeChanged(sizeInfo);
+
+        // a taller view may now show the end of the file from an earlier row
+        _firstRow = Math.Min(_firstRow, MaxFirstRow);
+        FirstRowChanged?.Invoke(this, EventArgs.Empty);
+    }
+
+    protected override void OnRender(DrawingContext drawingContext)
+    {
+        // transparent background for hit testing of the wheel and clicks
+        drawingContext.DrawRectangle(Brushes.Transparent, null, new Rect(RenderSize));
+
+        if (_view == null)
+            return;
+
+        MeasureFont();
+        var pixelsPerDip = VisualTreeHelper.GetDpi(this).PixelsPerDip;
+        // one more row for the partly visible one at the bottom
+        var rows = _view.FormatRows(_firstRow, VisibleRows + 1);
+
+        for (var i = 0; i < rows.Length; i++)
+        {
+            var y = i * _lineHeight;
+            DrawHighlight(drawingContext, _firstRow + (ulong)i, y);
+
+            var text = new FormattedText(rows[i], CultureInfo.InvariantCulture, FlowDirection.LeftToRight, Typeface, FontSize, Foreground, pixelsPerDip);
+            drawingContext.DrawText(text, new Point(0, y));
+        }
+    }
+
+    protected override void OnMouseDown(MouseButtonEventArgs e)
+    {
+        base.OnMouseDown(e);
+        Focus();
+    }
+
+    protected override void OnMouseWheel(MouseWheelEventArgs e)
+    {
+        base.OnMouseWheel(e);
+        ScrollBy(-e.Delta / Mouse.MouseWheelDeltaForOneLine * WheelRows);
+        e.Handled = true;
+    }
+
+    protected override void OnKeyDown(KeyEventArgs e)
+    {
+        base.OnKeyDown(e);
+
+        switch (e.Key)
+        {
+            case Key.Up:
+                ScrollBy(-1);
+                break;
+
+            case Key.Down:
+                ScrollBy(1);
+                break;
+
+            case Key.PageUp:
+                ScrollBy(-VisibleRows);
+                break;
+
+            case Key.PageDown:
+                ScrollBy(VisibleRows);
+                break;
+
+            case Key.Home:
+                FirstRow = 0;
+                break;
+
+            case Key.End:
+                FirstRow = MaxFirstRow;
+                break;
+
+            default:
+                return;
+        }
+
+        e.Handled = true;
+    }
+
+    private void DrawHighlight(DrawingContext drawingContext, ulong row, double y)
+    {
+        if (_highlightLength == 0)
+            return;
+
+        // the highlighted bytes that fall into this row
+        var rowStart = row * NativeHexView.BytesPerRow;
+        var highlightEnd = _highlightOffset + (ulong)_highlightLength;
+        if (highlightEnd <= rowStart || _highlightOffset >= rowStart + NativeHexView.BytesPerRow)
+            return;
+
+        var first = (int)(Math.Max(_highlightOffset, rowStart) - rowStart);
+        var last = (int)(Math.Min(highlightEnd, rowStart + NativeHexView.BytesPerRow) - rowStart);
+
+        // columns as laid out by HexView::formatRow: offset, two spaces, "XX " per byte with a
+        // wider gap after every 8 bytes, a space, then one character per byte
+        var hexColumn = _view.OffsetDigits + 2;
+        var textColumn = hexColumn + 3 * NativeHexView.BytesPerRow + NativeHexView.BytesPerRow / 8;
+        for (var i = first; i < last; i++)
+        {
+            drawingContext.DrawRectangle(HighlightBrush, null, new Rect((hexColumn + 3 * i + i / 8) * _charWidth, y, 2 * _charWidth, _lineHeight));
+            drawingContext.DrawRectangle(HighlightBrush, null, new Rect((textColumn + i) * _charWidth, y, _charWidth, _lineHeight));
+        }
+    }
+
+    private void MeasureFont()
+    {
+        if (_lineHeight > 0)
+            return;
+
+        var sample = new FormattedText("0", CultureInfo.InvariantCulture, FlowDirection.LeftToRight, Typeface, FontSize, Brushes.Black, VisualTreeHelper.GetDpi(this).PixelsPerDip);
+        _lineHeight = sample.Height;
+        _charWidth = sample.WidthIncludingTrailingWhitespace;
+    }
+}
@@ -0,0 +1,211 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace QuickLook.Plugin.BinaryViewer;
+
+/// <summary>
+/// Hex dump of a file of any size, formatted by the memory-mapped hex engine of QuickLook.Native.
+/// The file is mapped one window at a time and only the requested rows are formatted, so any place
+/// of a file can be shown in the same time and memory however large it is.
+/// </summary>
+internal sealed class NativeHexView : IDisposable
+{
+    public const int BytesPerRow = 16;
+    public const int MaxPatternLength = 4096;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private byte[] _text = [];
+
+    /// <summary>
+    /// Gets the file size in bytes.
+    /// </summary>
+    public ulong Size { get; }
+
+    /// <summary>
+    /// Gets the number of hex digits of the offset at the start of each row.
+    /// </summary>
+    public int OffsetDigits { get; }
+
+    /// <summary>
+    /// Gets the number of characters in each row.
+    /// </summary>
+    public int RowWidth { get; }
+
+    public ulong RowCount => (Size + BytesPerRow - 1) / BytesPerRow;
+
+    private NativeHexView(nint handle, HexInfo info, int rowWidth)
+    {
+        _handle = handle;
+        Size = info.Size;
+        OffsetDigits = (int)info.OffsetDigits;
+        RowWidth = rowWidth;
+    }
+
+    /// <summary>
+    /// Opens the specified file without mapping any of it yet.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeHexView" />, or <see langword="null" /> if the file cannot be opened or the native engine is not available.
+    /// </returns>
+    public static NativeHexView Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? HexOpen_arm64(path) : Is64Bit ? HexOpen_64(path) : HexOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? HexGetInfo_arm64(handle, out var info)
+                : Is64Bit ? HexGetInfo_64(handle, out info) : HexGetInfo_32(handle, out info);
+            if (ok)
+            {
+                var width = IsArm64 ? HexRowWidth_arm64(info.OffsetDigits, BytesPerRow)
+                    : Is64Bit ? HexRowWidth_64(info.OffsetDigits, BytesPerRow) : HexRowWidth_32(info.OffsetDigits, BytesPerRow);
+                return new NativeHexView(handle, info, (int)width);
+            }
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Formats up to <paramref name="count" /> rows from <paramref name="firstRow" /> on; rows past the end of the file are left out.
+    /// </summary>
+    public string[] FormatRows(ulong firstRow, int count)
+    {
+        var handle = ThrowIfDisposed();
+        if (count <= 0)
+            return [];
+
+        var lineLength = RowWidth + 1;
+        var capacity = checked(lineLength * count);
+        if (_text.Length < capacity)
+            _text = new byte[capacity];
+
+        var written = IsArm64 ? HexFormat_arm64(handle, firstRow, (uint)count, BytesPerRow, _text, (uint)capacity)
+            : Is64Bit ? HexFormat_64(handle, firstRow, (uint)count, BytesPerRow, _text, (uint)capacity)
+            : HexFormat_32(handle, firstRow, (uint)count, BytesPerRow, _text, (uint)capacity);
+
+        var rows = new string[written / lineLength];
+        for (var i = 0; i < rows.Length; i++)
+            rows[i] = Encoding.ASCII.GetString(_text, i * lineLength, RowWidth);
+        return rows;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeHexView));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            HexClose_arm64(handle);
+        else if (Is64Bit)
+            HexClose_64(handle);
+        else
+            HexClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "HexOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint HexOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "HexClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void HexClose_32(nint view);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "HexGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool HexGetInfo_32(nint view, out HexInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "HexRowWidth", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint HexRowWidth_32(uint offsetDigits, uint bytesPerRow);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "HexFormat", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint HexFormat_32(nint view, ulong firstRow, uint rows, uint bytesPerRow, [Out] byte[] text, uint capacity);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "HexOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint HexOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "HexClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void HexClose_64(nint view);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "HexGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool HexGetInfo_64(nint view, out HexInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "HexRowWidth", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint HexRowWidth_64(uint offsetDigits, uint bytesPerRow);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "HexFormat", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint HexFormat_64(nint view, ulong firstRow, uint rows, uint bytesPerRow, [Out] byte[] text, uint capacity);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "HexOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint HexOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "HexClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void HexClose_arm64(nint view);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "HexGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool HexGetInfo_arm64(nint view, out HexInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "HexRowWidth", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint HexRowWidth_arm64(uint offsetDigits, uint bytesPerRow);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "HexFormat", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint HexFormat_arm64(nint view, ulong firstRow, uint rows, uint bytesPerRow, [Out] byte[] text, uint capacity);
+
+    // Must match HexView::Info in QuickLook.Native/QuickLook.Native32/HexView.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct HexInfo
+    {
+        public ulong Size;
+        public uint OffsetDigits;
+    }
+}
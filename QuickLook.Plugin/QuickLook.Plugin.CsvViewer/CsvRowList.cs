@@ -0,0 +1,191 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Collections.Specialized;
+
+namespace QuickLook.Plugin.CsvViewer;
+
+/// <summary>
+/// The rows of a <see cref="NativeCsvTable" /> as a read-only list for the data grid, which asks only for the rows
+/// it shows. They are split in pages of <see cref="PageSize" /> rows, and the last pages read are kept, so a row
+/// stays the same instance while it is on screen. Each row starts with its number like the rows of
+/// <see cref="CsvViewerPanel.LoadFile" /> and has exactly <see cref="Columns" /> cells.
+/// </summary>
+internal sealed class CsvRowList : IList, IReadOnlyList<string[]>, INotifyCollectionChanged
+{
+    private const int PageSize = 64;
+    private const int CachedPages = 32;
+
+    // pages in the order they were last used, the latest first
+    private readonly List<(long Page, string[][] Rows)> _pages = [];
+    private NativeCsvTable _table;
+    private int _count;
+
+    public CsvRowList(NativeCsvTable table, int columns)
+    {
+        _table = table;
+        Columns = columns;
+        _count = CountOf(table);
+    }
+
+    public event NotifyCollectionChangedEventHandler CollectionChanged;
+
+    /// <summary>
+    /// Gets the number of cells of every row, including the row number.
+    /// </summary>
+    public int Columns { get; }
+
+    /// <summary>
+    /// Gets the number of rows indexed as of the last <see cref="Refresh" />.
+    /// </summary>
+    public int Count => _count;
+
+    public bool IsFixedSize => true;
+
+    public bool IsReadOnly => true;
+
+    public bool IsSynchronized => false;
+
+    public object SyncRoot => this;
+
+    public string[] this[int index]
+    {
+        get
+        {
+            if (index < 0 || index >= _count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            var rows = GetPage(index / PageSize);
+            var offset = index % PageSize;
+            return offset < rows.Length ? rows[offset] : new string[Columns];
+        }
+    }
+
+    object IList.this[int index]
+    {
+        get => this[index];
+        set => throw new NotSupportedException();
+    }
+
+    /// <summary>
+    /// Takes in the rows indexed since the last call, telling the data grid if there are more.
+    /// </summary>
+    public void Refresh()
+    {
+        if (_table == null)
+            return;
+
+        var count = CountOf(_table);
+        if (count == _count)
+            return;
+
+        // a page read at the end of the index may have been short
+        _pages.RemoveAll(page => page.Rows.Length < PageSize);
+        _count = count;
+        CollectionChanged?.Invoke(this, new NotifyCollectionChangedEventArgs(NotifyCollectionChangedAction.Reset));
+    }
+
+    /// <summary>
+    /// Stops reading from the table, which is about to be closed; the rows read so far can still be shown.
+    /// </summary>
+    public void Detach()
+    {
+        _table = null;
+    }
+
+    public int IndexOf(object value)
+    {
+        // rows are found by instance, and the data grid only asks for the ones it shows
+        foreach (var (page, rows) in _pages)
+        {
+            var offset = Array.IndexOf(rows, value);
+            if (offset >= 0)
+                return (int)(page * PageSize + offset);
+        }
+        return -1;
+    }
+
+    public bool Contains(object value)
+    {
+        return IndexOf(value) >= 0;
+    }
+
+    public void CopyTo(Array array, int index)
+    {
+        for (var i = 0; i < _count; i++)
+            array.SetValue(this[i], index + i);
+    }
+
+    public IEnumerator<string[]> GetEnumerator()
+    {
+        for (var i = 0; i < _count; i++)
+            yield return this[i];
+    }
+
+    IEnumerator IEnumerable.GetEnumerator()
+    {
+        return GetEnumerator();
+    }
+
+    int IList.Add(object value) => throw new NotSupportedException();
+
+    void IList.Clear() => throw new NotSupportedException();
+
+    void IList.Insert(int index, object value) => throw new NotSupportedException();
+
+    void IList.Remove(object value) => throw new NotSupportedException();
+
+    void IList.RemoveAt(int index) => throw new NotSupportedException();
+
+    private string[][] GetPage(long page)
+    {
+        var found = _pages.FindIndex(cached => cached.Page == page);
+        if (found >= 0)
+        {
+            var cached = _pages[found];
+            _pages.RemoveAt(found);
+            _pages.Insert(0, cached);
+            return cached.Rows;
+        }
+
+        if (_table == null)
+            return [];
+
+        var first = page * PageSize;
+        var rows = _table.ReadRows((ulong)first, PageSize, Columns - 1);
+        for (var i = 0; i < rows.Length; i++)
+        {
+            var row = new string[Columns];
+            row[0] = $"{first + i + 1}".PadLeft(6);
+            Array.Copy(rows[i], 0, row, 1, rows[i].Length);
+            rows[i] = row;
+        }
+
+        if (_pages.Count == CachedPages)
+            _pages.RemoveAt(CachedPages - 1);
+        _pages.Insert(0, (page, rows));
+        return rows;
+    }
+
+    private static int CountOf(NativeCsvTable table)
+    {
+        return table == null ? 0 : (int)Math.Min(table.RowCount, int.MaxValue);
+    }
+}
@@ -17,24 +17,51 @@
 
 using CsvHelper;
 using CsvHelper.Configuration;
+using QuickLook.Plugin.TextViewer;
+using QuickLook.Plugin.TextViewer.Detectors;
 using System;
 using System.Collections.Generic;
 using System.Globalization;
 using System.IO;
 using System.Linq;
 using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
 using System.Windows.Controls.Primitives;
 using System.Windows.Data;
 using System.Windows.Input;
 using System.Windows.Media;
+using System.Windows.Threading;
 using UtfUnknown;
 
 namespace QuickLook.Plugin.CsvViewer;
 
-public partial class CsvViewerPanel : UserControl
+public partial class CsvViewerPanel : UserControl, IDisposable
 {
+    // rows with matches listed of a file read through the native index
+    private const int SearchRowLimit = 10000;
+
+    // offsets found by the search past the row index kept at most, before the search is stopped
+    private const int MaxUnindexedMatches = 1024 * 1024;
+
+    // most fields shown of a row read through the native index
+    private const int MaxColumns = 4096;
+
+    // bytes indexed between two checks for disposal
+    private const uint BuildStep = 16 * 1024 * 1024;
+
+    private readonly object _buildLock = new();
+    private readonly DispatcherTimer _progressTimer = new() { Interval = TimeSpan.FromMilliseconds(250) };
+    private NativeCsvTable _table;
+    private CsvRowList _tableRows;
+    private string _tablePath;
+
+    // the whole-file search of the native table, and the offsets it found past what is indexed so far
+    private CancellationTokenSource _search;
+    private readonly List<ulong> _unindexedMatches = [];
+
     public CsvViewerPanel()
     {
         InitializeComponent();
@@ -48,9 +75,14 @@ public partial class CsvViewerPanel : UserControl
 
         PreviewKeyDown += CsvViewerPanel_PreviewKeyDown;
         dataGrid.LoadingRow += DataGrid_LoadingRow;
+        _progressTimer.Tick += (_, _) =>
+        {
+            _tableRows?.Refresh();
+            AddFileMatches([]);
+        };
     }
 
-    public List<string[]> Rows { get; private set; } = [];
+    public IReadOnlyList<string[]> Rows { get; private set; } = [];
 
     private readonly List<(int RowIndex, int ColumnIndex)> _matches = [];
     private readonly HashSet<(int RowIndex, int ColumnIndex)> _matchSet = [];
@@ -59,21 +91,22 @@ public partial class CsvViewerPanel : UserControl
     public void LoadFile(string path)
     {
         const int limit = 10000;
+        const long encodingSampleSize = 16 * 1024 * 1024;
         var binded = false;
 
-        Rows.Clear();
+        Rows = [];
         dataGrid.Columns.Clear();
+        CancelFileSearch();
         _matches.Clear();
         _matchSet.Clear();
         _currentMatchIndex = -1;
         searchPanel.SetMatchCount(0, 0);
         searchPanel.Visibility = Visibility.Collapsed;
 
-        var encoding = CharsetDetector.DetectFromFile(path).Detected?.Encoding ??
+        var encoding = NativeTextEncoding.DetectFile(path, encodingSampleSize) ??
+                       DetectEncoding(path, encodingSampleSize) ??
                        Encoding.Default;
 
-        using var sr = new StreamReader(new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite), encoding);
-
         // Use fixed delimiters for known extensions to avoid mis-detection on small samples.
         var extension = Path.GetExtension(path);
         var delimiter = extension.Equals(".tsv", StringComparison.OrdinalIgnoreCase)
@@ -82,6 +115,11 @@ public partial class CsvViewerPanel : UserControl
                 ? "|"
                 : null;
 
+        if (LoadTable(path, encoding, delimiter?[0] ?? '\0'))
+            return;
+
+        using var sr = new StreamReader(new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite), encoding);
+
         var conf = new CsvConfiguration(CultureInfo.CurrentUICulture)
         {
             MissingFieldFound = null,
@@ -96,6 +134,9 @@ public partial class CsvViewerPanel : UserControl
         }
 
         using var parser = new CsvParser(sr, conf);
+        var rows = new List<string[]>();
+        Rows = rows;
+        dataGrid.ItemsSource = rows;
         var i = 0;
         while (parser.Read())
         {
@@ -112,14 +153,83 @@ public partial class CsvViewerPanel : UserControl
 
             if (i > limit)
             {
-                Rows.Add([.. Enumerable.Repeat("...", row.Length)]);
+                rows.Add([.. Enumerable.Repeat("...", row.Length)]);
                 break;
             }
 
-            Rows.Add(row);
+            rows.Add(row);
+        }
+    }
+
+    public void Dispose()
+    {
+        CancelFileSearch();
+        _progressTimer.Stop();
+        _tableRows?.Detach();
+
+        // waits for the step being indexed, the table cannot be closed under it
+        lock (_buildLock)
+        {
+            _table?.Dispose();
+            _table = null;
         }
     }
 
+    /// <summary>
+    /// Shows all rows of the file through the native row index, which only splits the rows on screen, so a file of
+    /// any size opens at once and scrolls to its end while the rest is indexed in the background.
+    /// </summary>
+    /// <returns><see langword="false" /> if the index cannot read the file in <paramref name="encoding" />.</returns>
+    private bool LoadTable(string path, Encoding encoding, char delimiter)
+    {
+        var table = NativeCsvTable.Open(path, encoding, delimiter);
+        if (table == null)
+            return false;
+
+        // the columns come from the first row, which has to be indexed for that
+        string[][] first;
+        while ((first = table.ReadRows(0, 1, MaxColumns)).Length == 0 && table.Build(BuildStep))
+        {
+        }
+
+        _table = table;
+        _tablePath = path;
+        _tableRows = new CsvRowList(table, 1 + (first.Length > 0 ? first[0].Length : 0));
+        Rows = _tableRows;
+        SetupColumnBinding(_tableRows.Columns);
+        dataGrid.ItemsSource = _tableRows;
+
+        _progressTimer.Start();
+        _ = Task.Run(Build);
+        return true;
+    }
+
+    private void Build()
+    {
+        while (true)
+        {
+            lock (_buildLock)
+            {
+                if (_table == null || !_table.Build(BuildStep))
+                    break;
+            }
+        }
+
+        Dispatcher.BeginInvoke(() =>
+        {
+            _progressTimer.Stop();
+            _tableRows?.Refresh();
+            AddFileMatches([]);
+        });
+    }
+
+    private static Encoding DetectEncoding(string path, long sampleSize)
+    {
+        // the whole of a large file would take long to read
+        using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite);
+        return CharsetDetector.DetectFromStream(stream, sampleSize).Detected?.Encoding;
+    }
+
     private void SetupColumnBinding(int rowLength)
     {
         for (var i = 0; i < rowLength; i++)
@@ -222,6 +332,7 @@ public partial class CsvViewerPanel : UserControl
     private void ExecuteSearch()
     {
         var query = searchPanel.SearchText ?? string.Empty;
+        CancelFileSearch();
         _matches.Clear();
         _matchSet.Clear();
         _currentMatchIndex = -1;
@@ -232,7 +343,17 @@ public partial class CsvViewerPanel : UserControl
                 ? StringComparison.Ordinal
                 : StringComparison.OrdinalIgnoreCase;
 
-            for (var rowIndex = 0; rowIndex < Rows.Count; rowIndex++)
+            if (_table != null && StartFileSearch(query))
+            {
+                // the matches come in from the search as it goes through the file
+                searchPanel.SetMatchCount(0, 0);
+                UpdateVisibleCellHighlights();
+                UpdateCurrentMatchSelection();
+                return;
+            }
+
+            var searched = _tableRows != null ? Math.Min(Rows.Count, SearchRowLimit) : Rows.Count;
+            for (var rowIndex = 0; rowIndex < searched; rowIndex++)
             {
                 var row = Rows[rowIndex];
                 for (var columnIndex = 0; columnIndex < row.Length; columnIndex++)
@@ -257,6 +378,106 @@ public partial class CsvViewerPanel : UserControl
         UpdateCurrentMatchSelection();
     }
 
+    /// <summary>
+    /// Searches the whole file for <paramref name="query" /> on the native search threads, while the rows keep being
+    /// indexed, and adds the cells of the rows it is found in as the matches come in.
+    /// </summary>
+    /// <returns><see langword="false" /> if the native search cannot search the file.</returns>
+    private bool StartFileSearch(string query)
+    {
+        var options = searchPanel.MatchCase ? SearchOptions.None : SearchOptions.IgnoreCase;
+        var search = NativeFileSearch.Open(_tablePath, query, _table.Encoding, options);
+        if (search == null)
+            return false;
+
+        var cancellation = new CancellationTokenSource();
+        _search = cancellation;
+        var token = cancellation.Token;
+
+        _ = Task.Run(() =>
+        {
+            using (search)
+            {
+                search.Run(0, search.Size, (matches, _) =>
+                {
+                    var offsets = matches.Select(match => match.Offset).ToArray();
+                    Dispatcher.BeginInvoke(() =>
+                    {
+                        if (!token.IsCancellationRequested)
+                            AddFileMatches(offsets);
+                    });
+                    return true;
+                }, token);
+            }
+        }, token);
+        return true;
+    }
+
+    /// <summary>
+    /// Turns the offsets found by the whole-file search into the matching cells of their rows. Offsets past what is
+    /// indexed are kept for the next call, which the indexing makes as it goes on.
+    /// </summary>
+    private void AddFileMatches(ulong[] offsets)
+    {
+        _unindexedMatches.AddRange(offsets);
+        if (_table == null || _unindexedMatches.Count == 0)
+            return;
+
+        _tableRows.Refresh();
+
+        var query = searchPanel.SearchText ?? string.Empty;
+        var comparison = searchPanel.MatchCase ? StringComparison.Ordinal : StringComparison.OrdinalIgnoreCase;
+        var lastRow = _matches.Count > 0 ? _matches[_matches.Count - 1].RowIndex : -1;
+        var rows = _matches.Select(match => match.RowIndex).Distinct().Count();
+        var added = 0;
+
+        foreach (var offset in _unindexedMatches)
+        {
+            if (_table.RowOf(offset) is not { } found)
+                break;
+
+            added++;
+            if (found > int.MaxValue || (int)found <= lastRow || rows >= SearchRowLimit)
+                continue;
+
+            lastRow = (int)found;
+            rows++;
+
+            var row = Rows[lastRow];
+            for (var columnIndex = 1; columnIndex < row.Length; columnIndex++)
+            {
+                // a match across a delimiter is in no single cell
+                var cellValue = row[columnIndex];
+                if (!string.IsNullOrEmpty(cellValue) && cellValue.IndexOf(query, comparison) >= 0)
+                {
+                    _matches.Add((lastRow, columnIndex));
+                    _matchSet.Add((lastRow, columnIndex));
+                }
+            }
+        }
+        _unindexedMatches.RemoveRange(0, added);
+
+        // enough rows are listed, or the search is too far ahead of the index to keep its offsets
+        if (rows >= SearchRowLimit || _unindexedMatches.Count > MaxUnindexedMatches)
+            _search?.Cancel();
+
+        if (_currentMatchIndex < 0 && _matches.Count > 0)
+        {
+            _currentMatchIndex = 0;
+            UpdateCurrentMatchSelection();
+        }
+
+        searchPanel.SetMatchCount(_currentMatchIndex + 1, _matches.Count);
+        UpdateVisibleCellHighlights();
+    }
+
+    private void CancelFileSearch()
+    {
+        _search?.Cancel();
+        _search = null;
+        _unindexedMatches.Clear();
+    }
+
     private void MoveMatch(int direction)
     {
         if (_matches.Count == 0)
@@ -317,6 +538,7 @@ public partial class CsvViewerPanel : UserControl
     {
         searchPanel.Visibility = Visibility.Collapsed;
         dataGrid.SelectedCells.Clear();
+        CancelFileSearch();
         _matches.Clear();
         _matchSet.Clear();
         _currentMatchIndex = -1;
@@ -0,0 +1,304 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace QuickLook.Plugin.CsvViewer;
+
+/// <summary>
+/// Rows of a CSV file of any size, found by the memory-mapped row index of QuickLook.Native.
+/// The row ends are counted by <see cref="Build" /> on a background thread, while the rows indexed so far
+/// can already be read; only the rows asked for are ever split into fields.
+/// </summary>
+internal sealed class NativeCsvTable : IDisposable
+{
+    // bytes of field text kept of one row; the rest of a longer row is cut off
+    private const int RowCapacity = 64 * 1024;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private ulong[] _starts = [];
+    private uint[] _fieldEnds = [];
+    private readonly byte[] _text = new byte[RowCapacity];
+
+    /// <summary>
+    /// Gets the encoding the fields are decoded with.
+    /// </summary>
+    public Encoding Encoding { get; }
+
+    /// <summary>
+    /// Gets the delimiter between fields, given to <see cref="Open" /> or inferred from the first rows.
+    /// </summary>
+    public char Delimiter { get; }
+
+    /// <summary>
+    /// Gets the file size in bytes.
+    /// </summary>
+    public ulong Size { get; }
+
+    /// <summary>
+    /// Gets the number of rows indexed so far; the last row of the file only counts once all of it is indexed.
+    /// </summary>
+    public ulong RowCount => GetInfo().Rows;
+
+    /// <summary>
+    /// Gets whether the row ends of the whole file are counted.
+    /// </summary>
+    public bool IsIndexed => GetInfo().Indexed == Size;
+
+    private NativeCsvTable(nint handle, Encoding encoding, CsvInfo info)
+    {
+        _handle = handle;
+        Encoding = encoding;
+        Delimiter = (char)info.Delimiter;
+        Size = info.Size;
+    }
+
+    /// <summary>
+    /// Opens the specified file with fields in <paramref name="encoding" />, without indexing any of it yet.
+    /// A byte order mark at the start of the file is skipped.
+    /// </summary>
+    /// <param name="delimiter">The delimiter between fields, or <c>'\0'</c> to infer it from the first rows.</param>
+    /// <returns>
+    /// The <see cref="NativeCsvTable" />, or <see langword="null" /> if the file cannot be opened, ASCII characters
+    /// can be part of other characters in <paramref name="encoding" />, or the native index is not available.
+    /// </returns>
+    public static NativeCsvTable Open(string path, Encoding encoding, char delimiter)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+        _ = encoding ?? throw new ArgumentNullException(nameof(encoding));
+
+        // the index looks for quotes and line feeds byte by byte
+        if (_unavailable || delimiter > 0x7F || encoding is not UTF8Encoding && !encoding.IsSingleByte)
+            return null;
+
+        try
+        {
+            var start = PreambleLength(path, encoding);
+            var handle = IsArm64 ? CsvOpen_arm64(path, start, delimiter)
+                : Is64Bit ? CsvOpen_64(path, start, delimiter) : CsvOpen_32(path, start, delimiter);
+            if (handle == 0)
+                return null;
+
+            if (GetInfo(handle, out var info))
+                return new NativeCsvTable(handle, encoding, info);
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Counts the row ends in the next <paramref name="bytes" /> bytes of the file. Can run on another thread than the
+    /// other members, but on only one at a time.
+    /// </summary>
+    /// <returns><see langword="false" /> once the whole file is indexed, or if it cannot be read.</returns>
+    public bool Build(uint bytes)
+    {
+        var handle = ThrowIfDisposed();
+        return IsArm64 ? CsvBuild_arm64(handle, bytes)
+            : Is64Bit ? CsvBuild_64(handle, bytes) : CsvBuild_32(handle, bytes);
+    }
+
+    /// <summary>
+    /// Splits up to <paramref name="count" /> rows from <paramref name="firstRow" /> on into their first
+    /// <paramref name="maxFields" /> fields. Rows past what is indexed so far are left out.
+    /// </summary>
+    public string[][] ReadRows(ulong firstRow, int count, int maxFields)
+    {
+        var handle = ThrowIfDisposed();
+        if (count <= 0 || maxFields <= 0)
+            return [];
+
+        if (_starts.Length < count + 1)
+            _starts = new ulong[count + 1];
+        if (_fieldEnds.Length < maxFields)
+            _fieldEnds = new uint[maxFields];
+
+        var found = (int)(IsArm64 ? CsvGetRows_arm64(handle, firstRow, (uint)count, _starts)
+            : Is64Bit ? CsvGetRows_64(handle, firstRow, (uint)count, _starts)
+            : CsvGetRows_32(handle, firstRow, (uint)count, _starts));
+
+        var rows = new string[found][];
+        for (var i = 0; i < found; i++)
+        {
+            var fields = (int)(IsArm64
+                ? CsvReadRow_arm64(handle, _starts[i], _starts[i + 1], _text, RowCapacity, _fieldEnds, (uint)maxFields)
+                : Is64Bit
+                    ? CsvReadRow_64(handle, _starts[i], _starts[i + 1], _text, RowCapacity, _fieldEnds, (uint)maxFields)
+                    : CsvReadRow_32(handle, _starts[i], _starts[i + 1], _text, RowCapacity, _fieldEnds, (uint)maxFields));
+
+            var row = new string[fields];
+            for (int field = 0, start = 0; field < fields; start = (int)_fieldEnds[field++])
+                row[field] = Encoding.GetString(_text, start, (int)_fieldEnds[field] - start);
+            rows[i] = row;
+        }
+        return rows;
+    }
+
+    /// <summary>
+    /// Finds the row that the byte at <paramref name="offset" /> is in, for turning search matches into rows.
+    /// </summary>
+    /// <returns>The row, or <see langword="null" /> if <paramref name="offset" /> is not indexed yet.</returns>
+    public ulong? RowOf(ulong offset)
+    {
+        var handle = ThrowIfDisposed();
+        var found = IsArm64 ? CsvFindRow_arm64(handle, offset, out var row)
+            : Is64Bit ? CsvFindRow_64(handle, offset, out row) : CsvFindRow_32(handle, offset, out row);
+        return found ? row : null;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private CsvInfo GetInfo()
+    {
+        var handle = ThrowIfDisposed();
+        return GetInfo(handle, out var info) ? info : default;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeCsvTable));
+    }
+
+    private static uint PreambleLength(string path, Encoding encoding)
+    {
+        var preamble = encoding.GetPreamble();
+        if (preamble.Length == 0)
+            return 0;
+
+        using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete);
+        var head = new byte[preamble.Length];
+        var read = stream.Read(head, 0, head.Length);
+        return read == head.Length && head.SequenceEqual(preamble) ? (uint)head.Length : 0;
+    }
+
+    private static bool GetInfo(nint handle, out CsvInfo info)
+    {
+        return IsArm64 ? CsvGetInfo_arm64(handle, out info)
+            : Is64Bit ? CsvGetInfo_64(handle, out info) : CsvGetInfo_32(handle, out info);
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            CsvClose_arm64(handle);
+        else if (Is64Bit)
+            CsvClose_64(handle);
+        else
+            CsvClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint CsvOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path, ulong start, uint delimiter);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CsvClose_32(nint table);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvGetInfo_32(nint table, out CsvInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvBuild_32(nint table, uint bytes);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvGetRows", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CsvGetRows_32(nint table, ulong firstRow, uint count, [Out] ulong[] starts);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvFindRow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvFindRow_32(nint table, ulong offset, out ulong row);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "CsvReadRow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CsvReadRow_32(nint table, ulong offset, ulong end, [Out] byte[] text, uint capacity, [Out] uint[] fieldEnds, uint maxFields);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint CsvOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path, ulong start, uint delimiter);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CsvClose_64(nint table);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvGetInfo_64(nint table, out CsvInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvBuild_64(nint table, uint bytes);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvGetRows", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CsvGetRows_64(nint table, ulong firstRow, uint count, [Out] ulong[] starts);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvFindRow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvFindRow_64(nint table, ulong offset, out ulong row);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "CsvReadRow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CsvReadRow_64(nint table, ulong offset, ulong end, [Out] byte[] text, uint capacity, [Out] uint[] fieldEnds, uint maxFields);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint CsvOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path, ulong start, uint delimiter);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CsvClose_arm64(nint table);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvGetInfo_arm64(nint table, out CsvInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvBuild_arm64(nint table, uint bytes);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvGetRows", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CsvGetRows_arm64(nint table, ulong firstRow, uint count, [Out] ulong[] starts);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvFindRow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool CsvFindRow_arm64(nint table, ulong offset, out ulong row);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "CsvReadRow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint CsvReadRow_arm64(nint table, ulong offset, ulong end, [Out] byte[] text, uint capacity, [Out] uint[] fieldEnds, uint maxFields);
+
+    // Must match CsvTable::Info in QuickLook.Native/QuickLook.Native32/CsvTable.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct CsvInfo
+    {
+        public ulong Size;
+        public ulong Rows;
+        public ulong Indexed;
+        public uint Delimiter;
+    }
+}
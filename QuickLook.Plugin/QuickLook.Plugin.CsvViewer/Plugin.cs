@@ -66,6 +66,7 @@ public sealed partial class Plugin : IViewer, IMoreMenu
     {
         GC.SuppressFinalize(this);
 
+        _panel?.Dispose();
         _panel = null;
     }
 }
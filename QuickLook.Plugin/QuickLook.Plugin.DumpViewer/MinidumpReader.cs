@@ -15,6 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+using QuickLook.Common.Helpers;
 using System;
 using System.Collections.Generic;
 using System.IO;
@@ -33,6 +34,9 @@ internal static class MinidumpReader
 
     public static bool IsMinidump(string path)
     {
+        if (ContentTypeHelper.Is(path, "application/x-dmp") is { } sniffed)
+            return sniffed;
+
         try
         {
             if (!File.Exists(path))
@@ -62,20 +66,14 @@ internal static class MinidumpReader
 
         try
         {
-            using var stream = OpenRead(path);
-            using var reader = new BinaryReader(stream, Encoding.UTF8, leaveOpen: false);
-
-            var header = ReadHeader(reader, stream.Length);
-            info.TimeStamp = UnixTimeToLocalTime(header.TimeDateStamp);
+            // the native reader maps the file and only looks at the directory and the streams shown here;
+            // it is unavailable if the dump does not fit into the address space of a 32-bit process
+            using var image = NativeMinidump.Open(path);
+            if (image != null)
+                ReadWithNativeReader(info, image);
+            else
+                ReadWithStream(info, path);
 
-            var directories = ReadDirectories(reader, stream.Length, header)
-                .GroupBy(i => i.Type)
-                .ToDictionary(i => i.Key, i => i.First());
-
-            ReadSystemInfo(info, reader, stream.Length, directories);
-            ReadExceptionInfo(info, reader, stream.Length, directories);
-            ReadModules(info, reader, stream.Length, directories);
-            ReadSupplementalStreamInfo(info, directories);
             ReadClrVersions(info);
         }
         catch (Exception ex)
@@ -86,6 +84,50 @@ internal static class MinidumpReader
         return info;
     }
 
+    private static void ReadWithNativeReader(DumpInfo info, NativeMinidump image)
+    {
+        info.TimeStamp = UnixTimeToLocalTime(image.TimeDateStamp);
+
+        if (image.GetSystemInfo() is { } systemInfo)
+        {
+            info.Architecture = ToProcessorArchitectureName(systemInfo.ProcessorArchitecture);
+            info.OSVersion = $"{systemInfo.MajorVersion}.{systemInfo.MinorVersion}.{systemInfo.BuildNumber}";
+        }
+
+        if (image.GetException() is { } exception)
+        {
+            info.ExceptionCode = FormatExceptionCode(exception.Code);
+            info.ExceptionInformation = $"Thread {exception.ThreadId}, 0x{exception.Address:X}";
+            info.HasErrorInformation = true;
+        }
+
+        foreach (var module in image.GetModules())
+            info.Modules.Add(CreateModule(module.Path, module.BaseAddress, module.Size, FormatVersion(module.FileVersionMs, module.FileVersionLs)));
+
+        info.ProcessPath = info.Modules.FirstOrDefault()?.Path;
+
+        var streams = new HashSet<MinidumpStreamType>(image.GetStreamTypes().Select(i => (MinidumpStreamType)i));
+        ReadSupplementalStreamInfo(info, streams);
+    }
+
+    private static void ReadWithStream(DumpInfo info, string path)
+    {
+        using var stream = OpenRead(path);
+        using var reader = new BinaryReader(stream, Encoding.UTF8, leaveOpen: false);
+
+        var header = ReadHeader(reader, stream.Length);
+        info.TimeStamp = UnixTimeToLocalTime(header.TimeDateStamp);
+
+        var directories = ReadDirectories(reader, stream.Length, header)
+            .GroupBy(i => i.Type)
+            .ToDictionary(i => i.Key, i => i.First());
+
+        ReadSystemInfo(info, reader, stream.Length, directories);
+        ReadExceptionInfo(info, reader, stream.Length, directories);
+        ReadModules(info, reader, stream.Length, directories);
+        ReadSupplementalStreamInfo(info, directories.Keys);
+    }
+
     private static FileStream OpenRead(string path)
     {
         return new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete);
@@ -217,43 +259,49 @@ internal static class MinidumpReader
 
             reader.BaseStream.Position = moduleOffset;
 
-            var module = new DumpModuleInfo
-            {
-                BaseAddress = reader.ReadUInt64(),
-                Size = reader.ReadUInt32(),
-            };
+            var baseAddress = reader.ReadUInt64();
+            var size = reader.ReadUInt32();
 
             reader.BaseStream.Position = moduleOffset + 20;
             var moduleNameRva = reader.ReadUInt32();
 
-            module.Path = ReadMinidumpString(reader, fileLength, moduleNameRva);
-            module.Name = Path.GetFileName(module.Path);
-            if (string.IsNullOrEmpty(module.Name))
-                module.Name = module.Path;
+            var modulePath = ReadMinidumpString(reader, fileLength, moduleNameRva);
 
             reader.BaseStream.Position = moduleOffset + 24;
-            module.Version = ReadVersion(reader);
+            var version = ReadVersion(reader);
 
-            info.Modules.Add(module);
+            info.Modules.Add(CreateModule(modulePath, baseAddress, size, version));
         }
 
         info.ProcessPath = info.Modules.FirstOrDefault()?.Path;
     }
 
-    private static void ReadSupplementalStreamInfo(
-        DumpInfo info,
-        IReadOnlyDictionary<MinidumpStreamType, MinidumpDirectory> directories)
+    private static DumpModuleInfo CreateModule(string modulePath, ulong baseAddress, uint size, string version)
+    {
+        var name = Path.GetFileName(modulePath);
+
+        return new DumpModuleInfo
+        {
+            BaseAddress = baseAddress,
+            Size = size,
+            Path = modulePath,
+            Name = string.IsNullOrEmpty(name) ? modulePath : name,
+            Version = version,
+        };
+    }
+
+    private static void ReadSupplementalStreamInfo(DumpInfo info, ICollection<MinidumpStreamType> streams)
     {
         info.HasHeapInformation =
-            directories.ContainsKey(MinidumpStreamType.MemoryListStream)
-            || directories.ContainsKey(MinidumpStreamType.Memory64ListStream)
-            || directories.ContainsKey(MinidumpStreamType.MemoryInfoListStream)
-            || directories.ContainsKey(MinidumpStreamType.SystemMemoryInfoStream);
+            streams.Contains(MinidumpStreamType.MemoryListStream)
+            || streams.Contains(MinidumpStreamType.Memory64ListStream)
+            || streams.Contains(MinidumpStreamType.MemoryInfoListStream)
+            || streams.Contains(MinidumpStreamType.SystemMemoryInfoStream);
 
         info.HasErrorInformation =
             info.HasErrorInformation
-            || directories.ContainsKey(MinidumpStreamType.HandleOperationListStream)
-            || directories.ContainsKey(MinidumpStreamType.ProcessVmCountersStream);
+            || streams.Contains(MinidumpStreamType.HandleOperationListStream)
+            || streams.Contains(MinidumpStreamType.ProcessVmCountersStream);
     }
 
     private static void ReadClrVersions(DumpInfo info)
@@ -304,7 +352,12 @@ internal static class MinidumpReader
         var fileVersionMs = reader.ReadUInt32();
         var fileVersionLs = reader.ReadUInt32();
 
-        if (signature != VsFixedFileInfoSignature || (fileVersionMs == 0 && fileVersionLs == 0))
+        return signature == VsFixedFileInfoSignature ? FormatVersion(fileVersionMs, fileVersionLs) : string.Empty;
+    }
+
+    private static string FormatVersion(uint fileVersionMs, uint fileVersionLs)
+    {
+        if (fileVersionMs == 0 && fileVersionLs == 0)
             return string.Empty;
 
         return $"{HiWord(fileVersionMs)}.{LoWord(fileVersionMs)}.{HiWord(fileVersionLs)}.{LoWord(fileVersionLs)}";
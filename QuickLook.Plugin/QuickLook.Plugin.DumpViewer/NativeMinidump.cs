@@ -0,0 +1,431 @@
+// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+
+namespace QuickLook.Plugin.DumpViewer;
+
+/// <summary>
+/// Minidump that is read in place by the memory-mapped parser of QuickLook.Native.
+/// Opening a dump touches only its header and stream directory; the other streams are decoded when they are asked for
+/// and memory lists are never read, so the size of a full-memory dump does not matter.
+/// </summary>
+internal sealed class NativeMinidump : IDisposable
+{
+    private const int PageSize = 256;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private readonly MinidumpInfo _info;
+
+    public uint TimeDateStamp => _info.TimeDateStamp;
+
+    private NativeMinidump(nint handle, MinidumpInfo info)
+    {
+        _handle = handle;
+        _info = info;
+    }
+
+    /// <summary>
+    /// Maps the specified file and reads its stream directory.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeMinidump" />, or <see langword="null" /> if the file is not a minidump, does not fit into the
+    /// address space of this process, or the native parser is not available.
+    /// </returns>
+    public static NativeMinidump Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? MinidumpOpen_arm64(path) : Is64Bit ? MinidumpOpen_64(path) : MinidumpOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? MinidumpGetInfo_arm64(handle, out var info)
+                : Is64Bit ? MinidumpGetInfo_64(handle, out info) : MinidumpGetInfo_32(handle, out info);
+            if (ok)
+                return new NativeMinidump(handle, info);
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Enumerates the types of the streams which lie completely inside the file.
+    /// </summary>
+    public IEnumerable<uint> GetStreamTypes()
+    {
+        var page = new NativeStream[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? MinidumpReadStreams_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? MinidumpReadStreams_64(ThrowIfDisposed(), start, page, PageSize)
+                : MinidumpReadStreams_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+            {
+                if (page[i].InFile != 0)
+                    yield return page[i].Type;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Reads the system info stream, or returns <see langword="null" /> if the dump has none.
+    /// </summary>
+    public MinidumpSystemInfo GetSystemInfo()
+    {
+        var ok = IsArm64 ? MinidumpGetSystemInfo_arm64(ThrowIfDisposed(), out var info)
+            : Is64Bit ? MinidumpGetSystemInfo_64(ThrowIfDisposed(), out info)
+            : MinidumpGetSystemInfo_32(ThrowIfDisposed(), out info);
+        if (!ok)
+            return null;
+
+        return new MinidumpSystemInfo(
+            (ushort)info.ProcessorArchitecture,
+            info.NumberOfProcessors,
+            info.MajorVersion,
+            info.MinorVersion,
+            info.BuildNumber,
+            ToString(info.ServicePack, info.ServicePackLength));
+    }
+
+    /// <summary>
+    /// Reads the exception stream, or returns <see langword="null" /> if the dump has none.
+    /// </summary>
+    public MinidumpException GetException()
+    {
+        var ok = IsArm64 ? MinidumpGetException_arm64(ThrowIfDisposed(), out var exception)
+            : Is64Bit ? MinidumpGetException_64(ThrowIfDisposed(), out exception)
+            : MinidumpGetException_32(ThrowIfDisposed(), out exception);
+        if (!ok)
+            return null;
+
+        return new MinidumpException(exception.ThreadId, exception.Code, exception.Address);
+    }
+
+    /// <summary>
+    /// Enumerates the threads of the thread list (or extended thread list) stream.
+    /// </summary>
+    public IEnumerable<MinidumpThread> GetThreads()
+    {
+        var page = new NativeThread[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? MinidumpReadThreads_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? MinidumpReadThreads_64(ThrowIfDisposed(), start, page, PageSize)
+                : MinidumpReadThreads_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+                yield return new MinidumpThread(page[i].ThreadId, page[i].Teb, page[i].StackStart, page[i].StackSize);
+        }
+    }
+
+    /// <summary>
+    /// Enumerates the modules of the module list stream.
+    /// </summary>
+    public IEnumerable<MinidumpModule> GetModules()
+    {
+        var page = new NativeModule[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? MinidumpReadModules_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? MinidumpReadModules_64(ThrowIfDisposed(), start, page, PageSize)
+                : MinidumpReadModules_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+            {
+                yield return new MinidumpModule(
+                    ToString(page[i].Name, page[i].NameLength),
+                    page[i].BaseAddress,
+                    page[i].Size,
+                    page[i].FileVersionMs,
+                    page[i].FileVersionLs);
+            }
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private static string ToString(nint chars, uint length)
+    {
+        return chars != 0 ? Marshal.PtrToStringUni(chars, (int)length).TrimEnd('\0') : string.Empty;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeMinidump));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            MinidumpClose_arm64(handle);
+        else if (Is64Bit)
+            MinidumpClose_64(handle);
+        else
+            MinidumpClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint MinidumpOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void MinidumpClose_32(nint image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetInfo_32(nint image, out MinidumpInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpGetSystemInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetSystemInfo_32(nint image, out NativeSystemInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpGetException", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetException_32(nint image, out NativeException exception);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpReadStreams", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadStreams_32(nint image, uint start, [Out] NativeStream[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpReadThreads", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadThreads_32(nint image, uint start, [Out] NativeThread[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "MinidumpReadModules", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadModules_32(nint image, uint start, [Out] NativeModule[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint MinidumpOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void MinidumpClose_64(nint image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetInfo_64(nint image, out MinidumpInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpGetSystemInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetSystemInfo_64(nint image, out NativeSystemInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpGetException", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetException_64(nint image, out NativeException exception);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpReadStreams", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadStreams_64(nint image, uint start, [Out] NativeStream[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpReadThreads", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadThreads_64(nint image, uint start, [Out] NativeThread[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "MinidumpReadModules", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadModules_64(nint image, uint start, [Out] NativeModule[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint MinidumpOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void MinidumpClose_arm64(nint image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetInfo_arm64(nint image, out MinidumpInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpGetSystemInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetSystemInfo_arm64(nint image, out NativeSystemInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpGetException", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool MinidumpGetException_arm64(nint image, out NativeException exception);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpReadStreams", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadStreams_arm64(nint image, uint start, [Out] NativeStream[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpReadThreads", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadThreads_arm64(nint image, uint start, [Out] NativeThread[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "MinidumpReadModules", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint MinidumpReadModules_arm64(nint image, uint start, [Out] NativeModule[] entries, uint count);
+
+    // Must match MinidumpImage::Info in QuickLook.Native/QuickLook.Native32/MinidumpImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct MinidumpInfo
+    {
+        public uint Version;
+        public uint StreamCount;
+        public uint CheckSum;
+        public uint TimeDateStamp;
+        public ulong Flags;
+        public ulong FileSize;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeStream
+    {
+        public uint Type;
+        public uint Size;
+        public uint Rva;
+        public uint InFile;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeSystemInfo
+    {
+        public uint ProcessorArchitecture;
+        public uint ProcessorLevel;
+        public uint ProcessorRevision;
+        public uint NumberOfProcessors;
+        public uint ProductType;
+        public uint MajorVersion;
+        public uint MinorVersion;
+        public uint BuildNumber;
+        public uint PlatformId;
+        public uint SuiteMask;
+        public nint ServicePack;
+        public uint ServicePackLength;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeException
+    {
+        public uint ThreadId;
+        public uint Code;
+        public uint Flags;
+        public uint NumberParameters;
+        public ulong Record;
+        public ulong Address;
+
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 15)]
+        public ulong[] Parameters;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeThread
+    {
+        public uint ThreadId;
+        public uint SuspendCount;
+        public uint PriorityClass;
+        public uint Priority;
+        public ulong Teb;
+        public ulong StackStart;
+        public uint StackSize;
+        public uint ContextSize;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeModule
+    {
+        public ulong BaseAddress;
+        public uint Size;
+        public uint CheckSum;
+        public uint TimeDateStamp;
+        public uint NameLength;
+        public nint Name;
+        public uint FileVersionMs;
+        public uint FileVersionLs;
+        public uint ProductVersionMs;
+        public uint ProductVersionLs;
+    }
+}
+
+internal sealed class MinidumpSystemInfo(ushort processorArchitecture, uint numberOfProcessors, uint majorVersion, uint minorVersion, uint buildNumber, string servicePack)
+{
+    public ushort ProcessorArchitecture { get; } = processorArchitecture;
+
+    public uint NumberOfProcessors { get; } = numberOfProcessors;
+
+    public uint MajorVersion { get; } = majorVersion;
+
+    public uint MinorVersion { get; } = minorVersion;
+
+    public uint BuildNumber { get; } = buildNumber;
+
+    public string ServicePack { get; } = servicePack;
+}
+
+internal sealed class MinidumpException(uint threadId, uint code, ulong address)
+{
+    public uint ThreadId { get; } = threadId;
+
+    public uint Code { get; } = code;
+
+    public ulong Address { get; } = address;
+}
+
+internal sealed class MinidumpThread(uint threadId, ulong teb, ulong stackStart, uint stackSize)
+{
+    public uint ThreadId { get; } = threadId;
+
+    public ulong Teb { get; } = teb;
+
+    public ulong StackStart { get; } = stackStart;
+
+    public uint StackSize { get; } = stackSize;
+}
+
+internal sealed class MinidumpModule(string path, ulong baseAddress, uint size, uint fileVersionMs, uint fileVersionLs)
+{
+    public string Path { get; } = path;
+
+    public ulong BaseAddress { get; } = baseAddress;
+
+    public uint Size { get; } = size;
+
+    public uint FileVersionMs { get; } = fileVersionMs;
+
+    public uint FileVersionLs { get; } = fileVersionLs;
+}
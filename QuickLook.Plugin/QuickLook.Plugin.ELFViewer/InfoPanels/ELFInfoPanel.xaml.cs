@@ -49,9 +49,9 @@ public partial class ELFInfoPanel : UserControl, IInfoPanel
             if (File.Exists(path))
             {
                 var size = new FileInfo(path).Length;
-                var isElf = ELFReader.TryLoad(path, out var elf);
-                var arch = elf?.Machine.ToMachineName();
-                var typeLogo = elf?.Type switch
+                var (machine, type) = ReadHeader(path);
+                var arch = machine?.ToMachineName();
+                var typeLogo = type switch
                 {
                     FileType.Executable => "exec",
                     FileType.SharedObject => "dyn",
@@ -63,13 +63,29 @@ public partial class ELFInfoPanel : UserControl, IInfoPanel
                     architectureContainer.Visibility = string.IsNullOrEmpty(arch) ? System.Windows.Visibility.Collapsed : System.Windows.Visibility.Visible;
                     architecture.Text = arch;
                     format.Text = "ELF";
-                    formatProfile.Text = elf != null ? $"{elf.Type} / {elf.Machine}" : "NotELF";
+                    formatProfile.Text = machine != null ? $"{type} / {machine}" : "NotELF";
                     totalSize.Text = size.ToPrettySize(2);
                     image.Source = new BitmapImage(new Uri($"pack://application:,,,/QuickLook.Plugin.ELFViewer;component/Resources/{typeLogo}.png"));
                 });
             }
         });
     }
+
+    private static (Machine?, FileType?) ReadHeader(string path)
+    {
+        // The native reader maps the file and looks at the ELF header only
+        using (var native = NativeObjectImage.Open(path))
+        {
+            if (native != null)
+                return native.Format == ObjectFormat.ELF ? ((Machine)native.Machine, (FileType)native.Type) : (null, null);
+        }
+
+        if (!ELFReader.TryLoad(path, out var elf))
+            return (null, null);
+
+        using (elf)
+            return (elf.Machine, elf.Type);
+    }
 }
 
 file static class MachineTypeExtension
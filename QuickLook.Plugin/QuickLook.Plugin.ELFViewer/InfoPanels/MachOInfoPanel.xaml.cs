@@ -50,25 +50,9 @@ public partial class MachOInfoPanel : UserControl, IInfoPanel
             if (File.Exists(path))
             {
                 var size = new FileInfo(path).Length;
-                var tried = MachOReader.TryLoad(path, out MachO machO);
-                var arch = string.Empty;
-                var profile = string.Empty;
-
-                if (tried == MachOResult.OK)
-                {
-                    arch = machO.Machine.ToMachineName();
-                    profile = machO.Machine.ToString();
-                }
-                else if (tried == MachOResult.FatMachO)
-                {
-                    using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read);
-
-                    if (MachOReader.TryLoadFat(stream, shouldOwnStream: true, out var machOs) == MachOResult.FatMachO)
-                    {
-                        arch = string.Join(", ", machOs.Select(m => m.Machine.ToMachineName()).Distinct());
-                        profile = string.Join(", ", machOs.Select(m => m.Machine.ToString()).Distinct());
-                    }
-                }
+                var machines = ReadMachines(path);
+                var arch = string.Join(", ", machines.Select(m => m.ToMachineName()).Distinct());
+                var profile = string.Join(", ", machines.Select(m => m.ToString()).Distinct());
 
                 Dispatcher.Invoke(() =>
                 {
@@ -82,6 +66,38 @@ public partial class MachOInfoPanel : UserControl, IInfoPanel
             }
         });
     }
+
+    private static Machine[] ReadMachines(string path)
+    {
+        // The native reader only looks at the Mach-O header or the fat slice table
+        using (var native = NativeObjectImage.Open(path))
+        {
+            if (native != null)
+            {
+                return native.Format switch
+                {
+                    ObjectFormat.MachO => [(Machine)(int)native.Machine],
+                    ObjectFormat.FatMachO => native.GetSlices().Select(s => (Machine)(int)s.Machine).ToArray(),
+                    _ => [],
+                };
+            }
+        }
+
+        var tried = MachOReader.TryLoad(path, out MachO machO);
+
+        if (tried == MachOResult.OK)
+            return [machO.Machine];
+
+        if (tried == MachOResult.FatMachO)
+        {
+            using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read);
+
+            if (MachOReader.TryLoadFat(stream, shouldOwnStream: true, out var machOs) == MachOResult.FatMachO)
+                return machOs.Select(m => m.Machine).ToArray();
+        }
+
+        return [];
+    }
 }
 
 file static class MachineTypeExtension
@@ -50,19 +50,19 @@ public partial class UImageInfoPanel : UserControl, IInfoPanel
             if (File.Exists(path))
             {
                 var size = new FileInfo(path).Length;
-                var tried = UImageReader.TryLoad(path, out UImage uImage);
+                var tried = ReadHeader(path, out var header);
 
                 Dispatcher.Invoke(() =>
                 {
-                    var arch = tried == UImageResult.OK ? uImage.Architecture.ToMachineName() : string.Empty;
+                    var arch = tried == UImageResult.OK ? header.Architecture.ToMachineName() : string.Empty;
                     architectureContainer.Visibility = string.IsNullOrEmpty(arch) ? System.Windows.Visibility.Collapsed : System.Windows.Visibility.Visible;
 
                     if (tried == UImageResult.OK)
                     {
-                        imageName.Text = uImage.Name;
+                        imageName.Text = header.Name;
                         architecture.Text = arch;
-                        format.Text = $"UImage - {uImage.OperatingSystem} / {uImage.Compression}";
-                        formatProfile.Text = $"{uImage.Type} / {uImage.Architecture}";
+                        format.Text = $"UImage - {header.OperatingSystem} / {header.Compression}";
+                        formatProfile.Text = $"{header.Type} / {header.Architecture}";
                     }
                     else
                     {
@@ -78,6 +78,30 @@ public partial class UImageInfoPanel : UserControl, IInfoPanel
             }
         });
     }
+
+    private static UImageResult ReadHeader(string path, out (string Name, Architecture Architecture, OS OperatingSystem, CompressionType Compression, ImageType Type) header)
+    {
+        // Like ELFSharp, both checksums are verified here; the native reader does it without loading the file
+        using (var native = NativeObjectImage.Open(path))
+        {
+            if (native != null)
+            {
+                header = (native.Name, (Architecture)native.Machine, (OS)native.OperatingSystem,
+                          (CompressionType)native.Compression, (ImageType)native.Type);
+
+                if (native.Format != ObjectFormat.UImage)
+                    return UImageResult.NotUImage;
+
+                return native.HeaderValid && native.VerifyPayload() ? UImageResult.OK : UImageResult.BadChecksum;
+            }
+        }
+
+        var tried = UImageReader.TryLoad(path, out UImage uImage);
+        header = tried == UImageResult.OK
+            ? (uImage.Name, uImage.Architecture, uImage.OperatingSystem, uImage.Compression, uImage.Type)
+            : default;
+        return tried;
+    }
 }
 
 file static class MachineTypeExtension
@@ -0,0 +1,584 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+
+namespace QuickLook.Plugin.ELFViewer;
+
+/// <summary>
+/// ELF, Mach-O or uImage file whose headers are read in place by the memory-mapped parser of QuickLook.Native.
+/// Opening a file touches only its headers; program headers, sections, symbols, dynamic entries and slices are read page by page
+/// while they are enumerated, and the uImage payload only by <see cref="VerifyPayload" />.
+/// </summary>
+public sealed class NativeObjectImage : IDisposable
+{
+    private const int PageSize = 256;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private ObjectImageInfo _info;
+
+    /// <summary>
+    /// Gets a value indicating whether the native parser could be loaded. It is assumed to be until a call fails.
+    /// </summary>
+    public static bool IsAvailable => !_unavailable;
+
+    public ObjectFormat Format => (ObjectFormat)_info.Format;
+
+    public bool Is64BitImage => _info.Is64Bit != 0;
+
+    public bool IsBigEndian => _info.BigEndian != 0;
+
+    /// <summary>
+    /// Gets the ELF e_machine, the Mach-O cputype or the uImage architecture.
+    /// </summary>
+    public uint Machine => _info.Machine;
+
+    /// <summary>
+    /// Gets the ELF e_type, the Mach-O filetype or the uImage image type.
+    /// </summary>
+    public uint Type => _info.Type;
+
+    /// <summary>
+    /// Gets the ELF OS ABI or the uImage operating system.
+    /// </summary>
+    public uint OperatingSystem => _info.OS;
+
+    /// <summary>
+    /// Gets the uImage compression type.
+    /// </summary>
+    public uint Compression => _info.Flags;
+
+    public ulong EntryPoint => _info.Entry;
+
+    /// <summary>
+    /// Gets a value indicating whether the uImage header checksum matches. See <see cref="VerifyPayload" /> for the payload.
+    /// </summary>
+    public bool HeaderValid => _info.HeaderValid != 0;
+
+    /// <summary>
+    /// Gets the uImage name.
+    /// </summary>
+    public string Name => _info.Name != 0 ? Marshal.PtrToStringAnsi(_info.Name, (int)_info.NameLength) : null;
+
+    public int SectionCount => (int)_info.SectionCount;
+
+    private NativeObjectImage(nint handle, ObjectImageInfo info)
+    {
+        _handle = handle;
+        _info = info;
+    }
+
+    /// <summary>
+    /// Maps the specified file and parses its headers.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeObjectImage" />, or <see langword="null" /> if the file is none of the supported formats or the native parser is not available.
+    /// </returns>
+    public static NativeObjectImage Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? ObjectOpen_arm64(path) : Is64Bit ? ObjectOpen_64(path) : ObjectOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? ObjectGetInfo_arm64(handle, out var info)
+                : Is64Bit ? ObjectGetInfo_64(handle, out info) : ObjectGetInfo_32(handle, out info);
+            if (ok)
+                return new NativeObjectImage(handle, info);
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Enumerates the architecture slices of a fat Mach-O file.
+    /// </summary>
+    public IEnumerable<ObjectSlice> GetSlices()
+    {
+        var page = new NativeSlice[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? ObjectReadSlices_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? ObjectReadSlices_64(ThrowIfDisposed(), start, page, PageSize)
+                : ObjectReadSlices_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+                yield return new ObjectSlice(page[i].Machine, page[i].SubMachine, page[i].Offset, page[i].Size);
+        }
+    }
+
+    /// <summary>
+    /// Re-targets a fat Mach-O file at one of its slices, which then reads like a thin Mach-O file.
+    /// </summary>
+    public bool SelectSlice(int index)
+    {
+        var ok = IsArm64 ? ObjectSelectSlice_arm64(ThrowIfDisposed(), (uint)index)
+            : Is64Bit ? ObjectSelectSlice_64(ThrowIfDisposed(), (uint)index)
+            : ObjectSelectSlice_32(ThrowIfDisposed(), (uint)index);
+        if (!ok)
+            return false;
+
+        _ = IsArm64 ? ObjectGetInfo_arm64(_handle, out _info)
+            : Is64Bit ? ObjectGetInfo_64(_handle, out _info) : ObjectGetInfo_32(_handle, out _info);
+        return true;
+    }
+
+    /// <summary>
+    /// Checks the uImage payload against the data checksum in its header, which reads the whole file.
+    /// </summary>
+    /// <returns><see langword="false" /> if the payload is corrupt or truncated; <see langword="true" /> for the other formats.</returns>
+    public bool VerifyPayload()
+    {
+        return IsArm64 ? ObjectVerifyPayload_arm64(ThrowIfDisposed())
+            : Is64Bit ? ObjectVerifyPayload_64(ThrowIfDisposed()) : ObjectVerifyPayload_32(ThrowIfDisposed());
+    }
+
+    /// <summary>
+    /// Enumerates the ELF program headers or the Mach-O load commands, reading them lazily.
+    /// </summary>
+    public IEnumerable<ObjectProgramHeader> GetProgramHeaders()
+    {
+        var page = new NativeProgramHeader[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? ObjectReadProgramHeaders_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? ObjectReadProgramHeaders_64(ThrowIfDisposed(), start, page, PageSize)
+                : ObjectReadProgramHeaders_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+            {
+                var name = page[i].Name != 0 ? Marshal.PtrToStringAnsi(page[i].Name, (int)page[i].NameLength) : null;
+                yield return new ObjectProgramHeader(page[i].Type, page[i].Flags, page[i].Offset, page[i].Address,
+                    page[i].FileSize, page[i].MemorySize, name);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Enumerates the sections, reading the section headers lazily.
+    /// </summary>
+    public IEnumerable<ObjectSection> GetSections()
+    {
+        var page = new NativeSection[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? ObjectReadSections_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? ObjectReadSections_64(ThrowIfDisposed(), start, page, PageSize)
+                : ObjectReadSections_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+            {
+                var name = page[i].Name != 0 ? Marshal.PtrToStringAnsi(page[i].Name, (int)page[i].NameLength) : null;
+                var segment = page[i].SegmentName != 0 ? Marshal.PtrToStringAnsi(page[i].SegmentName, (int)page[i].SegmentNameLength) : null;
+                yield return new ObjectSection(name, segment, page[i].Type, page[i].Address, page[i].Offset, page[i].Size);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Enumerates the symbols of .symtab and .dynsym (ELF) or LC_SYMTAB (Mach-O), reading the tables lazily.
+    /// </summary>
+    public IEnumerable<ObjectSymbol> GetSymbols()
+    {
+        var cursor = new SymbolCursor();
+        var page = new NativeSymbol[PageSize];
+
+        while (true)
+        {
+            var count = IsArm64 ? ObjectReadSymbols_arm64(ThrowIfDisposed(), ref cursor, page, PageSize)
+                : Is64Bit ? ObjectReadSymbols_64(ThrowIfDisposed(), ref cursor, page, PageSize)
+                : ObjectReadSymbols_32(ThrowIfDisposed(), ref cursor, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            for (var i = 0; i < count; i++)
+                yield return new ObjectSymbol(Marshal.PtrToStringAnsi(page[i].Name), page[i].Value, page[i].Size, page[i].Type, page[i].Section);
+        }
+    }
+
+    /// <summary>
+    /// Enumerates the DT_NEEDED libraries of an ELF file.
+    /// </summary>
+    public IEnumerable<string> GetNeededLibraries()
+    {
+        const long DT_NEEDED = 1;
+
+        foreach (var entry in GetDynamicEntries())
+            if (entry.Tag == DT_NEEDED && entry.String != null)
+                yield return entry.String;
+    }
+
+    /// <summary>
+    /// Enumerates the entries of the ELF dynamic section up to DT_NULL, reading them lazily.
+    /// </summary>
+    public IEnumerable<ObjectDynamicEntry> GetDynamicEntries()
+    {
+        var page = new NativeDynamicEntry[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? ObjectReadDynamic_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? ObjectReadDynamic_64(ThrowIfDisposed(), start, page, PageSize)
+                : ObjectReadDynamic_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+                yield return new ObjectDynamicEntry(page[i].Tag, page[i].Value, page[i].String != 0 ? Marshal.PtrToStringAnsi(page[i].String) : null);
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeObjectImage));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            ObjectClose_arm64(handle);
+        else if (Is64Bit)
+            ObjectClose_64(handle);
+        else
+            ObjectClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ObjectOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ObjectClose_32(nint image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectGetInfo_32(nint image, out ObjectImageInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectSelectSlice", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectSelectSlice_32(nint image, uint index);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectVerifyPayload", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectVerifyPayload_32(nint image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectReadProgramHeaders", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadProgramHeaders_32(nint image, uint start, [Out] NativeProgramHeader[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectReadSections", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSections_32(nint image, uint start, [Out] NativeSection[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectReadDynamic", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadDynamic_32(nint image, uint start, [Out] NativeDynamicEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectReadSymbols", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSymbols_32(nint image, ref SymbolCursor cursor, [Out] NativeSymbol[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ObjectReadSlices", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSlices_32(nint image, uint start, [Out] NativeSlice[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ObjectOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ObjectClose_64(nint image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectGetInfo_64(nint image, out ObjectImageInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectSelectSlice", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectSelectSlice_64(nint image, uint index);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectVerifyPayload", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectVerifyPayload_64(nint image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectReadProgramHeaders", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadProgramHeaders_64(nint image, uint start, [Out] NativeProgramHeader[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectReadSections", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSections_64(nint image, uint start, [Out] NativeSection[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectReadDynamic", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadDynamic_64(nint image, uint start, [Out] NativeDynamicEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectReadSymbols", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSymbols_64(nint image, ref SymbolCursor cursor, [Out] NativeSymbol[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ObjectReadSlices", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSlices_64(nint image, uint start, [Out] NativeSlice[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ObjectOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ObjectClose_arm64(nint image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectGetInfo_arm64(nint image, out ObjectImageInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectSelectSlice", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectSelectSlice_arm64(nint image, uint index);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectVerifyPayload", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ObjectVerifyPayload_arm64(nint image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectReadProgramHeaders", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadProgramHeaders_arm64(nint image, uint start, [Out] NativeProgramHeader[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectReadSections", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSections_arm64(nint image, uint start, [Out] NativeSection[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectReadDynamic", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadDynamic_arm64(nint image, uint start, [Out] NativeDynamicEntry[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectReadSymbols", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSymbols_arm64(nint image, ref SymbolCursor cursor, [Out] NativeSymbol[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ObjectReadSlices", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint ObjectReadSlices_arm64(nint image, uint start, [Out] NativeSlice[] entries, uint count);
+
+    // Must match ObjectImage::Info in QuickLook.Native/QuickLook.Native32/ObjectImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ObjectImageInfo
+    {
+        public uint Format;
+        public uint Is64Bit;
+        public uint BigEndian;
+        public uint Machine;
+        public uint SubMachine;
+        public uint Type;
+        public uint OS;
+        public uint Flags;
+        public ulong Entry;
+        public uint ProgramHeaderCount;
+        public uint SectionCount;
+        public uint SliceCount;
+        public uint HeaderValid;
+        public nint Name;
+        public uint NameLength;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeProgramHeader
+    {
+        public uint Type;
+        public uint Flags;
+        public ulong Offset;
+        public ulong Address;
+        public ulong FileSize;
+        public ulong MemorySize;
+        public nint Name;
+        public uint NameLength;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeSection
+    {
+        public nint Name;
+        public uint NameLength;
+        public uint Type;
+        public ulong Flags;
+        public ulong Address;
+        public ulong Offset;
+        public ulong Size;
+        public nint SegmentName;
+        public uint SegmentNameLength;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeDynamicEntry
+    {
+        public long Tag;
+        public ulong Value;
+        public nint String;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeSymbol
+    {
+        public nint Name;
+        public ulong Value;
+        public ulong Size;
+        public uint Type;
+        public uint Section;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SymbolCursor
+    {
+        public uint Table;
+        public uint Index;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeSlice
+    {
+        public uint Machine;
+        public uint SubMachine;
+        public ulong Offset;
+        public ulong Size;
+    }
+}
+
+public enum ObjectFormat
+{
+    Unknown,
+    ELF,
+    MachO,
+    FatMachO,
+    UImage,
+}
+
+[DebuggerDisplay($"{nameof(ObjectSlice)}: Machine = {{Machine}}, Offset = {{Offset}}")]
+public sealed class ObjectSlice(uint machine, uint subMachine, ulong offset, ulong size)
+{
+    public uint Machine { get; } = machine;
+
+    public uint SubMachine { get; } = subMachine;
+
+    public ulong Offset { get; } = offset;
+
+    public ulong Size { get; } = size;
+}
+
+[DebuggerDisplay($"{nameof(ObjectProgramHeader)}: Type = {{Type}}, Offset = {{Offset}}")]
+public sealed class ObjectProgramHeader(uint type, uint flags, ulong offset, ulong address, ulong fileSize, ulong memorySize, string name)
+{
+    /// <summary>
+    /// Gets the ELF p_type or the Mach-O load command.
+    /// </summary>
+    public uint Type { get; } = type;
+
+    public uint Flags { get; } = flags;
+
+    public ulong Offset { get; } = offset;
+
+    public ulong Address { get; } = address;
+
+    public ulong FileSize { get; } = fileSize;
+
+    public ulong MemorySize { get; } = memorySize;
+
+    /// <summary>
+    /// Gets the Mach-O segment name, or <see langword="null" /> for ELF and for other load commands.
+    /// </summary>
+    public string Name { get; } = name;
+}
+
+[DebuggerDisplay($"{nameof(ObjectSection)}: Name = {{Name}}, Size = {{Size}}")]
+public sealed class ObjectSection(string name, string segmentName, uint type, ulong address, ulong offset, ulong size)
+{
+    public string Name { get; } = name;
+
+    /// <summary>
+    /// Gets the Mach-O segment the section belongs to, or <see langword="null" /> for ELF.
+    /// </summary>
+    public string SegmentName { get; } = segmentName;
+
+    public uint Type { get; } = type;
+
+    public ulong Address { get; } = address;
+
+    public ulong Offset { get; } = offset;
+
+    public ulong Size { get; } = size;
+}
+
+[DebuggerDisplay($"{nameof(ObjectSymbol)}: Name = {{Name}}, Value = {{Value}}")]
+public sealed class ObjectSymbol(string name, ulong value, ulong size, uint type, uint section)
+{
+    public string Name { get; } = name;
+
+    public ulong Value { get; } = value;
+
+    public ulong Size { get; } = size;
+
+    /// <summary>
+    /// Gets the ELF st_info or the Mach-O n_type.
+    /// </summary>
+    public uint Type { get; } = type;
+
+    /// <summary>
+    /// Gets the ELF st_shndx or the Mach-O n_sect.
+    /// </summary>
+    public uint Section { get; } = section;
+}
+
+[DebuggerDisplay($"{nameof(ObjectDynamicEntry)}: Tag = {{Tag}}, Value = {{Value}}")]
+public sealed class ObjectDynamicEntry(long tag, ulong value, string text)
+{
+    public long Tag { get; } = tag;
+
+    public ulong Value { get; } = value;
+
+    /// <summary>
+    /// Gets the string DT_NEEDED, DT_SONAME, DT_RPATH and DT_RUNPATH point at, or <see langword="null" /> for the other tags.
+    /// </summary>
+    public string String { get; } = text;
+}
@@ -18,6 +18,7 @@
 using ELFSharp.ELF;
 using ELFSharp.MachO;
 using ELFSharp.UImage;
+using QuickLook.Common.Helpers;
 using QuickLook.Common.Plugin;
 using QuickLook.Plugin.ELFViewer.InfoPanels;
 using System;
@@ -105,7 +106,7 @@ public sealed class Plugin : IViewer
         }
         else if (pathLower.Equals("uimage"))
         {
-            if (UImageReader.TryLoad(path, out _) == UImageResult.OK)
+            if (IsUImage(path))
                 return FileEnum.UImage;
         }
 
@@ -116,7 +117,7 @@ public sealed class Plugin : IViewer
         }
         else if (extension == string.Empty)
         {
-            if (MachOReader.TryLoad(path, out _) != MachOResult.NotMachO)
+            if (IsMachO(path))
                 return FileEnum.MachO;
         }
 
@@ -209,6 +210,36 @@ public sealed class Plugin : IViewer
         }
     }
 
+    /// <summary>
+    /// Uses the native reader, which maps the file and reads its header only, before falling back to ELFSharp,
+    /// which loads the whole image. The payload checksum is left to <see cref="UImageInfoPanel" />, so a corrupt payload
+    /// is still previewed and reported there.
+    /// </summary>
+    private static bool IsUImage(string path)
+    {
+        using (var image = NativeObjectImage.Open(path))
+        {
+            if (image != null || NativeObjectImage.IsAvailable)
+                return image is { Format: ObjectFormat.UImage, HeaderValid: true };
+        }
+
+        return UImageReader.TryLoad(path, out _) == UImageResult.OK;
+    }
+
+    private static bool IsMachO(string path)
+    {
+        if (ContentTypeHelper.Is(path, "application/x-mach-binary") is { } sniffed)
+            return sniffed;
+
+        using (var image = NativeObjectImage.Open(path))
+        {
+            if (image != null || NativeObjectImage.IsAvailable)
+                return image is { Format: ObjectFormat.MachO or ObjectFormat.FatMachO };
+        }
+
+        return MachOReader.TryLoad(path, out _) != MachOResult.NotMachO;
+    }
+
     private enum FileEnum
     {
         None,
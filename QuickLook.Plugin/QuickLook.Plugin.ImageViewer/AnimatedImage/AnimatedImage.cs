@@ -56,7 +56,7 @@ public class AnimatedImage : Image, IDisposable
 
         var provider = type.CreateInstance<AnimationProvider>(path, meta, contextObject);
 
-        return provider;
+        return CachedAnimationProvider.CanCache(provider) ? new CachedAnimationProvider(provider) : provider;
     }
 
     public static readonly DependencyProperty AnimationFrameIndexProperty =
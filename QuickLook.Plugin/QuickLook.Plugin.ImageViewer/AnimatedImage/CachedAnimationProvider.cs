@@ -0,0 +1,94 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System.Threading.Tasks;
+using System.Windows;
+using System.Windows.Media.Imaging;
+
+namespace QuickLook.Plugin.ImageViewer.AnimatedImage;
+
+/// <summary>
+/// Serves the images of a still image provider from <see cref="NativeImageCache" /> and puts what the provider decodes
+/// there. Animated images are left alone: their providers compose each frame onto the one before, so they have to
+/// see every frame.
+/// </summary>
+internal sealed class CachedAnimationProvider : AnimationProvider
+{
+    private readonly AnimationProvider _provider;
+
+    public CachedAnimationProvider(AnimationProvider provider)
+        : base(provider.Path, provider.Meta, provider.ContextObject)
+    {
+        _provider = provider;
+        Animator = provider.Animator;
+    }
+
+    public static bool CanCache(AnimationProvider provider)
+    {
+        return NativeImageCache.IsAvailable && provider.Path.IsFile && provider.Animator is not { KeyFrames.Count: > 1 };
+    }
+
+    // The tasks of the provider are created in any case, since a provider with nothing to show returns none instead, but
+    // they only run when the cache misses.
+
+    public override Task<BitmapSource> GetThumbnail(Size renderSize)
+    {
+        var task = _provider.GetThumbnail(renderSize);
+        if (task == null)
+            return null;
+
+        var path = Path.LocalPath;
+        return new Task<BitmapSource>(() =>
+        {
+            // the full frame beats any thumbnail, it is there if the image was shown until it finished decoding
+            var rendering = ImageRendering.Current(ContextObject);
+            var cached = NativeImageCache.GetFrame(path, 0, rendering) ??
+                         NativeImageCache.GetThumbnail(path, renderSize, rendering);
+            if (cached != null)
+                return cached;
+
+            task.RunSynchronously();
+            NativeImageCache.PutThumbnail(path, renderSize, rendering, task.Result);
+            return task.Result;
+        });
+    }
+
+    public override Task<BitmapSource> GetRenderedFrame(int index)
+    {
+        var task = _provider.GetRenderedFrame(index);
+        if (task == null)
+            return null;
+
+        var path = Path.LocalPath;
+        return new Task<BitmapSource>(() =>
+        {
+            var rendering = ImageRendering.Current(ContextObject);
+            var cached = NativeImageCache.GetFrame(path, index, rendering);
+            if (cached != null)
+                return cached;
+
+            task.RunSynchronously();
+            NativeImageCache.PutFrame(path, index, rendering, task.Result);
+            return task.Result;
+        });
+    }
+
+    public override void Dispose()
+    {
+        _provider.Dispose();
+    }
+}
@@ -0,0 +1,340 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using QuickLook.Common.Helpers;
+using QuickLook.Common.Plugin;
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Windows;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
+
+namespace QuickLook.Plugin.ImageViewer.AnimatedImage;
+
+/// <summary>
+/// Decoded images kept by QuickLook.Native for the whole process, so that an image which was previewed a moment ago
+/// shows up again without being decoded. Images are keyed by path, by what was decoded, by the display scale and colour
+/// profile it was rendered for and by the size and write time of the file, and all of them together stay within a
+/// memory budget; the least recently shown go first.
+/// Does nothing when the native library is not available.
+/// </summary>
+internal static class NativeImageCache
+{
+    private const uint Thumbnail = 0;
+    private const uint Frame = 1;
+
+    // the index into this table is what the native cache stores as the format; other formats are converted
+    private static readonly PixelFormat[] Formats =
+    [
+        PixelFormats.Pbgra32, PixelFormats.Bgra32, PixelFormats.Bgr32, PixelFormats.Bgr24, PixelFormats.Rgb24,
+        PixelFormats.Gray8, PixelFormats.Gray16, PixelFormats.Rgb48, PixelFormats.Rgba64, PixelFormats.Prgba64,
+        PixelFormats.Rgba128Float, PixelFormats.Prgba128Float,
+    ];
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    public static bool IsAvailable => !_unavailable;
+
+    /// <summary>
+    /// Sets how many bytes of pixels the cache may hold, evicting images right away if it holds more.
+    /// </summary>
+    public static void SetBudget(long bytes)
+    {
+        if (_unavailable)
+            return;
+
+        try
+        {
+            var budget = (ulong)Math.Max(bytes, 0);
+            if (IsArm64)
+                ImageCacheSetBudget_arm64(budget);
+            else if (Is64Bit)
+                ImageCacheSetBudget_64(budget);
+            else
+                ImageCacheSetBudget_32(budget);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+    }
+
+    /// <summary>
+    /// The thumbnail of <paramref name="path" /> decoded for <paramref name="renderSize" /> and
+    /// <paramref name="rendering" />, or <see langword="null" /> if it is not cached.
+    /// </summary>
+    public static BitmapSource GetThumbnail(string path, Size renderSize, ImageRendering rendering)
+    {
+        return Get(path, ThumbnailKey(renderSize, rendering));
+    }
+
+    /// <summary>
+    /// Frame <paramref name="index" /> of <paramref name="path" /> rendered for <paramref name="rendering" />, or
+    /// <see langword="null" /> if it is not cached.
+    /// </summary>
+    public static BitmapSource GetFrame(string path, int index, ImageRendering rendering)
+    {
+        return Get(path, FrameKey(index, rendering));
+    }
+
+    public static void PutThumbnail(string path, Size renderSize, ImageRendering rendering, BitmapSource image)
+    {
+        Put(path, ThumbnailKey(renderSize, rendering), image);
+    }
+
+    public static void PutFrame(string path, int index, ImageRendering rendering, BitmapSource image)
+    {
+        Put(path, FrameKey(index, rendering), image);
+    }
+
+    private static NativeImageKey ThumbnailKey(Size renderSize, ImageRendering rendering)
+    {
+        return new NativeImageKey
+        {
+            Kind = Thumbnail,
+            Width = (uint)Math.Max(Math.Round(renderSize.Width), 0),
+            Height = (uint)Math.Max(Math.Round(renderSize.Height), 0),
+            DpiX = rendering.DpiX,
+            DpiY = rendering.DpiY,
+            ColorProfile = rendering.ColorProfile,
+        };
+    }
+
+    private static NativeImageKey FrameKey(int index, ImageRendering rendering)
+    {
+        return new NativeImageKey
+        {
+            Kind = Frame,
+            Frame = (uint)index,
+            DpiX = rendering.DpiX,
+            DpiY = rendering.DpiY,
+            ColorProfile = rendering.ColorProfile,
+        };
+    }
+
+    private static BitmapSource Get(string path, NativeImageKey key)
+    {
+        if (_unavailable || string.IsNullOrEmpty(path))
+            return null;
+
+        try
+        {
+            var entry = IsArm64 ? ImageCacheAcquire_arm64(path, ref key, out var info)
+                : Is64Bit ? ImageCacheAcquire_64(path, ref key, out info) : ImageCacheAcquire_32(path, ref key, out info);
+            if (entry == 0)
+                return null;
+
+            try
+            {
+                var image = BitmapSource.Create((int)info.Width, (int)info.Height, info.DpiX, info.DpiY,
+                    Formats[info.Format], null, info.Pixels, (int)(info.Height * info.Stride), (int)info.Stride);
+                image.Freeze();
+                return image;
+            }
+            finally
+            {
+                Release(entry);
+            }
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    private static void Put(string path, NativeImageKey key, BitmapSource image)
+    {
+        // an image that is not frozen could not have been shown from the decoding thread either
+        if (_unavailable || string.IsNullOrEmpty(path) || image is not { IsFrozen: true })
+            return;
+
+        try
+        {
+            var format = Array.IndexOf(Formats, image.Format);
+            if (format < 0)
+            {
+                image = new FormatConvertedBitmap(image, PixelFormats.Pbgra32, null, 0);
+                format = 0;
+            }
+
+            var info = new NativeImageInfo
+            {
+                Width = (uint)image.PixelWidth,
+                Height = (uint)image.PixelHeight,
+                Stride = (uint)((image.PixelWidth * image.Format.BitsPerPixel + 31) / 32 * 4),
+                Format = (uint)format,
+                DpiX = image.DpiX,
+                DpiY = image.DpiY,
+            };
+            var entry = IsArm64 ? ImageCacheReserve_arm64(path, ref key, ref info)
+                : Is64Bit ? ImageCacheReserve_64(path, ref key, ref info) : ImageCacheReserve_32(path, ref key, ref info);
+            if (entry == 0)
+                return;
+
+            var filled = false;
+            try
+            {
+                image.CopyPixels(Int32Rect.Empty, info.Pixels, (int)(info.Height * info.Stride), (int)info.Stride);
+                filled = true;
+            }
+            catch (Exception e)
+            {
+                // a lazily decoding source that gives up half way
+                Debug.WriteLine(e);
+            }
+            finally
+            {
+                if (IsArm64)
+                    ImageCacheCommit_arm64(entry, filled);
+                else if (Is64Bit)
+                    ImageCacheCommit_64(entry, filled);
+                else
+                    ImageCacheCommit_32(entry, filled);
+            }
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+    }
+
+    private static void Release(nint entry)
+    {
+        if (IsArm64)
+            ImageCacheRelease_arm64(entry);
+        else if (Is64Bit)
+            ImageCacheRelease_64(entry);
+        else
+            ImageCacheRelease_32(entry);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ImageCacheSetBudget", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheSetBudget_32(ulong bytes);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ImageCacheAcquire", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ImageCacheAcquire_32([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [In] ref NativeImageKey key, out NativeImageInfo image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ImageCacheRelease", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheRelease_32(nint entry);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ImageCacheReserve", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ImageCacheReserve_32([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [In] ref NativeImageKey key, ref NativeImageInfo image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ImageCacheCommit", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheCommit_32(nint entry, bool keep);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ImageCacheSetBudget", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheSetBudget_64(ulong bytes);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ImageCacheAcquire", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ImageCacheAcquire_64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [In] ref NativeImageKey key, out NativeImageInfo image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ImageCacheRelease", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheRelease_64(nint entry);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ImageCacheReserve", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ImageCacheReserve_64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [In] ref NativeImageKey key, ref NativeImageInfo image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ImageCacheCommit", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheCommit_64(nint entry, bool keep);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ImageCacheSetBudget", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheSetBudget_arm64(ulong bytes);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ImageCacheAcquire", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ImageCacheAcquire_arm64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [In] ref NativeImageKey key, out NativeImageInfo image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ImageCacheRelease", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheRelease_arm64(nint entry);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ImageCacheReserve", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ImageCacheReserve_arm64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [In] ref NativeImageKey key, ref NativeImageInfo image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ImageCacheCommit", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ImageCacheCommit_arm64(nint entry, bool keep);
+
+    // Must match ImageCache::Key in QuickLook.Native/QuickLook.Native32/ImageCache.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeImageKey
+    {
+        public uint Kind;
+        public uint Frame;
+        public uint Width;
+        public uint Height;
+        public uint DpiX;
+        public uint DpiY;
+
+        [MarshalAs(UnmanagedType.LPWStr)]
+        public string ColorProfile;
+    }
+
+    // Must match ImageCache::Image in QuickLook.Native/QuickLook.Native32/ImageCache.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeImageInfo
+    {
+        public uint Width;
+        public uint Height;
+        public uint Stride;
+        public uint Format;
+        public double DpiX;
+        public double DpiY;
+        public nint Pixels;
+    }
+}
+
+/// <summary>
+/// What an image is rendered for besides its size: the DPI of the display and, when colours are mapped to the
+/// monitor, its colour profile. The providers read both while decoding, so an image cached for one display is not
+/// shown on another.
+/// </summary>
+internal readonly struct ImageRendering(uint dpiX, uint dpiY, string colorProfile)
+{
+    public uint DpiX { get; } = dpiX;
+
+    public uint DpiY { get; } = dpiY;
+
+    public string ColorProfile { get; } = colorProfile;
+
+    /// <summary>
+    /// Gets what the providers render for right now, with the colour profile of the monitor hosting
+    /// <paramref name="context" />.
+    /// </summary>
+    public static ImageRendering Current(ContextObject context)
+    {
+        var scale = DisplayDeviceHelper.GetCurrentScaleFactor();
+        var profile = SettingHelper.Get("UseColorProfile", false, "QuickLook.Plugin.ImageViewer")
+            ? context?.ColorProfileName
+            : null;
+        return new ImageRendering((uint)Math.Round(DisplayDeviceHelper.DefaultDpi * scale.Horizontal),
+            (uint)Math.Round(DisplayDeviceHelper.DefaultDpi * scale.Vertical), profile);
+    }
+}
@@ -42,9 +42,26 @@ internal class APngProvider : AnimationProvider
     private readonly List<BitmapSource> _renderedFrames;
     private int _lastEffectivePreviousPreviousFrameIndex;
     private AnimationProvider _fallbackImageProvider;
+    private readonly NativeApng _apng;
 
     public APngProvider(Uri path, MetaProvider meta, ContextObject contextObject) : base(path, meta, contextObject)
     {
+        // The native decoder composes each frame when it is shown instead of keeping all of them, so long and large
+        // animations play in bounded memory. LibAPNG is kept for when it is not available or cannot read the file.
+        _apng = NativeApng.Open(path.LocalPath);
+        if (_apng != null)
+        {
+            Animator = new Int32AnimationUsingKeyFrames { RepeatBehavior = RepeatBehavior.Forever };
+
+            var clock = TimeSpan.Zero;
+            for (var i = 0; i < _apng.FrameCount; i++)
+            {
+                Animator.KeyFrames.Add(new DiscreteInt32KeyFrame(i, KeyTime.FromTimeSpan(clock)));
+                clock += TimeSpan.FromMilliseconds(_apng.FrameDelays[i]);
+            }
+            return;
+        }
+
         if (!IsAnimatedPng(path.LocalPath))
         {
             var useNativeProvider = SettingHelper.Get("UseNativeProvider", true, "QuickLook.Plugin.ImageViewer");
@@ -83,6 +100,9 @@ internal class APngProvider : AnimationProvider
         if (_fallbackImageProvider != null)
             return _fallbackImageProvider.GetThumbnail(renderSize);
 
+        if (_apng != null)
+            return new Task<BitmapSource>(() => RenderNative(0));
+
         return new Task<BitmapSource>(() =>
         {
             var bs = _baseFrame.GetBitmapSource();
@@ -97,6 +117,9 @@ internal class APngProvider : AnimationProvider
         if (_fallbackImageProvider != null)
             return _fallbackImageProvider.GetRenderedFrame(index);
 
+        if (_apng != null)
+            return new Task<BitmapSource>(() => RenderNative(index));
+
         if (_renderedFrames[index] != null)
             return new Task<BitmapSource>(() => _renderedFrames[index]);
 
@@ -118,10 +141,27 @@ internal class APngProvider : AnimationProvider
             return;
         }
 
+        if (_apng != null)
+        {
+            lock (_apng)
+            {
+                _apng.Dispose();
+            }
+            return;
+        }
+
         _frames.Clear();
         _renderedFrames.Clear();
     }
 
+    private BitmapSource RenderNative(int index)
+    {
+        lock (_apng)
+        {
+            return _apng.Render(index, Math.Floor(_apng.DpiX), Math.Floor(_apng.DpiY));
+        }
+    }
+
     private BitmapSource Render(int index)
     {
         var currentFrame = _frames[index];
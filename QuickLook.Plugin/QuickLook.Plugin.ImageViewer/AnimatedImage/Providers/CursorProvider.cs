@@ -31,6 +31,7 @@ using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Input;
 using System.Windows.Media;
+using System.Windows.Media.Animation;
 using System.Windows.Media.Imaging;
 using PixelFormat = System.Drawing.Imaging.PixelFormat;
 
@@ -42,52 +43,49 @@ namespace QuickLook.Plugin.ImageViewer.AnimatedImage.Providers;
 internal class CursorProvider : ImageMagickProvider
 {
     private bool _isPlaying;
+    private readonly NativeIconContainer _cursor;
+    private readonly BitmapSource[] _frames;
 
     public CursorProvider(Uri path, MetaProvider meta, ContextObject contextObject) : base(path, meta, contextObject)
     {
-    }
+        // The native engine indexes every image of the cursor and decodes only the entry that fits the display, once
+        // per image; the frames of an animated cursor are then played from those. ImageMagick and ExtractIcon are
+        // kept for when it is not available.
+        _cursor = NativeIconContainer.Open(path.LocalPath);
+        if (_cursor == null)
+            return;
 
-#if false // Not supporting thumbnails would be better
-    public override Task<BitmapSource> GetThumbnail(Size renderSize)
-    {
-        return new Task<BitmapSource>(() =>
+        _frames = new BitmapSource[_cursor.IconCount];
+        if (_cursor.StepIcons.Length > 1)
         {
-            nint hIcon = IntPtr.Zero;
+            Animator = new Int32AnimationUsingKeyFrames { RepeatBehavior = RepeatBehavior.Forever };
 
-            try
+            var clock = TimeSpan.Zero;
+            for (var i = 0; i < _cursor.StepIcons.Length; i++)
             {
-                hIcon = NativeMethods.ExtractIcon(IntPtr.Zero, Path.LocalPath, 0);
-
-                if (hIcon != IntPtr.Zero)
-                {
-                    var bitmapSource = Imaging.CreateBitmapSourceFromHIcon(
-                        hIcon,
-                        Int32Rect.Empty,
-                        BitmapSizeOptions.FromEmptyOptions()
-                    );
-
-                    bitmapSource.Freeze();
-                    return bitmapSource;
-                }
-            }
-            catch (Exception e)
-            {
-                ProcessHelper.WriteLog(e.ToString());
-                return null;
-            }
-            finally
-            {
-                if (hIcon != IntPtr.Zero)
-                    NativeMethods.DestroyIcon(hIcon);
+                Animator.KeyFrames.Add(new DiscreteInt32KeyFrame(i, KeyTime.FromTimeSpan(clock)));
+                clock += TimeSpan.FromMilliseconds(_cursor.StepDelays[i]);
             }
+        }
+    }
 
-            return null;
-        });
+    public override Task<BitmapSource> GetThumbnail(System.Windows.Size renderSize)
+    {
+        if (_cursor != null)
+            return new Task<BitmapSource>(() => RenderNative(0, Math.Max(renderSize.Width, renderSize.Height)));
+
+        return base.GetThumbnail(renderSize);
     }
-#endif
 
     public override Task<BitmapSource> GetRenderedFrame(int index)
     {
+        if (_cursor != null)
+        {
+            var size = Meta.GetSize();
+            var edge = size.IsEmpty ? 0 : Math.Max(size.Width, size.Height);
+            return new Task<BitmapSource>(() => RenderFrame(index, edge));
+        }
+
         return new Task<BitmapSource>(() =>
         {
             var settings = new MagickReadSettings
@@ -121,9 +119,56 @@ internal class CursorProvider : ImageMagickProvider
     public override void Dispose()
     {
         _isPlaying = false;
+
+        if (_cursor != null)
+        {
+            lock (_cursor)
+            {
+                _cursor.Dispose();
+            }
+        }
+
         base.Dispose();
     }
 
+    /// <summary>
+    /// The image shown at step <paramref name="index" />. Steps of an animated cursor reuse a handful of images, so
+    /// each one is decoded once.
+    /// </summary>
+    private BitmapSource RenderFrame(int index, double size)
+    {
+        var icon = _cursor.StepIcons[Math.Min(Math.Max(index, 0), _cursor.StepIcons.Length - 1)];
+        lock (_frames)
+        {
+            return _frames[icon] ??= RenderNative(icon, size);
+        }
+    }
+
+    /// <summary>
+    /// Decodes the entry of image <paramref name="icon" /> that best fits <paramref name="size" /> device-independent
+    /// pixels on the current display, or its largest entry when the size is 0.
+    /// </summary>
+    private BitmapSource RenderNative(int icon, double size)
+    {
+        var scale = DisplayDeviceHelper.GetCurrentScaleFactor();
+        var pixels = (int)Math.Ceiling(size * Math.Max(scale.Horizontal, scale.Vertical));
+
+        try
+        {
+            lock (_cursor)
+            {
+                var entry = _cursor.Select(icon, pixels);
+                return entry < 0 ? null : _cursor.Render(entry, DisplayDeviceHelper.DefaultDpi * scale.Horizontal,
+                    DisplayDeviceHelper.DefaultDpi * scale.Vertical);
+            }
+        }
+        catch (Exception e)
+        {
+            ProcessHelper.WriteLog(e.ToString());
+            return null;
+        }
+    }
+
     public BitmapSource AnimatedCursor(string path)
     {
         var aniCursor = AniCursorLoader.LoadAniCursor(path);
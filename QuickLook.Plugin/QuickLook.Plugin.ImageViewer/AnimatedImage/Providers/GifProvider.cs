@@ -37,6 +37,9 @@ internal class GifProvider : AnimationProvider
     private readonly int FRAME_DELAY_TAG = 0x5100;
     private readonly int LOOP_COUNT_TAG = 20737;
 
+    private NativeGif _gif;
+    private readonly float _dpiX;
+    private readonly float _dpiY;
     private Stream _stream;
     private Bitmap _bitmap;
     private BitmapSource _frame;
@@ -53,19 +56,42 @@ internal class GifProvider : AnimationProvider
 
     public GifProvider(Uri path, MetaProvider meta, ContextObject contextObject) : base(path, meta, contextObject)
     {
-        if (!ImageAnimator.CanAnimate(Image.FromFile(path.LocalPath)))
+        _dpiX = DisplayDeviceHelper.DefaultDpi * DisplayDeviceHelper.GetCurrentScaleFactor().Horizontal;
+        _dpiY = DisplayDeviceHelper.DefaultDpi * DisplayDeviceHelper.GetCurrentScaleFactor().Vertical;
+
+        // Frames from the native decoder are composed as they are shown, so a long animation neither waits for nor
+        // holds all its frames. GDI+ is kept for when the decoder is not available or cannot read the file.
+        _gif = NativeGif.Open(path.LocalPath);
+        if (_gif != null)
         {
-            _nativeProvider = new NativeProvider(path, meta, contextObject);
+            if (_gif.FrameCount < 2)
+            {
+                _gif.Dispose();
+                _gif = null;
+                _nativeProvider = new NativeProvider(path, meta, contextObject);
+                return;
+            }
+
+            _frameCount = _gif.FrameCount;
+            _maxLoopCount = _gif.LoopCount;
+            _frameDelays = _gif.FrameDelays;
+            AddKeyFrames();
             return;
         }
 
+        using (var image = Image.FromFile(path.LocalPath))
+        {
+            if (!ImageAnimator.CanAnimate(image))
+            {
+                _nativeProvider = new NativeProvider(path, meta, contextObject);
+                return;
+            }
+        }
+
         _stream = new FileStream(path.LocalPath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete);
         _bitmap = new Bitmap(_stream);
 
-        _bitmap.SetResolution(DisplayDeviceHelper.DefaultDpi * DisplayDeviceHelper.GetCurrentScaleFactor().Horizontal,
-            DisplayDeviceHelper.DefaultDpi * DisplayDeviceHelper.GetCurrentScaleFactor().Vertical);
-
-        Animator = new Int32AnimationUsingKeyFrames { RepeatBehavior = RepeatBehavior.Forever };
+        _bitmap.SetResolution(_dpiX, _dpiY);
 
         _frameCount = _bitmap.GetFrameCount(FrameDimension.Time);
         _maxLoopCount = BitConverter.ToInt16(_bitmap.GetPropertyItem(LOOP_COUNT_TAG).Value, 0);
@@ -82,6 +108,12 @@ internal class GifProvider : AnimationProvider
             // Animator.KeyFrames.Add(new LinearInt32KeyFrame(i, KeyTime.FromTimeSpan(TimeSpan.FromMilliseconds(_frameDelays[i]))));
         }
 
+        AddKeyFrames();
+    }
+
+    private void AddKeyFrames()
+    {
+        Animator = new Int32AnimationUsingKeyFrames { RepeatBehavior = RepeatBehavior.Forever };
         Animator.KeyFrames.Add(new DiscreteInt32KeyFrame(0, KeyTime.FromTimeSpan(TimeSpan.FromMilliseconds(0))));
         Animator.KeyFrames.Add(new DiscreteInt32KeyFrame(1, KeyTime.FromTimeSpan(TimeSpan.FromMilliseconds(10))));
         Animator.KeyFrames.Add(new DiscreteInt32KeyFrame(2, KeyTime.FromTimeSpan(TimeSpan.FromMilliseconds(20))));
@@ -94,6 +126,14 @@ internal class GifProvider : AnimationProvider
         _nativeProvider?.Dispose();
         _nativeProvider = null;
 
+        if (_gif != null)
+        {
+            lock (_gif)
+            {
+                _gif.Dispose();
+            }
+        }
+
         try
         {
             lock (_bitmap ?? new object()) // Lock to prevent null reference exception
@@ -121,6 +161,12 @@ internal class GifProvider : AnimationProvider
 
         return new Task<BitmapSource>(() =>
         {
+            if (_gif != null)
+            {
+                UpdateFrame(0);
+                return _frame;
+            }
+
             _frame = _bitmap.ToBitmapSource();
             return _frame;
         });
@@ -224,6 +270,15 @@ internal class GifProvider : AnimationProvider
 
     private void UpdateFrame(int frameIndex)
     {
+        if (_gif != null)
+        {
+            lock (_gif)
+            {
+                _frame = _gif.Render(frameIndex, _dpiX, _dpiY) ?? _frame;
+            }
+            return;
+        }
+
         lock (_bitmap)
         {
             _bitmap.SetActiveTimeFrame(frameIndex);
@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+using ImageMagick;
+using QuickLook.Common.Helpers;
 using QuickLook.Common.Plugin;
 using System;
 using System.Collections.Generic;
@@ -32,20 +34,34 @@ using Size = System.Windows.Size;
 namespace QuickLook.Plugin.ImageViewer.AnimatedImage.Providers;
 
 /// <summary>
+/// Apple icon containers, read by the icon container engine of QuickLook.Native, which decodes only the entry that
+/// fits the size it is shown at. JPEG 2000 entries are handed to ImageMagick.
+/// The managed reader below is used when the engine is not available:
 /// https://github.com/BrokenEvent/CsIcnsReader
 /// Note: Not support the j2k format compression
 /// </summary>
 internal class IcnsProvider : AnimationProvider
 {
     private IcnsImage[] _images;
+    private readonly NativeIconContainer _icns;
 
     public IcnsProvider(Uri path, MetaProvider meta, ContextObject contextObject) : base(path, meta, contextObject)
     {
-        _images = IcnsImageParser.GetImages(Path.LocalPath);
+        _icns = NativeIconContainer.Open(Path.LocalPath);
+        if (_icns == null)
+            _images = IcnsImageParser.GetImages(Path.LocalPath);
     }
 
     public override void Dispose()
     {
+        if (_icns != null)
+        {
+            lock (_icns)
+            {
+                _icns.Dispose();
+            }
+        }
+
         if (_images != null)
         {
             try
@@ -66,6 +82,12 @@ internal class IcnsProvider : AnimationProvider
 
     public override Task<BitmapSource> GetRenderedFrame(int index)
     {
+        if (_icns != null)
+        {
+            var size = Meta.GetSize();
+            return new Task<BitmapSource>(() => RenderNative(size.IsEmpty ? 0 : Math.Max(size.Width, size.Height)));
+        }
+
         if (_images == null || _images.Length <= 0)
         {
             return new Task<BitmapSource>(() => null);
@@ -99,9 +121,53 @@ internal class IcnsProvider : AnimationProvider
 
     public override Task<BitmapSource> GetThumbnail(Size renderSize)
     {
+        if (_icns != null)
+            return new Task<BitmapSource>(() => RenderNative(Math.Max(renderSize.Width, renderSize.Height)));
+
         // Not implementing thumbnail method
         return GetRenderedFrame(0);
     }
+
+    /// <summary>
+    /// Decodes the one entry that best fits <paramref name="size" /> device-independent pixels on the current
+    /// display, or the largest entry when the size is 0.
+    /// </summary>
+    private BitmapSource RenderNative(double size)
+    {
+        var scale = DisplayDeviceHelper.GetCurrentScaleFactor();
+        var dpiX = DisplayDeviceHelper.DefaultDpi * scale.Horizontal;
+        var dpiY = DisplayDeviceHelper.DefaultDpi * scale.Vertical;
+
+        try
+        {
+            lock (_icns)
+            {
+                var entry = _icns.Select(0, (int)Math.Ceiling(size * Math.Max(scale.Horizontal, scale.Vertical)));
+                if (entry < 0)
+                    return null;
+
+                if (_icns.GetEntry(entry).Encoding != IconEncoding.Jpeg2000)
+                    return _icns.Render(entry, dpiX, dpiY);
+
+                using var mi = new MagickImage(_icns.GetData(entry));
+                mi.Density = new Density(dpiX, dpiY);
+                using var stream = new MemoryStream(mi.ToByteArray(MagickFormat.Png));
+
+                var bs = new BitmapImage();
+                bs.BeginInit();
+                bs.StreamSource = stream;
+                bs.CacheOption = BitmapCacheOption.OnLoad;
+                bs.EndInit();
+                bs.Freeze();
+                return bs;
+            }
+        }
+        catch (Exception e)
+        {
+            ProcessHelper.WriteLog(e.ToString());
+            return null;
+        }
+    }
 }
 
 internal static class IcnsDecoder
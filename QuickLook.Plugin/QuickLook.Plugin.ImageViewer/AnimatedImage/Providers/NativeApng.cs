@@ -0,0 +1,231 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
+
+namespace QuickLook.Plugin.ImageViewer.AnimatedImage.Providers;
+
+/// <summary>
+/// Animated PNG played by the APNG engine of QuickLook.Native. Opening it only indexes the frames; each frame is
+/// inflated and composed when it is rendered, so the first frame is ready at once and memory does not grow with the
+/// number of frames. Not thread-safe.
+/// </summary>
+internal sealed class NativeApng : IDisposable
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private const double InchesPerMeter = 0.0254;
+    private const double DefaultDpi = 96;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private readonly NativeApngInfo _info;
+
+    public int Width => (int)_info.Width;
+
+    public int Height => (int)_info.Height;
+
+    public int FrameCount => (int)_info.FrameCount;
+
+    /// <summary>
+    /// How many times the animation plays, 0 for forever.
+    /// </summary>
+    public int LoopCount => (int)_info.LoopCount;
+
+    /// <summary>
+    /// The resolution stored in the file, or 96 DPI when there is none.
+    /// </summary>
+    public double DpiX => _info.PixelsPerMeterX != 0 ? _info.PixelsPerMeterX * InchesPerMeter : DefaultDpi;
+
+    public double DpiY => _info.PixelsPerMeterY != 0 ? _info.PixelsPerMeterY * InchesPerMeter : DefaultDpi;
+
+    /// <summary>
+    /// How long each frame is shown, in milliseconds.
+    /// </summary>
+    public int[] FrameDelays { get; }
+
+    private NativeApng(nint handle, NativeApngInfo info, int[] frameDelays)
+    {
+        _handle = handle;
+        _info = info;
+        FrameDelays = frameDelays;
+    }
+
+    /// <summary>
+    /// Maps the specified file and indexes its frames.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeApng" />, or <see langword="null" /> if the file is not an animated PNG with at least one
+    /// frame, its canvas is too large, or the native engine is not available.
+    /// </returns>
+    public static NativeApng Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? ApngOpen_arm64(path) : Is64Bit ? ApngOpen_64(path) : ApngOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? ApngGetInfo_arm64(handle, out var info)
+                : Is64Bit ? ApngGetInfo_64(handle, out info) : ApngGetInfo_32(handle, out info);
+            if (ok)
+            {
+                var frameDelays = new int[info.FrameCount];
+                for (var i = 0u; i < info.FrameCount; i++)
+                {
+                    _ = IsArm64 ? ApngGetFrame_arm64(handle, i, out var frame)
+                        : Is64Bit ? ApngGetFrame_64(handle, i, out frame) : ApngGetFrame_32(handle, i, out frame);
+                    frameDelays[i] = (int)frame.Delay;
+                }
+                return new NativeApng(handle, info, frameDelays);
+            }
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Composes frame <paramref name="index" />. Rendering the frame after the last one rendered inflates just that
+    /// frame; any other frame but the last few rendered starts over from the first.
+    /// </summary>
+    /// <returns>The frozen frame, or <see langword="null" /> if there is no such frame.</returns>
+    public BitmapSource Render(int index, double dpiX, double dpiY)
+    {
+        var pixels = IsArm64 ? ApngRender_arm64(ThrowIfDisposed(), (uint)index)
+            : Is64Bit ? ApngRender_64(ThrowIfDisposed(), (uint)index) : ApngRender_32(ThrowIfDisposed(), (uint)index);
+        if (pixels == 0)
+            return null;
+
+        var stride = Width * 4;
+        var frame = BitmapSource.Create(Width, Height, dpiX, dpiY, PixelFormats.Pbgra32, null, pixels, stride * Height,
+            stride);
+        frame.Freeze();
+        return frame;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeApng));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            ApngClose_arm64(handle);
+        else if (Is64Bit)
+            ApngClose_64(handle);
+        else
+            ApngClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ApngOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ApngOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ApngClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ApngClose_32(nint image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ApngGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ApngGetInfo_32(nint image, out NativeApngInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ApngGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ApngGetFrame_32(nint image, uint index, out NativeApngFrame frame);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ApngRender", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ApngRender_32(nint image, uint index);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ApngOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ApngOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ApngClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ApngClose_64(nint image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ApngGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ApngGetInfo_64(nint image, out NativeApngInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ApngGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ApngGetFrame_64(nint image, uint index, out NativeApngFrame frame);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ApngRender", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ApngRender_64(nint image, uint index);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ApngOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ApngOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ApngClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ApngClose_arm64(nint image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ApngGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ApngGetInfo_arm64(nint image, out NativeApngInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ApngGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ApngGetFrame_arm64(nint image, uint index, out NativeApngFrame frame);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ApngRender", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint ApngRender_arm64(nint image, uint index);
+
+    // Must match ApngImage::Info in QuickLook.Native/QuickLook.Native32/ApngImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeApngInfo
+    {
+        public uint Width;
+        public uint Height;
+        public uint FrameCount;
+        public uint LoopCount;
+        public uint PixelsPerMeterX;
+        public uint PixelsPerMeterY;
+    }
+
+    // Must match ApngImage::Frame in QuickLook.Native/QuickLook.Native32/ApngImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeApngFrame
+    {
+        public uint Left;
+        public uint Top;
+        public uint Width;
+        public uint Height;
+        public uint Delay;
+        public uint Disposal;
+        public uint Blend;
+    }
+}
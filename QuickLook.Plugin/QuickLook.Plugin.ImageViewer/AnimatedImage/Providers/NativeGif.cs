@@ -0,0 +1,218 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
+
+namespace QuickLook.Plugin.ImageViewer.AnimatedImage.Providers;
+
+/// <summary>
+/// Animated GIF played by the GIF engine of QuickLook.Native. Opening it only indexes the frames; each frame is decoded
+/// and composed when it is rendered, so the first frame is ready at once and memory does not grow with the number of
+/// frames. Not thread-safe.
+/// </summary>
+internal sealed class NativeGif : IDisposable
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+    private readonly NativeGifInfo _info;
+
+    public int Width => (int)_info.Width;
+
+    public int Height => (int)_info.Height;
+
+    public int FrameCount => (int)_info.FrameCount;
+
+    /// <summary>
+    /// How many times the animation plays, 0 for forever.
+    /// </summary>
+    public int LoopCount => (int)_info.LoopCount;
+
+    /// <summary>
+    /// How long each frame is shown, in milliseconds, as stored in the file.
+    /// </summary>
+    public int[] FrameDelays { get; }
+
+    private NativeGif(nint handle, NativeGifInfo info, int[] frameDelays)
+    {
+        _handle = handle;
+        _info = info;
+        FrameDelays = frameDelays;
+    }
+
+    /// <summary>
+    /// Maps the specified file and indexes its frames.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeGif" />, or <see langword="null" /> if the file is not a GIF with at least one frame, its
+    /// canvas is too large, or the native engine is not available.
+    /// </returns>
+    public static NativeGif Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var handle = IsArm64 ? GifOpen_arm64(path) : Is64Bit ? GifOpen_64(path) : GifOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? GifGetInfo_arm64(handle, out var info)
+                : Is64Bit ? GifGetInfo_64(handle, out info) : GifGetInfo_32(handle, out info);
+            if (ok)
+            {
+                var frameDelays = new int[info.FrameCount];
+                for (var i = 0u; i < info.FrameCount; i++)
+                {
+                    _ = IsArm64 ? GifGetFrame_arm64(handle, i, out var frame)
+                        : Is64Bit ? GifGetFrame_64(handle, i, out frame) : GifGetFrame_32(handle, i, out frame);
+                    frameDelays[i] = (int)frame.Delay;
+                }
+                return new NativeGif(handle, info, frameDelays);
+            }
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Composes frame <paramref name="index" />. Rendering the frame after the last one rendered decodes just that
+    /// frame; any other frame but the last few rendered starts over from the first.
+    /// </summary>
+    /// <returns>The frozen frame, or <see langword="null" /> if there is no such frame.</returns>
+    public BitmapSource Render(int index, double dpiX, double dpiY)
+    {
+        var pixels = IsArm64 ? GifRender_arm64(ThrowIfDisposed(), (uint)index)
+            : Is64Bit ? GifRender_64(ThrowIfDisposed(), (uint)index) : GifRender_32(ThrowIfDisposed(), (uint)index);
+        if (pixels == 0)
+            return null;
+
+        var stride = Width * 4;
+        var frame = BitmapSource.Create(Width, Height, dpiX, dpiY, PixelFormats.Pbgra32, null, pixels, stride * Height,
+            stride);
+        frame.Freeze();
+        return frame;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeGif));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            GifClose_arm64(handle);
+        else if (Is64Bit)
+            GifClose_64(handle);
+        else
+            GifClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "GifOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint GifOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "GifClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GifClose_32(nint image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "GifGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool GifGetInfo_32(nint image, out NativeGifInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "GifGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool GifGetFrame_32(nint image, uint index, out NativeGifFrame frame);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "GifRender", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint GifRender_32(nint image, uint index);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "GifOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint GifOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "GifClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GifClose_64(nint image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "GifGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool GifGetInfo_64(nint image, out NativeGifInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "GifGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool GifGetFrame_64(nint image, uint index, out NativeGifFrame frame);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "GifRender", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint GifRender_64(nint image, uint index);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "GifOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint GifOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "GifClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GifClose_arm64(nint image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "GifGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool GifGetInfo_arm64(nint image, out NativeGifInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "GifGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool GifGetFrame_arm64(nint image, uint index, out NativeGifFrame frame);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "GifRender", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint GifRender_arm64(nint image, uint index);
+
+    // Must match GifImage::Info in QuickLook.Native/QuickLook.Native32/GifImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeGifInfo
+    {
+        public uint Width;
+        public uint Height;
+        public uint FrameCount;
+        public uint LoopCount;
+    }
+
+    // Must match GifImage::Frame in QuickLook.Native/QuickLook.Native32/GifImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeGifFrame
+    {
+        public uint Left;
+        public uint Top;
+        public uint Width;
+        public uint Height;
+        public uint Delay;
+        public uint Disposal;
+    }
+}
@@ -80,6 +80,12 @@ public sealed partial class Plugin : IViewer, IMoreMenu
         // Note that disabling this feature may slightly slow down image previewing but you can get precise colors.
         var useNativeProvider = SettingHelper.Get("UseNativeProvider", true, "QuickLook.Plugin.ImageViewer");
 
+        // Option of DecodedImageCacheSize:
+        // Default is 256 (MB of decoded pixels kept, so that going back to an image just seen needs no decoding)
+        // Set it to 0 to decode every image each time it is shown.
+        var decodedImageCacheSize = SettingHelper.Get("DecodedImageCacheSize", 256, "QuickLook.Plugin.ImageViewer");
+        AnimatedImage.NativeImageCache.SetBudget(decodedImageCacheSize * 1024L * 1024L);
+
         AnimatedImage.AnimatedImage.Providers.Add(
             new KeyValuePair<string[], Type>(
                 useColorProfile ? [".apng"] : [".apng", ".png"],
@@ -149,6 +155,10 @@ public sealed partial class Plugin : IViewer, IMoreMenu
 
     private static bool IsImageByMagicNumber(string path)
     {
+        if (ContentTypeHelper.Is(path, "image/png", "image/apng", "image/jpeg", "image/gif", "image/bmp", "image/webp")
+            is { } sniffed)
+            return sniffed;
+
         try
         {
             if (!File.Exists(path))
@@ -48,6 +48,9 @@ public sealed class Plugin : IViewer
         if (File.Exists(path) && Path.GetExtension(path).EndsWith(".pdf", StringComparison.OrdinalIgnoreCase))
             return true;
 
+        if (ContentTypeHelper.Is(path, "application/pdf") is { } sniffed)
+            return sniffed;
+
         using var fs = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read);
         byte[] buffer = new byte[4];
         if (fs.Read(buffer, 0, 4) < 4) return false;
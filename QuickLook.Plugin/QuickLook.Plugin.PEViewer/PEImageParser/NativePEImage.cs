@@ -0,0 +1,414 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+
+namespace QuickLook.Plugin.PEViewer.PEImageParser;
+
+/// <summary>
+/// Represents a PE image that is parsed in place by the memory-mapped parser of QuickLook.Native. Opening an image only touches its headers; imports, exports and resource directories are read page by page while they are enumerated.
+/// </summary>
+public sealed class NativePEImage : IDisposable
+{
+    private const int PageSize = 256;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private nint _handle;
+    private readonly PEImageHeaders _headers;
+
+    /// <summary>
+    /// Gets the target machine of this PE image.
+    /// </summary>
+    public ImageMachineType Machine { get; }
+
+    /// <summary>
+    /// Gets a value indicating whether this image has a PE+ (x64) optional header.
+    /// </summary>
+    public bool IsPEPlus => _headers.OptionalHeaderMagic == 0x20b;
+
+    /// <summary>
+    /// Gets the number of sections of this PE image.
+    /// </summary>
+    public int NumberOfSections => (int)_headers.NumberOfSections;
+
+    /// <summary>
+    /// Gets the size of the image file in bytes.
+    /// </summary>
+    public ulong FileSize => _headers.FileSize;
+
+    private NativePEImage(nint handle, PEImageHeaders headers)
+    {
+        _handle = handle;
+        _headers = headers;
+
+        Machine = (ImageMachineType)(ushort)Marshal.ReadInt16(headers.FileHeader);
+    }
+
+    /// <summary>
+    /// Maps the specified file and parses its headers.
+    /// </summary>
+    /// <param name="path">A <see cref="string" /> specifying the path of the file to open.</param>
+    /// <returns>
+    /// The <see cref="NativePEImage" />, or <see langword="null" /> if the file is not a PE image or the native parser is not available.
+    /// </returns>
+    public static NativePEImage Open(string path)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+
+        try
+        {
+            var handle = IsArm64 ? PeOpen_arm64(path) : Is64Bit ? PeOpen_64(path) : PeOpen_32(path);
+            if (handle == 0)
+                return null;
+
+            var ok = IsArm64 ? PeGetHeaders_arm64(handle, out var headers)
+                : Is64Bit ? PeGetHeaders_64(handle, out headers) : PeGetHeaders_32(handle, out headers);
+            if (ok)
+                return new NativePEImage(handle, headers);
+
+            Close(handle);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Enumerates the imported functions of this PE image, reading the import table lazily.
+    /// </summary>
+    public IEnumerable<PEImportEntry> GetImports()
+    {
+        var cursor = new PEImportCursor();
+        var page = new NativeImportEntry[PageSize];
+
+        while (true)
+        {
+            var count = IsArm64 ? PeReadImports_arm64(ThrowIfDisposed(), ref cursor, page, PageSize)
+                : Is64Bit ? PeReadImports_64(ThrowIfDisposed(), ref cursor, page, PageSize)
+                : PeReadImports_32(ThrowIfDisposed(), ref cursor, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            for (var i = 0; i < count; i++)
+                yield return new PEImportEntry(Marshal.PtrToStringAnsi(page[i].Module), Marshal.PtrToStringAnsi(page[i].Name), page[i].Ordinal);
+        }
+    }
+
+    /// <summary>
+    /// Enumerates the exported functions of this PE image, reading the export table lazily. Named exports come first.
+    /// </summary>
+    public IEnumerable<PEExportEntry> GetExports()
+    {
+        var page = new NativeExportEntry[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? PeReadExports_arm64(ThrowIfDisposed(), start, page, PageSize)
+                : Is64Bit ? PeReadExports_64(ThrowIfDisposed(), start, page, PageSize)
+                : PeReadExports_32(ThrowIfDisposed(), start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+                yield return new PEExportEntry(Marshal.PtrToStringAnsi(page[i].Name), Marshal.PtrToStringAnsi(page[i].Forwarder), page[i].Ordinal, page[i].Rva);
+        }
+    }
+
+    /// <summary>
+    /// Enumerates one directory of the resource tree of this PE image, reading it lazily.
+    /// </summary>
+    /// <param name="directoryOffset">The <see cref="PEResourceEntry.Offset" /> of a sub-directory, or zero for the root directory, whose entries are the resource types.</param>
+    public IEnumerable<PEResourceEntry> GetResources(uint directoryOffset = 0)
+    {
+        var page = new NativeResourceEntry[PageSize];
+        var start = 0u;
+
+        while (true)
+        {
+            var count = IsArm64 ? PeReadResources_arm64(ThrowIfDisposed(), directoryOffset, start, page, PageSize)
+                : Is64Bit ? PeReadResources_64(ThrowIfDisposed(), directoryOffset, start, page, PageSize)
+                : PeReadResources_32(ThrowIfDisposed(), directoryOffset, start, page, PageSize);
+            if (count == 0)
+                yield break;
+
+            start += count;
+
+            for (var i = 0; i < count; i++)
+            {
+                var name = page[i].Name != 0 ? Marshal.PtrToStringUni(page[i].Name, (int)page[i].NameLength) : null;
+                yield return new PEResourceEntry(name, page[i].Id, page[i].IsDirectory != 0, page[i].Offset, page[i].DataSize);
+            }
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativePEImage));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            PeClose_arm64(handle);
+        else if (Is64Bit)
+            PeClose_64(handle);
+        else
+            PeClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PeOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint PeOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PeClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void PeClose_32(nint image);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PeGetHeaders", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool PeGetHeaders_32(nint image, out PEImageHeaders headers);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PeReadImports", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadImports_32(nint image, ref PEImportCursor cursor, [Out] NativeImportEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PeReadExports", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadExports_32(nint image, uint start, [Out] NativeExportEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "PeReadResources", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadResources_32(nint image, uint directoryOffset, uint start, [Out] NativeResourceEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PeOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint PeOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PeClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void PeClose_64(nint image);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PeGetHeaders", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool PeGetHeaders_64(nint image, out PEImageHeaders headers);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PeReadImports", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadImports_64(nint image, ref PEImportCursor cursor, [Out] NativeImportEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PeReadExports", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadExports_64(nint image, uint start, [Out] NativeExportEntry[] entries, uint count);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "PeReadResources", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadResources_64(nint image, uint directoryOffset, uint start, [Out] NativeResourceEntry[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PeOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint PeOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PeClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void PeClose_arm64(nint image);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PeGetHeaders", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool PeGetHeaders_arm64(nint image, out PEImageHeaders headers);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PeReadImports", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadImports_arm64(nint image, ref PEImportCursor cursor, [Out] NativeImportEntry[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PeReadExports", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadExports_arm64(nint image, uint start, [Out] NativeExportEntry[] entries, uint count);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "PeReadResources", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint PeReadResources_arm64(nint image, uint directoryOffset, uint start, [Out] NativeResourceEntry[] entries, uint count);
+
+    // Must match PeImage::Headers in QuickLook.Native/QuickLook.Native32/PeImage.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct PEImageHeaders
+    {
+        public nint DosHeader;
+        public nint FileHeader;
+        public nint OptionalHeader;
+        public nint DataDirectories;
+        public nint Sections;
+        public ulong FileSize;
+        public uint OptionalHeaderMagic;
+        public uint NumberOfDataDirectories;
+        public uint NumberOfSections;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct PEImportCursor
+    {
+        public uint Descriptor;
+        public uint Thunk;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeImportEntry
+    {
+        public nint Module;
+        public nint Name;
+        public uint Ordinal;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeExportEntry
+    {
+        public nint Name;
+        public nint Forwarder;
+        public uint Ordinal;
+        public uint Rva;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeResourceEntry
+    {
+        public nint Name;
+        public uint NameLength;
+        public uint Id;
+        public uint IsDirectory;
+        public uint Offset;
+        public nint Data;
+        public uint DataSize;
+        public uint CodePage;
+    }
+}
+
+/// <summary>
+/// Represents a function imported by a PE image.
+/// </summary>
+[DebuggerDisplay($"{nameof(PEImportEntry)}: Module = {{Module}}, Name = {{Name}}, Ordinal = {{Ordinal}}")]
+public sealed class PEImportEntry
+{
+    /// <summary>
+    /// Gets the name of the module the function is imported from.
+    /// </summary>
+    public string Module { get; private set; }
+
+    /// <summary>
+    /// Gets the name of the imported function, or <see langword="null" /> if it is imported by ordinal.
+    /// </summary>
+    public string Name { get; private set; }
+
+    /// <summary>
+    /// Gets the ordinal of the function if it is imported by ordinal; otherwise, the hint into the export name table of the module.
+    /// </summary>
+    public uint Ordinal { get; private set; }
+
+    internal PEImportEntry(string module, string name, uint ordinal)
+    {
+        Module = module;
+        Name = name;
+        Ordinal = ordinal;
+    }
+}
+
+/// <summary>
+/// Represents a function exported by a PE image.
+/// </summary>
+[DebuggerDisplay($"{nameof(PEExportEntry)}: Name = {{Name}}, Ordinal = {{Ordinal}}")]
+public sealed class PEExportEntry
+{
+    /// <summary>
+    /// Gets the name of the exported function, or <see langword="null" /> if it is exported by ordinal only.
+    /// </summary>
+    public string Name { get; private set; }
+
+    /// <summary>
+    /// Gets the "DLL.Function" this export is forwarded to, or <see langword="null" /> if it is not forwarded.
+    /// </summary>
+    public string Forwarder { get; private set; }
+
+    /// <summary>
+    /// Gets the ordinal of the exported function.
+    /// </summary>
+    public uint Ordinal { get; private set; }
+
+    /// <summary>
+    /// Gets the address of the exported function relative to the image base, or zero if it is forwarded.
+    /// </summary>
+    public uint Rva { get; private set; }
+
+    internal PEExportEntry(string name, string forwarder, uint ordinal, uint rva)
+    {
+        Name = name;
+        Forwarder = forwarder;
+        Ordinal = ordinal;
+        Rva = rva;
+    }
+}
+
+/// <summary>
+/// Represents an entry of a resource directory of a PE image.
+/// </summary>
+[DebuggerDisplay($"{nameof(PEResourceEntry)}: Name = {{Name}}, Id = {{Id}}, IsDirectory = {{IsDirectory}}")]
+public sealed class PEResourceEntry
+{
+    /// <summary>
+    /// Gets the name of the entry, or <see langword="null" /> if it is identified by <see cref="Id" />.
+    /// </summary>
+    public string Name { get; private set; }
+
+    /// <summary>
+    /// Gets the integer id of the entry; in the root directory, the resource type such as 3 for RT_ICON.
+    /// </summary>
+    public uint Id { get; private set; }
+
+    /// <summary>
+    /// Gets a value indicating whether the entry is a sub-directory rather than resource data.
+    /// </summary>
+    public bool IsDirectory { get; private set; }
+
+    /// <summary>
+    /// Gets the offset of the sub-directory, to pass to <see cref="NativePEImage.GetResources(uint)" />.
+    /// </summary>
+    public uint Offset { get; private set; }
+
+    /// <summary>
+    /// Gets the size of the resource data in bytes, or zero for a sub-directory.
+    /// </summary>
+    public uint DataSize { get; private set; }
+
+    /// <summary>
+    /// Gets the name of the resource type a root directory entry stands for, such as "Icon" or "Manifest". Icons and cursors share a name with their groups.
+    /// </summary>
+    public string TypeName => Name ?? Id switch
+    {
+        // https://learn.microsoft.com/en-us/windows/win32/menurc/resource-types
+        1 or 12 => "Cursor",
+        2 => "Bitmap",
+        3 or 14 => "Icon",
+        4 => "Menu",
+        5 => "Dialog",
+        6 => "String",
+        7 => "Font Directory",
+        8 => "Font",
+        9 => "Accelerator",
+        10 => "RCData",
+        11 => "Message Table",
+        16 => "Version",
+        17 => "Dialog Include",
+        19 => "Plug and Play",
+        20 => "VxD",
+        21 => "Animated Cursor",
+        22 => "Animated Icon",
+        23 => "HTML",
+        24 => "Manifest",
+        _ => Id.ToString(),
+    };
+
+    internal PEResourceEntry(string name, uint id, bool isDirectory, uint offset, uint dataSize)
+    {
+        Name = name;
+        Id = id;
+        IsDirectory = isDirectory;
+        Offset = offset;
+        DataSize = dataSize;
+    }
+}
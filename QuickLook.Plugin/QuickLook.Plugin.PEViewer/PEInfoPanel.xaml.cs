@@ -21,6 +21,7 @@ using QuickLook.Plugin.PEViewer.PEImageParser;
 using System;
 using System.Diagnostics;
 using System.IO;
+using System.Linq;
 using System.Reflection;
 using System.Threading.Tasks;
 using System.Windows.Controls;
@@ -37,6 +38,9 @@ public partial class PEInfoPanel : UserControl
         totalSizeTitle.Text = TranslationHelper.Get("TOTAL_SIZE", translationFile);
         fileVersionTitle.Text = TranslationHelper.Get("FILE_VERSION", translationFile);
         productVersionTitle.Text = TranslationHelper.Get("PRODUCT_VERSION", translationFile);
+        importsTitle.Text = TranslationHelper.Get("IMPORTS", translationFile);
+        exportsTitle.Text = TranslationHelper.Get("EXPORTS", translationFile);
+        resourcesTitle.Text = TranslationHelper.Get("RESOURCES", translationFile);
     }
 
     public void DisplayInfo(string path)
@@ -67,10 +71,32 @@ public partial class PEInfoPanel : UserControl
                 var info = FileVersionInfo.GetVersionInfo(path);
                 var size = new FileInfo(path).Length;
                 var arch = default(string);
+                var importModules = default(string);
+                var exportCount = 0;
+                var resourceTypes = default(string);
+
+                // The native parser maps the file and only reads the headers on open, whatever the image size.
+                // The import, export and resource tables are then paged in just far enough for the summaries.
+                using (var nativeImage = NativePEImage.Open(path))
+                {
+                    if (nativeImage != null)
+                    {
+                        arch = nativeImage.Machine.ToImageMachineName();
+                        importModules = string.Join(", ", nativeImage.GetImports()
+                            .Select(import => import.Module)
+                            .Distinct(StringComparer.OrdinalIgnoreCase));
+                        exportCount = nativeImage.GetExports().Count();
+                        resourceTypes = string.Join(", ", nativeImage.GetResources()
+                            .Where(type => type.IsDirectory)
+                            .Select(type => type.TypeName)
+                            .Distinct());
+                    }
+                }
 
                 try
                 {
-                    int maxAttempts = 3;
+                    // fall back to the managed parser when the native one is not available
+                    int maxAttempts = arch == null ? 3 : 0;
                     int bufferSize = 1024;
 
                     for (int attempt = 0; attempt < maxAttempts; attempt++)
@@ -110,8 +136,18 @@ public partial class PEInfoPanel : UserControl
                     fileVersion.Text = info.FileVersion;
                     productVersion.Text = info.ProductVersion;
                     totalSize.Text = size.ToPrettySize(2);
+                    ShowSummary(imports, importModules);
+                    ShowSummary(exports, exportCount > 0 ? exportCount.ToString("N0") : null);
+                    ShowSummary(resources, resourceTypes);
                 });
             }
         });
     }
+
+    private static void ShowSummary(TextBlock textBlock, string text)
+    {
+        textBlock.Text = text;
+        textBlock.ToolTip = string.IsNullOrEmpty(text) ? null : text;
+        textBlock.Visibility = string.IsNullOrEmpty(text) ? System.Windows.Visibility.Collapsed : System.Windows.Visibility.Visible;
+    }
 }
@@ -50,7 +50,7 @@ public sealed class Plugin : IViewer
 
     public void Prepare(string path, ContextObject context)
     {
-        context.PreferredSize = new Size { Width = 520, Height = 192 };
+        context.PreferredSize = new Size { Width = 520, Height = 264 };
         context.Title = string.Empty;
         context.TitlebarOverlap = false;
         context.TitlebarBlurVisibility = false;
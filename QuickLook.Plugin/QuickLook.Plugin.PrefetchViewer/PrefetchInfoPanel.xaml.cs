@@ -19,8 +19,11 @@ using Prefetch;
 using QuickLook.Common.ExtensionMethods;
 using QuickLook.Common.Helpers;
 using System;
+using System.Collections.Generic;
 using System.IO;
+using System.Linq;
 using System.Reflection;
+using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
 using System.Windows.Media;
@@ -29,6 +32,8 @@ namespace QuickLook.Plugin.PrefetchViewer;
 
 public partial class PrefetchInfoPanel : UserControl
 {
+    private const int FilenameBatchSize = 256;
+
     public PrefetchInfoPanel()
     {
         InitializeComponent();
@@ -47,93 +52,148 @@ public partial class PrefetchInfoPanel : UserControl
 
     public void LoadPrefetch(string path)
     {
-        var name = Path.GetFileName(path);
-
-        try
+        _ = Task.Run(() =>
         {
-            IPrefetch pf;
-
-            using (var fs = new FileStream(path, FileMode.Open, FileAccess.Read))
+            try
             {
-                pf = PrefetchFile.Open(fs, path);
-            }
-
-            Dispatcher.Invoke(() =>
-            {
-                pfVersion.Text = pf.Header.Version.ToString();
-                fileHash.Text = pf.Header.Hash;
-                totalSize.Text = ((long)pf.Header.FileSize).ToPrettySize(2);
-                runCount.Text = pf.RunCount.ToString();
-
-                foreach (var runTime in pf.LastRunTimes)
+                var pf = PrefetchReader.Open(path);
+                if (pf == null)
                 {
-                    var tb = new TextBlock
-                    {
-                        Text = runTime.ToString("yyyy-MM-dd HH:mm:ss"),
-                        Margin = new Thickness(0, 0, 0, 2)
-                    };
-                    lastRunList.Items.Add(tb);
+                    LoadWithPrefetchLibrary(path);
+                    return;
                 }
 
-                fileMetrics.Text = $"{pf.FileMetrics.Count} entries";
-                traceChains.Text = $"{pf.TraceChains.Count} entries";
-
-                foreach (var vol in pf.VolumeInformation)
+                Dispatcher.Invoke(() =>
                 {
-                    var border = new Border
-                    {
-                        BorderBrush = Brushes.Gray,
-                        BorderThickness = new Thickness(0, 0, 0, 1),
-                        Margin = new Thickness(0, 0, 0, 4),
-                        Child = CreateVolumeInfoPanel(vol)
-                    };
-                    volumeInfoList.Items.Add(border);
-                }
+                    ShowSummary($"{pf.Version}", pf.Hash, pf.FileSize, pf.RunCount, pf.LastRunTimes.Select(t => t.ToString("yyyy-MM-dd HH:mm:ss")),
+                                pf.FileMetricsCount, pf.TraceChainsCount);
+
+                    foreach (var vol in pf.Volumes)
+                        AddVolume(vol.DeviceName, vol.SerialNumber, $"{vol.CreationTime:yyyy-MM-dd HH:mm:ss}", vol.DirectoryNames);
+                });
 
-                foreach (var fn in pf.Filenames)
+                // The file names are the bulk of a prefetch file; they follow the summary in batches
+                var batch = new List<string>(FilenameBatchSize);
+                foreach (var fn in pf.GetFilenames())
                 {
-                    var tb = new TextBlock
-                    {
-                        Text = fn,
-                        TextTrimming = TextTrimming.CharacterEllipsis,
-                        Margin = new Thickness(0, 0, 0, 1)
-                    };
-                    referencedFilesList.Items.Add(tb);
+                    batch.Add(fn);
+                    if (batch.Count < FilenameBatchSize)
+                        continue;
+
+                    var items = batch.ToArray();
+                    Dispatcher.Invoke(() => AddFilenames(items));
+                    batch.Clear();
                 }
-            });
+
+                Dispatcher.Invoke(() => AddFilenames(batch));
+            }
+            catch (Exception ex)
+            {
+                ShowError(ex);
+            }
+        });
+    }
+
+    private void LoadWithPrefetchLibrary(string path)
+    {
+        IPrefetch pf;
+
+        using (var fs = new FileStream(path, FileMode.Open, FileAccess.Read))
+        {
+            pf = PrefetchFile.Open(fs, path);
         }
-        catch (Exception ex)
+
+        Dispatcher.Invoke(() =>
         {
-            Dispatcher.Invoke(() =>
+            ShowSummary(pf.Header.Version.ToString(), pf.Header.Hash, (long)pf.Header.FileSize, pf.RunCount,
+                        pf.LastRunTimes.Select(t => t.ToString("yyyy-MM-dd HH:mm:ss")), pf.FileMetrics.Count, pf.TraceChains.Count);
+
+            foreach (var vol in pf.VolumeInformation)
+                AddVolume(vol.DeviceName, $"{vol.SerialNumber}", $"{vol.CreationTime:yyyy-MM-dd HH:mm:ss}", vol.DirectoryNames);
+
+            AddFilenames(pf.Filenames);
+        });
+    }
+
+    private void ShowSummary(string version, string hash, long fileSize, int runCount, IEnumerable<string> lastRunTimes, int fileMetricsCount,
+                             int traceChainsCount)
+    {
+        pfVersion.Text = version;
+        fileHash.Text = hash;
+        totalSize.Text = fileSize.ToPrettySize(2);
+        runCount.Text = runCount.ToString();
+
+        foreach (var runTime in lastRunTimes)
+        {
+            var tb = new TextBlock
             {
-                errorText.Text = $"Error: {ex.Message}";
-                errorText.Visibility = Visibility.Visible;
-            });
+                Text = runTime,
+                Margin = new Thickness(0, 0, 0, 2)
+            };
+            lastRunList.Items.Add(tb);
+        }
+
+        fileMetrics.Text = $"{fileMetricsCount} entries";
+        traceChains.Text = $"{traceChainsCount} entries";
+    }
+
+    private void AddVolume(string deviceName, string serialNumber, string creationTime, IReadOnlyCollection<string> directoryNames)
+    {
+        var border = new Border
+        {
+            BorderBrush = Brushes.Gray,
+            BorderThickness = new Thickness(0, 0, 0, 1),
+            Margin = new Thickness(0, 0, 0, 4),
+            Child = CreateVolumeInfoPanel(deviceName, serialNumber, creationTime, directoryNames)
+        };
+        volumeInfoList.Items.Add(border);
+    }
+
+    private void AddFilenames(IEnumerable<string> filenames)
+    {
+        foreach (var fn in filenames)
+        {
+            var tb = new TextBlock
+            {
+                Text = fn,
+                TextTrimming = TextTrimming.CharacterEllipsis,
+                Margin = new Thickness(0, 0, 0, 1)
+            };
+            referencedFilesList.Items.Add(tb);
         }
     }
 
-    private static StackPanel CreateVolumeInfoPanel(Prefetch.Other.VolumeInfo vol)
+    private void ShowError(Exception ex)
+    {
+        Dispatcher.Invoke(() =>
+        {
+            errorText.Text = $"Error: {ex.Message}";
+            errorText.Visibility = Visibility.Visible;
+        });
+    }
+
+    private static StackPanel CreateVolumeInfoPanel(string deviceName, string serialNumber, string creationTime, IReadOnlyCollection<string> directoryNames)
     {
         var panel = new StackPanel { Margin = new Thickness(0, 2, 0, 2) };
 
         panel.Children.Add(new TextBlock
         {
-            Text = $"Device: {vol.DeviceName}",
+            Text = $"Device: {deviceName}",
             FontWeight = FontWeights.SemiBold
         });
         panel.Children.Add(new TextBlock
         {
-            Text = $"Serial: {vol.SerialNumber}  |  Created: {vol.CreationTime:yyyy-MM-dd HH:mm:ss}"
+            Text = $"Serial: {serialNumber}  |  Created: {creationTime}"
         });
 
-        if (vol.DirectoryNames.Count > 0)
+        if (directoryNames.Count > 0)
         {
             panel.Children.Add(new TextBlock
             {
-                Text = $"Directories ({vol.DirectoryNames.Count}):",
+                Text = $"Directories ({directoryNames.Count}):",
                 Margin = new Thickness(0, 2, 0, 0)
             });
-            foreach (var dir in vol.DirectoryNames)
+            foreach (var dir in directoryNames)
             {
                 panel.Children.Add(new TextBlock
                 {
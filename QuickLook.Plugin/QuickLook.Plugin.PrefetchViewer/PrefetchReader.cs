@@ -0,0 +1,256 @@
+// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace QuickLook.Plugin.PrefetchViewer;
+
+/// <summary>
+/// Reader for SCCA prefetch files (versions 17 to 31). Compressed "MAM" files from Windows 10 and later are
+/// unpacked in full by the Xpress Huffman decoder of QuickLook.Native when the file is opened: its blocks can only
+/// be decoded in order, and the volume information is the last section of the file. Opening parses the header,
+/// the run information and the volumes; the referenced file names are converted to strings while they are enumerated.
+/// </summary>
+public sealed class PrefetchReader
+{
+    private const int HeaderSize = 84;
+
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private readonly byte[] _data;
+    private readonly uint _filenamesOffset;
+    private readonly uint _filenamesSize;
+
+    public int Version { get; }
+
+    public string ExecutableName { get; }
+
+    public string Hash { get; }
+
+    public uint FileSize { get; }
+
+    public int RunCount { get; }
+
+    public IReadOnlyList<DateTimeOffset> LastRunTimes { get; }
+
+    public int FileMetricsCount { get; }
+
+    public int TraceChainsCount { get; }
+
+    public IReadOnlyList<PrefetchVolume> Volumes { get; }
+
+    private PrefetchReader(byte[] data)
+    {
+        _data = data;
+
+        Version = (int)ReadUInt32(0);
+        FileSize = ReadUInt32(12);
+        ExecutableName = ReadString(16, 30);
+        Hash = ReadUInt32(76).ToString("X");
+
+        var metricsOffset = ReadUInt32(84);
+        FileMetricsCount = (int)ReadUInt32(88);
+        TraceChainsCount = (int)ReadUInt32(96);
+        _filenamesOffset = ReadUInt32(100);
+        _filenamesSize = ReadUInt32(104);
+
+        var volumesOffset = ReadUInt32(108);
+        var volumeCount = ReadUInt32(112);
+
+        // the run information grew from one last run time (17, 23) to eight (26 and later);
+        // one variant of version 30 has a file information block 8 bytes shorter
+        int runTimesOffset, runTimeCount, runCountOffset, volumeEntrySize;
+        switch (Version)
+        {
+            case 17:
+                (runTimesOffset, runTimeCount, runCountOffset, volumeEntrySize) = (120, 1, 144, 40);
+                break;
+
+            case 23:
+                (runTimesOffset, runTimeCount, runCountOffset, volumeEntrySize) = (128, 1, 152, 104);
+                break;
+
+            case 26:
+                (runTimesOffset, runTimeCount, runCountOffset, volumeEntrySize) = (128, 8, 208, 104);
+                break;
+
+            default:
+                (runTimesOffset, runTimeCount, runCountOffset, volumeEntrySize) = (128, 8, metricsOffset == HeaderSize + 216 ? 200 : 208, 96);
+                break;
+        }
+
+        var lastRunTimes = new List<DateTimeOffset>();
+        for (var i = 0; i < runTimeCount; i++)
+        {
+            var time = (long)ReadUInt64(runTimesOffset + i * 8);
+            if (time > 0)
+                lastRunTimes.Add(DateTimeOffset.FromFileTime(time).ToUniversalTime());
+        }
+
+        LastRunTimes = lastRunTimes;
+        RunCount = (int)ReadUInt32(runCountOffset);
+
+        var volumes = new List<PrefetchVolume>();
+        for (var i = 0u; i < volumeCount; i++)
+        {
+            var entry = volumesOffset + (long)i * volumeEntrySize;
+            if (entry + volumeEntrySize > _data.Length)
+                break;
+
+            var deviceName = ReadString((long)volumesOffset + ReadUInt32(entry), (int)ReadUInt32(entry + 4));
+            var creationTime = DateTimeOffset.FromFileTime((long)ReadUInt64(entry + 8)).ToUniversalTime();
+            var serialNumber = ReadUInt32(entry + 16).ToString("X");
+            var directories = ReadDirectoryStrings((long)volumesOffset + ReadUInt32(entry + 28), ReadUInt32(entry + 32));
+
+            volumes.Add(new PrefetchVolume(deviceName, serialNumber, creationTime, directories));
+        }
+
+        Volumes = volumes;
+    }
+
+    /// <summary>
+    /// Reads a prefetch file, decompressing it first if it is a "MAM" file.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="PrefetchReader" />, or <see langword="null" /> if the file is compressed and the native decoder
+    /// is not available, or if it is not a prefetch file of a known version.
+    /// </returns>
+    public static PrefetchReader Open(string path)
+    {
+        var data = File.ReadAllBytes(path);
+
+        if (data.Length >= 8 && data[0] == 'M' && data[1] == 'A' && data[2] == 'M')
+        {
+            data = Decompress(data);
+            if (data == null)
+                return null;
+        }
+
+        if (data.Length < HeaderSize || Encoding.ASCII.GetString(data, 4, 4) != "SCCA")
+            return null;
+
+        return BitConverter.ToUInt32(data, 0) switch
+        {
+            17 or 23 or 26 or 30 or 31 => new PrefetchReader(data),
+            _ => null,
+        };
+    }
+
+    /// <summary>
+    /// Enumerates the files the executable loaded while it was being traced.
+    /// </summary>
+    public IEnumerable<string> GetFilenames()
+    {
+        var end = Math.Min((long)_filenamesOffset + _filenamesSize, _data.Length);
+
+        for (long start = _filenamesOffset; start + 1 < end;)
+        {
+            var terminator = start;
+            while (terminator + 1 < end && (_data[terminator] | _data[terminator + 1]) != 0)
+                terminator += 2;
+
+            yield return Encoding.Unicode.GetString(_data, (int)start, (int)(terminator - start));
+            start = terminator + 2;
+        }
+    }
+
+    private List<string> ReadDirectoryStrings(long offset, uint count)
+    {
+        // each entry is a character count, the characters and a terminating NUL
+        var directories = new List<string>();
+        for (var i = 0u; i < count && offset + 2 <= _data.Length; i++)
+        {
+            var length = BitConverter.ToUInt16(_data, (int)offset);
+            directories.Add(ReadString(offset + 2, length));
+            offset += 2 + (length + 1) * 2;
+        }
+
+        return directories;
+    }
+
+    private uint ReadUInt32(long offset)
+    {
+        return offset >= 0 && offset + 4 <= _data.Length ? BitConverter.ToUInt32(_data, (int)offset) : 0;
+    }
+
+    private ulong ReadUInt64(long offset)
+    {
+        return offset >= 0 && offset + 8 <= _data.Length ? BitConverter.ToUInt64(_data, (int)offset) : 0;
+    }
+
+    private string ReadString(long offset, int maxLength)
+    {
+        if (offset < 0 || offset >= _data.Length)
+            return string.Empty;
+
+        var length = (int)Math.Min(Math.Max(maxLength, 0) * 2L, _data.Length - offset) & ~1;
+        var value = Encoding.Unicode.GetString(_data, (int)offset, length);
+        var terminator = value.IndexOf('\0');
+        return terminator < 0 ? value : value.Substring(0, terminator);
+    }
+
+    private static byte[] Decompress(byte[] data)
+    {
+        try
+        {
+            var size = IsArm64 ? DecompressMam_arm64(data, (uint)data.Length, null, 0)
+                : Is64Bit ? DecompressMam_64(data, (uint)data.Length, null, 0)
+                : DecompressMam_32(data, (uint)data.Length, null, 0);
+            if (size == 0)
+                return null;
+
+            var output = new byte[size];
+            var written = IsArm64 ? DecompressMam_arm64(data, (uint)data.Length, output, size)
+                : Is64Bit ? DecompressMam_64(data, (uint)data.Length, output, size)
+                : DecompressMam_32(data, (uint)data.Length, output, size);
+            return written == size ? output : null;
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+            return null;
+        }
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "DecompressMam", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint DecompressMam_32(byte[] input, uint inputSize, [Out] byte[] output, uint outputSize);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "DecompressMam", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint DecompressMam_64(byte[] input, uint inputSize, [Out] byte[] output, uint outputSize);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "DecompressMam", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint DecompressMam_arm64(byte[] input, uint inputSize, [Out] byte[] output, uint outputSize);
+}
+
+[DebuggerDisplay($"{nameof(PrefetchVolume)}: DeviceName = {{DeviceName}}")]
+public sealed class PrefetchVolume(string deviceName, string serialNumber, DateTimeOffset creationTime, IReadOnlyList<string> directoryNames)
+{
+    public string DeviceName { get; } = deviceName;
+
+    public string SerialNumber { get; } = serialNumber;
+
+    public DateTimeOffset CreationTime { get; } = creationTime;
+
+    public IReadOnlyList<string> DirectoryNames { get; } = directoryNames;
+}
@@ -25,12 +25,18 @@ namespace QuickLook.Plugin.TextViewer.Detectors;
 [Export]
 public class EncodingDetector
 {
-    public static Encoding DetectFromBytes(byte[] bytes)
+    /// <param name="truncated">
+    /// <see langword="true" /> if <paramref name="bytes" /> is only the head of the file, which may then end in the middle of a character.
+    /// </param>
+    public static Encoding DetectFromBytes(byte[] bytes, bool truncated = false)
     {
-        var result = CharsetDetector.DetectFromBytes(bytes);
-        var encoding = result.DoubleDetectFromResult(bytes); // Fix issues
+        // BOMs, ASCII and valid UTF-8 are settled natively; only the rest needs the statistical detector
+        var encoding = NativeTextEncoding.Detect(bytes, truncated);
+        if (encoding != null)
+            return encoding;
 
-        return encoding;
+        var result = CharsetDetector.DetectFromBytes(bytes);
+        return result.DoubleDetectFromResult(bytes); // Fix issues
     }
 }
 
@@ -15,6 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+using System;
 using System.Collections.Generic;
 using System.Linq;
 
@@ -45,12 +46,23 @@ public class FormatDetector
         new ResourcesDetector(),
     ];
 
+    /// <summary>
+    /// Characters at the head of a text that the signatures of <see cref="ISignatureFormatDetector" /> are looked for in.
+    /// </summary>
+    public const int SniffLength = 8192;
+
+    private readonly object _sniffLock = new();
+    private NativeFormatSniffer _sniffer;
+    private ISignatureFormatDetector[] _signatureDetectors;
+    private WeakReference<string> _sniffedText; // not to keep the text of a closed viewer
+    private FormatCandidate[] _sniffed;
+
     public static IFormatDetector Confuse(string path, string text)
     {
         if (string.IsNullOrWhiteSpace(text)) return null;
 
         return Instance.TextDetectors
-            .FirstOrDefault(detector => detector is IConfusedFormatDetector && detector.Detect(path, text));
+            .FirstOrDefault(detector => detector is IConfusedFormatDetector && Matches(detector, path, text));
     }
 
     public static IFormatDetector Detect(string path, string text)
@@ -58,7 +70,19 @@ public class FormatDetector
         if (string.IsNullOrWhiteSpace(text)) return null;
 
         return Instance.TextDetectors
-            .FirstOrDefault(detector => detector is not IConfusedFormatDetector && detector.Detect(path, text));
+            .FirstOrDefault(detector => detector is not IConfusedFormatDetector && Matches(detector, path, text));
+    }
+
+    /// <summary>
+    /// Scores the head of <paramref name="text" /> against the signatures of all the detectors in one pass. The last
+    /// text is remembered, so <see cref="Confuse" /> and <see cref="Detect" /> on the same text read it once.
+    /// </summary>
+    /// <returns>The detectors whose signatures weigh for the text, best first.</returns>
+    public static FormatCandidate[] Sniff(string text)
+    {
+        _ = text ?? throw new ArgumentNullException(nameof(text));
+
+        return Instance.SniffCached(text);
     }
 
     public static bool Transfer(string path, out string text)
@@ -79,6 +103,93 @@ public class FormatDetector
         }
         return false;
     }
+
+    private static bool Matches(IFormatDetector detector, string path, string text)
+    {
+        if (detector is not ISignatureFormatDetector signatureDetector)
+            return detector.Detect(path, text);
+
+        return signatureDetector.Detect(path, text, ScoreOf(signatureDetector, text));
+    }
+
+    /// <summary>
+    /// The score of the signatures of <paramref name="detector" />, or of the detector of the same type in the list, at
+    /// the head of <paramref name="text" />.
+    /// </summary>
+    internal static int ScoreOf(ISignatureFormatDetector detector, string text)
+    {
+        if (text == null) return 0;
+
+        return Sniff(text).FirstOrDefault(candidate => candidate.Detector.GetType() == detector.GetType())?.Score ?? 0;
+    }
+
+    private FormatCandidate[] SniffCached(string text)
+    {
+        lock (_sniffLock)
+        {
+            if (_sniffedText != null && _sniffedText.TryGetTarget(out var sniffedText) && ReferenceEquals(text, sniffedText))
+                return _sniffed;
+
+            if (_sniffer == null)
+            {
+                _signatureDetectors = [.. TextDetectors.OfType<ISignatureFormatDetector>()];
+                _sniffer = new NativeFormatSniffer([.. _signatureDetectors.Select(detector => detector.Signatures)]);
+            }
+
+            _sniffed = [.. _sniffer.Run(text, SniffLength)
+                .Select(candidate => new FormatCandidate(_signatureDetectors[candidate.Format], candidate.Score))];
+            _sniffedText = new WeakReference<string>(text);
+            return _sniffed;
+        }
+    }
+}
+
+public sealed class FormatCandidate(IFormatDetector detector, int score)
+{
+    public IFormatDetector Detector { get; } = detector;
+
+    public int Score { get; } = score;
+}
+
+/// <summary>
+/// A string whose presence at the head of a text makes a format more, or with a negative weight less, likely.
+/// </summary>
+public sealed class FormatSignature
+{
+    public FormatSignature(string text, int weight, FormatSignatureOptions options = FormatSignatureOptions.None)
+    {
+        if (string.IsNullOrEmpty(text))
+            throw new ArgumentException("A signature cannot be empty.", nameof(text));
+
+        Text = text;
+        Weight = weight;
+        Options = options;
+    }
+
+    public string Text { get; }
+
+    public int Weight { get; }
+
+    public FormatSignatureOptions Options { get; }
+}
+
+// Must match TextSniffer::Flags in QuickLook.Native/QuickLook.Native32/TextSniffer.h
+[Flags]
+public enum FormatSignatureOptions : uint
+{
+    None = 0,
+
+    /// <summary>ASCII letters match either case.</summary>
+    IgnoreCase = 0x1,
+
+    /// <summary>Matches after nothing but spaces and tabs on its line.</summary>
+    LineStart = 0x2,
+
+    /// <summary>Matches at the start of the text, after any byte order mark.</summary>
+    TextStart = 0x4,
+
+    /// <summary>Weighs once for every match rather than once.</summary>
+    EveryMatch = 0x8,
 }
 
 public interface IFormatDetector
@@ -92,6 +203,17 @@ public interface IFormatDetector
 
 public interface IConfusedFormatDetector : IFormatDetector;
 
+/// <summary>
+/// A detector that is given the score of its <see cref="Signatures" /> at the head of the text, found in one pass
+/// together with those of all the other detectors, so it only has to look further when the score is promising.
+/// </summary>
+public interface ISignatureFormatDetector : IFormatDetector
+{
+    public FormatSignature[] Signatures { get; }
+
+    public bool Detect(string path, string text, int score);
+}
+
 public interface ITransferFormatDetector : IFormatDetector
 {
     public string OriginalExtension { get; }
@@ -20,15 +20,27 @@ using System.Text.RegularExpressions;
 
 namespace QuickLook.Plugin.TextViewer.Detectors;
 
-public sealed class JSONDetector : IFormatDetector
+public sealed class JSONDetector : ISignatureFormatDetector
 {
     internal Regex Signature { get; } = new(@"""[^""]+""\s*:", RegexOptions.IgnoreCase);
 
+    // the end of a key and its colon, or the start of the whitespace JSON allows between them
+    public FormatSignature[] Signatures { get; } =
+    [
+        new("\":", 1),
+        new("\" ", 1),
+        new("\"\t", 1),
+        new("\"\n", 1),
+        new("\"\r", 1),
+    ];
+
     public string Name => "JSON";
 
     public string Extension => ".json";
 
-    public bool Detect(string path, string text)
+    public bool Detect(string path, string text) => Detect(path, text, FormatDetector.ScoreOf(this, text));
+
+    public bool Detect(string path, string text, int score)
     {
         _ = path;
 
@@ -59,6 +71,10 @@ public sealed class JSONDetector : IFormatDetector
         if (end < 0 || (span[end] != '}' && span[end] != ']'))
             return false;
 
+        // a key may only be missed in the head when there is more text than the head
+        if (score <= 0 && text.Length <= FormatDetector.SniffLength)
+            return false;
+
         return Signature.IsMatch(text);
     }
 }
@@ -0,0 +1,222 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace QuickLook.Plugin.TextViewer.Detectors;
+
+/// <summary>
+/// Scores a text against the signatures of several formats at once through the Aho-Corasick sniffer of
+/// QuickLook.Native, which reads the text once however many signatures there are. Falls back to searching for each
+/// signature in turn when the native sniffer is not available.
+/// </summary>
+internal sealed class NativeFormatSniffer
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private readonly FormatSignature[][] _signatures;
+    private readonly object _compileLock = new();
+    private nint _handle;
+    private bool _compiled;
+
+    /// <param name="signatures">The signatures of each format, by format.</param>
+    public NativeFormatSniffer(FormatSignature[][] signatures)
+    {
+        _signatures = signatures ?? throw new ArgumentNullException(nameof(signatures));
+    }
+
+    /// <summary>
+    /// Scores the first <paramref name="length" /> characters of <paramref name="text" />.
+    /// </summary>
+    /// <returns>The formats with a positive score, best first and in format order where they tie.</returns>
+    public SniffCandidate[] Run(string text, int length)
+    {
+        _ = text ?? throw new ArgumentNullException(nameof(text));
+
+        length = Math.Max(Math.Min(length, text.Length), 0);
+        var handle = Compile();
+        if (handle != 0)
+        {
+            try
+            {
+                return Run(handle, text, (uint)length);
+            }
+            catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+            {
+                _unavailable = true;
+                Debug.WriteLine(e);
+            }
+        }
+
+        return RunManaged(text, length);
+    }
+
+    private static SniffCandidate[] Run(nint handle, string text, uint length)
+    {
+        var candidates = new SniffCandidate[16];
+        while (true)
+        {
+            var count = IsArm64 ? TextSnifferRun_arm64(handle, text, length, candidates, (uint)candidates.Length)
+                : Is64Bit ? TextSnifferRun_64(handle, text, length, candidates, (uint)candidates.Length)
+                : TextSnifferRun_32(handle, text, length, candidates, (uint)candidates.Length);
+            if (count <= candidates.Length)
+            {
+                Array.Resize(ref candidates, (int)count);
+                return candidates;
+            }
+            candidates = new SniffCandidate[count];
+        }
+    }
+
+    private nint Compile()
+    {
+        if (_unavailable)
+            return 0;
+
+        lock (_compileLock)
+        {
+            if (_compiled)
+                return _handle;
+
+            _compiled = true;
+            var signatures = new List<SniffSignature>();
+            var text = new StringBuilder();
+            for (var format = 0; format < _signatures.Length; format++)
+            {
+                foreach (var signature in _signatures[format])
+                {
+                    signatures.Add(new SniffSignature
+                    {
+                        Format = (uint)format,
+                        Weight = signature.Weight,
+                        Options = signature.Options,
+                        Begin = (uint)text.Length,
+                        Length = (uint)signature.Text.Length,
+                    });
+                    text.Append(signature.Text);
+                }
+            }
+
+            try
+            {
+                var all = signatures.ToArray();
+                var patterns = text.ToString();
+                _handle = IsArm64 ? TextSnifferCompile_arm64(all, (uint)all.Length, patterns, (uint)patterns.Length)
+                    : Is64Bit ? TextSnifferCompile_64(all, (uint)all.Length, patterns, (uint)patterns.Length)
+                    : TextSnifferCompile_32(all, (uint)all.Length, patterns, (uint)patterns.Length);
+            }
+            catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+            {
+                _unavailable = true;
+                Debug.WriteLine(e);
+            }
+            return _handle;
+        }
+    }
+
+    // the same scores, one signature at a time
+    private SniffCandidate[] RunManaged(string text, int length)
+    {
+        var start = length > 0 && text[0] == '\uFEFF' ? 1 : 0;
+        var candidates = new List<SniffCandidate>();
+        for (var format = 0; format < _signatures.Length; format++)
+        {
+            var score = 0;
+            foreach (var signature in _signatures[format])
+            {
+                var comparison = signature.Options.HasFlag(FormatSignatureOptions.IgnoreCase)
+                    ? StringComparison.OrdinalIgnoreCase : StringComparison.Ordinal;
+                for (var i = text.IndexOf(signature.Text, start, length - start, comparison);
+                     i >= 0;
+                     i = text.IndexOf(signature.Text, i + 1, length - i - 1, comparison))
+                {
+                    if (signature.Options.HasFlag(FormatSignatureOptions.TextStart) && i != start)
+                        break;
+                    if (signature.Options.HasFlag(FormatSignatureOptions.LineStart) && !IsLineStart(text, start, i))
+                        continue;
+
+                    score += signature.Weight;
+                    if (!signature.Options.HasFlag(FormatSignatureOptions.EveryMatch))
+                        break;
+                }
+            }
+
+            if (score > 0)
+                candidates.Add(new SniffCandidate { Format = (uint)format, Score = score });
+        }
+        return [.. candidates.OrderByDescending(candidate => candidate.Score)];
+    }
+
+    private static bool IsLineStart(string text, int start, int index)
+    {
+        while (index > start && (text[index - 1] == ' ' || text[index - 1] == '\t'))
+            index--;
+
+        return index == start || text[index - 1] == '\n' || text[index - 1] == '\r';
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextSnifferCompile", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint TextSnifferCompile_32([In] SniffSignature[] signatures, uint count,
+        [MarshalAs(UnmanagedType.LPWStr)] string text, uint textLength);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextSnifferRun", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextSnifferRun_32(nint sniffer, [MarshalAs(UnmanagedType.LPWStr)] string text,
+        uint length, [Out] SniffCandidate[] candidates, uint capacity);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextSnifferCompile", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint TextSnifferCompile_64([In] SniffSignature[] signatures, uint count,
+        [MarshalAs(UnmanagedType.LPWStr)] string text, uint textLength);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextSnifferRun", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextSnifferRun_64(nint sniffer, [MarshalAs(UnmanagedType.LPWStr)] string text,
+        uint length, [Out] SniffCandidate[] candidates, uint capacity);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextSnifferCompile", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint TextSnifferCompile_arm64([In] SniffSignature[] signatures, uint count,
+        [MarshalAs(UnmanagedType.LPWStr)] string text, uint textLength);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextSnifferRun", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextSnifferRun_arm64(nint sniffer, [MarshalAs(UnmanagedType.LPWStr)] string text,
+        uint length, [Out] SniffCandidate[] candidates, uint capacity);
+
+    // Must match TextSniffer::Signature in QuickLook.Native/QuickLook.Native32/TextSniffer.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SniffSignature
+    {
+        public uint Format;
+        public int Weight;
+        public FormatSignatureOptions Options;
+        public uint Begin;
+        public uint Length;
+    }
+
+    // Must match TextSniffer::Candidate in QuickLook.Native/QuickLook.Native32/TextSniffer.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct SniffCandidate
+    {
+        public uint Format;
+        public int Score;
+    }
+}
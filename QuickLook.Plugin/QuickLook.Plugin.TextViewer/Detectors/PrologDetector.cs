@@ -23,14 +23,40 @@ namespace QuickLook.Plugin.TextViewer.Detectors;
 /// <summary>
 /// Resolve conflicting file extension names between Prolog and Perl.
 /// </summary>
-public sealed class PrologDetector : IConfusedFormatDetector
+public sealed class PrologDetector : IConfusedFormatDetector, ISignatureFormatDetector
 {
     public string Name => "Prolog";
 
     public string Extension => ".pl";
 
-    public bool Detect(string path, string text) =>
-        PlFormatHelper.IsPlFile(path) && PlFormatHelper.LooksLikeProlog(text);
+    // Prolog weighs for and Perl against
+    public FormatSignature[] Signatures { get; } =
+    [
+        new(":-", 3),
+        new("?-", 2),
+        new(":- module", 3, FormatSignatureOptions.IgnoreCase),
+        new(":- use_module", 3, FormatSignatureOptions.IgnoreCase),
+        new(":- dynamic", 2, FormatSignatureOptions.IgnoreCase),
+        new(":- multifile", 2, FormatSignatureOptions.IgnoreCase),
+        new(":- initialization", 2, FormatSignatureOptions.IgnoreCase),
+        new("%", 1, FormatSignatureOptions.LineStart | FormatSignatureOptions.EveryMatch),
+        new("use strict", -3, FormatSignatureOptions.IgnoreCase),
+        new("use warnings", -2, FormatSignatureOptions.IgnoreCase),
+        new("use v5", -2, FormatSignatureOptions.IgnoreCase),
+        new("sub ", -1, FormatSignatureOptions.IgnoreCase),
+        new("my $", -2, FormatSignatureOptions.IgnoreCase),
+        new("our $", -1, FormatSignatureOptions.IgnoreCase),
+        new("package ", -2, FormatSignatureOptions.IgnoreCase),
+        new("=pod", -2, FormatSignatureOptions.IgnoreCase),
+        new("__DATA__", -2, FormatSignatureOptions.IgnoreCase),
+        new("__END__", -2, FormatSignatureOptions.IgnoreCase),
+        new("#", -1, FormatSignatureOptions.LineStart | FormatSignatureOptions.EveryMatch),
+    ];
+
+    public bool Detect(string path, string text) => Detect(path, text, FormatDetector.ScoreOf(this, text));
+
+    public bool Detect(string path, string text, int score) =>
+        PlFormatHelper.IsPlFile(path) && PlFormatHelper.LooksLikeProlog(text, score);
 }
 
 /// <summary>
@@ -38,12 +64,14 @@ public sealed class PrologDetector : IConfusedFormatDetector
 /// </summary>
 internal static class PlFormatHelper
 {
-    private const int SampleLength = 8192;
-
     internal static bool IsPlFile(string path) =>
         Path.GetExtension(path).Equals(".pl", StringComparison.OrdinalIgnoreCase);
 
-    internal static bool LooksLikeProlog(string text)
+    /// <param name="score">
+    /// The score of <see cref="PrologDetector.Signatures" /> at the head of the text, above 0 when it looks more like
+    /// Prolog than Perl.
+    /// </param>
+    internal static bool LooksLikeProlog(string text, int score)
     {
         if (string.IsNullOrWhiteSpace(text))
             return false;
@@ -63,83 +91,7 @@ internal static class PlFormatHelper
                 return true;
         }
 
-        if (span.Length > SampleLength)
-            span = span.Slice(0, SampleLength);
-
-        int prologScore = 0;
-        int perlScore = 0;
-
-        if (span.Contains(":-".AsSpan(), StringComparison.Ordinal))
-            prologScore += 3;
-
-        if (span.Contains("?-".AsSpan(), StringComparison.Ordinal))
-            prologScore += 2;
-
-        if (ContainsIgnoreCase(span, ":- module"))
-            prologScore += 3;
-
-        if (ContainsIgnoreCase(span, ":- use_module"))
-            prologScore += 3;
-
-        if (ContainsIgnoreCase(span, ":- dynamic"))
-            prologScore += 2;
-
-        if (ContainsIgnoreCase(span, ":- multifile"))
-            prologScore += 2;
-
-        if (ContainsIgnoreCase(span, ":- initialization"))
-            prologScore += 2;
-
-        if (ContainsIgnoreCase(span, "use strict"))
-            perlScore += 3;
-
-        if (ContainsIgnoreCase(span, "use warnings"))
-            perlScore += 2;
-
-        if (ContainsIgnoreCase(span, "use v5"))
-            perlScore += 2;
-
-        if (ContainsIgnoreCase(span, "sub "))
-            perlScore += 1;
-
-        if (ContainsIgnoreCase(span, "my $"))
-            perlScore += 2;
-
-        if (ContainsIgnoreCase(span, "our $"))
-            perlScore += 1;
-
-        if (ContainsIgnoreCase(span, "package "))
-            perlScore += 2;
-
-        if (ContainsIgnoreCase(span, "=pod"))
-            perlScore += 2;
-
-        if (ContainsIgnoreCase(span, "__DATA__"))
-            perlScore += 2;
-
-        if (ContainsIgnoreCase(span, "__END__"))
-            perlScore += 2;
-
-        foreach (ReadOnlySpan<char> line in new LineEnumerator(span))
-        {
-            ReadOnlySpan<char> trimmed = TrimStart(line);
-            if (trimmed.IsEmpty)
-                continue;
-
-            if (trimmed[0] == '%')
-                prologScore++;
-
-            if (trimmed[0] == '#')
-                perlScore++;
-        }
-
-        if (prologScore > perlScore)
-            return true;
-
-        if (perlScore > prologScore)
-            return false;
-
-        return false;
+        return score > 0;
     }
 
     private static ReadOnlySpan<char> SkipBom(ReadOnlySpan<char> span)
@@ -165,67 +117,8 @@ internal static class PlFormatHelper
         return true;
     }
 
-    private static ReadOnlySpan<char> TrimStart(ReadOnlySpan<char> span)
-    {
-        int i = 0;
-        while (i < span.Length && (span[i] == ' ' || span[i] == '\t'))
-            i++;
-
-        return span.Slice(i);
-    }
-
     private static bool ContainsIgnoreCase(ReadOnlySpan<char> haystack, string needle)
     {
         return haystack.Contains(needle.AsSpan(), StringComparison.OrdinalIgnoreCase);
     }
-
-    private ref struct LineEnumerator
-    {
-        private ReadOnlySpan<char> _remaining;
-        private ReadOnlySpan<char> _current;
-
-        public LineEnumerator(ReadOnlySpan<char> span)
-        {
-            _remaining = span;
-            _current = default;
-        }
-
-        public readonly ReadOnlySpan<char> Current => _current;
-
-        public readonly LineEnumerator GetEnumerator() => this;
-
-        public bool MoveNext()
-        {
-            if (_remaining.Length == 0)
-                return false;
-
-            for (int i = 0; i < _remaining.Length; i++)
-            {
-                char c = _remaining[i];
-
-                if (c != '\r' && c != '\n')
-                    continue;
-
-                _current = _remaining.Slice(0, i);
-
-                int nextStart = i + 1;
-
-                if (c == '\r'
-                    && nextStart < _remaining.Length
-                    && _remaining[nextStart] == '\n')
-                {
-                    nextStart++;
-                }
-
-                _remaining = _remaining.Slice(nextStart);
-
-                return true;
-            }
-
-            _current = _remaining;
-            _remaining = default;
-
-            return true;
-        }
-    }
 }
@@ -19,18 +19,26 @@ using System.Text.RegularExpressions;
 
 namespace QuickLook.Plugin.TextViewer.Detectors;
 
-public sealed class XMLDetector : IFormatDetector
+public sealed class XMLDetector : ISignatureFormatDetector
 {
     internal Regex Signature { get; } = new(@"<\?xml\b[^>]*\bversion\s*=\s*(['""])[^'""]*\1[^\?>]*\?>", RegexOptions.IgnoreCase);
 
+    public FormatSignature[] Signatures { get; } = [new("<?xml", 1, FormatSignatureOptions.IgnoreCase)];
+
     public string Name => "XML";
 
     public string Extension => ".xml";
 
-    public bool Detect(string path, string text)
+    public bool Detect(string path, string text) => Detect(path, text, FormatDetector.ScoreOf(this, text));
+
+    public bool Detect(string path, string text, int score)
     {
         _ = path;
 
+        // the declaration may only be missed in the head when there is more text than the head
+        if (score <= 0 && text.Length <= FormatDetector.SniffLength)
+            return false;
+
         return Signature.IsMatch(text);
     }
 }
@@ -0,0 +1,419 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using ICSharpCode.AvalonEdit.Highlighting;
+using QuickLook.Common.Helpers;
+using QuickLook.Plugin.TextViewer.Detectors;
+using QuickLook.Plugin.TextViewer.Themes;
+using QuickLook.Plugin.TextViewer.Themes.HighlightingDefinitions;
+using System;
+using System.Globalization;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using System.Windows;
+using System.Windows.Controls;
+using System.Windows.Controls.Primitives;
+using System.Windows.Input;
+using System.Windows.Media;
+using System.Windows.Threading;
+
+namespace QuickLook.Plugin.TextViewer;
+
+/// <summary>
+/// Shows text files too large for <see cref="TextViewerPanel" /> through the native line index. The file opens at once,
+/// its line ends are counted in the background, and only the visible lines are decoded, so a log of any size can be
+/// scrolled to any line without being cut off. The lines are highlighted by <see cref="NativeSyntax" />, which finds the
+/// spans in the background as well. Ctrl+F searches the whole file through <see cref="NativeFileSearch" />, from the line
+/// after the last match on.
+/// </summary>
+public sealed class LargeTextViewerPanel : Grid, IDisposable
+{
+    /// <summary>
+    /// Files up to this size are loaded whole into <see cref="TextViewerPanel" />.
+    /// </summary>
+    public const long Threshold = 5 * 1024 * 1024;
+
+    // head of the file the encoding is detected from
+    private const int EncodingSampleSize = 1024 * 1024;
+
+    // bytes indexed between two checks for disposal
+    private const uint BuildStep = 4 * 1024 * 1024;
+
+    // how often a search that found a match past the indexed part checks whether the index has got there
+    private static readonly TimeSpan IndexWaitInterval = TimeSpan.FromMilliseconds(100);
+
+    private readonly object _buildLock = new();
+    private readonly object _syntaxLock = new();
+    private readonly TextLinesView _view = new();
+    private readonly ScrollBar _verticalScrollBar = new() { Orientation = Orientation.Vertical };
+    private readonly ScrollBar _horizontalScrollBar = new() { Orientation = Orientation.Horizontal };
+    private readonly TextBlock _status = new() { Margin = new Thickness(8, 2, 8, 2), Opacity = 0.6 };
+    private readonly DispatcherTimer _progressTimer = new() { Interval = TimeSpan.FromMilliseconds(250) };
+
+    private readonly DockPanel _searchBar = new() { Margin = new Thickness(8, 2, 8, 2), Visibility = Visibility.Collapsed };
+    private readonly TextBox _searchBox = new() { MinWidth = 200 };
+    private readonly CheckBox _matchCase = new() { Margin = new Thickness(8, 0, 0, 0), VerticalAlignment = VerticalAlignment.Center };
+    private readonly CheckBox _regex = new() { Margin = new Thickness(8, 0, 0, 0), VerticalAlignment = VerticalAlignment.Center };
+    private readonly TextBlock _searchStatus = new() { Margin = new Thickness(8, 0, 0, 0), Opacity = 0.6, VerticalAlignment = VerticalAlignment.Center };
+
+    private readonly string _path;
+    private NativeTextLines _lines;
+    private NativeSyntax _syntax;
+    private CancellationTokenSource _search;
+    private int _building;
+    private bool _indexing;
+
+    private LargeTextViewerPanel(string path, NativeTextLines lines, HighlightingTheme highlighting)
+    {
+        _path = path;
+        _lines = lines;
+
+        RowDefinitions.Add(new RowDefinition { Height = new GridLength(1, GridUnitType.Star) });
+        RowDefinitions.Add(new RowDefinition { Height = GridLength.Auto });
+        RowDefinitions.Add(new RowDefinition { Height = GridLength.Auto });
+        ColumnDefinitions.Add(new ColumnDefinition { Width = new GridLength(1, GridUnitType.Star) });
+        ColumnDefinitions.Add(new ColumnDefinition { Width = GridLength.Auto });
+
+        _view.ClipToBounds = true;
+        _view.FontSize = Math.Max(1d, Math.Min(72d, SettingHelper.Get("FontSize", 14d, "QuickLook.Plugin.TextViewer")));
+        _view.FontFamily = new FontFamily(
+            SettingHelper.Get("FontFamily",
+                failsafe: TranslationHelper.Get("Editor_FontFamily",
+                domain: Assembly.GetExecutingAssembly().GetName().Name),
+            "QuickLook.Plugin.TextViewer"));
+        _view.MaxLineLength = TextViewerPanel.MAX_LINE_LENGTH;
+        _view.Ellipsis = TextViewerPanel.ELLIPSIS;
+        _view.Foreground = OSThemeHelper.AppsUseDarkTheme() ? Brushes.White : Brushes.Black;
+        if (highlighting.SyntaxHighlighting != null && !highlighting.IsDark && OSThemeHelper.AppsUseDarkTheme())
+        {
+            // light colors need a light background, as in TextViewerPanel
+            Background = new SolidColorBrush(Color.FromArgb(175, 255, 255, 255));
+            _view.Foreground = Brushes.Black;
+        }
+        _view.FirstLineChanged += View_FirstLineChanged;
+        Children.Add(_view);
+
+        SetColumn(_verticalScrollBar, 1);
+        _verticalScrollBar.Scroll += (_, e) => _view.FirstLine = (ulong)Math.Max(0, Math.Round(e.NewValue));
+        Children.Add(_verticalScrollBar);
+
+        // the status sits left of the horizontal scroll bar in the same row
+        var bottom = new DockPanel();
+        SetRow(bottom, 1);
+        DockPanel.SetDock(_status, Dock.Right);
+        bottom.Children.Add(_status);
+        _horizontalScrollBar.Scroll += (_, e) => _view.HorizontalOffset = e.NewValue;
+        bottom.Children.Add(_horizontalScrollBar);
+        Children.Add(bottom);
+
+        var domain = Assembly.GetExecutingAssembly().GetName().Name;
+        _searchBox.ToolTip = TranslationHelper.Get("Search_Placeholder", failsafe: "Search...", domain: domain);
+        _matchCase.Content = TranslationHelper.Get("Search_MatchCase", failsafe: "Match case", domain: domain);
+        _regex.Content = TranslationHelper.Get("Search_Regex", failsafe: "Regular expression", domain: domain);
+        _searchBox.TextChanged += (_, _) => _view.MarkedLine = null;
+        SetRow(_searchBar, 2);
+        SetColumnSpan(_searchBar, 2);
+        DockPanel.SetDock(_matchCase, Dock.Right);
+        DockPanel.SetDock(_regex, Dock.Right);
+        DockPanel.SetDock(_searchStatus, Dock.Right);
+        _searchBar.Children.Add(_searchStatus);
+        _searchBar.Children.Add(_regex);
+        _searchBar.Children.Add(_matchCase);
+        _searchBar.Children.Add(_searchBox);
+        Children.Add(_searchBar);
+        PreviewKeyDown += Panel_PreviewKeyDown;
+
+        _view.Lines = lines;
+        _progressTimer.Tick += (_, _) => _view.Refresh();
+        _progressTimer.Start();
+        _building = 1;
+        _indexing = true;
+        _ = Task.Run(Build);
+
+        if (highlighting.SyntaxHighlighting is { } definition and not ICustomHighlightingDefinition)
+        {
+            var encoding = lines.Encoding;
+            _building++;
+            _ = Task.Run(() => BuildSyntax(definition, encoding));
+        }
+    }
+
+    /// <summary>
+    /// Opens <paramref name="path" /> if it is too large for <see cref="TextViewerPanel" />.
+    /// </summary>
+    /// <returns>
+    /// The panel, or <see langword="null" /> if the file is small enough, converted by a <see cref="FormatDetector" />,
+    /// in an encoding the line index cannot split, or the native index is not available.
+    /// </returns>
+    public static LargeTextViewerPanel Open(string path)
+    {
+        if (FormatDetector.SupportedExtensions.Any(ext => path.EndsWith(ext, StringComparison.OrdinalIgnoreCase)))
+            return null;
+
+        byte[] sample;
+        bool truncated;
+        using (var s = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite))
+        {
+            if (s.Length <= Threshold)
+                return null;
+
+            sample = new byte[EncodingSampleSize];
+            var count = 0;
+            for (int read; count < sample.Length && (read = s.Read(sample, count, sample.Length - count)) > 0;)
+                count += read;
+            Array.Resize(ref sample, count);
+            truncated = count < s.Length;
+        }
+
+        var encoding = EncodingDetector.DetectFromBytes(sample, truncated);
+        var lines = NativeTextLines.Open(path, encoding);
+        if (lines == null)
+            return null;
+
+        var highlighting = HighlightingThemeManager.GetHighlightingByExtensionOrDetector(path, Path.GetExtension(path),
+            encoding.GetString(sample));
+        return new LargeTextViewerPanel(path, lines, highlighting);
+    }
+
+    public void Dispose()
+    {
+        _search?.Cancel();
+        _progressTimer.Stop();
+        _view.Lines = null;
+
+        // waits for the step being indexed, the index cannot be closed under it
+        lock (_buildLock)
+        {
+            _lines?.Dispose();
+            _lines = null;
+        }
+
+        _view.Syntax = null;
+        lock (_syntaxLock)
+        {
+            _syntax?.Dispose();
+            _syntax = null;
+        }
+    }
+
+    private void Build()
+    {
+        while (true)
+        {
+            lock (_buildLock)
+            {
+                if (_lines == null || !_lines.Build(BuildStep))
+                    break;
+            }
+        }
+
+        Dispatcher.BeginInvoke(() =>
+        {
+            _indexing = false;
+            BuildDone();
+        });
+    }
+
+    private void BuildSyntax(IHighlightingDefinition definition, Encoding encoding)
+    {
+        // the rules of a definition are compiled here the first time it is used
+        var syntax = NativeSyntax.Open(_path, NativeTextLines.PreambleLength(_path, encoding), encoding, definition);
+        if (syntax != null)
+        {
+            Dispatcher.Invoke(() =>
+            {
+                if (_lines == null)
+                {
+                    syntax.Dispose();
+                    syntax = null;
+                    return;
+                }
+
+                _syntax = syntax;
+                _view.Syntax = syntax;
+            });
+        }
+
+        while (syntax != null)
+        {
+            lock (_syntaxLock)
+            {
+                if (_syntax == null || !_syntax.Build(BuildStep))
+                    break;
+            }
+        }
+
+        Dispatcher.BeginInvoke(BuildDone);
+    }
+
+    // the view is drawn again as more of the file is indexed and lexed, until both are done
+    private void BuildDone()
+    {
+        if (--_building > 0)
+            return;
+
+        _progressTimer.Stop();
+        if (_lines != null)
+            _view.Refresh();
+    }
+
+    private void Panel_PreviewKeyDown(object sender, KeyEventArgs e)
+    {
+        if (e.Key == Key.F && Keyboard.Modifiers.HasFlag(ModifierKeys.Control))
+        {
+            _searchBar.Visibility = Visibility.Visible;
+            _searchBox.Focus();
+            _searchBox.SelectAll();
+        }
+        else if (e.Key == Key.F3 || e.Key == Key.Enter && _searchBox.IsKeyboardFocused)
+        {
+            FindNext();
+        }
+        else if (e.Key == Key.Escape && _searchBar.Visibility == Visibility.Visible)
+        {
+            _search?.Cancel();
+            _searchBar.Visibility = Visibility.Collapsed;
+            _view.MarkedLine = null;
+            _view.Focus();
+        }
+        else
+        {
+            return;
+        }
+
+        e.Handled = true;
+    }
+
+    /// <summary>
+    /// Marks the next line with a match, searching from the line after the one marked, or the first one shown, to the
+    /// end of the file and then from its start.
+    /// </summary>
+    private async void FindNext()
+    {
+        _search?.Cancel();
+        _search = null;
+
+        var pattern = _searchBox.Text;
+        if (_lines == null || string.IsNullOrEmpty(pattern))
+            return;
+
+        var cancellation = new CancellationTokenSource();
+        _search = cancellation;
+
+        var begin = _lines.StartOf(0) ?? 0;
+        var from = _lines.StartOf(_view.MarkedLine + 1 ?? _view.FirstLine) ?? begin;
+        var options = (_matchCase.IsChecked == true ? SearchOptions.None : SearchOptions.IgnoreCase) |
+                      (_regex.IsChecked == true ? SearchOptions.Regex : SearchOptions.None);
+        var path = _path;
+        var encoding = _lines.Encoding;
+
+        _searchStatus.Text = "…";
+        var offset = await Task.Run(() => Find(path, pattern, encoding, options, begin, from, cancellation.Token));
+        if (cancellation.IsCancellationRequested || _lines == null)
+            return;
+
+        var line = offset is { } found ? _lines.LineOf(found) : null;
+        if (line == null && offset != null)
+        {
+            // the match lies past the part indexed so far; its line is known once the index gets there
+            _searchStatus.Text = TranslationHelper.Get("Search_Indexing", failsafe: "Indexing…",
+                domain: Assembly.GetExecutingAssembly().GetName().Name);
+            while (line == null && _indexing)
+            {
+                try
+                {
+                    await Task.Delay(IndexWaitInterval, cancellation.Token);
+                }
+                catch (TaskCanceledException)
+                {
+                    return;
+                }
+
+                if (_lines == null)
+                    return;
+
+                line = _lines.LineOf(offset.Value);
+            }
+
+            // the last step may have been indexed after the check above
+            line ??= _lines.LineOf(offset.Value);
+        }
+
+        _search = null;
+        if (line == null)
+        {
+            _searchStatus.Text = TranslationHelper.Get("Search_NoMatches", failsafe: "No matches",
+                domain: Assembly.GetExecutingAssembly().GetName().Name);
+            return;
+        }
+
+        _searchStatus.Text = string.Empty;
+        _view.MarkedLine = line;
+        var above = (ulong)(_view.VisibleLines / 3);
+        _view.FirstLine = line.Value > above ? line.Value - above : 0;
+    }
+
+    private static ulong? Find(string path, string pattern, Encoding encoding, SearchOptions options, ulong begin,
+        ulong from, CancellationToken token)
+    {
+        using var search = NativeFileSearch.Open(path, pattern, encoding, options);
+        if (search == null)
+            return null;
+
+        ulong? found = null;
+        bool First(SearchMatch[] matches, ulong searched)
+        {
+            if (matches.Length == 0)
+                return true;
+
+            found = matches[0].Offset;
+            return false;
+        }
+
+        search.Run(from, search.Size, First, token);
+        if (found == null && from > begin && !token.IsCancellationRequested)
+            search.Run(begin, from, First, token);
+        return found;
+    }
+
+    private void View_FirstLineChanged(object sender, EventArgs e)
+    {
+        var visible = _view.VisibleLines;
+        _verticalScrollBar.Maximum = _view.MaxFirstLine;
+        _verticalScrollBar.ViewportSize = visible;
+        _verticalScrollBar.LargeChange = visible;
+        _verticalScrollBar.SmallChange = 1;
+        _verticalScrollBar.Value = _view.FirstLine;
+
+        _horizontalScrollBar.Maximum = _view.MaxHorizontalOffset;
+        _horizontalScrollBar.ViewportSize = _view.ActualWidth;
+        _horizontalScrollBar.LargeChange = _view.ActualWidth;
+        _horizontalScrollBar.SmallChange = _view.FontSize;
+        _horizontalScrollBar.Value = _view.HorizontalOffset;
+        _horizontalScrollBar.Visibility = _view.MaxHorizontalOffset > 0 ? Visibility.Visible : Visibility.Hidden;
+
+        if (_lines == null)
+            return;
+
+        var lines = _lines.LineCount.ToString("N0", CultureInfo.CurrentCulture);
+        _status.Text = _lines.IsIndexed ? lines : $"{lines} ({_lines.Progress:P0})";
+    }
+}
@@ -0,0 +1,270 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+
+namespace QuickLook.Plugin.TextViewer;
+
+/// <summary>
+/// Whole-file search by QuickLook.Native. The file is searched by several threads at once through memory-mapped
+/// windows, for plain text or a regular expression in the bytes of the file's encoding, and the matches come in
+/// file order while the rest of the file is still being searched.
+/// This file is also linked into the CSV and binary viewers.
+/// </summary>
+internal sealed class NativeFileSearch : IDisposable
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+    private static readonly int MatchSize = Marshal.SizeOf<SearchMatch>();
+
+    private static volatile bool _unavailable;
+
+    private nint _handle;
+
+    private NativeFileSearch(nint handle)
+    {
+        _handle = handle;
+    }
+
+    /// <summary>
+    /// Opens the specified file to search for <paramref name="pattern" /> in text in <paramref name="encoding" />.
+    /// With <see cref="SearchOptions.Regex" /> the pattern is a regular expression of the usual subset: no
+    /// look-arounds, back references or word boundaries, and case is ignored for ASCII letters only.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeFileSearch" />, or <see langword="null" /> if the file cannot be opened, the pattern is
+    /// invalid or matches empty text, the encoding is not UTF-8, UTF-16 or a single-byte code page, or the native
+    /// search is not available.
+    /// </returns>
+    public static NativeFileSearch Open(string path, string pattern, Encoding encoding, SearchOptions options)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+        _ = pattern ?? throw new ArgumentNullException(nameof(pattern));
+        _ = encoding ?? throw new ArgumentNullException(nameof(encoding));
+
+        SearchEncoding searchEncoding;
+        switch (encoding)
+        {
+            case UTF8Encoding:
+                searchEncoding = SearchEncoding.Utf8;
+                break;
+
+            case UnicodeEncoding:
+                searchEncoding = encoding.CodePage == 1201 ? SearchEncoding.Utf16BE : SearchEncoding.Utf16LE;
+                break;
+
+            case { IsSingleByte: true }:
+                // the native side sees bytes, so the pattern becomes the bytes of the code page; the syntax of a
+                // regular expression is ASCII, which every code page keeps
+                searchEncoding = SearchEncoding.Bytes;
+                pattern = new string(encoding.GetBytes(pattern).Select(b => (char)b).ToArray());
+                break;
+
+            default:
+                return null;
+        }
+
+        return Open(path, pattern, searchEncoding, options);
+    }
+
+    /// <summary>
+    /// Opens the specified file to search for the bytes of <paramref name="pattern" />.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeFileSearch" />, or <see langword="null" /> if the file cannot be opened or the native search
+    /// is not available.
+    /// </returns>
+    public static NativeFileSearch Open(string path, byte[] pattern)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+        _ = pattern ?? throw new ArgumentNullException(nameof(pattern));
+
+        return Open(path, new string(pattern.Select(b => (char)b).ToArray()), SearchEncoding.Bytes, SearchOptions.None);
+    }
+
+    /// <summary>
+    /// Searches the bytes [<paramref name="from" />, <paramref name="to" />), which are taken as the whole text, so lines
+    /// begin at <paramref name="from" />. <paramref name="onMatches" /> is called on the search threads, one call at a
+    /// time, with the next matches in file order and the number of bytes searched so far; it returns
+    /// <see langword="false" /> to stop. Matches never overlap.
+    /// </summary>
+    /// <returns>
+    /// <see langword="true" /> if the whole range was searched; <see langword="false" /> if the search was stopped,
+    /// cancelled through <paramref name="token" /> or the file could not be read.
+    /// </returns>
+    public bool Run(ulong from, ulong to, Func<SearchMatch[], ulong, bool> onMatches, CancellationToken token)
+    {
+        _ = onMatches ?? throw new ArgumentNullException(nameof(onMatches));
+        var handle = ThrowIfDisposed();
+
+        SearchCallback callback = (matches, count, searched, _) =>
+        {
+            try
+            {
+                var batch = new SearchMatch[count];
+                for (var i = 0; i < batch.Length; i++)
+                    batch[i] = Marshal.PtrToStructure<SearchMatch>(matches + i * MatchSize);
+                return onMatches(batch, searched) ? 1 : 0;
+            }
+            catch (Exception e)
+            {
+                // an exception must not unwind through the native threads
+                Debug.WriteLine(e);
+                return 0;
+            }
+        };
+
+        using (token.Register(() => Cancel(handle)))
+        {
+            // 0 threads lets the native side pick a count from the number of processors
+            var done = IsArm64 ? SearchRun_arm64(handle, from, to, 0, callback, 0)
+                : Is64Bit ? SearchRun_64(handle, from, to, 0, callback, 0)
+                : SearchRun_32(handle, from, to, 0, callback, 0);
+            GC.KeepAlive(callback);
+            return done;
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        if (IsArm64)
+            SearchClose_arm64(_handle);
+        else if (Is64Bit)
+            SearchClose_64(_handle);
+        else
+            SearchClose_32(_handle);
+        _handle = 0;
+    }
+
+    private static NativeFileSearch Open(string path, string pattern, SearchEncoding encoding, SearchOptions options)
+    {
+        if (_unavailable || pattern.Length == 0)
+            return null;
+
+        try
+        {
+            var length = (uint)pattern.Length;
+            var handle = IsArm64 ? SearchOpen_arm64(path, pattern, length, encoding, options)
+                : Is64Bit ? SearchOpen_64(path, pattern, length, encoding, options)
+                : SearchOpen_32(path, pattern, length, encoding, options);
+            if (handle != 0)
+                return new NativeFileSearch(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeFileSearch));
+    }
+
+    private static void Cancel(nint handle)
+    {
+        if (IsArm64)
+            SearchCancel_arm64(handle);
+        else if (Is64Bit)
+            SearchCancel_64(handle);
+        else
+            SearchCancel_32(handle);
+    }
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    private delegate int SearchCallback(nint matches, uint count, ulong searched, nint context);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SearchOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SearchOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [MarshalAs(UnmanagedType.LPWStr)] string pattern, uint length, SearchEncoding encoding, SearchOptions flags);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SearchClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SearchClose_32(nint search);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SearchRun", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SearchRun_32(nint search, ulong from, ulong to, uint threads, SearchCallback callback, nint context);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SearchCancel", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SearchCancel_32(nint search);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SearchOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SearchOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [MarshalAs(UnmanagedType.LPWStr)] string pattern, uint length, SearchEncoding encoding, SearchOptions flags);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SearchClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SearchClose_64(nint search);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SearchRun", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SearchRun_64(nint search, ulong from, ulong to, uint threads, SearchCallback callback, nint context);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SearchCancel", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SearchCancel_64(nint search);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SearchOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SearchOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path,
+        [MarshalAs(UnmanagedType.LPWStr)] string pattern, uint length, SearchEncoding encoding, SearchOptions flags);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SearchClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SearchClose_arm64(nint search);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SearchRun", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SearchRun_arm64(nint search, ulong from, ulong to, uint threads, SearchCallback callback, nint context);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SearchCancel", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SearchCancel_arm64(nint search);
+
+    // Must match RegexDfa::Encoding in QuickLook.Native/QuickLook.Native32/RegexDfa.h
+    private enum SearchEncoding : uint
+    {
+        Bytes = 0,
+        Utf8 = 1,
+        Utf16LE = 2,
+        Utf16BE = 3,
+    }
+}
+
+// Must match FileSearch::Flags in QuickLook.Native/QuickLook.Native32/FileSearch.h
+[Flags]
+internal enum SearchOptions : uint
+{
+    None = 0,
+    IgnoreCase = 0x1, // ASCII letters only
+    Regex = 0x2,
+}
+
+// Must match FileSearch::Match in QuickLook.Native/QuickLook.Native32/FileSearch.h
+[StructLayout(LayoutKind.Sequential)]
+internal struct SearchMatch
+{
+    public ulong Offset;
+    public ulong Length;
+}
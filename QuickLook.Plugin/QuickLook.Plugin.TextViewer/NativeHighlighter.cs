@@ -0,0 +1,170 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using ICSharpCode.AvalonEdit.Document;
+using ICSharpCode.AvalonEdit.Highlighting;
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Threading.Tasks;
+using System.Windows.Threading;
+
+namespace QuickLook.Plugin.TextViewer;
+
+/// <summary>
+/// Highlights a document too long for AvalonEdit's own highlighter through <see cref="NativeSyntax" />. The spans are
+/// found on a background thread, and the lines found so far are drawn again as it goes on. The document must not
+/// change.
+/// </summary>
+internal sealed class NativeHighlighter : IHighlighter
+{
+    // UTF-16 bytes lexed between two redraws
+    private const uint BuildStep = 2 * 1024 * 1024;
+
+    private readonly object _buildLock = new();
+    private readonly IHighlightingDefinition _definition;
+    private readonly Dispatcher _dispatcher;
+    private NativeSyntax _syntax;
+    private int _lines;
+
+    private NativeHighlighter(TextDocument document, IHighlightingDefinition definition, NativeSyntax syntax,
+        Dispatcher dispatcher)
+    {
+        Document = document;
+        _definition = definition;
+        _syntax = syntax;
+        _dispatcher = dispatcher;
+        _lines = (int)Math.Min(syntax.LineCount, int.MaxValue);
+    }
+
+    public event HighlightingStateChangedEventHandler HighlightingStateChanged;
+
+    public IDocument Document { get; }
+
+    public HighlightingColor DefaultTextColor => null;
+
+    /// <summary>
+    /// Lexes the first part of <paramref name="text" />, the text of <paramref name="document" />, and goes on with the
+    /// rest in the background, redrawing through <paramref name="dispatcher" />, the one of the document. Call it off
+    /// the UI thread, as compiling the rules the first time may take a moment.
+    /// </summary>
+    /// <returns>
+    /// The highlighter, or <see langword="null" /> if the text has line ends AvalonEdit knows but the lexer does not, or
+    /// the native lexer is not available.
+    /// </returns>
+    public static NativeHighlighter Open(TextDocument document, string text, IHighlightingDefinition definition,
+        Dispatcher dispatcher)
+    {
+        _ = document ?? throw new ArgumentNullException(nameof(document));
+        _ = text ?? throw new ArgumentNullException(nameof(text));
+        _ = definition ?? throw new ArgumentNullException(nameof(definition));
+        _ = dispatcher ?? throw new ArgumentNullException(nameof(dispatcher));
+
+        // a CR without an LF after it ends a line in the document
+        for (var i = text.IndexOf('\r'); i >= 0; i = text.IndexOf('\r', i + 1))
+        {
+            if (i + 1 == text.Length || text[i + 1] != '\n')
+                return null;
+        }
+
+        var syntax = NativeSyntax.Open(text, definition);
+        if (syntax == null)
+            return null;
+
+        syntax.Build(BuildStep);
+        var highlighter = new NativeHighlighter(document, definition, syntax, dispatcher);
+        _ = Task.Run(highlighter.Build);
+        return highlighter;
+    }
+
+    public HighlightedLine HighlightLine(int lineNumber)
+    {
+        var documentLine = Document.GetLineByNumber(lineNumber);
+        var line = new HighlightedLine(Document, documentLine);
+        if (_syntax == null || lineNumber > _lines)
+            return line;
+
+        var lines = _syntax.Tokenize((ulong)lineNumber - 1, 1, Math.Max(documentLine.Length, 1));
+        foreach (var section in lines.SelectMany(sections => sections))
+        {
+            section.Offset += documentLine.Offset;
+            line.Sections.Add(section);
+        }
+        return line;
+    }
+
+    public IEnumerable<HighlightingColor> GetColorStack(int lineNumber)
+    {
+        return [];
+    }
+
+    public void UpdateHighlightingState(int lineNumber)
+    {
+    }
+
+    public void BeginHighlighting()
+    {
+    }
+
+    public void EndHighlighting()
+    {
+    }
+
+    public HighlightingColor GetNamedColor(string name)
+    {
+        return _definition.GetNamedColor(name);
+    }
+
+    public void Dispose()
+    {
+        // waits for the step being lexed, the lexer cannot be closed under it
+        lock (_buildLock)
+        {
+            _syntax?.Dispose();
+            _syntax = null;
+        }
+    }
+
+    private void Build()
+    {
+        while (true)
+        {
+            bool more;
+            ulong lines;
+            lock (_buildLock)
+            {
+                if (_syntax == null)
+                    return;
+
+                more = _syntax.Build(BuildStep);
+                lines = _syntax.LineCount;
+            }
+
+            // the lines lexed in this step are drawn again, from the end of the one before them
+            _dispatcher.BeginInvoke(() =>
+            {
+                var from = _lines;
+                _lines = (int)Math.Min(lines, (ulong)Document.LineCount);
+                if (_syntax != null && _lines > from)
+                    HighlightingStateChanged?.Invoke(Math.Max(from, 1), _lines);
+            }, DispatcherPriority.Background);
+
+            if (!more)
+                return;
+        }
+    }
+}
@@ -0,0 +1,589 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using ICSharpCode.AvalonEdit.Highlighting;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Text.RegularExpressions;
+
+namespace QuickLook.Plugin.TextViewer;
+
+/// <summary>
+/// Syntax highlighting of a text of any size by QuickLook.Native. The rules of a highlighting definition are compiled
+/// once into DFAs, <see cref="Build" /> finds where the spans begin and end in the whole text on a background thread,
+/// and <see cref="Tokenize" /> colors just the lines asked for, each from the spans open at its start.
+/// Patterns are matched like AvalonEdit does, but take the longest match instead of the first alternative that
+/// matches, and support look-arounds only at their start and end; rules that cannot be compiled are left out.
+/// </summary>
+internal sealed class NativeSyntax : IDisposable
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    // compiled rules by definition and code page; they are shared by every lexer and never freed
+    private static readonly Dictionary<IHighlightingDefinition, Dictionary<int, Rules>> RulesCache = [];
+
+    private static volatile bool _unavailable;
+
+    private readonly Rules _rules;
+    private readonly Dictionary<ulong, HighlightingColor> _colors = [];
+    private nint _handle;
+    private SyntaxToken[] _tokens = new SyntaxToken[4096];
+    private uint[] _tokenEnds = [];
+
+    private NativeSyntax(nint handle, Rules rules)
+    {
+        _handle = handle;
+        _rules = rules;
+    }
+
+    /// <summary>
+    /// Gets the number of lines whose spans are found so far; the last line only counts once all of the text is lexed.
+    /// </summary>
+    public ulong LineCount => GetInfo().Lines;
+
+    /// <summary>
+    /// Gets whether the whole text is lexed.
+    /// </summary>
+    public bool IsLexed => GetInfo() is var info && info.Lexed == info.Size;
+
+    /// <summary>
+    /// Opens the specified file with text in <paramref name="encoding" /> to highlight by <paramref name="definition" />.
+    /// The first line begins at <paramref name="start" />, after any byte order mark, as for <see cref="NativeTextLines" />.
+    /// Compiling the rules of a definition the first time may take a moment.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeSyntax" />, or <see langword="null" /> if the file cannot be opened, the encoding is not UTF-8,
+    /// UTF-16 or a single-byte code page, or the native lexer is not available.
+    /// </returns>
+    public static NativeSyntax Open(string path, ulong start, Encoding encoding, IHighlightingDefinition definition)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+        _ = encoding ?? throw new ArgumentNullException(nameof(encoding));
+        _ = definition ?? throw new ArgumentNullException(nameof(definition));
+
+        return Open(encoding, definition, rules => IsArm64 ? SyntaxLexerOpen_arm64(path, start, rules)
+            : Is64Bit ? SyntaxLexerOpen_64(path, start, rules) : SyntaxLexerOpen_32(path, start, rules));
+    }
+
+    /// <summary>
+    /// Opens a copy of <paramref name="text" /> to highlight by <paramref name="definition" />. Lines end with LF, with
+    /// or without a CR before it.
+    /// </summary>
+    /// <returns>The <see cref="NativeSyntax" />, or <see langword="null" /> if the native lexer is not available.</returns>
+    public static NativeSyntax Open(string text, IHighlightingDefinition definition)
+    {
+        _ = text ?? throw new ArgumentNullException(nameof(text));
+        _ = definition ?? throw new ArgumentNullException(nameof(definition));
+
+        var length = (ulong)text.Length;
+        return Open(Encoding.Unicode, definition, rules => IsArm64 ? SyntaxLexerOpenText_arm64(text, length, rules)
+            : Is64Bit ? SyntaxLexerOpenText_64(text, length, rules) : SyntaxLexerOpenText_32(text, length, rules));
+    }
+
+    /// <summary>
+    /// Finds the spans in the lines in the next <paramref name="bytes" /> bytes of the text. Can run on another thread
+    /// than the other members, but on only one at a time.
+    /// </summary>
+    /// <returns><see langword="false" /> once the whole text is lexed, or if it cannot be read.</returns>
+    public bool Build(uint bytes)
+    {
+        var handle = ThrowIfDisposed();
+        return IsArm64 ? SyntaxLexerBuild_arm64(handle, bytes)
+            : Is64Bit ? SyntaxLexerBuild_64(handle, bytes) : SyntaxLexerBuild_32(handle, bytes);
+    }
+
+    /// <summary>
+    /// Colors up to <paramref name="count" /> lines from <paramref name="firstLine" /> on, up to character
+    /// <paramref name="maxLength" /> of each. Lines past what is lexed so far are left out.
+    /// </summary>
+    /// <returns>The colored sections of each line, with offsets from the start of the line.</returns>
+    public List<HighlightedSection>[] Tokenize(ulong firstLine, int count, int maxLength)
+    {
+        var handle = ThrowIfDisposed();
+        if (count <= 0 || maxLength <= 0)
+            return [];
+
+        if (_tokenEnds.Length < count)
+            _tokenEnds = new uint[count];
+
+        // tokens that do not fit are left out, so a full buffer is tried again twice the size
+        int found;
+        while (true)
+        {
+            var capacity = (uint)_tokens.Length;
+            found = (int)(IsArm64 ? SyntaxLexerTokenize_arm64(handle, firstLine, (uint)count, (uint)maxLength, _tokens, capacity, _tokenEnds)
+                : Is64Bit ? SyntaxLexerTokenize_64(handle, firstLine, (uint)count, (uint)maxLength, _tokens, capacity, _tokenEnds)
+                : SyntaxLexerTokenize_32(handle, firstLine, (uint)count, (uint)maxLength, _tokens, capacity, _tokenEnds));
+            if (found == 0 || _tokenEnds[found - 1] < capacity || _tokens.Length >= count * maxLength)
+                break;
+
+            _tokens = new SyntaxToken[_tokens.Length * 2];
+        }
+
+        var lines = new List<HighlightedSection>[found];
+        var token = 0;
+        for (var i = 0; i < found; i++)
+        {
+            lines[i] = [];
+            for (; token < _tokenEnds[i]; token++)
+            {
+                var run = _tokens[token];
+                if (GetColor(handle, run.Frame, run.Color) is { } color)
+                    lines[i].Add(new HighlightedSection { Offset = (int)run.Start, Length = (int)run.Length, Color = color });
+            }
+        }
+        return lines;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private static NativeSyntax Open(Encoding encoding, IHighlightingDefinition definition, Func<nint, nint> open)
+    {
+        if (_unavailable)
+            return null;
+
+        try
+        {
+            var rules = GetRules(definition, encoding);
+            if (rules == null)
+                return null;
+
+            var handle = open(rules.Handle);
+            if (handle != 0)
+                return new NativeSyntax(handle, rules);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    private static Rules GetRules(IHighlightingDefinition definition, Encoding encoding)
+    {
+        SyntaxEncoding syntaxEncoding;
+        switch (encoding)
+        {
+            case UTF8Encoding:
+                syntaxEncoding = SyntaxEncoding.Utf8;
+                break;
+
+            case UnicodeEncoding:
+                syntaxEncoding = encoding.CodePage == 1201 ? SyntaxEncoding.Utf16BE : SyntaxEncoding.Utf16LE;
+                break;
+
+            case { IsSingleByte: true }:
+                syntaxEncoding = SyntaxEncoding.Bytes;
+                break;
+
+            default:
+                return null;
+        }
+
+        lock (RulesCache)
+        {
+            if (!RulesCache.TryGetValue(definition, out var byCodePage))
+                RulesCache.Add(definition, byCodePage = []);
+
+            // rules that fail to compile are not tried again
+            if (!byCodePage.TryGetValue(encoding.CodePage, out var rules))
+                byCodePage.Add(encoding.CodePage, rules = Rules.Compile(definition, encoding, syntaxEncoding));
+            return rules;
+        }
+    }
+
+    private HighlightingColor GetColor(nint handle, uint frame, uint color)
+    {
+        var key = (ulong)frame << 32 | color;
+        if (_colors.TryGetValue(key, out var merged))
+            return merged;
+
+        // the colors of the spans open around a token, from the outermost in, and then its own
+        var chain = new List<uint> { color };
+        for (var id = frame; id != 0;)
+        {
+            if (!(IsArm64 ? SyntaxLexerGetFrame_arm64(handle, id, out id, out var spanColor)
+                : Is64Bit ? SyntaxLexerGetFrame_64(handle, id, out id, out spanColor)
+                : SyntaxLexerGetFrame_32(handle, id, out id, out spanColor)))
+                break;
+
+            chain.Add(spanColor);
+        }
+
+        foreach (var id in Enumerable.Reverse(chain))
+        {
+            if (id == 0)
+                continue;
+
+            merged ??= new HighlightingColor();
+            merged.MergeWith(_rules.Colors[id]);
+        }
+
+        merged?.Freeze();
+        _colors.Add(key, merged);
+        return merged;
+    }
+
+    private SyntaxLexerInfo GetInfo()
+    {
+        var handle = ThrowIfDisposed();
+        return (IsArm64 ? SyntaxLexerGetInfo_arm64(handle, out var info)
+            : Is64Bit ? SyntaxLexerGetInfo_64(handle, out info) : SyntaxLexerGetInfo_32(handle, out info)) ? info : default;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeSyntax));
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            SyntaxLexerClose_arm64(handle);
+        else if (Is64Bit)
+            SyntaxLexerClose_64(handle);
+        else
+            SyntaxLexerClose_32(handle);
+    }
+
+    /// <summary>
+    /// The rules of a definition compiled for one encoding, with the colors they refer to by index; 0 is none.
+    /// </summary>
+    private sealed class Rules
+    {
+        private Rules(nint handle, HighlightingColor[] colors)
+        {
+            Handle = handle;
+            Colors = colors;
+        }
+
+        public nint Handle { get; }
+
+        public HighlightingColor[] Colors { get; }
+
+        public static Rules Compile(IHighlightingDefinition definition, Encoding encoding, SyntaxEncoding syntaxEncoding)
+        {
+            var ruleSetIds = new Dictionary<HighlightingRuleSet, uint>();
+            var ruleSets = new List<HighlightingRuleSet>();
+            var colorIds = new Dictionary<HighlightingColor, uint>();
+            var colors = new List<HighlightingColor> { null };
+            var rules = new List<SyntaxRule>();
+            var text = new StringBuilder();
+
+            uint RuleSetOf(HighlightingRuleSet ruleSet)
+            {
+                if (ruleSet == null)
+                    return uint.MaxValue;
+
+                if (!ruleSetIds.TryGetValue(ruleSet, out var id))
+                {
+                    ruleSetIds.Add(ruleSet, id = (uint)ruleSets.Count);
+                    ruleSets.Add(ruleSet);
+                }
+                return id;
+            }
+
+            uint ColorOf(HighlightingColor color)
+            {
+                if (color == null)
+                    return 0;
+
+                if (!colorIds.TryGetValue(color, out var id))
+                {
+                    colorIds.Add(color, id = (uint)colors.Count);
+                    colors.Add(color);
+                }
+                return id;
+            }
+
+            // the pattern is appended to the text; null if it cannot be matched in the encoding
+            bool Append(Regex regex, out uint start, out uint length)
+            {
+                var pattern = ToPattern(regex, encoding, syntaxEncoding);
+                start = (uint)text.Length;
+                length = (uint)(pattern?.Length ?? 0);
+                text.Append(pattern);
+                return pattern != null;
+            }
+
+            RuleSetOf(definition.MainRuleSet);
+            for (var i = 0; i < ruleSets.Count; i++)
+            {
+                foreach (var span in ruleSets[i].Spans)
+                {
+                    uint end = 0, endLength = 0;
+                    if (!Append(span.StartExpression, out var begin, out var beginLength) ||
+                        span.EndExpression != null && !Append(span.EndExpression, out end, out endLength))
+                        continue;
+
+                    rules.Add(new SyntaxRule
+                    {
+                        RuleSet = (uint)i,
+                        Kind = SyntaxRuleKind.Span,
+                        Begin = begin,
+                        BeginLength = beginLength,
+                        End = end,
+                        EndLength = endLength,
+                        Color = ColorOf(span.SpanColor),
+                        BeginColor = ColorOf(span.StartColor),
+                        EndColor = ColorOf(span.EndColor),
+                        Inner = RuleSetOf(span.RuleSet),
+                    });
+                }
+
+                foreach (var rule in ruleSets[i].Rules)
+                {
+                    if (!Append(rule.Regex, out var begin, out var beginLength))
+                        continue;
+
+                    rules.Add(new SyntaxRule
+                    {
+                        RuleSet = (uint)i,
+                        Kind = SyntaxRuleKind.Rule,
+                        Begin = begin,
+                        BeginLength = beginLength,
+                        Color = ColorOf(rule.Color),
+                        Inner = uint.MaxValue,
+                    });
+                }
+            }
+
+            var all = rules.ToArray();
+            var patterns = text.ToString();
+            var handle = IsArm64 ? SyntaxRulesCompile_arm64(all, (uint)all.Length, patterns, (uint)patterns.Length, syntaxEncoding)
+                : Is64Bit ? SyntaxRulesCompile_64(all, (uint)all.Length, patterns, (uint)patterns.Length, syntaxEncoding)
+                : SyntaxRulesCompile_32(all, (uint)all.Length, patterns, (uint)patterns.Length, syntaxEncoding);
+            if (handle == 0)
+                return null;
+
+            var dropped = IsArm64 ? SyntaxRulesGetDropped_arm64(handle)
+                : Is64Bit ? SyntaxRulesGetDropped_64(handle) : SyntaxRulesGetDropped_32(handle);
+            Debug.WriteLine($"{definition.Name}: {all.Length} rules, {dropped} dropped");
+
+            return new Rules(handle, [.. colors]);
+        }
+
+        private static string ToPattern(Regex regex, Encoding encoding, SyntaxEncoding syntaxEncoding)
+        {
+            var pattern = regex.ToString();
+            if (regex.Options.HasFlag(RegexOptions.IgnorePatternWhitespace))
+                pattern = StripWhitespace(pattern);
+
+            // an empty end matches at once, which the native side takes for no end at all
+            if (pattern.Length == 0)
+                pattern = "()";
+
+            if (regex.Options.HasFlag(RegexOptions.IgnoreCase))
+                pattern = "(?i)" + pattern;
+
+            if (syntaxEncoding != SyntaxEncoding.Bytes)
+                return pattern;
+
+            // as for NativeFileSearch, the pattern becomes the bytes of the code page, unless it has characters the code
+            // page does not have, which would become question marks
+            var bytes = encoding.GetBytes(pattern);
+            return encoding.GetString(bytes) == pattern ? new string(bytes.Select(b => (char)b).ToArray()) : null;
+        }
+
+        // drops the whitespace and comments that RegexOptions.IgnorePatternWhitespace ignores
+        private static string StripWhitespace(string pattern)
+        {
+            var result = new StringBuilder(pattern.Length);
+            var inClass = false;
+            for (var i = 0; i < pattern.Length; i++)
+            {
+                var c = pattern[i];
+                if (c == '\\' && i + 1 < pattern.Length)
+                {
+                    result.Append(c).Append(pattern[++i]);
+                }
+                else if (inClass)
+                {
+                    inClass = c != ']';
+                    result.Append(c);
+                }
+                else if (c == '#')
+                {
+                    while (i + 1 < pattern.Length && pattern[i + 1] != '\n')
+                        i++;
+                }
+                else if (!char.IsWhiteSpace(c))
+                {
+                    inClass = c == '[';
+                    result.Append(c);
+                }
+            }
+            return result.ToString();
+        }
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxRulesCompile", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxRulesCompile_32([In] SyntaxRule[] rules, uint count,
+        [MarshalAs(UnmanagedType.LPWStr)] string text, uint textLength, SyntaxEncoding encoding);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxRulesGetDropped", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint SyntaxRulesGetDropped_32(nint rules);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxLexerOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path, ulong start, nint rules);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerOpenText", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxLexerOpenText_32([MarshalAs(UnmanagedType.LPWStr)] string text, ulong length, nint rules);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SyntaxLexerClose_32(nint lexer);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerGetInfo_32(nint lexer, out SyntaxLexerInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerBuild_32(nint lexer, uint bytes);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerTokenize", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint SyntaxLexerTokenize_32(nint lexer, ulong firstLine, uint count, uint maxColumn,
+        [Out] SyntaxToken[] tokens, uint capacity, [Out] uint[] tokenEnds);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SyntaxLexerGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerGetFrame_32(nint lexer, uint frame, out uint parent, out uint color);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxRulesCompile", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxRulesCompile_64([In] SyntaxRule[] rules, uint count,
+        [MarshalAs(UnmanagedType.LPWStr)] string text, uint textLength, SyntaxEncoding encoding);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxRulesGetDropped", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint SyntaxRulesGetDropped_64(nint rules);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxLexerOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path, ulong start, nint rules);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerOpenText", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxLexerOpenText_64([MarshalAs(UnmanagedType.LPWStr)] string text, ulong length, nint rules);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SyntaxLexerClose_64(nint lexer);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerGetInfo_64(nint lexer, out SyntaxLexerInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerBuild_64(nint lexer, uint bytes);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerTokenize", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint SyntaxLexerTokenize_64(nint lexer, ulong firstLine, uint count, uint maxColumn,
+        [Out] SyntaxToken[] tokens, uint capacity, [Out] uint[] tokenEnds);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SyntaxLexerGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerGetFrame_64(nint lexer, uint frame, out uint parent, out uint color);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxRulesCompile", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxRulesCompile_arm64([In] SyntaxRule[] rules, uint count,
+        [MarshalAs(UnmanagedType.LPWStr)] string text, uint textLength, SyntaxEncoding encoding);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxRulesGetDropped", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint SyntaxRulesGetDropped_arm64(nint rules);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxLexerOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path, ulong start, nint rules);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerOpenText", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint SyntaxLexerOpenText_arm64([MarshalAs(UnmanagedType.LPWStr)] string text, ulong length, nint rules);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SyntaxLexerClose_arm64(nint lexer);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerGetInfo_arm64(nint lexer, out SyntaxLexerInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerBuild_arm64(nint lexer, uint bytes);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerTokenize", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint SyntaxLexerTokenize_arm64(nint lexer, ulong firstLine, uint count, uint maxColumn,
+        [Out] SyntaxToken[] tokens, uint capacity, [Out] uint[] tokenEnds);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SyntaxLexerGetFrame", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool SyntaxLexerGetFrame_arm64(nint lexer, uint frame, out uint parent, out uint color);
+
+    // Must match RegexDfa::Encoding in QuickLook.Native/QuickLook.Native32/RegexDfa.h
+    private enum SyntaxEncoding : uint
+    {
+        Bytes = 0,
+        Utf8 = 1,
+        Utf16LE = 2,
+        Utf16BE = 3,
+    }
+
+    // Must match SyntaxRules::Kind in QuickLook.Native/QuickLook.Native32/SyntaxRules.h
+    private enum SyntaxRuleKind : uint
+    {
+        Rule = 0,
+        Span = 1,
+    }
+
+    // Must match SyntaxRules::Rule in QuickLook.Native/QuickLook.Native32/SyntaxRules.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SyntaxRule
+    {
+        public uint RuleSet;
+        public SyntaxRuleKind Kind;
+        public uint Begin;
+        public uint BeginLength;
+        public uint End;
+        public uint EndLength;
+        public uint Color;
+        public uint BeginColor;
+        public uint EndColor;
+        public uint Inner;
+    }
+
+    // Must match SyntaxLexer::Info in QuickLook.Native/QuickLook.Native32/SyntaxLexer.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SyntaxLexerInfo
+    {
+        public ulong Size;
+        public ulong Lines;
+        public ulong Lexed;
+    }
+
+    // Must match SyntaxLexer::Token in QuickLook.Native/QuickLook.Native32/SyntaxLexer.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SyntaxToken
+    {
+        public uint Start;
+        public uint Length;
+        public uint Color;
+        public uint Frame;
+    }
+}
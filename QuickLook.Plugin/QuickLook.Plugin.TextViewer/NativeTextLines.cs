@@ -0,0 +1,358 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace QuickLook.Plugin.TextViewer;
+
+/// <summary>
+/// Lines of a text file of any size, found by the memory-mapped line index of QuickLook.Native.
+/// The line ends are counted by <see cref="Build" /> on a background thread, while the lines indexed so far
+/// can already be read; only the lines asked for are ever decoded.
+/// </summary>
+internal sealed class NativeTextLines : IDisposable
+{
+    private static readonly bool IsArm64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+    private static readonly bool Is64Bit = Environment.Is64BitProcess;
+
+    private static volatile bool _unavailable;
+
+    private readonly Decoder _decoder;
+    private nint _handle;
+    private ulong[] _starts = [];
+    private byte[] _bytes = [];
+    private char[] _chars = [];
+
+    /// <summary>
+    /// Gets the encoding the lines are decoded with.
+    /// </summary>
+    public Encoding Encoding { get; }
+
+    /// <summary>
+    /// Gets the file size in bytes.
+    /// </summary>
+    public ulong Size { get; }
+
+    /// <summary>
+    /// Gets the number of lines indexed so far; the last line of the file only counts once all of it is indexed.
+    /// </summary>
+    public ulong LineCount => GetInfo().Lines;
+
+    /// <summary>
+    /// Gets whether the line ends of the whole file are counted.
+    /// </summary>
+    public bool IsIndexed => GetInfo().Indexed == Size;
+
+    /// <summary>
+    /// Gets the part of the file that is indexed, from 0 to 1.
+    /// </summary>
+    public double Progress => Size == 0 ? 1 : (double)GetInfo().Indexed / Size;
+
+    private NativeTextLines(nint handle, Encoding encoding, ulong size)
+    {
+        _handle = handle;
+        _decoder = encoding.GetDecoder();
+        Encoding = encoding;
+        Size = size;
+    }
+
+    /// <summary>
+    /// Opens the specified file with lines in <paramref name="encoding" />, without indexing any of it yet.
+    /// A byte order mark at the start of the file is skipped.
+    /// </summary>
+    /// <returns>
+    /// The <see cref="NativeTextLines" />, or <see langword="null" /> if the file cannot be opened, its line ends are not
+    /// one or two bytes long, or the native index is not available.
+    /// </returns>
+    public static NativeTextLines Open(string path, Encoding encoding)
+    {
+        _ = path ?? throw new ArgumentNullException(nameof(path));
+        _ = encoding ?? throw new ArgumentNullException(nameof(encoding));
+
+        if (_unavailable)
+            return null;
+
+        var newline = encoding.GetByteCount("\n") switch
+        {
+            1 => Newline.LF,
+            2 => encoding.GetBytes("\n")[0] == '\n' ? Newline.LFUtf16LE : Newline.LFUtf16BE,
+            _ => (Newline?)null,
+        };
+        if (newline == null)
+            return null;
+
+        try
+        {
+            var start = PreambleLength(path, encoding);
+            var handle = IsArm64 ? TextLinesOpen_arm64(path, newline.Value, start)
+                : Is64Bit ? TextLinesOpen_64(path, newline.Value, start) : TextLinesOpen_32(path, newline.Value, start);
+            if (handle == 0)
+                return null;
+
+            if (GetInfo(handle, out var info))
+                return new NativeTextLines(handle, encoding, info.Size);
+
+            Close(handle);
+        }
+        catch (Exception e) when (e is DllNotFoundException or EntryPointNotFoundException or BadImageFormatException)
+        {
+            _unavailable = true;
+            Debug.WriteLine(e);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// Counts the line ends in the next <paramref name="bytes" /> bytes of the file. Can run on another thread than the
+    /// other members, but on only one at a time.
+    /// </summary>
+    /// <returns><see langword="false" /> once the whole file is indexed, or if it cannot be read.</returns>
+    public bool Build(uint bytes)
+    {
+        var handle = ThrowIfDisposed();
+        return IsArm64 ? TextLinesBuild_arm64(handle, bytes)
+            : Is64Bit ? TextLinesBuild_64(handle, bytes) : TextLinesBuild_32(handle, bytes);
+    }
+
+    /// <summary>
+    /// Decodes up to <paramref name="count" /> lines from <paramref name="firstLine" /> on, without their line ends.
+    /// Lines past what is indexed so far are left out, and lines longer than <paramref name="maxLength" /> characters
+    /// are cut and end with <paramref name="ellipsis" />.
+    /// </summary>
+    public string[] ReadLines(ulong firstLine, int count, int maxLength, string ellipsis)
+    {
+        var handle = ThrowIfDisposed();
+        if (count <= 0)
+            return [];
+
+        if (_starts.Length < count + 1)
+            _starts = new ulong[count + 1];
+
+        var found = (int)(IsArm64 ? TextLinesGetLines_arm64(handle, firstLine, (uint)count, _starts)
+            : Is64Bit ? TextLinesGetLines_64(handle, firstLine, (uint)count, _starts)
+            : TextLinesGetLines_32(handle, firstLine, (uint)count, _starts));
+
+        var maxBytes = Encoding.GetMaxByteCount(maxLength);
+        var lines = new string[found];
+        for (var i = 0; i < found; i++)
+        {
+            var length = _starts[i + 1] - _starts[i];
+            var cut = length > (ulong)maxBytes;
+            lines[i] = Decode(handle, _starts[i], cut ? maxBytes : (int)length, cut, maxLength, ellipsis);
+        }
+        return lines;
+    }
+
+    /// <summary>
+    /// Finds the byte offset where <paramref name="line" /> starts, for searching the file from there.
+    /// </summary>
+    /// <returns>The offset, or <see langword="null" /> if <paramref name="line" /> is not indexed yet.</returns>
+    public ulong? StartOf(ulong line)
+    {
+        var handle = ThrowIfDisposed();
+        if (_starts.Length < 2)
+            _starts = new ulong[2];
+
+        var found = IsArm64 ? TextLinesGetLines_arm64(handle, line, 1, _starts)
+            : Is64Bit ? TextLinesGetLines_64(handle, line, 1, _starts) : TextLinesGetLines_32(handle, line, 1, _starts);
+        return found == 1 ? _starts[0] : null;
+    }
+
+    /// <summary>
+    /// Finds the line that the byte at <paramref name="offset" /> is in, for turning search matches into lines.
+    /// </summary>
+    /// <returns>The line, or <see langword="null" /> if <paramref name="offset" /> is not indexed yet.</returns>
+    public ulong? LineOf(ulong offset)
+    {
+        var handle = ThrowIfDisposed();
+        var found = IsArm64 ? TextLinesFindLine_arm64(handle, offset, out var line)
+            : Is64Bit ? TextLinesFindLine_64(handle, offset, out line) : TextLinesFindLine_32(handle, offset, out line);
+        return found ? line : null;
+    }
+
+    public void Dispose()
+    {
+        if (_handle == 0)
+            return;
+
+        Close(_handle);
+        _handle = 0;
+    }
+
+    private string Decode(nint handle, ulong offset, int length, bool cut, int maxLength, string ellipsis)
+    {
+        if (_bytes.Length < length)
+            _bytes = new byte[length];
+
+        var read = (int)(IsArm64 ? TextLinesRead_arm64(handle, offset, (uint)length, _bytes)
+            : Is64Bit ? TextLinesRead_64(handle, offset, (uint)length, _bytes)
+            : TextLinesRead_32(handle, offset, (uint)length, _bytes));
+
+        // a cut line may end inside a character, which the decoder then keeps back instead of replacing
+        _decoder.Reset();
+        var capacity = _decoder.GetCharCount(_bytes, 0, read, !cut);
+        if (_chars.Length < capacity)
+            _chars = new char[capacity];
+
+        var chars = _decoder.GetChars(_bytes, 0, read, _chars, 0, !cut);
+        if (!cut)
+        {
+            if (chars > 0 && _chars[chars - 1] == '\n')
+                chars--;
+            if (chars > 0 && _chars[chars - 1] == '\r')
+                chars--;
+        }
+
+        if (!cut && chars <= maxLength)
+            return new string(_chars, 0, chars);
+
+        return new string(_chars, 0, Math.Min(chars, maxLength - ellipsis.Length)) + ellipsis;
+    }
+
+    private TextLinesInfo GetInfo()
+    {
+        var handle = ThrowIfDisposed();
+        return GetInfo(handle, out var info) ? info : default;
+    }
+
+    private nint ThrowIfDisposed()
+    {
+        return _handle != 0 ? _handle : throw new ObjectDisposedException(nameof(NativeTextLines));
+    }
+
+    /// <summary>
+    /// Gets the length of the byte order mark of <paramref name="encoding" /> at the start of the file, or 0 if it has
+    /// none, which is where the first line begins.
+    /// </summary>
+    internal static uint PreambleLength(string path, Encoding encoding)
+    {
+        var preamble = encoding.GetPreamble();
+        if (preamble.Length == 0)
+            return 0;
+
+        using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete);
+        var head = new byte[preamble.Length];
+        var read = stream.Read(head, 0, head.Length);
+        return read == head.Length && head.SequenceEqual(preamble) ? (uint)head.Length : 0;
+    }
+
+    private static bool GetInfo(nint handle, out TextLinesInfo info)
+    {
+        return IsArm64 ? TextLinesGetInfo_arm64(handle, out info)
+            : Is64Bit ? TextLinesGetInfo_64(handle, out info) : TextLinesGetInfo_32(handle, out info);
+    }
+
+    private static void Close(nint handle)
+    {
+        if (IsArm64)
+            TextLinesClose_arm64(handle);
+        else if (Is64Bit)
+            TextLinesClose_64(handle);
+        else
+            TextLinesClose_32(handle);
+    }
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint TextLinesOpen_32([MarshalAs(UnmanagedType.LPWStr)] string path, Newline newline, ulong start);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void TextLinesClose_32(nint lines);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesGetInfo_32(nint lines, out TextLinesInfo info);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesBuild_32(nint lines, uint bytes);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesGetLines", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextLinesGetLines_32(nint lines, ulong firstLine, uint count, [Out] ulong[] starts);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesFindLine", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesFindLine_32(nint lines, ulong offset, out ulong line);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "TextLinesRead", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextLinesRead_32(nint lines, ulong offset, uint length, [Out] byte[] buffer);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint TextLinesOpen_64([MarshalAs(UnmanagedType.LPWStr)] string path, Newline newline, ulong start);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void TextLinesClose_64(nint lines);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesGetInfo_64(nint lines, out TextLinesInfo info);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesBuild_64(nint lines, uint bytes);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesGetLines", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextLinesGetLines_64(nint lines, ulong firstLine, uint count, [Out] ulong[] starts);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesFindLine", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesFindLine_64(nint lines, ulong offset, out ulong line);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "TextLinesRead", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextLinesRead_64(nint lines, ulong offset, uint length, [Out] byte[] buffer);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesOpen", CallingConvention = CallingConvention.Cdecl)]
+    private static extern nint TextLinesOpen_arm64([MarshalAs(UnmanagedType.LPWStr)] string path, Newline newline, ulong start);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesClose", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void TextLinesClose_arm64(nint lines);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesGetInfo", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesGetInfo_arm64(nint lines, out TextLinesInfo info);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesBuild", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesBuild_arm64(nint lines, uint bytes);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesGetLines", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextLinesGetLines_arm64(nint lines, ulong firstLine, uint count, [Out] ulong[] starts);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesFindLine", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool TextLinesFindLine_arm64(nint lines, ulong offset, out ulong line);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "TextLinesRead", CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint TextLinesRead_arm64(nint lines, ulong offset, uint length, [Out] byte[] buffer);
+
+    // Must match TextLines::Newline in QuickLook.Native/QuickLook.Native32/TextLines.h
+    private enum Newline : uint
+    {
+        LF = 0,
+        LFUtf16LE = 1,
+        LFUtf16BE = 2,
+    }
+
+    // Must match TextLines::Info in QuickLook.Native/QuickLook.Native32/TextLines.h
+    [StructLayout(LayoutKind.Sequential)]
+    private struct TextLinesInfo
+    {
+        public ulong Size;
+        public ulong Lines;
+        public ulong Indexed;
+    }
+}
@@ -37,6 +37,7 @@ public partial class Plugin : IViewer, IMoreMenu
     ];
 
     private TextViewerPanel _tvp;
+    private LargeTextViewerPanel _ltvp;
     private string _currentPath;
 
     public int Priority => -5;
@@ -89,6 +90,11 @@ public partial class Plugin : IViewer, IMoreMenu
             context.ViewerContent = rtfBox;
             context.IsBusy = false;
         }
+        else if ((_ltvp = LargeTextViewerPanel.Open(path)) != null)
+        {
+            context.ViewerContent = _ltvp;
+            context.IsBusy = false;
+        }
         else
         {
             _tvp = new TextViewerPanel();
@@ -102,6 +108,8 @@ public partial class Plugin : IViewer, IMoreMenu
     {
         _tvp?.Dispose();
         _tvp = null;
+        _ltvp?.Dispose();
+        _ltvp = null;
     }
 
     [MethodImpl(MethodImplOptions.AggressiveInlining)]
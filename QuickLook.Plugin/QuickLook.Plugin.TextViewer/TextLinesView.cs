@@ -0,0 +1,337 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+//
+// This file is part of QuickLook program.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+using ICSharpCode.AvalonEdit.Highlighting;
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Windows;
+using System.Windows.Input;
+using System.Windows.Media;
+using System.Windows.Threading;
+
+namespace QuickLook.Plugin.TextViewer;
+
+/// <summary>
+/// Draws the lines of a <see cref="NativeTextLines" /> that fit into the control, from <see cref="FirstLine" /> on,
+/// with their line numbers. Only those lines are ever decoded, and colored by <see cref="Syntax" /> if set, so scrolling
+/// costs the same in a file of any size. Lines are not wrapped; the view scrolls sideways instead.
+/// </summary>
+public sealed class TextLinesView : FrameworkElement
+{
+    private const int WheelLines = 3;
+    private const double NumberGap = 16;
+
+    private NativeTextLines _lines;
+    private NativeSyntax _syntax;
+    private ulong _firstLine;
+    private ulong? _markedLine;
+    private double _horizontalOffset;
+    private double _extentWidth;
+    private Typeface _typeface;
+    private double _lineHeight;
+
+    public TextLinesView()
+    {
+        Focusable = true;
+        FocusVisualStyle = null;
+    }
+
+    /// <summary>
+    /// Occurs when <see cref="FirstLine" />, the number of lines or the visible area changes.
+    /// </summary>
+    public event EventHandler FirstLineChanged;
+
+    public Brush Foreground { get; set; } = Brushes.Black;
+
+    public Brush LineNumberForeground { get; set; } = Brushes.Gray;
+
+    public FontFamily FontFamily { get; set; } = new("Consolas");
+
+    public double FontSize { get; set; } = 14;
+
+    /// <summary>
+    /// Gets or sets the longest line shown in characters; longer lines are cut and end with <see cref="Ellipsis" />.
+    /// </summary>
+    public int MaxLineLength { get; set; } = 10000;
+
+    public string Ellipsis { get; set; } = "…";
+
+    public Brush MarkBrush { get; set; } = new SolidColorBrush(Color.FromArgb(0x55, 0xFF, 0xFF, 0x00));
+
+    /// <summary>
+    /// Gets or sets the line drawn on <see cref="MarkBrush" />, such as the one a search found.
+    /// </summary>
+    public ulong? MarkedLine
+    {
+        get => _markedLine;
+        set
+        {
+            _markedLine = value;
+            InvalidateVisual();
+        }
+    }
+
+    internal NativeTextLines Lines
+    {
+        get => _lines;
+        set
+        {
+            _lines = value;
+            _firstLine = 0;
+            _markedLine = null;
+            _horizontalOffset = 0;
+            _extentWidth = 0;
+            InvalidateVisual();
+            FirstLineChanged?.Invoke(this, EventArgs.Empty);
+        }
+    }
+
+    /// <summary>
+    /// Gets or sets the highlighting of the lines; lines it has not reached yet are drawn in <see cref="Foreground" />.
+    /// </summary>
+    internal NativeSyntax Syntax
+    {
+        get => _syntax;
+        set
+        {
+            _syntax = value;
+            InvalidateVisual();
+        }
+    }
+
+    public ulong FirstLine
+    {
+        get => _firstLine;
+        set
+        {
+            var line = Math.Min(value, MaxFirstLine);
+            if (line == _firstLine)
+                return;
+
+            _firstLine = line;
+            InvalidateVisual();
+            FirstLineChanged?.Invoke(this, EventArgs.Empty);
+        }
+    }
+
+    public int VisibleLines => Math.Max(1, (int)(ActualHeight / LineHeight));
+
+    public ulong MaxFirstLine
+    {
+        get
+        {
+            var lines = _lines?.LineCount ?? 0;
+            return lines > (ulong)VisibleLines ? lines - (ulong)VisibleLines : 0;
+        }
+    }
+
+    public double HorizontalOffset
+    {
+        get => _horizontalOffset;
+        set
+        {
+            var offset = Math.Max(0, Math.Min(value, MaxHorizontalOffset));
+            if (offset == _horizontalOffset)
+                return;
+
+            _horizontalOffset = offset;
+            InvalidateVisual();
+            FirstLineChanged?.Invoke(this, EventArgs.Empty);
+        }
+    }
+
+    /// <summary>
+    /// Gets how far the widest line drawn so far reaches past the right edge.
+    /// </summary>
+    public double MaxHorizontalOffset => Math.Max(0, _extentWidth - ActualWidth);
+
+    private double LineHeight
+    {
+        get
+        {
+            MeasureFont();
+            return _lineHeight;
+        }
+    }
+
+    /// <summary>
+    /// Draws the lines again, for when more of the file has been indexed.
+    /// </summary>
+    public void Refresh()
+    {
+        InvalidateVisual();
+        FirstLineChanged?.Invoke(this, EventArgs.Empty);
+    }
+
+    public void ScrollBy(long lines)
+    {
+        FirstLine = lines < 0 ? _firstLine - Math.Min(_firstLine, (ulong)-lines) : _firstLine + Math.Min((ulong)lines, MaxFirstLine - _firstLine);
+    }
+
+    protected override void OnRenderSizeChanged(SizeChangedInfo sizeInfo)
+    {
+        base.OnRenderSizeChanged(sizeInfo);
+
+        // a taller view may now show the end of the file from an earlier line
+        _firstLine = Math.Min(_firstLine, MaxFirstLine);
+        FirstLineChanged?.Invoke(this, EventArgs.Empty);
+    }
+
+    protected override void OnRender(DrawingContext drawingContext)
+    {
+        // transparent background for hit testing of the wheel and clicks
+        drawingContext.DrawRectangle(Brushes.Transparent, null, new Rect(RenderSize));
+
+        if (_lines == null)
+            return;
+
+        MeasureFont();
+        var pixelsPerDip = VisualTreeHelper.GetDpi(this).PixelsPerDip;
+        // one more line for the partly visible one at the bottom
+        var lines = _lines.ReadLines(_firstLine, VisibleLines + 1, MaxLineLength, Ellipsis);
+        var sections = _syntax?.Tokenize(_firstLine, lines.Length, MaxLineLength) ?? [];
+
+        // the numbers get as wide as the last one that can be shown
+        var digits = Math.Max(_lines.LineCount, 1).ToString(CultureInfo.InvariantCulture).Length;
+        var numberWidth = Format(new string('0', digits), LineNumberForeground, pixelsPerDip).WidthIncludingTrailingWhitespace + NumberGap;
+
+        if (_markedLine >= _firstLine && _markedLine - _firstLine < (ulong)lines.Length)
+            drawingContext.DrawRectangle(MarkBrush, null,
+                new Rect(0, (double)(_markedLine.Value - _firstLine) * _lineHeight, ActualWidth, _lineHeight));
+
+        var extentWidth = _extentWidth;
+        drawingContext.PushClip(new RectangleGeometry(new Rect(numberWidth, 0, Math.Max(0, ActualWidth - numberWidth), ActualHeight)));
+        for (var i = 0; i < lines.Length; i++)
+        {
+            var text = Format(lines[i], Foreground, pixelsPerDip);
+            // a cut line is not colored, as in TextViewerPanel
+            if (i < sections.Length && (lines[i].Length < MaxLineLength || !lines[i].EndsWith(Ellipsis, StringComparison.Ordinal)))
+                Colorize(text, lines[i].Length, sections[i]);
+            _extentWidth = Math.Max(_extentWidth, numberWidth + text.WidthIncludingTrailingWhitespace);
+            drawingContext.DrawText(text, new Point(numberWidth - _horizontalOffset, i * _lineHeight));
+        }
+        drawingContext.Pop();
+
+        // a wider line than seen before lets the view scroll further; not while rendering, though
+        if (_extentWidth > extentWidth)
+            Dispatcher.BeginInvoke(() => FirstLineChanged?.Invoke(this, EventArgs.Empty), DispatcherPriority.Background);
+
+        for (var i = 0; i < lines.Length; i++)
+        {
+            var number = Format((_firstLine + (ulong)i + 1).ToString(CultureInfo.InvariantCulture), LineNumberForeground, pixelsPerDip);
+            drawingContext.DrawText(number, new Point(numberWidth - NumberGap - number.Width, i * _lineHeight));
+        }
+    }
+
+    protected override void OnMouseDown(MouseButtonEventArgs e)
+    {
+        base.OnMouseDown(e);
+        Focus();
+    }
+
+    protected override void OnMouseWheel(MouseWheelEventArgs e)
+    {
+        base.OnMouseWheel(e);
+
+        if (Keyboard.Modifiers.HasFlag(ModifierKeys.Shift))
+            HorizontalOffset -= e.Delta / Mouse.MouseWheelDeltaForOneLine * WheelLines * LineHeight;
+        else
+            ScrollBy(-e.Delta / Mouse.MouseWheelDeltaForOneLine * WheelLines);
+        e.Handled = true;
+    }
+
+    protected override void OnKeyDown(KeyEventArgs e)
+    {
+        base.OnKeyDown(e);
+
+        switch (e.Key)
+        {
+            case Key.Up:
+                ScrollBy(-1);
+                break;
+
+            case Key.Down:
+                ScrollBy(1);
+                break;
+
+            case Key.Left:
+                HorizontalOffset -= LineHeight;
+                break;
+
+            case Key.Right:
+                HorizontalOffset += LineHeight;
+                break;
+
+            case Key.PageUp:
+                ScrollBy(-VisibleLines);
+                break;
+
+            case Key.PageDown:
+                ScrollBy(VisibleLines);
+                break;
+
+            case Key.Home:
+                FirstLine = 0;
+                break;
+
+            case Key.End:
+                FirstLine = MaxFirstLine;
+                break;
+
+            default:
+                return;
+        }
+
+        e.Handled = true;
+    }
+
+    private FormattedText Format(string text, Brush brush, double pixelsPerDip)
+    {
+        return new FormattedText(text, CultureInfo.CurrentCulture, FlowDirection.LeftToRight, _typeface, FontSize, brush, pixelsPerDip);
+    }
+
+    private static void Colorize(FormattedText text, int length, List<HighlightedSection> sections)
+    {
+        foreach (var section in sections)
+        {
+            if (section.Offset >= length)
+                break;
+
+            var start = section.Offset;
+            var count = Math.Min(section.Length, length - start);
+            var color = section.Color;
+            if (color.Foreground?.GetBrush(null) is { } brush)
+                text.SetForegroundBrush(brush, start, count);
+            if (color.FontWeight is { } weight)
+                text.SetFontWeight(weight, start, count);
+            if (color.FontStyle is { } style)
+                text.SetFontStyle(style, start, count);
+            if (color.Underline == true)
+                text.SetTextDecorations(TextDecorations.Underline, start, count);
+        }
+    }
+
+    private void MeasureFont()
+    {
+        if (_lineHeight > 0)
+            return;
+
+        _typeface = new Typeface(FontFamily, FontStyles.Normal, FontWeights.Normal, FontStretches.Normal);
+        _lineHeight = Format("0", Brushes.Black, VisualTreeHelper.GetDpi(this).PixelsPerDip).Height;
+    }
+}
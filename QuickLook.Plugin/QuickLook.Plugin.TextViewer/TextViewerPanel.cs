@@ -18,6 +18,7 @@
 using ICSharpCode.AvalonEdit;
 using ICSharpCode.AvalonEdit.Document;
 using ICSharpCode.AvalonEdit.Editing;
+using ICSharpCode.AvalonEdit.Highlighting;
 using ICSharpCode.AvalonEdit.Rendering;
 using ICSharpCode.AvalonEdit.Search;
 using QuickLook.Common.Helpers;
@@ -43,12 +44,13 @@ namespace QuickLook.Plugin.TextViewer;
 public partial class TextViewerPanel : TextEditor, IDisposable
 {
     private bool _disposed;
+    private NativeHighlighter _highlighter;
 
     /// <summary>Maximum number of characters allowed on a single line before it is truncated.</summary>
-    private const int MAX_LINE_LENGTH = 10000;
+    internal const int MAX_LINE_LENGTH = 10000;
 
     /// <summary>Marker appended at the end of a truncated line to indicate omitted content.</summary>
-    private const string ELLIPSIS = "⁞⁞[TRUNCATED]⁞⁞";
+    internal const string ELLIPSIS = "⁞⁞[TRUNCATED]⁞⁞";
 
     static TextViewerPanel()
     {
@@ -134,6 +136,8 @@ public partial class TextViewerPanel : TextEditor, IDisposable
     public void Dispose()
     {
         _disposed = true;
+        _highlighter?.Dispose();
+        _highlighter = null;
     }
 
     private void Viewer_ManipulationInertiaStarting(object sender, ManipulationInertiaStartingEventArgs e)
@@ -315,6 +319,23 @@ public partial class TextViewerPanel : TextEditor, IDisposable
         }
     }
 
+    private async void HighlightNatively(TextDocument document, string text, IHighlightingDefinition definition)
+    {
+        var highlighter = await Task.Run(() => NativeHighlighter.Open(document, text, definition, Dispatcher));
+        if (highlighter == null)
+            return;
+
+        if (_disposed || Document != document)
+        {
+            highlighter.Dispose();
+            return;
+        }
+
+        // ahead of the transformers that decolor lines
+        _highlighter = highlighter;
+        TextArea.TextView.LineTransformers.Insert(0, new HighlightingColorizer(highlighter));
+    }
+
     public void LoadFileAsync(string path, ContextObject context)
     {
         _ = Task.Run(() =>
@@ -323,6 +344,7 @@ public partial class TextViewerPanel : TextEditor, IDisposable
             const int maxHighlightingLength = (int)(0.5d * 1024 * 1024);
             var buffer = new MemoryStream();
             bool fileTooLong = false;
+            bool truncated = false;
 
             // Read file to memory stream
             if (FormatDetector.Transfer(path, out string transferred))
@@ -343,6 +365,8 @@ public partial class TextViewerPanel : TextEditor, IDisposable
                     var count = s.Read(lb, 0, lb.Length);
                     buffer.Write(lb, 0, count);
                 }
+
+                truncated = s.Position < s.Length;
             }
 
             if (_disposed)
@@ -354,7 +378,7 @@ public partial class TextViewerPanel : TextEditor, IDisposable
             var bufferCopy = buffer.ToArray();
             buffer.Dispose();
 
-            var encoding = EncodingDetector.DetectFromBytes(bufferCopy);
+            var encoding = EncodingDetector.DetectFromBytes(bufferCopy, truncated);
             var text = encoding.GetString(bufferCopy);
 
             // Truncate overly long lines to prevent crashes and lag
@@ -377,6 +401,13 @@ public partial class TextViewerPanel : TextEditor, IDisposable
                     : highlighting.SyntaxHighlighting;
                 Document = doc;
 
+                // past what AvalonEdit highlights, the native lexer finds the spans in the background
+                if (bufferCopy.Length > maxHighlightingLength &&
+                    highlighting.SyntaxHighlighting is { } definition and not ICustomHighlightingDefinition)
+                {
+                    HighlightNatively(doc, text, definition);
+                }
+
                 if (SyntaxHighlighting is ICustomHighlightingDefinition custom)
                 {
                     foreach (var lineTransformer in custom.LineTransformers)
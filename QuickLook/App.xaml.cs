@@ -127,13 +127,14 @@ public partial class App : Application
         RunListener(e);
 
         // First instance: run and preview this file
-        if (e.Args.Any())
+        var args = TakeVerb(e.Args, out var message);
+        if (args.Any())
         {
             try
             {
-                var path = Path.GetFullPath(e.Args.First());
+                var path = Path.GetFullPath(args.First());
                 if (Directory.Exists(path) || File.Exists(path))
-                    PipeServerManager.PostMessage(PipeMessages.Toggle, path);
+                    PipeServerManager.PostMessage(message, path, [.. args.Skip(1)]);
             }
             catch
             {
@@ -247,6 +248,10 @@ public partial class App : Application
 
         _isRunning.ReleaseMutex();
 
+        // opt-in, for tuning the native caches: what they did during this session
+        if (SettingHelper.Get("LogNativeDiagnostics", false))
+            ProcessHelper.WriteLog(NativeMethods.QuickLook.GetDiagnostics().ToString());
+
         PipeServerManager.GetInstance().Dispose();
         TrayIconManager.GetInstance().Dispose();
         KeystrokeDispatcher.GetInstance().Dispose();
@@ -289,6 +294,7 @@ public partial class App : Application
             return true;
 
         // Second instance: preview this file
+        args = TakeVerb(args, out var message);
         if (args.Any())
         {
             try
@@ -296,7 +302,7 @@ public partial class App : Application
                 var path = Path.GetFullPath(args.First());
                 if (Directory.Exists(path) || File.Exists(path))
                 {
-                    PipeServerManager.PostMessage(PipeMessages.Toggle, path, [.. args.Skip(1)]);
+                    PipeServerManager.PostMessage(message, path, [.. args.Skip(1)]);
                     return false;
                 }
             }
@@ -313,6 +319,29 @@ public partial class App : Application
         return false;
     }
 
+    /// <summary>
+    /// Strips the /invoke, /toggle or /switch that QuickLook.Launcher passes on when it has to start the app
+    /// itself, and returns the pipe message it stands for in <paramref name="message" />; Toggle if there is none.
+    /// </summary>
+    private static string[] TakeVerb(string[] args, out string message)
+    {
+        message = args.FirstOrDefault()?.ToLowerInvariant() switch
+        {
+            "/invoke" => PipeMessages.Invoke,
+            "/switch" => PipeMessages.Switch,
+            "/toggle" => PipeMessages.Toggle,
+            _ => null,
+        };
+
+        if (message == null)
+        {
+            message = PipeMessages.Toggle;
+            return args;
+        }
+
+        return [.. args.Skip(1)];
+    }
+
     private void CheckUpdate()
     {
         if (SettingHelper.Get("DisableAutoUpdateCheck", false))
@@ -340,6 +369,7 @@ public partial class App : Application
             AutoStartupHelper.CreateAutorunShortcut();
 
         NativeMethods.QuickLook.Init();
+        NativeMethods.QuickLook.SetReadAheadEnabled(SettingHelper.Get("ReadAhead", false));
 
         PluginManager.GetInstance();
         ViewWindowManager.GetInstance();
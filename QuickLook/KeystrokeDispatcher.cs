@@ -16,11 +16,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using QuickLook.Common.Helpers;
-using QuickLook.Common.NativeMethods;
-using QuickLook.Helpers;
 using System;
-using System.Collections.Generic;
 using System.Diagnostics;
+using System.Threading;
 using System.Windows.Forms;
 
 namespace QuickLook;
@@ -29,111 +27,42 @@ internal class KeystrokeDispatcher : IDisposable
 {
     private static KeystrokeDispatcher _instance;
 
-    private static HashSet<Keys> _validKeys;
-
-    private GlobalKeyboardHook _hook;
-    private nint _winEventHook;
-    private User32.WinEventProc _winEventProc; // keep reference to prevent GC
-    private bool _isPreviewRequest;
-    private bool _spaceIsDown;
-    private long _spaceHoldTick;
-    private long _lastInvalidKeyPressTick;
-
-    private const long HOLD_TO_PREVIEW_DURATION = TimeSpan.TicksPerMillisecond * 750;
-    private const long VALID_KEY_PRESS_DELAY = TimeSpan.TicksPerSecond * 1;
+    private Thread _dispatchThread;
+    private volatile bool _isRunning;
 
     protected KeystrokeDispatcher()
     {
-        InstallKeyHook(KeyDownEventHandler, KeyUpEventHandler);
-        InstallForegroundWindowHook();
-
-        _validKeys =
-        [
-            Keys.Up, Keys.Down, Keys.Left, Keys.Right,
-            Keys.Enter, Keys.Space, Keys.Escape,
-            Keys.F5, Keys.F11,
-        ];
-    }
-
-    public void Dispose()
-    {
-        _hook?.Dispose();
-        _hook = null;
-
-        if (_winEventHook != IntPtr.Zero)
+        // The low-level keyboard hook, together with the valid-key, modifier, Space-hold and
+        // focused-window filtering, runs in a native thread of QuickLook.Native.
+        // Only actionable keystrokes are handed over to us, so GC pauses never delay keyboard input.
+        if (!NativeMethods.QuickLook.StartKeyboardHook())
         {
-            User32.UnhookWinEvent(_winEventHook);
-            _winEventHook = IntPtr.Zero;
+            Debug.WriteLine("KeystrokeDispatcher: failed to install the keyboard hook");
+            return;
         }
-    }
 
-    private void KeyDownEventHandler(object sender, KeyEventArgs e)
-    {
-        CallViewWindowManagerInvokeRoutine(e, true);
+        _isRunning = true;
+        _dispatchThread = new Thread(DispatchLoop)
+        {
+            IsBackground = true,
+            Name = nameof(KeystrokeDispatcher),
+        };
+        _dispatchThread.Start();
     }
 
-    private void KeyUpEventHandler(object sender, KeyEventArgs e)
+    public void Dispose()
     {
-        CallViewWindowManagerInvokeRoutine(e, false);
+        _isRunning = false;
+        NativeMethods.QuickLook.StopKeyboardHook();
+
+        _dispatchThread?.Join(1000);
+        _dispatchThread = null;
     }
 
-    private void CallViewWindowManagerInvokeRoutine(KeyEventArgs e, bool isKeyDown)
+    private void DispatchLoop()
     {
-        // skip invalid keys, but record the timestamp
-        if (!_validKeys.Contains(e.KeyCode))
-        {
-            Debug.WriteLine($"Invalid keypress: key={e.KeyCode},down={isKeyDown}, time={_lastInvalidKeyPressTick}");
-            _lastInvalidKeyPressTick = DateTime.Now.Ticks;
-            return;
-        }
-
-        // skip valid keys when modifiers are used
-        if (isKeyDown && e.Modifiers != Keys.None)
-            return;
-
-        // skip if key is valid but too close after pressing an invalid key
-        if (DateTime.Now.Ticks - _lastInvalidKeyPressTick < VALID_KEY_PRESS_DELAY)
-            return;
-        _lastInvalidKeyPressTick = 0L;
-
-        // skip if user is holding Space (don't skip other valid keys)
-        if (isKeyDown && e.KeyCode == Keys.Space)
-        {
-            if (_spaceIsDown)
-                return;
-
-            _spaceHoldTick = DateTime.Now.Ticks;
-        }
-
-        // check if the valid key is a preview request
-        if (isKeyDown)
-        {
-            _isPreviewRequest = NativeMethods.QuickLook.GetFocusedWindowType() !=
-                                NativeMethods.QuickLook.FocusedWindowType.Invalid;
-            _isPreviewRequest |= WindowHelper.IsForegroundWindowBelongToSelf();
-        } // else (when isKeyDown is false), _isPreviewRequest retain its current state
-
-        // call InvokeRoutine only when user pressed a key in a valid window, or
-        // released a key which was pressed in a valid window, with an exception of Space which
-        // must be hold for 750ms before releasing.
-        if (_isPreviewRequest)
-        {
-            if (isKeyDown || e.KeyCode != Keys.Space ||
-                DateTime.Now.Ticks - _spaceHoldTick >= HOLD_TO_PREVIEW_DURATION)
-            {
-                InvokeRoutine(e.KeyCode, isKeyDown);
-
-                if (isKeyDown && e.KeyCode == Keys.Space)
-                    _spaceIsDown = true;
-            }
-        }
-
-        // when the key has been released, reset variables
-        if (!isKeyDown)
-        {
-            _isPreviewRequest = false;
-            _spaceIsDown = e.KeyCode != Keys.Space && _spaceIsDown;
-        }
+        while (_isRunning && NativeMethods.QuickLook.WaitKeystrokeEvent(out var ev))
+            InvokeRoutine((Keys)ev.VkCode, ev.IsKeyDown);
     }
 
     private void InvokeRoutine(Keys key, bool isKeyDown)
@@ -184,39 +113,6 @@ internal class KeystrokeDispatcher : IDisposable
         }
     }
 
-    private void InstallKeyHook(KeyEventHandler downHandler, KeyEventHandler upHandler)
-    {
-        _hook = GlobalKeyboardHook.GetInstance();
-
-        _hook.KeyDown += downHandler;
-        _hook.KeyUp += upHandler;
-    }
-
-    private void InstallForegroundWindowHook()
-    {
-        // When the foreground window changes (e.g. via Alt+Tab), reset the invalid-key
-        // delay so the first Space press in the newly focused Explorer window works.
-        // https://github.com/QL-Win/QuickLook/issues/1939
-        _winEventProc = OnForegroundWindowChanged;
-        _winEventHook = User32.SetWinEventHook(
-            User32.EVENT_SYSTEM_FOREGROUND, User32.EVENT_SYSTEM_FOREGROUND,
-            IntPtr.Zero, _winEventProc,
-            0, 0, User32.WINEVENT_OUTOFCONTEXT);
-    }
-
-    private void OnForegroundWindowChanged(nint hWinEventHook, uint eventType, nint hwnd,
-        int idObject, int idChild, uint idEventThread, uint dwmsEventTime)
-    {
-        // A different window is now in the foreground. Any invalid key presses that happened
-        // before this switch (e.g. Alt+Tab keystrokes) belong to the previous context,
-        // so they must not suppress valid keys in the new window.
-        _lastInvalidKeyPressTick = 0L;
-
-#if false // The problem of requiring two spaces has been solved -- comment the test code first.
-        Debug.WriteLine($"Foreground window changed to {hwnd:X}, invalid-key delay cleared.");
-#endif
-    }
-
     internal static KeystrokeDispatcher GetInstance()
     {
         return _instance ??= new KeystrokeDispatcher();
@@ -41,6 +41,31 @@ internal static class QuickLook
         CallingConvention = CallingConvention.Cdecl)]
     private static extern void GetCurrentSelectionNative_32([MarshalAs(UnmanagedType.LPWStr)] StringBuilder sb);
 
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "StartKeyboardHook",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool StartKeyboardHook_32();
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "StopKeyboardHook",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void StopKeyboardHook_32();
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "WaitKeystrokeEvent",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool WaitKeystrokeEvent_32(out KeystrokeEvent ev, uint timeout);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "SetReadAheadEnabled",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SetReadAheadEnabled_32(bool enabled);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "ScanFolder",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ScanFolder_32([MarshalAs(UnmanagedType.LPWStr)] string root, uint flags,
+        FolderScanProgress progress, IntPtr context, out FolderScanResult result);
+
+    [DllImport("QuickLook.Native32.dll", EntryPoint = "GetDiagnostics",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GetDiagnostics_32(ref Diagnostics diagnostics);
+
     [DllImport("QuickLook.Native64.dll", EntryPoint = "Init",
         CallingConvention = CallingConvention.Cdecl)]
     private static extern void Init_64();
@@ -53,6 +78,31 @@ internal static class QuickLook
         CallingConvention = CallingConvention.Cdecl)]
     private static extern void GetCurrentSelectionNative_64([MarshalAs(UnmanagedType.LPWStr)] StringBuilder sb);
 
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "StartKeyboardHook",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool StartKeyboardHook_64();
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "StopKeyboardHook",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void StopKeyboardHook_64();
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "WaitKeystrokeEvent",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool WaitKeystrokeEvent_64(out KeystrokeEvent ev, uint timeout);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "SetReadAheadEnabled",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SetReadAheadEnabled_64(bool enabled);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "ScanFolder",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ScanFolder_64([MarshalAs(UnmanagedType.LPWStr)] string root, uint flags,
+        FolderScanProgress progress, IntPtr context, out FolderScanResult result);
+
+    [DllImport("QuickLook.Native64.dll", EntryPoint = "GetDiagnostics",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GetDiagnostics_64(ref Diagnostics diagnostics);
+
     [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "Init",
     CallingConvention = CallingConvention.Cdecl)]
     private static extern void Init_arm64();
@@ -65,6 +115,31 @@ internal static class QuickLook
         CallingConvention = CallingConvention.Cdecl)]
     private static extern void GetCurrentSelectionNative_arm64([MarshalAs(UnmanagedType.LPWStr)] StringBuilder sb);
 
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "StartKeyboardHook",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool StartKeyboardHook_arm64();
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "StopKeyboardHook",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void StopKeyboardHook_arm64();
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "WaitKeystrokeEvent",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool WaitKeystrokeEvent_arm64(out KeystrokeEvent ev, uint timeout);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "SetReadAheadEnabled",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SetReadAheadEnabled_arm64(bool enabled);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "ScanFolder",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool ScanFolder_arm64([MarshalAs(UnmanagedType.LPWStr)] string root, uint flags,
+        FolderScanProgress progress, IntPtr context, out FolderScanResult result);
+
+    [DllImport("QuickLook.NativeArm64.dll", EntryPoint = "GetDiagnostics",
+        CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GetDiagnostics_arm64(ref Diagnostics diagnostics);
+
     internal static void Init()
     {
         try
@@ -97,6 +172,127 @@ internal static class QuickLook
         }
     }
 
+    internal static bool StartKeyboardHook()
+    {
+        try
+        {
+            if (App.IsArm64)
+                return StartKeyboardHook_arm64();
+            else
+                return App.Is64Bit ? StartKeyboardHook_64() : StartKeyboardHook_32();
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+            return false;
+        }
+    }
+
+    internal static void StopKeyboardHook()
+    {
+        try
+        {
+            if (App.IsArm64)
+                StopKeyboardHook_arm64();
+            else if (App.Is64Bit)
+                StopKeyboardHook_64();
+            else
+                StopKeyboardHook_32();
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+    }
+
+    /// <summary>
+    /// Blocks until the native keyboard hook has an actionable keystroke, the hook is stopped,
+    /// or <paramref name="timeout"/> (in milliseconds) elapses.
+    /// </summary>
+    internal static bool WaitKeystrokeEvent(out KeystrokeEvent ev, uint timeout = uint.MaxValue)
+    {
+        try
+        {
+            if (App.IsArm64)
+                return WaitKeystrokeEvent_arm64(out ev, timeout);
+            else
+                return App.Is64Bit ? WaitKeystrokeEvent_64(out ev, timeout) : WaitKeystrokeEvent_32(out ev, timeout);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+            ev = default;
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Lets the native side pre-read each newly resolved selection into the file cache.
+    /// </summary>
+    internal static void SetReadAheadEnabled(bool enabled)
+    {
+        try
+        {
+            if (App.IsArm64)
+                SetReadAheadEnabled_arm64(enabled);
+            else if (App.Is64Bit)
+                SetReadAheadEnabled_64(enabled);
+            else
+                SetReadAheadEnabled_32(enabled);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+    }
+
+    /// <summary>
+    /// Counts the sub-directories, files and bytes below <paramref name="root"/> on several threads.
+    /// <paramref name="progress"/> is called about every 100 ms with the running totals; return 0 from it to cancel.
+    /// </summary>
+    internal static bool ScanFolder(string root, bool useCache, FolderScanProgress progress,
+        out FolderScanResult result)
+    {
+        try
+        {
+            var flags = useCache ? 1u : 0u;
+            if (App.IsArm64)
+                return ScanFolder_arm64(root, flags, progress, IntPtr.Zero, out result);
+            else
+                return App.Is64Bit
+                    ? ScanFolder_64(root, flags, progress, IntPtr.Zero, out result)
+                    : ScanFolder_32(root, flags, progress, IntPtr.Zero, out result);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+            result = default;
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Counters of the native selection cache, provider start-up, read-ahead and image cache for this session.
+    /// </summary>
+    internal static Diagnostics GetDiagnostics()
+    {
+        var diagnostics = new Diagnostics { Size = (uint)Marshal.SizeOf<Diagnostics>() };
+        try
+        {
+            if (App.IsArm64)
+                GetDiagnostics_arm64(ref diagnostics);
+            else if (App.Is64Bit)
+                GetDiagnostics_64(ref diagnostics);
+            else
+                GetDiagnostics_32(ref diagnostics);
+        }
+        catch (Exception e)
+        {
+            Debug.WriteLine(e);
+        }
+        return diagnostics;
+    }
+
     internal static string GetCurrentSelection()
     {
         StringBuilder sb = new(MaxPath);
@@ -143,6 +339,84 @@ internal static class QuickLook
         return sb.Length == 0 ? path : sb.ToString();
     }
 
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    internal delegate int FolderScanProgress(ref FolderScanResult progress, IntPtr context);
+
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct FolderScanResult
+    {
+        public ulong Directories;
+        public ulong Files;
+        public ulong Bytes;
+    }
+
+    /// <summary>
+    /// Must match Diagnostics in QuickLook.Native32/Diagnostics.h; fields are only ever appended.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct Diagnostics
+    {
+        public uint Size;
+
+        public ulong SelectionCacheHits;
+        public ulong SelectionCacheMisses;
+        public ulong SelectionCacheInvalidations;
+
+        public ulong WoW64HookHelperInitMicroseconds;
+        public ulong DOpusInitMicroseconds;
+        public ulong MultiCommanderInitMicroseconds;
+
+        [MarshalAs(UnmanagedType.Bool)]
+        public bool DOpusPreWarmed;
+
+        [MarshalAs(UnmanagedType.Bool)]
+        public bool MultiCommanderPreWarmed;
+
+        public ulong PreWarmMicroseconds;
+
+        public ulong ReadAheadRequests;
+        public ulong ReadAheadBytes;
+        public ulong ReadAheadCancelled;
+
+        public ulong ImageCacheHits;
+        public ulong ImageCacheMisses;
+        public ulong ImageCacheEvictions;
+        public ulong ImageCacheBytes;
+
+        public ulong WoW64HookHelperColdSelectionMicroseconds;
+        public ulong WoW64HookHelperWarmSelectionMicroseconds;
+        public ulong DOpusColdSelectionMicroseconds;
+        public ulong DOpusWarmSelectionMicroseconds;
+        public ulong MultiCommanderColdSelectionMicroseconds;
+        public ulong MultiCommanderWarmSelectionMicroseconds;
+
+        public override readonly string ToString()
+        {
+            return $"Selection cache: {SelectionCacheHits} hits, {SelectionCacheMisses} misses, "
+                 + $"{SelectionCacheInvalidations} invalidations\n"
+                 + $"Provider init (us): WoW64HookHelper {WoW64HookHelperInitMicroseconds}, "
+                 + $"DOpus {DOpusInitMicroseconds}{(DOpusPreWarmed ? " (pre-warmed)" : string.Empty)}, "
+                 + $"MultiCommander {MultiCommanderInitMicroseconds}"
+                 + $"{(MultiCommanderPreWarmed ? " (pre-warmed)" : string.Empty)}; pre-warm {PreWarmMicroseconds}\n"
+                 + $"First selection, cold/warm (us): WoW64HookHelper {WoW64HookHelperColdSelectionMicroseconds}/"
+                 + $"{WoW64HookHelperWarmSelectionMicroseconds}, DOpus {DOpusColdSelectionMicroseconds}/"
+                 + $"{DOpusWarmSelectionMicroseconds}, MultiCommander {MultiCommanderColdSelectionMicroseconds}/"
+                 + $"{MultiCommanderWarmSelectionMicroseconds}\n"
+                 + $"Read-ahead: {ReadAheadRequests} requests, {ReadAheadBytes} bytes, {ReadAheadCancelled} cancelled\n"
+                 + $"Image cache: {ImageCacheHits} hits, {ImageCacheMisses} misses, {ImageCacheEvictions} evictions, "
+                 + $"{ImageCacheBytes} bytes";
+        }
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct KeystrokeEvent
+    {
+        public uint VkCode;
+
+        [MarshalAs(UnmanagedType.Bool)]
+        public bool IsKeyDown;
+    }
+
     internal enum FocusedWindowType
     {
         Invalid,
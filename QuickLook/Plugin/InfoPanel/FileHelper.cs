@@ -40,7 +40,38 @@ public static class FileHelper
         }
     }
 
-    public static void CountFolder(string root, ref bool stop, out long totalDirs, out long totalFiles,
+    /// <summary>
+    /// Counts the folder on the native parallel scanner, reporting running totals through <paramref name="progress"/>.
+    /// Falls back to a managed walk when the native library is not available.
+    /// </summary>
+    public static void CountFolder(string root, Func<bool> stop, Action<long, long, long> progress, bool useCache,
+        out long totalDirs, out long totalFiles, out long totalSize)
+    {
+        NativeMethods.QuickLook.FolderScanProgress callback =
+            (ref NativeMethods.QuickLook.FolderScanResult current, IntPtr _) =>
+            {
+                if (stop())
+                    return 0;
+
+                progress?.Invoke((long)current.Directories, (long)current.Files, (long)current.Bytes);
+                return 1;
+            };
+
+        var completed = NativeMethods.QuickLook.ScanFolder(root, useCache, callback, out var result);
+        GC.KeepAlive(callback);
+
+        if (completed || stop() || result.Directories != 0 || result.Files != 0)
+        {
+            totalDirs = (long)result.Directories;
+            totalFiles = (long)result.Files;
+            totalSize = (long)result.Bytes;
+            return;
+        }
+
+        CountFolderManaged(root, stop, out totalDirs, out totalFiles, out totalSize);
+    }
+
+    private static void CountFolderManaged(string root, Func<bool> stop, out long totalDirs, out long totalFiles,
         out long totalSize)
     {
         totalDirs = totalFiles = totalSize = 0L;
@@ -52,7 +83,7 @@ public static class FileHelper
 
         do
         {
-            if (stop)
+            if (stop())
                 break;
 
             var pos = stack.Pop();
@@ -89,34 +89,42 @@ public partial class InfoPanel : UserControl
             }
             else if (Directory.Exists(path))
             {
-                FileHelper.CountFolder(path, ref _stop,
+                // show running totals while large trees are still being counted
+                FileHelper.CountFolder(path, () => Stop,
+                    (dirs, files, size) => Dispatcher.BeginInvoke(new Action(() =>
+                    {
+                        if (!Stop)
+                            totalSize.Text = FormatFolderSize(dirs, files, size);
+                    })),
+                    SettingHelper.Get("CacheFolderSize", false),
                     out var totalDirsL, out var totalFilesL, out var totalSizeL);
 
                 if (!Stop)
-                    Dispatcher.Invoke(() =>
-                    {
-                        string t;
-                        var folders = totalDirsL == 0
-                            ? string.Empty
-                            : string.Format(TranslationHelper.Get(
-                                totalDirsL == 1 ? "InfoPanel_Folder" : "InfoPanel_Folders"), totalDirsL);
-                        var files = totalFilesL == 0
-                            ? string.Empty
-                            : string.Format(TranslationHelper.Get(
-                                totalFilesL == 1 ? "InfoPanel_File" : "InfoPanel_Files"), totalFilesL);
-
-                        if (!string.IsNullOrEmpty(folders) && !string.IsNullOrEmpty(files))
-                            t = string.Format(
-                                TranslationHelper.Get("InfoPanel_FolderAndFile"), folders, files);
-                        else if (string.IsNullOrEmpty(folders) && string.IsNullOrEmpty(files))
-                            t = string.Empty;
-                        else
-                            t = $"({folders}{files})";
-
-                        totalSize.Text =
-                            $"{totalSizeL.ToPrettySize(2)} {t}";
-                    });
+                    Dispatcher.Invoke(() => { totalSize.Text = FormatFolderSize(totalDirsL, totalFilesL, totalSizeL); });
             }
         });
     }
+
+    private static string FormatFolderSize(long totalDirsL, long totalFilesL, long totalSizeL)
+    {
+        string t;
+        var folders = totalDirsL == 0
+            ? string.Empty
+            : string.Format(TranslationHelper.Get(
+                totalDirsL == 1 ? "InfoPanel_Folder" : "InfoPanel_Folders"), totalDirsL);
+        var files = totalFilesL == 0
+            ? string.Empty
+            : string.Format(TranslationHelper.Get(
+                totalFilesL == 1 ? "InfoPanel_File" : "InfoPanel_Files"), totalFilesL);
+
+        if (!string.IsNullOrEmpty(folders) && !string.IsNullOrEmpty(files))
+            t = string.Format(
+                TranslationHelper.Get("InfoPanel_FolderAndFile"), folders, files);
+        else if (string.IsNullOrEmpty(folders) && string.IsNullOrEmpty(files))
+            t = string.Empty;
+        else
+            t = $"({folders}{files})";
+
+        return $"{totalSizeL.ToPrettySize(2)} {t}";
+    }
 }
@@ -54,6 +54,12 @@ public sealed class PluginManager
         if (string.IsNullOrEmpty(path))
             return null;
 
+        // read the ends of the file once here, the plugins consult the guesses rather than opening it again
+        var sniffTimer = Stopwatch.StartNew();
+        var guesses = ContentTypeHelper.Sniff(path);
+        var sniffed = guesses == null ? "unknown" : string.Join<ContentTypeGuess>(", ", guesses);
+        Debug.WriteLine($"Content type: {sniffed}, {sniffTimer.ElapsedMilliseconds}ms");
+
         var matched = GetInstance()
             .LoadedPlugins.FirstOrDefault(plugin =>
             {
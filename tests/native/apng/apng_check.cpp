@@ -0,0 +1,274 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks ApngImage from the command line:
+//
+//   apng_check dump <file.png> <out>              writes Info, then each Frame and its pixels, in the layout
+//                                                 of the .expected files of make_apngs.py
+//   apng_check seek <file.png> [seed]             renders frames in random order and compares them with a
+//                                                 forward pass, to check going back and the buffer ring
+//   apng_check blend <seed> <count>               compares BlendOver at every SIMD level with a reference
+//   apng_check fuzz <seed> <count> <file.png>...  renders every frame of count mutations of the files
+//   apng_check bench <file.png>                   times indexing, the first frame, playback and BlendOver
+
+#include "ApngImage.h"
+#include "harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace
+{
+    const Simd::Level levels[] = {Simd::SCALAR, Simd::SSE2, Simd::AVX2, Simd::NEON};
+    volatile uint8_t sink;
+
+    int Dump(const char* path, const char* outPath)
+    {
+        ApngImage apng;
+        if (!apng.Open(path))
+            return 1;
+
+        auto out = fopen(outPath, "wb");
+        if (out == nullptr)
+            return 1;
+
+        auto& info = apng.GetInfo();
+        fwrite(&info, sizeof info, 1, out);
+        for (uint32_t k = 0; k < info.frameCount; k++)
+        {
+            ApngImage::Frame frame;
+            apng.GetFrame(k, &frame);
+            fwrite(&frame, sizeof frame, 1, out);
+            fwrite(apng.Render(k), 4, static_cast<size_t>(info.width) * info.height, out);
+        }
+        fclose(out);
+        return 0;
+    }
+
+    int Seek(const char* path, uint32_t seed)
+    {
+        ApngImage forward, seeking;
+        if (!forward.Open(path) || !seeking.Open(path))
+            return 1;
+
+        auto& info = forward.GetInfo();
+        auto bytes = static_cast<size_t>(info.width) * info.height * 4;
+        std::vector<std::vector<uint8_t>> frames;
+        for (uint32_t k = 0; k < info.frameCount; k++)
+        {
+            auto pixels = forward.Render(k);
+            frames.emplace_back(pixels, pixels + bytes);
+        }
+
+        // keep up to RING_SIZE earlier results, which must still hold their frames
+        std::mt19937 rng(seed);
+        std::vector<std::pair<uint32_t, const uint8_t*>> recent;
+        for (uint32_t step = 0; step < info.frameCount * 4; step++)
+        {
+            auto index = rng() % 3 == 0 ? static_cast<uint32_t>(rng() % info.frameCount) : step % info.frameCount;
+            recent.emplace_back(index, seeking.Render(index));
+            if (recent.size() > ApngImage::RING_SIZE)
+                recent.erase(recent.begin());
+
+            for (auto& [frame, pixels] : recent)
+            {
+                if (memcmp(pixels, frames[frame].data(), bytes) != 0)
+                {
+                    printf("%s: frame %u differs after rendering frame %u\n", path, frame, index);
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    // source over target for premultiplied pixels, a channel at a time with the rounding of div255
+    uint32_t ReferenceBlend(uint32_t below, uint32_t color)
+    {
+        auto inverse = 255 - (color >> 24);
+        uint32_t out = 0;
+        for (uint32_t shift = 0; shift < 32; shift += 8)
+        {
+            auto scaled = (below >> shift & 0xFF) * inverse + 128;
+            auto channel = (color >> shift & 0xFF) + ((scaled + (scaled >> 8)) >> 8);
+            out |= std::min(channel, 255u) << shift;
+        }
+        return out;
+    }
+
+    int Blend(uint32_t seed, long iterations)
+    {
+#ifdef QL_SIMD_NEON
+        if (!Simd::Supports(Simd::NEON))
+        {
+            printf("NEON is compiled in but not supported\n");
+            return 1;
+        }
+#endif
+
+        std::mt19937 rng(seed);
+        for (long iteration = 0; iteration < iterations; iteration++)
+        {
+            // runs of opaque, clear and translucent pixels, so that the vector shortcuts for whole
+            // opaque or clear groups are taken and missed; channels above alpha must saturate alike
+            auto count = rng() % 70;
+            std::vector<uint32_t> source(count), below(count);
+            auto runs = rng() % 4;
+            for (auto& color : source)
+            {
+                auto kind = runs == 0 ? rng() % 4 : runs;
+                uint32_t alpha = kind == 1 ? 255 : kind == 2 ? 0 : rng() % 256;
+                color = alpha << 24;
+                for (uint32_t shift = 0; shift < 24; shift += 8)
+                    color |= (rng() % 16 == 0 ? rng() % 256 : rng() % (alpha + 1)) << shift;
+            }
+            for (auto& color : below)
+                color = static_cast<uint32_t>(rng());
+
+            std::vector<uint32_t> expected(below);
+            for (size_t i = 0; i < count; i++)
+                expected[i] = ReferenceBlend(below[i], source[i]);
+
+            for (auto level : levels)
+            {
+                if (!Simd::Supports(level))
+                    continue;
+
+                std::vector<uint32_t> target(below);
+                ApngImage::BlendOver(target.data(), source.data(), static_cast<uint32_t>(count), level);
+                if (target != expected)
+                {
+                    auto at = std::mismatch(target.begin(), target.end(), expected.begin()).first - target.begin();
+                    printf("BlendOver at level %u gives %08X, not %08X, for %08X over %08X\n", level, target[at],
+                           expected[at], source[at], below[at]);
+                    return 1;
+                }
+            }
+        }
+
+        printf("BlendOver agrees at every level on %ld runs\n", iterations);
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        Harness::Mutator mutate;
+        mutate.bigEndian = true;
+        mutate.maximumChanges = 12;
+        return Harness::Fuzz(Harness::ReadFiles(paths, count, 50), iterations, seed, mutate,
+                             [](const std::vector<uint8_t>& data) {
+                                 ApngImage apng;
+                                 if (!apng.Parse(data.data(), data.size()))
+                                     return false;
+
+                                 // touch the last pixel of every frame, up to the first 64
+                                 auto& info = apng.GetInfo();
+                                 for (uint32_t k = 0; k < info.frameCount && k < 64; k++)
+                                 {
+                                     auto pixels = apng.Render(k);
+                                     if (pixels != nullptr)
+                                         sink = sink + pixels[static_cast<size_t>(info.width) * info.height * 4 - 1];
+                                 }
+                                 return true;
+                             });
+    }
+
+    int Bench(const char* path)
+    {
+        Harness::Stopwatch stopwatch;
+        ApngImage apng;
+        if (!apng.Open(path))
+            return 1;
+        auto index = stopwatch.Milliseconds();
+
+        auto& info = apng.GetInfo();
+        stopwatch.Restart();
+        apng.Render(0);
+        auto first = stopwatch.Milliseconds();
+
+        stopwatch.Restart();
+        for (uint32_t k = 0; k < info.frameCount; k++)
+            sink = sink ^ apng.Render(k)[0];
+        auto pass = stopwatch.Milliseconds();
+
+        stopwatch.Restart();
+        for (int loop = 0; loop < 2; loop++)
+        {
+            for (uint32_t k = 0; k < info.frameCount; k++)
+                sink = sink ^ apng.Render(k)[0];
+        }
+        auto looping = stopwatch.Milliseconds();
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("%ux%u, %u frames: index %.2f ms, first frame %.2f ms, %.3f ms a frame on the first pass and %.3f "
+               "looping, peak RSS %ld MB\n",
+               info.width, info.height, info.frameCount, index, first, pass / info.frameCount,
+               looping / (2.0 * info.frameCount), usage.ru_maxrss / 1024);
+
+        // half translucent pixels, so that no group of them takes the opaque or clear shortcut
+        std::vector<uint32_t> source(1 << 20), target(source.size());
+        std::mt19937 rng(1);
+        for (auto& color : source)
+            color = (rng() % 2 == 0 ? 0x80u : 0xFFu) << 24 | (rng() & 0x7F7F7F);
+        for (auto level : levels)
+        {
+            if (!Simd::Supports(level))
+                continue;
+
+            long rounds = 0;
+            stopwatch.Restart();
+            do
+            {
+                ApngImage::BlendOver(target.data(), source.data(), static_cast<uint32_t>(source.size()), level);
+                rounds++;
+            } while (stopwatch.Milliseconds() < 300);
+
+            // on x86 the NEON level runs the plain C++ model, which says nothing about ARM64
+            printf("BlendOver level %u: %.0f Mpixels/s%s\n", level,
+                   source.size() * rounds / stopwatch.Milliseconds() / 1e3,
+                   level == Simd::NEON && Simd::Best() != Simd::NEON ? " (model)" : "");
+        }
+        sink = sink ^ static_cast<uint8_t>(target[0]);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 2 ? argv[1] : "";
+    if (mode == "dump" && argc > 3)
+        return Dump(argv[2], argv[3]);
+    if (mode == "seek")
+        return Seek(argv[2], argc > 3 ? static_cast<uint32_t>(atol(argv[3])) : 1);
+    if (mode == "blend" && argc > 3)
+        return Blend(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]));
+    if (mode == "fuzz" && argc > 4)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+    if (mode == "bench")
+        return Bench(argv[2]);
+
+    fprintf(stderr, "usage: apng_check dump <file.png> <out> | seek <file.png> [seed] | blend <seed> <count> | "
+                    "fuzz <seed> <count> <file.png>... | bench <file.png>\n");
+    return 2;
+}
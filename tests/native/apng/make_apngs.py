@@ -0,0 +1,270 @@
+# Writes random APNG files and, next to each, what ApngImage must make of it:
+#
+#   make_apngs.py <directory> <count> [seed]          small files with every color type, bit depth,
+#                                                     filter, disposal and blend mix
+#   make_apngs.py --large <out.png> <w> <h> <frames>  one large screen-recording-like animation for timing
+#
+# The encoder is written from the PNG and APNG specifications: every scanline gets a random filter,
+# a third of the files are interlaced, the frame data is split over random IDAT and fdAT chunks, and
+# some files hide their default image from the animation. Because the generator knows the samples it
+# encoded, it composes the frames itself, from the samples rather than from the file. The expected
+# file has the layout of apng_check dump: Info, then each Frame and its premultiplied BGRA pixels.
+import os
+import random
+import struct
+import sys
+import zlib
+
+ADAM7 = [(0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4), (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2)]
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+DEPTHS = {0: [1, 2, 4, 8, 16], 2: [8, 16], 3: [1, 2, 4, 8], 4: [8, 16], 6: [8, 16]}
+DISPOSE_NONE, DISPOSE_BACKGROUND, DISPOSE_PREVIOUS = 0, 1, 2
+BLEND_SOURCE, BLEND_OVER = 0, 1
+
+
+def chunk(kind, body):
+    return struct.pack('>I', len(body)) + kind + body + struct.pack('>I', zlib.crc32(kind + body))
+
+
+def pack_row(samples, depth):
+    if depth == 16:
+        return b''.join(struct.pack('>H', sample) for sample in samples)
+    if depth == 8:
+        return bytes(samples)
+    out = bytearray()
+    bits = filled = 0
+    for sample in samples:
+        bits = bits << depth | sample
+        filled += depth
+        if filled == 8:
+            out.append(bits)
+            bits = filled = 0
+    if filled:
+        out.append(bits << 8 - filled)
+    return bytes(out)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filtered(row, prior, step, kind):
+    out = bytearray([kind])
+    for i, byte in enumerate(row):
+        a = row[i - step] if i >= step else 0
+        b = prior[i] if prior else 0
+        c = prior[i - step] if prior and i >= step else 0
+        predicted = (0, a, b, (a + b) >> 1, paeth(a, b, c))[kind]
+        out.append((byte - predicted) & 0xFF)
+    return out
+
+
+def encode(image, width, height, color_type, depth, interlaced, rnd, filters=range(5)):
+    """image holds a tuple of samples for each pixel, row by row."""
+    step = max(CHANNELS[color_type] * depth // 8, 1)
+    raw = bytearray()
+    for left, top, dx, dy in ADAM7 if interlaced else [(0, 0, 1, 1)]:
+        columns = range(left, width, dx)
+        if not columns:
+            continue
+        prior = None
+        for y in range(top, height, dy):
+            row = pack_row([sample for x in columns for sample in image[y][x]], depth)
+            raw += filtered(row, prior, step, rnd.choice(filters))
+            prior = row
+    return zlib.compress(bytes(raw), rnd.choice((0, 1, 6, 9)))
+
+
+def div255(value):
+    value += 128
+    return (value + (value >> 8)) >> 8
+
+
+def premultiplied(image, color_type, depth, palette, transparency):
+    """The frame as BGRA words the way ApngImage hands them out."""
+    def to8(sample):
+        if depth == 16:
+            return sample >> 8
+        return sample * 255 // ((1 << depth) - 1)
+
+    out = []
+    for row in image:
+        for pixel in row:
+            if color_type == 6:
+                r, g, b, a = (to8(sample) for sample in pixel)
+            elif color_type == 4:
+                gray, a = (to8(sample) for sample in pixel)
+                r = g = b = gray
+            elif color_type == 3:
+                index = pixel[0]
+                r, g, b = palette[index] if index < len(palette) else (0, 0, 0)
+                a = transparency[index] if transparency and index < len(transparency) else 255
+            elif transparency is not None and list(pixel) == transparency:
+                r = g = b = a = 0
+            elif color_type == 2:
+                r, g, b = (to8(sample) for sample in pixel)
+                a = 255
+            else:
+                r = g = b = to8(pixel[0])
+                a = 255
+            if a != 255:
+                r, g, b = div255(r * a), div255(g * a), div255(b * a)
+            out.append(a << 24 | r << 16 | g << 8 | b)
+    return out
+
+
+def blend_over(below, color):
+    inverse = 255 - (color >> 24)
+    out = 0
+    for shift in (0, 8, 16, 24):
+        channel = (color >> shift & 0xFF) + div255((below >> shift & 0xFF) * inverse)
+        out |= min(channel, 255) << shift
+    return out
+
+
+def compose(width, height, frames):
+    canvas = [0] * (width * height)
+    rendered = []
+    for left, top, w, h, disposal, blend, pixels in frames:
+        spots = [(top + y) * width + left + x for y in range(h) for x in range(w)]
+        saved = [canvas[spot] for spot in spots]
+        for spot, color in zip(spots, pixels):
+            canvas[spot] = color if blend == BLEND_SOURCE else blend_over(canvas[spot], color)
+        rendered.append(list(canvas))
+        for spot, old in zip(spots, saved):
+            if disposal == DISPOSE_BACKGROUND:
+                canvas[spot] = 0
+            elif disposal == DISPOSE_PREVIOUS:
+                canvas[spot] = old
+    return rendered
+
+
+def random_apng(path, expected, rnd):
+    width, height = rnd.randint(1, 40), rnd.randint(1, 40)
+    color_type = rnd.choice(list(CHANNELS))
+    depth = rnd.choice(DEPTHS[color_type])
+    interlaced = rnd.random() < 0.3
+    top_sample = (1 << depth) - 1
+
+    palette, transparency = [], None
+    if color_type == 3:
+        palette = [(rnd.randrange(256), rnd.randrange(256), rnd.randrange(256))
+                   for _ in range(rnd.randint(1, 1 << depth))]
+        if rnd.random() < 0.6:
+            transparency = [rnd.choice((0, 255, rnd.randrange(256))) for _ in range(rnd.randint(1, len(palette)))]
+    elif color_type in (0, 2) and rnd.random() < 0.5:
+        transparency = [rnd.randint(0, top_sample) for _ in range(CHANNELS[color_type])]
+
+    def random_image(w, h):
+        if color_type == 3:
+            # now and then an index past the palette, which shows as opaque black
+            colors = min(len(palette) + (rnd.random() < 0.1), 1 << depth)
+            return [[(rnd.randrange(colors),) for _ in range(w)] for _ in range(h)]
+        image = []
+        for _ in range(h):
+            row = []
+            for _ in range(w):
+                if transparency is not None and rnd.random() < 0.2:
+                    row.append(tuple(transparency))
+                else:
+                    row.append(tuple(rnd.choice((0, top_sample, rnd.randint(0, top_sample)))
+                                     for _ in range(CHANNELS[color_type])))
+            image.append(row)
+        return image
+
+    frame_count = rnd.randint(1, 8)
+    loops = rnd.choice((0, 1, 3))
+    hidden = rnd.random() < 0.3
+    physical = (rnd.randint(1, 20000), rnd.randint(1, 20000)) if rnd.random() < 0.3 else (0, 0)
+
+    out = bytearray(b'\x89PNG\r\n\x1a\n')
+    out += chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, depth, color_type, 0, 0, interlaced))
+    out += chunk(b'acTL', struct.pack('>II', frame_count, loops))
+    if physical[0]:
+        out += chunk(b'pHYs', struct.pack('>IIB', physical[0], physical[1], 1))
+    if palette:
+        out += chunk(b'PLTE', b''.join(bytes(color) for color in palette))
+    if transparency is not None:
+        out += chunk(b'tRNS', bytes(transparency) if color_type == 3 else
+                     b''.join(struct.pack('>H', sample) for sample in transparency))
+    if hidden:
+        out += chunk(b'IDAT', encode(random_image(width, height), width, height, color_type, depth, interlaced, rnd))
+
+    sequence = 0
+    frames, records = [], []
+    for index in range(frame_count):
+        if index == 0:
+            w, h, left, top = width, height, 0, 0
+        else:
+            w, h = rnd.randint(1, width), rnd.randint(1, height)
+            left, top = rnd.randint(0, width - w), rnd.randint(0, height - h)
+        numerator, denominator = rnd.randint(0, 10), rnd.choice((0, 100, 1000))
+        disposal, blend = rnd.randrange(3), rnd.randrange(2)
+        out += chunk(b'fcTL', struct.pack('>IIIIIHHBB', sequence, w, h, left, top, numerator, denominator,
+                                          disposal, blend))
+        sequence += 1
+
+        image = random_image(w, h)
+        data = encode(image, w, h, color_type, depth, interlaced, rnd)
+        cuts = sorted(rnd.sample(range(1, len(data)), min(rnd.randint(0, 3), len(data) - 1)))
+        for start, end in zip([0] + cuts, cuts + [len(data)]):
+            if index == 0 and not hidden:
+                out += chunk(b'IDAT', data[start:end])
+            else:
+                out += chunk(b'fdAT', struct.pack('>I', sequence) + data[start:end])
+                sequence += 1
+
+        # a first frame that restores the previous canvas clears it instead
+        if index == 0 and disposal == DISPOSE_PREVIOUS:
+            disposal = DISPOSE_BACKGROUND
+        frames.append((left, top, w, h, disposal, blend,
+                       premultiplied(image, color_type, depth, palette, transparency)))
+        delay = numerator * 1000 // (denominator or 100)
+        records.append(struct.pack('<7I', left, top, w, h, delay, disposal, blend))
+    out += chunk(b'IEND', b'')
+    open(path, 'wb').write(out)
+
+    with open(expected, 'wb') as dump:
+        dump.write(struct.pack('<6I', width, height, frame_count, loops, *physical))
+        for record, pixels in zip(records, compose(width, height, frames)):
+            dump.write(record)
+            dump.write(struct.pack('<%dI' % len(pixels), *pixels))
+
+
+def large_apng(path, width, height, count):
+    # a full RGBA first frame, then small rectangles blended over it, like a screen recording
+    rnd = random.Random(1)
+    line = bytes(rnd.randrange(256) for _ in range(width * 4))
+    image = [[tuple(line[x * 4:x * 4 + 4]) for x in range(width)] for _ in range(height)]
+    out = bytearray(b'\x89PNG\r\n\x1a\n')
+    out += chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 6, 0, 0, 0))
+    out += chunk(b'acTL', struct.pack('>II', count, 0))
+    sequence = 0
+    for index in range(count):
+        w, h = (width, height) if index == 0 else (rnd.randint(16, width // 4), rnd.randint(16, height // 4))
+        left, top = (0, 0) if index == 0 else (rnd.randint(0, width - w), rnd.randint(0, height - h))
+        out += chunk(b'fcTL', struct.pack('>IIIIIHHBB', sequence, w, h, left, top, 1, 30, 0, index != 0))
+        sequence += 1
+        data = encode([row[left:left + w] for row in image[top:top + h]], w, h, 6, 8, False, rnd, filters=[0, 1])
+        if index == 0:
+            out += chunk(b'IDAT', data)
+        else:
+            out += chunk(b'fdAT', struct.pack('>I', sequence) + data)
+            sequence += 1
+    out += chunk(b'IEND', b'')
+    open(path, 'wb').write(out)
+
+
+if __name__ == '__main__':
+    if sys.argv[1] == '--large':
+        large_apng(sys.argv[2], int(sys.argv[3]), int(sys.argv[4]), int(sys.argv[5]))
+    else:
+        os.makedirs(sys.argv[1], exist_ok=True)
+        rnd = random.Random(int(sys.argv[3]) if len(sys.argv) > 3 else 1)
+        for i in range(int(sys.argv[2])):
+            name = os.path.join(sys.argv[1], 'random%03d' % i)
+            random_apng(name + '.png', name + '.expected', rnd)
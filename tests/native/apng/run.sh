@@ -0,0 +1,28 @@
+#!/bin/sh
+# Checks ApngImage on random APNG files from make_apngs.py: every frame and its composed pixels must
+# match what the generator expects from the samples it encoded, rendering frames out of order must
+# give the same pixels, BlendOver must agree with a reference at every SIMD level, and mutations of
+# the files must not trip the sanitizers. The build includes the NEON model from ../neon, so the
+# NEON blend runs too. BENCH=1 also times a large animation and BlendOver. Needs python3.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/apng_check.cpp $native/ApngImage.cpp $native/Inflate.cpp $native/MappedFile.cpp $native/Simd.cpp"
+neon="-DQL_SIMD_NEON -include $here/../neon/arm_neon.h"
+build apng_check $neon $sources
+
+python3 "$here/make_apngs.py" "$out/apngs" "${APNGS:-150}"
+for png in "$out"/apngs/*.png; do
+    "$out/apng_check" dump "$png" "$out/dump.bin"
+    same "${png%.png}.expected" "$out/dump.bin"
+    "$out/apng_check" seek "$png"
+done
+echo "every frame matches, also out of order"
+
+"$out/apng_check" blend 2 "${BLENDS:-200000}"
+"$out/apng_check" fuzz 3 "$(iterations 20000)" "$out"/apngs/*.png
+
+if bench; then
+    build_bench apng_bench $neon $sources
+    python3 "$here/make_apngs.py" --large "$out/large.png" 800 600 120
+    "$out/apng_bench" bench "$out/large.png"
+fi
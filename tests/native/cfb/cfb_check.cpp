@@ -0,0 +1,231 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks CompoundFile from the command line:
+//
+//   cfb_check print <file>                    lists every storage and stream with its size and hash
+//   cfb_check bench <file>                    times opening, listing the root and reading every stream
+//   cfb_check fuzz <seed> <count> <file>...   walks count mutations of the files
+//
+// The print format matches make_cfb.py manifests and reference.py, so that they can be compared
+// with diff.
+
+#include "CompoundFile.h"
+#include "harness.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t STORAGE = 1;
+
+    // a corrupt file can nest storages deeply, but every entry is claimed once, so this only
+    // bounds the recursion
+    constexpr int MAXIMUM_DEPTH = 64;
+
+    volatile uint8_t sink;
+
+    // the names are little-endian UTF-16
+    std::string Utf8(const uint8_t* utf16, uint32_t length)
+    {
+        std::string out;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            uint32_t c = utf16[2 * i] | utf16[2 * i + 1] << 8;
+            if (c >= 0xd800 && c < 0xdc00 && i + 1 < length)
+            {
+                uint32_t low = utf16[2 * i + 2] | utf16[2 * i + 3] << 8;
+                c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                i++;
+            }
+
+            if (c < 0x80)
+            {
+                out += char(c);
+            }
+            else if (c < 0x800)
+            {
+                out += char(0xc0 | c >> 6);
+                out += char(0x80 | (c & 63));
+            }
+            else if (c < 0x10000)
+            {
+                out += char(0xe0 | c >> 12);
+                out += char(0x80 | (c >> 6 & 63));
+                out += char(0x80 | (c & 63));
+            }
+            else
+            {
+                out += char(0xf0 | c >> 18);
+                out += char(0x80 | (c >> 12 & 63));
+                out += char(0x80 | (c >> 6 & 63));
+                out += char(0x80 | (c & 63));
+            }
+        }
+        return out;
+    }
+
+    // FNV-1a over the stream, read in runs of at most a few segments at a time
+    uint64_t HashStream(CompoundFile& file, uint32_t id, uint64_t* size)
+    {
+        CompoundFile::SegmentCursor cursor = {};
+        CompoundFile::Segment segments[3];
+        uint64_t hash = 0xcbf29ce484222325ull;
+        *size = 0;
+        for (uint32_t n; (n = file.ReadSegments(id, &cursor, segments, 3)) != 0;)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                for (uint32_t at = 0; at < segments[i].length; at++)
+                    hash = (hash ^ segments[i].data[at]) * 0x100000001b3ull;
+                *size += segments[i].length;
+            }
+        }
+        return hash;
+    }
+
+    // Lists the children of storage; with print unset it only touches every name and stream.
+    size_t Walk(CompoundFile& file, uint32_t storage, const std::string& path, bool print, int depth)
+    {
+        if (depth > MAXIMUM_DEPTH)
+            return 0;
+
+        size_t total = 0;
+        uint32_t ids[5];
+        for (uint32_t n, start = 0; (n = file.ReadChildren(storage, start, ids, 5)) != 0; start += n)
+        {
+            for (uint32_t i = 0; i < n; i++, total++)
+            {
+                CompoundFile::Entry entry;
+                if (!file.GetEntry(ids[i], &entry))
+                {
+                    if (print)
+                        printf("%s/?\tunreadable\n", path.c_str());
+                    continue;
+                }
+
+                if (!print)
+                {
+                    if (entry.nameLength != 0)
+                        sink += entry.name[2 * entry.nameLength - 1];
+                    uint64_t size;
+                    sink += static_cast<uint8_t>(HashStream(file, ids[i], &size));
+                    if (entry.type == STORAGE)
+                        total += Walk(file, ids[i], path, false, depth + 1);
+                    continue;
+                }
+
+                auto name = path + "/" + Utf8(entry.name, entry.nameLength);
+                if (entry.type == STORAGE)
+                {
+                    printf("%s\tS\n", name.c_str());
+                    total += Walk(file, ids[i], name, true, depth + 1);
+                    continue;
+                }
+
+                uint64_t size;
+                auto hash = HashStream(file, ids[i], &size);
+                printf("%s\t%" PRIu64 "\t%016" PRIx64 "%s\n", name.c_str(), entry.size, hash,
+                       size == entry.size ? "" : "\tshort");
+            }
+        }
+        return total;
+    }
+
+    int Print(const char* path)
+    {
+        CompoundFile file;
+        if (!file.Open(path))
+            return 1;
+
+        Walk(file, CompoundFile::ROOT, "", true, 0);
+        return 0;
+    }
+
+    int Bench(const char* path)
+    {
+        for (int run = 0; run < 3; run++)
+        {
+            Harness::Stopwatch stopwatch;
+            CompoundFile file;
+            if (!file.Open(path))
+                return 1;
+
+            auto open = stopwatch.Milliseconds();
+            stopwatch.Restart();
+            std::vector<uint32_t> ids;
+            uint32_t page[256];
+            for (uint32_t n; (n = file.ReadChildren(CompoundFile::ROOT, static_cast<uint32_t>(ids.size()), page,
+                                                    256)) != 0;)
+                ids.insert(ids.end(), page, page + n);
+            auto list = stopwatch.Milliseconds();
+
+            stopwatch.Restart();
+            uint64_t bytes = 0;
+            for (auto id : ids)
+            {
+                CompoundFile::SegmentCursor cursor = {};
+                CompoundFile::Segment segments[64];
+                for (uint32_t n; (n = file.ReadSegments(id, &cursor, segments, 64)) != 0;)
+                {
+                    for (uint32_t s = 0; s < n; s++)
+                    {
+                        sink += segments[s].data[segments[s].length - 1];
+                        bytes += segments[s].length;
+                    }
+                }
+            }
+            auto read = stopwatch.Milliseconds();
+
+            printf("open %.3f ms, %zu root children listed in %.1f ms, %" PRIu64 " stream bytes walked in %.1f ms\n",
+                   open, ids.size(), list, bytes, read);
+        }
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        // the header and the FAT and directory sectors that usually follow it
+        Harness::Mutator mutate;
+        mutate.maximumChanges = 16;
+        return Harness::Fuzz(Harness::ReadFiles(paths, count, 512), iterations, seed, mutate,
+                             [](const std::vector<uint8_t>& buffer)
+                             {
+                                 CompoundFile file;
+                                 return file.Parse(buffer.data(), buffer.size()) &&
+                                        Walk(file, CompoundFile::ROOT, "", false, 0) != 0;
+                             });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "print" && argc == 3)
+        return Print(argv[2]);
+    if (mode == "bench" && argc == 3)
+        return Bench(argv[2]);
+    if (mode == "fuzz" && argc >= 5)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+
+    fprintf(stderr, "usage: cfb_check print <file> | bench <file> | fuzz <seed> <count> <file>...\n");
+    return 2;
+}
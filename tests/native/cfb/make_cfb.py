@@ -0,0 +1,232 @@
+# Writes a random Compound File Binary container and the list of what it holds:
+#
+#   make_cfb.py <out> <manifest> [seed] [--big] [--flat N]
+#
+# Version 3 (512-byte sectors) and version 4 (4096-byte sectors) files are mixed, as are nested
+# storages, empty streams, mini streams, sizes around the sector and cutoff boundaries and names
+# with MSI-encoded characters. Sectors and mini sectors are handed out in a shuffled order half
+# of the time, so that chains jump around the file. Version 3 files get garbage in the high half
+# of the stream size, which readers must ignore. --big adds multi-megabyte streams, enough for the
+# FAT to continue in DIFAT sectors, and --flat N puts N streams directly in the root instead of a
+# random tree.
+#
+# The manifest has one line per entry in the order the storage lists them: the path and "S" for a
+# storage, or the path, size and FNV-1a hash of the contents for a stream.
+import random
+import struct
+import sys
+
+FREE, END_OF_CHAIN, FAT_SECTOR, DIFAT_SECTOR = 0xFFFFFFFF, 0xFFFFFFFE, 0xFFFFFFFD, 0xFFFFFFFC
+NO_STREAM = 0xFFFFFFFF
+STORAGE, STREAM, ROOT = 1, 2, 5
+MINI_SECTOR_SIZE = 64
+MINI_STREAM_CUTOFF = 4096
+HEADER_DIFAT = 109
+
+# \x05 starts the property set streams, U+3800 to U+4840 are MSI table and stream names
+NAME_CHARACTERS = 'abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_ .é中\x05䡀㨌䟢'
+
+
+def fnv(data):
+    value = 0xcbf29ce484222325
+    for byte in data:
+        value = (value ^ byte) * 0x100000001b3 & 0xFFFFFFFFFFFFFFFF
+    return value
+
+
+class Entry:
+    def __init__(self, name, kind, data=b''):
+        self.name = name
+        self.kind = kind
+        self.data = data
+        self.children = []
+        self.start = END_OF_CHAIN
+        self.left = self.right = self.child = NO_STREAM
+
+
+def contents(rnd, size):
+    block = rnd.randbytes(min(size, 4096))
+    return (block * (size // 4096 + 1))[:size]
+
+
+def build_tree(rnd, entries, parent, depth, big):
+    names = set()
+    for _ in range(rnd.randint(0, 12 if depth == 0 else 6)):
+        name = ''.join(rnd.choice(NAME_CHARACTERS) for _ in range(rnd.randint(1, 31)))
+        if name.upper() in names:
+            continue
+        names.add(name.upper())
+        if depth < 4 and rnd.random() < 0.25:
+            entry = Entry(name, STORAGE)
+            entries.append(entry)
+            parent.children.append(len(entries) - 1)
+            build_tree(rnd, entries, entry, depth + 1, big)
+            continue
+
+        pick = rnd.random()
+        if big and pick < 0.35:
+            size = rnd.randint(200000, 3000000)
+        elif pick < 0.1:
+            size = 0
+        elif pick < 0.5:
+            size = rnd.randint(1, MINI_STREAM_CUTOFF - 1)
+        elif pick < 0.6:
+            size = rnd.choice([63, 64, 65, 512, 513, 4095, 4096, 4097])
+        else:
+            size = rnd.randint(MINI_STREAM_CUTOFF, 60000)
+        entries.append(Entry(name, STREAM, contents(rnd, size)))
+        parent.children.append(len(entries) - 1)
+
+
+def balanced(entries, ids):
+    # directory order: shorter names first, then by upper-cased code units
+    if not ids:
+        return NO_STREAM
+    middle = len(ids) // 2
+    entries[ids[middle]].left = balanced(entries, ids[:middle])
+    entries[ids[middle]].right = balanced(entries, ids[middle + 1:])
+    return ids[middle]
+
+
+def write(out, manifest, rnd, big, flat):
+    version4 = rnd.random() < 0.4
+    shift = 12 if version4 else 9
+    sector_size = 1 << shift
+    per_sector = sector_size // 4
+
+    entries = [Entry('Root Entry', ROOT)]
+    if flat:
+        for i in range(flat):
+            entries.append(Entry('stream%06d' % i, STREAM, contents(rnd, rnd.choice((0, 64, 100, 5000)))))
+            entries[0].children.append(i + 1)
+    else:
+        build_tree(rnd, entries, entries[0], 0, big)
+
+    # small streams go to the mini stream, which the root entry holds
+    small = [entry for entry in entries if entry.kind == STREAM and 0 < len(entry.data) < MINI_STREAM_CUTOFF]
+    mini_sectors = sum((len(entry.data) + MINI_SECTOR_SIZE - 1) // MINI_SECTOR_SIZE for entry in small)
+    order = list(range(mini_sectors))
+    if rnd.random() < 0.5:
+        rnd.shuffle(order)
+    mini_stream = bytearray(mini_sectors * MINI_SECTOR_SIZE)
+    mini_fat = [FREE] * mini_sectors
+    taken = 0
+    for entry in small:
+        count = (len(entry.data) + MINI_SECTOR_SIZE - 1) // MINI_SECTOR_SIZE
+        chain = order[taken:taken + count]
+        taken += count
+        for i, sector in enumerate(chain):
+            piece = entry.data[i * MINI_SECTOR_SIZE:(i + 1) * MINI_SECTOR_SIZE]
+            mini_stream[sector * MINI_SECTOR_SIZE:sector * MINI_SECTOR_SIZE + len(piece)] = piece
+            mini_fat[sector] = chain[i + 1] if i + 1 < count else END_OF_CHAIN
+        entry.start = chain[0]
+    entries[0].data = bytes(mini_stream)
+
+    for entry in entries:
+        if entry.kind in (STORAGE, ROOT):
+            entry.child = balanced(entries, sorted(entry.children,
+                                                   key=lambda i: (len(entries[i].name), entries[i].name.upper())))
+
+    # sector counts: data, then as many FAT and DIFAT sectors as it takes to describe them all
+    directory_sectors = (len(entries) * 128 + sector_size - 1) // sector_size
+    mini_fat_sectors = (len(mini_fat) * 4 + sector_size - 1) // sector_size
+    large = [entry for entry in entries
+             if entry.kind == STREAM and len(entry.data) >= MINI_STREAM_CUTOFF or entry.kind == ROOT and entry.data]
+    data_sectors = directory_sectors + mini_fat_sectors + sum(
+        (len(entry.data) + sector_size - 1) // sector_size for entry in large)
+    fat_sectors = difat_sectors = 0
+    while True:
+        fat = (data_sectors + fat_sectors + difat_sectors + per_sector - 1) // per_sector
+        difat = (fat - HEADER_DIFAT + per_sector - 2) // (per_sector - 1) if fat > HEADER_DIFAT else 0
+        if (fat, difat) == (fat_sectors, difat_sectors):
+            break
+        fat_sectors, difat_sectors = fat, difat
+
+    free = list(range(data_sectors + fat_sectors + difat_sectors))
+    if rnd.random() < 0.6:
+        rnd.shuffle(free)
+    free = iter(free)
+    fat = [FREE] * (fat_sectors * per_sector)
+
+    def allocate(count, mark=None):
+        chain = [next(free) for _ in range(count)]
+        for i, sector in enumerate(chain):
+            fat[sector] = mark if mark is not None else chain[i + 1] if i + 1 < count else END_OF_CHAIN
+        return chain
+
+    fat_chain = allocate(fat_sectors, FAT_SECTOR)
+    difat_chain = allocate(difat_sectors, DIFAT_SECTOR)
+    directory_chain = allocate(directory_sectors)
+    mini_fat_chain = allocate(mini_fat_sectors)
+    image = bytearray((len(fat_chain) + len(difat_chain) + data_sectors + 1) * sector_size)
+
+    def put(chain, data):
+        for i, sector in enumerate(chain):
+            piece = data[i * sector_size:(i + 1) * sector_size]
+            image[(sector + 1) * sector_size:(sector + 1) * sector_size + len(piece)] = piece
+
+    for entry in large:
+        chain = allocate((len(entry.data) + sector_size - 1) // sector_size)
+        entry.start = chain[0]
+        put(chain, entry.data)
+    put(mini_fat_chain, b''.join(struct.pack('<I', value) for value in mini_fat))
+
+    directory = bytearray(directory_sectors * sector_size)
+    for i in range(len(entries), len(directory) // 128):
+        struct.pack_into('<III', directory, i * 128 + 68, NO_STREAM, NO_STREAM, NO_STREAM)
+    for i, entry in enumerate(entries):
+        name = entry.name.encode('utf-16-le')
+        at = i * 128
+        directory[at:at + len(name)] = name
+        struct.pack_into('<HBBIII', directory, at + 64, len(name) + 2, entry.kind, 1, entry.left, entry.right,
+                         entry.child)
+        if entry.kind != STREAM:
+            struct.pack_into('<QQ', directory, at + 100, rnd.getrandbits(56), rnd.getrandbits(56))
+        struct.pack_into('<I', directory, at + 116, entry.start)
+        if version4:
+            struct.pack_into('<Q', directory, at + 120, len(entry.data))
+        else:
+            struct.pack_into('<II', directory, at + 120, len(entry.data), rnd.getrandbits(32))
+    put(directory_chain, directory)
+    put(fat_chain, b''.join(struct.pack('<I', value) for value in fat))
+
+    # the first 109 FAT sectors are listed in the header, the rest in the DIFAT chain
+    rest = fat_chain[HEADER_DIFAT:]
+    for i, sector in enumerate(difat_chain):
+        listed = rest[i * (per_sector - 1):(i + 1) * (per_sector - 1)]
+        listed += [FREE] * (per_sector - 1 - len(listed))
+        listed.append(difat_chain[i + 1] if i + 1 < len(difat_chain) else END_OF_CHAIN)
+        put([sector], b''.join(struct.pack('<I', value) for value in listed))
+
+    header = bytearray(512)
+    header[0:8] = bytes.fromhex('D0CF11E0A1B11AE1')
+    struct.pack_into('<HHHHH', header, 0x18, 0x3E, 4 if version4 else 3, 0xFFFE, shift, 6)
+    struct.pack_into('<9I', header, 0x28, directory_sectors if version4 else 0, fat_sectors, directory_chain[0], 0,
+                     MINI_STREAM_CUTOFF, mini_fat_chain[0] if mini_fat_chain else END_OF_CHAIN, mini_fat_sectors,
+                     difat_chain[0] if difat_chain else END_OF_CHAIN, difat_sectors)
+    listed = fat_chain[:HEADER_DIFAT]
+    struct.pack_into('<109I', header, 0x4C, *(listed + [FREE] * (HEADER_DIFAT - len(listed))))
+    image[0:512] = header
+    open(out, 'wb').write(image)
+
+    with open(manifest, 'w', encoding='utf-8') as lines:
+        def walk(index, path):
+            for child in sorted(entries[index].children,
+                                key=lambda i: (len(entries[i].name), entries[i].name.upper())):
+                entry = entries[child]
+                name = path + '/' + entry.name
+                if entry.kind == STORAGE:
+                    lines.write('%s\tS\n' % name)
+                    walk(child, name)
+                else:
+                    lines.write('%s\t%d\t%016x\n' % (name, len(entry.data), fnv(entry.data)))
+
+        walk(0, '')
+
+
+arguments = [argument for argument in sys.argv[1:] if not argument.startswith('--')]
+flat_count = int(sys.argv[sys.argv.index('--flat') + 1]) if '--flat' in sys.argv else 0
+if flat_count:
+    arguments.remove(str(flat_count))
+write(arguments[0], arguments[1], random.Random(int(arguments[2]) if len(arguments) > 2 else 1), '--big' in sys.argv,
+      flat_count)
@@ -0,0 +1,94 @@
+# Lists a Compound File Binary container in the format of make_cfb.py manifests:
+#
+#   reference.py <file>
+#
+# A plain reader written from MS-CFB that loads the whole FAT, mini FAT and directory up front,
+# for comparison with CompoundFile, which collects them lazily and walks chains in place.
+import struct
+import sys
+
+END_OF_CHAIN = 0xFFFFFFFA  # and everything above it
+NO_STREAM = 0xFFFFFFFF
+STORAGE, STREAM = 1, 2
+
+
+def fnv(data):
+    value = 0xcbf29ce484222325
+    for byte in data:
+        value = (value ^ byte) * 0x100000001b3 & 0xFFFFFFFFFFFFFFFF
+    return value
+
+
+image = open(sys.argv[1], 'rb').read()
+version, shift = struct.unpack_from('<HxxH', image, 0x1A)
+sector_size = 1 << shift
+(fat_count, directory_start, _, cutoff, mini_fat_start, _, difat_start, _) = struct.unpack_from('<8I', image, 0x2C)
+
+
+def sector(number):
+    return image[(number + 1) * sector_size:(number + 2) * sector_size]
+
+
+fat_sectors = list(struct.unpack_from('<109I', image, 0x4C))
+number = difat_start
+while number < END_OF_CHAIN:
+    listed = struct.unpack('<%dI' % (sector_size // 4), sector(number))
+    fat_sectors += listed[:-1]
+    number = listed[-1]
+fat = []
+for number in fat_sectors[:fat_count]:
+    fat += struct.unpack('<%dI' % (sector_size // 4), sector(number))
+
+
+def read(start, size=None):
+    chain = []
+    while start < END_OF_CHAIN:
+        chain.append(sector(start))
+        start = fat[start]
+    return b''.join(chain)[:size]
+
+
+directory = read(directory_start)
+entries = [directory[at:at + 128] for at in range(0, len(directory), 128)]
+mini_stream = read(*struct.unpack_from('<II', entries[0], 116))
+mini_fat_data = read(mini_fat_start)
+mini_fat = struct.unpack('<%dI' % (len(mini_fat_data) // 4), mini_fat_data)
+
+
+def read_mini(start, size):
+    chain = []
+    while start < END_OF_CHAIN:
+        chain.append(mini_stream[start * 64:(start + 1) * 64])
+        start = mini_fat[start]
+    return b''.join(chain)[:size]
+
+
+def in_order(index, out):
+    if index == NO_STREAM:
+        return
+    left, right = struct.unpack_from('<II', entries[index], 68)
+    in_order(left, out)
+    out.append(index)
+    in_order(right, out)
+
+
+def walk(index, path):
+    children = []
+    in_order(struct.unpack_from('<I', entries[index], 76)[0], children)
+    for child in children:
+        entry = entries[child]
+        name_size = struct.unpack_from('<H', entry, 64)[0]
+        name = path + '/' + entry[:max(name_size - 2, 0)].decode('utf-16-le', 'surrogatepass')
+        if entry[66] == STORAGE:
+            print('%s\tS' % name)
+            walk(child, name)
+        elif entry[66] == STREAM:
+            # version 3 files may have garbage in the high half of the size
+            size = struct.unpack_from('<I' if version == 3 else '<Q', entry, 120)[0]
+            start = struct.unpack_from('<I', entry, 116)[0]
+            data = read_mini(start, size) if size < cutoff else read(start, size)
+            print('%s\t%d\t%016x' % (name, size, fnv(data)))
+
+
+sys.stdout.reconfigure(encoding='utf-8')
+walk(0, '')
@@ -0,0 +1,51 @@
+#!/bin/sh
+# Checks CompoundFile on a corpus of generated containers and on whatever compound files the system
+# has (CFB_FILES, by default the first 20 Office, MSI, Visual Studio and Thumbs.db style files
+# under /usr/share and /usr/lib): every storage and stream, with its size and contents, must match
+# the manifest make_cfb.py wrote and what reference.py reads, and mutations must not trip the
+# sanitizers. BENCH=1 also times a container with 40000 streams in its root and one with
+# multi-megabyte streams. Needs python3.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/cfb_check.cpp $native/CompoundFile.cpp $native/MappedFile.cpp"
+build cfb_check $sources
+
+generated=
+for seed in $(seq 1 "${CONTAINERS:-40}"); do
+    python3 "$here/make_cfb.py" "$out/generated$seed.cfb" "$out/generated$seed.txt" $seed
+    "$out/cfb_check" print "$out/generated$seed.cfb" > "$out/generated$seed.out"
+    same "$out/generated$seed.txt" "$out/generated$seed.out"
+    generated="$generated $out/generated$seed.cfb"
+done
+echo "$(echo $generated | wc -w) generated containers match"
+
+# seed 5 is a version 3 file whose FAT continues in DIFAT sectors
+python3 "$here/make_cfb.py" "$out/big.cfb" "$out/big.txt" 5 --big
+"$out/cfb_check" print "$out/big.cfb" > "$out/big.out"
+same "$out/big.txt" "$out/big.out"
+echo "big.cfb: $(wc -l < "$out/big.txt") entries match"
+
+found=
+candidates=$(find /usr/share /usr/lib -type f \( -name '*.doc' -o -name '*.xls' -o -name '*.ppt' -o -name '*.msi' \
+    -o -name '*.msg' -o -name '*.vsmacros' -o -name '*.suo' -o -name '*.db' -o -name '*.cfb' \) 2>/dev/null)
+for file in ${CFB_FILES-$candidates}; do
+    if [ "$(head -c 8 "$file" | od -An -tx1 | tr -d ' \n')" = d0cf11e0a1b11ae1 ] &&
+        [ "$(echo $found | wc -w)" -lt 20 ]; then
+        found="$found $file"
+    fi
+done
+for file in $found; do
+    python3 "$here/reference.py" "$file" > "$out/file.ref"
+    "$out/cfb_check" print "$file" > "$out/file.out"
+    same "$out/file.ref" "$out/file.out"
+    echo "$(basename "$file"): $(wc -l < "$out/file.ref") entries match"
+done
+
+"$out/cfb_check" fuzz 7 "$(iterations 20000)" $generated $found
+
+if bench; then
+    build_bench cfb_bench $sources
+    python3 "$here/make_cfb.py" "$out/wide.cfb" "$out/wide.txt" 1 --flat 40000
+    "$out/cfb_bench" bench "$out/wide.cfb"
+    "$out/cfb_bench" bench "$out/big.cfb"
+fi
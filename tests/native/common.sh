@@ -0,0 +1,50 @@
+# Shared by the run.sh of every harness, which sources it with
+#
+#   . "$(dirname "$0")/../common.sh"
+#
+# It stops the script at the first failure and sets $here to the harness directory, $native to the
+# native sources and $out to the directory for builds and scratch files ($OUT, or out/ next to the
+# harness). Then:
+#
+#   build <name> <argument>...        compiles with ASan and UBSan into $out/<name>
+#   build_bench <name> <argument>...  compiles an -O2 build without sanitizers into $out/<name>
+#   iterations <default>              the number of fuzz cases: $ITERATIONS, or the default
+#   bench                             whether BENCH is set, which asks for the timings too
+#   same <expected> <actual>          fails unless the two files are equal
+#
+# Both builds see the native sources and harness.h on the include path and warn with -Wall -Wextra;
+# $CXX picks the compiler, g++ by default.
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+native=$(cd "$here/../../../QuickLook.Native/QuickLook.Native32" && pwd)
+out=${OUT:-"$here/out"}
+mkdir -p "$out"
+
+build() {
+    name=$1
+    shift
+    ${CXX:-g++} -std=c++17 -Wall -Wextra -I"$native" -I"$here/.." -O1 -g -fsanitize=address,undefined \
+        -fno-sanitize-recover=undefined "$@" -pthread -o "$out/$name"
+}
+
+build_bench() {
+    name=$1
+    shift
+    ${CXX:-g++} -std=c++17 -Wall -Wextra -I"$native" -I"$here/.." -O2 "$@" -pthread -o "$out/$name"
+}
+
+iterations() {
+    echo "${ITERATIONS:-$1}"
+}
+
+bench() {
+    [ -n "$BENCH" ]
+}
+
+same() {
+    if ! cmp -s "$1" "$2"; then
+        echo "$2 differs from $1" >&2
+        exit 1
+    fi
+}
@@ -0,0 +1,359 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks CsvTable from the command line:
+//
+//   csv_check kernels <seed> <count>              compares Skip and Split with plain reference loops
+//   csv_check table <scratch file> <seed> <count> indexes random files and checks every row lookup
+//   csv_check bench <file> [MB]                   times the Skip kernels and a full index of the file,
+//                                                 writing MB megabytes of CSV to it first if it is missing
+//
+// Skip is run at every SIMD level this CPU runs.
+
+#include "CsvTable.h"
+#include "harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const Simd::Level levels[] = {Simd::SCALAR, Simd::SSE2, Simd::AVX2, Simd::NEON};
+
+    size_t ReferenceSkip(const uint8_t* data, size_t size, bool* quoted, uint64_t* count)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if (data[i] == '"')
+                *quoted = !*quoted;
+            else if (data[i] == '\n' && !*quoted && --*count == 0)
+                return i + 1;
+        }
+        return size;
+    }
+
+    std::vector<std::string> ReferenceSplit(std::string row, char delimiter)
+    {
+        if (!row.empty() && row.back() == '\n')
+            row.pop_back();
+        if (!row.empty() && row.back() == '\r')
+            row.pop_back();
+
+        std::vector<std::string> fields(1);
+        auto quoted = false;
+        for (size_t i = 0; i < row.size(); i++)
+        {
+            if (row[i] == '"')
+            {
+                if (quoted && i + 1 < row.size() && row[i + 1] == '"')
+                {
+                    fields.back() += '"';
+                    i++;
+                }
+                else
+                {
+                    quoted = !quoted;
+                }
+            }
+            else if (row[i] == delimiter && !quoted)
+            {
+                fields.emplace_back();
+            }
+            else
+            {
+                fields.back() += row[i];
+            }
+        }
+        return fields;
+    }
+
+    int Kernels(uint32_t seed, long iterations)
+    {
+        static const char alphabet[] = "ab,\"\n;\r\t|";
+
+        std::mt19937_64 rng(seed);
+        for (long iteration = 0; iteration < iterations; iteration++)
+        {
+            // mostly plain bytes with a few specials, or only specials
+            size_t size = rng() % 400;
+            std::vector<uint8_t> data(size);
+            auto dense = rng() % 4 == 0;
+            for (auto& byte : data)
+                byte = dense || rng() % 10 >= 8 ? alphabet[rng() % 9] : 'x';
+
+            auto quotedBefore = (rng() & 1) != 0;
+            uint64_t countBefore = 1 + rng() % 20;
+            auto expectedQuoted = quotedBefore;
+            auto expectedCount = countBefore;
+            auto expected = ReferenceSkip(data.data(), size, &expectedQuoted, &expectedCount);
+
+            for (auto level : levels)
+            {
+                if (!Simd::Supports(level))
+                    continue;
+
+                auto quoted = quotedBefore;
+                auto count = countBefore;
+                auto stopped = CsvTable::Skip(data.data(), size, &quoted, &count, level);
+                if (stopped != expected || count != expectedCount || quoted != expectedQuoted)
+                {
+                    printf("Skip mismatch at level %u for %zu bytes: stopped at %zu, not %zu\n", level, size, stopped,
+                           expected);
+                    return 1;
+                }
+            }
+
+            std::string row(data.begin(), data.begin() + std::min<size_t>(size, 60));
+            auto delimiter = ",;\t|"[rng() % 4];
+            auto fields = ReferenceSplit(row, delimiter);
+            uint8_t text[128];
+            uint32_t fieldEnds[64];
+            uint32_t capacity = rng() % 80;
+            uint32_t maxFields = 1 + rng() % 40;
+            auto count = CsvTable::Split(reinterpret_cast<const uint8_t*>(row.data()), row.size(),
+                                         static_cast<uint8_t>(delimiter), text, capacity, fieldEnds, maxFields);
+
+            auto expectedFields = std::min<size_t>(fields.size(), maxFields);
+            if (count != expectedFields)
+            {
+                printf("Split found %u fields, not %zu\n", count, expectedFields);
+                return 1;
+            }
+
+            std::string joined;
+            for (size_t k = 0; k < expectedFields; k++)
+            {
+                joined += fields[k];
+                if (fieldEnds[k] != std::min<size_t>(joined.size(), capacity))
+                {
+                    printf("Split ends field %zu at %u\n", k, fieldEnds[k]);
+                    return 1;
+                }
+            }
+            joined.resize(std::min<size_t>(joined.size(), capacity));
+            if (memcmp(text, joined.data(), joined.size()) != 0)
+            {
+                printf("Split text differs\n");
+                return 1;
+            }
+        }
+
+        printf("Skip and Split agree on %ld inputs; best level %u\n", iterations, Simd::Best());
+        return 0;
+    }
+
+    int Table(const char* path, uint32_t seed, long iterations)
+    {
+        static const char alphabet[] = "ab,\"\n;\r";
+
+        std::mt19937_64 rng(seed);
+        for (long iteration = 0; iteration < iterations; iteration++)
+        {
+            // now and then a file larger than one MappedWindow
+            size_t size = rng() % (iteration % 50 == 0 ? 3000000 : 5000);
+            std::string data(size, 'x');
+            for (auto& byte : data)
+                byte = rng() % 10 < 7 ? 'x' : alphabet[rng() % 7];
+            auto start = std::min<uint64_t>(size != 0 ? rng() % 4 : 0, size);
+
+            auto file = fopen(path, "wb");
+            if (file == nullptr)
+                return 1;
+            fwrite(data.data(), 1, size, file);
+            fclose(file);
+
+            std::vector<uint64_t> starts{start};
+            auto quoted = false;
+            for (size_t i = start; i < size; i++)
+            {
+                if (data[i] == '"')
+                    quoted = !quoted;
+                else if (data[i] == '\n' && !quoted)
+                    starts.push_back(i + 1);
+            }
+            uint64_t rows = starts.size() - 1;
+            if (starts.back() != size)
+            {
+                rows++;
+                starts.push_back(size);
+            }
+
+            CsvTable table;
+            if (!table.Open(path, start, ','))
+            {
+                printf("cannot open %s\n", path);
+                return 1;
+            }
+            while (table.Build(static_cast<uint32_t>(1 + rng() % 100000)))
+            {
+            }
+
+            auto info = table.GetInfo();
+            if (info.rows != rows || info.indexed != size || info.size != size)
+            {
+                printf("indexed %llu rows, not %llu, in %zu bytes\n", static_cast<unsigned long long>(info.rows),
+                       static_cast<unsigned long long>(rows), size);
+                return 1;
+            }
+
+            for (int lookup = 0; lookup < 30 && rows != 0; lookup++)
+            {
+                auto first = rng() % (rows + 2);
+                auto count = static_cast<uint32_t>(1 + rng() % 200);
+                std::vector<uint64_t> found(count + 1);
+                auto returned = table.GetRows(first, count, found.data());
+                auto expected = first >= rows ? 0 : std::min<uint64_t>(count, rows - first);
+                if (returned != expected)
+                {
+                    printf("GetRows returned %u rows from %llu, not %llu\n", returned,
+                           static_cast<unsigned long long>(first), static_cast<unsigned long long>(expected));
+                    return 1;
+                }
+                for (uint32_t j = 0; returned != 0 && j <= returned; j++)
+                {
+                    uint64_t row;
+                    if (found[j] != starts[first + j] ||
+                        (j < returned && (!table.FindRow(found[j], &row) || row != first + j)))
+                    {
+                        printf("row %llu is misplaced\n", static_cast<unsigned long long>(first + j));
+                        return 1;
+                    }
+                }
+
+                if (returned != 0)
+                {
+                    uint8_t text[256], expectedText[256];
+                    uint32_t fieldEnds[16], expectedEnds[16];
+                    auto fields = table.ReadRow(found[0], found[1], text, 256, fieldEnds, 16);
+                    auto expectedFields = CsvTable::Split(reinterpret_cast<const uint8_t*>(data.data()) + found[0],
+                                                          found[1] - found[0], ',', expectedText, 256, expectedEnds, 16);
+                    if (fields != expectedFields ||
+                        (fields != 0 && memcmp(text, expectedText, fieldEnds[fields - 1]) != 0))
+                    {
+                        printf("ReadRow differs from Split\n");
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        printf("%ld tables indexed and looked up\n", iterations);
+        return 0;
+    }
+
+    void WriteSample(const char* path, uint64_t bytes)
+    {
+        auto file = fopen(path, "wb");
+        std::mt19937 rng(5);
+        std::string buffer;
+        for (uint64_t total = 0; total < bytes; total += buffer.size())
+        {
+            buffer.clear();
+            for (int row = 0; row < 10000; row++)
+            {
+                buffer += std::to_string(rng()) + ",2026-10-19T12:00:00Z,";
+                buffer += rng() % 8 == 0 ? "\"quoted, with \"\"escaped\"\" quote\nand a line\"," : "plain text value,";
+                buffer += std::to_string(rng() % 100000) + "." + std::to_string(rng() % 100) + ",some-category,\"x\"\r\n";
+            }
+            fwrite(buffer.data(), 1, buffer.size(), file);
+        }
+        fclose(file);
+    }
+
+    int Bench(const char* path, uint64_t megabytes)
+    {
+        MappedFile file;
+        if (!file.Open(path))
+        {
+            WriteSample(path, megabytes << 20);
+            if (!file.Open(path))
+                return 1;
+        }
+
+        auto data = file.Data();
+        auto size = static_cast<size_t>(file.Size());
+        for (auto level : levels)
+        {
+            if (!Simd::Supports(level))
+                continue;
+
+            double best = 1e9;
+            uint64_t rows = 0;
+            for (int run = 0; run < 3; run++)
+            {
+                Harness::Stopwatch stopwatch;
+                auto quoted = false;
+                rows = 0;
+                for (size_t at = 0; at < size;)
+                {
+                    uint64_t count = UINT64_MAX >> 1;
+                    at += CsvTable::Skip(data + at, size - at, &quoted, &count, level);
+                    rows += (UINT64_MAX >> 1) - count;
+                }
+                best = std::min(best, stopwatch.Milliseconds() / 1000);
+            }
+            printf("Skip at level %u: %llu rows, %.2f GB/s\n", level, static_cast<unsigned long long>(rows),
+                   size / best / 1e9);
+        }
+
+        CsvTable table;
+        Harness::Stopwatch stopwatch;
+        if (!table.Open(path, 0, 0))
+            return 1;
+        while (table.Build(64u << 20))
+        {
+        }
+        auto seconds = stopwatch.Milliseconds() / 1000;
+        auto info = table.GetInfo();
+        printf("index: %llu rows, delimiter '%c', %.2f s, %.2f GB/s\n", static_cast<unsigned long long>(info.rows),
+               info.delimiter, seconds, info.size / seconds / 1e9);
+
+        std::mt19937_64 rng(1);
+        std::vector<uint64_t> starts(61);
+        uint8_t text[4096];
+        uint32_t fieldEnds[64];
+        const int jumps = 2000;
+        stopwatch.Restart();
+        for (int jump = 0; jump < jumps; jump++)
+        {
+            auto rows = table.GetRows(rng() % info.rows, 60, starts.data());
+            for (uint32_t k = 0; k < rows; k++)
+                table.ReadRow(starts[k], starts[k + 1], text, sizeof text, fieldEnds, 64);
+        }
+        printf("a page of 60 split rows at a random place: %.1f us\n",
+               stopwatch.Milliseconds() * 1000 / jumps);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 2 ? argv[1] : "";
+    if (mode == "kernels" && argc > 3)
+        return Kernels(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]));
+    if (mode == "table" && argc > 4)
+        return Table(argv[2], static_cast<uint32_t>(atol(argv[3])), atol(argv[4]));
+    if (mode == "bench")
+        return Bench(argv[2], argc > 3 ? strtoull(argv[3], nullptr, 10) : 2048);
+
+    fprintf(stderr, "usage: csv_check kernels <seed> <count> | table <scratch file> <seed> <count> | bench <file> [MB]\n");
+    return 2;
+}
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Checks CsvTable: Skip at every SIMD level this CPU runs and Split must agree with plain reference
+# loops, and indexing random files must find every row where a plain scan does. BENCH=1 also times
+# the kernels and a full index of a generated CSV file of BENCH_MB megabytes, 2048 by default.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/csv_check.cpp $native/CsvTable.cpp $native/MappedWindow.cpp $native/MappedFile.cpp $native/Simd.cpp"
+build csv_check $sources
+
+"$out/csv_check" kernels 1 "$(iterations 200000)"
+"$out/csv_check" table "$out/scratch.csv" 1 "${TABLES:-1000}"
+
+if bench; then
+    build_bench csv_bench $sources
+    "$out/csv_bench" bench "$out/large.csv" "${BENCH_MB:-2048}"
+fi
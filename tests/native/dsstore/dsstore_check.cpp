@@ -0,0 +1,193 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks DSStoreReader from the command line:
+//
+//   dsstore_check print <file> <page>         prints every record, reading page records per call
+//   dsstore_check bench <file>                times the first page and the full walk
+//   dsstore_check fuzz <seed> <count> <file>...  walks count mutations of the files
+//
+// The print format matches reference.py, so that the two can be compared with diff.
+
+#include "DSStoreReader.h"
+#include "harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // the names and ustr values are big-endian UTF-16
+    std::string Utf8(const uint8_t* utf16, uint32_t length)
+    {
+        std::string out;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            uint32_t c = utf16[2 * i] << 8 | utf16[2 * i + 1];
+            if (c >= 0xd800 && c < 0xdc00 && i + 1 < length)
+            {
+                uint32_t low = utf16[2 * i + 2] << 8 | utf16[2 * i + 3];
+                c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                i++;
+            }
+
+            if (c < 0x80)
+            {
+                out += char(c);
+            }
+            else if (c < 0x800)
+            {
+                out += char(0xc0 | c >> 6);
+                out += char(0x80 | (c & 63));
+            }
+            else if (c < 0x10000)
+            {
+                out += char(0xe0 | c >> 12);
+                out += char(0x80 | (c >> 6 & 63));
+                out += char(0x80 | (c & 63));
+            }
+            else
+            {
+                out += char(0xf0 | c >> 18);
+                out += char(0x80 | (c >> 12 & 63));
+                out += char(0x80 | (c >> 6 & 63));
+                out += char(0x80 | (c & 63));
+            }
+        }
+        return out;
+    }
+
+    std::string FourCc(uint32_t value)
+    {
+        std::string out;
+        for (int i = 3; i >= 0; i--)
+            out += char(value >> (i * 8));
+        return out;
+    }
+
+    size_t Walk(const DSStoreReader& reader, DSStoreReader::Cursor* cursor, uint32_t page, bool print)
+    {
+        std::vector<DSStoreReader::Record> records(page);
+        size_t total = 0;
+        volatile uint8_t sink = 0;
+        for (uint32_t n; (n = reader.ReadRecords(cursor, records.data(), page)) != 0; total += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& record = records[i];
+                // touch the last byte of every span, so that ASan sees a span that runs past the buffer
+                if (record.nameLength != 0)
+                    sink += record.name[record.nameLength * 2 - 1];
+                if (record.data != nullptr && record.dataLength != 0)
+                    sink += record.data[record.dataLength - 1];
+                if (!print)
+                    continue;
+
+                auto type = FourCc(record.type);
+                std::string value;
+                if (type == "blob")
+                {
+                    char hex[3];
+                    for (uint32_t k = 0; k < record.dataLength; k++)
+                    {
+                        snprintf(hex, sizeof hex, "%02x", record.data[k]);
+                        value += hex;
+                    }
+                }
+                else if (type == "ustr")
+                {
+                    value = Utf8(record.data, record.dataLength);
+                }
+                else
+                {
+                    value = std::to_string(record.value);
+                }
+
+                printf("%s|%s|%s|%s\n", Utf8(record.name, record.nameLength).c_str(), FourCc(record.code).c_str(),
+                       type.c_str(), value.c_str());
+            }
+        }
+        return total;
+    }
+
+    int Print(const char* path, uint32_t page)
+    {
+        DSStoreReader reader;
+        if (!reader.Open(path))
+            return 1;
+
+        DSStoreReader::Cursor cursor = {};
+        Walk(reader, &cursor, std::max(page, 1u), true);
+        return 0;
+    }
+
+    int Bench(const char* path)
+    {
+        for (int run = 0; run < 3; run++)
+        {
+            Harness::Stopwatch stopwatch;
+            DSStoreReader reader;
+            if (!reader.Open(path))
+                return 1;
+
+            DSStoreReader::Cursor cursor = {};
+            DSStoreReader::Record records[256];
+            auto first = reader.ReadRecords(&cursor, records, 256);
+            auto firstPage = stopwatch.Milliseconds();
+            auto total = first + Walk(reader, &cursor, 256, false);
+
+            printf("first %u records in %.0f us, all %zu records in %.1f ms\n", first, firstPage * 1000, total,
+                   stopwatch.Milliseconds() - firstPage);
+        }
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        // the header, the block addresses and the DSDB entry are big-endian and in the first bytes
+        Harness::Mutator mutate;
+        mutate.hotBytes = 64;
+        mutate.bigEndian = true;
+        return Harness::Fuzz(Harness::ReadFiles(paths, count, 8), iterations, seed, mutate,
+                             [](const std::vector<uint8_t>& data) {
+                                 DSStoreReader reader;
+                                 if (!reader.Parse(data.data(), data.size()))
+                                     return false;
+
+                                 // an odd page size, so that the cursor is carried across calls
+                                 DSStoreReader::Cursor cursor = {};
+                                 Walk(reader, &cursor, 1 + data.size() % 40, false);
+                                 return true;
+                             });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 2 ? argv[1] : "";
+    if (mode == "print")
+        return Print(argv[2], argc > 3 ? atoi(argv[3]) : 256);
+    if (mode == "bench")
+        return Bench(argv[2]);
+    if (mode == "fuzz" && argc > 4)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+
+    fprintf(stderr, "usage: dsstore_check print <file> [page] | bench <file> | fuzz <seed> <count> <file>...\n");
+    return 2;
+}
@@ -0,0 +1,149 @@
+# Writes a synthetic .DS_Store with a B-tree of random records:
+#
+#   make_dsstore.py <out.DS_Store> <files> [seed] [--cycle]
+#
+# Each file gets one to three records. Nodes are 4 KiB pages; internal nodes split their records
+# evenly between up to 64 children. --cycle points every child of the root node back at the root.
+import random
+import struct
+import sys
+
+PAGE = 4096
+CODES = [('Iloc', 'blob'), ('dilc', 'blob'), ('lg1S', 'comp'), ('moDD', 'dutc'), ('ptbN', 'ustr'),
+         ('vSrn', 'long'), ('BKGD', 'blob'), ('ICVO', 'bool'), ('fwi0', 'blob'), ('icvp', 'blob'),
+         ('lsvp', 'blob'), ('pict', 'blob'), ('ph1S', 'comp')]
+
+
+def record(name, code, kind, value):
+    out = struct.pack('>I', len(name)) + name.encode('utf-16-be') + code.encode() + kind.encode()
+    if kind == 'bool':
+        out += struct.pack('>B', value)
+    elif kind in ('long', 'shor', 'type'):
+        out += struct.pack('>I', value)
+    elif kind in ('comp', 'dutc'):
+        out += struct.pack('>Q', value)
+    elif kind == 'blob':
+        out += struct.pack('>I', len(value)) + value
+    elif kind == 'ustr':
+        out += struct.pack('>I', len(value)) + value.encode('utf-16-be')
+    return out
+
+
+def make_records(files, seed):
+    rnd = random.Random(seed)
+    out = []
+    for i in range(files):
+        name = 'file %06d %s' % (i, ''.join(rnd.choice('abcdéfgh日本') for _ in range(rnd.randint(0, 20))))
+        for code, kind in rnd.sample(CODES, rnd.randint(1, 3)):
+            if kind == 'blob':
+                value = bytes(rnd.randrange(256) for _ in range(rnd.choice([16, 8, 0, 100])))
+            elif kind == 'ustr':
+                value = 'x' * rnd.randint(0, 30)
+            elif kind == 'bool':
+                value = rnd.randint(0, 1)
+            elif kind in ('comp', 'dutc'):
+                value = rnd.getrandbits(64)
+            else:
+                value = rnd.getrandbits(32)
+            out.append(record(name, code, kind, value))
+    return out
+
+
+def build(records, nodes):
+    """Appends the subtree for records to nodes and returns the block id of its root."""
+    leaf = struct.pack('>II', 0, len(records)) + b''.join(records)
+    if len(leaf) <= PAGE:
+        nodes.append(leaf)
+        return len(nodes) - 1 + 2
+
+    # the widest fan-out whose separators still fit into one page
+    fanout = 2
+    while True:
+        wider = fanout * 2
+        separators = sum(len(records[(k + 1) * len(records) // wider - 1]) + 4 for k in range(wider - 1))
+        if wider > len(records) or wider > 64 or separators + 8 > PAGE:
+            break
+        fanout = wider
+
+    bounds = [k * len(records) // fanout for k in range(fanout + 1)]
+    children, separators = [], []
+    for k in range(fanout):
+        part = records[bounds[k]:bounds[k + 1]]
+        if k < fanout - 1:
+            separators.append(part[-1])
+            part = part[:-1]
+        children.append(part)
+
+    nodes.append(None)
+    index = len(nodes) - 1
+    ids = [build(child, nodes) for child in children]
+    body = b''.join(struct.pack('>I', child) + separator for child, separator in zip(ids[:-1], separators))
+    nodes[index] = struct.pack('>II', ids[-1], len(separators)) + body
+    assert len(nodes[index]) <= PAGE
+    return index + 2
+
+
+def make_cyclic(nodes, root):
+    node = bytearray(nodes[root - 2])
+    rightmost, count = struct.unpack('>II', node[:8])
+    if rightmost == 0:
+        raise SystemExit('--cycle needs more files than fit into one leaf')
+    node[0:4] = struct.pack('>I', root)
+    offset = 8
+    for _ in range(count):
+        node[offset:offset + 4] = struct.pack('>I', root)
+        offset += 4
+        length, = struct.unpack('>I', node[offset:offset + 4])
+        offset += 4 + 2 * length + 8
+        kind = node[offset - 4:offset].decode()
+        if kind == 'bool':
+            offset += 1
+        elif kind in ('long', 'shor', 'type'):
+            offset += 4
+        elif kind in ('comp', 'dutc'):
+            offset += 8
+        elif kind == 'blob':
+            offset += 4 + struct.unpack('>I', node[offset:offset + 4])[0]
+        elif kind == 'ustr':
+            offset += 4 + 2 * struct.unpack('>I', node[offset:offset + 4])[0]
+    nodes[root - 2] = bytes(node)
+
+
+def write(path, files, seed, cycle):
+    records = make_records(files, seed)
+    nodes = []
+    root = build(records, nodes)
+    if cycle:
+        make_cyclic(nodes, root)
+
+    # block 0 is the allocator's root block, 1 the DSDB header and 2.. the nodes, one per page
+    blocks = 2 + len(nodes)
+    addresses = [0] * blocks
+    addresses[1] = 32 | 5
+    for k in range(len(nodes)):
+        addresses[2 + k] = (PAGE * (k + 1)) | 12
+    root_offset = PAGE * (len(nodes) + 1)
+
+    table = (blocks + 255) // 256 * 256
+    tail = b'\0' * 4 * (table - blocks)
+    tail += struct.pack('>I', 1) + bytes([4]) + b'DSDB' + struct.pack('>I', 1)
+    tail += struct.pack('>I', 0) * 32
+    root_size = 1
+    while (1 << root_size) < 8 + 4 * blocks + len(tail):
+        root_size += 1
+    addresses[0] = root_offset | root_size
+    root_block = struct.pack('>II', blocks, 0) + b''.join(struct.pack('>I', a) for a in addresses) + tail
+
+    buffer = bytearray(root_offset + (1 << root_size))
+    buffer[0:32] = b'Bud1' + struct.pack('>III', root_offset, len(root_block), root_offset) + b'\0' * 16
+    buffer[32:52] = struct.pack('>IIIII', root, 0, len(records), len(nodes), PAGE)
+    for k, node in enumerate(nodes):
+        buffer[PAGE * (k + 1):PAGE * (k + 1) + len(node)] = node
+    buffer[root_offset:root_offset + len(root_block)] = root_block
+    with open(path, 'wb') as out:
+        out.write(struct.pack('>I', 1) + bytes(buffer))
+
+
+if __name__ == '__main__':
+    arguments = [a for a in sys.argv[1:] if a != '--cycle']
+    write(arguments[0], int(arguments[1]), int(arguments[2]) if len(arguments) > 2 else 1, '--cycle' in sys.argv)
@@ -0,0 +1,80 @@
+# Reference .DS_Store reader: a plain recursive walk of the B-tree, after the layout the ds_store
+# Python library reads. Prints one line per record in the format of dsstore_check print.
+import struct
+import sys
+
+
+def read(path):
+    data = open(path, 'rb').read()[4:]
+    assert data[:4] == b'Bud1'
+    root_offset, root_size, _ = struct.unpack('>III', data[4:16])
+    root = data[root_offset:root_offset + root_size]
+    count, _ = struct.unpack('>II', root[:8])
+    table = (count + 255) & ~255
+    addresses = list(struct.unpack('>%dI' % table, root[8:8 + 4 * table]))[:count]
+    offset = 8 + 4 * table
+    entries, = struct.unpack('>I', root[offset:offset + 4])
+    offset += 4
+    directory = {}
+    for _ in range(entries):
+        length = root[offset]
+        name = root[offset + 1:offset + 1 + length]
+        directory[name], = struct.unpack('>I', root[offset + 1 + length:offset + 5 + length])
+        offset += 5 + length
+
+    def block(id):
+        address = addresses[id]
+        return data[address & ~0x1f:(address & ~0x1f) + (1 << (address & 0x1f))]
+
+    tree_root = struct.unpack('>IIIII', block(directory[b'DSDB'])[:20])[0]
+    out = []
+
+    def record(node, offset):
+        length, = struct.unpack('>I', node[offset:offset + 4])
+        offset += 4
+        name = node[offset:offset + 2 * length].decode('utf-16-be')
+        offset += 2 * length
+        code = node[offset:offset + 4].decode('latin1')
+        kind = node[offset + 4:offset + 8].decode('latin1')
+        offset += 8
+        if kind == 'bool':
+            value = node[offset]
+            offset += 1
+        elif kind in ('long', 'shor', 'type'):
+            value, = struct.unpack('>I', node[offset:offset + 4])
+            offset += 4
+        elif kind in ('comp', 'dutc'):
+            value, = struct.unpack('>Q', node[offset:offset + 8])
+            offset += 8
+        elif kind == 'blob':
+            length, = struct.unpack('>I', node[offset:offset + 4])
+            value = node[offset + 4:offset + 4 + length].hex()
+            offset += 4 + length
+        elif kind == 'ustr':
+            length, = struct.unpack('>I', node[offset:offset + 4])
+            value = node[offset + 4:offset + 4 + 2 * length].decode('utf-16-be')
+            offset += 4 + 2 * length
+        out.append('%s|%s|%s|%s' % (name, code, kind, value))
+        return offset
+
+    def walk(id):
+        node = block(id)
+        rightmost, count = struct.unpack('>II', node[:8])
+        offset = 8
+        for _ in range(count):
+            if rightmost:
+                child, = struct.unpack('>I', node[offset:offset + 4])
+                offset += 4
+                walk(child)
+            offset = record(node, offset)
+        if rightmost:
+            walk(rightmost)
+
+    walk(tree_root)
+    return out
+
+
+if __name__ == '__main__':
+    sys.stdout.reconfigure(encoding='utf-8')
+    for line in read(sys.argv[1]):
+        print(line)
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Checks DSStoreReader on generated stores: the records must match reference.py whatever the page
+# size, a cyclic tree must end, and mutations must not trip the sanitizers. BENCH=1 also times a
+# 400k-record store. Needs python3.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/dsstore_check.cpp $native/DSStoreReader.cpp $native/MappedFile.cpp"
+build dsstore_check $sources
+
+python3 "$here/make_dsstore.py" "$out/small.DS_Store" 50
+python3 "$here/make_dsstore.py" "$out/medium.DS_Store" 3000 2
+for store in small medium; do
+    python3 "$here/reference.py" "$out/$store.DS_Store" > "$out/$store.ref"
+    for page in 1 7 256; do
+        "$out/dsstore_check" print "$out/$store.DS_Store" $page > "$out/$store.out"
+        same "$out/$store.ref" "$out/$store.out"
+    done
+    echo "$store: $(wc -l < "$out/$store.ref") records match"
+done
+
+python3 "$here/make_dsstore.py" "$out/cyclic.DS_Store" 3000 2 --cycle
+timeout 60 "$out/dsstore_check" print "$out/cyclic.DS_Store" 256 > /dev/null
+echo "cyclic: the walk ends"
+
+"$out/dsstore_check" fuzz 7 "$(iterations 20000)" "$out/small.DS_Store" "$out/medium.DS_Store"
+
+if bench; then
+    build_bench dsstore_bench $sources
+    python3 "$here/make_dsstore.py" "$out/large.DS_Store" 200000 3
+    "$out/dsstore_bench" bench "$out/large.DS_Store"
+fi
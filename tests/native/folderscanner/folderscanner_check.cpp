@@ -0,0 +1,265 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks FolderScanner from the command line:
+//
+//   folderscanner_check compare <root>   counts at several thread counts against a serial walk
+//   folderscanner_check cache <dir>      builds a tree in dir and changes it between cached rescans
+//   folderscanner_check cancel <root>    cancels from the progress callback
+//   folderscanner_check missing <path>   scans a root that does not exist
+//   folderscanner_check bench <root>     times the serial walk, scans and cached rescans
+
+#include "FolderScanner.h"
+#include "harness.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // the same counting rules as the scanner, one directory at a time and with a stat per entry
+    void Walk(const std::string& path, FolderScanner::Result& result)
+    {
+        auto dir = opendir(path.c_str());
+        if (dir == nullptr)
+            return;
+
+        while (auto entry = readdir(dir))
+        {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+
+            struct stat st;
+            if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+
+            if (S_ISDIR(st.st_mode))
+            {
+                result.directories++;
+                Walk(path + "/" + entry->d_name, result);
+            }
+            else
+            {
+                result.files++;
+                result.bytes += static_cast<uint64_t>(st.st_size);
+            }
+        }
+        closedir(dir);
+    }
+
+    FolderScanner::Result Reference(const std::string& root)
+    {
+        FolderScanner::Result result = {};
+        Walk(root, result);
+        return result;
+    }
+
+    bool Same(const FolderScanner::Result& expected, const FolderScanner::Result& actual, const char* what)
+    {
+        if (expected.directories == actual.directories && expected.files == actual.files &&
+            expected.bytes == actual.bytes)
+            return true;
+
+        fprintf(stderr, "%s: %" PRIu64 " dirs %" PRIu64 " files %" PRIu64 " bytes, expected %" PRIu64 " %" PRIu64
+                        " %" PRIu64 "\n",
+                what, actual.directories, actual.files, actual.bytes, expected.directories, expected.files,
+                expected.bytes);
+        return false;
+    }
+
+    int Compare(const char* root)
+    {
+        auto expected = Reference(root);
+        for (unsigned threads : {1u, 2u, 3u, 8u, 0u})
+        {
+            FolderScanner::SetThreadCount(threads);
+            FolderScanner::Result result;
+            if (!FolderScanner::Scan(root, 0, nullptr, nullptr, 0, &result) ||
+                !Same(expected, result, ("threads " + std::to_string(threads)).c_str()))
+                return 1;
+        }
+
+        // the first cached scan fills the cache, the second reads from it
+        FolderScanner::ClearCache();
+        for (int pass = 0; pass < 2; pass++)
+        {
+            FolderScanner::Result result;
+            if (!FolderScanner::Scan(root, FolderScanner::USE_CACHE, nullptr, nullptr, 0, &result) ||
+                !Same(expected, result, pass == 0 ? "filling the cache" : "from the cache"))
+                return 1;
+        }
+
+        // a trailing separator names the same tree
+        FolderScanner::Result result;
+        if (!FolderScanner::Scan((std::string(root) + "//").c_str(), FolderScanner::USE_CACHE, nullptr, nullptr, 0,
+                                 &result) ||
+            !Same(expected, result, "trailing separator"))
+            return 1;
+
+        printf("%s: %" PRIu64 " dirs %" PRIu64 " files %" PRIu64 " bytes match\n", root, expected.directories,
+               expected.files, expected.bytes);
+        FolderScanner::SetThreadCount(0);
+        return 0;
+    }
+
+    void WriteFile(const std::string& path, const char* text)
+    {
+        auto file = fopen(path.c_str(), "wb");
+        fputs(text, file);
+        fclose(file);
+    }
+
+    int Cache(const char* dir)
+    {
+        std::string root = dir;
+        system(("rm -rf '" + root + "'").c_str());
+        mkdir(root.c_str(), 0755);
+        mkdir((root + "/a").c_str(), 0755);
+        mkdir((root + "/a/b").c_str(), 0755);
+        WriteFile(root + "/a/b/one", "hi\n");
+
+        struct Step
+        {
+            const char* what;
+            std::string command;
+        };
+        // each change touches a directory two levels down, which the scan has to reach through
+        // unchanged parents; the pause keeps the change out of the parent's timestamp granularity
+        Step steps[] = {
+            {"added file", "echo more > '" + root + "/a/b/two'"},
+            {"removed file", "rm '" + root + "/a/b/one'"},
+            {"renamed file", "mv '" + root + "/a/b/two' '" + root + "/a/b/three'"},
+            {"added directory", "mkdir -p '" + root + "/a/b/c/d' && echo deep > '" + root + "/a/b/c/d/four'"},
+            {"removed directory", "rm -r '" + root + "/a/b/c'"},
+        };
+
+        FolderScanner::ClearCache();
+        FolderScanner::Result result;
+        if (!FolderScanner::Scan(dir, FolderScanner::USE_CACHE, nullptr, nullptr, 0, &result) ||
+            !Same(Reference(root), result, "first scan"))
+            return 1;
+
+        for (auto& step : steps)
+        {
+            usleep(20000);
+            if (system(step.command.c_str()) != 0)
+                return 1;
+            if (!FolderScanner::Scan(dir, FolderScanner::USE_CACHE, nullptr, nullptr, 0, &result) ||
+                !Same(Reference(root), result, step.what))
+                return 1;
+        }
+
+        printf("cache: %zu changes seen\n", sizeof steps / sizeof steps[0]);
+        return 0;
+    }
+
+    int CancelOnFirstCall(const FolderScanner::Result*, void* context)
+    {
+        ++*static_cast<int*>(context);
+        return 0;
+    }
+
+    int Cancel(const char* root)
+    {
+        // a one-millisecond interval and a single thread make sure the callback runs before the end
+        FolderScanner::SetThreadCount(1);
+        int calls = 0;
+        FolderScanner::Result result;
+        auto finished = FolderScanner::Scan(root, 0, CancelOnFirstCall, &calls, 1, &result);
+        FolderScanner::SetThreadCount(0);
+        if (calls > 1 || finished == (calls != 0))
+        {
+            fprintf(stderr, "cancel: %d calls, scan returned %d\n", calls, finished);
+            return 1;
+        }
+
+        printf("cancel: %s\n", finished ? "the scan ended before the first callback" : "the scan stopped");
+        return 0;
+    }
+
+    int Missing(const char* path)
+    {
+        FolderScanner::Result result;
+        if (FolderScanner::Scan(path, 0, nullptr, nullptr, 0, &result) || result.files != 0)
+        {
+            fprintf(stderr, "missing: the scan of %s succeeded\n", path);
+            return 1;
+        }
+
+        printf("missing: the scan fails\n");
+        return 0;
+    }
+
+    int Bench(const char* root)
+    {
+        Harness::Stopwatch stopwatch;
+        auto expected = Reference(root);
+        printf("serial walk: %" PRIu64 " dirs %" PRIu64 " files in %.1f ms\n", expected.directories, expected.files,
+               stopwatch.Milliseconds());
+
+        for (unsigned threads : {1u, 2u, 4u, 8u})
+        {
+            FolderScanner::SetThreadCount(threads);
+            FolderScanner::Result result;
+            stopwatch.Restart();
+            FolderScanner::Scan(root, 0, nullptr, nullptr, 0, &result);
+            printf("%u threads: %.1f ms\n", threads, stopwatch.Milliseconds());
+            if (!Same(expected, result, "bench"))
+                return 1;
+        }
+
+        FolderScanner::SetThreadCount(0);
+        FolderScanner::ClearCache();
+        for (int pass = 0; pass < 3; pass++)
+        {
+            FolderScanner::Result result;
+            stopwatch.Restart();
+            FolderScanner::Scan(root, FolderScanner::USE_CACHE, nullptr, nullptr, 0, &result);
+            printf("%s: %.1f ms\n", pass == 0 ? "filling the cache" : "cached rescan", stopwatch.Milliseconds());
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: folderscanner_check compare|cache|cancel|missing|bench <path>\n");
+        return 2;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "compare")
+        return Compare(argv[2]);
+    if (mode == "cache")
+        return Cache(argv[2]);
+    if (mode == "cancel")
+        return Cancel(argv[2]);
+    if (mode == "missing")
+        return Missing(argv[2]);
+    if (mode == "bench")
+        return Bench(argv[2]);
+    return 2;
+}
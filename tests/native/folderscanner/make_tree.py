@@ -0,0 +1,41 @@
+# Writes a random directory tree for the folder scanner:
+#
+#   make_tree.py <root> <files> [seed]
+#
+# Directories nest up to twelve levels and some stay empty. Files get random sizes, made sparse
+# so that large trees stay cheap, and some names have spaces or non-ASCII characters. A few
+# symlinks point at directories, which the scanner must count as entries but not follow, and
+# one of them points back at the root.
+import os
+import random
+import shutil
+import sys
+
+root = sys.argv[1]
+count = int(sys.argv[2])
+rnd = random.Random(int(sys.argv[3]) if len(sys.argv) > 3 else 1)
+
+shutil.rmtree(root, ignore_errors=True)
+os.makedirs(root)
+directories = [root]
+names = ['a', 'lib', 'src', 'résumé', 'with space', '日本語', '.hidden', 'x' * 200]
+
+for i in range(count):
+    parent = rnd.choice(directories[-50:] if rnd.random() < 0.7 else directories)
+    if rnd.random() < 0.15 and parent.count(os.sep) - root.count(os.sep) < 12:
+        path = os.path.join(parent, '%s%d' % (rnd.choice(names), i))
+        os.mkdir(path)
+        directories.append(path)
+        continue
+
+    path = os.path.join(parent, '%s%d.bin' % (rnd.choice(names), i))
+    if rnd.random() < 0.01:
+        os.symlink(rnd.choice(directories), path)
+        continue
+
+    with open(path, 'wb') as f:
+        size = rnd.choice([0, rnd.randrange(1, 4096), rnd.randrange(1 << 20, 1 << 34)])
+        if size:
+            f.truncate(size)
+
+os.symlink(root, os.path.join(root, 'loop'))
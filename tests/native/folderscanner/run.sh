@@ -0,0 +1,22 @@
+#!/bin/sh
+# Checks FolderScanner on generated trees: the counts must match a serial readdir walk at every
+# thread count, cached rescans must notice entries added, removed or renamed below the root, and a
+# cancelled scan must say so. BENCH=1 also times a 200k-file tree. Needs python3.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/folderscanner_check.cpp $native/FolderScanner.cpp"
+build folderscanner_check $sources
+
+python3 "$here/make_tree.py" "$out/small" 300
+python3 "$here/make_tree.py" "$out/medium" 20000 2
+"$out/folderscanner_check" compare "$out/small"
+"$out/folderscanner_check" compare "$out/medium"
+"$out/folderscanner_check" cache "$out/cache"
+"$out/folderscanner_check" cancel "$out/medium"
+"$out/folderscanner_check" missing "$out/none"
+
+if bench; then
+    build_bench folderscanner_bench $sources
+    python3 "$here/make_tree.py" "$out/large" 200000 3
+    "$out/folderscanner_bench" bench "$out/large"
+fi
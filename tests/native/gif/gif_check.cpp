@@ -0,0 +1,174 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks GifImage from the command line:
+//
+//   gif_check dump <file.gif> <out>            writes Info, then each Frame and its pixels, for reference.py
+//   gif_check seek <file.gif> <seed>           renders frames in random order and compares them with a
+//                                              forward pass, to check going back and the buffer ring
+//   gif_check fuzz <seed> <count> <file.gif>...  renders every frame of count mutations of the files
+//   gif_check bench <file.gif>                 times indexing, the first frame and playback
+
+#include "GifImage.h"
+#include "harness.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace
+{
+    int Dump(const char* path, const char* outPath)
+    {
+        GifImage gif;
+        if (!gif.Open(path))
+            return 1;
+
+        auto out = fopen(outPath, "wb");
+        if (out == nullptr)
+            return 1;
+
+        auto& info = gif.GetInfo();
+        fwrite(&info, sizeof info, 1, out);
+        for (uint32_t k = 0; k < info.frameCount; k++)
+        {
+            GifImage::Frame frame;
+            gif.GetFrame(k, &frame);
+            fwrite(&frame, sizeof frame, 1, out);
+            fwrite(gif.Render(k), 4, static_cast<size_t>(info.width) * info.height, out);
+        }
+        fclose(out);
+        return 0;
+    }
+
+    int Seek(const char* path, uint32_t seed)
+    {
+        GifImage forward, seeking;
+        if (!forward.Open(path) || !seeking.Open(path))
+            return 1;
+
+        auto& info = forward.GetInfo();
+        auto bytes = static_cast<size_t>(info.width) * info.height * 4;
+        std::vector<std::vector<uint8_t>> frames;
+        for (uint32_t k = 0; k < info.frameCount; k++)
+        {
+            auto pixels = forward.Render(k);
+            frames.emplace_back(pixels, pixels + bytes);
+        }
+
+        // keep up to RING_SIZE earlier results, which must still hold their frames
+        std::mt19937 rng(seed);
+        std::vector<std::pair<uint32_t, const uint8_t*>> recent;
+        for (uint32_t step = 0; step < info.frameCount * 4; step++)
+        {
+            auto index = rng() % 3 == 0 ? static_cast<uint32_t>(rng() % info.frameCount) : step % info.frameCount;
+            recent.emplace_back(index, seeking.Render(index));
+            if (recent.size() > GifImage::RING_SIZE)
+                recent.erase(recent.begin());
+
+            for (auto& [frame, pixels] : recent)
+            {
+                if (memcmp(pixels, frames[frame].data(), bytes) != 0)
+                {
+                    printf("%s: frame %u differs after rendering frame %u\n", path, frame, index);
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        Harness::Mutator mutate;
+        mutate.maximumChanges = 20;
+        return Harness::Fuzz(Harness::ReadFiles(paths, count, 100), iterations, seed, mutate,
+                             [](const std::vector<uint8_t>& data) {
+                                 GifImage gif;
+                                 if (!gif.Parse(data.data(), data.size()))
+                                     return false;
+
+                                 // touch the last pixel of every frame, up to the first 64
+                                 auto& info = gif.GetInfo();
+                                 volatile uint8_t sink = 0;
+                                 for (uint32_t k = 0; k < info.frameCount && k < 64; k++)
+                                 {
+                                     auto pixels = gif.Render(k);
+                                     if (pixels != nullptr && info.width != 0 && info.height != 0)
+                                         sink += pixels[static_cast<size_t>(info.width) * info.height * 4 - 1];
+                                 }
+                                 return true;
+                             });
+    }
+
+    int Bench(const char* path)
+    {
+        Harness::Stopwatch stopwatch;
+        GifImage gif;
+        if (!gif.Open(path))
+            return 1;
+        auto index = stopwatch.Milliseconds();
+
+        auto& info = gif.GetInfo();
+        stopwatch.Restart();
+        gif.Render(0);
+        auto first = stopwatch.Milliseconds();
+
+        volatile uint8_t sink = 0;
+        stopwatch.Restart();
+        for (uint32_t k = 0; k < info.frameCount; k++)
+            sink ^= gif.Render(k)[0];
+        auto pass = stopwatch.Milliseconds();
+
+        stopwatch.Restart();
+        for (int loop = 0; loop < 2; loop++)
+        {
+            for (uint32_t k = 0; k < info.frameCount; k++)
+                sink ^= gif.Render(k)[0];
+        }
+        auto looping = stopwatch.Milliseconds();
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("%ux%u, %u frames: index %.2f ms, first frame %.2f ms, %.3f ms a frame on the first pass and %.3f "
+               "looping, peak RSS %ld MB\n",
+               info.width, info.height, info.frameCount, index, first, pass / info.frameCount,
+               looping / (2.0 * info.frameCount), usage.ru_maxrss / 1024);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 2 ? argv[1] : "";
+    if (mode == "dump" && argc > 3)
+        return Dump(argv[2], argv[3]);
+    if (mode == "seek")
+        return Seek(argv[2], argc > 3 ? static_cast<uint32_t>(atol(argv[3])) : 1);
+    if (mode == "fuzz" && argc > 4)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+    if (mode == "bench")
+        return Bench(argv[2]);
+
+    fprintf(stderr, "usage: gif_check dump <file.gif> <out> | seek <file.gif> [seed] | "
+                    "fuzz <seed> <count> <file.gif>... | bench <file.gif>\n");
+    return 2;
+}
@@ -0,0 +1,62 @@
+# Writes random animated GIFs with Pillow:
+#
+#   make_gifs.py <directory> <count> [seed]        small GIFs with every disposal, palette and interlacing mix
+#   make_gifs.py --large <out.gif> <w> <h> <frames> one large, full-frame animation for timing
+import os
+import random
+import sys
+
+from PIL import Image
+
+
+def random_gif(path, rnd):
+    width, height = rnd.randint(1, 120), rnd.randint(1, 90)
+    frames = []
+    for _ in range(rnd.randint(1, 8)):
+        if rnd.random() < 0.5:
+            image = Image.new('P', (width, height))
+            image.putpalette([rnd.randint(0, 255) for _ in range(768)])
+            pixels = image.load()
+            colors = rnd.choice([2, 4, 16, 256])
+            for y in range(height):
+                for x in range(width):
+                    pixels[x, y] = rnd.randrange(colors) if rnd.random() < 0.3 else (x // 5 + y // 7) % colors
+        else:
+            image = Image.new('RGB', (width, height), (rnd.randint(0, 255),) * 3)
+            pixels = image.load()
+            for y in range(0, height, 3):
+                for x in range(0, width, 2):
+                    pixels[x, y] = (x * 3 % 256, y * 5 % 256, x * y % 256)
+        frames.append(image)
+
+    options = dict(save_all=True, append_images=frames[1:], duration=[rnd.randint(0, 200) for _ in frames],
+                   loop=rnd.choice([0, 3]), disposal=[rnd.choice([0, 1, 2, 3]) for _ in frames],
+                   optimize=rnd.random() < 0.5, interlace=rnd.random() < 0.5)
+    if len(frames) == 1:
+        # Pillow takes per-frame lists only for animations
+        options['duration'], options['disposal'] = options['duration'][0], options['disposal'][0]
+    if rnd.random() < 0.5:
+        options['transparency'] = rnd.randrange(16)
+    frames[0].save(path, **options)
+
+
+def large_gif(path, width, height, count):
+    base = Image.radial_gradient('L').resize((width, height))
+    ramp = Image.linear_gradient('L').resize((width, height))
+    frames = []
+    for k in range(count):
+        red = base.point(lambda v: (v + k * 3) % 256)
+        green = base.rotate(k % 360).point(lambda v: (v * 2 + k) % 256)
+        blue = ramp.point(lambda v: (v + k * 5) % 256)
+        frames.append(Image.merge('RGB', (red, green, blue)).quantize(256))
+    frames[0].save(path, save_all=True, append_images=frames[1:], duration=40, loop=0, optimize=False)
+
+
+if __name__ == '__main__':
+    if sys.argv[1] == '--large':
+        large_gif(sys.argv[2], int(sys.argv[3]), int(sys.argv[4]), int(sys.argv[5]))
+    else:
+        os.makedirs(sys.argv[1], exist_ok=True)
+        rnd = random.Random(int(sys.argv[3]) if len(sys.argv) > 3 else 1)
+        for i in range(int(sys.argv[2])):
+            random_gif(os.path.join(sys.argv[1], 'random%03d.gif' % i), rnd)
@@ -0,0 +1,151 @@
+# Reference GIF player: a plain LZW decoder and compositor written from the GIF89a specification,
+# with the background disposal clearing to transparent as browsers do. Compares what gif_check dump
+# writes for each file with its own frames:
+#
+#   reference.py <gif_check> <scratch file> <file.gif>...
+import struct
+import subprocess
+import sys
+
+
+def lzw(data, minimum_code_size, pixels):
+    clear = 1 << minimum_code_size
+    end = clear + 1
+    out, bits, available, position = [], 0, 0, 0
+    code_size = minimum_code_size + 1
+    table = [[i] for i in range(clear)] + [None, None]
+    previous = None
+    while len(out) < pixels:
+        while available < code_size:
+            if position >= len(data):
+                return out
+            bits |= data[position] << available
+            position += 1
+            available += 8
+        code = bits & ((1 << code_size) - 1)
+        bits >>= code_size
+        available -= code_size
+
+        if code == clear:
+            table = [[i] for i in range(clear)] + [None, None]
+            code_size = minimum_code_size + 1
+            previous = None
+            continue
+        if code == end:
+            break
+        if previous is None:
+            if code >= len(table) or table[code] is None:
+                break
+            out += table[code]
+            previous = code
+            continue
+
+        if code < len(table):
+            entry = table[code]
+        elif code == len(table):
+            entry = table[previous] + [table[previous][0]]
+        else:
+            break
+        if len(table) < 4096:
+            table.append(table[previous] + [entry[0]])
+            if len(table) == 1 << code_size and code_size < 12:
+                code_size += 1
+        out += entry
+        previous = code
+    return out[:pixels]
+
+
+def render(path):
+    """Returns the canvas size and every composed frame as little-endian BGRA words."""
+    data = open(path, 'rb').read()
+    width, height, flags = struct.unpack_from('<HHB', data, 6)
+    offset, global_palette = 13, None
+    if flags & 0x80:
+        entries = 2 << (flags & 7)
+        global_palette = data[offset:offset + 3 * entries]
+        offset += 3 * entries
+
+    frames, control = [], (0, -1)
+    while offset < len(data) and data[offset] != 0x3b:
+        if data[offset] == 0x21:
+            label, block = data[offset + 1], offset + 2
+            if label == 0xf9:
+                packed = data[block + 1]
+                disposal = (packed >> 2) & 7
+                control = (disposal if disposal <= 3 else 0, data[block + 4] if packed & 1 else -1)
+            while data[block]:
+                block += 1 + data[block]
+            offset = block + 1
+        elif data[offset] == 0x2c:
+            left, top, w, h, packed = struct.unpack_from('<HHHHB', data, offset + 1)
+            offset += 10
+            palette = global_palette
+            if packed & 0x80:
+                entries = 2 << (packed & 7)
+                palette = data[offset:offset + 3 * entries]
+                offset += 3 * entries
+            minimum_code_size = data[offset]
+            offset += 1
+            code = b''
+            while data[offset]:
+                code += data[offset + 1:offset + 1 + data[offset]]
+                offset += 1 + data[offset]
+            offset += 1
+            frames.append((left, top, w, h, bool(packed & 0x40), palette, minimum_code_size, code) + control)
+            control = (0, -1)
+        else:
+            break
+
+    canvas, out = [0] * (width * height), []
+    for left, top, w, h, interlaced, palette, minimum_code_size, code, disposal, transparent in frames:
+        saved = list(canvas) if disposal == 3 else None
+        rows = list(range(h))
+        if interlaced:
+            rows = list(range(0, h, 8)) + list(range(4, h, 8)) + list(range(2, h, 4)) + list(range(1, h, 2))
+        for i, index in enumerate(lzw(code, minimum_code_size, w * h)):
+            x, y = i % w, rows[i // w]
+            if left + x >= width or top + y >= height or index == transparent:
+                continue
+            color = 0xff000000
+            if palette and 3 * index + 2 < len(palette):
+                color |= palette[3 * index] << 16 | palette[3 * index + 1] << 8 | palette[3 * index + 2]
+            canvas[(top + y) * width + left + x] = color
+        out.append(struct.pack('<%dI' % (width * height), *canvas))
+
+        for y in range(top, min(top + h, height)):
+            for x in range(left, min(left + w, width)):
+                if disposal == 2:
+                    canvas[y * width + x] = 0
+                elif disposal == 3:
+                    canvas[y * width + x] = saved[y * width + x]
+    return width, height, out
+
+
+def compare(checker, scratch, path):
+    if subprocess.run([checker, 'dump', path, scratch]).returncode != 0:
+        return 'cannot be opened'
+    width, height, frames = render(path)
+    data = open(scratch, 'rb').read()
+    w, h, count, _ = struct.unpack_from('<4I', data, 0)
+    if (w, h, count) != (width, height, len(frames)):
+        return 'is %ux%u with %u frames, not %ux%u with %u' % (w, h, count, width, height, len(frames))
+
+    # the dump holds Info, then each Frame and its pixels
+    offset = 16
+    for k in range(count):
+        offset += 24
+        if data[offset:offset + w * h * 4] != frames[k]:
+            return 'differs in frame %d' % k
+        offset += w * h * 4
+    return None
+
+
+if __name__ == '__main__':
+    failures = 0
+    for path in sys.argv[3:]:
+        problem = compare(sys.argv[1], sys.argv[2], path)
+        if problem:
+            print('%s %s' % (path, problem))
+            failures += 1
+    print('%d of %d GIFs match' % (len(sys.argv) - 3 - failures, len(sys.argv) - 3))
+    sys.exit(failures != 0)
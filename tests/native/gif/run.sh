@@ -0,0 +1,23 @@
+#!/bin/sh
+# Checks GifImage on random GIFs written by Pillow: every composed frame must match reference.py,
+# rendering frames out of order must give the same pixels, and mutations of the files must not trip
+# the sanitizers. BENCH=1 also times a large animation. Needs python3 and Pillow.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/gif_check.cpp $native/GifImage.cpp $native/MappedFile.cpp"
+build gif_check $sources
+
+python3 "$here/make_gifs.py" "$out/gifs" "${GIFS:-150}"
+python3 "$here/reference.py" "$out/gif_check" "$out/dump.bin" "$out"/gifs/*.gif
+for gif in "$out"/gifs/*.gif; do
+    "$out/gif_check" seek "$gif"
+done
+echo "out-of-order rendering matches"
+
+"$out/gif_check" fuzz 3 "$(iterations 20000)" "$out"/gifs/*.gif
+
+if bench; then
+    build_bench gif_bench $sources
+    python3 "$here/make_gifs.py" --large "$out/large.gif" 800 600 120
+    "$out/gif_bench" bench "$out/large.gif"
+fi
@@ -0,0 +1,143 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+// Pieces the harnesses under tests/native share: reading inputs, mutating them, running the fuzz
+// loop and timing.
+namespace Harness
+{
+    inline std::vector<uint8_t> ReadFile(const char* path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    // Reads the files, skipping those shorter than minimumSize.
+    inline std::vector<std::vector<uint8_t>> ReadFiles(char** paths, int count, size_t minimumSize)
+    {
+        std::vector<std::vector<uint8_t>> files;
+        for (int i = 0; i < count; i++)
+        {
+            auto file = ReadFile(paths[i]);
+            if (file.size() >= minimumSize)
+                files.push_back(std::move(file));
+        }
+        return files;
+    }
+
+    // Damages a valid file the way broken and hostile files differ from good ones: random and
+    // flipped bytes, 32-bit values that are small, near the file size or all ones, cut-off tails
+    // and removed runs. Half of the changes land in the first hotBytes, where headers and
+    // directories usually are.
+    struct Mutator
+    {
+        size_t hotBytes = 4096;
+        bool bigEndian = false;
+        uint32_t maximumChanges = 8;
+
+        void operator()(std::vector<uint8_t>& buffer, std::mt19937& rng) const
+        {
+            for (auto changes = 1 + rng() % maximumChanges; changes > 0 && buffer.size() >= 8; changes--)
+            {
+                size_t at = rng() % 2 ? rng() % std::min(buffer.size(), hotBytes) : rng() % buffer.size();
+                switch (rng() % 6)
+                {
+                case 0:
+                case 1:
+                    buffer[at] = static_cast<uint8_t>(rng());
+                    break;
+                case 2:
+                    buffer[at] ^= static_cast<uint8_t>(1 << (rng() % 8));
+                    break;
+                case 3:
+                {
+                    auto kind = rng() % 3;
+                    uint32_t value = kind == 0   ? rng() % 600
+                                     : kind == 1 ? static_cast<uint32_t>(rng() % (buffer.size() + 64))
+                                                 : 0xFFFFFFFF - rng() % 6;
+                    if (at + 4 > buffer.size())
+                        break;
+                    for (int i = 0; i < 4; i++)
+                        buffer[at + i] = static_cast<uint8_t>(value >> (bigEndian ? 24 - 8 * i : 8 * i));
+                    break;
+                }
+                case 4:
+                    buffer.resize(std::max<size_t>(8, rng() % buffer.size()));
+                    break;
+                case 5:
+                    buffer.erase(buffer.begin() + at, buffer.begin() + std::min(buffer.size(), at + 1 + rng() % 50));
+                    break;
+                }
+            }
+        }
+    };
+
+    // Hands count mutations of the seeds to accept, each in an exact-size copy so that ASan catches
+    // a read one past the end, and prints how many accept took. accept returns whether the parser
+    // took the input; it should then walk everything the parser hands out.
+    template <typename Accept>
+    int Fuzz(const std::vector<std::vector<uint8_t>>& seeds, long count, uint32_t seed, const Mutator& mutate,
+             Accept accept)
+    {
+        if (seeds.empty())
+        {
+            fprintf(stderr, "no seed files\n");
+            return 1;
+        }
+
+        std::mt19937 rng(seed);
+        long accepted = 0;
+        for (long i = 0; i < count; i++)
+        {
+            auto buffer = seeds[rng() % seeds.size()];
+            mutate(buffer, rng);
+            std::vector<uint8_t> exact(buffer);
+            if (accept(exact))
+                accepted++;
+        }
+
+        printf("accepted %ld of %ld mutations\n", accepted, count);
+        return 0;
+    }
+
+    class Stopwatch
+    {
+    public:
+        double Milliseconds() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+        }
+
+        void Restart()
+        {
+            _start = std::chrono::steady_clock::now();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+    };
+}
@@ -0,0 +1,133 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks HexView from the command line:
+//
+//   hex_check dump <file> <bytes per row>   prints the whole file the way the viewer shows it
+//   hex_check kernels <seed> <count>        compares the ToHex kernels of every level this CPU runs
+//   hex_check scroll <file> <calls>         times formatting 60-row pages at random offsets
+//
+// dump prints in the format of reference.py, so that the two can be compared with diff.
+
+#include "HexView.h"
+#include "harness.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int Dump(const char* path, uint32_t bytesPerRow)
+    {
+        HexView view;
+        if (!view.Open(path))
+            return 1;
+
+        // pages of 100 rows, so that the rows are formatted from several window positions
+        std::vector<char> text(1 << 20);
+        for (uint64_t row = 0;; row += 100)
+        {
+            auto written = view.Format(row, 100, bytesPerRow, text.data(), static_cast<uint32_t>(text.size()));
+            if (written == 0)
+                break;
+
+            fwrite(text.data(), 1, written, stdout);
+        }
+        return 0;
+    }
+
+    int Kernels(uint32_t seed, long iterations)
+    {
+        static const char digits[] = "0123456789ABCDEF";
+        const Simd::Level levels[] = {Simd::SCALAR, Simd::SSE2, Simd::AVX2, Simd::NEON};
+
+        std::mt19937 rng(seed);
+        for (long iteration = 0; iteration < iterations; iteration++)
+        {
+            // sizes around the vector widths and their multiples
+            size_t size = rng() % 300;
+            std::vector<uint8_t> data(size);
+            for (auto& byte : data)
+                byte = static_cast<uint8_t>(rng());
+
+            std::string expected(2 * size, 0);
+            for (size_t i = 0; i < size; i++)
+            {
+                expected[2 * i] = digits[data[i] >> 4];
+                expected[2 * i + 1] = digits[data[i] & 15];
+            }
+
+            for (auto level : levels)
+            {
+                if (!Simd::Supports(level))
+                    continue;
+
+                // an exact-size buffer, so that ASan catches a store one past the end
+                std::vector<char> hex(2 * size);
+                HexView::ToHex(data.data(), size, hex.data(), level);
+                if (std::string(hex.begin(), hex.end()) != expected)
+                {
+                    printf("ToHex mismatch at level %u for %zu bytes\n", level, size);
+                    return 1;
+                }
+            }
+        }
+
+        printf("ToHex kernels agree on %ld inputs; best level %u\n", iterations, Simd::Best());
+        return 0;
+    }
+
+    int Scroll(const char* path, int calls)
+    {
+        HexView view;
+        if (!view.Open(path))
+            return 1;
+
+        auto& info = view.GetInfo();
+        auto rows = (info.size + 15) / 16;
+        if (rows == 0)
+            return 1;
+
+        std::mt19937_64 rng(1);
+        std::vector<char> text(64 * 1024);
+        size_t characters = 0;
+        Harness::Stopwatch stopwatch;
+        for (int i = 0; i < calls; i++)
+            characters += view.Format(rng() % rows, 60, 16, text.data(), static_cast<uint32_t>(text.size()));
+        auto elapsed = stopwatch.Milliseconds() * 1000;
+
+        printf("%llu bytes, %u offset digits: %.3f us per 60-row page (%zu characters)\n",
+               static_cast<unsigned long long>(info.size), info.offsetDigits, elapsed / calls, characters / calls);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 3 ? argv[1] : "";
+    if (mode == "dump")
+        return Dump(argv[2], static_cast<uint32_t>(atoi(argv[3])));
+    if (mode == "kernels")
+        return Kernels(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]));
+    if (mode == "scroll")
+        return Scroll(argv[2], atoi(argv[3]));
+
+    fprintf(stderr, "usage: hex_check dump <file> <bytes per row> | kernels <seed> <count> | scroll <file> <calls>\n");
+    return 2;
+}
@@ -0,0 +1,25 @@
+# Reference hex dump in HexView's layout: "hexdump -C" rows with as many offset digits as the file
+# size needs, but at least 8.
+#
+#   reference.py <file> <bytes per row>
+import sys
+
+
+def dump(data, width):
+    digits = 8
+    while digits < 16 and len(data) >> (4 * digits):
+        digits += 1
+
+    for offset in range(0, len(data), width):
+        row = data[offset:offset + width]
+        hex = ''
+        for j in range(width):
+            hex += ('%02X' % row[j] if j < len(row) else '  ') + ' '
+            if j % 8 == 7 and j + 1 < width:
+                hex += ' '
+        text = ''.join(chr(c) if 0x20 <= c < 0x7f else '.' for c in row).ljust(width)
+        yield '%0*X  %s %s\n' % (digits, offset, hex, text)
+
+
+if __name__ == '__main__':
+    sys.stdout.write(''.join(dump(open(sys.argv[1], 'rb').read(), int(sys.argv[2]))))
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Checks HexView: the dump of a few files must match reference.py at every row width, and the ToHex
+# kernels of every level this CPU runs must agree. BENCH=1 also times scrolling through a sparse
+# 100 GB file, which the file system must support, and a small one. Needs python3.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/hex_check.cpp $native/HexView.cpp $native/MappedWindow.cpp $native/MappedFile.cpp $native/Simd.cpp"
+build hex_check $sources
+
+: > "$out/empty.bin"
+printf 'A' > "$out/one.bin"
+cat "$native"/HexView.* "$native"/CsvTable.* | head -c 22490 > "$out/text.bin"
+python3 -c "import random, sys; r = random.Random(1); sys.stdout.buffer.write(bytes(r.randrange(256) for _ in range(100003)))" \
+    > "$out/random.bin"
+for file in empty one text random; do
+    for width in 8 16 24 32 64; do
+        python3 "$here/reference.py" "$out/$file.bin" $width > "$out/$file.ref"
+        "$out/hex_check" dump "$out/$file.bin" $width > "$out/$file.out"
+        same "$out/$file.ref" "$out/$file.out"
+    done
+done
+echo "dumps match"
+
+"$out/hex_check" kernels 1 "$(iterations 200000)"
+
+if bench; then
+    build_bench hex_bench $sources
+    truncate -s 100G "$out/sparse.bin"
+    "$out/hex_bench" scroll "$out/sparse.bin" 1000
+    "$out/hex_bench" scroll "$out/random.bin" 100000
+    rm "$out/sparse.bin"
+fi
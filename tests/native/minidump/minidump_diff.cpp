@@ -0,0 +1,235 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Differential test of MinidumpImage against the minidump reader of LLVM.
+//
+//   minidump_diff <file.dmp>...                        compares each dump and prints what it read
+//   minidump_diff fuzz <seed> <count> <file.dmp>...    compares count mutations of the dumps
+//
+// A mutation that LLVM rejects is still walked through every reader, so that ASan and UBSan see it.
+
+#include "MinidumpImage.h"
+#include "harness.h"
+
+#include <llvm/Object/Minidump.h>
+#include <llvm/Support/ConvertUTF.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+    int failures = 0;
+
+#define CHECK(condition)                                                                     \
+    do                                                                                       \
+    {                                                                                        \
+        if (!(condition))                                                                    \
+        {                                                                                    \
+            failures++;                                                                      \
+            fprintf(stderr, "mismatch at %s:%d: %s\n", __FILE__, __LINE__, #condition);      \
+        }                                                                                    \
+    } while (0)
+
+    std::string Utf8(const uint8_t* utf16, uint32_t length)
+    {
+        std::vector<UTF16> units(length);
+        if (length != 0)
+            memcpy(units.data(), utf16, length * 2);
+        std::string out;
+        convertUTF16ToUTF8String(ArrayRef<UTF16>(units), out);
+        return out;
+    }
+
+    void WalkAll(const MinidumpImage& image)
+    {
+        volatile uint32_t sink = 0;
+        MinidumpImage::SystemInfo systemInfo;
+        image.GetSystemInfo(&systemInfo);
+        MinidumpImage::Exception exception;
+        image.GetException(&exception);
+
+        MinidumpImage::Thread threads[8];
+        for (uint32_t start = 0, n; (n = image.ReadThreads(start, threads, 8)) != 0; start += n)
+            sink += n;
+
+        MinidumpImage::Module modules[8];
+        for (uint32_t start = 0, n; (n = image.ReadModules(start, modules, 8)) != 0; start += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                if (modules[i].name != nullptr && modules[i].nameLength != 0)
+                    sink += modules[i].name[modules[i].nameLength * 2 - 1];
+            }
+        }
+
+        MinidumpImage::Stream streams[8];
+        for (uint32_t start = 0, n; (n = image.ReadStreams(start, streams, 8)) != 0; start += n)
+            sink += n;
+    }
+
+    // Returns whether MinidumpImage took the file.
+    bool Compare(const std::vector<uint8_t>& buffer, bool verbose)
+    {
+        MinidumpImage image;
+        auto parsed = image.Parse(buffer.data(), buffer.size());
+
+        auto file = object::MinidumpFile::create(
+            MemoryBufferRef(StringRef(reinterpret_cast<const char*>(buffer.data()), buffer.size()), "dump"));
+        if (!file)
+        {
+            // MinidumpImage may be more lenient; it must still read the file safely
+            consumeError(file.takeError());
+            WalkAll(image);
+            return parsed;
+        }
+
+        CHECK(parsed);
+        auto& reference = **file;
+        CHECK(image.GetInfo().streamCount == reference.streams().size());
+        CHECK(image.GetInfo().timeDateStamp == reference.header().TimeDateStamp);
+
+        MinidumpImage::SystemInfo systemInfo;
+        auto hasSystemInfo = image.GetSystemInfo(&systemInfo);
+        if (auto system = reference.getSystemInfo())
+        {
+            CHECK(hasSystemInfo);
+            CHECK(systemInfo.processorArchitecture == static_cast<uint32_t>(static_cast<minidump::ProcessorArchitecture>(system->ProcessorArch)));
+            CHECK(systemInfo.majorVersion == system->MajorVersion && systemInfo.minorVersion == system->MinorVersion &&
+                  systemInfo.buildNumber == system->BuildNumber);
+            CHECK(systemInfo.numberOfProcessors == system->NumberOfProcessors);
+            if (auto servicePack = reference.getString(system->CSDVersionRVA))
+                CHECK(Utf8(systemInfo.servicePack, systemInfo.servicePackLength) == *servicePack);
+            else
+                consumeError(servicePack.takeError());
+
+            if (verbose)
+                printf("arch %u, Windows %u.%u.%u, %u processors\n", systemInfo.processorArchitecture,
+                       systemInfo.majorVersion, systemInfo.minorVersion, systemInfo.buildNumber,
+                       systemInfo.numberOfProcessors);
+        }
+        else
+        {
+            consumeError(system.takeError());
+        }
+
+        if (auto referenceModules = reference.getModuleList())
+        {
+            std::vector<MinidumpImage::Module> modules(referenceModules->size() + 1);
+            auto count = image.ReadModules(0, modules.data(), static_cast<uint32_t>(modules.size()));
+            CHECK(count == referenceModules->size());
+            for (size_t i = 0; i < count && i < referenceModules->size(); i++)
+            {
+                auto& expected = (*referenceModules)[i];
+                CHECK(modules[i].baseAddress == expected.BaseOfImage && modules[i].size == expected.SizeOfImage &&
+                      modules[i].timeDateStamp == expected.TimeDateStamp && modules[i].checkSum == expected.Checksum);
+                if (auto name = reference.getString(expected.ModuleNameRVA))
+                    CHECK(Utf8(modules[i].name, modules[i].nameLength) == *name);
+                else
+                    consumeError(name.takeError());
+                if (expected.VersionInfo.Signature == 0xFEEF04BD)
+                    CHECK(modules[i].fileVersionMs == expected.VersionInfo.FileVersionHigh &&
+                          modules[i].fileVersionLs == expected.VersionInfo.FileVersionLow);
+
+                if (verbose)
+                    printf("module %llx %s %x.%x\n", static_cast<unsigned long long>(modules[i].baseAddress),
+                           Utf8(modules[i].name, modules[i].nameLength).c_str(), modules[i].fileVersionMs,
+                           modules[i].fileVersionLs);
+            }
+        }
+        else
+        {
+            consumeError(referenceModules.takeError());
+        }
+
+        if (auto referenceThreads = reference.getThreadList())
+        {
+            // read in pages of three to exercise the start index
+            std::vector<MinidumpImage::Thread> threads(referenceThreads->size() + 4);
+            uint32_t total = 0;
+            for (uint32_t n; (n = image.ReadThreads(total, threads.data() + total, 3)) != 0; total += n)
+            {
+                if (total + n + 3 > threads.size())
+                    threads.resize(total + n + 3);
+            }
+
+            CHECK(total == referenceThreads->size());
+            for (size_t i = 0; i < total && i < referenceThreads->size(); i++)
+            {
+                auto& expected = (*referenceThreads)[i];
+                CHECK(threads[i].threadId == expected.ThreadId && threads[i].teb == expected.EnvironmentBlock &&
+                      threads[i].stackStart == expected.Stack.StartOfMemoryRange &&
+                      threads[i].stackSize == expected.Stack.Memory.DataSize &&
+                      threads[i].contextSize == expected.Context.DataSize &&
+                      threads[i].priority == expected.Priority);
+
+                if (verbose)
+                    printf("thread %x, TEB %llx\n", threads[i].threadId, static_cast<unsigned long long>(threads[i].teb));
+            }
+        }
+        else
+        {
+            consumeError(referenceThreads.takeError());
+        }
+
+        if (auto referenceException = reference.getExceptionStream())
+        {
+            MinidumpImage::Exception exception;
+            CHECK(image.GetException(&exception));
+            auto& record = referenceException->ExceptionRecord;
+            CHECK(exception.threadId == referenceException->ThreadId && exception.code == record.ExceptionCode &&
+                  exception.address == record.ExceptionAddress && exception.flags == record.ExceptionFlags);
+            for (uint32_t i = 0; i < exception.numberParameters; i++)
+                CHECK(exception.parameters[i] == record.ExceptionInformation[i]);
+
+            if (verbose)
+                printf("exception %x at %llx in thread %x, %u parameters\n", exception.code,
+                       static_cast<unsigned long long>(exception.address), exception.threadId,
+                       exception.numberParameters);
+        }
+        else
+        {
+            consumeError(referenceException.takeError());
+        }
+        return parsed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 4 && strcmp(argv[1], "fuzz") == 0)
+    {
+        // the directory entries and the RVAs and sizes they point at are in the first few hundred bytes
+        Harness::Mutator mutate;
+        mutate.hotBytes = 160;
+        auto status = Harness::Fuzz(Harness::ReadFiles(argv + 4, argc - 4, 8), atol(argv[3]),
+                                    static_cast<uint32_t>(atol(argv[2])), mutate,
+                                    [](const std::vector<uint8_t>& data) { return Compare(data, false); });
+        printf("%d mismatches\n", failures);
+        return status != 0 || failures != 0;
+    }
+
+    for (int i = 1; i < argc; i++)
+        Compare(Harness::ReadFile(argv[i]), true);
+
+    printf("%d mismatches\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Compares MinidumpImage with LLVM's minidump reader on a sample dump and on mutations of it.
+# Needs the LLVM development files (llvm-config) and yaml2obj.
+. "$(dirname "$0")/../common.sh"
+
+build minidump_diff $(llvm-config --cxxflags | sed 's/-std=[^ ]*//; s/-fno-exceptions//; s/-I/-isystem /g') \
+    "$here/minidump_diff.cpp" "$native/MinidumpImage.cpp" "$native/MappedFile.cpp" \
+    $(llvm-config --ldflags --libs object support)
+
+yaml2obj "$here/sample.yaml" -o "$out/sample.dmp"
+"$out/minidump_diff" "$out/sample.dmp"
+"$out/minidump_diff" fuzz 42 "$(iterations 200000)" "$out/sample.dmp"
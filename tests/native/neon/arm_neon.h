@@ -0,0 +1,311 @@
+// Plain C++ model of the AArch64 NEON intrinsics the native kernels use, lane by lane as the Arm C
+// Language Extensions define them, so that the NEON kernels can be built and checked on x86:
+//
+//   g++ -DQL_SIMD_NEON -include tests/native/neon/arm_neon.h ...
+//
+// Simd.h still selects the x86 kernels on such a build, so one binary runs every level. Vector types
+// are distinct structs, as they are for the compiler, and lane indices must be constants in range.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+template <typename T, int N>
+struct NeonVector
+{
+    T lane[N];
+};
+
+using uint8x8_t = NeonVector<uint8_t, 8>;
+using uint8x16_t = NeonVector<uint8_t, 16>;
+using uint16x8_t = NeonVector<uint16_t, 8>;
+using uint32x4_t = NeonVector<uint32_t, 4>;
+using uint64x1_t = NeonVector<uint64_t, 1>;
+using uint64x2_t = NeonVector<uint64_t, 2>;
+
+struct uint8x16x2_t
+{
+    uint8x16_t val[2];
+};
+
+namespace NeonModel
+{
+    template <typename V, typename F>
+    inline V Map(const V& a, const V& b, F f)
+    {
+        V r;
+        for (int i = 0; i < int(sizeof r.lane / sizeof r.lane[0]); i++)
+            r.lane[i] = f(a.lane[i], b.lane[i]);
+        return r;
+    }
+
+    template <typename V, typename T>
+    inline V Duplicate(T value)
+    {
+        V r;
+        for (auto& lane : r.lane)
+            lane = value;
+        return r;
+    }
+
+    template <typename To, typename From>
+    inline To Reinterpret(const From& from)
+    {
+        static_assert(sizeof(To) == sizeof(From), "reinterpret between vectors of one size");
+        To to;
+        memcpy(&to, &from, sizeof to);
+        return to;
+    }
+
+    template <typename V>
+    inline V Load(const void* address)
+    {
+        V r;
+        memcpy(r.lane, address, sizeof r.lane);
+        return r;
+    }
+}
+
+// loads and stores
+
+inline uint8x16_t vld1q_u8(const uint8_t* p) { return NeonModel::Load<uint8x16_t>(p); }
+inline uint32x4_t vld1q_u32(const uint32_t* p) { return NeonModel::Load<uint32x4_t>(p); }
+inline void vst1q_u8(uint8_t* p, uint8x16_t a) { memcpy(p, a.lane, sizeof a.lane); }
+inline void vst1q_u32(uint32_t* p, uint32x4_t a) { memcpy(p, a.lane, sizeof a.lane); }
+
+// interleaves: p[2i] = val[0][i], p[2i + 1] = val[1][i]
+inline void vst2q_u8(uint8_t* p, uint8x16x2_t a)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        p[2 * i] = a.val[0].lane[i];
+        p[2 * i + 1] = a.val[1].lane[i];
+    }
+}
+
+// duplicates, halves and lanes
+
+inline uint8x16_t vdupq_n_u8(uint8_t x) { return NeonModel::Duplicate<uint8x16_t>(x); }
+inline uint16x8_t vdupq_n_u16(uint16_t x) { return NeonModel::Duplicate<uint16x8_t>(x); }
+inline uint32x4_t vdupq_n_u32(uint32_t x) { return NeonModel::Duplicate<uint32x4_t>(x); }
+
+inline uint8x8_t vget_low_u8(uint8x16_t a)
+{
+    uint8x8_t r;
+    memcpy(r.lane, a.lane, 8);
+    return r;
+}
+
+inline uint8x8_t vget_high_u8(uint8x16_t a)
+{
+    uint8x8_t r;
+    memcpy(r.lane, a.lane + 8, 8);
+    return r;
+}
+
+inline uint8x16_t vcombine_u8(uint8x8_t low, uint8x8_t high)
+{
+    uint8x16_t r;
+    memcpy(r.lane, low.lane, 8);
+    memcpy(r.lane + 8, high.lane, 8);
+    return r;
+}
+
+inline uint64_t vget_lane_u64(uint64x1_t a, int lane) { return a.lane[lane]; }
+inline uint64_t vgetq_lane_u64(uint64x2_t a, int lane) { return a.lane[lane]; }
+
+// the last 16 - n lanes of a followed by the first n lanes of b
+inline uint8x16_t vextq_u8(uint8x16_t a, uint8x16_t b, int n)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 16; i++)
+        r.lane[i] = i + n < 16 ? a.lane[i + n] : b.lane[i + n - 16];
+    return r;
+}
+
+// reinterpretation
+
+inline uint16x8_t vreinterpretq_u16_u8(uint8x16_t a) { return NeonModel::Reinterpret<uint16x8_t>(a); }
+inline uint32x4_t vreinterpretq_u32_u8(uint8x16_t a) { return NeonModel::Reinterpret<uint32x4_t>(a); }
+inline uint64x2_t vreinterpretq_u64_u8(uint8x16_t a) { return NeonModel::Reinterpret<uint64x2_t>(a); }
+inline uint8x16_t vreinterpretq_u8_u16(uint16x8_t a) { return NeonModel::Reinterpret<uint8x16_t>(a); }
+inline uint8x16_t vreinterpretq_u8_u32(uint32x4_t a) { return NeonModel::Reinterpret<uint8x16_t>(a); }
+inline uint64x1_t vreinterpret_u64_u8(uint8x8_t a) { return NeonModel::Reinterpret<uint64x1_t>(a); }
+
+// bitwise
+
+inline uint8x16_t vandq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x & y); });
+}
+
+inline uint8x16_t vorrq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x | y); });
+}
+
+inline uint8x16_t veorq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x ^ y); });
+}
+
+// each bit from a where the mask bit is set, else from b
+inline uint8x16_t vbslq_u8(uint8x16_t mask, uint8x16_t a, uint8x16_t b)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 16; i++)
+        r.lane[i] = uint8_t((mask.lane[i] & a.lane[i]) | (~mask.lane[i] & b.lane[i]));
+    return r;
+}
+
+// comparisons set every bit of a lane that holds
+
+inline uint8x16_t vceqq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x == y ? 0xFF : 0); });
+}
+
+inline uint8x16_t vcgeq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x >= y ? 0xFF : 0); });
+}
+
+inline uint8x16_t vcltq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x < y ? 0xFF : 0); });
+}
+
+inline uint16x8_t vceqq_u16(uint16x8_t a, uint16x8_t b)
+{
+    return NeonModel::Map(a, b, [](uint16_t x, uint16_t y) { return uint16_t(x == y ? 0xFFFF : 0); });
+}
+
+// arithmetic; the q forms saturate, the others wrap
+
+inline uint8x16_t vqaddq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x + y > 0xFF ? 0xFF : x + y); });
+}
+
+inline uint8x16_t vqsubq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return uint8_t(x > y ? x - y : 0); });
+}
+
+inline uint8x16_t vminq_u8(uint8x16_t a, uint8x16_t b)
+{
+    return NeonModel::Map(a, b, [](uint8_t x, uint8_t y) { return x < y ? x : y; });
+}
+
+inline uint16x8_t vaddq_u16(uint16x8_t a, uint16x8_t b)
+{
+    return NeonModel::Map(a, b, [](uint16_t x, uint16_t y) { return uint16_t(x + y); });
+}
+
+inline uint32x4_t vsubq_u32(uint32x4_t a, uint32x4_t b)
+{
+    return NeonModel::Map(a, b, [](uint32_t x, uint32_t y) { return uint32_t(x - y); });
+}
+
+inline uint32x4_t vmulq_n_u32(uint32x4_t a, uint32_t b)
+{
+    for (auto& lane : a.lane)
+        lane *= b;
+    return a;
+}
+
+// widening multiply of the eight lanes
+inline uint16x8_t vmull_u8(uint8x8_t a, uint8x8_t b)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.lane[i] = uint16_t(a.lane[i] * b.lane[i]);
+    return r;
+}
+
+// pairwise add: the sums of neighbouring lanes of a, then those of b
+inline uint8x16_t vpaddq_u8(uint8x16_t a, uint8x16_t b)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 8; i++)
+    {
+        r.lane[i] = uint8_t(a.lane[2 * i] + a.lane[2 * i + 1]);
+        r.lane[i + 8] = uint8_t(b.lane[2 * i] + b.lane[2 * i + 1]);
+    }
+    return r;
+}
+
+// shifts
+
+inline uint8x16_t vshrq_n_u8(uint8x16_t a, int n)
+{
+    for (auto& lane : a.lane)
+        lane = uint8_t(lane >> n);
+    return a;
+}
+
+inline uint16x8_t vshrq_n_u16(uint16x8_t a, int n)
+{
+    for (auto& lane : a.lane)
+        lane = uint16_t(lane >> n);
+    return a;
+}
+
+inline uint32x4_t vshrq_n_u32(uint32x4_t a, int n)
+{
+    for (auto& lane : a.lane)
+        lane >>= n;
+    return a;
+}
+
+// shift right and keep the low half of each lane
+inline uint8x8_t vshrn_n_u16(uint16x8_t a, int n)
+{
+    uint8x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.lane[i] = uint8_t(a.lane[i] >> n);
+    return r;
+}
+
+// table lookup; an index past the 16 table bytes gives 0
+inline uint8x16_t vqtbl1q_u8(uint8x16_t table, uint8x16_t index)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 16; i++)
+        r.lane[i] = index.lane[i] < 16 ? table.lane[index.lane[i]] : 0;
+    return r;
+}
+
+// across-vector reductions
+
+inline uint8_t vmaxvq_u8(uint8x16_t a)
+{
+    uint8_t m = 0;
+    for (auto lane : a.lane)
+        m = lane > m ? lane : m;
+    return m;
+}
+
+inline uint8_t vminvq_u8(uint8x16_t a)
+{
+    uint8_t m = 0xFF;
+    for (auto lane : a.lane)
+        m = lane < m ? lane : m;
+    return m;
+}
+
+inline uint32_t vmaxvq_u32(uint32x4_t a)
+{
+    uint32_t m = 0;
+    for (auto lane : a.lane)
+        m = lane > m ? lane : m;
+    return m;
+}
+
+inline uint32_t vminvq_u32(uint32x4_t a)
+{
+    uint32_t m = 0xFFFFFFFF;
+    for (auto lane : a.lane)
+        m = lane < m ? lane : m;
+    return m;
+}
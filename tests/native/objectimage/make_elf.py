@@ -0,0 +1,156 @@
+# Writes a synthetic ELF shared object:
+#
+#   make_elf.py <out> <32|64> <little|big> <symbols> [extra sections] [seed]
+#
+# It has PT_LOAD, PT_DYNAMIC and PT_GNU_STACK program headers, a .dynamic section with needed
+# libraries, a soname and a runpath, and both .dynsym and .symtab with random bindings, types and
+# section indices. With 65280 or more sections the counts move into the first section header
+# (extended numbering), the way they do in huge objects.
+import random
+import struct
+import sys
+
+out, bits, endian, symbol_count = sys.argv[1], int(sys.argv[2]), sys.argv[3], int(sys.argv[4])
+extra = int(sys.argv[5]) if len(sys.argv) > 5 else 0
+rnd = random.Random(int(sys.argv[6]) if len(sys.argv) > 6 else 1)
+order = '<' if endian == 'little' else '>'
+word = 'Q' if bits == 64 else 'I'
+machine = {(64, 'little'): 62, (64, 'big'): 21, (32, 'little'): 3, (32, 'big'): 8}[bits, endian]
+BASE = 0x10000
+
+SHT_PROGBITS, SHT_SYMTAB, SHT_STRTAB, SHT_DYNAMIC, SHT_NOBITS, SHT_DYNSYM = 1, 2, 3, 6, 8, 11
+SHN_LORESERVE, SHN_ABS, SHN_COMMON, SHN_XINDEX = 0xff00, 0xfff1, 0xfff2, 0xffff
+DT_NEEDED, DT_STRTAB, DT_SYMTAB, DT_STRSZ, DT_SYMENT, DT_SONAME, DT_RUNPATH = 1, 5, 6, 10, 11, 14, 29
+
+
+class Strings:
+    def __init__(self):
+        self.data = bytearray(b'\0')
+        self.offsets = {}
+
+    def add(self, text):
+        if text not in self.offsets:
+            self.offsets[text] = len(self.data)
+            self.data += text.encode() + b'\0'
+        return self.offsets[text]
+
+
+def pack(fields, *values):
+    return struct.pack(order + fields, *values)
+
+
+# the sections in file order; filled in with their contents below
+sections = [dict(name='', type=0, flags=0, data=b'', link=0, info=0, align=0, entsize=0)]
+
+
+def section(name, type, data=b'', flags=2, link=0, info=0, align=8, entsize=0, size=None):
+    sections.append(dict(name=name, type=type, flags=flags, data=data, link=link, info=info, align=align,
+                         entsize=entsize, size=size))
+    return len(sections) - 1
+
+
+text = section('.text', SHT_PROGBITS, bytes(rnd.randrange(256) for _ in range(256)), flags=6, align=16)
+data = section('.data', SHT_PROGBITS, bytes(64), flags=3)
+bss = section('.bss', SHT_NOBITS, flags=3, size=4096)
+for i in range(extra):
+    section('.extra.%d' % i, SHT_PROGBITS, flags=0, align=1)
+index_limit = len(sections) + 6
+
+
+def symbols(count, strings, prefix):
+    table = [pack('IIIBBH' if bits == 32 else 'IBBHQQ', *([0] * 6))]
+    for i in range(count):
+        name = strings.add('%s%d' % (prefix, i))
+        binding = rnd.choice([0, 1, 2])
+        kind = rnd.choice([0, 1, 2, 3, 4, 6])
+        shndx = rnd.choice([0, text, data, bss, SHN_ABS, SHN_COMMON, rnd.randrange(index_limit)])
+        if shndx >= SHN_LORESERVE and shndx not in (SHN_ABS, SHN_COMMON):
+            shndx = 0
+        value = rnd.randrange(1 << (bits - 4))
+        size = rnd.randrange(1 << 16)
+        info = binding << 4 | kind
+        table.append(pack('IIIBBH', name, value, size, info, 0, shndx) if bits == 32
+                     else pack('IBBHQQ', name, info, 0, shndx, value, size))
+    return b''.join(table)
+
+
+dynstr = Strings()
+needed = ['libc.so.6', 'libm.so.6', 'libquicklook-%d.so' % rnd.randrange(100)]
+for library in needed:
+    dynstr.add(library)
+soname = dynstr.add('libsynthetic.so.1')
+runpath = dynstr.add('$ORIGIN/../lib')
+dynsym_data = symbols(symbol_count // 4, dynstr, 'dyn_')
+strtab = Strings()
+symtab_data = symbols(symbol_count, strtab, 'local_symbol_')
+
+entry_size = 24 if bits == 64 else 16
+dynstr_index = section('.dynstr', SHT_STRTAB, bytes(dynstr.data), align=1)
+dynsym_index = section('.dynsym', SHT_DYNSYM, dynsym_data, link=dynstr_index, info=1, entsize=entry_size)
+dynamic_index = section('.dynamic', SHT_DYNAMIC, b'', flags=3, link=dynstr_index, entsize=16 if bits == 64 else 8)
+strtab_index = section('.strtab', SHT_STRTAB, bytes(strtab.data), flags=0, align=1)
+section('.symtab', SHT_SYMTAB, symtab_data, flags=0, link=strtab_index, info=1, entsize=entry_size)
+shstrtab_index = section('.shstrtab', SHT_STRTAB, b'', flags=0, align=1)
+
+header_size = 64 if bits == 64 else 52
+program_header_size = 56 if bits == 64 else 32
+program_header_count = 3
+
+# lay the sections out after the program headers; .dynamic is a fixed size, so it can be filled in
+# once the addresses of .dynstr and .dynsym are known
+dynamic_count = len(needed) + 7
+sections[dynamic_index]['data'] = bytes(dynamic_count * (16 if bits == 64 else 8))
+shstrtab = Strings()
+for s in sections:
+    s['name_offset'] = shstrtab.add(s['name']) if s['name'] else 0
+sections[shstrtab_index]['data'] = bytes(shstrtab.data)
+
+offset = header_size + program_header_size * program_header_count
+for s in sections[1:]:
+    offset = (offset + s['align'] - 1) // max(s['align'], 1) * max(s['align'], 1)
+    s['offset'] = offset
+    if s['type'] != SHT_NOBITS:
+        offset += len(s['data'])
+section_headers = (offset + 7) // 8 * 8
+
+dynamic = [(DT_NEEDED, dynstr.offsets[library]) for library in needed]
+dynamic += [(DT_SONAME, soname), (DT_RUNPATH, runpath), (DT_STRTAB, BASE + sections[dynstr_index]['offset']),
+            (DT_STRSZ, len(dynstr.data)), (DT_SYMTAB, BASE + sections[dynsym_index]['offset']),
+            (DT_SYMENT, entry_size), (0, 0)]
+sections[dynamic_index]['data'] = b''.join(pack(word * 2, tag, value) for tag, value in dynamic)
+
+count = len(sections)
+extended = count >= SHN_LORESERVE
+elf = bytearray(b'\x7fELF' + bytes([2 if bits == 64 else 1, 1 if endian == 'little' else 2, 1, 0]) + bytes(8))
+elf += pack('HHI' + word * 3 + 'IHHHHHH', 3, machine, 1, BASE + sections[text]['offset'], header_size,
+            section_headers, 0, header_size, program_header_size, program_header_count,
+            64 if bits == 64 else 40, 0 if extended else count, SHN_XINDEX if extended else shstrtab_index)
+
+file_size = section_headers + count * (64 if bits == 64 else 40)
+dynamic_section = sections[dynamic_index]
+loads = [(1, 0, 0, file_size, file_size + 4096, 7), (2, dynamic_section['offset'], BASE + dynamic_section['offset'],
+                                                      len(dynamic_section['data']), len(dynamic_section['data']), 6),
+         (0x6474e551, 0, 0, 0, 0, 6)]
+for kind, offset, address, size, memory, flags in loads:
+    address = address or (BASE if kind == 1 else 0)
+    if bits == 64:
+        elf += pack('IIQQQQQQ', kind, flags, offset, address, address, size, memory, 8)
+    else:
+        elf += pack('IIIIIIII', kind, offset, address, address, size, memory, flags, 8)
+
+for s in sections[1:]:
+    elf += bytes(s['offset'] - len(elf))
+    if s['type'] != SHT_NOBITS:
+        elf += s['data']
+elf += bytes(section_headers - len(elf))
+
+for i, s in enumerate(sections):
+    size = s['size'] if s.get('size') is not None else len(s['data'])
+    link = s['link']
+    if i == 0 and extended:
+        size, link = count, shstrtab_index
+    address = BASE + s.get('offset', 0) if s['flags'] & 2 else 0
+    elf += pack('IIIIIIIIII' if bits == 32 else 'IIQQQQIIQQ', s['name_offset'], s['type'], s['flags'], address,
+                s.get('offset', 0), size, link, s['info'], s['align'], s['entsize'])
+
+open(out, 'wb').write(elf)
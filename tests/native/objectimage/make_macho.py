@@ -0,0 +1,125 @@
+# Writes a synthetic Mach-O executable, thin or fat:
+#
+#   make_macho.py <out> <symbols> <arch>... [--fat64] [--seed n]
+#
+# Each arch (i386, x86_64, arm64, ppc) becomes a thin image with __PAGEZERO, __TEXT, __DATA and
+# __LINKEDIT segments, LC_SYMTAB, LC_LOAD_DYLIB and LC_UUID; ppc is big-endian. Several arches are
+# wrapped in a fat file, with 64-bit slice entries when --fat64 is given.
+import random
+import struct
+import sys
+
+args = [a for a in sys.argv[1:] if not a.startswith('--')]
+out, symbol_count, arches = args[0], int(args[1]), args[2:]
+fat64 = '--fat64' in sys.argv
+rnd = random.Random(int(sys.argv[sys.argv.index('--seed') + 1]) if '--seed' in sys.argv else 1)
+if '--seed' in sys.argv:
+    arches = arches[:-1]
+
+CPU = {'i386': (7, 3, 32, '<'), 'x86_64': (0x1000007, 3, 64, '<'), 'arm64': (0x100000c, 0, 64, '<'),
+       'ppc': (18, 0, 32, '>')}
+LC_SEGMENT, LC_SYMTAB, LC_LOAD_DYLIB, LC_SEGMENT_64, LC_UUID = 0x1, 0x2, 0xc, 0x19, 0x1b
+S_ZEROFILL, S_CSTRING_LITERALS = 0x1, 0x2
+
+
+def thin(arch):
+    cpu, subtype, bits, order = CPU[arch]
+    word = 'Q' if bits == 64 else 'I'
+    header_size = 32 if bits == 64 else 28
+    segment_size = 72 if bits == 64 else 56
+    section_size = 80 if bits == 64 else 68
+    base = 0x100000000 if bits == 64 else 0x1000
+
+    text = bytes(rnd.randrange(256) for _ in range(rnd.randrange(64, 512)))
+    cstring = b'hello, world\0quicklook\0'
+    data = bytes(rnd.randrange(256) for _ in range(48))
+    segments = [('__PAGEZERO', []), ('__TEXT', [('__text', text, 0x80000400), ('__cstring', cstring, S_CSTRING_LITERALS)]),
+                ('__DATA', [('__data', data, 0), ('__bss', 256, S_ZEROFILL)]), ('__LINKEDIT', [])]
+    dylib = b'/usr/lib/libSystem.B.dylib\0'
+    dylib += bytes(-(24 + len(dylib)) % 8)
+    commands_size = sum(segment_size + section_size * len(s) for _, s in segments) + 24 + 24 + len(dylib) + 24
+    content = header_size + commands_size
+    content = (content + 15) // 16 * 16
+
+    # place the section contents after the load commands, then the symbol and string tables
+    blob = bytearray()
+    placed = []
+    for name, sections in segments:
+        for section, payload, flags in sections:
+            if flags == S_ZEROFILL:
+                placed.append((name, section, payload, 0, flags))
+                continue
+            blob += bytes(-len(blob) % 16)
+            placed.append((name, section, len(payload), content + len(blob), flags))
+            blob += payload
+
+    strings = bytearray(b' \0')
+    nlist = b''
+    for i in range(symbol_count):
+        name = '_%s_%d' % (rnd.choice(['main', 'helper', 'quick', 'look', 'objc_msgSend']), i)
+        offset = len(strings)
+        strings += name.encode() + b'\0'
+        kind = rnd.choice([0x0e, 0x0f, 0x0f, 0x01, 0x1e, 0x02])
+        section = rnd.randrange(1, 5) if kind & 0x0e == 0x0e else 0
+        nlist += struct.pack(order + 'IBBH' + word, offset, kind, section, 0,
+                             base + rnd.randrange(0x10000) if kind != 0x01 else 0)
+    blob += bytes(-len(blob) % 8)
+    symbols = content + len(blob)
+    blob += nlist
+    string_table = content + len(blob)
+    blob += strings
+    blob += bytes(-len(blob) % 8)
+    file_size = content + len(blob)
+
+    commands = b''
+    index = 0
+    address = base
+    for name, sections in segments:
+        own = [p for p in placed if p[0] == name]
+        if name == '__PAGEZERO':
+            vmaddr, vmsize, fileoff, filesize, prot = 0, base, 0, 0, 0
+        elif name == '__LINKEDIT':
+            vmaddr, vmsize, fileoff, filesize, prot = address, 0x4000, symbols, file_size - symbols, 1
+        else:
+            start = min(p[3] for p in own if p[3]) // 16 * 16 if name == '__DATA' else 0
+            end = max(p[3] + p[2] for p in own if p[3])
+            vmaddr, vmsize, fileoff, filesize, prot = address, 0x4000, start, end - start, 5 if name == '__TEXT' else 3
+            address += 0x4000
+        commands += struct.pack(order + 'II16s' + word * 4 + 'iiII', LC_SEGMENT_64 if bits == 64 else LC_SEGMENT,
+                                segment_size + section_size * len(own), name.encode(), vmaddr, vmsize, fileoff,
+                                filesize, 7 if prot else 0, prot, len(own), 0)
+        for _, section, size, offset, flags in own:
+            section_address = vmaddr + (offset - fileoff if offset else index * 0x100)
+            commands += struct.pack(order + '16s16s' + word * 2 + 'IIIIIII' + ('I' if bits == 64 else ''),
+                                    section.encode(), name.encode(), section_address, size, offset, 4, 0, 0, flags,
+                                    0, 0, *([0] if bits == 64 else []))
+            index += 1
+
+    commands += struct.pack(order + 'IIIIII', LC_SYMTAB, 24, symbols, symbol_count, string_table, len(strings))
+    commands += struct.pack(order + 'IIIIII', LC_LOAD_DYLIB, 24 + len(dylib), 24, 2, 0x10000, 0x10000) + dylib
+    commands += struct.pack(order + 'II', LC_UUID, 24) + bytes(rnd.randrange(256) for _ in range(16))
+    assert len(commands) == commands_size
+
+    magic = 0xfeedfacf if bits == 64 else 0xfeedface
+    header = struct.pack(order + 'IiiIIII', magic, cpu, subtype, 2, 3 + len(segments), commands_size, 0x200085)
+    header += bytes(4) if bits == 64 else b''
+    image = header + commands
+    return cpu, subtype, image + bytes(content - len(image)) + blob
+
+
+slices = [thin(arch) for arch in arches]
+if len(slices) == 1:
+    open(out, 'wb').write(slices[0][2])
+    sys.exit()
+
+# slices are page aligned after the fat header, as lipo does it
+entry = '>iiQQII' if fat64 else '>iiIII'
+fat = bytearray(struct.pack('>II', 0xcafebabf if fat64 else 0xcafebabe, len(slices)))
+fat += bytes(struct.calcsize(entry) * len(slices))
+body = bytearray()
+for i, (cpu, subtype, image) in enumerate(slices):
+    offset = (len(fat) + len(body) + 0xfff) // 0x1000 * 0x1000
+    body += bytes(offset - len(fat) - len(body)) + image
+    fields = (cpu, subtype, offset, len(image), 12) + ((0,) if fat64 else ())
+    struct.pack_into(entry, fat, 8 + struct.calcsize(entry) * i, *fields)
+open(out, 'wb').write(fat + body)
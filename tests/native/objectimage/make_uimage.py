@@ -0,0 +1,33 @@
+# Writes a legacy U-Boot uImage: a 64-byte big-endian header followed by the payload.
+#
+#   make_uimage.py <out> <payload bytes> <good|header|payload|truncated> [seed]
+#
+# "header" corrupts the header name after the header checksum is computed, "payload" flips a
+# payload byte after ih_dcrc is computed and "truncated" drops the last payload byte.
+import random
+import struct
+import sys
+import zlib
+
+out, size, damage = sys.argv[1], int(sys.argv[2]), sys.argv[3]
+rnd = random.Random(int(sys.argv[4]) if len(sys.argv) > 4 else 1)
+
+payload = bytearray(rnd.getrandbits(8) for _ in range(size))
+name = b'Linux-6.1 generated'.ljust(32, b'\0')
+
+
+def header(header_crc):
+    # magic, hcrc, time, size, load, ep, dcrc, os, arch, type, comp, name
+    return struct.pack('>7I4B32s', 0x27051956, header_crc, 1700000000, size, 0x80008000, 0x80008000,
+                       zlib.crc32(payload), 5, 2, 2, 0, name)
+
+
+image = bytearray(header(zlib.crc32(header(0))))
+if damage == 'header':
+    image[40] ^= 0x20
+image += payload
+if damage == 'payload':
+    image[64 + size // 2] ^= 1
+if damage == 'truncated':
+    image = image[:-1]
+open(out, 'wb').write(image)
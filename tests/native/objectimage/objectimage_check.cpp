@@ -0,0 +1,247 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks ObjectImage from the command line:
+//
+//   objectimage_check print <file>                   prints the header and every table; a fat file
+//                                                    prints its slices and then each slice selected
+//   objectimage_check verify <file>                  prints the uImage header and payload checks
+//   objectimage_check bench <file>                   times opening the image and each table walk
+//   objectimage_check fuzz <seed> <count> <file>...  walks count mutations of the files
+//
+// The print format matches reference.py, so that the two can be compared with diff.
+
+#include "ObjectImage.h"
+#include "harness.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    volatile uint8_t sink;
+
+    std::string Name(const char* name, uint32_t length)
+    {
+        return name != nullptr && length != 0 ? std::string(name, length) : "-";
+    }
+
+    size_t PrintTables(const ObjectImage& image, bool print)
+    {
+        auto& info = image.GetInfo();
+        size_t total = 0;
+        if (print && info.format == ObjectImage::ELF)
+            printf("format 1 machine %x type %x entry %" PRIx64 " os %x\n", info.machine, info.type, info.entry,
+                   info.os);
+        else if (print && info.format == ObjectImage::MACHO)
+            printf("format 2 machine %x sub %x type %x flags %x\n", info.machine, info.subMachine, info.type,
+                   info.flags);
+
+        ObjectImage::ProgramHeader programs[7];
+        for (uint32_t n, start = 0; (n = image.ReadProgramHeaders(start, programs, 7)) != 0; start += n, total += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& program = programs[i];
+                if (program.name != nullptr && program.nameLength != 0)
+                    sink += program.name[program.nameLength - 1];
+                if (!print)
+                    continue;
+
+                printf("program %x %x %" PRIx64 " %" PRIx64 " %" PRIx64 " %" PRIx64, program.type, program.flags,
+                       program.offset, program.address, program.fileSize, program.memorySize);
+                if (program.name != nullptr)
+                    printf(" %s", Name(program.name, program.nameLength).c_str());
+                printf("\n");
+
+                // Mach-O sections follow their segment
+                if (info.format != ObjectImage::MACHO || program.name == nullptr)
+                    continue;
+
+                ObjectImage::Section section;
+                for (uint32_t s = 0; image.ReadSections(s, &section, 1) == 1; s++)
+                {
+                    if (Name(section.segmentName, section.segmentNameLength) != Name(program.name, program.nameLength))
+                        continue;
+                    printf("section %s,%s %x %" PRIx64 " %" PRIx64 " %" PRIx64 " %" PRIx64 "\n",
+                           Name(section.segmentName, section.segmentNameLength).c_str(),
+                           Name(section.name, section.nameLength).c_str(), section.type, section.flags,
+                           section.address, section.offset, section.size);
+                }
+            }
+        }
+
+        ObjectImage::Section sections[5];
+        for (uint32_t n, start = 0; (n = image.ReadSections(start, sections, 5)) != 0; start += n, total += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& section = sections[i];
+                if (section.name != nullptr && section.nameLength != 0)
+                    sink += section.name[section.nameLength - 1];
+                if (print && info.format == ObjectImage::ELF)
+                    printf("section %s %x %" PRIx64 " %" PRIx64 " %" PRIx64 " %" PRIx64 "\n",
+                           Name(section.name, section.nameLength).c_str(), section.type, section.flags,
+                           section.address, section.offset, section.size);
+            }
+        }
+
+        ObjectImage::DynamicEntry dynamic[6];
+        uint32_t dynamicCount = 0;
+        for (uint32_t n; (n = image.ReadDynamic(dynamicCount, dynamic, 6)) != 0; dynamicCount += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& entry = dynamic[i];
+                if (entry.string != nullptr)
+                    sink += entry.string[0];
+                if (print)
+                    printf("dynamic %" PRIx64 "%s%s\n", static_cast<uint64_t>(entry.tag), entry.string ? " " : "",
+                           entry.string ? entry.string : "");
+            }
+        }
+        // ReadDynamic stops before DT_NULL, llvm-readobj shows it
+        if (print && info.format == ObjectImage::ELF && dynamicCount != 0)
+            printf("dynamic 0\n");
+        total += dynamicCount;
+
+        ObjectImage::SymbolCursor cursor = {};
+        ObjectImage::Symbol symbols[13];
+        for (uint32_t n; (n = image.ReadSymbols(&cursor, symbols, 13)) != 0; total += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& symbol = symbols[i];
+                if (symbol.name != nullptr)
+                    sink += symbol.name[0];
+                if (print)
+                    printf("symbol %s %" PRIx64 " %" PRIx64 " %x %x\n",
+                           symbol.name != nullptr && symbol.name[0] != 0 ? symbol.name : "-", symbol.value,
+                           symbol.size, symbol.type, symbol.section);
+            }
+        }
+        return total;
+    }
+
+    size_t Walk(const uint8_t* data, uint64_t size, bool print)
+    {
+        ObjectImage image;
+        if (!image.Parse(data, size))
+            return 0;
+        if (image.GetInfo().format != ObjectImage::FAT_MACHO)
+            return PrintTables(image, print);
+
+        if (print)
+            printf("format 3\n");
+
+        ObjectImage::Slice slices[4];
+        std::vector<ObjectImage::Slice> all;
+        for (uint32_t n, start = 0; (n = image.ReadSlices(start, slices, 4)) != 0; start += n)
+            all.insert(all.end(), slices, slices + n);
+        for (auto& slice : all)
+            if (print)
+                printf("slice %x %x %" PRIx64 " %" PRIx64 "\n", slice.machine, slice.subMachine, slice.offset,
+                       slice.size);
+
+        size_t total = all.size();
+        for (uint32_t i = 0; i < all.size(); i++)
+        {
+            if (print)
+                printf("select %u\n", i);
+
+            ObjectImage thin;
+            if (thin.Parse(data, size) && thin.SelectSlice(i))
+                total += PrintTables(thin, print);
+        }
+        return total;
+    }
+
+    int Print(const char* path)
+    {
+        auto file = Harness::ReadFile(path);
+        return Walk(file.data(), file.size(), true) != 0 ? 0 : 1;
+    }
+
+    int Verify(const char* path)
+    {
+        ObjectImage image;
+        if (!image.Open(path))
+            return 1;
+
+        printf("header %u payload %u\n", image.GetInfo().headerValid, image.VerifyPayload() ? 1u : 0u);
+        return 0;
+    }
+
+    int Bench(const char* path)
+    {
+        for (int run = 0; run < 3; run++)
+        {
+            Harness::Stopwatch stopwatch;
+            ObjectImage image;
+            if (!image.Open(path))
+                return 1;
+
+            auto open = stopwatch.Milliseconds();
+            auto entries = PrintTables(image, false);
+            auto walk = stopwatch.Milliseconds() - open;
+
+            printf("open %.0f us, %zu entries in %.1f ms\n", open * 1000, entries, walk);
+        }
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        // the file header and the first load commands or section headers carry the offsets
+        Harness::Mutator mutate;
+        mutate.hotBytes = 512;
+        auto files = Harness::ReadFiles(paths, count, 64);
+        auto result = Harness::Fuzz(files, iterations, seed, mutate,
+                                    [](const std::vector<uint8_t>& buffer)
+                                    {
+                                        return Walk(buffer.data(), buffer.size(), false) != 0;
+                                    });
+
+        // the big-endian mutations matter for the fat header and for big-endian images
+        mutate.bigEndian = true;
+        return result | Harness::Fuzz(files, iterations / 2, seed + 1, mutate,
+                                      [](const std::vector<uint8_t>& buffer)
+                                      {
+                                          return Walk(buffer.data(), buffer.size(), false) != 0;
+                                      });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "print" && argc == 3)
+        return Print(argv[2]);
+    if (mode == "verify" && argc == 3)
+        return Verify(argv[2]);
+    if (mode == "bench" && argc == 3)
+        return Bench(argv[2]);
+    if (mode == "fuzz" && argc >= 5)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+
+    fprintf(stderr,
+            "usage: objectimage_check print <file> | verify <file> | bench <file> | fuzz <seed> <count> <file>...\n");
+    return 2;
+}
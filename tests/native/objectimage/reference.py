@@ -0,0 +1,154 @@
+# Reference for objectimage_check print: reads ELF files through llvm-readobj and Mach-O files,
+# thin or fat, through llvm-objdump (header, load commands and sections) and llvm-readobj
+# (symbols), and prints them in the same format. File offsets within a fat slice are made
+# absolute, as ObjectImage reports them.
+import re
+import subprocess
+import sys
+
+path = sys.argv[1]
+
+# the load commands llvm-objdump prints by name, from mach-o/loader.h
+LOAD_COMMANDS = dict(
+    LC_SEGMENT=0x1, LC_SYMTAB=0x2, LC_SYMSEG=0x3, LC_THREAD=0x4, LC_UNIXTHREAD=0x5, LC_LOADFVMLIB=0x6,
+    LC_IDFVMLIB=0x7, LC_IDENT=0x8, LC_FVMFILE=0x9, LC_PREPAGE=0xa, LC_DYSYMTAB=0xb, LC_LOAD_DYLIB=0xc,
+    LC_ID_DYLIB=0xd, LC_LOAD_DYLINKER=0xe, LC_ID_DYLINKER=0xf, LC_PREBOUND_DYLIB=0x10, LC_ROUTINES=0x11,
+    LC_SUB_FRAMEWORK=0x12, LC_SUB_UMBRELLA=0x13, LC_SUB_CLIENT=0x14, LC_SUB_LIBRARY=0x15, LC_TWOLEVEL_HINTS=0x16,
+    LC_PREBIND_CKSUM=0x17, LC_LOAD_WEAK_DYLIB=0x80000018, LC_SEGMENT_64=0x19, LC_ROUTINES_64=0x1a, LC_UUID=0x1b,
+    LC_RPATH=0x8000001c, LC_CODE_SIGNATURE=0x1d, LC_SEGMENT_SPLIT_INFO=0x1e, LC_REEXPORT_DYLIB=0x8000001f,
+    LC_LAZY_LOAD_DYLIB=0x20, LC_ENCRYPTION_INFO=0x21, LC_DYLD_INFO=0x22, LC_DYLD_INFO_ONLY=0x80000022,
+    LC_LOAD_UPWARD_DYLIB=0x80000023, LC_VERSION_MIN_MACOSX=0x24, LC_VERSION_MIN_IPHONEOS=0x25,
+    LC_FUNCTION_STARTS=0x26, LC_DYLD_ENVIRONMENT=0x27, LC_MAIN=0x80000028, LC_DATA_IN_CODE=0x29,
+    LC_SOURCE_VERSION=0x2a, LC_DYLIB_CODE_SIGN_DRS=0x2b, LC_ENCRYPTION_INFO_64=0x2c, LC_LINKER_OPTION=0x2d,
+    LC_LINKER_OPTIMIZATION_HINT=0x2e, LC_VERSION_MIN_TVOS=0x2f, LC_VERSION_MIN_WATCHOS=0x30, LC_NOTE=0x31,
+    LC_BUILD_VERSION=0x32, LC_DYLD_EXPORTS_TRIE=0x80000033, LC_DYLD_CHAINED_FIXUPS=0x80000034,
+    LC_FILESET_ENTRY=0x80000035)
+
+
+def run(*args):
+    return subprocess.run(args, check=True, capture_output=True).stdout.decode('utf-8', 'replace')
+
+
+def fields(block):
+    return dict(re.findall(r'^\s*([\w/]+): (.*)$', block, re.M))
+
+
+def raw(value):
+    # "SharedObject (0x3)" or "0x1F68" or "8832"
+    match = re.search(r'\((0x[0-9A-Fa-f]+)\)\s*$', value)
+    return int(match.group(1) if match else value.split()[0], 0)
+
+
+def blocks(text, name):
+    return re.findall(r'^( *)%s \{\n(.*?)^\1\}' % name, text, re.M | re.S)
+
+
+def name_or_dash(value):
+    name = re.sub(r' \(\d+\)$', '', value)
+    return name if name else '-'
+
+
+def elf():
+    text = run('llvm-readobj', '--file-headers', '--program-headers', '--sections', '--symbols', '--dyn-syms',
+               '--dynamic-table', path)
+    header = fields(text[text.index('ElfHeader {'):text.index('ProgramHeaders [')])
+    print('format 1 machine %x type %x entry %x os %x' % (raw(header['Machine']), raw(header['Type']),
+                                                           int(header['Entry'], 0), raw(header['OS/ABI'])))
+    for _, block in blocks(text, 'ProgramHeader'):
+        f = fields(block)
+        flags = int(re.search(r'Flags \[ \((0x\w+)\)', block).group(1), 0)
+        print('program %x %x %x %x %x %x' % (raw(f['Type']), flags, int(f['Offset'], 0), int(f['VirtualAddress'], 0),
+                                             int(f['FileSize']), int(f['MemSize'])))
+
+    sections = []
+    for _, block in blocks(text, 'Section'):
+        f = fields(block)
+        flags = int(re.search(r'Flags \[ \((0x\w+)\)', block).group(1), 0)
+        sections.append(raw(f['Type']))
+        print('section %s %x %x %x %x %x' % (name_or_dash(f['Name']), raw(f['Type']), flags, int(f['Address'], 0),
+                                             int(f['Offset'], 0), int(f['Size'])))
+
+    for line in re.findall(r'^  0x([0-9A-F]+) \S+ +(.*)$', text[text.find('DynamicSection'):], re.M):
+        tag, value = int(line[0], 16), line[1]
+        string = re.match(r'(?:Shared library|Library soname|Library rpath|Library runpath): \[(.*)\]$', value)
+        print('dynamic %x%s' % (tag, ' ' + string.group(1) if string else ''))
+        if tag == 0:
+            break
+
+    # the tables come in section order; version suffixes are llvm-readobj's, not part of the name
+    tables = {'Symbols [': 2, 'DynamicSymbols [': 11}
+    found = sorted((sections.index(kind), text.index(title)) for title, kind in tables.items()
+                   if kind in sections and title in text)
+    for _, start in found:
+        dynamic = text.startswith('DynamicSymbols', start)
+        part = text[start:text.index('\n]', start)]
+        for index, (_, block) in enumerate(blocks(part, 'Symbol')):
+            if index == 0:
+                continue
+            f = fields(block)
+            name = name_or_dash(f['Name'])
+            if dynamic and name != '-':
+                name = name.split('@')[0] or '-'
+            info = raw(f['Binding']) << 4 | raw(f['Type'])
+            print('symbol %s %x %x %x %x' % (name, int(f['Value'], 0), int(f['Size']), info, raw(f['Section'])))
+
+
+def thin(text, symbols, base):
+    header = re.search(r'^\s*(0x\w+)\s+(\d+)\s+(\d+)\s+(0x\w+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(0x\w+)', text, re.M)
+    magic, cpu, subtype, caps, filetype, _, _, flags = header.groups()
+    is64 = int(magic, 0) in (0xfeedfacf, 0xcffaedfe)
+    print('format 2 machine %x sub %x type %x flags %x' % (int(cpu), int(subtype) | int(caps, 0) << 24,
+                                                             int(filetype), int(flags, 0)))
+    offset = base + (32 if is64 else 28)
+    sections = []
+    for command in re.split(r'^Load command \d+\n', text, flags=re.M)[1:]:
+        f = dict(re.findall(r'^\s*(\w+) (.*)$', command.split('Section\n')[0], re.M))
+        kind = LOAD_COMMANDS.get(f['cmd'], None) or int(f['cmd'].strip('?()'), 0)
+        if kind in (0x1, 0x19):
+            print('program %x %x %x %x %x %x %s' % (kind, int(f['initprot'], 0), base + int(f['fileoff']),
+                                                    int(f['vmaddr'], 0), int(f['filesize']), int(f['vmsize'], 0),
+                                                    f['segname']))
+            for section in command.split('Section\n')[1:]:
+                s = dict(re.findall(r'^\s*(\w+) (.*)$', section, re.M))
+                section_offset = int(s['offset'])
+                sections.append(s)
+                print('section %s,%s %x %x %x %x %x' % (s['segname'], s['sectname'], int(s['flags'], 0) & 0xff,
+                                                        int(s['flags'], 0), int(s['addr'], 0),
+                                                        base + section_offset if section_offset else 0,
+                                                        int(s['size'], 0)))
+        else:
+            print('program %x 0 %x 0 %x 0' % (kind, offset, int(f['cmdsize'])))
+        offset += int(f['cmdsize'])
+
+    for _, block in blocks(symbols, 'Symbol'):
+        f = fields(block)
+        kind = raw(f['Type']) | (0x10 if re.search(r'^\s*PrivateExtern$', block, re.M) else 0) \
+            | (0x1 if re.search(r'^\s*Extern$', block, re.M) else 0)
+        print('symbol %s %x 0 %x %x' % (name_or_dash(f['Name']), int(f['Value'], 0), kind, raw(f['Section'])))
+
+
+def macho():
+    headers = run('llvm-objdump', '--macho', '--private-headers', '--non-verbose', '--arch=all', path)
+    symbols = run('llvm-readobj', '--symbols', path)
+    universal = run('llvm-objdump', '--macho', '--universal-headers', '--non-verbose', path)
+    slices = [dict(re.findall(r'^\s*(\w+) (\S+)', block, re.M))
+              for block in re.split(r'^architecture .*\n', universal, flags=re.M)[1:]]
+    per_arch = re.split(r'^\S.*:\n(?=Mach header)', headers, flags=re.M)[1:] or [headers]
+    per_symbols = [part for part in symbols.split('File: ') if part.strip()]
+    if not slices:
+        thin(per_arch[0], per_symbols[0], 0)
+        return
+
+    print('format 3')
+    for s in slices:
+        print('slice %x %x %x %x' % (int(s['cputype']), int(s['cpusubtype']) | int(s['capabilities'], 0) << 24,
+                                     int(s['offset']), int(s['size'])))
+    for index, s in enumerate(slices):
+        print('select %d' % index)
+        thin(per_arch[index], per_symbols[index], int(s['offset']))
+
+
+if open(path, 'rb').read(4) == b'\x7fELF':
+    elf()
+else:
+    macho()
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Checks ObjectImage on generated ELF and Mach-O images and on the shared objects the system has
+# (OBJECT_FILES, by default ten from /usr/lib/x86_64-linux-gnu): the header, program headers,
+# sections, dynamic entries and symbols of every image, and of every slice of a fat file, must match
+# what reference.py reads from llvm-readobj and llvm-objdump. The uImage header and payload checksums
+# are checked on good and damaged images, and mutations must not trip the sanitizers. BENCH=1 also
+# times the largest shared object in /usr/lib/x86_64-linux-gnu, or BENCH_FILE. Needs python3,
+# llvm-readobj and llvm-objdump.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/objectimage_check.cpp $native/ObjectImage.cpp $native/MappedFile.cpp"
+build objectimage_check $sources
+
+python3 "$here/make_elf.py" "$out/little64.so" 64 little 200
+python3 "$here/make_elf.py" "$out/big32.so" 32 big 200 10 2
+python3 "$here/make_elf.py" "$out/extended.so" 64 little 50 65300 3
+python3 "$here/make_macho.py" "$out/thin" 100 x86_64
+python3 "$here/make_macho.py" "$out/fat" 40 i386 x86_64 ppc arm64 --seed 4
+python3 "$here/make_macho.py" "$out/fat64" 40 x86_64 arm64 --fat64 --seed 5
+generated="$out/little64.so $out/big32.so $out/extended.so $out/thin $out/fat $out/fat64"
+found=$(find /usr/lib/x86_64-linux-gnu -maxdepth 1 -type f -name 'lib*.so*' 2>/dev/null | sort | head -n 10)
+for image in $generated ${OBJECT_FILES-$found}; do
+    python3 "$here/reference.py" "$image" > "$out/image.ref"
+    "$out/objectimage_check" print "$image" > "$out/image.out"
+    same "$out/image.ref" "$out/image.out"
+    echo "$(basename "$image"): $(wc -l < "$out/image.ref") entries match"
+done
+
+for damage in good header payload truncated; do
+    python3 "$here/make_uimage.py" "$out/uimage" 100000 $damage
+    "$out/objectimage_check" verify "$out/uimage" > "$out/uimage.out"
+    case $damage in
+        good) echo "header 1 payload 1" > "$out/uimage.ref" ;;
+        header) echo "header 0 payload 1" > "$out/uimage.ref" ;;
+        *) echo "header 1 payload 0" > "$out/uimage.ref" ;;
+    esac
+    same "$out/uimage.ref" "$out/uimage.out"
+    echo "uimage ($damage): $(cat "$out/uimage.out")"
+done
+
+python3 "$here/make_uimage.py" "$out/uimage" 4096 good
+"$out/objectimage_check" fuzz 7 "$(iterations 20000)" $out/little64.so $out/big32.so $out/thin $out/fat \
+    $out/fat64 "$out/uimage"
+
+if bench; then
+    build_bench objectimage_bench $sources
+    "$out/objectimage_bench" bench "${BENCH_FILE:-$(ls -S /usr/lib/x86_64-linux-gnu/lib*.so* | head -n 1)}"
+fi
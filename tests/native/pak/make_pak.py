@@ -0,0 +1,69 @@
+# Writes a synthetic Chromium resource pack:
+#
+#   make_pak.py <out.pak> <version 4|5> <resources> [seed]
+#
+# The resources are a random mix of raw bytes, gzip streams and brotli streams in Chromium's
+# framing (0x1E 0x9B and the decoded size in 6 bytes). Version 5 packs also get a few aliases.
+import ctypes
+import gzip
+import random
+import struct
+import sys
+
+encoder = ctypes.CDLL('libbrotlienc.so.1')
+encoder.BrotliEncoderCompress.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_size_t, ctypes.c_char_p,
+                                          ctypes.POINTER(ctypes.c_size_t), ctypes.c_char_p]
+
+
+def brotli(data):
+    size = ctypes.c_size_t(len(data) + 1024)
+    out = ctypes.create_string_buffer(size.value)
+    assert encoder.BrotliEncoderCompress(5, 22, 0, len(data), data, ctypes.byref(size), out) == 1
+    return b'\x1e\x9b' + len(data).to_bytes(6, 'little') + out.raw[:size.value]
+
+
+def payload(rnd):
+    kind = rnd.choice(['text', 'binary', 'empty'])
+    if kind == 'text':
+        return ''.join(rnd.choice(['<div>', 'chrome', ' ', 'résumé', '\n', '{}']) for _ in range(rnd.randint(1, 400))).encode()
+    if kind == 'binary':
+        return bytes(rnd.randrange(256) for _ in range(rnd.randint(1, 300)))
+    return b''
+
+
+def write(path, version, count, seed):
+    rnd = random.Random(seed)
+    ids = sorted(rnd.sample(range(1, 65535), count + count // 8))
+    resources, aliases = ids[:count], []
+    if version == 5:
+        aliases = [(id, rnd.randrange(count)) for id in ids[count:]]
+
+    blobs = []
+    for _ in resources:
+        data = payload(rnd)
+        packing = rnd.randrange(3)
+        if packing == 1 and data:
+            data = gzip.compress(data, mtime=0)
+        elif packing == 2 and data:
+            data = brotli(data)
+        blobs.append(data)
+
+    if version == 4:
+        header = struct.pack('<IIB', 4, count, 1)
+    else:
+        header = struct.pack('<IB3xHH', 5, 1, count, len(aliases))
+    offset = len(header) + (count + 1) * 6 + len(aliases) * 4
+
+    table = b''
+    for id, blob in zip(resources, blobs):
+        table += struct.pack('<HI', id, offset)
+        offset += len(blob)
+    table += struct.pack('<HI', 0, offset)
+    table += b''.join(struct.pack('<HH', id, index) for id, index in aliases)
+
+    with open(path, 'wb') as out:
+        out.write(header + table + b''.join(blobs))
+
+
+if __name__ == '__main__':
+    write(sys.argv[1], int(sys.argv[2]), int(sys.argv[3]), int(sys.argv[4]) if len(sys.argv) > 4 else 1)
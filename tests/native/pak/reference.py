@@ -0,0 +1,48 @@
+# Reference reader for Chromium resource packs. Unlike PakFile it decodes every compressed resource,
+# to prove that the sizes it reports are right. Prints one line per resource in the format of
+# pak_check list.
+import ctypes
+import struct
+import sys
+import zlib
+
+decoder = ctypes.CDLL('libbrotlidec.so.1')
+decoder.BrotliDecoderDecompress.argtypes = [ctypes.c_size_t, ctypes.c_char_p, ctypes.POINTER(ctypes.c_size_t),
+                                            ctypes.c_char_p]
+
+
+def brotli(data, size):
+    out = ctypes.create_string_buffer(max(size, 1))
+    length = ctypes.c_size_t(size)
+    assert decoder.BrotliDecoderDecompress(len(data), data, ctypes.byref(length), out) == 1
+    return out.raw[:length.value]
+
+
+def read(path):
+    data = open(path, 'rb').read()
+    version, = struct.unpack_from('<I', data, 0)
+    if version == 4:
+        count, _ = struct.unpack_from('<IB', data, 4)
+        table = 9
+    else:
+        _, count, _ = struct.unpack_from('<BxxxHH', data, 4)
+        table = 12
+
+    for i in range(count):
+        id, start = struct.unpack_from('<HI', data, table + i * 6)
+        _, end = struct.unpack_from('<HI', data, table + i * 6 + 6)
+        resource = data[start:end]
+        if len(resource) >= 18 and resource[:3] == b'\x1f\x8b\x08':
+            compression, payload, size = 1, resource, len(zlib.decompress(resource, 31))
+        elif len(resource) >= 8 and resource[:2] == b'\x1e\x9b':
+            compression, payload = 2, resource[8:]
+            size = int.from_bytes(resource[2:8], 'little')
+            assert len(brotli(payload, size)) == size
+        else:
+            compression, payload, size = 0, resource, len(resource)
+        yield '%d %d %d %d %02x' % (id, compression, len(payload), size, payload[0] if payload else 0)
+
+
+if __name__ == '__main__':
+    for line in read(sys.argv[1]):
+        print(line)
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Checks PakFile on generated version 4 and 5 packs: the resources, compression and sizes must
+# match reference.py, which decodes every payload, and mutations of the packs must not trip the
+# sanitizers. BENCH=1 also times listing a pack of 50000 resources. Needs python3 and libbrotli.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/pak_check.cpp $native/PakFile.cpp $native/MappedFile.cpp"
+build pak_check $sources
+
+python3 "$here/make_pak.py" "$out/v4.pak" 4 300 1
+python3 "$here/make_pak.py" "$out/v5.pak" 5 300 2
+python3 "$here/make_pak.py" "$out/tiny.pak" 5 2 3
+for pak in v4 v5 tiny; do
+    python3 "$here/reference.py" "$out/$pak.pak" > "$out/$pak.ref"
+    "$out/pak_check" list "$out/$pak.pak" > "$out/$pak.out"
+    same "$out/$pak.ref" "$out/$pak.out"
+done
+echo "listings match"
+
+"$out/pak_check" fuzz 1 "$(iterations 100000)" "$out/v4.pak" "$out/v5.pak" "$out/tiny.pak"
+
+if bench; then
+    build_bench pak_bench $sources
+    python3 "$here/make_pak.py" "$out/large.pak" 5 50000 4
+    "$out/pak_bench" list "$out/large.pak" > /dev/null
+fi
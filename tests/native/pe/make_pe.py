@@ -0,0 +1,209 @@
+# Writes a synthetic PE image with imports, exports and resources:
+#
+#   make_pe.py <out> <32|64> <imports> <exports> <resources> [seed]
+#
+# The imports are spread over several modules and mix names and ordinals. The exports mix named
+# functions, functions with only an ordinal, forwarders and unused slots. The resource tree has
+# the usual three levels with both named and numbered entries. Everything sits in a .rdata and a
+# .rsrc section after a small .text, laid out the way link.exe does it.
+import random
+import struct
+import sys
+
+FILE_ALIGNMENT = 0x200
+SECTION_ALIGNMENT = 0x1000
+HEADERS_SIZE = 0x400
+
+out, bits, import_count, export_count, resource_count = sys.argv[1], int(sys.argv[2]), *map(int, sys.argv[3:6])
+rnd = random.Random(int(sys.argv[6]) if len(sys.argv) > 6 else 1)
+thunk = 8 if bits == 64 else 4
+
+
+def align(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def identifier(prefix, i):
+    return '%s%s%d' % (prefix, rnd.choice(['', 'Ex', 'W', 'A', '_internal', '_v2']), i)
+
+
+class Blob:
+    def __init__(self, rva):
+        self.rva = rva
+        self.data = bytearray()
+
+    def here(self):
+        return self.rva + len(self.data)
+
+    def add(self, data, alignment=1):
+        while len(self.data) % alignment:
+            self.data += b'\0'
+        at = self.here()
+        self.data += data
+        return at
+
+    def patch(self, rva, data):
+        self.data[rva - self.rva:rva - self.rva + len(data)] = data
+
+
+def imports(blob):
+    modules = ['KERNEL32.dll', 'USER32.dll', 'ntdll.dll', 'msvcrt.dll', 'api-ms-win-core-synch-l1-2-0.dll',
+               'a' * 100 + '.dll']
+    groups = {}
+    for i in range(import_count):
+        module = rnd.choice(modules)
+        groups.setdefault(module, []).append(('#', rnd.randrange(1, 65536)) if rnd.random() < 0.2
+                                             else (identifier('Import', i), rnd.randrange(65536)))
+
+    descriptors = blob.add(bytes(20 * (len(groups) + 1)), 4)
+    for n, (module, symbols) in enumerate(groups.items()):
+        name = blob.add(module.encode() + b'\0', 2)
+        hints = []
+        for symbol, value in symbols:
+            hints.append(None if symbol == '#' else blob.add(struct.pack('<H', value) + symbol.encode() + b'\0', 2))
+
+        def table():
+            values = []
+            for (symbol, value), hint in zip(symbols, hints):
+                values.append(value | 1 << (bits - 1) if symbol == '#' else hint)
+            return blob.add(b''.join(struct.pack('<Q' if bits == 64 else '<I', v) for v in values + [0]), thunk)
+
+        # half of the modules look bound: the address table no longer holds the names
+        lookup = table()
+        address = table()
+        if n % 2:
+            blob.patch(address, bytes(thunk * len(symbols)).replace(b'\0', b'\xcc'))
+        blob.patch(descriptors + 20 * n, struct.pack('<IIIII', lookup, 0, 0, name, address))
+    return descriptors, 20 * (len(groups) + 1)
+
+
+def exports(blob):
+    if export_count == 0:
+        return 0, 0
+    slots = export_count + export_count // 8
+    base = rnd.randrange(1, 100)
+    names = sorted({identifier('Export', i): i for i in range(export_count) if rnd.random() < 0.75}.items())
+    named = rnd.sample(range(slots), len(names))
+
+    directory = blob.add(bytes(40), 4)
+    module = blob.add(b'synthetic.dll\0')
+    functions = blob.add(bytes(4 * slots), 4)
+    name_table = blob.add(bytes(4 * len(names)), 4)
+    ordinal_table = blob.add(bytes(2 * len(names)), 2)
+    for i, (name, _) in enumerate(names):
+        blob.patch(name_table + 4 * i, struct.pack('<I', blob.add(name.encode() + b'\0')))
+        blob.patch(ordinal_table + 2 * i, struct.pack('<H', named[i]))
+
+    # unused slots stay 0; forwarders point at a string inside the export directory
+    forwarders = []
+    for slot in range(slots):
+        if slot not in named and rnd.random() < 0.1:
+            continue
+        forwarders.append(slot) if rnd.random() < 0.1 else \
+            blob.patch(functions + 4 * slot, struct.pack('<I', 0x1000 + rnd.randrange(0x200)))
+    for slot in forwarders:
+        target = blob.add(('OTHER.%s\0' % identifier('Forward', slot)).encode())
+        blob.patch(functions + 4 * slot, struct.pack('<I', target))
+
+    size = blob.here() - directory
+    blob.patch(directory, struct.pack('<IIHHIIIIIII', 0, 0, 0, 0, module, base, slots, len(names), functions,
+                                      name_table, ordinal_table))
+    return directory, size
+
+
+def resources(blob):
+    # type -> name -> language -> data
+    tree = {}
+    for i in range(resource_count):
+        kind = rnd.choice([3, 14, 16, 24, 'MUI', 'TYPELIB', 'Ünïcode'])
+        name = rnd.choice([rnd.randrange(1, 200), 'NAME%d' % rnd.randrange(50), 'ICON'])
+        language = rnd.choice([0, 1033, 1031, 2052])
+        tree.setdefault(kind, {}).setdefault(name, {})[language] = bytes(rnd.randrange(256)
+                                                                        for _ in range(rnd.randrange(1, 64)))
+
+    def order(entries):
+        # named entries first, by name, then the numbered ones by id
+        return sorted(entries.items(), key=lambda item: (0, str(item[0])) if isinstance(item[0], str) else (1, item[0]))
+
+    # directories first, then the strings and data entries, then the data, like cvtres
+    def size_of(node, depth):
+        own = 16 + 8 * len(node)
+        return own if depth == 2 else own + sum(size_of(child, depth + 1) for child in node.values())
+
+    tables = bytearray(size_of(tree, 0))
+    strings = Blob(blob.rva + len(tables))
+    entries = []
+
+    def write(node, depth, offset):
+        items = order(node)
+        named = sum(isinstance(key, str) for key, _ in items)
+        tables[offset:offset + 16] = struct.pack('<IIHHHH', 0, 0, 4, 0, named, len(items) - named)
+        next_offset = offset + 16 + 8 * len(items)
+        for i, (key, child) in enumerate(items):
+            entry = offset + 16 + 8 * i
+            if isinstance(key, str):
+                encoded = key.encode('utf-16-le')
+                at = strings.add(struct.pack('<H', len(encoded) // 2) + encoded, 2) - blob.rva
+                key_field = 0x80000000 | at
+            else:
+                key_field = key
+            if depth == 2:
+                entries.append((entry, child))
+                tables[entry:entry + 8] = struct.pack('<II', key_field, 0)
+            else:
+                tables[entry:entry + 8] = struct.pack('<II', key_field, 0x80000000 | next_offset)
+                next_offset = write(child, depth + 1, next_offset)
+        return next_offset
+
+    write(tree, 0, 0)
+    blob.add(bytes(tables))
+    blob.add(bytes(strings.data))
+    leaves = []
+    for entry, data in entries:
+        leaves.append(blob.add(bytes(16), 4))
+        blob.patch(blob.rva + entry + 4, struct.pack('<I', leaves[-1] - blob.rva))
+    for leaf, (entry, data) in zip(leaves, entries):
+        blob.patch(leaf, struct.pack('<IIII', blob.add(data, 8), len(data), rnd.choice([0, 1252, 65001]), 0))
+    return (blob.rva, len(blob.data)) if entries else (0, 0)
+
+
+text = Blob(0x1000)
+text.add(b'\xc3' * 0x100)
+rdata = Blob(align(text.here(), SECTION_ALIGNMENT))
+import_directory = imports(rdata)
+export_directory = exports(rdata)
+rsrc = Blob(align(rdata.here(), SECTION_ALIGNMENT))
+resource_directory = resources(rsrc)
+
+sections = [(b'.text', text, 0x60000020), (b'.rdata', rdata, 0x40000040), (b'.rsrc', rsrc, 0x40000040)]
+section_table = b''
+raw = HEADERS_SIZE
+for name, blob, characteristics in sections:
+    size = align(len(blob.data), FILE_ALIGNMENT)
+    section_table += struct.pack('<8sIIIIIIHHI', name, len(blob.data), blob.rva, size, raw, 0, 0, 0, 0,
+                                 characteristics)
+    raw += size
+
+directories = [export_directory, import_directory, resource_directory] + [(0, 0)] * 13
+image_size = align(rsrc.here(), SECTION_ALIGNMENT)
+if bits == 64:
+    optional = struct.pack('<HBBIIIIIQIIHHHHHHIIIIHHQQQQII', 0x20b, 14, 0, 0x200, 0, 0, 0x1000, 0x1000,
+                           0x180000000, SECTION_ALIGNMENT, FILE_ALIGNMENT, 6, 0, 0, 0, 6, 0, 0, image_size,
+                           HEADERS_SIZE, 0, 2, 0x8160, 0x100000, 0x1000, 0x100000, 0x1000, 0, 16)
+else:
+    optional = struct.pack('<HBBIIIIIIIIIHHHHHHIIIIHHIIIIII', 0x10b, 14, 0, 0x200, 0, 0, 0x1000, 0x1000, 0x2000,
+                           0x10000000, SECTION_ALIGNMENT, FILE_ALIGNMENT, 6, 0, 0, 0, 6, 0, 0, image_size,
+                           HEADERS_SIZE, 0, 2, 0x8140, 0x100000, 0x1000, 0x100000, 0x1000, 0, 16)
+optional += b''.join(struct.pack('<II', *d) for d in directories)
+
+header = bytearray(b'MZ' + bytes(58) + struct.pack('<I', 0x80))
+header += bytes(0x80 - len(header))
+header += b'PE\0\0' + struct.pack('<HHIIIHH', 0x8664 if bits == 64 else 0x14c, len(sections), 0, 0, 0,
+                                   len(optional), 0x2022 if export_count else 0x22)
+header += optional + section_table
+assert len(header) <= HEADERS_SIZE
+
+with open(out, 'wb') as f:
+    f.write(header + bytes(HEADERS_SIZE - len(header)))
+    for _, blob, _ in sections:
+        f.write(blob.data + bytes(align(len(blob.data), FILE_ALIGNMENT) - len(blob.data)))
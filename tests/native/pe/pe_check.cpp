@@ -0,0 +1,272 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks PeImage from the command line:
+//
+//   pe_check print <file>                    prints the headers, imports, exports and resources
+//   pe_check bench <file>                    times opening the image and each table walk
+//   pe_check fuzz <seed> <count> <file>...   walks count mutations of the files
+//
+// The print format matches reference.py, so that the two can be compared with diff.
+
+#include "PeImage.h"
+#include "harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    volatile uint8_t sink;
+
+    std::string Utf8(const uint16_t* text, uint32_t length)
+    {
+        std::string out;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            // resource names need not be aligned
+            uint16_t unit;
+            memcpy(&unit, text + i, 2);
+            uint32_t c = unit;
+            if (c >= 0xd800 && c < 0xdc00 && i + 1 < length)
+            {
+                uint16_t low;
+                memcpy(&low, text + i + 1, 2);
+                c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00u);
+                i++;
+            }
+
+            if (c < 0x80)
+            {
+                out += char(c);
+            }
+            else if (c < 0x800)
+            {
+                out += char(0xc0 | c >> 6);
+                out += char(0x80 | (c & 63));
+            }
+            else if (c < 0x10000)
+            {
+                out += char(0xe0 | c >> 12);
+                out += char(0x80 | (c >> 6 & 63));
+                out += char(0x80 | (c & 63));
+            }
+            else
+            {
+                out += char(0xf0 | c >> 18);
+                out += char(0x80 | (c >> 12 & 63));
+                out += char(0x80 | (c >> 6 & 63));
+                out += char(0x80 | (c & 63));
+            }
+        }
+        return out;
+    }
+
+    std::string Key(const PeImage::ResourceEntry& entry)
+    {
+        return entry.name != nullptr ? Utf8(entry.name, entry.nameLength) : "#" + std::to_string(entry.id);
+    }
+
+    uint32_t Fnv(const void* data, uint32_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (uint32_t i = 0; i < size; i++)
+            hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 16777619u;
+        return hash;
+    }
+
+    size_t WalkImports(const PeImage& image, bool print)
+    {
+        PeImage::ImportCursor cursor = {};
+        PeImage::ImportEntry entries[64];
+        size_t total = 0;
+        for (uint32_t n; (n = image.ReadImports(&cursor, entries, 64)) != 0; total += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& entry = entries[i];
+                if (!print)
+                {
+                    sink += entry.module != nullptr ? entry.module[0] : 0;
+                    sink += entry.name != nullptr ? entry.name[0] : 0;
+                }
+                else if (entry.name != nullptr)
+                {
+                    printf("import %s %s %u\n", entry.module ? entry.module : "?", entry.name, entry.ordinal);
+                }
+                else
+                {
+                    printf("import %s #%u\n", entry.module ? entry.module : "?", entry.ordinal);
+                }
+            }
+        }
+        return total;
+    }
+
+    size_t WalkExports(PeImage& image, bool print)
+    {
+        std::vector<PeImage::ExportEntry> all;
+        PeImage::ExportEntry entries[64];
+        uint32_t start = 0;
+        for (uint32_t n; (n = image.ReadExports(start, entries, 64)) != 0; start += n)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                sink += entries[i].name != nullptr ? entries[i].name[0] : 0;
+                sink += entries[i].forwarder != nullptr ? entries[i].forwarder[0] : 0;
+            }
+            if (print)
+                all.insert(all.end(), entries, entries + n);
+        }
+
+        // named exports come first; the reference lists them by ordinal
+        std::stable_sort(all.begin(), all.end(), [](auto& a, auto& b) { return a.ordinal < b.ordinal; });
+        for (auto& entry : all)
+        {
+            auto name = entry.name != nullptr ? entry.name : "-";
+            if (entry.forwarder != nullptr)
+                printf("export %u %s forward %s\n", entry.ordinal, name, entry.forwarder);
+            else
+                printf("export %u %s %x\n", entry.ordinal, name, entry.rva);
+        }
+        return start;
+    }
+
+    // Visits at most budget entries: three levels make a well-formed tree, but a broken one can
+    // point its directories back at themselves with up to 65535 * 2 entries each.
+    size_t WalkResources(const PeImage& image, uint32_t offset, const std::string& path, int depth, bool print,
+                         size_t& budget)
+    {
+        if (depth == 3)
+            return 0;
+
+        PeImage::ResourceEntry entries[16];
+        size_t total = 0;
+        for (uint32_t n, start = 0; budget != 0 && (n = image.ReadResources(offset, start, entries, 16)) != 0;
+             start += n, budget -= std::min<size_t>(budget, n))
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                auto& entry = entries[i];
+                auto key = path.empty() ? Key(entry) : path + "/" + Key(entry);
+                if (entry.isDirectory)
+                {
+                    total += WalkResources(image, entry.offset, key, depth + 1, print, budget);
+                    continue;
+                }
+
+                total++;
+                if (entry.data != nullptr && entry.dataSize != 0)
+                    sink += static_cast<const uint8_t*>(entry.data)[entry.dataSize - 1];
+                if (print)
+                    printf("resource %s %u %u %08x\n", key.c_str(), entry.dataSize, entry.codePage,
+                           entry.data != nullptr ? Fnv(entry.data, entry.dataSize) : 0);
+            }
+        }
+        return total;
+    }
+
+    int Print(const char* path)
+    {
+        PeImage image;
+        if (!image.Open(path))
+            return 1;
+
+        auto& headers = image.GetHeaders();
+        printf("machine %x magic %x sections %u\n", headers.fileHeader->machine, headers.optionalHeaderMagic,
+               headers.numberOfSections);
+        for (uint32_t i = 0; i < headers.numberOfSections; i++)
+        {
+            auto& section = headers.sections[i];
+            printf("section %.8s %x %x %x %x\n", reinterpret_cast<const char*>(section.name), section.virtualAddress,
+                   section.virtualSize, section.pointerToRawData, section.sizeOfRawData);
+        }
+
+        WalkImports(image, true);
+        WalkExports(image, true);
+        size_t budget = SIZE_MAX;
+        WalkResources(image, 0, "", 0, true, budget);
+        return 0;
+    }
+
+    int Bench(const char* path)
+    {
+        for (int run = 0; run < 3; run++)
+        {
+            Harness::Stopwatch stopwatch;
+            PeImage image;
+            if (!image.Open(path))
+                return 1;
+
+            auto open = stopwatch.Milliseconds();
+            auto imports = WalkImports(image, false);
+            auto importTime = stopwatch.Milliseconds() - open;
+            auto exports = WalkExports(image, false);
+            auto exportTime = stopwatch.Milliseconds() - open - importTime;
+            stopwatch.Restart();
+            size_t budget = SIZE_MAX;
+            auto resources = WalkResources(image, 0, "", 0, false, budget);
+
+            printf("open %.0f us, %zu imports in %.1f ms, %zu exports in %.1f ms, %zu resources in %.1f ms\n",
+                   open * 1000, imports, importTime, exports, exportTime, resources, stopwatch.Milliseconds());
+        }
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        // the headers and the section table are in the first kilobyte
+        Harness::Mutator mutate;
+        mutate.hotBytes = 1024;
+        return Harness::Fuzz(Harness::ReadFiles(paths, count, 64), iterations, seed, mutate,
+                             [](const std::vector<uint8_t>& buffer)
+                             {
+                                 PeImage image;
+                                 if (!image.Parse(buffer.data(), buffer.size()))
+                                     return false;
+
+                                 auto& headers = image.GetHeaders();
+                                 for (uint32_t i = 0; i < headers.numberOfSections; i++)
+                                     sink += headers.sections[i].name[7];
+                                 for (uint32_t i = 0; i < headers.numberOfDataDirectories; i++)
+                                     sink += static_cast<uint8_t>(headers.dataDirectories[i].size);
+
+                                 WalkImports(image, false);
+                                 WalkExports(image, false);
+                                 size_t budget = 10000;
+                                 WalkResources(image, 0, "", 0, false, budget);
+                                 return true;
+                             });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "print" && argc == 3)
+        return Print(argv[2]);
+    if (mode == "bench" && argc == 3)
+        return Bench(argv[2]);
+    if (mode == "fuzz" && argc >= 5)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+
+    fprintf(stderr, "usage: pe_check print <file> | bench <file> | fuzz <seed> <count> <file>...\n");
+    return 2;
+}
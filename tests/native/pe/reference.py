@@ -0,0 +1,81 @@
+# Reference for pe_check print: reads the headers, imports, exports and resources from
+# llvm-readobj's output and prints them in the same format. Forwarder strings and resource data
+# are read from the file through llvm-readobj's section table.
+import re
+import subprocess
+import sys
+
+path = sys.argv[1]
+data = open(path, 'rb').read()
+text = subprocess.run(['llvm-readobj', '--file-headers', '--sections', '--coff-imports', '--coff-exports',
+                       '--coff-resources', path], check=True, capture_output=True).stdout.decode('utf-8', 'replace')
+
+
+def fields(block):
+    return dict(re.findall(r'^\s*(\w+): (.*)$', block, re.M))
+
+
+header = fields(text[:text.index('DOSHeader {')])
+sections = [fields(block) for block in re.findall(r'^  Section \{\n(.*?)^  \}', text, re.M | re.S)]
+
+
+def offset(rva):
+    for section in sections:
+        start = int(section['VirtualAddress'], 16)
+        if start <= rva < start + int(section['RawDataSize']):
+            return int(section['PointerToRawData'], 16) + rva - start
+    return rva
+
+
+def string(rva):
+    start = offset(rva)
+    return data[start:data.index(b'\0', start)].decode()
+
+
+def fnv(blob):
+    value = 2166136261
+    for byte in blob:
+        value = (value ^ byte) * 16777619 & 0xffffffff
+    return value
+
+
+print('machine %x magic %x sections %d' % (int(re.search(r'\(0x(\w+)\)', header['Machine']).group(1), 16),
+                                           int(header['Magic'], 16), len(sections)))
+for section in sections:
+    print('section %s %x %x %x %x' % (section['Name'].split()[0], int(section['VirtualAddress'], 16),
+                                      int(section['VirtualSize'], 16), int(section['PointerToRawData'], 16),
+                                      int(section['RawDataSize'])))
+
+for block in re.findall(r'^Import \{\n(.*?)^\}', text, re.M | re.S):
+    module = fields(block)['Name']
+    for name, ordinal in re.findall(r'^  Symbol: (.*) \((\d+)\)$', block, re.M):
+        print('import %s %s %s' % (module, name, ordinal) if name else 'import %s #%s' % (module, ordinal))
+
+exports = int(header['ExportTableRVA'], 16), int(header['ExportTableSize'], 16)
+for block in re.findall(r'^Export \{\n(.*?)^\}', text, re.M | re.S):
+    export = fields(block)
+    name = export.get('Name') or '-'
+    rva = int(export['RVA'], 16)
+    if rva == 0 and name == '-':
+        continue
+    if exports[0] <= rva < exports[0] + exports[1]:
+        print('export %s %s forward %s' % (export['Ordinal'], name, string(rva)))
+    else:
+        print('export %s %s %x' % (export['Ordinal'], name, rva))
+
+# the resource tree is indented two spaces per level; ids print as "(ID n)", names as they are
+path = []
+for line in text.splitlines():
+    match = re.match(r'^(\s*)(Type|Name|Language): (.*?) ?(?:\(ID (\d+)\))? \[$', line)
+    if match:
+        depth = {'Type': 0, 'Name': 1, 'Language': 2}[match.group(2)]
+        path[depth:] = ['#' + match.group(4) if match.group(4) else match.group(3)]
+        continue
+    match = re.match(r'^\s*(DataRVA|DataSize|Codepage): (\w+)$', line)
+    if match:
+        path.append(int(match.group(2), 0))
+        if match.group(1) == 'Codepage':
+            rva, size, codepage = path[3:6]
+            print('resource %s %d %d %08x' % ('/'.join(path[:3]), size, codepage,
+                                               fnv(data[offset(rva):offset(rva) + size])))
+            del path[3:]
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Checks PeImage on generated PE32 and PE32+ images and on whatever Windows binaries the system
+# has (PE_FILES, by default the first 20 found under /usr and pyenv): the headers, imports, exports and resources
+# must match what reference.py reads from llvm-readobj, and mutations must not trip the
+# sanitizers. BENCH=1 also times an image with 100k imports and 50k exports. Needs python3 and
+# llvm-readobj.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/pe_check.cpp $native/PeImage.cpp $native/MappedFile.cpp"
+build pe_check $sources
+
+python3 "$here/make_pe.py" "$out/small32.dll" 32 20 10 5
+python3 "$here/make_pe.py" "$out/small64.dll" 64 20 10 5 2
+python3 "$here/make_pe.py" "$out/medium32.dll" 32 2000 3000 300 3
+python3 "$here/make_pe.py" "$out/medium64.dll" 64 2000 3000 300 4
+generated="$out/small32.dll $out/small64.dll $out/medium32.dll $out/medium64.dll"
+found=
+candidates=$(find /usr/lib /usr/share "$HOME/.pyenv" -type f \( -name '*.exe' -o -name '*.dll' \) 2>/dev/null)
+for image in ${PE_FILES-$candidates}; do
+    if [ "$(head -c 2 "$image")" = MZ ] && [ "$(echo $found | wc -w)" -lt 20 ]; then
+        found="$found $image"
+    fi
+done
+for image in $generated $found; do
+    python3 "$here/reference.py" "$image" > "$out/image.ref"
+    "$out/pe_check" print "$image" > "$out/image.out"
+    same "$out/image.ref" "$out/image.out"
+    echo "$(basename "$image"): $(wc -l < "$out/image.ref") entries match"
+done
+
+"$out/pe_check" fuzz 7 "$(iterations 20000)" $generated $found
+
+if bench; then
+    build_bench pe_bench $sources
+    python3 "$here/make_pe.py" "$out/large.dll" 64 100000 50000 2000 5
+    "$out/pe_bench" bench "$out/large.dll"
+fi
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Checks TextEncoding: Detect at every SIMD level must agree with a strict reference decoder on
+# fuzzed text and on every short sequence of boundary bytes, truncated and not. The build includes
+# the NEON model from ../neon, so the NEON kernel runs next to the x86 ones. BENCH=1 also times
+# every level on BENCH_MB megabytes of ASCII and of UTF-8 text, 10 by default.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/textencoding_check.cpp $native/TextEncoding.cpp $native/Simd.cpp"
+neon="-DQL_SIMD_NEON -include $here/../neon/arm_neon.h"
+build textencoding_check $neon $sources
+
+"$out/textencoding_check" fuzz 1 "$(iterations 200000)"
+"$out/textencoding_check" corners
+
+if bench; then
+    build_bench textencoding_bench $neon $sources
+    "$out/textencoding_bench" bench "${BENCH_MB:-10}"
+fi
@@ -0,0 +1,446 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks TextEncoding::Detect from the command line:
+//
+//   textencoding_check fuzz <seed> <count>  random mixes of valid, broken and cut-off UTF-8
+//   textencoding_check corners              every byte sequence of up to four bytes from a set of
+//                                           boundary values, at offsets around the vector widths
+//   textencoding_check bench [MB]           MB/s of every level on ASCII and UTF-8 text, 10 MB by default
+//
+// Each input goes through every SIMD level this build runs, truncated and not, and must give what a
+// strict reference gives. The reference decodes code points and checks their values instead of
+// byte ranges, so it shares no tables with the scanners. run.sh builds with the NEON model in
+// tests/native/neon, so NEON is checked on x86 too.
+
+#include "TextEncoding.h"
+#include "harness.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const Simd::Level levels[] = {Simd::SCALAR, Simd::SSE2, Simd::AVX2, Simd::NEON};
+    volatile uint8_t sink;
+
+    // bytes in the sequence a lead byte starts, or 0 for a byte that starts none
+    size_t SequenceLength(uint8_t lead)
+    {
+        if (lead < 0x80)
+            return 1;
+        if (lead < 0xC0)
+            return 0;
+        if (lead < 0xE0)
+            return 2;
+        if (lead < 0xF0)
+            return 3;
+        return lead < 0xF8 ? 4 : 0;
+    }
+
+    // whether some code point from lowest to highest is a scalar value the sequence length may encode
+    bool AnyScalar(uint32_t lowest, uint32_t highest, size_t length)
+    {
+        static const uint32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (lowest < minimum[length])
+            lowest = minimum[length];
+        if (highest > 0x10FFFF)
+            highest = 0x10FFFF;
+        if (lowest > highest)
+            return false;
+        return lowest < 0xD800 || highest > 0xDFFF;
+    }
+
+    // Whether the available bytes at data start a well-formed sequence (complete is then set) or a
+    // prefix of one that the end of the buffer cuts off.
+    bool Decode(const uint8_t* data, size_t available, size_t* length, bool* complete)
+    {
+        *length = SequenceLength(data[0]);
+        if (*length == 0)
+            return false;
+
+        auto have = *length < available ? *length : available;
+        uint32_t value = *length == 1 ? data[0] : data[0] & (0x7F >> *length);
+        for (size_t i = 1; i < have; i++)
+        {
+            if ((data[i] & 0xC0) != 0x80)
+                return false;
+            value = value << 6 | (data[i] & 0x3F);
+        }
+
+        auto missing = 6 * static_cast<uint32_t>(*length - have);
+        *complete = have == *length;
+        return AnyScalar(value << missing, value << missing | ((1u << missing) - 1), *length);
+    }
+
+    TextEncoding::Kind ReferenceNullPattern(const uint8_t* data, size_t size)
+    {
+        auto sample = size < 4096 ? size : 4096;
+        size_t zeros[2] = {};
+        for (size_t i = 0; i + 1 < sample; i += 2)
+        {
+            zeros[0] += data[i] == 0;
+            zeros[1] += data[i + 1] == 0;
+        }
+
+        auto pairs = sample / 2;
+        if (pairs < 2)
+            return TextEncoding::UNKNOWN;
+        if (zeros[1] * 8 >= pairs && zeros[0] * 16 <= zeros[1])
+            return TextEncoding::UTF16LE;
+        if (zeros[0] * 8 >= pairs && zeros[1] * 16 <= zeros[0])
+            return TextEncoding::UTF16BE;
+        return TextEncoding::UNKNOWN;
+    }
+
+    TextEncoding::Kind Reference(const uint8_t* data, size_t size, bool truncated)
+    {
+        static const struct
+        {
+            const char* bytes;
+            size_t size;
+            TextEncoding::Kind kind;
+        } marks[] = {
+            {"\xFF\xFE\0\0", 4, TextEncoding::UTF32LE_BOM}, {"\0\0\xFE\xFF", 4, TextEncoding::UTF32BE_BOM},
+            {"\xEF\xBB\xBF", 3, TextEncoding::UTF8_BOM},    {"\xFF\xFE", 2, TextEncoding::UTF16LE_BOM},
+            {"\xFE\xFF", 2, TextEncoding::UTF16BE_BOM},
+        };
+
+        if (size == 0)
+            return TextEncoding::UNKNOWN;
+        for (auto& mark : marks)
+        {
+            if (size >= mark.size && memcmp(data, mark.bytes, mark.size) == 0)
+                return mark.kind;
+        }
+
+        auto multibyte = false;
+        auto zero = false;
+        size_t pos = 0;
+        while (pos < size)
+        {
+            size_t length;
+            bool complete;
+            if (!Decode(data + pos, size - pos, &length, &complete))
+                return ReferenceNullPattern(data, size);
+            if (!complete)
+            {
+                // only the sequence the end cuts off may be incomplete, and only when asked
+                if (!truncated)
+                    return ReferenceNullPattern(data, size);
+                if (pos == 0)
+                    return TextEncoding::UNKNOWN;
+                break;
+            }
+            zero |= data[pos] == 0;
+            multibyte |= length > 1;
+            pos += length;
+        }
+
+        if (zero)
+            return ReferenceNullPattern(data, size);
+        return multibyte ? TextEncoding::UTF8 : TextEncoding::ASCII;
+    }
+
+    // Runs the input through every level in both modes. The copy is exactly the size of the input,
+    // so that ASan catches a read past the end.
+    bool Check(const std::vector<uint8_t>& input)
+    {
+        std::vector<uint8_t> exact(input);
+        for (auto truncated : {false, true})
+        {
+            auto expected = Reference(exact.data(), exact.size(), truncated);
+            for (auto level : levels)
+            {
+                if (!Simd::Supports(level))
+                    continue;
+
+                auto kind = TextEncoding::Detect(exact.data(), exact.size(), truncated, level);
+                if (kind == expected)
+                    continue;
+
+                printf("level %u%s gives %u, not %u, for", level, truncated ? " truncated" : "", kind, expected);
+                for (auto byte : exact)
+                    printf(" %02X", byte);
+                printf("\n");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the NEON model makes NEON run here; a build without it would skip the level without a word
+    bool LevelsPresent()
+    {
+#ifdef QL_SIMD_NEON
+        if (!Simd::Supports(Simd::NEON))
+        {
+            printf("NEON is compiled in but not supported\n");
+            return false;
+        }
+#else
+        printf("built without NEON, only the x86 levels are checked\n");
+#endif
+        return true;
+    }
+
+    void AppendCodePoint(std::vector<uint8_t>& out, uint32_t value)
+    {
+        if (value < 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value));
+        }
+        else if (value < 0x800)
+        {
+            out.push_back(static_cast<uint8_t>(0xC0 | value >> 6));
+            out.push_back(static_cast<uint8_t>(0x80 | (value & 0x3F)));
+        }
+        else if (value < 0x10000)
+        {
+            out.push_back(static_cast<uint8_t>(0xE0 | value >> 12));
+            out.push_back(static_cast<uint8_t>(0x80 | (value >> 6 & 0x3F)));
+            out.push_back(static_cast<uint8_t>(0x80 | (value & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<uint8_t>(0xF0 | value >> 18));
+            out.push_back(static_cast<uint8_t>(0x80 | (value >> 12 & 0x3F)));
+            out.push_back(static_cast<uint8_t>(0x80 | (value >> 6 & 0x3F)));
+            out.push_back(static_cast<uint8_t>(0x80 | (value & 0x3F)));
+        }
+    }
+
+    // Text that is mostly valid: ASCII runs long enough to cross the 16, 32 and 64-byte blocks,
+    // characters of every length with the boundary values among them, and now and then an error,
+    // a zero byte or the start of a BOM.
+    std::vector<uint8_t> Generate(std::mt19937_64& rng)
+    {
+        static const uint32_t boundaries[] = {0x7F,   0x80,   0x7FF,   0x800,   0xD7FF,   0xE000,
+                                              0xFFFD, 0xFFFF, 0x10000, 0x10FFFF, 0xFEFF};
+        static const uint32_t ranges[] = {0x80, 0x800, 0xD800, 0x10000, 0x110000};
+
+        std::vector<uint8_t> out;
+        auto pieces = rng() % 40;
+        auto errors = rng() % 3 == 0 ? 1 + rng() % 3 : 0;
+        for (uint64_t piece = 0; piece < pieces; piece++)
+        {
+            switch (rng() % 8)
+            {
+            case 0:
+            case 1:
+                for (auto n = rng() % (rng() % 4 == 0 ? 130 : 10); n != 0; n--)
+                    out.push_back(static_cast<uint8_t>(0x20 + rng() % 0x5F));
+                break;
+            case 2:
+                AppendCodePoint(out, boundaries[rng() % (sizeof boundaries / sizeof boundaries[0])]);
+                break;
+            case 3:
+            case 4:
+            case 5:
+            {
+                auto value = static_cast<uint32_t>(rng() % ranges[rng() % 5]);
+                AppendCodePoint(out, value >= 0xD800 && value < 0xE000 ? value + 0x800 : value);
+                break;
+            }
+            default:
+                if (errors == 0)
+                    break;
+                errors--;
+                switch (rng() % 7)
+                {
+                case 0:
+                    out.push_back(static_cast<uint8_t>(0x80 + rng() % 0x80));
+                    break;
+                case 1:
+                    out.push_back(0);
+                    break;
+                case 2:
+                {
+                    // a sequence with a byte missing from the middle
+                    std::vector<uint8_t> character;
+                    AppendCodePoint(character, static_cast<uint32_t>(0x80 + rng() % 0x10FF80));
+                    character.erase(character.begin() + 1 + rng() % (character.size() - 1));
+                    out.insert(out.end(), character.begin(), character.end());
+                    break;
+                }
+                case 3:
+                {
+                    // surrogates, overlong forms and values past U+10FFFF
+                    static const uint8_t bad[][4] = {{0xED, 0xA0, 0x80}, {0xED, 0xBF, 0xBF}, {0xC0, 0xAF},
+                                                     {0xC1, 0xBF},       {0xE0, 0x9F, 0xBF}, {0xF0, 0x8F, 0xBF, 0xBF},
+                                                     {0xF4, 0x90, 0x80, 0x80}, {0xF5, 0x80, 0x80, 0x80}};
+                    auto& sequence = bad[rng() % 8];
+                    for (size_t i = 0; i < 4 && sequence[i] != 0; i++)
+                        out.push_back(sequence[i]);
+                    break;
+                }
+                case 4:
+                    out.push_back(static_cast<uint8_t>(0xF8 + rng() % 8));
+                    break;
+                default:
+                    if (!out.empty())
+                        out[rng() % out.size()] ^= static_cast<uint8_t>(1 << rng() % 8);
+                    break;
+                }
+                break;
+            }
+        }
+
+        if (rng() % 16 == 0)
+        {
+            static const uint8_t marks[] = {0xEF, 0xBB, 0xBF, 0xFF, 0xFE, 0x00, 0x00};
+            auto start = rng() % 5;
+            out.insert(out.begin(), marks + start, marks + start + 1 + rng() % 3);
+        }
+
+        // a head sampled from a longer file ends anywhere
+        if (rng() % 2 == 0 && !out.empty())
+            out.resize(rng() % (out.size() + 1));
+        return out;
+    }
+
+    int Fuzz(uint32_t seed, long count)
+    {
+        if (!LevelsPresent())
+            return 1;
+
+        std::mt19937_64 rng(seed);
+        long utf8 = 0;
+        for (long i = 0; i < count; i++)
+        {
+            auto input = Generate(rng);
+            if (!Check(input))
+                return 1;
+            utf8 += Reference(input.data(), input.size(), false) == TextEncoding::UTF8;
+        }
+
+        printf("every level agrees on %ld inputs, %ld of them UTF-8\n", count, utf8);
+        return 0;
+    }
+
+    int Corners()
+    {
+        if (!LevelsPresent())
+            return 1;
+
+        static const uint8_t values[] = {0x00, 0x41, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF,
+                                         0xC0, 0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5};
+        const size_t count = sizeof values / sizeof values[0];
+        static const size_t offsets[] = {0, 14, 30, 61, 63};
+
+        long inputs = 0;
+        for (size_t length = 1; length <= 4; length++)
+        {
+            size_t combinations = 1;
+            for (size_t i = 0; i < length; i++)
+                combinations *= count;
+
+            for (auto offset : offsets)
+            {
+                for (size_t combination = 0; combination < combinations; combination++)
+                {
+                    std::vector<uint8_t> input(offset, 'a');
+                    for (size_t i = 0, rest = combination; i < length; i++, rest /= count)
+                        input.push_back(values[rest % count]);
+
+                    // once at the end of the buffer and once followed by more text
+                    if (!Check(input))
+                        return 1;
+                    input.insert(input.end(), 3, 'z');
+                    if (!Check(input))
+                        return 1;
+                    inputs += 2;
+                }
+            }
+        }
+
+        printf("every level agrees on %ld boundary inputs\n", inputs);
+        return 0;
+    }
+
+    void Time(const char* name, const std::vector<uint8_t>& text)
+    {
+        for (auto level : levels)
+        {
+            if (!Simd::Supports(level))
+                continue;
+
+            long rounds = 0;
+            Harness::Stopwatch stopwatch;
+            do
+            {
+                sink = static_cast<uint8_t>(TextEncoding::Detect(text.data(), text.size(), false, level));
+                rounds++;
+            } while (stopwatch.Milliseconds() < 300);
+
+            // on x86 the NEON level runs the plain C++ model, which says nothing about ARM64
+            auto seconds = stopwatch.Milliseconds() / 1000;
+            printf("%-6s level %u: %8.0f MB/s%s\n", name, level, text.size() * rounds / seconds / 1e6,
+                   level == Simd::NEON && Simd::Best() != Simd::NEON ? " (model)" : "");
+        }
+    }
+
+    int Bench(size_t megabytes)
+    {
+        std::mt19937_64 rng(1);
+        std::vector<uint8_t> ascii;
+        while (ascii.size() < megabytes << 20)
+            ascii.push_back(rng() % 12 == 0 ? '\n' : static_cast<uint8_t>(0x20 + rng() % 0x5F));
+
+        // Latin, Cyrillic and CJK words between ASCII punctuation, with an emoji now and then
+        static const uint32_t starts[] = {0xC0, 0x430, 0x4E00, 0x1F600};
+        std::vector<uint8_t> utf8;
+        while (utf8.size() < megabytes << 20)
+        {
+            auto script = rng() % 16 == 0 ? 3 : rng() % 3;
+            for (auto n = 2 + rng() % 6; n != 0; n--)
+                AppendCodePoint(utf8, static_cast<uint32_t>(starts[script] + rng() % 64));
+            utf8.push_back(rng() % 8 == 0 ? '.' : ' ');
+        }
+        ascii.resize(megabytes << 20);
+        utf8.resize(megabytes << 20);
+        while (utf8.back() >= 0x80)
+            utf8.pop_back();
+
+        if (Reference(ascii.data(), ascii.size(), false) != TextEncoding::ASCII ||
+            Reference(utf8.data(), utf8.size(), false) != TextEncoding::UTF8)
+        {
+            printf("the benchmark text is not what it should be\n");
+            return 1;
+        }
+
+        Time("ascii", ascii);
+        Time("utf-8", utf8);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && strcmp(argv[1], "fuzz") == 0)
+        return Fuzz(static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)), strtol(argv[3], nullptr, 10));
+    if (argc == 2 && strcmp(argv[1], "corners") == 0)
+        return Corners();
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0)
+        return Bench(argc == 3 ? strtoul(argv[2], nullptr, 10) : 10);
+
+    fprintf(stderr, "usage: textencoding_check fuzz <seed> <count> | corners | bench [MB]\n");
+    return 2;
+}
@@ -0,0 +1,252 @@
+# Writes test input and its "MAM\x04" container, compressed with an Xpress Huffman encoder written
+# from MS-XCA 2.2 that shares no code with XpressHuffman.cpp:
+#
+#   make_mam.py <zero|runs|text|utf16|random|FILE> <size> <raw out> <mam out> [seed]
+#
+# The match finder allows matches of up to 70000 bytes that run across the 64 KiB block boundary,
+# so every length encoding (in the symbol, one byte, two bytes and four bytes) shows up. Before
+# anything is written the stream is decoded again by a literal transcription of the decoder in
+# the specification, so that a broken encoder cannot make both sides agree.
+import heapq
+import random
+import struct
+import sys
+
+BLOCK_SIZE = 65536
+MAXIMUM_CODE_LENGTH = 15
+WINDOW = 65535
+MAXIMUM_MATCH = 70000
+
+
+def code_lengths(frequencies):
+    used = [symbol for symbol in range(512) if frequencies[symbol]]
+    lengths = [0] * 512
+    if len(used) == 1:
+        # a single symbol still needs a complete code, so give it a one-bit sibling
+        lengths[used[0]] = lengths[1 if used[0] == 0 else 0] = 1
+        return lengths
+
+    weights = list(frequencies)
+    while True:
+        heap = [(weights[symbol], symbol, (symbol,)) for symbol in used]
+        heapq.heapify(heap)
+        lengths = [0] * 512
+        serial = 512
+        while len(heap) > 1:
+            a, b = heapq.heappop(heap), heapq.heappop(heap)
+            for symbol in a[2] + b[2]:
+                lengths[symbol] += 1
+            serial += 1
+            heapq.heappush(heap, (a[0] + b[0], serial, a[2] + b[2]))
+        if max(lengths) <= MAXIMUM_CODE_LENGTH:
+            return lengths
+        # too deep: flatten the weights and build the tree again
+        weights = [max((weight + 1) // 2, 1) if weight else 0 for weight in weights]
+
+
+def canonical_codes(lengths):
+    codes = {}
+    code = 0
+    for length in range(1, MAXIMUM_CODE_LENGTH + 1):
+        for symbol in range(512):
+            if lengths[symbol] == length:
+                codes[symbol] = (code, length)
+                code += 1
+        code <<= 1
+    return codes
+
+
+class BitWriter:
+    # Bits go into 16-bit little-endian words, most significant bit first. The slot for a word is
+    # reserved when the word before it starts, so that the extra length bytes written in between
+    # land after both words, the way the decoder reads them.
+    def __init__(self):
+        self.out = bytearray()
+
+    def start_block(self, table):
+        self.out += table
+        self.slots = []
+        self.word = self.filled = self.total = 0
+        self.reserve()
+
+    def reserve(self):
+        self.slots.append(len(self.out))
+        self.out += b'\0\0'
+
+    def bits(self, value, count):
+        for i in reversed(range(count)):
+            if self.total % 16 == 0:
+                self.reserve()
+            self.word = self.word << 1 | (value >> i) & 1
+            self.filled += 1
+            self.total += 1
+            if self.filled == 16:
+                self.flush()
+
+    def flush(self):
+        at = self.slots.pop(0)
+        self.out[at:at + 2] = struct.pack('<H', self.word << 16 - self.filled)
+        self.word = self.filled = 0
+
+    def end_block(self):
+        if self.filled:
+            self.flush()
+
+
+def tokens(data, start, end):
+    chains = {}
+
+    def insert(at):
+        if at + 3 <= len(data):
+            chains.setdefault(data[at:at + 3], []).append(at)
+
+    for at in range(max(0, start - WINDOW), start):
+        insert(at)
+    result = []
+    at = start
+    while at < end:
+        length, distance = 0, 0
+        for candidate in reversed(chains.get(data[at:at + 3], [])[-16:]):
+            if at - candidate > WINDOW:
+                break
+            limit = min(MAXIMUM_MATCH, len(data) - at)
+            n = 0
+            while n < limit and data[candidate + n] == data[at + n]:
+                n += 1
+            if n > length:
+                length, distance = n, at - candidate
+        if length >= 3:
+            result.append((length, distance))
+            for covered in range(at, at + length):
+                insert(covered)
+            at += length
+        else:
+            result.append((data[at],))
+            insert(at)
+            at += 1
+    return result, at
+
+
+def compress(data):
+    writer = BitWriter()
+    at = 0
+    while at < len(data):
+        block, at = tokens(data, at, min(at + BLOCK_SIZE, len(data)))
+        frequencies = [0] * 512
+        symbols = []
+        for token in block:
+            if len(token) == 1:
+                symbol = token[0]
+            else:
+                length, distance = token
+                symbol = 256 + ((distance.bit_length() - 1) << 4) + min(length - 3, 15)
+            frequencies[symbol] += 1
+            symbols.append((symbol, token))
+
+        lengths = code_lengths(frequencies)
+        codes = canonical_codes(lengths)
+        writer.start_block(bytes(lengths[2 * i] | lengths[2 * i + 1] << 4 for i in range(256)))
+        for symbol, token in symbols:
+            writer.bits(*codes[symbol])
+            if len(token) == 1:
+                continue
+            length, distance = token[0] - 3, token[1]
+            if length >= 15:
+                if length - 15 < 255:
+                    writer.out.append(length - 15)
+                elif length < 65536:
+                    writer.out += struct.pack('<BH', 255, length)
+                else:
+                    writer.out += struct.pack('<BHI', 255, 0, length)
+            distance_bits = distance.bit_length() - 1
+            writer.bits(distance - (1 << distance_bits), distance_bits)
+        writer.end_block()
+    return bytes(writer.out)
+
+
+def decompress(source, size):
+    # MS-XCA 2.2.4, step by step
+    out = bytearray()
+    cursor = 0
+
+    def read16():
+        nonlocal cursor
+        value = struct.unpack_from('<H', source, cursor)[0] if cursor + 2 <= len(source) else 0
+        cursor += 2
+        return value
+
+    while len(out) < size:
+        lengths = []
+        for byte in source[cursor:cursor + 256]:
+            lengths += [byte & 15, byte >> 4]
+        cursor += 256
+        decode = {code: symbol for symbol, code in canonical_codes(lengths).items()}
+        next_bits = read16() << 16 | read16()
+        extra_bits = 16
+        block_end = min(len(out) + BLOCK_SIZE, size)
+        while len(out) < block_end:
+            for length in range(1, MAXIMUM_CODE_LENGTH + 1):
+                symbol = decode.get((next_bits >> 32 - length, length))
+                if symbol is not None:
+                    break
+            assert symbol is not None, 'undecodable bits'
+            next_bits = next_bits << length & 0xffffffff
+            extra_bits -= length
+            if extra_bits < 0:
+                next_bits |= read16() << -extra_bits
+                extra_bits += 16
+            if symbol < 256:
+                out.append(symbol)
+                continue
+
+            symbol -= 256
+            match_length, distance_bits = symbol & 15, symbol >> 4
+            if match_length == 15:
+                match_length = source[cursor]
+                cursor += 1
+                if match_length == 255:
+                    match_length = struct.unpack_from('<H', source, cursor)[0]
+                    cursor += 2
+                    if match_length == 0:
+                        match_length = struct.unpack_from('<I', source, cursor)[0]
+                        cursor += 4
+                    match_length -= 15
+                match_length += 15
+            match_length += 3
+            distance = (next_bits >> 32 - distance_bits if distance_bits else 0) | 1 << distance_bits
+            next_bits = next_bits << distance_bits & 0xffffffff
+            extra_bits -= distance_bits
+            if extra_bits < 0:
+                next_bits |= read16() << -extra_bits
+                extra_bits += 16
+            for _ in range(min(match_length, size - len(out))):
+                out.append(out[-distance])
+    return bytes(out)
+
+
+def generate(kind, size, rnd):
+    if kind == 'zero':
+        return bytes(size)
+    if kind == 'runs':
+        data = bytearray()
+        while len(data) < size:
+            data += bytes([rnd.getrandbits(8)]) * rnd.choice((1, 2, 5, 40, 300, 5000))
+        return bytes(data[:size])
+    if kind in ('text', 'utf16'):
+        words = [''.join(rnd.choice('etaoinshrdlucmfw') for _ in range(rnd.randint(1, 9))) for _ in range(400)]
+        text = ''
+        while len(text) < size:
+            text += rnd.choice(words) + rnd.choice((' ', ' ', '  ', ', ', '.\r\n'))
+        text = text[:size]
+        return text.encode('utf-16-le') if kind == 'utf16' else text.encode()
+    if kind == 'random':
+        return bytes(rnd.getrandbits(8) for _ in range(size))
+    return open(kind, 'rb').read()[:size]
+
+
+kind, size, raw_out, mam_out = sys.argv[1], int(sys.argv[2]), sys.argv[3], sys.argv[4]
+data = generate(kind, size, random.Random(int(sys.argv[5]) if len(sys.argv) > 5 else 1))
+compressed = compress(data)
+assert decompress(compressed, len(data)) == data, 'the reference decoder disagrees with the encoder'
+open(raw_out, 'wb').write(data)
+open(mam_out, 'wb').write(b'MAM\x04' + struct.pack('<I', len(data)) + compressed)
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks XpressHuffman against make_mam.py, an encoder written separately from the specification:
+# zeros, runs, text, UTF-16 text, random bytes and a system binary must all decompress to the bytes
+# they were made from, no prefix of a container may decode to anything else, and mutations must not
+# trip the sanitizers. BENCH=1 also prints the decompression speed of each kind in MB/s. Needs
+# python3.
+. "$(dirname "$0")/../common.sh"
+
+sources="$here/xpress_check.cpp $native/XpressHuffman.cpp"
+build xpress_check $sources
+
+containers=
+seed=1
+for kind in zero runs text utf16 random "${XPRESS_FILE:-/bin/sh}"; do
+    name=$(basename "$kind")
+    for size in 1 300 200000; do
+        python3 "$here/make_mam.py" "$kind" $size "$out/$name-$size" "$out/$name-$size.mam" $seed
+        "$out/xpress_check" decode "$out/$name-$size.mam" "$out/$name-$size.out"
+        same "$out/$name-$size" "$out/$name-$size.out"
+        containers="$containers $out/$name-$size.mam"
+        seed=$((seed + 1))
+    done
+    echo "$name: decoded"
+done
+
+"$out/xpress_check" truncate "$out/text-300.mam"
+"$out/xpress_check" truncate "$out/zero-200000.mam"
+"$out/xpress_check" fuzz 7 "$(iterations 5000)" $containers
+
+if bench; then
+    build_bench xpress_bench $sources
+    "$out/xpress_bench" bench "$out"/*-200000.mam
+fi
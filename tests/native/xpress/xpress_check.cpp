@@ -0,0 +1,163 @@
+﻿// Copyright © 2017-2026 QL-Win Contributors
+// 
+// This file is part of QuickLook program.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks XpressHuffman from the command line:
+//
+//   xpress_check decode <mam> <out>                decompresses a MAM container into out
+//   xpress_check truncate <mam>                    decodes every prefix of the container; each must
+//                                                  fail or give the same output as the whole
+//   xpress_check bench <mam>...                    prints the decompression speed of each file in MB/s
+//   xpress_check fuzz <seed> <count> <mam>...      decodes count mutations of the containers
+//
+// The containers come from make_mam.py, whose encoder shares no code with the decoder.
+
+#include "XpressHuffman.h"
+#include "harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<uint8_t> Decode(const std::vector<uint8_t>& input, bool* valid)
+    {
+        // a mutated size field can claim gigabytes, so the output is capped
+        auto size = std::min<size_t>(XpressHuffman::DecompressMam(input.data(), input.size(), nullptr, 0), 64 << 20);
+        std::vector<uint8_t> output(size);
+        *valid = size != 0 && XpressHuffman::DecompressMam(input.data(), input.size(), output.data(), size) == size;
+        return output;
+    }
+
+    int DecodeFile(const char* path, const char* outputPath)
+    {
+        bool valid;
+        auto output = Decode(Harness::ReadFile(path), &valid);
+        if (!valid)
+        {
+            fprintf(stderr, "%s: not decoded\n", path);
+            return 1;
+        }
+
+        auto file = fopen(outputPath, "wb");
+        if (file == nullptr || fwrite(output.data(), 1, output.size(), file) != output.size())
+            return 1;
+        fclose(file);
+        return 0;
+    }
+
+    int Truncate(const char* path)
+    {
+        auto input = Harness::ReadFile(path);
+        bool valid;
+        auto whole = Decode(input, &valid);
+        if (!valid)
+            return 1;
+
+        // the last words of a block can be padding, so a short prefix may still decode, but never
+        // to something else
+        size_t decoded = 0;
+        for (size_t size = 0; size < input.size(); size++)
+        {
+            // a fresh copy of exactly size bytes, so that ASan sees any read past the end
+            std::unique_ptr<uint8_t[]> prefix(new uint8_t[size]);
+            memcpy(prefix.get(), input.data(), size);
+            auto length = XpressHuffman::DecompressMam(prefix.get(), size, nullptr, 0);
+            if (length != whole.size())
+                continue;
+
+            std::vector<uint8_t> output(length);
+            if (XpressHuffman::DecompressMam(prefix.get(), size, output.data(), length) != length)
+                continue;
+            if (output != whole)
+            {
+                fprintf(stderr, "%s: the first %zu bytes decode to different output\n", path, size);
+                return 1;
+            }
+            decoded++;
+        }
+
+        printf("%s: %zu of %zu prefixes decode\n", path, decoded, input.size());
+        return 0;
+    }
+
+    int Bench(char** paths, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            auto input = Harness::ReadFile(paths[i]);
+            std::vector<uint8_t> output(XpressHuffman::DecompressMam(input.data(), input.size(), nullptr, 0));
+            if (output.empty())
+                return 1;
+
+            // repeat small files so that each run decodes at least 64 MB
+            auto repeats = std::max<size_t>(1, (64 << 20) / output.size());
+            double best = 1e9;
+            for (int run = 0; run < 3; run++)
+            {
+                Harness::Stopwatch stopwatch;
+                for (size_t repeat = 0; repeat < repeats; repeat++)
+                {
+                    if (XpressHuffman::DecompressMam(input.data(), input.size(), output.data(), output.size()) !=
+                        output.size())
+                        return 1;
+                }
+                best = std::min(best, stopwatch.Milliseconds() / 1000);
+            }
+            printf("%s: %zu to %zu bytes, %.0f MB/s\n", paths[i], input.size(), output.size(),
+                   output.size() * repeats / best / 1e6);
+        }
+        return 0;
+    }
+
+    int Fuzz(uint32_t seed, long iterations, char** paths, int count)
+    {
+        // the code length table is the first 256 bytes after the 8-byte container header; almost any
+        // damage makes a block fail, so only a change or two, to let some streams decode far
+        Harness::Mutator mutate;
+        mutate.hotBytes = 300;
+        mutate.maximumChanges = 2;
+        return Harness::Fuzz(Harness::ReadFiles(paths, count, 9), iterations, seed, mutate,
+                             [](const std::vector<uint8_t>& buffer)
+                             {
+                                 bool valid;
+                                 Decode(buffer, &valid);
+                                 return valid;
+                             });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "decode" && argc == 4)
+        return DecodeFile(argv[2], argv[3]);
+    if (mode == "truncate" && argc == 3)
+        return Truncate(argv[2]);
+    if (mode == "bench" && argc >= 3)
+        return Bench(argv + 2, argc - 2);
+    if (mode == "fuzz" && argc >= 5)
+        return Fuzz(static_cast<uint32_t>(atol(argv[2])), atol(argv[3]), argv + 4, argc - 4);
+
+    fprintf(stderr, "usage: xpress_check decode <mam> <out> | truncate <mam> | bench <mam>... | "
+                    "fuzz <seed> <count> <mam>...\n");
+    return 2;
+}